@@ -8,3 +8,12 @@
  */
 
 #include "xenia/apu/nop/nop_apu_flags.h"
+
+DEFINE_string(nop_audio_wav_path, "",
+              "Write audio played through the nop audio system to this WAV "
+              "file.",
+              "APU");
+DEFINE_bool(nop_audio_unpaced, false,
+            "Consume audio frames in the nop audio system as soon as they are "
+            "submitted instead of at the real-time rate. For benchmarking.",
+            "APU");
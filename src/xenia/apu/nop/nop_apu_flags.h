@@ -10,4 +10,9 @@
 #ifndef XENIA_APU_NOP_NOP_APU_FLAGS_H_
 #define XENIA_APU_NOP_NOP_APU_FLAGS_H_
 
+#include "xenia/base/cvar.h"
+
+DECLARE_string(nop_audio_wav_path);
+DECLARE_bool(nop_audio_unpaced);
+
 #endif  // XENIA_APU_NOP_NOP_APU_FLAGS_H_
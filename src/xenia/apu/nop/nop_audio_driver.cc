@@ -0,0 +1,186 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2020 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include "xenia/apu/nop/nop_audio_driver.h"
+
+#include <algorithm>
+#include <cinttypes>
+#include <functional>
+
+#include "xenia/base/assert.h"
+#include "xenia/base/byte_order.h"
+#include "xenia/base/logging.h"
+
+namespace xe {
+namespace apu {
+namespace nop {
+
+// Time a sound device takes to play one frame.
+static const std::chrono::nanoseconds kFramePeriod(
+    1000000000ull * NopAudioDriver::kChannelSamples /
+    NopAudioDriver::kFrameFrequency);
+// If the consumer is ever this far behind (host hitch, debugger break) it
+// restarts the clock rather than draining the backlog in a burst.
+static const uint32_t kMaxLagFrames = 8;
+
+NopAudioDriver::NopAudioDriver(Memory* memory,
+                               xe::threading::Semaphore* semaphore,
+                               bool unpaced)
+    : AudioDriver(memory), semaphore_(semaphore), unpaced_(unpaced) {}
+
+NopAudioDriver::~NopAudioDriver() {
+  assert_false(consumer_thread_);
+  assert_true(frames_queued_.empty());
+  assert_true(frames_unused_.empty());
+}
+
+bool NopAudioDriver::Initialize() {
+  running_ = true;
+  consumer_thread_ = xe::threading::Thread::Create(
+      {}, std::bind(&NopAudioDriver::ConsumerThreadMain, this));
+  if (!consumer_thread_) {
+    running_ = false;
+    return false;
+  }
+  consumer_thread_->set_name("Nop Audio Driver");
+  return true;
+}
+
+void NopAudioDriver::SubmitFrame(uint32_t frame_ptr) {
+  const auto input_frame = memory_->TranslateVirtual<float*>(frame_ptr);
+  float* output_frame;
+  {
+    std::lock_guard<std::mutex> lock(frames_mutex_);
+    if (frames_unused_.empty()) {
+      output_frame = new float[kFrameSamples];
+    } else {
+      output_frame = frames_unused_.top();
+      frames_unused_.pop();
+    }
+  }
+
+  // Interleave the data, as a device would take it.
+  for (size_t index = 0, o = 0; index < kChannelSamples; ++index) {
+    for (size_t channel = 0, table = 0; channel < kFrameChannels;
+         ++channel, table += kChannelSamples) {
+      output_frame[o++] = xe::byte_swap(input_frame[table + index]);
+    }
+  }
+
+  auto now = Clock::now();
+  {
+    std::lock_guard<std::mutex> lock(frames_mutex_);
+    frames_queued_.push(output_frame);
+
+    ++telemetry_.frames_submitted;
+    uint32_t depth = uint32_t(frames_queued_.size());
+    telemetry_.queue_depth_total += depth;
+    telemetry_.queue_depth_max = std::max(telemetry_.queue_depth_max, depth);
+    // The slots the guest starts out with were never released by us.
+    if (!release_times_.empty()) {
+      auto latency = std::chrono::duration_cast<std::chrono::nanoseconds>(
+          now - release_times_.front());
+      release_times_.pop();
+      ++telemetry_.latency_samples;
+      telemetry_.latency_total += latency;
+      telemetry_.latency_max = std::max(telemetry_.latency_max, latency);
+    }
+  }
+  frames_cond_.notify_one();
+}
+
+void NopAudioDriver::ConsumerThreadMain() {
+  auto deadline = Clock::now();
+  std::unique_lock<std::mutex> lock(frames_mutex_);
+  while (running_) {
+    if (unpaced_) {
+      frames_cond_.wait(
+          lock, [this] { return !running_ || !frames_queued_.empty(); });
+    } else {
+      deadline += kFramePeriod;
+      frames_cond_.wait_until(lock, deadline, [this] { return !running_; });
+      auto now = Clock::now();
+      if (now - deadline > kFramePeriod * kMaxLagFrames) {
+        deadline = now;
+      }
+    }
+    if (!running_) {
+      break;
+    }
+
+    if (frames_queued_.empty()) {
+      // Nothing to play. Only counts once the guest has started submitting.
+      if (telemetry_.frames_submitted) {
+        ++telemetry_.underruns;
+      }
+      continue;
+    }
+    float* frame = frames_queued_.front();
+    frames_queued_.pop();
+
+    lock.unlock();
+    ConsumeFrame(frame);
+    lock.lock();
+
+    frames_unused_.push(frame);
+    ++telemetry_.frames_consumed;
+    release_times_.push(Clock::now());
+    auto ret = semaphore_->Release(1, nullptr);
+    assert_true(ret);
+  }
+}
+
+void NopAudioDriver::Shutdown() {
+  if (consumer_thread_) {
+    {
+      std::lock_guard<std::mutex> lock(frames_mutex_);
+      running_ = false;
+    }
+    frames_cond_.notify_all();
+    xe::threading::Wait(consumer_thread_.get(), false);
+    consumer_thread_.reset();
+  }
+
+  auto telemetry = GetTelemetry();
+  if (telemetry.frames_submitted) {
+    XELOGI("Nop audio driver: %" PRIu64 " frames submitted, %" PRIu64
+           " consumed, %" PRIu64 " underruns",
+           telemetry.frames_submitted, telemetry.frames_consumed,
+           telemetry.underruns);
+    XELOGI("Nop audio driver: queue depth avg %.2f max %u",
+           double(telemetry.queue_depth_total) / telemetry.frames_submitted,
+           telemetry.queue_depth_max);
+    if (telemetry.latency_samples) {
+      XELOGI(
+          "Nop audio driver: callback-to-submit latency avg %.3fms max "
+          "%.3fms",
+          telemetry.latency_total.count() / 1e6 / telemetry.latency_samples,
+          telemetry.latency_max.count() / 1e6);
+    }
+  }
+
+  std::lock_guard<std::mutex> lock(frames_mutex_);
+  while (!frames_unused_.empty()) {
+    delete[] frames_unused_.top();
+    frames_unused_.pop();
+  }
+  while (!frames_queued_.empty()) {
+    delete[] frames_queued_.front();
+    frames_queued_.pop();
+  }
+}
+
+NopAudioDriver::Telemetry NopAudioDriver::GetTelemetry() {
+  std::lock_guard<std::mutex> lock(frames_mutex_);
+  return telemetry_;
+}
+
+}  // namespace nop
+}  // namespace apu
+}  // namespace xe
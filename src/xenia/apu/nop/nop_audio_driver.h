@@ -0,0 +1,92 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2020 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#ifndef XENIA_APU_NOP_NOP_AUDIO_DRIVER_H_
+#define XENIA_APU_NOP_NOP_AUDIO_DRIVER_H_
+
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <stack>
+
+#include "xenia/apu/audio_driver.h"
+#include "xenia/base/threading.h"
+
+namespace xe {
+namespace apu {
+namespace nop {
+
+// Plays frames into nothing, on the same schedule a sound device would pull
+// them, so guest audio callbacks run at a realistic pace on hosts without
+// audio hardware. Also tracks how well the guest keeps up.
+class NopAudioDriver : public AudioDriver {
+ public:
+  struct Telemetry {
+    uint64_t frames_submitted = 0;
+    uint64_t frames_consumed = 0;
+    // Frame periods where the guest had nothing queued.
+    uint64_t underruns = 0;
+    // Queue depth right after each submission.
+    uint64_t queue_depth_total = 0;
+    uint32_t queue_depth_max = 0;
+    // Time between freeing a slot (which wakes the guest callback) and the
+    // frame that fills it being submitted.
+    uint64_t latency_samples = 0;
+    std::chrono::nanoseconds latency_total = {};
+    std::chrono::nanoseconds latency_max = {};
+  };
+
+  static const uint32_t kFrameFrequency = 48000;
+  static const uint32_t kFrameChannels = 6;
+  static const uint32_t kChannelSamples = 256;
+  static const uint32_t kFrameSamples = kFrameChannels * kChannelSamples;
+
+  // When unpaced, frames are consumed as soon as they arrive.
+  NopAudioDriver(Memory* memory, xe::threading::Semaphore* semaphore,
+                 bool unpaced);
+  ~NopAudioDriver() override;
+
+  virtual bool Initialize();
+  void SubmitFrame(uint32_t frame_ptr) override;
+  virtual void Shutdown();
+
+  Telemetry GetTelemetry();
+
+ protected:
+  // Called on the consumer thread with an interleaved frame of
+  // kFrameSamples floats.
+  virtual void ConsumeFrame(const float* frame) {}
+
+ private:
+  using Clock = std::chrono::steady_clock;
+
+  void ConsumerThreadMain();
+
+  xe::threading::Semaphore* semaphore_ = nullptr;
+  bool unpaced_ = false;
+
+  std::unique_ptr<xe::threading::Thread> consumer_thread_;
+  bool running_ = false;
+
+  std::mutex frames_mutex_;
+  std::condition_variable frames_cond_;
+  std::queue<float*> frames_queued_;
+  std::stack<float*> frames_unused_;
+  // When each slot handed back to the guest was freed, oldest first.
+  std::queue<Clock::time_point> release_times_;
+  Telemetry telemetry_;
+};
+
+}  // namespace nop
+}  // namespace apu
+}  // namespace xe
+
+#endif  // XENIA_APU_NOP_NOP_AUDIO_DRIVER_H_
@@ -10,6 +10,10 @@
 #include "xenia/apu/nop/nop_audio_system.h"
 
 #include "xenia/apu/apu_flags.h"
+#include "xenia/apu/nop/nop_apu_flags.h"
+#include "xenia/apu/nop/nop_audio_driver.h"
+#include "xenia/apu/nop/wav_audio_driver.h"
+#include "xenia/base/string.h"
 
 namespace xe {
 namespace apu {
@@ -27,10 +31,44 @@ NopAudioSystem::~NopAudioSystem() = default;
 X_STATUS NopAudioSystem::CreateDriver(size_t index,
                                       xe::threading::Semaphore* semaphore,
                                       AudioDriver** out_driver) {
-  return X_STATUS_NOT_IMPLEMENTED;
+  assert_not_null(out_driver);
+  NopAudioDriver* driver;
+  if (!cvars::nop_audio_wav_path.empty()) {
+    // Every client after the first gets its own file: out.wav, out.1.wav...
+    auto path = xe::to_wstring(cvars::nop_audio_wav_path);
+    if (index) {
+      auto suffix = L"." + std::to_wstring(index);
+      auto dot = path.find_last_of(L'.');
+      auto separator = path.find_last_of(L"/\\");
+      if (dot == std::wstring::npos ||
+          (separator != std::wstring::npos && dot < separator)) {
+        path += suffix;
+      } else {
+        path.insert(dot, suffix);
+      }
+    }
+    driver = new WavAudioDriver(memory_, semaphore, cvars::nop_audio_unpaced,
+                                path);
+  } else {
+    driver = new NopAudioDriver(memory_, semaphore, cvars::nop_audio_unpaced);
+  }
+  if (!driver->Initialize()) {
+    driver->Shutdown();
+    delete driver;
+    return X_STATUS_UNSUCCESSFUL;
+  }
+
+  *out_driver = driver;
+  return X_STATUS_SUCCESS;
 }
 
-void NopAudioSystem::DestroyDriver(AudioDriver* driver) { assert_always(); }
+void NopAudioSystem::DestroyDriver(AudioDriver* driver) {
+  assert_not_null(driver);
+  auto nop_driver = dynamic_cast<NopAudioDriver*>(driver);
+  assert_not_null(nop_driver);
+  nop_driver->Shutdown();
+  delete nop_driver;
+}
 
 }  // namespace nop
 }  // namespace apu
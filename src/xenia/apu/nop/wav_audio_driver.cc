@@ -0,0 +1,98 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2020 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include "xenia/apu/nop/wav_audio_driver.h"
+
+#include <cstring>
+
+#include "xenia/apu/apu_flags.h"
+#include "xenia/base/assert.h"
+#include "xenia/base/filesystem.h"
+#include "xenia/base/logging.h"
+#include "xenia/base/memory.h"
+
+namespace xe {
+namespace apu {
+namespace nop {
+
+static const size_t kWavHeaderSize = 44;
+
+WavAudioDriver::WavAudioDriver(Memory* memory,
+                               xe::threading::Semaphore* semaphore,
+                               bool unpaced, const std::wstring& path)
+    : NopAudioDriver(memory, semaphore, unpaced), path_(path) {}
+
+WavAudioDriver::~WavAudioDriver() { assert_null(file_); }
+
+bool WavAudioDriver::Initialize() {
+  file_ = xe::filesystem::OpenFile(path_, "wb");
+  if (!file_) {
+    XELOGE("Unable to open audio output file %ls", path_.c_str());
+    return false;
+  }
+  // Sizes are filled in on shutdown.
+  WriteHeader();
+  return NopAudioDriver::Initialize();
+}
+
+void WavAudioDriver::Shutdown() {
+  // Stops the consumer, so nothing else writes to the file.
+  NopAudioDriver::Shutdown();
+  if (file_) {
+    WriteHeader();
+    fclose(file_);
+    file_ = nullptr;
+    XELOGI("Wrote %u bytes of audio to %ls", data_size_, path_.c_str());
+  }
+}
+
+void WavAudioDriver::ConsumeFrame(const float* frame) {
+  const uint32_t frame_size = kFrameSamples * sizeof(float);
+  // RIFF sizes are 32-bit; stop at about an hour and a half of 5.1 audio.
+  if (data_size_ > UINT32_MAX - kWavHeaderSize - frame_size) {
+    return;
+  }
+  if (cvars::mute) {
+    static const float silence[kFrameSamples] = {};
+    fwrite(silence, 1, frame_size, file_);
+  } else {
+    fwrite(frame, 1, frame_size, file_);
+  }
+  data_size_ += frame_size;
+}
+
+void WavAudioDriver::WriteHeader() {
+  // Canonical header for WAVE_FORMAT_IEEE_FLOAT, which is little endian like
+  // the hosts we run on.
+  const uint16_t channels = kFrameChannels;
+  const uint32_t sample_rate = kFrameFrequency;
+  const uint16_t bits_per_sample = 32;
+  const uint16_t block_align = channels * bits_per_sample / 8;
+  uint8_t header[kWavHeaderSize];
+  std::memcpy(header, "RIFF", 4);
+  xe::store<uint32_t>(header + 4, uint32_t(kWavHeaderSize - 8) + data_size_);
+  std::memcpy(header + 8, "WAVEfmt ", 8);
+  xe::store<uint32_t>(header + 16, 16);
+  xe::store<uint16_t>(header + 20, 3);
+  xe::store<uint16_t>(header + 22, channels);
+  xe::store<uint32_t>(header + 24, sample_rate);
+  xe::store<uint32_t>(header + 28, sample_rate * block_align);
+  xe::store<uint16_t>(header + 32, block_align);
+  xe::store<uint16_t>(header + 34, bits_per_sample);
+  std::memcpy(header + 36, "data", 4);
+  xe::store<uint32_t>(header + 40, data_size_);
+
+  fseek(file_, 0, SEEK_SET);
+  fwrite(header, 1, sizeof(header), file_);
+  fseek(file_, 0, SEEK_END);
+}
+
+}  // namespace nop
+}  // namespace apu
+}  // namespace xe
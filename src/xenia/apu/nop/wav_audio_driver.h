@@ -0,0 +1,47 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2020 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#ifndef XENIA_APU_NOP_WAV_AUDIO_DRIVER_H_
+#define XENIA_APU_NOP_WAV_AUDIO_DRIVER_H_
+
+#include <cstdio>
+#include <string>
+
+#include "xenia/apu/nop/nop_audio_driver.h"
+
+namespace xe {
+namespace apu {
+namespace nop {
+
+// Nop driver that also records everything it plays to a 32-bit float WAV.
+class WavAudioDriver : public NopAudioDriver {
+ public:
+  WavAudioDriver(Memory* memory, xe::threading::Semaphore* semaphore,
+                 bool unpaced, const std::wstring& path);
+  ~WavAudioDriver() override;
+
+  bool Initialize() override;
+  void Shutdown() override;
+
+ protected:
+  void ConsumeFrame(const float* frame) override;
+
+ private:
+  void WriteHeader();
+
+  std::wstring path_;
+  FILE* file_ = nullptr;
+  uint32_t data_size_ = 0;
+};
+
+}  // namespace nop
+}  // namespace apu
+}  // namespace xe
+
+#endif  // XENIA_APU_NOP_WAV_AUDIO_DRIVER_H_
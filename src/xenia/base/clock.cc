@@ -10,8 +10,11 @@
 #include "xenia/base/clock.h"
 
 #include <algorithm>
+#include <atomic>
+#include <condition_variable>
 #include <limits>
 #include <mutex>
+#include <set>
 
 #include "xenia/base/assert.h"
 #include "xenia/base/math.h"
@@ -24,6 +27,16 @@ DEFINE_bool(clock_source_raw, false,
             "Use the RDTSC instruction as the time source. "
             "Host CPU must support invariant TSC. ",
             "CPU");
+DEFINE_bool(clock_virtual, false,
+            "Derive guest time from the number of guest instructions executed "
+            "instead of the host clock, skipping ahead while the guest sleeps. "
+            "The guest then sees the same timing on every run of a workload, "
+            "for benchmarks and traces. Overrides time scaling.",
+            "CPU");
+DEFINE_int32(clock_virtual_instructions_per_tick, 64,
+             "Guest instructions per tick of the guest clock with "
+             "clock_virtual. 64 is a 3.2GHz CPU against the 50MHz time base.",
+             "CPU");
 
 namespace xe {
 
@@ -45,6 +58,46 @@ uint64_t last_host_tick_count_ = Clock::QueryHostTickCount();
 // Mutex to ensure last_host_tick_count_ and last_guest_tick_count_ are in sync
 std::mutex tick_mutex_;
 
+// Guest instructions executed, plus idle time skipped in instructions, when
+// the guest clock is virtual.
+std::atomic<uint64_t> virtual_instruction_count_ = {0};
+
+// Guest threads running, and those of them blocked, with the instruction
+// counts at which those in SkipGuestIdle are done.
+std::mutex idle_mutex_;
+std::condition_variable idle_cv_;
+uint32_t guest_thread_count_ = 0;
+uint32_t blocked_guest_thread_count_ = 0;
+std::multiset<uint64_t> idle_deadlines_;
+// First of idle_deadlines_, or UINT64_MAX, checked without the lock.
+std::atomic<uint64_t> next_idle_deadline_ = {UINT64_MAX};
+
+inline uint64_t VirtualInstructionsPerTick() {
+  return uint64_t(std::max(cvars::clock_virtual_instructions_per_tick, 1));
+}
+
+// Whether the guest system time is the host's, unscaled.
+inline bool GuestTimeIsHostTime() {
+  return cvars::clock_no_scaling && !cvars::clock_virtual;
+}
+
+// Skips guest time ahead to the first idle deadline if no guest thread is left
+// to move it. Called with idle_mutex_ held.
+void SkipToIdleDeadline() {
+  if (idle_deadlines_.empty() ||
+      blocked_guest_thread_count_ < guest_thread_count_) {
+    return;
+  }
+  uint64_t deadline = *idle_deadlines_.begin();
+  uint64_t instruction_count =
+      virtual_instruction_count_.load(std::memory_order_relaxed);
+  if (deadline > instruction_count) {
+    virtual_instruction_count_.fetch_add(deadline - instruction_count,
+                                         std::memory_order_relaxed);
+  }
+  idle_cv_.notify_all();
+}
+
 void RecomputeGuestTickScalar() {
   // Create a rational number with numerator (first) and denominator (second)
   auto frac =
@@ -68,6 +121,11 @@ void RecomputeGuestTickScalar() {
 // Update the guest timer for all threads.
 // Return a copy of the value so locking is reduced.
 uint64_t UpdateGuestClock() {
+  if (cvars::clock_virtual) {
+    return virtual_instruction_count_.load(std::memory_order_relaxed) /
+           VirtualInstructionsPerTick();
+  }
+
   uint64_t host_tick_count = Clock::QueryHostTickCount();
 
   if (cvars::clock_no_scaling) {
@@ -95,7 +153,7 @@ uint64_t UpdateGuestClock() {
 
 // Offset of the current guest system file time relative to the guest base time.
 inline uint64_t QueryGuestSystemTimeOffset() {
-  if (cvars::clock_no_scaling) {
+  if (GuestTimeIsHostTime()) {
     return Clock::QueryHostSystemTime() - guest_system_time_base_;
   }
 
@@ -158,7 +216,7 @@ uint64_t Clock::QueryGuestTickCount() {
 }
 
 uint64_t Clock::QueryGuestSystemTime() {
-  if (cvars::clock_no_scaling) {
+  if (GuestTimeIsHostTime()) {
     return Clock::QueryHostSystemTime();
   }
 
@@ -173,7 +231,7 @@ uint32_t Clock::QueryGuestUptimeMillis() {
 }
 
 void Clock::SetGuestSystemTime(uint64_t system_time) {
-  if (cvars::clock_no_scaling) {
+  if (GuestTimeIsHostTime()) {
     // Time is fixed to host time.
     return;
   }
@@ -183,8 +241,72 @@ void Clock::SetGuestSystemTime(uint64_t system_time) {
   guest_system_time_base_ = system_time - guest_system_time_offset;
 }
 
+void Clock::AdvanceGuestInstructions(uint64_t instruction_count) {
+  uint64_t new_count = virtual_instruction_count_.fetch_add(
+                           instruction_count, std::memory_order_relaxed) +
+                       instruction_count;
+  if (new_count >= next_idle_deadline_.load(std::memory_order_relaxed)) {
+    // Threads still running got there first.
+    std::lock_guard<std::mutex> lock(idle_mutex_);
+    idle_cv_.notify_all();
+  }
+}
+
+void Clock::SkipGuestIdle(uint64_t guest_file_time) {
+  uint64_t numerator = guest_tick_frequency_;
+  uint64_t denominator = 10000000;  // 100ns/10MHz resolution
+  reduce_fraction(numerator, denominator);
+  uint64_t instruction_count =
+      guest_file_time * numerator / denominator * VirtualInstructionsPerTick();
+
+  std::unique_lock<std::mutex> lock(idle_mutex_);
+  uint64_t deadline =
+      virtual_instruction_count_.load(std::memory_order_relaxed) +
+      instruction_count;
+  auto it = idle_deadlines_.insert(deadline);
+  next_idle_deadline_.store(*idle_deadlines_.begin(),
+                            std::memory_order_relaxed);
+  ++blocked_guest_thread_count_;
+  SkipToIdleDeadline();
+  idle_cv_.wait(lock, [deadline]() {
+    return virtual_instruction_count_.load(std::memory_order_relaxed) >=
+           deadline;
+  });
+  --blocked_guest_thread_count_;
+  idle_deadlines_.erase(it);
+  next_idle_deadline_.store(
+      idle_deadlines_.empty() ? UINT64_MAX : *idle_deadlines_.begin(),
+      std::memory_order_relaxed);
+}
+
+void Clock::AddGuestThread() {
+  std::lock_guard<std::mutex> lock(idle_mutex_);
+  ++guest_thread_count_;
+}
+
+void Clock::RemoveGuestThread() {
+  std::lock_guard<std::mutex> lock(idle_mutex_);
+  --guest_thread_count_;
+  SkipToIdleDeadline();
+}
+
+void Clock::BeginGuestWait() {
+  std::lock_guard<std::mutex> lock(idle_mutex_);
+  ++blocked_guest_thread_count_;
+  SkipToIdleDeadline();
+}
+
+void Clock::EndGuestWait() {
+  std::lock_guard<std::mutex> lock(idle_mutex_);
+  --blocked_guest_thread_count_;
+}
+
+void Clock::ResetGuestVirtualTime() {
+  virtual_instruction_count_.store(0, std::memory_order_relaxed);
+}
+
 uint32_t Clock::ScaleGuestDurationMillis(uint32_t guest_ms) {
-  if (cvars::clock_no_scaling) {
+  if (cvars::clock_no_scaling || cvars::clock_virtual) {
     return guest_ms;
   }
 
@@ -201,10 +323,21 @@ uint32_t Clock::ScaleGuestDurationMillis(uint32_t guest_ms) {
 }
 
 int64_t Clock::ScaleGuestDurationFileTime(int64_t guest_file_time) {
-  if (cvars::clock_no_scaling) {
+  if (cvars::clock_no_scaling && !cvars::clock_virtual) {
     return static_cast<uint64_t>(guest_file_time);
   }
 
+  if (cvars::clock_virtual) {
+    // Guest time has no relation to the host's, so absolute times are made
+    // relative, as they would be after the same time of the guest's.
+    if (guest_file_time <= 0) {
+      return guest_file_time;
+    }
+    int64_t relative_time =
+        guest_file_time - static_cast<int64_t>(QueryGuestSystemTime());
+    return -std::max<int64_t>(relative_time, 1);
+  }
+
   if (!guest_file_time) {
     return 0;
   } else if (guest_file_time > 0) {
@@ -224,7 +357,7 @@ int64_t Clock::ScaleGuestDurationFileTime(int64_t guest_file_time) {
 }
 
 void Clock::ScaleGuestDurationTimeval(int32_t* tv_sec, int32_t* tv_usec) {
-  if (cvars::clock_no_scaling) {
+  if (cvars::clock_no_scaling || cvars::clock_virtual) {
     return;
   }
 
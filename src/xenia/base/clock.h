@@ -16,6 +16,8 @@
 
 DECLARE_bool(clock_no_scaling);
 DECLARE_bool(clock_source_raw);
+DECLARE_bool(clock_virtual);
+DECLARE_int32(clock_virtual_instructions_per_tick);
 
 namespace xe {
 
@@ -66,6 +68,24 @@ class Clock {
   // Sets the system time of the guest.
   static void SetGuestSystemTime(uint64_t system_time);
 
+  // Virtual guest time (--clock_virtual), which instead of following the host
+  // only moves as the guest runs, so the guest sees the same timing on every
+  // run of the same workload.
+  // Adds to the guest instructions executed so far.
+  static void AdvanceGuestInstructions(uint64_t instruction_count);
+  // Waits for a duration in 100ns ticks like FILETIME of guest time. Once all
+  // guest threads are blocked, guest time skips ahead to the earliest end of
+  // such a wait, as it would have been spent idle.
+  static void SkipGuestIdle(uint64_t guest_file_time);
+  // Guest threads, counted from when they start running until they exit, and
+  // their blocking waits for anything else, for when guest time can skip.
+  static void AddGuestThread();
+  static void RemoveGuestThread();
+  static void BeginGuestWait();
+  static void EndGuestWait();
+  // Restarts virtual guest time from 0.
+  static void ResetGuestVirtualTime();
+
   // Scales a time duration in milliseconds, from guest time.
   static uint32_t ScaleGuestDurationMillis(uint32_t guest_ms);
   // Scales a time duration in 100ns ticks like FILETIME, from guest time.
@@ -64,7 +64,11 @@ void StringBuffer::AppendFormat(const char* format, ...) {
 }
 
 void StringBuffer::AppendVarargs(const char* format, va_list args) {
-  int length = vsnprintf(nullptr, 0, format, args);
+  // The list can only be walked once on some ABIs (like System V x86-64).
+  va_list size_args;
+  va_copy(size_args, args);
+  int length = vsnprintf(nullptr, 0, format, size_args);
+  va_end(size_args);
   Grow(length + 1);
   vsnprintf(buffer_ + buffer_offset_, buffer_capacity_, format, args);
   buffer_offset_ += length;
@@ -99,6 +99,15 @@ SleepResult AlertableSleep(std::chrono::duration<Rep, Period> duration) {
       std::chrono::duration_cast<std::chrono::microseconds>(duration));
 }
 
+// Registers the word the current thread's generated code polls at its
+// safepoints. It's set while the thread is asked to suspend, and the code then
+// calls ProcessSafepoint. nullptr unregisters it. Only used where the host
+// can't suspend a running thread itself (POSIX), and ignored elsewhere.
+void SetSafepointFlag(volatile uint32_t* flag);
+// Blocks while the current thread is suspended. User callbacks are not run
+// here, only in alertable waits.
+void ProcessSafepoint();
+
 typedef uint32_t TlsHandle;
 constexpr TlsHandle kInvalidTlsHandle = UINT_MAX;
 
@@ -393,6 +402,8 @@ class Thread : public WaitHandle {
   virtual bool Resume(uint32_t* out_new_suspend_count = nullptr) = 0;
 
   // Suspends the specified thread.
+  // On POSIX, a running thread stops at its next safepoint and a thread blocked
+  // in a host wait once the wait ends, so this returns before it has stopped.
   virtual bool Suspend(uint32_t* out_previous_suspend_count = nullptr) = 0;
 
   // Terminates the thread.
@@ -13,13 +13,20 @@
 #include "xenia/base/logging.h"
 
 #include <pthread.h>
+#include <signal.h>
 #include <sys/eventfd.h>
+#include <sys/select.h>
 #include <sys/syscall.h>
 #include <sys/time.h>
 #include <sys/types.h>
 #include <time.h>
 #include <unistd.h>
 
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+
 namespace xe {
 namespace threading {
 
@@ -54,10 +61,233 @@ void Sleep(std::chrono::microseconds duration) {
   // TODO(benvanik): spin while rmtp >0?
 }
 
-// TODO(dougvj) Not sure how to implement the equivalent of this on POSIX.
+// POSIX threads can't be suspended or sent callbacks by others, so requests
+// are queued here and acted on by the thread itself. Suspension takes effect
+// at the safepoints of guest code. User callbacks, as on Windows, only run in
+// alertable waits, and threads blocked in one are interrupted with
+// kAlertSignal.
+class PosixThreadControl {
+ public:
+  explicit PosixThreadControl(uint32_t suspend_count)
+      : suspend_count_(suspend_count) {}
+
+  void set_handle(pthread_t handle) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    handle_ = handle;
+  }
+
+  void SetFlag(volatile uint32_t* flag) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (flag_) {
+      *flag_ = 0;
+    }
+    flag_ = flag;
+    UpdateFlag();
+  }
+
+  void QueueUserCallback(std::function<void()> callback) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    callbacks_.push_back(std::move(callback));
+    cond_.notify_all();
+    if (in_alertable_wait_ && !dispatching_) {
+      pthread_kill(handle_, kAlertSignal);
+    }
+  }
+
+  uint32_t Suspend(bool is_current_thread) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    uint32_t previous_suspend_count = suspend_count_++;
+    UpdateFlag();
+    if (is_current_thread) {
+      WaitWhileSuspended(lock);
+    }
+    return previous_suspend_count;
+  }
+
+  bool Resume(uint32_t* out_previous_suspend_count) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (out_previous_suspend_count) {
+      *out_previous_suspend_count = suspend_count_;
+    }
+    if (suspend_count_ && !--suspend_count_) {
+      UpdateFlag();
+      cond_.notify_all();
+    }
+    return true;
+  }
+
+  // Called by the thread itself.
+  void ProcessSafepoint() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    WaitWhileSuspended(lock);
+  }
+
+  SleepResult AlertableSleep(std::chrono::microseconds duration) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    cond_.wait_for(lock, duration,
+                   [this]() { return !callbacks_.empty() && !dispatching_; });
+    return DispatchCallbacks(lock) ? SleepResult::kAlerted
+                                   : SleepResult::kSuccess;
+  }
+
+  // Waits on a file descriptor until it's readable, the timeout passes, or a
+  // callback is queued.
+  WaitResult AlertableWait(int fd, const timespec* timeout) {
+    InstallAlertHandler();
+    // The signal is blocked until pselect unblocks it, so one sent after the
+    // queue is checked still interrupts the wait.
+    sigset_t alert_set, previous_set;
+    sigemptyset(&alert_set);
+    sigaddset(&alert_set, kAlertSignal);
+    pthread_sigmask(SIG_BLOCK, &alert_set, &previous_set);
+    sigset_t wait_set = previous_set;
+    sigdelset(&wait_set, kAlertSignal);
+    // Other signals interrupt pselect too, after which it waits again for
+    // what's left of the timeout.
+    timespec deadline;
+    if (timeout) {
+      clock_gettime(CLOCK_MONOTONIC, &deadline);
+      deadline.tv_sec += timeout->tv_sec;
+      deadline.tv_nsec += timeout->tv_nsec;
+      if (deadline.tv_nsec >= 1000000000) {
+        deadline.tv_sec += 1;
+        deadline.tv_nsec -= 1000000000;
+      }
+    }
+    WaitResult result;
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+      if (DispatchCallbacks(lock)) {
+        result = WaitResult::kUserCallback;
+        break;
+      }
+      timespec remaining;
+      if (timeout) {
+        timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        remaining.tv_sec = deadline.tv_sec - now.tv_sec;
+        remaining.tv_nsec = deadline.tv_nsec - now.tv_nsec;
+        if (remaining.tv_nsec < 0) {
+          remaining.tv_sec -= 1;
+          remaining.tv_nsec += 1000000000;
+        }
+        if (remaining.tv_sec < 0) {
+          remaining = {0, 0};
+        }
+      }
+      in_alertable_wait_ = true;
+      lock.unlock();
+      fd_set set;
+      FD_ZERO(&set);
+      FD_SET(fd, &set);
+      int ret = pselect(fd + 1, &set, nullptr, nullptr,
+                        timeout ? &remaining : nullptr, &wait_set);
+      int error = errno;
+      lock.lock();
+      in_alertable_wait_ = false;
+      if (ret == -1 && error == EINTR) {
+        continue;
+      }
+      if (ret == -1) {
+        result = WaitResult::kFailed;
+      } else {
+        result = ret ? WaitResult::kSuccess : WaitResult::kTimeout;
+      }
+      break;
+    }
+    lock.unlock();
+    pthread_sigmask(SIG_SETMASK, &previous_set, nullptr);
+    return result;
+  }
+
+  static void InstallAlertHandler() {
+    static std::once_flag once;
+    std::call_once(once, []() {
+      struct sigaction action = {};
+      // Only there to interrupt the wait, so no SA_RESTART.
+      action.sa_handler = [](int) {};
+      sigemptyset(&action.sa_mask);
+      sigaction(kAlertSignal, &action, nullptr);
+    });
+  }
+
+ private:
+  static const int kAlertSignal;
+
+  // The flag is set while the thread is asked to suspend.
+  void UpdateFlag() {
+    if (flag_) {
+      *flag_ = suspend_count_ != 0;
+    }
+  }
+
+  void WaitWhileSuspended(std::unique_lock<std::mutex>& lock) {
+    cond_.wait(lock, [this]() { return !suspend_count_; });
+  }
+
+  bool DispatchCallbacks(std::unique_lock<std::mutex>& lock) {
+    if (dispatching_ || callbacks_.empty()) {
+      return false;
+    }
+    dispatching_ = true;
+    while (!callbacks_.empty()) {
+      auto callback = std::move(callbacks_.front());
+      callbacks_.pop_front();
+      lock.unlock();
+      callback();
+      lock.lock();
+      WaitWhileSuspended(lock);
+    }
+    dispatching_ = false;
+    return true;
+  }
+
+  std::mutex mutex_;
+  std::condition_variable cond_;
+  std::deque<std::function<void()>> callbacks_;
+  uint32_t suspend_count_ = 0;
+  bool dispatching_ = false;
+  bool in_alertable_wait_ = false;
+  volatile uint32_t* flag_ = nullptr;
+  pthread_t handle_ = {};
+};
+
+const int PosixThreadControl::kAlertSignal = SIGRTMIN;
+
+// Held by the thread for its lifetime. The flag is dropped on exit, as the
+// context it lives in may be freed before the thread object is.
+struct CurrentThreadControl {
+  std::shared_ptr<PosixThreadControl> control;
+  ~CurrentThreadControl() {
+    if (control) {
+      control->SetFlag(nullptr);
+    }
+  }
+};
+thread_local CurrentThreadControl current_control_;
+
+PosixThreadControl* GetCurrentThreadControl() {
+  if (!current_control_.control) {
+    current_control_.control = std::make_shared<PosixThreadControl>(0);
+    current_control_.control->set_handle(pthread_self());
+  }
+  return current_control_.control.get();
+}
+
+void SetSafepointFlag(volatile uint32_t* flag) {
+  if (flag || current_control_.control) {
+    GetCurrentThreadControl()->SetFlag(flag);
+  }
+}
+
+void ProcessSafepoint() {
+  if (current_control_.control) {
+    current_control_.control->ProcessSafepoint();
+  }
+}
+
 SleepResult AlertableSleep(std::chrono::microseconds duration) {
-  sleep(duration.count() / 1000);
-  return SleepResult::kSuccess;
+  return GetCurrentThreadControl()->AlertableSleep(duration);
 }
 
 // TODO(dougvj) We can probably wrap this with pthread_key_t but the type of
@@ -231,25 +461,35 @@ WaitResult Wait(WaitHandle* wait_handle, bool is_alertable,
   struct timeval time_val;
   int ret;
 
-  FD_ZERO(&set);
-  FD_SET(handle, &set);
-
-  time_val.tv_sec = timeout.count() / 1000;
-  time_val.tv_usec = timeout.count() * 1000;
-  ret = select(handle + 1, &set, NULL, NULL, &time_val);
-  if (ret == -1) {
-    return WaitResult::kFailed;
-  } else if (ret == 0) {
-    return WaitResult::kTimeout;
+  if (is_alertable) {
+    timespec time_spec = {time_t(timeout.count() / 1000),
+                          long(timeout.count() % 1000) * 1000000};
+    WaitResult result = GetCurrentThreadControl()->AlertableWait(
+        static_cast<int>(handle), &time_spec);
+    if (result != WaitResult::kSuccess) {
+      return result;
+    }
   } else {
-    uint64_t buf = 0;
-    ret = read(handle, &buf, sizeof(buf));
-    if (ret < 8) {
+    FD_ZERO(&set);
+    FD_SET(handle, &set);
+
+    time_val.tv_sec = timeout.count() / 1000;
+    time_val.tv_usec = (timeout.count() % 1000) * 1000;
+    ret = select(handle + 1, &set, NULL, NULL, &time_val);
+    if (ret == -1) {
+      return WaitResult::kFailed;
+    } else if (ret == 0) {
       return WaitResult::kTimeout;
     }
+  }
 
-    return WaitResult::kSuccess;
+  uint64_t buf = 0;
+  ret = read(handle, &buf, sizeof(buf));
+  if (ret < 8) {
+    return WaitResult::kTimeout;
   }
+
+  return WaitResult::kSuccess;
 }
 
 // TODO(dougvj)
@@ -296,7 +536,7 @@ std::unique_ptr<Event> Event::CreateAutoResetEvent(bool initial_state) {
     return nullptr;
   }
 
-  return std::make_unique<PosixEvent>(PosixEvent(fd));
+  return std::make_unique<PosixEvent>(fd);
 }
 
 // TODO(dougvj)
@@ -362,7 +602,8 @@ std::unique_ptr<Timer> Timer::CreateSynchronizationTimer() {
 
 class PosixThread : public PosixThreadHandle<Thread> {
  public:
-  explicit PosixThread(pthread_t handle) : PosixThreadHandle(handle) {}
+  PosixThread(pthread_t handle, std::shared_ptr<PosixThreadControl> control)
+      : PosixThreadHandle(handle), control_(std::move(control)) {}
   ~PosixThread() = default;
 
   void set_name(std::string name) override {
@@ -392,34 +633,47 @@ class PosixThread : public PosixThreadHandle<Thread> {
     int ret = pthread_setschedparam(handle_, SCHED_FIFO, &param);
   }
 
-  // TODO(DrChat)
   void QueueUserCallback(std::function<void()> callback) override {
-    assert_always();
+    control_->QueueUserCallback(std::move(callback));
   }
 
   bool Resume(uint32_t* out_new_suspend_count = nullptr) override {
-    assert_always();
-    return false;
+    return control_->Resume(out_new_suspend_count);
   }
 
   bool Suspend(uint32_t* out_previous_suspend_count = nullptr) override {
-    assert_always();
-    return false;
+    uint32_t previous_suspend_count =
+        control_->Suspend(control_ == current_control_.control);
+    if (out_previous_suspend_count) {
+      *out_previous_suspend_count = previous_suspend_count;
+    }
+    return true;
   }
 
   void Terminate(int exit_code) override {}
+
+ private:
+  // Shared by every object for the thread.
+  std::shared_ptr<PosixThreadControl> control_;
 };
 
 thread_local std::unique_ptr<PosixThread> current_thread_ = nullptr;
 
 struct ThreadStartData {
   std::function<void()> start_routine;
+  std::shared_ptr<PosixThreadControl> control;
 };
 void* ThreadStartRoutine(void* parameter) {
-  current_thread_ =
-      std::unique_ptr<PosixThread>(new PosixThread(::pthread_self()));
-
   auto start_data = reinterpret_cast<ThreadStartData*>(parameter);
+  current_control_.control = start_data->control;
+  // Before anything can wait alertably and be signaled, rather than relying
+  // on the creator, which may not have returned from pthread_create yet.
+  current_control_.control->set_handle(pthread_self());
+  current_thread_ = std::unique_ptr<PosixThread>(
+      new PosixThread(::pthread_self(), start_data->control));
+
+  // Created suspended threads wait here to be resumed.
+  current_control_.control->ProcessSafepoint();
   start_data->start_routine();
   delete start_data;
   return 0;
@@ -427,9 +681,10 @@ void* ThreadStartRoutine(void* parameter) {
 
 std::unique_ptr<Thread> Thread::Create(CreationParameters params,
                                        std::function<void()> start_routine) {
-  auto start_data = new ThreadStartData({std::move(start_routine)});
+  auto control =
+      std::make_shared<PosixThreadControl>(params.create_suspended ? 1 : 0);
+  auto start_data = new ThreadStartData({std::move(start_routine), control});
 
-  assert_false(params.create_suspended);
   pthread_t handle;
   pthread_attr_t attr;
   pthread_attr_init(&attr);
@@ -442,7 +697,8 @@ std::unique_ptr<Thread> Thread::Create(CreationParameters params,
     return nullptr;
   }
 
-  return std::unique_ptr<PosixThread>(new PosixThread(handle));
+  return std::unique_ptr<PosixThread>(
+      new PosixThread(handle, std::move(control)));
 }
 
 Thread* Thread::GetCurrentThread() {
@@ -452,7 +708,9 @@ Thread* Thread::GetCurrentThread() {
 
   pthread_t handle = pthread_self();
 
-  current_thread_ = std::make_unique<PosixThread>(handle);
+  GetCurrentThreadControl();
+  current_thread_ =
+      std::make_unique<PosixThread>(handle, current_control_.control);
   return current_thread_.get();
 }
 
@@ -97,6 +97,11 @@ SleepResult AlertableSleep(std::chrono::microseconds duration) {
   return SleepResult::kSuccess;
 }
 
+// Callbacks are dispatched and threads suspended by the host.
+void SetSafepointFlag(volatile uint32_t* flag) {}
+
+void ProcessSafepoint() {}
+
 TlsHandle AllocateTlsHandle() { return TlsAlloc(); }
 
 bool FreeTlsHandle(TlsHandle handle) { return TlsFree(handle) ? true : false; }
@@ -10,6 +10,7 @@
 #ifndef XENIA_CPU_BACKEND_BACKEND_H_
 #define XENIA_CPU_BACKEND_BACKEND_H_
 
+#include <cstdint>
 #include <memory>
 
 #include "xenia/cpu/backend/machine_info.h"
@@ -32,6 +33,11 @@ namespace backend {
 class Assembler;
 class CodeCache;
 
+// Runs a guest function without compiling it, called with the context, the
+// data given to SetupInterpreterEntry and the guest return address.
+typedef void (*InterpreterEntry)(void* raw_context, void* data,
+                                 uint32_t return_address);
+
 class Backend {
  public:
   explicit Backend();
@@ -54,6 +60,22 @@ class Backend {
   virtual std::unique_ptr<GuestFunction> CreateGuestFunction(
       Module* module, uint32_t address) = 0;
 
+  // Has calls to the function, through its machine code and the indirection
+  // table, go to the interpreter entry until it is compiled. Returns false if
+  // the backend can't.
+  virtual bool SetupInterpreterEntry(GuestFunction* function,
+                                     InterpreterEntry entry, void* data) {
+    return false;
+  }
+
+  // Called when the guest code of a function has changed, once it can no
+  // longer be resolved. It may still be running, and direct callers must end
+  // up at whatever is compiled for its address next.
+  virtual void RetireFunction(GuestFunction* function) {}
+  // Called once nothing can be running a function anymore, to free what was
+  // generated for it.
+  virtual void ReleaseFunction(GuestFunction* function) {}
+
   // Calculates the next host instruction based on the current thread state and
   // current PC. This will look for branches and other control flow
   // instructions.
@@ -97,9 +97,16 @@ bool X64Assembler::Assemble(GuestFunction* function, HIRBuilder* builder,
   // Install into indirection table.
   uint64_t host_address = reinterpret_cast<uint64_t>(machine_code);
   assert_true((host_address >> 32) == 0);
-  reinterpret_cast<X64CodeCache*>(backend_->code_cache())
-      ->AddIndirection(function->address(),
-                       static_cast<uint32_t>(host_address));
+  auto code_cache = reinterpret_cast<X64CodeCache*>(backend_->code_cache());
+  code_cache->AddIndirection(function->address(),
+                             static_cast<uint32_t>(host_address));
+
+  // Callers that went to the interpreter for the function come here instead.
+  auto interpreter_entry =
+      static_cast<X64Function*>(function)->interpreter_entry();
+  if (interpreter_entry) {
+    code_cache->RetireGuestCode(function->address(), interpreter_entry);
+  }
 
   return true;
 }
@@ -16,6 +16,7 @@
 
 #include "xenia/base/exception_handler.h"
 #include "xenia/base/logging.h"
+#include "xenia/base/memory.h"
 #include "xenia/cpu/backend/x64/x64_assembler.h"
 #include "xenia/cpu/backend/x64/x64_code_cache.h"
 #include "xenia/cpu/backend/x64/x64_emitter.h"
@@ -149,6 +150,67 @@ std::unique_ptr<GuestFunction> X64Backend::CreateGuestFunction(
   return std::make_unique<X64Function>(module, address);
 }
 
+bool X64Backend::SetupInterpreterEntry(GuestFunction* function,
+                                       InterpreterEntry entry, void* data) {
+  // mov rdx, data
+  // mov r8, rcx
+  // mov rcx, entry
+  // mov eax, guest_to_host_thunk
+  // jmp rax
+  // Called as a compiled function is, with the return address in rcx, and
+  // calls the entry through the guest-to-host thunk as externs are. The first
+  // instruction is over 5 bytes so that RetireGuestCode can patch it once
+  // the function is compiled.
+  const size_t stub_size = 30;
+  uint8_t stub[stub_size];
+  stub[0] = 0x48;
+  stub[1] = 0xBA;
+  xe::store<uint64_t>(stub + 2, reinterpret_cast<uint64_t>(data));
+  stub[10] = 0x49;
+  stub[11] = 0x89;
+  stub[12] = 0xC8;
+  stub[13] = 0x48;
+  stub[14] = 0xB9;
+  xe::store<uint64_t>(stub + 15, reinterpret_cast<uint64_t>(entry));
+  assert_zero(uint64_t(guest_to_host_thunk_) & 0xFFFFFFFF00000000ull);
+  stub[23] = 0xB8;
+  xe::store<uint32_t>(stub + 24, uint32_t(uint64_t(guest_to_host_thunk_)));
+  stub[28] = 0xFF;
+  stub[29] = 0xE0;
+
+  EmitFunctionInfo func_info = {};
+  func_info.code_size.total = stub_size;
+  func_info.code_size.body = stub_size;
+  auto code = code_cache_->PlaceGuestCode(function->address(), stub,
+                                          func_info, function);
+  static_cast<X64Function*>(function)->SetupInterpreterEntry(
+      reinterpret_cast<uint8_t*>(code), stub_size);
+  return true;
+}
+
+void X64Backend::RetireFunction(GuestFunction* function) {
+  auto x64_function = static_cast<X64Function*>(function);
+  x64_function->set_retired();
+  if (x64_function->machine_code()) {
+    code_cache_->RetireGuestCode(function->address(),
+                                 x64_function->machine_code());
+  }
+}
+
+void X64Backend::ReleaseFunction(GuestFunction* function) {
+  auto x64_function = static_cast<X64Function*>(function);
+  auto interpreter_entry = x64_function->interpreter_entry();
+  if (x64_function->machine_code() &&
+      x64_function->machine_code() != interpreter_entry) {
+    code_cache_->FreeGuestCode(function->address(),
+                               x64_function->machine_code());
+  }
+  if (interpreter_entry) {
+    code_cache_->FreeGuestCode(function->address(), interpreter_entry);
+  }
+  x64_function->Setup(nullptr, 0);
+}
+
 uint64_t ReadCapstoneReg(X64Context* context, x86_reg reg) {
   switch (reg) {
     case X86_REG_RAX:
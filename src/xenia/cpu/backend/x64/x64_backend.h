@@ -61,6 +61,11 @@ class X64Backend : public Backend {
   std::unique_ptr<GuestFunction> CreateGuestFunction(Module* module,
                                                      uint32_t address) override;
 
+  bool SetupInterpreterEntry(GuestFunction* function, InterpreterEntry entry,
+                             void* data) override;
+  void RetireFunction(GuestFunction* function) override;
+  void ReleaseFunction(GuestFunction* function) override;
+
   uint64_t CalculateNextHostInstruction(ThreadDebugInfo* thread_info,
                                         uint64_t current_pc) override;
 
@@ -9,8 +9,10 @@
 
 #include "xenia/cpu/backend/x64/x64_code_cache.h"
 
+#include <algorithm>
 #include <cstdlib>
 #include <cstring>
+#include <iterator>
 
 #if ENABLE_VTUNE
 #include "third_party/vtune/include/jitprofiling.h"
@@ -18,6 +20,7 @@
 #endif
 
 #include "xenia/base/assert.h"
+#include "xenia/base/atomic.h"
 #include "xenia/base/clock.h"
 #include "xenia/base/logging.h"
 #include "xenia/base/math.h"
@@ -85,7 +88,10 @@ bool X64CodeCache::Initialize() {
   }
 
   // Preallocate the function map to a large, reasonable size.
-  generated_code_map_.reserve(kMaximumFunctionCount);
+  for (auto& map : generated_code_maps_) {
+    map.entries.reset(
+        new std::pair<uint64_t, GuestFunction*>[kMaximumFunctionCount]);
+  }
 
   return true;
 }
@@ -134,60 +140,53 @@ void* X64CodeCache::PlaceHostCode(uint32_t guest_address, void* machine_code,
 void* X64CodeCache::PlaceGuestCode(uint32_t guest_address, void* machine_code,
                                    const EmitFunctionInfo& func_info,
                                    GuestFunction* function_info) {
-  // Hold a lock while we bump the pointers up. This is important as the
-  // unwind table requires entries AND code to be sorted in order.
-  size_t low_mark;
-  size_t high_mark;
+  // Hold a lock while we find space. This is important as the unwind table
+  // and function map are kept sorted by code address.
   uint8_t* code_address;
   UnwindReservation unwind_reservation;
   {
     auto global_lock = global_critical_region_.Acquire();
 
-    low_mark = generated_code_offset_;
-
-    // Reserve code.
+    // Reserve code, followed by its unwind info.
     // Always move the code to land on 16b alignment.
-    code_address = generated_code_base_ + generated_code_offset_;
-    generated_code_offset_ += xe::round_up(func_info.code_size.total, 16);
-
-    auto tail_address = generated_code_base_ + generated_code_offset_;
-
-    // Reserve unwind info.
     // We go on the high size of the unwind info as we don't know how big we
     // need it, and a few extra bytes of padding isn't the worst thing.
-    unwind_reservation =
-        RequestUnwindReservation(generated_code_base_ + generated_code_offset_);
-    generated_code_offset_ += xe::round_up(unwind_reservation.data_size, 16);
-
-    auto end_address = generated_code_base_ + generated_code_offset_;
-
-    high_mark = generated_code_offset_;
-
-    // Store in map. It is maintained in sorted order of host PC dependent on
-    // us also being append-only.
-    generated_code_map_.emplace_back(
-        (uint64_t(code_address - generated_code_base_) << 32) |
-            generated_code_offset_,
-        function_info);
-
-    // TODO(DrChat): The following code doesn't really need to be under the
-    // global lock except for PlaceCode (but it depends on the previous code
-    // already being ran)
-
-    // If we are going above the high water mark of committed memory, commit
-    // some more. It's ok if multiple threads do this, as redundant commits
-    // aren't harmful.
-    size_t old_commit_mark, new_commit_mark;
-    do {
-      old_commit_mark = generated_code_commit_mark_;
-      if (high_mark <= old_commit_mark) break;
-
-      new_commit_mark = old_commit_mark + 16 * 1024 * 1024;
-      xe::memory::AllocFixed(generated_code_base_, new_commit_mark,
-                             xe::memory::AllocationType::kCommit,
-                             xe::memory::PageAccess::kExecuteReadWrite);
-    } while (generated_code_commit_mark_.compare_exchange_weak(
-        old_commit_mark, new_commit_mark));
+    size_t code_size = xe::round_up(func_info.code_size.total, 16);
+    unwind_reservation = RequestUnwindReservation();
+    size_t total_size =
+        code_size + xe::round_up(unwind_reservation.data_size, 16);
+    size_t code_offset = AllocateCode(total_size);
+    code_address = generated_code_base_ + code_offset;
+    unwind_reservation.entry_address = code_address + code_size;
+
+    auto tail_address = code_address + func_info.code_size.total;
+    auto end_address = code_address + total_size;
+
+    // Store in map, which is maintained in sorted order of host PC.
+    uint64_t map_key =
+        (uint64_t(code_offset) << 32) | (code_offset + total_size);
+    if (generated_code_maps_[0].count < kMaximumFunctionCount) {
+      UpdateCodeMap([map_key, function_info](CodeMap& map) {
+        auto begin = map.entries.get();
+        auto end = begin + map.count;
+        auto it = std::upper_bound(
+            begin, end, map_key,
+            [](uint64_t key, const std::pair<uint64_t, GuestFunction*>& b) {
+              return key < b.first;
+            });
+        std::move_backward(it, end, end + 1);
+        *it = std::make_pair(map_key, function_info);
+        ++map.count;
+      });
+    } else {
+      XELOGE("Too many functions in the code cache to look them up");
+      assert_always();
+    }
+    for (auto callee : func_info.direct_callees) {
+      size_t callee_offset = callee - generated_code_base_;
+      direct_callees_[code_offset].push_back(callee_offset);
+      direct_callers_[callee_offset].push_back(code_offset);
+    }
 
     // Copy code.
     std::memcpy(code_address, machine_code, func_info.code_size.total);
@@ -235,23 +234,172 @@ void* X64CodeCache::PlaceGuestCode(uint32_t guest_address, void* machine_code,
 }
 
 uint32_t X64CodeCache::PlaceData(const void* data, size_t length) {
-  // Hold a lock while we bump the pointers up.
-  size_t high_mark;
+  // Hold a lock while we find space.
   uint8_t* data_address = nullptr;
   {
     auto global_lock = global_critical_region_.Acquire();
 
     // Reserve code.
     // Always move the code to land on 16b alignment.
-    data_address = generated_code_base_ + generated_code_offset_;
-    generated_code_offset_ += xe::round_up(length, 16);
+    data_address =
+        generated_code_base_ + AllocateCode(xe::round_up(length, 16));
+  }
 
-    high_mark = generated_code_offset_;
+  // Copy code.
+  std::memcpy(data_address, data, length);
+
+  return uint32_t(uintptr_t(data_address));
+}
+
+void X64CodeCache::RetireGuestCode(uint32_t guest_address,
+                                   void* code_address) {
+  auto global_lock = global_critical_region_.Acquire();
+  size_t code_offset =
+      static_cast<uint8_t*>(code_address) - generated_code_base_;
+  if (!indirection_table_base_ || retirement_stubs_.count(code_offset)) {
+    return;
   }
+  ResetIndirection(guest_address, code_address);
+
+  // mov ebx, guest_address
+  // mov eax, [rbx]
+  // jmp rax
+  // As a call through the indirection table, landing in the resolve thunk if
+  // nothing has been compiled for the address again yet.
+  size_t stub_offset = AllocateCode(16);
+  uint8_t* stub = generated_code_base_ + stub_offset;
+  std::memset(stub, 0xCC, 16);
+  stub[0] = 0xBB;
+  xe::store<uint32_t>(stub + 1, guest_address);
+  stub[5] = 0x8B;
+  stub[6] = 0x03;
+  stub[7] = 0xFF;
+  stub[8] = 0xE0;
+  retirement_stubs_[code_offset] = stub_offset;
+
+  // Replace the first 5 bytes of the code with a jmp to the stub. They're
+  // written along with the 3 after them, unchanged, in a single aligned 8 byte
+  // store so threads entering it at the same time see one or the other. The
+  // prolog always starts with a 7 byte sub rsp, so no thread can be partway
+  // into the bytes replaced.
+  auto entry = reinterpret_cast<volatile int64_t*>(code_address);
+  int64_t value = *entry;
+  auto patch = reinterpret_cast<uint8_t*>(&value);
+  patch[0] = 0xE9;
+  xe::store<int32_t>(patch + 1, int32_t(stub_offset - (code_offset + 5)));
+  xe::atomic_exchange(value, entry);
+}
 
-  // If we are going above the high water mark of committed memory, commit some
-  // more. It's ok if multiple threads do this, as redundant commits aren't
-  // harmful.
+void X64CodeCache::FreeGuestCode(uint32_t guest_address, void* code_address) {
+  auto global_lock = global_critical_region_.Acquire();
+  size_t code_offset =
+      static_cast<uint8_t*>(code_address) - generated_code_base_;
+  auto find_entry = [code_offset](CodeMap& map) {
+    auto begin = map.entries.get();
+    auto end = begin + map.count;
+    auto it = std::lower_bound(
+        begin, end, code_offset,
+        [](const std::pair<uint64_t, GuestFunction*>& element, size_t offset) {
+          return (element.first >> 32) < offset;
+        });
+    return it != end && (it->first >> 32) == code_offset ? it : nullptr;
+  };
+  auto entry = find_entry(generated_code_maps_[0]);
+  if (!entry) {
+    assert_always();
+    return;
+  }
+  size_t end_offset = uint32_t(entry->first);
+  UpdateCodeMap([&find_entry](CodeMap& map) {
+    auto it = find_entry(map);
+    std::move(it + 1, map.entries.get() + map.count, it);
+    --map.count;
+  });
+  ResetIndirection(guest_address, code_address);
+  RemoveCode(code_address);
+
+  // Code it called directly may have been waiting on it.
+  auto callees_it = direct_callees_.find(code_offset);
+  if (callees_it != direct_callees_.end()) {
+    std::vector<size_t> callees = std::move(callees_it->second);
+    direct_callees_.erase(callees_it);
+    for (size_t callee_offset : callees) {
+      auto& callers = direct_callers_[callee_offset];
+      callers.erase(std::find(callers.begin(), callers.end(), code_offset));
+      if (callers.empty()) {
+        direct_callers_.erase(callee_offset);
+        FreeReleasedEntry(callee_offset);
+      }
+    }
+  }
+
+  auto stub_it = retirement_stubs_.find(code_offset);
+  if (stub_it != retirement_stubs_.end() &&
+      direct_callers_.count(code_offset)) {
+    // Callers still jump to the entry, which goes on to the stub.
+    released_entries_.insert(code_offset);
+    FreeCode(code_offset + 16, end_offset - code_offset - 16);
+    return;
+  }
+  auto callers_it = direct_callers_.find(code_offset);
+  if (callers_it != direct_callers_.end()) {
+    // Not retired, so freed along with its callers.
+    for (size_t caller_offset : callers_it->second) {
+      auto& callees = direct_callees_[caller_offset];
+      callees.erase(std::find(callees.begin(), callees.end(), code_offset));
+    }
+    direct_callers_.erase(callers_it);
+  }
+  if (stub_it != retirement_stubs_.end()) {
+    FreeCode(stub_it->second, 16);
+    retirement_stubs_.erase(stub_it);
+  }
+  FreeCode(code_offset, end_offset - code_offset);
+}
+
+void X64CodeCache::FreeReleasedEntry(size_t code_offset) {
+  if (!released_entries_.erase(code_offset)) {
+    return;
+  }
+  auto stub_it = retirement_stubs_.find(code_offset);
+  FreeCode(stub_it->second, 16);
+  retirement_stubs_.erase(stub_it);
+  FreeCode(code_offset, 16);
+}
+
+void X64CodeCache::ResetIndirection(uint32_t guest_address,
+                                    void* code_address) {
+  if (!guest_address || !indirection_table_base_) {
+    return;
+  }
+  // Only if nothing newer has been placed for the address already.
+  uint32_t* indirection_slot = reinterpret_cast<uint32_t*>(
+      indirection_table_base_ + (guest_address - kIndirectionTableBase));
+  if (*indirection_slot == uint32_t(reinterpret_cast<uint64_t>(code_address))) {
+    *indirection_slot = indirection_default_value_;
+  }
+}
+
+size_t X64CodeCache::AllocateCode(size_t size) {
+  size_t offset;
+  auto best_fit = free_ranges_by_size_.lower_bound(std::make_pair(size, 0));
+  if (best_fit != free_ranges_by_size_.end()) {
+    size_t range_size = best_fit->first;
+    offset = best_fit->second;
+    EraseFreeRange(free_ranges_.find(offset));
+    if (range_size > size) {
+      InsertFreeRange(offset + size, range_size - size);
+    }
+  } else {
+    offset = generated_code_offset_;
+    generated_code_offset_ += size;
+  }
+  generated_code_used_ += size;
+
+  // If we are going above the high water mark of committed memory, commit
+  // some more. It's ok if multiple threads do this, as redundant commits
+  // aren't harmful.
+  size_t high_mark = offset + size;
   size_t old_commit_mark, new_commit_mark;
   do {
     old_commit_mark = generated_code_commit_mark_;
@@ -264,36 +412,90 @@ uint32_t X64CodeCache::PlaceData(const void* data, size_t length) {
   } while (generated_code_commit_mark_.compare_exchange_weak(old_commit_mark,
                                                              new_commit_mark));
 
-  // Copy code.
-  std::memcpy(data_address, data, length);
+  return offset;
+}
 
-  return uint32_t(uintptr_t(data_address));
+void X64CodeCache::FreeCode(size_t offset, size_t size) {
+  generated_code_used_ -= size;
+  // Anything still jumping here traps.
+  std::memset(generated_code_base_ + offset, 0xCC, size);
+
+  // Merge with the free neighbors.
+  auto next = free_ranges_.lower_bound(offset);
+  if (next != free_ranges_.begin()) {
+    auto prev = std::prev(next);
+    if (prev->first + prev->second == offset) {
+      offset = prev->first;
+      size += prev->second;
+      EraseFreeRange(prev);
+    }
+  }
+  if (next != free_ranges_.end() && next->first == offset + size) {
+    size += next->second;
+    EraseFreeRange(next);
+  }
+
+  if (offset + size == generated_code_offset_) {
+    generated_code_offset_ = offset;
+  } else {
+    InsertFreeRange(offset, size);
+  }
+}
+
+void X64CodeCache::InsertFreeRange(size_t offset, size_t size) {
+  free_ranges_.emplace(offset, size);
+  free_ranges_by_size_.emplace(size, offset);
+}
+
+void X64CodeCache::EraseFreeRange(std::map<size_t, size_t>::iterator it) {
+  free_ranges_by_size_.erase(std::make_pair(it->second, it->first));
+  free_ranges_.erase(it);
+}
+
+size_t X64CodeCache::used_size() {
+  auto global_lock = global_critical_region_.Acquire();
+  return generated_code_used_;
+}
+
+size_t X64CodeCache::high_water_mark() {
+  auto global_lock = global_critical_region_.Acquire();
+  return generated_code_offset_;
+}
+
+void X64CodeCache::UpdateCodeMap(std::function<void(CodeMap& map)> update) {
+  uint32_t version =
+      generated_code_map_version_.load(std::memory_order_relaxed);
+  update(generated_code_maps_[(version + 1) & 1]);
+  generated_code_map_version_.store(version + 1, std::memory_order_release);
+  // The other copy is only changed once lookups can see it's not in use.
+  std::atomic_thread_fence(std::memory_order_release);
+  update(generated_code_maps_[version & 1]);
 }
 
 GuestFunction* X64CodeCache::LookupFunction(uint64_t host_pc) {
   uint32_t key = uint32_t(host_pc - kGeneratedCodeBase);
-  void* fn_entry = std::bsearch(
-      &key, generated_code_map_.data(), generated_code_map_.size() + 1,
-      sizeof(std::pair<uint32_t, Function*>),
-      [](const void* key_ptr, const void* element_ptr) {
-        auto key = *reinterpret_cast<const uint32_t*>(key_ptr);
-        auto element =
-            reinterpret_cast<const std::pair<uint64_t, GuestFunction*>*>(
-                element_ptr);
-        if (key < (element->first >> 32)) {
-          return -1;
-        } else if (key > uint32_t(element->first)) {
-          return 1;
-        } else {
-          return 0;
-        }
-      });
-  if (fn_entry) {
-    return reinterpret_cast<const std::pair<uint64_t, GuestFunction*>*>(
-               fn_entry)
-        ->second;
-  } else {
-    return nullptr;
+  while (true) {
+    uint32_t version =
+        generated_code_map_version_.load(std::memory_order_acquire);
+    const CodeMap& map = generated_code_maps_[version & 1];
+    auto begin = map.entries.get();
+    auto end = begin + map.count.load(std::memory_order_relaxed);
+    // The last function starting at or before the key.
+    auto it = std::upper_bound(
+        begin, end, key,
+        [](uint32_t key, const std::pair<uint64_t, GuestFunction*>& element) {
+          return key < (element.first >> 32);
+        });
+    GuestFunction* function = nullptr;
+    if (it != begin && key < uint32_t((it - 1)->first)) {
+      function = (it - 1)->second;
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (generated_code_map_version_.load(std::memory_order_relaxed) ==
+        version) {
+      return function;
+    }
+    // Changed while it was read.
   }
 }
 
@@ -11,8 +11,13 @@
 #define XENIA_CPU_BACKEND_X64_X64_CODE_CACHE_H_
 
 #include <atomic>
+#include <functional>
+#include <map>
 #include <memory>
+#include <set>
 #include <string>
+#include <unordered_map>
+#include <unordered_set>
 #include <utility>
 #include <vector>
 
@@ -35,6 +40,9 @@ struct EmitFunctionInfo {
   } code_size;
   size_t prolog_stack_alloc_offset;  // offset of instruction after stack alloc
   size_t stack_size;
+  // Code the function calls directly rather than through the indirection
+  // table.
+  std::vector<uint8_t*> direct_callees;
 };
 
 class X64CodeCache : public CodeCache {
@@ -66,6 +74,22 @@ class X64CodeCache : public CodeCache {
                        GuestFunction* function_info);
   uint32_t PlaceData(const void* data, size_t length);
 
+  // Sends callers of guest code that may still be running - including those
+  // bound to it directly - through the indirection table, where they find
+  // whatever has been compiled for guest_address since. The code itself is
+  // kept until FreeGuestCode.
+  void RetireGuestCode(uint32_t guest_address, void* code_address);
+  // Returns the space of guest code, and of its retirement stub if any, to be
+  // reused. Nothing may be running it anymore. Retired code that other code
+  // still calls directly keeps its entry and stub until those callers are
+  // freed too.
+  void FreeGuestCode(uint32_t guest_address, void* code_address);
+
+  // Bytes of generated code and data currently placed.
+  size_t used_size();
+  // End of the space in use, past which nothing has been placed.
+  size_t high_water_mark();
+
   GuestFunction* LookupFunction(uint64_t host_pc) override;
 
  protected:
@@ -86,18 +110,38 @@ class X64CodeCache : public CodeCache {
 
   struct UnwindReservation {
     size_t data_size = 0;
-    size_t table_slot = 0;
     uint8_t* entry_address = 0;
   };
+  struct CodeMap {
+    std::unique_ptr<std::pair<uint64_t, GuestFunction*>[]> entries;
+    std::atomic<size_t> count = {0};
+  };
 
   X64CodeCache();
 
-  virtual UnwindReservation RequestUnwindReservation(uint8_t* entry_address) {
+  // Called with the lock held; entry_address is filled in once space for the
+  // code and unwind data has been found.
+  virtual UnwindReservation RequestUnwindReservation() {
     return UnwindReservation();
   }
   virtual void PlaceCode(uint32_t guest_address, void* machine_code,
                          const EmitFunctionInfo& func_info, void* code_address,
                          UnwindReservation unwind_reservation) {}
+  // Called with the lock held before the code is freed.
+  virtual void RemoveCode(void* code_address) {}
+
+  // Finds space for size bytes (a multiple of 16) with the lock held, and
+  // commits it. Returns the offset from generated_code_base_.
+  size_t AllocateCode(size_t size);
+  void FreeCode(size_t offset, size_t size);
+  void InsertFreeRange(size_t offset, size_t size);
+  void EraseFreeRange(std::map<size_t, size_t>::iterator it);
+  void ResetIndirection(uint32_t guest_address, void* code_address);
+  // Frees the entry and stub of retired code freed with direct callers left,
+  // once it has none.
+  void FreeReleasedEntry(size_t code_offset);
+  // Applies the change to both copies of the code map, with the lock held.
+  void UpdateCodeMap(std::function<void(CodeMap& map)> update);
 
   std::wstring file_name_;
   xe::memory::FileMappingHandle mapping_ = nullptr;
@@ -120,10 +164,33 @@ class X64CodeCache : public CodeCache {
   size_t generated_code_offset_ = 0;
   // Current high water mark of COMMITTED code.
   std::atomic<size_t> generated_code_commit_mark_ = {0};
+  // Bytes handed out by AllocateCode and not freed.
+  size_t generated_code_used_ = 0;
+  // Freed space below generated_code_offset_, never adjacent to each other or
+  // to the top, by offset and by (size, offset) for best-fit allocation.
+  std::map<size_t, size_t> free_ranges_;
+  std::set<std::pair<size_t, size_t>> free_ranges_by_size_;
+  // Offsets of retired code to those of the stubs now at their entry.
+  std::unordered_map<size_t, size_t> retirement_stubs_;
+  // Offsets of guest code to those of the code it calls directly, and the
+  // reverse.
+  std::unordered_map<size_t, std::vector<size_t>> direct_callees_;
+  std::unordered_map<size_t, std::vector<size_t>> direct_callers_;
+  // Offsets of freed retired code whose first 16 bytes, jumping to its stub,
+  // are kept for the direct callers left.
+  std::unordered_set<size_t> released_entries_;
   // Sorted map by host PC base offsets to source function info.
   // This can be used to bsearch on host PC to find the guest function.
   // The key is [start address | end address].
-  std::vector<std::pair<uint64_t, GuestFunction*>> generated_code_map_;
+  // LookupFunction is used while handling exceptions and walking the stacks
+  // of suspended threads, which may be holding the global critical region, so
+  // it takes no lock. Instead there are two copies, each with room for
+  // kMaximumFunctionCount entries. Changes are made to the one not in use,
+  // which then replaces the other, and are then made to the other too.
+  // Lookups retry if generated_code_map_version_ changed while they read.
+  CodeMap generated_code_maps_[2];
+  // The copy in use is generated_code_maps_[version & 1].
+  std::atomic<uint32_t> generated_code_map_version_ = {0};
 };
 
 }  // namespace x64
@@ -9,8 +9,11 @@
 
 #include "xenia/cpu/backend/x64/x64_code_cache.h"
 
+#include <algorithm>
+#include <atomic>
 #include <cstdlib>
 #include <cstring>
+#include <utility>
 
 #include "xenia/base/assert.h"
 #include "xenia/base/clock.h"
@@ -105,21 +108,37 @@ class Win32X64CodeCache : public X64CodeCache {
   void* LookupUnwindInfo(uint64_t host_pc) override;
 
  private:
-  UnwindReservation RequestUnwindReservation(uint8_t* entry_address) override;
+  UnwindReservation RequestUnwindReservation() override;
   void PlaceCode(uint32_t guest_address, void* machine_code,
                  const EmitFunctionInfo& func_info, void* code_address,
                  UnwindReservation unwind_reservation) override;
+  void RemoveCode(void* code_address) override;
 
-  void InitializeUnwindEntry(uint8_t* unwind_entry_address,
-                             size_t unwind_table_slot, void* code_address,
+  void InitializeUnwindEntry(uint8_t* unwind_entry_address, void* code_address,
                              const EmitFunctionInfo& func_info);
+  void InsertUnwindEntry(const RUNTIME_FUNCTION& fn_entry);
+  // Overwrites a free entry where fn_entry goes, so that lookups made
+  // meanwhile never see it cover code it isn't for.
+  void WriteUnwindEntry(RUNTIME_FUNCTION& entry,
+                        const RUNTIME_FUNCTION& fn_entry);
+
+  struct UnwindTable {
+    std::unique_ptr<RUNTIME_FUNCTION[]> entries;
+    std::atomic<size_t> count = {0};
+  };
 
   // Growable function table system handle.
   void* unwind_table_handle_ = nullptr;
-  // Actual unwind table entries.
-  std::vector<RUNTIME_FUNCTION> unwind_table_;
-  // Current number of entries in the table.
-  std::atomic<uint32_t> unwind_table_count_ = {0};
+  // Actual unwind table entries, with room for kMaximumFunctionCount so that
+  // adding to the end never moves them. The system and LookupUnwindInfo read
+  // them without a lock, so entries of removed code are left in place as free
+  // ones, with an EndAddress of 0 covering nothing, to be reused. Entries that
+  // can't be added in place are inserted into a copy in the other table,
+  // which is then registered in place of the current one.
+  UnwindTable unwind_tables_[2];
+  // The table in use is unwind_tables_[version & 1].
+  std::atomic<uint32_t> unwind_table_version_ = {0};
+  size_t unwind_table_free_count_ = 0;
   // Does this version of Windows support growable funciton tables?
   bool supports_growable_table_ = false;
 
@@ -154,7 +173,9 @@ bool Win32X64CodeCache::Initialize() {
 
   // Compute total number of unwind entries we should allocate.
   // We don't support reallocing right now, so this should be high.
-  unwind_table_.resize(kMaximumFunctionCount);
+  for (auto& unwind_table : unwind_tables_) {
+    unwind_table.entries.reset(new RUNTIME_FUNCTION[kMaximumFunctionCount]);
+  }
 
   // Check if this version of Windows supports growable function tables.
   auto ntdll_handle = GetModuleHandleW(L"ntdll.dll");
@@ -176,8 +197,9 @@ bool Win32X64CodeCache::Initialize() {
   // Create table and register with the system. It's empty now, but we'll grow
   // it as functions are added.
   if (supports_growable_table_) {
-    if (add_growable_table_(&unwind_table_handle_, unwind_table_.data(),
-                            unwind_table_count_, DWORD(unwind_table_.size()),
+    if (add_growable_table_(&unwind_table_handle_,
+                            unwind_tables_[0].entries.get(), 0,
+                            DWORD(kMaximumFunctionCount),
                             reinterpret_cast<ULONG_PTR>(generated_code_base_),
                             reinterpret_cast<ULONG_PTR>(generated_code_base_ +
                                                         kGeneratedCodeSize))) {
@@ -205,12 +227,12 @@ bool Win32X64CodeCache::Initialize() {
 }
 
 Win32X64CodeCache::UnwindReservation
-Win32X64CodeCache::RequestUnwindReservation(uint8_t* entry_address) {
-  assert_false(unwind_table_count_ >= kMaximumFunctionCount);
+Win32X64CodeCache::RequestUnwindReservation() {
+  assert_false(unwind_tables_[unwind_table_version_ & 1].count -
+                   unwind_table_free_count_ >=
+               kMaximumFunctionCount);
   UnwindReservation unwind_reservation;
   unwind_reservation.data_size = xe::round_up(kUnwindInfoSize, 16);
-  unwind_reservation.table_slot = unwind_table_count_++;
-  unwind_reservation.entry_address = entry_address;
   return unwind_reservation;
 }
 
@@ -219,22 +241,39 @@ void Win32X64CodeCache::PlaceCode(uint32_t guest_address, void* machine_code,
                                   void* code_address,
                                   UnwindReservation unwind_reservation) {
   // Add unwind info.
-  InitializeUnwindEntry(unwind_reservation.entry_address,
-                        unwind_reservation.table_slot, code_address, func_info);
-
-  if (supports_growable_table_) {
-    // Notify that the unwind table has grown.
-    // We do this outside of the lock, but with the latest total count.
-    grow_table_(unwind_table_handle_, unwind_table_count_);
-  }
+  InitializeUnwindEntry(unwind_reservation.entry_address, code_address,
+                        func_info);
 
   // This isn't needed on x64 (probably), but is convention.
   FlushInstructionCache(GetCurrentProcess(), code_address,
                         func_info.code_size.total);
 }
 
+void Win32X64CodeCache::RemoveCode(void* code_address) {
+  auto begin_address =
+      (DWORD)(reinterpret_cast<uint8_t*>(code_address) - generated_code_base_);
+  auto& unwind_table = unwind_tables_[unwind_table_version_ & 1];
+  auto entries_end = unwind_table.entries.get() + unwind_table.count;
+  auto it = std::lower_bound(unwind_table.entries.get(), entries_end,
+                             begin_address,
+                             [](const RUNTIME_FUNCTION& entry, DWORD address) {
+                               return entry.BeginAddress < address;
+                             });
+  // Free entries may begin at the same address.
+  while (it != entries_end && it->BeginAddress == begin_address &&
+         !it->EndAddress) {
+    ++it;
+  }
+  if (it == entries_end || it->BeginAddress != begin_address) {
+    return;
+  }
+  // Still sorted, as nothing moves.
+  static_cast<volatile RUNTIME_FUNCTION&>(*it).EndAddress = 0;
+  ++unwind_table_free_count_;
+}
+
 void Win32X64CodeCache::InitializeUnwindEntry(
-    uint8_t* unwind_entry_address, size_t unwind_table_slot, void* code_address,
+    uint8_t* unwind_entry_address, void* code_address,
     const EmitFunctionInfo& func_info) {
   auto unwind_info = reinterpret_cast<UNWIND_INFO*>(unwind_entry_address);
   UNWIND_CODE* unwind_code = nullptr;
@@ -297,30 +336,159 @@ void Win32X64CodeCache::InitializeUnwindEntry(
   }
 
   // Add entry.
-  auto& fn_entry = unwind_table_[unwind_table_slot];
+  RUNTIME_FUNCTION fn_entry;
   fn_entry.BeginAddress =
       (DWORD)(reinterpret_cast<uint8_t*>(code_address) - generated_code_base_);
   fn_entry.EndAddress =
       (DWORD)(fn_entry.BeginAddress + func_info.code_size.total);
   fn_entry.UnwindData = (DWORD)(unwind_entry_address - generated_code_base_);
+  InsertUnwindEntry(fn_entry);
+}
+
+void Win32X64CodeCache::InsertUnwindEntry(const RUNTIME_FUNCTION& fn_entry) {
+  uint32_t version = unwind_table_version_.load(std::memory_order_relaxed);
+  auto& unwind_table = unwind_tables_[version & 1];
+  auto entries = unwind_table.entries.get();
+  size_t count = unwind_table.count.load(std::memory_order_relaxed);
+  size_t index = std::lower_bound(entries, entries + count,
+                                  fn_entry.BeginAddress,
+                                  [](const RUNTIME_FUNCTION& entry,
+                                     DWORD address) {
+                                    return entry.BeginAddress < address;
+                                  }) -
+                 entries;
+
+  // Free entries beginning within the new code would send lookups in it the
+  // wrong way, so they're moved to its end, last first to stay sorted.
+  size_t end_index = index;
+  while (end_index < count &&
+         entries[end_index].BeginAddress < fn_entry.EndAddress) {
+    assert_zero(entries[end_index].EndAddress);
+    ++end_index;
+  }
+  while (end_index > index) {
+    static_cast<volatile RUNTIME_FUNCTION&>(entries[--end_index])
+        .BeginAddress = fn_entry.EndAddress;
+  }
+
+  // Reclaimed space is usually reused from its start, where the entry of the
+  // code removed from it is free to reuse in place.
+  if (index < count && !entries[index].EndAddress) {
+    WriteUnwindEntry(entries[index], fn_entry);
+    --unwind_table_free_count_;
+    return;
+  }
+  if (index && !entries[index - 1].EndAddress) {
+    WriteUnwindEntry(entries[index - 1], fn_entry);
+    --unwind_table_free_count_;
+    return;
+  }
+
+  // Code is otherwise usually placed above all existing code, so the entry
+  // can be added to the end.
+  if (index == count && count < kMaximumFunctionCount) {
+    entries[count] = fn_entry;
+    unwind_table.count.store(count + 1, std::memory_order_release);
+    if (supports_growable_table_) {
+      // Notify that the unwind table has grown.
+      grow_table_(unwind_table_handle_, DWORD(count + 1));
+    }
+    return;
+  }
+
+  // Otherwise the entries are copied to the other table, sorted with the new
+  // one. Free ones are kept for reuse unless there's no room.
+  bool compact = count >= kMaximumFunctionCount;
+  if (compact && count - unwind_table_free_count_ >= kMaximumFunctionCount) {
+    XELOGE("Unable to add unwind info: too many functions");
+    assert_always();
+    return;
+  }
+  // Lookups made since it was last replaced have seen it's not in use.
+  std::atomic_thread_fence(std::memory_order_release);
+  auto& new_unwind_table = unwind_tables_[(version + 1) & 1];
+  auto new_entries = new_unwind_table.entries.get();
+  size_t new_count = 0;
+  for (size_t i = 0; i < count; ++i) {
+    if (i == index) {
+      new_entries[new_count++] = fn_entry;
+    }
+    if (!compact || entries[i].EndAddress) {
+      new_entries[new_count++] = entries[i];
+    }
+  }
+  if (index == count) {
+    new_entries[new_count++] = fn_entry;
+  }
+  new_unwind_table.count.store(new_count, std::memory_order_relaxed);
+
+  if (supports_growable_table_) {
+    // Registered before the current one is removed, so unwinding never finds
+    // no table for the range. Once removed, the system no longer reads it.
+    void* unwind_table_handle = nullptr;
+    if (add_growable_table_(&unwind_table_handle,
+                            new_unwind_table.entries.get(), DWORD(new_count),
+                            DWORD(kMaximumFunctionCount),
+                            reinterpret_cast<ULONG_PTR>(generated_code_base_),
+                            reinterpret_cast<ULONG_PTR>(generated_code_base_ +
+                                                        kGeneratedCodeSize))) {
+      XELOGE("Unable to create unwind function table");
+      return;
+    }
+    delete_growable_table_(unwind_table_handle_);
+    unwind_table_handle_ = unwind_table_handle;
+  }
+  unwind_table_version_.store(version + 1, std::memory_order_release);
+  if (compact) {
+    unwind_table_free_count_ = 0;
+  }
+}
+
+void Win32X64CodeCache::WriteUnwindEntry(RUNTIME_FUNCTION& entry,
+                                         const RUNTIME_FUNCTION& fn_entry) {
+  // Lookups may land on the entry at any point. Until it covers anything, it
+  // sends them the same way as before, as nothing else begins between the two
+  // begin addresses.
+  auto& volatile_entry = static_cast<volatile RUNTIME_FUNCTION&>(entry);
+  if (fn_entry.BeginAddress >= volatile_entry.BeginAddress) {
+    volatile_entry.BeginAddress = fn_entry.BeginAddress;
+    volatile_entry.UnwindData = fn_entry.UnwindData;
+    volatile_entry.EndAddress = fn_entry.EndAddress;
+  } else {
+    // Only covers the new code from the old begin address, if at all.
+    volatile_entry.UnwindData = fn_entry.UnwindData;
+    volatile_entry.EndAddress = fn_entry.EndAddress;
+    volatile_entry.BeginAddress = fn_entry.BeginAddress;
+  }
 }
 
 void* Win32X64CodeCache::LookupUnwindInfo(uint64_t host_pc) {
-  return std::bsearch(
-      &host_pc, unwind_table_.data(), unwind_table_count_,
-      sizeof(RUNTIME_FUNCTION),
-      [](const void* key_ptr, const void* element_ptr) {
-        auto key =
-            *reinterpret_cast<const uintptr_t*>(key_ptr) - kGeneratedCodeBase;
-        auto element = reinterpret_cast<const RUNTIME_FUNCTION*>(element_ptr);
-        if (key < element->BeginAddress) {
-          return -1;
-        } else if (key > element->EndAddress) {
-          return 1;
-        } else {
-          return 0;
-        }
-      });
+  // The same search as the system's, where free entries are passed over.
+  auto key = DWORD(host_pc - kGeneratedCodeBase);
+  while (true) {
+    uint32_t version = unwind_table_version_.load(std::memory_order_acquire);
+    auto& unwind_table = unwind_tables_[version & 1];
+    RUNTIME_FUNCTION* found = nullptr;
+    size_t low = 0;
+    size_t high = unwind_table.count.load(std::memory_order_acquire);
+    while (low < high) {
+      size_t middle = (low + high) / 2;
+      auto entry = &unwind_table.entries[middle];
+      if (key < entry->BeginAddress) {
+        high = middle;
+      } else if (key >= entry->EndAddress) {
+        low = middle + 1;
+      } else {
+        found = entry;
+        break;
+      }
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (unwind_table_version_.load(std::memory_order_relaxed) == version) {
+      return found;
+    }
+    // Replaced while it was read.
+  }
 }
 
 }  // namespace x64
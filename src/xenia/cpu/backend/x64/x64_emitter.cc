@@ -15,6 +15,7 @@
 
 #include "xenia/base/assert.h"
 #include "xenia/base/atomic.h"
+#include "xenia/base/clock.h"
 #include "xenia/base/debugging.h"
 #include "xenia/base/logging.h"
 #include "xenia/base/math.h"
@@ -142,6 +143,7 @@ void* X64Emitter::Emplace(const EmitFunctionInfo& func_info,
 bool X64Emitter::Emit(HIRBuilder* builder, EmitFunctionInfo& func_info) {
   Xbyak::Label epilog_label;
   epilog_label_ = &epilog_label;
+  direct_callees_ = &func_info.direct_callees;
 
   // Calculate stack size. We need to align things to their natural sizes.
   // This could be much better (sort by type/etc).
@@ -183,7 +185,14 @@ bool X64Emitter::Emit(HIRBuilder* builder, EmitFunctionInfo& func_info) {
   func_info.stack_size = stack_size;
   stack_size_ = stack_size;
 
-  sub(rsp, (uint32_t)stack_size);
+  // Always the 7 byte imm32 form, even when the size would fit in a byte, so
+  // X64CodeCache::RetireGuestCode can overwrite the first 5 bytes while other
+  // threads may be entering the function.
+  db(0x48);
+  db(0x81);
+  db(0xEC);
+  dd(static_cast<uint32_t>(stack_size));
+  assert_true(getSize() - code_offsets.prolog == 7);
 
   code_offsets.prolog_stack_alloc = getSize();
   code_offsets.body = getSize();
@@ -254,6 +263,7 @@ bool X64Emitter::Emit(HIRBuilder* builder, EmitFunctionInfo& func_info) {
   // Function epilog.
   L(epilog_label);
   epilog_label_ = nullptr;
+  direct_callees_ = nullptr;
   EmitTraceUserCallReturn();
   mov(GetContextReg(), qword[rsp + StackLayout::GUEST_CTX_HOME]);
 
@@ -398,6 +408,9 @@ void X64Emitter::Call(const hir::Instr* instr, GuestFunction* function) {
     // a ResolveFunction call, but makes the table less useful.
     assert_zero(uint64_t(fn->machine_code()) & 0xFFFFFFFF00000000);
     mov(eax, uint32_t(uint64_t(fn->machine_code())));
+    // So the entry of the code is kept for as long as this is, should the
+    // function be retired.
+    direct_callees_->push_back(fn->machine_code());
   } else if (code_cache_->has_indirection_table()) {
     // Load the pointer to the indirection table maintained in X64CodeCache.
     // The target dword will either contain the address of the generated code
@@ -483,7 +496,18 @@ uint64_t UndefinedCallExtern(void* raw_context, uint64_t function_ptr) {
   }
   return 0;
 }
+uint64_t X64Emitter::FlushVirtualClock(void* raw_context) {
+  auto context = reinterpret_cast<ppc::PPCContext*>(raw_context);
+  Clock::AdvanceGuestInstructions(context->virtual_clock_instructions);
+  context->virtual_clock_instructions = 0;
+  return 0;
+}
+
 void X64Emitter::CallExtern(const hir::Instr* instr, const Function* function) {
+  if (cvars::clock_virtual) {
+    // Kernel calls may wait or look at the time.
+    CallNative(FlushVirtualClock);
+  }
   bool undefined = true;
   if (function->behavior() == Function::Behavior::kBuiltin) {
     auto builtin_function = static_cast<const BuiltinFunction*>(function);
@@ -737,7 +761,17 @@ static const vec128_t xmm_consts[] = {
     /* XMMIntMaxPD            */ vec128d(INT_MAX),
     /* XMMPosIntMinPS         */ vec128f((float)0x80000000u),
     /* XMMQNaN                */ vec128i(0x7FC00000u),
-    /* XMMOneDouble           */ vec128d(1.0)
+    /* XMMOneDouble           */ vec128d(1.0),
+    /* XMMPackFLOAT16_Rebias  */ vec128i(0x0001C000u),
+    /* XMMPackFLOAT16_DenormScale */ vec128f(16777216.0f),
+    /* XMMPackFLOAT16_MinNormal */ vec128i(0x38800000u),
+    /* XMMPackFLOAT16_Overflow */ vec128i(0x477FFFFFu),
+    /* XMMPackFLOAT16_Max     */ vec128i(0x00007BFFu),
+    /* XMMPackFLOAT16_InfNaN  */ vec128i(0x7F7FFFFFu),
+    /* XMMUnpackFLOAT16_ExpMask */ vec128i(0x0F800000u),
+    /* XMMUnpackFLOAT16_Rebias */ vec128i(0x38000000u),
+    /* XMMFloatMinNormal      */ vec128i(0x00800000u),
+    /* XMMPosInf              */ vec128i(0x7F800000u)
 };
 
 // First location to try and place constants.
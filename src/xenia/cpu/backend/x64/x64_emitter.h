@@ -114,7 +114,17 @@ enum XmmConst {
   XMMIntMaxPD,
   XMMPosIntMinPS,
   XMMQNaN,
-  XMMOneDouble
+  XMMOneDouble,
+  XMMPackFLOAT16_Rebias,
+  XMMPackFLOAT16_DenormScale,
+  XMMPackFLOAT16_MinNormal,
+  XMMPackFLOAT16_Overflow,
+  XMMPackFLOAT16_Max,
+  XMMPackFLOAT16_InfNaN,
+  XMMUnpackFLOAT16_ExpMask,
+  XMMUnpackFLOAT16_Rebias,
+  XMMFloatMinNormal,
+  XMMPosInf
 };
 
 // Unfortunately due to the design of xbyak we have to pass this to the ctor.
@@ -197,6 +207,10 @@ class X64Emitter : public Xbyak::CodeGenerator {
   void CallNativeSafe(void* fn);
   void SetReturnAddress(uint64_t value);
 
+  // Adds the instructions the thread has executed to the virtual guest clock,
+  // for --clock_virtual.
+  static uint64_t FlushVirtualClock(void* raw_context);
+
   Xbyak::Reg64 GetNativeParam(uint32_t param);
 
   Xbyak::Reg64 GetContextReg();
@@ -243,6 +257,9 @@ class X64Emitter : public Xbyak::CodeGenerator {
   uint32_t feature_flags_ = 0;
 
   Xbyak::Label* epilog_label_ = nullptr;
+  // Code of the functions called directly, in the EmitFunctionInfo of the
+  // function being emitted.
+  std::vector<uint8_t*>* direct_callees_ = nullptr;
 
   hir::Instr* current_instr_ = nullptr;
 
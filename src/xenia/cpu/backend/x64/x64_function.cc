@@ -30,7 +30,17 @@ void X64Function::Setup(uint8_t* machine_code, size_t machine_code_length) {
   machine_code_length_ = machine_code_length;
 }
 
+void X64Function::SetupInterpreterEntry(uint8_t* stub, size_t stub_length) {
+  interpreter_entry_ = stub;
+  Setup(stub, stub_length);
+}
+
 bool X64Function::CallImpl(ThreadState* thread_state, uint32_t return_address) {
+  if (retired_) {
+    auto function = thread_state->processor()->ResolveFunction(address());
+    return function && function != this &&
+           function->Call(thread_state, return_address);
+  }
   auto backend =
       reinterpret_cast<X64Backend*>(thread_state->processor()->backend());
   auto thunk = backend->host_to_guest_thunk();
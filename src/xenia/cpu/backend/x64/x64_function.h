@@ -10,6 +10,8 @@
 #ifndef XENIA_CPU_BACKEND_X64_X64_FUNCTION_H_
 #define XENIA_CPU_BACKEND_X64_X64_FUNCTION_H_
 
+#include <atomic>
+
 #include "xenia/cpu/function.h"
 #include "xenia/cpu/thread_state.h"
 
@@ -28,12 +30,24 @@ class X64Function : public GuestFunction {
 
   void Setup(uint8_t* machine_code, size_t machine_code_length);
 
+  // The stub calls went through to the interpreter before the function was
+  // compiled, if it was interpreted.
+  uint8_t* interpreter_entry() const { return interpreter_entry_; }
+  void SetupInterpreterEntry(uint8_t* stub, size_t stub_length);
+
+  // Set once the code is retired, after which calls go to whatever has been
+  // compiled for the address since, as the code may be freed at any time.
+  bool retired() const { return retired_; }
+  void set_retired() { retired_ = true; }
+
  protected:
   bool CallImpl(ThreadState* thread_state, uint32_t return_address) override;
 
  private:
   uint8_t* machine_code_ = nullptr;
   size_t machine_code_length_ = 0;
+  uint8_t* interpreter_entry_ = nullptr;
+  std::atomic<bool> retired_ = {false};
 };
 
 }  // namespace x64
@@ -10,9 +10,12 @@
 #include "xenia/cpu/backend/x64/x64_sequences.h"
 
 #include <algorithm>
+#include <cstddef>
 #include <cstring>
 
+#include "xenia/base/threading.h"
 #include "xenia/cpu/backend/x64/x64_op.h"
+#include "xenia/cpu/ppc/ppc_context.h"
 
 namespace xe {
 namespace cpu {
@@ -231,6 +234,26 @@ EMITTER_OPCODE_TABLE(OPCODE_TRAP_TRUE, TRAP_TRUE_I8, TRAP_TRUE_I16,
                      TRAP_TRUE_I32, TRAP_TRUE_I64, TRAP_TRUE_F32,
                      TRAP_TRUE_F64);
 
+// ============================================================================
+// OPCODE_SAFEPOINT
+// ============================================================================
+struct SAFEPOINT : Sequence<SAFEPOINT, I<OPCODE_SAFEPOINT, VoidOp>> {
+  static void Emit(X64Emitter& e, const EmitArgType& i) {
+    e.cmp(e.dword[e.GetContextReg() +
+                  offsetof(ppc::PPCContext, safepoint_pending)],
+          0);
+    Xbyak::Label skip;
+    e.jz(skip);
+    e.CallNative(ProcessSafepoint);
+    e.L(skip);
+  }
+  static uint64_t ProcessSafepoint(void* raw_context) {
+    threading::ProcessSafepoint();
+    return 0;
+  }
+};
+EMITTER_OPCODE_TABLE(OPCODE_SAFEPOINT, SAFEPOINT);
+
 // ============================================================================
 // OPCODE_CALL
 // ============================================================================
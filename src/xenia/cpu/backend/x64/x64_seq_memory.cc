@@ -1122,9 +1122,48 @@ EMITTER_OPCODE_TABLE(OPCODE_CACHE_CONTROL, CACHE_CONTROL);
 // ============================================================================
 // OPCODE_MEMORY_BARRIER
 // ============================================================================
+// x64 only reorders stores with later loads, so that's the only ordering that
+// needs a fence - the others just have to keep the HIR accesses in order, which
+// the barrier being volatile does.
+// Locked instructions are full barriers themselves, so the fence is also
+// dropped when one is next to it with nothing touching memory in between, as
+// is the case for the one after a conditional store.
+static bool IsNextToLockedInstr(const Instr* barrier) {
+  auto is_locked = [](const Instr* i) {
+    return i->opcode == &OPCODE_ATOMIC_EXCHANGE_info ||
+           i->opcode == &OPCODE_ATOMIC_COMPARE_EXCHANGE_info;
+  };
+  auto may_access_memory = [](const Instr* i) {
+    return (i->opcode->flags & (OPCODE_FLAG_MEMORY | OPCODE_FLAG_VOLATILE |
+                                OPCODE_FLAG_BRANCH)) != 0;
+  };
+  for (auto i = barrier->prev; i; i = i->prev) {
+    if (is_locked(i)) {
+      return true;
+    }
+    if (may_access_memory(i)) {
+      break;
+    }
+  }
+  for (auto i = barrier->next; i; i = i->next) {
+    if (is_locked(i)) {
+      return true;
+    }
+    if (may_access_memory(i)) {
+      break;
+    }
+  }
+  return false;
+}
 struct MEMORY_BARRIER
     : Sequence<MEMORY_BARRIER, I<OPCODE_MEMORY_BARRIER, VoidOp>> {
-  static void Emit(X64Emitter& e, const EmitArgType& i) { e.mfence(); }
+  static void Emit(X64Emitter& e, const EmitArgType& i) {
+    if (!(i.instr->flags & MEMORY_BARRIER_STORE_LOAD) ||
+        IsNextToLockedInstr(i.instr)) {
+      return;
+    }
+    e.mfence();
+  }
 };
 EMITTER_OPCODE_TABLE(OPCODE_MEMORY_BARRIER, MEMORY_BARRIER);
 
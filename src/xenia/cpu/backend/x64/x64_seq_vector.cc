@@ -14,9 +14,6 @@
 
 #include "xenia/cpu/backend/x64/x64_op.h"
 
-// For OPCODE_PACK/OPCODE_UNPACK
-#include "third_party/half/include/half.hpp"
-
 namespace xe {
 namespace cpu {
 namespace backend {
@@ -668,25 +665,139 @@ struct VECTOR_SUB
 EMITTER_OPCODE_TABLE(OPCODE_VECTOR_SUB, VECTOR_SUB);
 
 // ============================================================================
-// OPCODE_VECTOR_SHL
+// Variable vector shifts
 // ============================================================================
-template <typename T, std::enable_if_t<std::is_integral<T>::value, int> = 0>
-static __m128i EmulateVectorShl(void*, __m128i src1, __m128i src2) {
-  alignas(16) T value[16 / sizeof(T)];
-  alignas(16) T shamt[16 / sizeof(T)];
+// x86 only has per-lane shift counts for dwords, and only with AVX2, so the
+// other forms are built from fixed shifts: for each bit of the count, lanes
+// with that bit set take the value shifted by the bit's weight.
+//
+// The helpers below take the value in xmm0 and the counts in xmm1 and clobber
+// xmm0-xmm3.
+template <typename ARGS>
+static void LoadVectorShiftOperands(X64Emitter& e, const ARGS& i) {
+  if (i.src1.is_constant) {
+    e.LoadConstantXmm(e.xmm0, i.src1.constant());
+  } else {
+    e.vmovdqa(e.xmm0, i.src1);
+  }
+  if (i.src2.is_constant) {
+    e.LoadConstantXmm(e.xmm1, i.src2.constant());
+  } else {
+    e.vmovdqa(e.xmm1, i.src2);
+  }
+}
 
-  // Load SSE registers into a C array.
-  _mm_store_si128(reinterpret_cast<__m128i*>(value), src1);
-  _mm_store_si128(reinterpret_cast<__m128i*>(shamt), src2);
+// Logical byte shifts. Leaves the result in xmm0; arithmetic shifts are
+// built on top of this by the caller.
+static void EmitVectorShiftInt8(X64Emitter& e, bool left) {
+  for (int b = 0; b < 3; ++b) {
+    uint8_t k = uint8_t(1) << b;
+    if (left) {
+      // Doubling can't carry into the neighboring byte, unlike vpsllw.
+      e.vpaddb(e.xmm2, e.xmm0, e.xmm0);
+      for (int n = 1; n < k; ++n) {
+        e.vpaddb(e.xmm2, e.xmm2, e.xmm2);
+      }
+    } else {
+      // Shift as words and drop the bits pulled in from the high byte.
+      e.vpsrlw(e.xmm2, e.xmm0, k);
+      e.vpcmpeqb(e.xmm3, e.xmm3, e.xmm3);
+      e.vpsrlw(e.xmm3, e.xmm3, 8 + k);
+      e.vpackuswb(e.xmm3, e.xmm3, e.xmm3);
+      e.vpand(e.xmm2, e.xmm2, e.xmm3);
+    }
+    // vpblendvb only looks at the top bit of each byte.
+    e.vpsllw(e.xmm3, e.xmm1, 7 - b);
+    e.vpblendvb(e.xmm0, e.xmm0, e.xmm2, e.xmm3);
+  }
+}
 
-  for (size_t i = 0; i < (16 / sizeof(T)); ++i) {
-    value[i] = value[i] << (shamt[i] & ((sizeof(T) * 8) - 1));
+static void EmitVectorShiftInt16(X64Emitter& e, const Xmm& dest,
+                                 Opcode opcode) {
+  if (e.IsFeatureEnabled(kX64EmitAVX2)) {
+    // Shift the odd and even words separately as dwords, each with the
+    // other word out of the way, then merge.
+    e.vpsrld(e.xmm2, e.xmm1, 16);
+    e.vpand(e.xmm2, e.xmm2, e.GetXmmConstPtr(XMMShiftMaskEvenPI16));
+    e.vpand(e.xmm1, e.xmm1, e.GetXmmConstPtr(XMMShiftMaskEvenPI16));
+    switch (opcode) {
+      case OPCODE_VECTOR_SHL:
+        e.vpxor(e.xmm3, e.xmm3, e.xmm3);
+        e.vpblendw(e.xmm3, e.xmm3, e.xmm0, 0b10101010);
+        e.vpsllvd(e.xmm2, e.xmm3, e.xmm2);
+        e.vpsllvd(e.xmm0, e.xmm0, e.xmm1);
+        break;
+      case OPCODE_VECTOR_SHR:
+        e.vpxor(e.xmm3, e.xmm3, e.xmm3);
+        e.vpblendw(e.xmm3, e.xmm0, e.xmm3, 0b10101010);
+        e.vpsrlvd(e.xmm2, e.xmm0, e.xmm2);
+        e.vpsrlvd(e.xmm0, e.xmm3, e.xmm1);
+        break;
+      case OPCODE_VECTOR_SHA:
+        e.vpsravd(e.xmm2, e.xmm0, e.xmm2);
+        e.vpslld(e.xmm0, e.xmm0, 16);
+        e.vpsravd(e.xmm0, e.xmm0, e.xmm1);
+        e.vpsrld(e.xmm0, e.xmm0, 16);
+        break;
+      default:
+        assert_unhandled_case(opcode);
+        break;
+    }
+    e.vpblendw(dest, e.xmm0, e.xmm2, 0b10101010);
+    return;
   }
 
-  // Store result and return it.
-  return _mm_load_si128(reinterpret_cast<__m128i*>(value));
+  for (int b = 0; b < 4; ++b) {
+    uint8_t k = uint8_t(1) << b;
+    switch (opcode) {
+      case OPCODE_VECTOR_SHL:
+        e.vpsllw(e.xmm2, e.xmm0, k);
+        break;
+      case OPCODE_VECTOR_SHR:
+        e.vpsrlw(e.xmm2, e.xmm0, k);
+        break;
+      case OPCODE_VECTOR_SHA:
+        e.vpsraw(e.xmm2, e.xmm0, k);
+        break;
+      default:
+        assert_unhandled_case(opcode);
+        break;
+    }
+    // Spread bit b of each count over its word for vpblendvb.
+    e.vpsllw(e.xmm3, e.xmm1, 15 - b);
+    e.vpsraw(e.xmm3, e.xmm3, 15);
+    e.vpblendvb(b == 3 ? dest : e.xmm0, e.xmm0, e.xmm2, e.xmm3);
+  }
 }
 
+// Only used without AVX2; otherwise vpsllvd and friends do this directly.
+static void EmitVectorShiftInt32(X64Emitter& e, const Xmm& dest,
+                                 Opcode opcode) {
+  for (int b = 0; b < 5; ++b) {
+    uint8_t k = uint8_t(1) << b;
+    switch (opcode) {
+      case OPCODE_VECTOR_SHL:
+        e.vpslld(e.xmm2, e.xmm0, k);
+        break;
+      case OPCODE_VECTOR_SHR:
+        e.vpsrld(e.xmm2, e.xmm0, k);
+        break;
+      case OPCODE_VECTOR_SHA:
+        e.vpsrad(e.xmm2, e.xmm0, k);
+        break;
+      default:
+        assert_unhandled_case(opcode);
+        break;
+    }
+    // vblendvps only looks at the sign bit of each dword.
+    e.vpslld(e.xmm3, e.xmm1, 31 - b);
+    e.vblendvps(b == 4 ? dest : e.xmm0, e.xmm0, e.xmm2, e.xmm3);
+  }
+}
+
+// ============================================================================
+// OPCODE_VECTOR_SHL
+// ============================================================================
 struct VECTOR_SHL_V128
     : Sequence<VECTOR_SHL_V128, I<OPCODE_VECTOR_SHL, V128Op, V128Op, V128Op>> {
   static void Emit(X64Emitter& e, const EmitArgType& i) {
@@ -707,15 +818,9 @@ struct VECTOR_SHL_V128
   }
 
   static void EmitInt8(X64Emitter& e, const EmitArgType& i) {
-    // TODO(benvanik): native version (with shift magic).
-    if (i.src2.is_constant) {
-      e.lea(e.GetNativeParam(1), e.StashConstantXmm(1, i.src2.constant()));
-    } else {
-      e.lea(e.GetNativeParam(1), e.StashXmm(1, i.src2));
-    }
-    e.lea(e.GetNativeParam(0), e.StashXmm(0, i.src1));
-    e.CallNativeSafe(reinterpret_cast<void*>(EmulateVectorShl<uint8_t>));
-    e.vmovaps(i.dest, e.xmm0);
+    LoadVectorShiftOperands(e, i);
+    EmitVectorShiftInt8(e, true);
+    e.vmovdqa(i.dest, e.xmm0);
   }
 
   static void EmitInt16(X64Emitter& e, const EmitArgType& i) {
@@ -744,7 +849,7 @@ struct VECTOR_SHL_V128
     }
 
     // Shift 8 words in src1 by amount specified in src2.
-    Xbyak::Label emu, end;
+    Xbyak::Label varying, end;
 
     // Only bother with this check if shift amt isn't constant.
     if (!i.src2.is_constant) {
@@ -753,7 +858,7 @@ struct VECTOR_SHL_V128
       e.vpshufd(e.xmm0, e.xmm0, 0b00000000);
       e.vpxor(e.xmm1, e.xmm0, i.src2);
       e.vptest(e.xmm1, e.xmm1);
-      e.jnz(emu);
+      e.jnz(varying);
 
       // Equal. Shift using vpsllw.
       e.mov(e.rax, 0xF);
@@ -763,16 +868,9 @@ struct VECTOR_SHL_V128
       e.jmp(end);
     }
 
-    // TODO(benvanik): native version (with shift magic).
-    e.L(emu);
-    if (i.src2.is_constant) {
-      e.lea(e.GetNativeParam(1), e.StashConstantXmm(1, i.src2.constant()));
-    } else {
-      e.lea(e.GetNativeParam(1), e.StashXmm(1, i.src2));
-    }
-    e.lea(e.GetNativeParam(0), e.StashXmm(0, src1));
-    e.CallNativeSafe(reinterpret_cast<void*>(EmulateVectorShl<uint16_t>));
-    e.vmovaps(i.dest, e.xmm0);
+    e.L(varying);
+    LoadVectorShiftOperands(e, i);
+    EmitVectorShiftInt16(e, i.dest, OPCODE_VECTOR_SHL);
 
     e.L(end);
   }
@@ -821,7 +919,7 @@ struct VECTOR_SHL_V128
       }
     } else {
       // Shift 4 words in src1 by amount specified in src2.
-      Xbyak::Label emu, end;
+      Xbyak::Label varying, end;
 
       // See if the shift is equal first for a shortcut.
       // Only bother with this check if shift amt isn't constant.
@@ -829,7 +927,7 @@ struct VECTOR_SHL_V128
         e.vpshufd(e.xmm0, i.src2, 0b00000000);
         e.vpxor(e.xmm1, e.xmm0, i.src2);
         e.vptest(e.xmm1, e.xmm1);
-        e.jnz(emu);
+        e.jnz(varying);
 
         // Equal. Shift using vpsrad.
         e.mov(e.rax, 0x1F);
@@ -839,16 +937,9 @@ struct VECTOR_SHL_V128
         e.jmp(end);
       }
 
-      // TODO(benvanik): native version (with shift magic).
-      e.L(emu);
-      if (i.src2.is_constant) {
-        e.lea(e.GetNativeParam(1), e.StashConstantXmm(1, i.src2.constant()));
-      } else {
-        e.lea(e.GetNativeParam(1), e.StashXmm(1, i.src2));
-      }
-      e.lea(e.GetNativeParam(0), e.StashXmm(0, src1));
-      e.CallNativeSafe(reinterpret_cast<void*>(EmulateVectorShl<uint32_t>));
-      e.vmovaps(i.dest, e.xmm0);
+      e.L(varying);
+      LoadVectorShiftOperands(e, i);
+      EmitVectorShiftInt32(e, i.dest, OPCODE_VECTOR_SHL);
 
       e.L(end);
     }
@@ -859,23 +950,6 @@ EMITTER_OPCODE_TABLE(OPCODE_VECTOR_SHL, VECTOR_SHL_V128);
 // ============================================================================
 // OPCODE_VECTOR_SHR
 // ============================================================================
-template <typename T, std::enable_if_t<std::is_integral<T>::value, int> = 0>
-static __m128i EmulateVectorShr(void*, __m128i src1, __m128i src2) {
-  alignas(16) T value[16 / sizeof(T)];
-  alignas(16) T shamt[16 / sizeof(T)];
-
-  // Load SSE registers into a C array.
-  _mm_store_si128(reinterpret_cast<__m128i*>(value), src1);
-  _mm_store_si128(reinterpret_cast<__m128i*>(shamt), src2);
-
-  for (size_t i = 0; i < (16 / sizeof(T)); ++i) {
-    value[i] = value[i] >> (shamt[i] & ((sizeof(T) * 8) - 1));
-  }
-
-  // Store result and return it.
-  return _mm_load_si128(reinterpret_cast<__m128i*>(value));
-}
-
 struct VECTOR_SHR_V128
     : Sequence<VECTOR_SHR_V128, I<OPCODE_VECTOR_SHR, V128Op, V128Op, V128Op>> {
   static void Emit(X64Emitter& e, const EmitArgType& i) {
@@ -896,18 +970,20 @@ struct VECTOR_SHR_V128
   }
 
   static void EmitInt8(X64Emitter& e, const EmitArgType& i) {
-    // TODO(benvanik): native version (with shift magic).
-    if (i.src2.is_constant) {
-      e.lea(e.GetNativeParam(1), e.StashConstantXmm(1, i.src2.constant()));
-    } else {
-      e.lea(e.GetNativeParam(1), e.StashXmm(1, i.src2));
-    }
-    e.lea(e.GetNativeParam(0), e.StashXmm(0, i.src1));
-    e.CallNativeSafe(reinterpret_cast<void*>(EmulateVectorShr<uint8_t>));
-    e.vmovaps(i.dest, e.xmm0);
+    LoadVectorShiftOperands(e, i);
+    EmitVectorShiftInt8(e, false);
+    e.vmovdqa(i.dest, e.xmm0);
   }
 
   static void EmitInt16(X64Emitter& e, const EmitArgType& i) {
+    Xmm src1;
+    if (i.src1.is_constant) {
+      src1 = e.xmm2;
+      e.LoadConstantXmm(src1, i.src1.constant());
+    } else {
+      src1 = i.src1;
+    }
+
     if (i.src2.is_constant) {
       const auto& shamt = i.src2.constant();
       bool all_same = true;
@@ -919,13 +995,13 @@ struct VECTOR_SHR_V128
       }
       if (all_same) {
         // Every count is the same, so we can use vpsllw.
-        e.vpsrlw(i.dest, i.src1, shamt.u16[0] & 0xF);
+        e.vpsrlw(i.dest, src1, shamt.u16[0] & 0xF);
         return;
       }
     }
 
     // Shift 8 words in src1 by amount specified in src2.
-    Xbyak::Label emu, end;
+    Xbyak::Label varying, end;
 
     // See if the shift is equal first for a shortcut.
     // Only bother with this check if shift amt isn't constant.
@@ -934,26 +1010,19 @@ struct VECTOR_SHR_V128
       e.vpshufd(e.xmm0, e.xmm0, 0b00000000);
       e.vpxor(e.xmm1, e.xmm0, i.src2);
       e.vptest(e.xmm1, e.xmm1);
-      e.jnz(emu);
+      e.jnz(varying);
 
       // Equal. Shift using vpsrlw.
       e.mov(e.rax, 0xF);
       e.vmovq(e.xmm1, e.rax);
       e.vpand(e.xmm0, e.xmm0, e.xmm1);
-      e.vpsrlw(i.dest, i.src1, e.xmm0);
+      e.vpsrlw(i.dest, src1, e.xmm0);
       e.jmp(end);
     }
 
-    // TODO(benvanik): native version (with shift magic).
-    e.L(emu);
-    if (i.src2.is_constant) {
-      e.lea(e.GetNativeParam(1), e.StashConstantXmm(1, i.src2.constant()));
-    } else {
-      e.lea(e.GetNativeParam(1), e.StashXmm(1, i.src2));
-    }
-    e.lea(e.GetNativeParam(0), e.StashXmm(0, i.src1));
-    e.CallNativeSafe(reinterpret_cast<void*>(EmulateVectorShr<uint16_t>));
-    e.vmovaps(i.dest, e.xmm0);
+    e.L(varying);
+    LoadVectorShiftOperands(e, i);
+    EmitVectorShiftInt16(e, i.dest, OPCODE_VECTOR_SHR);
 
     e.L(end);
   }
@@ -1002,7 +1071,7 @@ struct VECTOR_SHR_V128
       e.vpsrlvd(i.dest, src1, e.xmm0);
     } else {
       // Shift 4 words in src1 by amount specified in src2.
-      Xbyak::Label emu, end;
+      Xbyak::Label varying, end;
 
       // See if the shift is equal first for a shortcut.
       // Only bother with this check if shift amt isn't constant.
@@ -1010,7 +1079,7 @@ struct VECTOR_SHR_V128
         e.vpshufd(e.xmm0, i.src2, 0b00000000);
         e.vpxor(e.xmm1, e.xmm0, i.src2);
         e.vptest(e.xmm1, e.xmm1);
-        e.jnz(emu);
+        e.jnz(varying);
 
         // Equal. Shift using vpsrld.
         e.mov(e.rax, 0x1F);
@@ -1020,16 +1089,9 @@ struct VECTOR_SHR_V128
         e.jmp(end);
       }
 
-      // TODO(benvanik): native version.
-      e.L(emu);
-      if (i.src2.is_constant) {
-        e.lea(e.GetNativeParam(1), e.StashConstantXmm(1, i.src2.constant()));
-      } else {
-        e.lea(e.GetNativeParam(1), e.StashXmm(1, i.src2));
-      }
-      e.lea(e.GetNativeParam(0), e.StashXmm(0, src1));
-      e.CallNativeSafe(reinterpret_cast<void*>(EmulateVectorShr<uint32_t>));
-      e.vmovaps(i.dest, e.xmm0);
+      e.L(varying);
+      LoadVectorShiftOperands(e, i);
+      EmitVectorShiftInt32(e, i.dest, OPCODE_VECTOR_SHR);
 
       e.L(end);
     }
@@ -1060,18 +1122,32 @@ struct VECTOR_SHA_V128
   }
 
   static void EmitInt8(X64Emitter& e, const EmitArgType& i) {
-    // TODO(benvanik): native version (with shift magic).
-    if (i.src2.is_constant) {
-      e.lea(e.GetNativeParam(1), e.StashConstantXmm(1, i.src2.constant()));
+    // For negative lanes x >> n == ~(~x >> n), so flip those, shift
+    // logically and flip them back.
+    LoadVectorShiftOperands(e, i);
+    e.vpxor(e.xmm2, e.xmm2, e.xmm2);
+    e.vpcmpgtb(e.xmm2, e.xmm2, e.xmm0);
+    e.vpxor(e.xmm0, e.xmm0, e.xmm2);
+    EmitVectorShiftInt8(e, false);
+    e.vpxor(e.xmm2, e.xmm2, e.xmm2);
+    if (i.src1.is_constant) {
+      e.LoadConstantXmm(e.xmm3, i.src1.constant());
+      e.vpcmpgtb(e.xmm2, e.xmm2, e.xmm3);
     } else {
-      e.lea(e.GetNativeParam(1), e.StashXmm(1, i.src2));
+      e.vpcmpgtb(e.xmm2, e.xmm2, i.src1);
     }
-    e.lea(e.GetNativeParam(0), e.StashXmm(0, i.src1));
-    e.CallNativeSafe(reinterpret_cast<void*>(EmulateVectorShr<int8_t>));
-    e.vmovaps(i.dest, e.xmm0);
+    e.vpxor(i.dest, e.xmm0, e.xmm2);
   }
 
   static void EmitInt16(X64Emitter& e, const EmitArgType& i) {
+    Xmm src1;
+    if (i.src1.is_constant) {
+      src1 = e.xmm2;
+      e.LoadConstantXmm(src1, i.src1.constant());
+    } else {
+      src1 = i.src1;
+    }
+
     if (i.src2.is_constant) {
       const auto& shamt = i.src2.constant();
       bool all_same = true;
@@ -1083,13 +1159,13 @@ struct VECTOR_SHA_V128
       }
       if (all_same) {
         // Every count is the same, so we can use vpsraw.
-        e.vpsraw(i.dest, i.src1, shamt.u16[0] & 0xF);
+        e.vpsraw(i.dest, src1, shamt.u16[0] & 0xF);
         return;
       }
     }
 
     // Shift 8 words in src1 by amount specified in src2.
-    Xbyak::Label emu, end;
+    Xbyak::Label varying, end;
 
     // See if the shift is equal first for a shortcut.
     // Only bother with this check if shift amt isn't constant.
@@ -1098,31 +1174,32 @@ struct VECTOR_SHA_V128
       e.vpshufd(e.xmm0, e.xmm0, 0b00000000);
       e.vpxor(e.xmm1, e.xmm0, i.src2);
       e.vptest(e.xmm1, e.xmm1);
-      e.jnz(emu);
+      e.jnz(varying);
 
       // Equal. Shift using vpsraw.
       e.mov(e.rax, 0xF);
       e.vmovq(e.xmm1, e.rax);
       e.vpand(e.xmm0, e.xmm0, e.xmm1);
-      e.vpsraw(i.dest, i.src1, e.xmm0);
+      e.vpsraw(i.dest, src1, e.xmm0);
       e.jmp(end);
     }
 
-    // TODO(benvanik): native version (with shift magic).
-    e.L(emu);
-    if (i.src2.is_constant) {
-      e.lea(e.GetNativeParam(1), e.StashConstantXmm(1, i.src2.constant()));
-    } else {
-      e.lea(e.GetNativeParam(1), e.StashXmm(1, i.src2));
-    }
-    e.lea(e.GetNativeParam(0), e.StashXmm(0, i.src1));
-    e.CallNativeSafe(reinterpret_cast<void*>(EmulateVectorShr<int16_t>));
-    e.vmovaps(i.dest, e.xmm0);
+    e.L(varying);
+    LoadVectorShiftOperands(e, i);
+    EmitVectorShiftInt16(e, i.dest, OPCODE_VECTOR_SHA);
 
     e.L(end);
   }
 
   static void EmitInt32(X64Emitter& e, const EmitArgType& i) {
+    Xmm src1;
+    if (i.src1.is_constant) {
+      src1 = e.xmm2;
+      e.LoadConstantXmm(src1, i.src1.constant());
+    } else {
+      src1 = i.src1;
+    }
+
     if (i.src2.is_constant) {
       const auto& shamt = i.src2.constant();
       bool all_same = true;
@@ -1134,7 +1211,7 @@ struct VECTOR_SHA_V128
       }
       if (all_same) {
         // Every count is the same, so we can use vpsrad.
-        e.vpsrad(i.dest, i.src1, shamt.u32[0] & 0x1F);
+        e.vpsrad(i.dest, src1, shamt.u32[0] & 0x1F);
         return;
       }
     }
@@ -1148,10 +1225,10 @@ struct VECTOR_SHA_V128
       } else {
         e.vandps(e.xmm0, i.src2, e.GetXmmConstPtr(XMMShiftMaskPS));
       }
-      e.vpsravd(i.dest, i.src1, e.xmm0);
+      e.vpsravd(i.dest, src1, e.xmm0);
     } else {
       // Shift 4 words in src1 by amount specified in src2.
-      Xbyak::Label emu, end;
+      Xbyak::Label varying, end;
 
       // See if the shift is equal first for a shortcut.
       // Only bother with this check if shift amt isn't constant.
@@ -1159,26 +1236,19 @@ struct VECTOR_SHA_V128
         e.vpshufd(e.xmm0, i.src2, 0b00000000);
         e.vpxor(e.xmm1, e.xmm0, i.src2);
         e.vptest(e.xmm1, e.xmm1);
-        e.jnz(emu);
+        e.jnz(varying);
 
         // Equal. Shift using vpsrad.
         e.mov(e.rax, 0x1F);
         e.vmovq(e.xmm1, e.rax);
         e.vpand(e.xmm0, e.xmm0, e.xmm1);
-        e.vpsrad(i.dest, i.src1, e.xmm0);
+        e.vpsrad(i.dest, src1, e.xmm0);
         e.jmp(end);
       }
 
-      // TODO(benvanik): native version.
-      e.L(emu);
-      if (i.src2.is_constant) {
-        e.lea(e.GetNativeParam(1), e.StashConstantXmm(1, i.src2.constant()));
-      } else {
-        e.lea(e.GetNativeParam(1), e.StashXmm(1, i.src2));
-      }
-      e.lea(e.GetNativeParam(0), e.StashXmm(0, i.src1));
-      e.CallNativeSafe(reinterpret_cast<void*>(EmulateVectorShr<int32_t>));
-      e.vmovaps(i.dest, e.xmm0);
+      e.L(varying);
+      LoadVectorShiftOperands(e, i);
+      EmitVectorShiftInt32(e, i.dest, OPCODE_VECTOR_SHA);
 
       e.L(end);
     }
@@ -1851,83 +1921,75 @@ struct PACK : Sequence<PACK, I<OPCODE_PACK, V128Op, V128Op, V128Op>> {
     //     ((src1.uy & 0xFF) << 8) | (src1.uz & 0xFF)
     e.vpshufb(i.dest, i.dest, e.GetXmmConstPtr(XMMPackD3DCOLOR));
   }
-  static __m128i EmulateFLOAT16_2(void*, __m128 src1) {
-    alignas(16) float a[4];
-    alignas(16) uint16_t b[8];
-    _mm_store_ps(a, src1);
-    std::memset(b, 0, sizeof(b));
-
-    for (int i = 0; i < 2; i++) {
-      b[7 - i] = half_float::detail::float2half<std::round_toward_zero>(a[i]);
-    }
-
-    return _mm_load_si128(reinterpret_cast<__m128i*>(b));
+  // Converts the floats in src to halves, truncating like vcvtps2ph with
+  // rounding mode 3, and leaves them in the low four words of dest. For hosts
+  // without F16C.
+  static void EmitFloatToHalf(X64Emitter& e, const Xmm& dest, const Xmm& src) {
+    e.vpand(e.xmm0, src, e.GetXmmConstPtr(XMMAbsMaskPS));
+    // Normal halves: rebias the exponent and drop the low mantissa bits.
+    e.vpsrld(e.xmm1, e.xmm0, 13);
+    e.vpsubd(e.xmm1, e.xmm1, e.GetXmmConstPtr(XMMPackFLOAT16_Rebias));
+    // Denormal halves are integer multiples of 2^-24.
+    e.vmulps(e.xmm2, e.xmm0, e.GetXmmConstPtr(XMMPackFLOAT16_DenormScale));
+    e.vcvttps2dq(e.xmm2, e.xmm2);
+    e.vmovdqa(e.xmm3, e.GetXmmConstPtr(XMMPackFLOAT16_MinNormal));
+    e.vpcmpgtd(e.xmm3, e.xmm3, e.xmm0);
+    e.vpblendvb(e.xmm1, e.xmm1, e.xmm2, e.xmm3);
+    // Finite values too large for a half truncate to the largest one.
+    e.vpcmpgtd(e.xmm3, e.xmm0, e.GetXmmConstPtr(XMMPackFLOAT16_Overflow));
+    e.vpblendvb(e.xmm1, e.xmm1, e.GetXmmConstPtr(XMMPackFLOAT16_Max),
+                e.xmm3);
+    // Infinities and NaNs keep the top of their mantissa.
+    e.vpcmpgtd(e.xmm3, e.xmm0, e.GetXmmConstPtr(XMMPackFLOAT16_InfNaN));
+    e.vpsrld(e.xmm2, e.xmm0, 13);
+    e.vpsubd(e.xmm2, e.xmm2, e.GetXmmConstPtr(XMMPackFLOAT16_Rebias));
+    e.vpsubd(e.xmm2, e.xmm2, e.GetXmmConstPtr(XMMPackFLOAT16_Rebias));
+    e.vpblendvb(e.xmm1, e.xmm1, e.xmm2, e.xmm3);
+    e.vpsrld(e.xmm2, src, 31);
+    e.vpslld(e.xmm2, e.xmm2, 15);
+    e.vpor(e.xmm1, e.xmm1, e.xmm2);
+    e.vpackusdw(dest, e.xmm1, e.xmm1);
   }
   static void EmitFLOAT16_2(X64Emitter& e, const EmitArgType& i) {
     assert_true(i.src2.value->IsConstantZero());
     // http://blogs.msdn.com/b/chuckw/archive/2012/09/11/directxmath-f16c-and-fma.aspx
     // dest = [(src1.x | src1.y), 0, 0, 0]
 
+    Xmm src;
+    if (i.src1.is_constant) {
+      src = i.dest;
+      e.LoadConstantXmm(src, i.src1.constant());
+    } else {
+      src = i.src1;
+    }
+    // 0|0|0|0|W|Z|Y|X
     if (e.IsFeatureEnabled(kX64EmitF16C)) {
-      Xmm src;
-      if (i.src1.is_constant) {
-        src = i.dest;
-        e.LoadConstantXmm(src, i.src1.constant());
-      } else {
-        src = i.src1;
-      }
-      // 0|0|0|0|W|Z|Y|X
       e.vcvtps2ph(i.dest, src, 0b00000011);
-      // Shuffle to X|Y|0|0|0|0|0|0
-      e.vpshufb(i.dest, i.dest, e.GetXmmConstPtr(XMMPackFLOAT16_2));
     } else {
-      if (i.src1.is_constant) {
-        e.lea(e.GetNativeParam(0), e.StashConstantXmm(0, i.src1.constant()));
-      } else {
-        e.lea(e.GetNativeParam(0), e.StashXmm(0, i.src1));
-      }
-      e.CallNativeSafe(reinterpret_cast<void*>(EmulateFLOAT16_2));
-      e.vmovaps(i.dest, e.xmm0);
-    }
-  }
-  static __m128i EmulateFLOAT16_4(void*, __m128 src1) {
-    alignas(16) float a[4];
-    alignas(16) uint16_t b[8];
-    _mm_store_ps(a, src1);
-    std::memset(b, 0, sizeof(b));
-
-    for (int i = 0; i < 4; i++) {
-      b[7 - (i ^ 2)] =
-          half_float::detail::float2half<std::round_toward_zero>(a[i]);
+      EmitFloatToHalf(e, i.dest, src);
     }
-
-    return _mm_load_si128(reinterpret_cast<__m128i*>(b));
+    // Shuffle to X|Y|0|0|0|0|0|0
+    e.vpshufb(i.dest, i.dest, e.GetXmmConstPtr(XMMPackFLOAT16_2));
   }
   static void EmitFLOAT16_4(X64Emitter& e, const EmitArgType& i) {
     assert_true(i.src2.value->IsConstantZero());
     // dest = [(src1.z | src1.w), (src1.x | src1.y), 0, 0]
 
+    Xmm src;
+    if (i.src1.is_constant) {
+      src = i.dest;
+      e.LoadConstantXmm(src, i.src1.constant());
+    } else {
+      src = i.src1;
+    }
+    // 0|0|0|0|W|Z|Y|X
     if (e.IsFeatureEnabled(kX64EmitF16C)) {
-      Xmm src;
-      if (i.src1.is_constant) {
-        src = i.dest;
-        e.LoadConstantXmm(src, i.src1.constant());
-      } else {
-        src = i.src1;
-      }
-      // 0|0|0|0|W|Z|Y|X
       e.vcvtps2ph(i.dest, src, 0b00000011);
-      // Shuffle to Z|W|X|Y|0|0|0|0
-      e.vpshufb(i.dest, i.dest, e.GetXmmConstPtr(XMMPackFLOAT16_4));
     } else {
-      if (i.src1.is_constant) {
-        e.lea(e.GetNativeParam(0), e.StashConstantXmm(0, i.src1.constant()));
-      } else {
-        e.lea(e.GetNativeParam(0), e.StashXmm(0, i.src1));
-      }
-      e.CallNativeSafe(reinterpret_cast<void*>(EmulateFLOAT16_4));
-      e.vmovaps(i.dest, e.xmm0);
+      EmitFloatToHalf(e, i.dest, src);
     }
+    // Shuffle to Z|W|X|Y|0|0|0|0
+    e.vpshufb(i.dest, i.dest, e.GetXmmConstPtr(XMMPackFLOAT16_4));
   }
   static void EmitSHORT_2(X64Emitter& e, const EmitArgType& i) {
     assert_true(i.src2.value->IsConstantZero());
@@ -2021,54 +2083,35 @@ struct PACK : Sequence<PACK, I<OPCODE_PACK, V128Op, V128Op, V128Op>> {
     // Merge XZ and YW.
     e.vorps(i.dest, e.xmm0);
   }
-  static __m128i EmulatePack8_IN_16_UN_UN_SAT(void*, __m128i src1,
-                                              __m128i src2) {
-    alignas(16) uint16_t a[8];
-    alignas(16) uint16_t b[8];
-    alignas(16) uint8_t c[16];
-    _mm_store_si128(reinterpret_cast<__m128i*>(a), src1);
-    _mm_store_si128(reinterpret_cast<__m128i*>(b), src2);
-    for (int i = 0; i < 8; ++i) {
-      c[i] = uint8_t(std::max(uint16_t(0), std::min(uint16_t(255), a[i])));
-      c[i + 8] = uint8_t(std::max(uint16_t(0), std::min(uint16_t(255), b[i])));
-    }
-    return _mm_load_si128(reinterpret_cast<__m128i*>(c));
-  }
-  static __m128i EmulatePack8_IN_16_UN_UN(void*, __m128i src1, __m128i src2) {
-    alignas(16) uint8_t a[16];
-    alignas(16) uint8_t b[16];
-    alignas(16) uint8_t c[16];
-    _mm_store_si128(reinterpret_cast<__m128i*>(a), src1);
-    _mm_store_si128(reinterpret_cast<__m128i*>(b), src2);
-    for (int i = 0; i < 8; ++i) {
-      c[i] = a[i * 2];
-      c[i + 8] = b[i * 2];
-    }
-    return _mm_load_si128(reinterpret_cast<__m128i*>(c));
-  }
   static void Emit8_IN_16(X64Emitter& e, const EmitArgType& i, uint32_t flags) {
     // TODO(benvanik): handle src2 (or src1) being constant zero
     if (IsPackInUnsigned(flags)) {
       if (IsPackOutUnsigned(flags)) {
+        Xmm src1 = i.src1.is_constant ? e.xmm2 : i.src1;
+        if (i.src1.is_constant) {
+          e.LoadConstantXmm(src1, i.src1.constant());
+        }
+        Xmm src2 = i.src2.is_constant ? e.xmm3 : i.src2;
+        if (i.src2.is_constant) {
+          e.LoadConstantXmm(src2, i.src2.constant());
+        }
         if (IsPackOutSaturate(flags)) {
           // unsigned -> unsigned + saturate
-          if (i.src2.is_constant) {
-            e.lea(e.GetNativeParam(1),
-                  e.StashConstantXmm(1, i.src2.constant()));
-          } else {
-            e.lea(e.GetNativeParam(1), e.StashXmm(1, i.src2));
-          }
-          e.lea(e.GetNativeParam(0), e.StashXmm(0, i.src1));
-          e.CallNativeSafe(
-              reinterpret_cast<void*>(EmulatePack8_IN_16_UN_UN_SAT));
-          e.vmovaps(i.dest, e.xmm0);
+          // vpackuswb saturates signed words, so clamp as unsigned first.
+          e.vpcmpeqw(e.xmm0, e.xmm0, e.xmm0);
+          e.vpsrlw(e.xmm0, e.xmm0, 8);
+          e.vpminuw(e.xmm1, src1, e.xmm0);
+          e.vpminuw(e.xmm0, src2, e.xmm0);
+          e.vpackuswb(i.dest, e.xmm1, e.xmm0);
           e.vpshufb(i.dest, i.dest, e.GetXmmConstPtr(XMMByteOrderMask));
         } else {
           // unsigned -> unsigned
-          e.lea(e.GetNativeParam(1), e.StashXmm(1, i.src2));
-          e.lea(e.GetNativeParam(0), e.StashXmm(0, i.src1));
-          e.CallNativeSafe(reinterpret_cast<void*>(EmulatePack8_IN_16_UN_UN));
-          e.vmovaps(i.dest, e.xmm0);
+          // Keep the low byte of each word; nothing saturates after that.
+          e.vpcmpeqw(e.xmm0, e.xmm0, e.xmm0);
+          e.vpsrlw(e.xmm0, e.xmm0, 8);
+          e.vpand(e.xmm1, src1, e.xmm0);
+          e.vpand(e.xmm0, src2, e.xmm0);
+          e.vpackuswb(i.dest, e.xmm1, e.xmm0);
           e.vpshufb(i.dest, i.dest, e.GetXmmConstPtr(XMMByteOrderMask));
         }
       } else {
@@ -2267,27 +2310,35 @@ struct UNPACK : Sequence<UNPACK, I<OPCODE_UNPACK, V128Op, V128Op>> {
     e.vpor(i.dest, e.GetXmmConstPtr(XMMOne));
     // To convert to 0 to 1, games multiply by 0x47008081 and add 0xC7008081.
   }
-  static __m128 EmulateFLOAT16_2(void*, __m128i src1) {
-    alignas(16) uint16_t a[8];
-    alignas(16) float b[4];
-    _mm_store_si128(reinterpret_cast<__m128i*>(a), src1);
-
-    for (int i = 0; i < 2; i++) {
-      b[i] = half_float::detail::half2float(a[VEC128_W(6 + i)]);
-    }
-
-    // Constants, or something
-    b[2] = 0.f;
-    b[3] = 1.f;
-
-    return _mm_load_ps(b);
+  // Converts the halves in the low four words of dest to floats in place,
+  // matching vcvtph2ps. For hosts without F16C.
+  static void EmitHalfToFloat(X64Emitter& e, const Xmm& dest) {
+    // http://fgiesen.wordpress.com/2012/03/28/half-to-float-done-quic/
+    e.vpmovzxwd(e.xmm0, dest);
+    // Exponent and mantissa moved into float position.
+    e.vpslld(e.xmm1, e.xmm0, 17);
+    e.vpsrld(e.xmm1, e.xmm1, 4);
+    e.vpand(e.xmm2, e.xmm1, e.GetXmmConstPtr(XMMUnpackFLOAT16_ExpMask));
+    e.vpaddd(e.xmm1, e.xmm1, e.GetXmmConstPtr(XMMUnpackFLOAT16_Rebias));
+    // Infinities and NaNs need the exponent rebiased a second time.
+    e.vpcmpeqd(e.xmm3, e.xmm2, e.GetXmmConstPtr(XMMUnpackFLOAT16_ExpMask));
+    e.vpand(e.xmm3, e.xmm3, e.GetXmmConstPtr(XMMUnpackFLOAT16_Rebias));
+    e.vpaddd(e.xmm1, e.xmm1, e.xmm3);
+    // Zeros and denormals: renormalize by letting the FPU subtract the
+    // implicit one. The result is exact, so the rounding mode doesn't matter.
+    e.vpxor(e.xmm3, e.xmm3, e.xmm3);
+    e.vpcmpeqd(e.xmm3, e.xmm3, e.xmm2);
+    e.vpaddd(e.xmm2, e.xmm1, e.GetXmmConstPtr(XMMFloatMinNormal));
+    e.vsubps(e.xmm2, e.xmm2, e.GetXmmConstPtr(XMMPackFLOAT16_MinNormal));
+    e.vblendvps(e.xmm1, e.xmm1, e.xmm2, e.xmm3);
+    e.vpsrld(e.xmm0, e.xmm0, 15);
+    e.vpslld(e.xmm0, e.xmm0, 31);
+    e.vpor(dest, e.xmm1, e.xmm0);
   }
   static void EmitFLOAT16_2(X64Emitter& e, const EmitArgType& i) {
     // 1 bit sign, 5 bit exponent, 10 bit mantissa
     // D3D10 half float format
-    // TODO(benvanik):
     // http://blogs.msdn.com/b/chuckw/archive/2012/09/11/directxmath-f16c-and-fma.aspx
-    // Use _mm_cvtph_ps -- requires very modern processors (SSE5+)
     // Unpacking half floats:
     // http://fgiesen.wordpress.com/2012/03/28/half-to-float-done-quic/
     // Packing half floats: https://gist.github.com/rygorous/2156668
@@ -2295,67 +2346,44 @@ struct UNPACK : Sequence<UNPACK, I<OPCODE_UNPACK, V128Op, V128Op>> {
     // Also zero out the high end.
     // TODO(benvanik): special case constant unpacks that just get 0/1/etc.
 
+    Xmm src;
+    if (i.src1.is_constant) {
+      src = i.dest;
+      e.LoadConstantXmm(src, i.src1.constant());
+    } else {
+      src = i.src1;
+    }
+    // sx = src.iw >> 16;
+    // sy = src.iw & 0xFFFF;
+    // dest = { XMConvertHalfToFloat(sx),
+    //          XMConvertHalfToFloat(sy),
+    //          0.0,
+    //          1.0 };
+    // Shuffle to 0|0|0|0|0|0|Y|X
+    e.vpshufb(i.dest, src, e.GetXmmConstPtr(XMMUnpackFLOAT16_2));
     if (e.IsFeatureEnabled(kX64EmitF16C)) {
-      Xmm src;
-      if (i.src1.is_constant) {
-        src = i.dest;
-        e.LoadConstantXmm(src, i.src1.constant());
-      } else {
-        src = i.src1;
-      }
-      // sx = src.iw >> 16;
-      // sy = src.iw & 0xFFFF;
-      // dest = { XMConvertHalfToFloat(sx),
-      //          XMConvertHalfToFloat(sy),
-      //          0.0,
-      //          1.0 };
-      // Shuffle to 0|0|0|0|0|0|Y|X
-      e.vpshufb(i.dest, src, e.GetXmmConstPtr(XMMUnpackFLOAT16_2));
       e.vcvtph2ps(i.dest, i.dest);
-      e.vpshufd(i.dest, i.dest, 0b10100100);
-      e.vpor(i.dest, e.GetXmmConstPtr(XMM0001));
     } else {
-      if (i.src1.is_constant) {
-        e.lea(e.GetNativeParam(0), e.StashConstantXmm(0, i.src1.constant()));
-      } else {
-        e.lea(e.GetNativeParam(0), e.StashXmm(0, i.src1));
-      }
-      e.CallNativeSafe(reinterpret_cast<void*>(EmulateFLOAT16_2));
-      e.vmovaps(i.dest, e.xmm0);
+      EmitHalfToFloat(e, i.dest);
     }
-  }
-  static __m128 EmulateFLOAT16_4(void*, __m128i src1) {
-    alignas(16) uint16_t a[8];
-    alignas(16) float b[4];
-    _mm_store_si128(reinterpret_cast<__m128i*>(a), src1);
-
-    for (int i = 0; i < 4; i++) {
-      b[i] = half_float::detail::half2float(a[VEC128_W(4 + i)]);
-    }
-
-    return _mm_load_ps(b);
+    e.vpshufd(i.dest, i.dest, 0b10100100);
+    e.vpor(i.dest, e.GetXmmConstPtr(XMM0001));
   }
   static void EmitFLOAT16_4(X64Emitter& e, const EmitArgType& i) {
     // src = [(dest.x | dest.y), (dest.z | dest.w), 0, 0]
+    Xmm src;
+    if (i.src1.is_constant) {
+      src = i.dest;
+      e.LoadConstantXmm(src, i.src1.constant());
+    } else {
+      src = i.src1;
+    }
+    // Shuffle to 0|0|0|0|W|Z|Y|X
+    e.vpshufb(i.dest, src, e.GetXmmConstPtr(XMMUnpackFLOAT16_4));
     if (e.IsFeatureEnabled(kX64EmitF16C)) {
-      Xmm src;
-      if (i.src1.is_constant) {
-        src = i.dest;
-        e.LoadConstantXmm(src, i.src1.constant());
-      } else {
-        src = i.src1;
-      }
-      // Shuffle to 0|0|0|0|W|Z|Y|X
-      e.vpshufb(i.dest, src, e.GetXmmConstPtr(XMMUnpackFLOAT16_4));
       e.vcvtph2ps(i.dest, i.dest);
     } else {
-      if (i.src1.is_constant) {
-        e.lea(e.GetNativeParam(0), e.StashConstantXmm(0, i.src1.constant()));
-      } else {
-        e.lea(e.GetNativeParam(0), e.StashXmm(0, i.src1));
-      }
-      e.CallNativeSafe(reinterpret_cast<void*>(EmulateFLOAT16_4));
-      e.vmovaps(i.dest, e.xmm0);
+      EmitHalfToFloat(e, i.dest);
     }
   }
   static void EmitSHORT_2(X64Emitter& e, const EmitArgType& i) {
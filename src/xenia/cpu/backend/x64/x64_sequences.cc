@@ -434,7 +434,8 @@ struct LOAD_CLOCK : Sequence<LOAD_CLOCK, I<OPCODE_LOAD_CLOCK, I64Op>> {
     // simple multiply and division. In that case we rather bake the scaling in
     // here to cut extra function calls with CPU cache misses and stack frame
     // overhead.
-    if (cvars::clock_no_scaling && cvars::clock_source_raw) {
+    if (cvars::clock_no_scaling && cvars::clock_source_raw &&
+        !cvars::clock_virtual) {
       auto ratio = Clock::guest_tick_ratio();
       // The 360 CPU is an in-order CPU, AMD64 usually isn't. Without
       // mfence/lfence magic the rdtsc instruction can be executed sooner or
@@ -459,6 +460,9 @@ struct LOAD_CLOCK : Sequence<LOAD_CLOCK, I<OPCODE_LOAD_CLOCK, I64Op>> {
     }
   }
   static uint64_t LoadClock(void* raw_context) {
+    if (cvars::clock_virtual) {
+      X64Emitter::FlushVirtualClock(raw_context);
+    }
     return Clock::QueryGuestTickCount();
   }
 };
@@ -2668,44 +2672,81 @@ struct LOG2_V128 : Sequence<LOG2_V128, I<OPCODE_LOG2, V128Op, V128Op>> {
 EMITTER_OPCODE_TABLE(OPCODE_LOG2, LOG2_F32, LOG2_F64, LOG2_V128);
 
 struct DOT_PRODUCT_V128 {
-  static void Emit(X64Emitter& e, Xmm dest, Xmm src1, Xmm src2, uint8_t imm) {
-    // TODO(benvanik): apparently this is very slow
-    // - find alternative?
-    Xbyak::Label end;
-    e.inLocalLabel();
-
-    // Grab space to put MXCSR.
-    // TODO(gibbed): stick this in TLS or
-    // something?
-    e.sub(e.rsp, 8);
-
-    // Grab MXCSR and mask off the overflow flag,
-    // because it's sticky.
-    e.vstmxcsr(e.dword[e.rsp]);
-    e.mov(e.eax, e.dword[e.rsp]);
-    e.and_(e.eax, uint32_t(~8));
-    e.mov(e.dword[e.rsp], e.eax);
-    e.vldmxcsr(e.dword[e.rsp]);
-
-    // Hey we can do the dot product now.
-    e.vdpps(dest, src1, src2, imm);
-
-    // Load MXCSR...
-    e.vstmxcsr(e.dword[e.rsp]);
-
-    // ..free our temporary space and get MXCSR at
-    // the same time
-    e.pop(e.rax);
-
-    // Did we overflow?
-    e.test(e.al, 8);
-    e.jz(end);
-
+  // Matches vdpps (products, then (p1 + p0) + (p3 + p2) with the operands in
+  // the same order so NaN propagation is identical) followed by a check of
+  // the MXCSR overflow flag, returning QNaN if any step overflowed. Reading
+  // and resetting MXCSR is slow, so instead overflow is recognized as an
+  // infinity produced from finite operands. Any overflow leaves the final sum
+  // infinite or NaN, so that is only looked into when the sum isn't finite.
+  // Under a directed rounding mode overflow can saturate to FLT_MAX and go
+  // unnoticed, but VMX arithmetic always rounds to nearest.
+  static void Emit(X64Emitter& e, Xmm dest, Xmm src1, Xmm src2, bool dot3) {
+    Xbyak::Label slow, end;
+
+    // xmm2 = [p0, p1, p2, p3], with p3 as +0 for the 3 component version.
+    e.vmulps(e.xmm2, src1, src2);
+    if (dot3) {
+      e.vblendps(e.xmm2, e.xmm2, e.GetXmmConstPtr(XMMZero), 0b1000);
+    }
+    e.vmovshdup(e.xmm3, e.xmm2);
+    e.vaddps(e.xmm2, e.xmm3, e.xmm2);
+    e.vmovhlps(e.xmm3, e.xmm2, e.xmm2);
+    e.vaddss(e.xmm2, e.xmm2, e.xmm3);
+    e.vmovd(e.eax, e.xmm2);
+    e.and_(e.eax, 0x7F800000);
+    e.cmp(e.eax, 0x7F800000);
+    e.je(slow, e.T_NEAR);
+    e.vmovaps(dest, e.xmm2);
+    e.jmp(end, e.T_NEAR);
+
+    e.L(slow);
+    // xmm2 = lanes where neither source is infinite.
+    e.vandps(e.xmm2, src1, e.GetXmmConstPtr(XMMAbsMaskPS));
+    e.vcmpneqps(e.xmm2, e.xmm2, e.GetXmmConstPtr(XMMPosInf));
+    e.vandps(e.xmm3, src2, e.GetXmmConstPtr(XMMAbsMaskPS));
+    e.vcmpneqps(e.xmm3, e.xmm3, e.GetXmmConstPtr(XMMPosInf));
+    e.vandps(e.xmm2, e.xmm2, e.xmm3);
+    e.vmulps(e.xmm3, src1, src2);
+    if (dot3) {
+      e.vblendps(e.xmm3, e.xmm3, e.GetXmmConstPtr(XMMZero), 0b1000);
+    }
+    // The sources (one may be in xmm0) are dead from here on.
+    // Overflowed products: infinite ones in lanes without infinite sources.
+    e.vandps(e.xmm2, e.xmm2, e.xmm3);
+    e.vandps(e.xmm2, e.xmm2, e.GetXmmConstPtr(XMMAbsMaskPS));
+    e.vcmpeqps(e.xmm2, e.xmm2, e.GetXmmConstPtr(XMMPosInf));
+    // Overflowed pair sums: infinite sums of just the finite products.
+    e.vandps(e.xmm0, e.xmm3, e.GetXmmConstPtr(XMMAbsMaskPS));
+    e.vcmpneqps(e.xmm0, e.xmm0, e.GetXmmConstPtr(XMMPosInf));
+    e.vandps(e.xmm0, e.xmm0, e.xmm3);
+    e.vmovshdup(e.xmm1, e.xmm0);
+    e.vaddps(e.xmm0, e.xmm1, e.xmm0);
+    e.vandps(e.xmm0, e.xmm0, e.GetXmmConstPtr(XMMAbsMaskPS));
+    e.vcmpeqps(e.xmm0, e.xmm0, e.GetXmmConstPtr(XMMPosInf));
+    // Lanes 1 and 3 hold p1 + p1 and p3 + p3, which mean nothing.
+    e.vblendps(e.xmm0, e.xmm0, e.GetXmmConstPtr(XMMZero), 0b1010);
+    e.vorps(e.xmm2, e.xmm2, e.xmm0);
+    // xmm3 = [p1 + p0, -, p3 + p2, -]
+    e.vmovshdup(e.xmm0, e.xmm3);
+    e.vaddps(e.xmm3, e.xmm0, e.xmm3);
+    // Overflowed final sum: infinite sum of just the finite pair sums.
+    e.vandps(e.xmm0, e.xmm3, e.GetXmmConstPtr(XMMAbsMaskPS));
+    e.vcmpneqps(e.xmm0, e.xmm0, e.GetXmmConstPtr(XMMPosInf));
+    e.vandps(e.xmm0, e.xmm0, e.xmm3);
+    e.vmovhlps(e.xmm1, e.xmm0, e.xmm0);
+    e.vaddss(e.xmm0, e.xmm0, e.xmm1);
+    e.vandps(e.xmm0, e.xmm0, e.GetXmmConstPtr(XMMAbsMaskPS));
+    e.vcmpeqps(e.xmm0, e.xmm0, e.GetXmmConstPtr(XMMPosInf));
+    e.vorps(e.xmm2, e.xmm2, e.xmm0);
+    // The sum itself.
+    e.vmovhlps(e.xmm0, e.xmm3, e.xmm3);
+    e.vaddss(dest, e.xmm3, e.xmm0);
+    e.vptest(e.xmm2, e.xmm2);
+    e.jz(end, e.T_NEAR);
     // Infinity? HA! Give NAN.
     e.vmovdqa(dest, e.GetXmmConstPtr(XMMQNaN));
 
     e.L(end);
-    e.outLocalLabel();
   }
 };
 
@@ -2719,7 +2760,7 @@ struct DOT_PRODUCT_3_V128
     // https://msdn.microsoft.com/en-us/library/bb514054(v=vs.90).aspx
     EmitCommutativeBinaryXmmOp(
         e, i, [](X64Emitter& e, Xmm dest, Xmm src1, Xmm src2) {
-          DOT_PRODUCT_V128::Emit(e, dest, src1, src2, 0b01110001);
+          DOT_PRODUCT_V128::Emit(e, dest, src1, src2, true);
         });
   }
 };
@@ -2735,7 +2776,7 @@ struct DOT_PRODUCT_4_V128
     // https://msdn.microsoft.com/en-us/library/bb514054(v=vs.90).aspx
     EmitCommutativeBinaryXmmOp(
         e, i, [](X64Emitter& e, Xmm dest, Xmm src1, Xmm src2) {
-          DOT_PRODUCT_V128::Emit(e, dest, src1, src2, 0b11110001);
+          DOT_PRODUCT_V128::Emit(e, dest, src1, src2, false);
         });
   }
 };
@@ -2989,28 +3030,38 @@ struct SHL_I64 : Sequence<SHL_I64, I<OPCODE_SHL, I64Op, I64Op, I8Op>> {
 };
 struct SHL_V128 : Sequence<SHL_V128, I<OPCODE_SHL, V128Op, V128Op, I8Op>> {
   static void Emit(X64Emitter& e, const EmitArgType& i) {
-    // TODO(benvanik): native version (with shift magic).
-    if (i.src2.is_constant) {
-      e.mov(e.GetNativeParam(1), i.src2.constant());
+    // shamt is [0,7]. Almost all instances are shamt = 1, but non-constant.
+    // Shift each dword and pull in the top bits of the next lower order one,
+    // which is in the next higher lane as the guest's most significant word
+    // sits in lane 0.
+    Xmm src1;
+    if (i.src1.is_constant) {
+      src1 = e.xmm2;
+      e.LoadConstantXmm(src1, i.src1.constant());
     } else {
-      e.mov(e.GetNativeParam(1), i.src2);
+      src1 = i.src1;
     }
-    e.lea(e.GetNativeParam(0), e.StashXmm(0, i.src1));
-    e.CallNativeSafe(reinterpret_cast<void*>(EmulateShlV128));
-    e.vmovaps(i.dest, e.xmm0);
-  }
-  static __m128i EmulateShlV128(void*, __m128i src1, uint8_t src2) {
-    // Almost all instances are shamt = 1, but non-constant.
-    // shamt is [0,7]
-    uint8_t shamt = src2 & 0x7;
-    alignas(16) vec128_t value;
-    _mm_store_si128(reinterpret_cast<__m128i*>(&value), src1);
-    for (int i = 0; i < 15; ++i) {
-      value.u8[i ^ 0x3] = (value.u8[i ^ 0x3] << shamt) |
-                          (value.u8[(i + 1) ^ 0x3] >> (8 - shamt));
+    e.vpsrldq(e.xmm0, src1, 4);
+    if (i.src2.is_constant) {
+      uint8_t shamt = i.src2.constant() & 0x7;
+      if (!shamt) {
+        e.vmovdqa(i.dest, src1);
+        return;
+      }
+      e.vpsrld(e.xmm0, e.xmm0, 32 - shamt);
+      e.vpslld(e.xmm1, src1, shamt);
+    } else {
+      e.movzx(e.eax, i.src2);
+      e.and_(e.eax, 0x7);
+      e.vmovd(e.xmm1, e.eax);
+      // A count of 32 clears the carried in bits when shamt is 0.
+      e.neg(e.eax);
+      e.add(e.eax, 32);
+      e.vmovd(e.xmm3, e.eax);
+      e.vpsrld(e.xmm0, e.xmm0, e.xmm3);
+      e.vpslld(e.xmm1, src1, e.xmm1);
     }
-    value.u8[15 ^ 0x3] = value.u8[15 ^ 0x3] << shamt;
-    return _mm_load_si128(reinterpret_cast<__m128i*>(&value));
+    e.vpor(i.dest, e.xmm0, e.xmm1);
   }
 };
 EMITTER_OPCODE_TABLE(OPCODE_SHL, SHL_I8, SHL_I16, SHL_I32, SHL_I64, SHL_V128);
@@ -3066,28 +3117,37 @@ struct SHR_I64 : Sequence<SHR_I64, I<OPCODE_SHR, I64Op, I64Op, I8Op>> {
 };
 struct SHR_V128 : Sequence<SHR_V128, I<OPCODE_SHR, V128Op, V128Op, I8Op>> {
   static void Emit(X64Emitter& e, const EmitArgType& i) {
-    // TODO(benvanik): native version (with shift magic).
+    // shamt is [0,7]. Almost all instances are shamt = 1, but non-constant.
+    // Mirror of SHL_V128: bits come in from the next higher order dword,
+    // which is in the next lower lane.
+    Xmm src1;
+    if (i.src1.is_constant) {
+      src1 = e.xmm2;
+      e.LoadConstantXmm(src1, i.src1.constant());
+    } else {
+      src1 = i.src1;
+    }
+    e.vpslldq(e.xmm0, src1, 4);
     if (i.src2.is_constant) {
-      e.mov(e.GetNativeParam(1), i.src2.constant());
+      uint8_t shamt = i.src2.constant() & 0x7;
+      if (!shamt) {
+        e.vmovdqa(i.dest, src1);
+        return;
+      }
+      e.vpslld(e.xmm0, e.xmm0, 32 - shamt);
+      e.vpsrld(e.xmm1, src1, shamt);
     } else {
-      e.mov(e.GetNativeParam(1), i.src2);
+      e.movzx(e.eax, i.src2);
+      e.and_(e.eax, 0x7);
+      e.vmovd(e.xmm1, e.eax);
+      // A count of 32 clears the carried in bits when shamt is 0.
+      e.neg(e.eax);
+      e.add(e.eax, 32);
+      e.vmovd(e.xmm3, e.eax);
+      e.vpslld(e.xmm0, e.xmm0, e.xmm3);
+      e.vpsrld(e.xmm1, src1, e.xmm1);
     }
-    e.lea(e.GetNativeParam(0), e.StashXmm(0, i.src1));
-    e.CallNativeSafe(reinterpret_cast<void*>(EmulateShrV128));
-    e.vmovaps(i.dest, e.xmm0);
-  }
-  static __m128i EmulateShrV128(void*, __m128i src1, uint8_t src2) {
-    // Almost all instances are shamt = 1, but non-constant.
-    // shamt is [0,7]
-    uint8_t shamt = src2 & 0x7;
-    alignas(16) vec128_t value;
-    _mm_store_si128(reinterpret_cast<__m128i*>(&value), src1);
-    for (int i = 15; i > 0; --i) {
-      value.u8[i ^ 0x3] = (value.u8[i ^ 0x3] >> shamt) |
-                          (value.u8[(i - 1) ^ 0x3] << (8 - shamt));
-    }
-    value.u8[0 ^ 0x3] = value.u8[0 ^ 0x3] >> shamt;
-    return _mm_load_si128(reinterpret_cast<__m128i*>(&value));
+    e.vpor(i.dest, e.xmm0, e.xmm1);
   }
 };
 EMITTER_OPCODE_TABLE(OPCODE_SHR, SHR_I8, SHR_I16, SHR_I32, SHR_I64, SHR_V128);
@@ -19,11 +19,16 @@
 #include "xenia/cpu/compiler/passes/data_flow_analysis_pass.h"
 #include "xenia/cpu/compiler/passes/dead_code_elimination_pass.h"
 #include "xenia/cpu/compiler/passes/finalization_pass.h"
+#include "xenia/cpu/compiler/passes/fpscr_update_elimination_pass.h"
+#include "xenia/cpu/compiler/passes/global_value_numbering_pass.h"
 #include "xenia/cpu/compiler/passes/memory_sequence_combination_pass.h"
 #include "xenia/cpu/compiler/passes/register_allocation_pass.h"
 #include "xenia/cpu/compiler/passes/repetitive_computation_merger_pass.h"
+#include "xenia/cpu/compiler/passes/safepoint_pass.h"
 #include "xenia/cpu/compiler/passes/simplification_pass.h"
+#include "xenia/cpu/compiler/passes/stack_promotion_pass.h"
 #include "xenia/cpu/compiler/passes/validation_pass.h"
 #include "xenia/cpu/compiler/passes/value_reduction_pass.h"
+#include "xenia/cpu/compiler/passes/virtual_clock_pass.h"
 
 #endif  // XENIA_CPU_COMPILER_COMPILER_PASSES_H_
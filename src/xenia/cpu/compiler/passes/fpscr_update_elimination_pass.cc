@@ -0,0 +1,149 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2020 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include "xenia/cpu/compiler/passes/fpscr_update_elimination_pass.h"
+
+#include <cstddef>
+
+#include "xenia/base/profiling.h"
+#include "xenia/cpu/compiler/compiler.h"
+#include "xenia/cpu/ppc/ppc_context.h"
+#include "xenia/cpu/processor.h"
+
+namespace xe {
+namespace cpu {
+namespace compiler {
+namespace passes {
+
+// TODO(benvanik): remove when enums redefined.
+using namespace xe::cpu::hir;
+
+using xe::cpu::hir::Block;
+using xe::cpu::hir::Edge;
+using xe::cpu::hir::HIRBuilder;
+using xe::cpu::hir::Instr;
+using xe::cpu::hir::Value;
+
+static const size_t kFPSCROffset = offsetof(ppc::PPCContext, fpscr);
+
+FPSCRUpdateEliminationPass::FPSCRUpdateEliminationPass() : CompilerPass() {}
+
+FPSCRUpdateEliminationPass::~FPSCRUpdateEliminationPass() {}
+
+bool FPSCRUpdateEliminationPass::Run(HIRBuilder* builder) {
+  // Forward must-analysis of the FPSCR bits that are zero. Everything starts
+  // out known zero and is narrowed until nothing changes, except the entry
+  // block where nothing is known.
+  uint16_t block_ordinal = 0;
+  auto block = builder->first_block();
+  while (block) {
+    block->ordinal = block_ordinal++;
+    block = block->next;
+  }
+  block_known_zero_.assign(block_ordinal, UINT32_MAX);
+
+  bool changed;
+  do {
+    changed = false;
+    block = builder->first_block();
+    while (block) {
+      uint32_t known_zero =
+          ProcessBlock(block, GetIncomingKnownZero(block), false);
+      if (known_zero != block_known_zero_[block->ordinal]) {
+        block_known_zero_[block->ordinal] = known_zero;
+        changed = true;
+      }
+      block = block->next;
+    }
+  } while (changed);
+
+  block = builder->first_block();
+  while (block) {
+    ProcessBlock(block, GetIncomingKnownZero(block), true);
+    block = block->next;
+  }
+
+  return true;
+}
+
+uint32_t FPSCRUpdateEliminationPass::GetIncomingKnownZero(Block* block) {
+  if (!block->prev) {
+    return 0;
+  }
+  bool any_predecessor = false;
+  uint32_t known_zero = UINT32_MAX;
+  auto edge = block->incoming_edge_head;
+  while (edge) {
+    known_zero &= block_known_zero_[edge->src->ordinal];
+    any_predecessor = true;
+    edge = edge->incoming_next;
+  }
+  // Fallthrough isn't in the CFG.
+  auto prev_tail = block->prev->instr_tail;
+  if (!prev_tail || (prev_tail->opcode != &OPCODE_BRANCH_info &&
+                     prev_tail->opcode != &OPCODE_RETURN_info)) {
+    known_zero &= block_known_zero_[block->prev->ordinal];
+    any_predecessor = true;
+  }
+  return any_predecessor ? known_zero : 0;
+}
+
+uint32_t FPSCRUpdateEliminationPass::ProcessBlock(Block* block,
+                                                  uint32_t known_zero,
+                                                  bool remove) {
+  // The last FPSCR load that nothing has stored over yet.
+  Value* fpscr_value = nullptr;
+  auto i = block->instr_head;
+  while (i) {
+    auto next = i->next;
+    if (i->opcode->flags & OPCODE_FLAG_VOLATILE) {
+      // Calls may change FPSCR, traps may let the debugger do so.
+      known_zero = 0;
+      fpscr_value = nullptr;
+    } else if (i->opcode == &OPCODE_LOAD_CONTEXT_info) {
+      if (i->src1.offset == kFPSCROffset) {
+        fpscr_value = i->dest;
+      }
+    } else if (i->opcode == &OPCODE_STORE_CONTEXT_info) {
+      size_t offset = i->src1.offset;
+      Value* value = i->src2.value;
+      if (offset == kFPSCROffset && value->type == INT32_TYPE) {
+        Instr* def = value->def;
+        if (value->IsConstant()) {
+          known_zero = ~uint32_t(value->constant.i32);
+        } else if (fpscr_value && def && def->opcode == &OPCODE_AND_info &&
+                   def->src1.value == fpscr_value &&
+                   def->src2.value->IsConstant()) {
+          // Clearing bits of the current value.
+          uint32_t cleared = ~uint32_t(def->src2.value->constant.i32);
+          if (remove && !(cleared & ~known_zero)) {
+            i->Remove();
+            i = next;
+            continue;
+          }
+          known_zero |= cleared;
+        } else {
+          known_zero = 0;
+        }
+        fpscr_value = nullptr;
+      } else if (offset < kFPSCROffset + 4 &&
+                 offset + GetTypeSize(value->type) > kFPSCROffset) {
+        known_zero = 0;
+        fpscr_value = nullptr;
+      }
+    }
+    i = next;
+  }
+  return known_zero;
+}
+
+}  // namespace passes
+}  // namespace compiler
+}  // namespace cpu
+}  // namespace xe
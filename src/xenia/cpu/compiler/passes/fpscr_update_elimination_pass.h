@@ -0,0 +1,50 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2020 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#ifndef XENIA_CPU_COMPILER_PASSES_FPSCR_UPDATE_ELIMINATION_PASS_H_
+#define XENIA_CPU_COMPILER_PASSES_FPSCR_UPDATE_ELIMINATION_PASS_H_
+
+#include <vector>
+
+#include "xenia/cpu/compiler/compiler_pass.h"
+
+namespace xe {
+namespace cpu {
+namespace compiler {
+namespace passes {
+
+// Removes FPSCR updates that only clear bits already known to be clear on
+// every path reaching them. FPU instructions all clear the same non-sticky
+// exception bits, so after the first update in a function, blocks doing FP
+// math mostly have nothing left to write until a call or an explicit FPSCR
+// store (mtfsf and friends) may have raised them again.
+// Requires the CFG from ControlFlowAnalysisPass.
+class FPSCRUpdateEliminationPass : public CompilerPass {
+ public:
+  FPSCRUpdateEliminationPass();
+  ~FPSCRUpdateEliminationPass() override;
+
+  bool Run(hir::HIRBuilder* builder) override;
+
+ private:
+  uint32_t GetIncomingKnownZero(hir::Block* block);
+  // Returns the FPSCR bits known to be zero at the end of the block. Redundant
+  // updates are removed as they are found if remove is set.
+  uint32_t ProcessBlock(hir::Block* block, uint32_t known_zero, bool remove);
+
+  // FPSCR bits known to be zero on exit from each block, by ordinal.
+  std::vector<uint32_t> block_known_zero_;
+};
+
+}  // namespace passes
+}  // namespace compiler
+}  // namespace cpu
+}  // namespace xe
+
+#endif  // XENIA_CPU_COMPILER_PASSES_FPSCR_UPDATE_ELIMINATION_PASS_H_
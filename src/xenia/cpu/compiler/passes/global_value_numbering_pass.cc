@@ -0,0 +1,624 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2020 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include "xenia/cpu/compiler/passes/global_value_numbering_pass.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "xenia/base/assert.h"
+#include "xenia/base/profiling.h"
+
+namespace xe {
+namespace cpu {
+namespace compiler {
+namespace passes {
+
+// TODO(benvanik): remove when enums redefined.
+using namespace xe::cpu::hir;
+
+using xe::cpu::hir::Block;
+using xe::cpu::hir::Edge;
+using xe::cpu::hir::HIRBuilder;
+using xe::cpu::hir::Instr;
+using xe::cpu::hir::Value;
+
+namespace {
+
+// Past this, the blocks between a dominator and a block are assumed to write
+// everything rather than being walked.
+const uint32_t kMaxIncomingClobberBlocks = 64;
+const size_t kMaxClobberRanges = 16;
+// Each value reused across blocks takes a stack slot.
+const uint32_t kMaxLocals = 128;
+
+const uint32_t kInvalidIndex = UINT32_MAX;
+
+bool IsBranch(const Instr* i) {
+  // Volatile, but they don't write anything.
+  return i->opcode == &OPCODE_BRANCH_info ||
+         i->opcode == &OPCODE_BRANCH_TRUE_info ||
+         i->opcode == &OPCODE_BRANCH_FALSE_info ||
+         i->opcode == &OPCODE_RETURN_info ||
+         i->opcode == &OPCODE_RETURN_TRUE_info;
+}
+
+bool IsRoundingDependent(const Instr* i) {
+  auto IsFloat = [](TypeName type) {
+    return type == FLOAT32_TYPE || type == FLOAT64_TYPE || type == VEC128_TYPE;
+  };
+  uint32_t signature = i->opcode->signature;
+  return IsFloat(i->dest->type) ||
+         (GET_OPCODE_SIG_TYPE_SRC1(signature) == OPCODE_SIG_TYPE_V &&
+          IsFloat(i->src1.value->type)) ||
+         (GET_OPCODE_SIG_TYPE_SRC2(signature) == OPCODE_SIG_TYPE_V &&
+          IsFloat(i->src2.value->type)) ||
+         (GET_OPCODE_SIG_TYPE_SRC3(signature) == OPCODE_SIG_TYPE_V &&
+          IsFloat(i->src3.value->type));
+}
+
+// Guest memory loads, the only memory accesses that may be reused.
+bool IsPlainLoad(const Instr* i) {
+  return i->opcode == &OPCODE_LOAD_info ||
+         i->opcode == &OPCODE_LOAD_OFFSET_info;
+}
+
+// Not worth a store and a load of a local when done in another block.
+bool IsCheap(const Instr* i) {
+  return i->opcode == &OPCODE_LOAD_CONTEXT_info ||
+         i->opcode == &OPCODE_CAST_info ||
+         i->opcode == &OPCODE_ZERO_EXTEND_info ||
+         i->opcode == &OPCODE_SIGN_EXTEND_info ||
+         i->opcode == &OPCODE_TRUNCATE_info;
+}
+
+}  // namespace
+
+void GlobalValueNumberingPass::Clobbers::Merge(const Clobbers& other) {
+  memory |= other.memory;
+  rounding_mode |= other.rounding_mode;
+  all_context |= other.all_context;
+  if (!all_context) {
+    context_ranges.insert(context_ranges.end(), other.context_ranges.begin(),
+                          other.context_ranges.end());
+    if (context_ranges.size() > kMaxClobberRanges) {
+      all_context = true;
+    }
+  }
+  if (all_context) {
+    context_ranges.clear();
+  }
+}
+
+bool GlobalValueNumberingPass::ExpressionKey::operator==(
+    const ExpressionKey& other) const {
+  return opcode == other.opcode && flags == other.flags &&
+         type == other.type && epoch == other.epoch &&
+         operands[0] == other.operands[0] &&
+         operands[1] == other.operands[1] && operands[2] == other.operands[2];
+}
+
+size_t GlobalValueNumberingPass::ExpressionKeyHash::operator()(
+    const ExpressionKey& key) const {
+  uint64_t hash = reinterpret_cast<uintptr_t>(key.opcode);
+  hash = hash * 31 + ((uint64_t(key.flags) << 8) | key.type);
+  hash = hash * 31 + key.epoch;
+  for (uint64_t operand : key.operands) {
+    hash = (hash ^ operand) * 0x100000001B3ull;
+  }
+  return size_t(hash ^ (hash >> 32));
+}
+
+GlobalValueNumberingPass::GlobalValueNumberingPass() : CompilerPass() {}
+
+GlobalValueNumberingPass::~GlobalValueNumberingPass() {}
+
+bool GlobalValueNumberingPass::Run(HIRBuilder* builder) {
+  SCOPE_profile_cpu_f("cpu");
+
+  replaced_in_block_count_ = 0;
+  replaced_across_blocks_count_ = 0;
+  if (!BuildDominatorTree(builder)) {
+    return true;
+  }
+
+  next_value_number_ = 1;
+  value_numbers_.assign(builder->max_value_ordinal(), 0);
+  constant_value_numbers_.clear();
+  block_values_.assign(1, nullptr);
+  block_value_stamps_.assign(1, 0);
+  block_stamp_ = 0;
+  expressions_.clear();
+  expression_log_.clear();
+  context_.clear();
+  context_log_.clear();
+  next_epoch_ = 1;
+  memory_epoch_ = 0;
+  rounding_epoch_ = 0;
+  local_count_ = 0;
+
+  block_clobbers_.resize(blocks_.size());
+  for (size_t n = 0; n < blocks_.size(); ++n) {
+    block_clobbers_[n] = Clobbers();
+    ComputeBlockClobbers(blocks_[n], block_clobbers_[n]);
+  }
+
+  // Preorder walk of the dominator tree. Everything a block adds to the tables
+  // is undone before its siblings are visited.
+  struct Frame {
+    uint32_t index;
+    size_t next_child;
+    size_t expression_mark;
+    size_t context_mark;
+    uint32_t memory_epoch;
+    uint32_t rounding_epoch;
+  };
+  std::vector<Frame> stack;
+  Clobbers incoming;
+  auto Enter = [&](uint32_t index) {
+    stack.push_back({index, 0, expression_log_.size(), context_log_.size(),
+                     memory_epoch_, rounding_epoch_});
+    if (index) {
+      incoming = Clobbers();
+      ComputeIncomingClobbers(index, incoming);
+      ApplyClobbers(incoming);
+    }
+    ProcessBlock(builder, blocks_[index]);
+  };
+  Enter(0);
+  while (!stack.empty()) {
+    Frame& frame = stack.back();
+    const auto& children = dominator_children_[frame.index];
+    if (frame.next_child < children.size()) {
+      Enter(children[frame.next_child++]);
+      continue;
+    }
+    while (expression_log_.size() > frame.expression_mark) {
+      expressions_.erase(expression_log_.back());
+      expression_log_.pop_back();
+    }
+    while (context_log_.size() > frame.context_mark) {
+      const ContextUndo& undo = context_log_.back();
+      if (undo.existed) {
+        context_[undo.offset] = undo.entry;
+      } else {
+        context_.erase(undo.offset);
+      }
+      context_log_.pop_back();
+    }
+    memory_epoch_ = frame.memory_epoch;
+    rounding_epoch_ = frame.rounding_epoch;
+    stack.pop_back();
+  }
+
+  return true;
+}
+
+bool GlobalValueNumberingPass::BuildDominatorTree(HIRBuilder* builder) {
+  blocks_.clear();
+  uint32_t block_count = 0;
+  for (auto block = builder->first_block(); block; block = block->next) {
+    block->ordinal = uint16_t(block_count++);
+  }
+  if (!block_count) {
+    return false;
+  }
+
+  // Postorder from the entry, then reversed.
+  block_indices_.assign(block_count, kInvalidIndex);
+  std::vector<std::pair<Block*, Edge*>> dfs_stack;
+  std::vector<bool> visited(block_count, false);
+  visited[0] = true;
+  dfs_stack.emplace_back(builder->first_block(),
+                         builder->first_block()->outgoing_edge_head);
+  while (!dfs_stack.empty()) {
+    auto& top = dfs_stack.back();
+    if (top.second) {
+      Block* dest = top.second->dest;
+      top.second = top.second->outgoing_next;
+      if (!visited[dest->ordinal]) {
+        visited[dest->ordinal] = true;
+        dfs_stack.emplace_back(dest, dest->outgoing_edge_head);
+      }
+      continue;
+    }
+    blocks_.push_back(top.first);
+    dfs_stack.pop_back();
+  }
+  std::reverse(blocks_.begin(), blocks_.end());
+  for (uint32_t n = 0; n < blocks_.size(); ++n) {
+    block_indices_[blocks_[n]->ordinal] = n;
+  }
+
+  // Cooper, Harvey and Kennedy, "A Simple, Fast Dominance Algorithm".
+  idoms_.assign(blocks_.size(), kInvalidIndex);
+  idoms_[0] = 0;
+  bool changed;
+  do {
+    changed = false;
+    for (uint32_t n = 1; n < blocks_.size(); ++n) {
+      uint32_t new_idom = kInvalidIndex;
+      for (auto edge = blocks_[n]->incoming_edge_head; edge;
+           edge = edge->incoming_next) {
+        uint32_t pred = block_indices_[edge->src->ordinal];
+        if (pred == kInvalidIndex || idoms_[pred] == kInvalidIndex) {
+          continue;
+        }
+        if (new_idom == kInvalidIndex) {
+          new_idom = pred;
+          continue;
+        }
+        uint32_t a = pred, b = new_idom;
+        while (a != b) {
+          while (a > b) {
+            a = idoms_[a];
+          }
+          while (b > a) {
+            b = idoms_[b];
+          }
+        }
+        new_idom = a;
+      }
+      if (idoms_[n] != new_idom) {
+        idoms_[n] = new_idom;
+        changed = true;
+      }
+    }
+  } while (changed);
+
+  dominator_children_.resize(blocks_.size());
+  for (auto& children : dominator_children_) {
+    children.clear();
+  }
+  for (uint32_t n = 1; n < blocks_.size(); ++n) {
+    dominator_children_[idoms_[n]].push_back(n);
+  }
+  visit_stamps_.assign(blocks_.size(), 0);
+  visit_stamp_ = 0;
+  return true;
+}
+
+void GlobalValueNumberingPass::ComputeBlockClobbers(Block* block,
+                                                   Clobbers& clobbers) {
+  for (auto i = block->instr_head; i; i = i->next) {
+    const OpcodeInfo* opcode = i->opcode;
+    if (opcode->flags & OPCODE_FLAG_VOLATILE) {
+      if (!IsBranch(i)) {
+        // Calls and traps may change anything.
+        clobbers.all_context = true;
+        clobbers.memory = true;
+        clobbers.rounding_mode = true;
+      }
+    } else if (opcode == &OPCODE_STORE_CONTEXT_info) {
+      clobbers.context_ranges.emplace_back(
+          uint32_t(i->src1.offset),
+          uint32_t(GetTypeSize(i->src2.value->type)));
+    } else if (opcode == &OPCODE_CONTEXT_BARRIER_info) {
+      clobbers.all_context = true;
+    } else if (opcode == &OPCODE_SET_ROUNDING_MODE_info) {
+      clobbers.rounding_mode = true;
+    } else if ((opcode->flags & OPCODE_FLAG_MEMORY) && !IsPlainLoad(i)) {
+      clobbers.memory = true;
+    }
+  }
+  if (clobbers.context_ranges.size() > kMaxClobberRanges) {
+    clobbers.all_context = true;
+  }
+  if (clobbers.all_context) {
+    clobbers.context_ranges.clear();
+  }
+}
+
+void GlobalValueNumberingPass::ComputeIncomingClobbers(uint32_t index,
+                                                       Clobbers& clobbers) {
+  uint32_t idom = idoms_[index];
+  ++visit_stamp_;
+  std::vector<uint32_t> worklist;
+  auto AddPredecessors = [&](uint32_t n) {
+    for (auto edge = blocks_[n]->incoming_edge_head; edge;
+         edge = edge->incoming_next) {
+      uint32_t pred = block_indices_[edge->src->ordinal];
+      if (pred == kInvalidIndex || pred == idom) {
+        continue;
+      }
+      if (pred >= n) {
+        // Every cycle has an edge going back in reverse postorder, so there
+        // may be a loop between the dominator and the block. Other guest
+        // threads may be what ends it, and memory loaded before it can't be
+        // trusted after.
+        clobbers.memory = true;
+      }
+      if (visit_stamps_[pred] != visit_stamp_) {
+        visit_stamps_[pred] = visit_stamp_;
+        worklist.push_back(pred);
+      }
+    }
+  };
+  AddPredecessors(index);
+  uint32_t count = 0;
+  while (!worklist.empty()) {
+    uint32_t n = worklist.back();
+    worklist.pop_back();
+    if (++count > kMaxIncomingClobberBlocks) {
+      clobbers.all_context = true;
+      clobbers.memory = true;
+      clobbers.rounding_mode = true;
+      clobbers.context_ranges.clear();
+      return;
+    }
+    clobbers.Merge(block_clobbers_[n]);
+    AddPredecessors(n);
+  }
+}
+
+void GlobalValueNumberingPass::ApplyClobbers(const Clobbers& clobbers) {
+  if (clobbers.all_context) {
+    KillAllContext();
+  } else {
+    for (const auto& range : clobbers.context_ranges) {
+      KillContext(range.first, range.second);
+    }
+  }
+  if (clobbers.memory) {
+    memory_epoch_ = next_epoch_++;
+  }
+  if (clobbers.rounding_mode) {
+    rounding_epoch_ = next_epoch_++;
+  }
+}
+
+void GlobalValueNumberingPass::ProcessBlock(HIRBuilder* builder,
+                                            Block* block) {
+  ++block_stamp_;
+  for (auto i = block->instr_head; i; i = i->next) {
+    const OpcodeInfo* opcode = i->opcode;
+    if (opcode == &OPCODE_LOAD_CONTEXT_info) {
+      ProcessLoadContext(i);
+    } else if (opcode == &OPCODE_STORE_CONTEXT_info) {
+      Value* value = i->src2.value;
+      uint32_t offset = uint32_t(i->src1.offset);
+      KillContext(offset, uint32_t(GetTypeSize(value->type)));
+      StoreContext(offset, value->type, GetValueNumber(value));
+    } else if (opcode == &OPCODE_CONTEXT_BARRIER_info) {
+      KillAllContext();
+    } else if (opcode->flags & OPCODE_FLAG_VOLATILE) {
+      if (!IsBranch(i)) {
+        KillAllContext();
+        memory_epoch_ = next_epoch_++;
+        rounding_epoch_ = next_epoch_++;
+      }
+    } else if (opcode == &OPCODE_SET_ROUNDING_MODE_info) {
+      rounding_epoch_ = next_epoch_++;
+    } else if (opcode->flags & OPCODE_FLAG_MEMORY) {
+      if (IsPlainLoad(i)) {
+        ProcessExpression(builder, i, memory_epoch_);
+      } else {
+        // Stores, and MMIO accesses, which may have side effects even when
+        // they only read.
+        memory_epoch_ = next_epoch_++;
+      }
+    } else if (opcode == &OPCODE_ASSIGN_info) {
+      SetValueNumber(i->dest, GetValueNumber(i->src1.value));
+    } else if (i->dest && opcode != &OPCODE_LOAD_CLOCK_info &&
+               opcode != &OPCODE_LOAD_LOCAL_info &&
+               !(opcode->flags & OPCODE_FLAG_PAIRED_PREV) &&
+               !(i->next && i->next->opcode->flags & OPCODE_FLAG_PAIRED_PREV)) {
+      ProcessExpression(builder, i,
+                        IsRoundingDependent(i) ? rounding_epoch_ : 0);
+    }
+    if (i->dest) {
+      // Anything not numbered above is unique.
+      uint32_t value_number = GetValueNumber(i->dest);
+      if (!GetBlockValue(value_number)) {
+        SetBlockValue(value_number, i->dest);
+      }
+    }
+  }
+}
+
+void GlobalValueNumberingPass::ProcessExpression(HIRBuilder* builder,
+                                                 Instr* i, uint32_t epoch) {
+  ExpressionKey key;
+  key.opcode = i->opcode;
+  key.flags = i->flags;
+  key.type = i->dest->type;
+  key.epoch = epoch;
+  uint32_t signature = i->opcode->signature;
+  const Instr::Op* sources[] = {&i->src1, &i->src2, &i->src3};
+  const uint32_t source_types[] = {GET_OPCODE_SIG_TYPE_SRC1(signature),
+                                   GET_OPCODE_SIG_TYPE_SRC2(signature),
+                                   GET_OPCODE_SIG_TYPE_SRC3(signature)};
+  for (uint32_t n = 0; n < 3; ++n) {
+    switch (source_types[n]) {
+      case OPCODE_SIG_TYPE_V:
+        key.operands[n] = GetValueNumber(sources[n]->value);
+        break;
+      case OPCODE_SIG_TYPE_O:
+        key.operands[n] = sources[n]->offset;
+        break;
+      default:
+        key.operands[n] = 0;
+        break;
+    }
+  }
+  if ((i->opcode->flags & OPCODE_FLAG_COMMUNATIVE) &&
+      key.operands[0] > key.operands[1]) {
+    std::swap(key.operands[0], key.operands[1]);
+  }
+
+  auto it = expressions_.find(key);
+  if (it == expressions_.end()) {
+    Expression expression;
+    expression.value_number = AllocValueNumber();
+    expression.leader = i->dest;
+    SetValueNumber(i->dest, expression.value_number);
+    expressions_.emplace(key, expression);
+    expression_log_.push_back(key);
+    return;
+  }
+  SetValueNumber(i->dest, it->second.value_number);
+  ReplaceInstr(builder, i, it->second.leader, it->second.value_number);
+}
+
+void GlobalValueNumberingPass::ProcessLoadContext(Instr* i) {
+  uint32_t offset = uint32_t(i->src1.offset);
+  auto it = context_.find(offset);
+  if (it != context_.end() && it->second.type == i->dest->type) {
+    uint32_t value_number = it->second.value_number;
+    SetValueNumber(i->dest, value_number);
+    Value* block_value = GetBlockValue(value_number);
+    if (block_value) {
+      i->Replace(&OPCODE_ASSIGN_info, 0);
+      i->set_src1(block_value);
+      ++replaced_in_block_count_;
+    }
+    return;
+  }
+  uint32_t value_number = AllocValueNumber();
+  SetValueNumber(i->dest, value_number);
+  StoreContext(offset, i->dest->type, value_number);
+}
+
+void GlobalValueNumberingPass::StoreContext(uint32_t offset, TypeName type,
+                                            uint32_t value_number) {
+  ContextUndo undo;
+  undo.offset = offset;
+  auto it = context_.find(offset);
+  undo.existed = it != context_.end();
+  if (undo.existed) {
+    undo.entry = it->second;
+  }
+  context_log_.push_back(undo);
+  context_[offset] = {type, value_number};
+}
+
+void GlobalValueNumberingPass::KillContext(uint32_t offset, uint32_t length) {
+  // Entries are at most 16 bytes long.
+  auto it = context_.lower_bound(offset >= 15 ? offset - 15 : 0);
+  while (it != context_.end() && it->first < offset + length) {
+    if (it->first + GetTypeSize(it->second.type) > offset) {
+      context_log_.push_back({it->first, true, it->second});
+      it = context_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+void GlobalValueNumberingPass::KillAllContext() {
+  for (const auto& it : context_) {
+    context_log_.push_back({it.first, true, it.second});
+  }
+  context_.clear();
+}
+
+void GlobalValueNumberingPass::ReplaceInstr(HIRBuilder* builder, Instr* i,
+                                            Value* leader,
+                                            uint32_t value_number) {
+  Value* block_value = GetBlockValue(value_number);
+  if (block_value) {
+    i->Replace(&OPCODE_ASSIGN_info, 0);
+    i->set_src1(block_value);
+    ++replaced_in_block_count_;
+    return;
+  }
+  if (IsCheap(i)) {
+    return;
+  }
+  Value* slot = GetLocalSlot(builder, leader);
+  if (!slot) {
+    return;
+  }
+  i->Replace(&OPCODE_LOAD_LOCAL_info, 0);
+  i->set_src1(slot);
+  // Spilling it again can reuse the slot.
+  i->dest->local_slot = slot;
+  ++replaced_across_blocks_count_;
+}
+
+Value* GlobalValueNumberingPass::GetLocalSlot(HIRBuilder* builder,
+                                              Value* value) {
+  if (value->local_slot) {
+    return value->local_slot;
+  }
+  if (local_count_ >= kMaxLocals) {
+    return nullptr;
+  }
+  // Stored right after the def, or as soon after as the PAIRED flags allow.
+  auto def_next = value->def->next;
+  while (def_next && def_next->opcode->flags & OPCODE_FLAG_PAIRED_PREV) {
+    def_next = def_next->next;
+  }
+  if (!def_next) {
+    // Nothing to put the store before at the end of a block that falls through.
+    return nullptr;
+  }
+  ++local_count_;
+  value->local_slot = builder->AllocLocal(value->type);
+  builder->StoreLocal(value->local_slot, value);
+  builder->last_instr()->MoveBefore(def_next);
+  return value->local_slot;
+}
+
+uint32_t GlobalValueNumberingPass::AllocValueNumber() {
+  block_values_.push_back(nullptr);
+  block_value_stamps_.push_back(0);
+  return next_value_number_++;
+}
+
+uint32_t GlobalValueNumberingPass::GetValueNumber(Value* value) {
+  if (value->IsConstant()) {
+    uint8_t bits[16] = {};
+    std::memcpy(bits, &value->constant, GetTypeSize(value->type));
+    uint64_t low, high;
+    std::memcpy(&low, bits, sizeof(low));
+    std::memcpy(&high, bits + 8, sizeof(high));
+    auto key = std::make_tuple(uint8_t(value->type), low, high);
+    auto it = constant_value_numbers_.find(key);
+    if (it != constant_value_numbers_.end()) {
+      return it->second;
+    }
+    uint32_t value_number = AllocValueNumber();
+    constant_value_numbers_.emplace(key, value_number);
+    return value_number;
+  }
+  if (value->ordinal >= value_numbers_.size()) {
+    value_numbers_.resize(value->ordinal + 1, 0);
+  }
+  uint32_t& value_number = value_numbers_[value->ordinal];
+  if (!value_number) {
+    value_number = AllocValueNumber();
+  }
+  return value_number;
+}
+
+void GlobalValueNumberingPass::SetValueNumber(Value* value,
+                                              uint32_t value_number) {
+  if (value->ordinal >= value_numbers_.size()) {
+    value_numbers_.resize(value->ordinal + 1, 0);
+  }
+  value_numbers_[value->ordinal] = value_number;
+}
+
+Value* GlobalValueNumberingPass::GetBlockValue(uint32_t value_number) const {
+  return block_value_stamps_[value_number] == block_stamp_
+             ? block_values_[value_number]
+             : nullptr;
+}
+
+void GlobalValueNumberingPass::SetBlockValue(uint32_t value_number,
+                                             Value* value) {
+  block_values_[value_number] = value;
+  block_value_stamps_[value_number] = block_stamp_;
+}
+
+}  // namespace passes
+}  // namespace compiler
+}  // namespace cpu
+}  // namespace xe
@@ -0,0 +1,158 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2020 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#ifndef XENIA_CPU_COMPILER_PASSES_GLOBAL_VALUE_NUMBERING_PASS_H_
+#define XENIA_CPU_COMPILER_PASSES_GLOBAL_VALUE_NUMBERING_PASS_H_
+
+#include <cstdint>
+#include <map>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "xenia/cpu/compiler/compiler_pass.h"
+
+namespace xe {
+namespace cpu {
+namespace compiler {
+namespace passes {
+
+// Finds computations that repeat one done earlier in the same block or in a
+// dominating block, walking the dominator tree with scoped tables. Guest
+// memory loads are only reused while nothing may have stored to memory, and
+// context loads while nothing has stored to their bytes, on every path from
+// the first load.
+//
+// The register allocator works per block, so values don't live across blocks.
+// A computation reused from a dominating block is stored to a local after it
+// is done and loaded from there instead. Cheap ones (context loads,
+// conversions) are only numbered, so the computations using them can match,
+// and are never carried across blocks.
+// Requires the CFG from ControlFlowAnalysisPass.
+class GlobalValueNumberingPass : public CompilerPass {
+ public:
+  GlobalValueNumberingPass();
+  ~GlobalValueNumberingPass() override;
+
+  bool Run(hir::HIRBuilder* builder) override;
+
+  // Computations replaced by the last Run.
+  uint32_t replaced_in_block_count() const { return replaced_in_block_count_; }
+  uint32_t replaced_across_blocks_count() const {
+    return replaced_across_blocks_count_;
+  }
+
+ private:
+  // Effects that make earlier loads stale.
+  struct Clobbers {
+    // Written context bytes, as (offset, length).
+    std::vector<std::pair<uint32_t, uint32_t>> context_ranges;
+    bool all_context = false;
+    bool memory = false;
+    bool rounding_mode = false;
+
+    void Merge(const Clobbers& other);
+  };
+
+  struct ExpressionKey {
+    const hir::OpcodeInfo* opcode;
+    uint16_t flags;
+    uint8_t type;
+    // Memory or rounding mode epoch for operations that depend on them.
+    uint32_t epoch;
+    uint64_t operands[3];
+
+    bool operator==(const ExpressionKey& other) const;
+  };
+  struct ExpressionKeyHash {
+    size_t operator()(const ExpressionKey& key) const;
+  };
+  struct Expression {
+    uint32_t value_number;
+    // First value with the number, defined in a dominating block.
+    hir::Value* leader;
+  };
+
+  struct ContextEntry {
+    hir::TypeName type;
+    uint32_t value_number;
+  };
+  struct ContextUndo {
+    uint32_t offset;
+    bool existed;
+    ContextEntry entry;
+  };
+
+  bool BuildDominatorTree(hir::HIRBuilder* builder);
+  void ComputeBlockClobbers(hir::Block* block, Clobbers& clobbers);
+  // Gathers the effects of all blocks on paths from the immediate dominator to
+  // the block.
+  void ComputeIncomingClobbers(uint32_t index, Clobbers& clobbers);
+  void ApplyClobbers(const Clobbers& clobbers);
+
+  void ProcessBlock(hir::HIRBuilder* builder, hir::Block* block);
+  void ProcessExpression(hir::HIRBuilder* builder, hir::Instr* i,
+                         uint32_t epoch);
+  void ProcessLoadContext(hir::Instr* i);
+  void StoreContext(uint32_t offset, hir::TypeName type,
+                    uint32_t value_number);
+  void KillContext(uint32_t offset, uint32_t length);
+  void KillAllContext();
+  // Makes i produce the value of the leader, which has the given number.
+  void ReplaceInstr(hir::HIRBuilder* builder, hir::Instr* i,
+                    hir::Value* leader, uint32_t value_number);
+  hir::Value* GetLocalSlot(hir::HIRBuilder* builder, hir::Value* value);
+
+  uint32_t AllocValueNumber();
+  uint32_t GetValueNumber(hir::Value* value);
+  void SetValueNumber(hir::Value* value, uint32_t value_number);
+  // The value with the number defined in the current block, if any.
+  hir::Value* GetBlockValue(uint32_t value_number) const;
+  void SetBlockValue(uint32_t value_number, hir::Value* value);
+
+  // Reachable blocks in reverse postorder and their immediate dominators and
+  // children, by index in that order.
+  std::vector<hir::Block*> blocks_;
+  std::vector<uint32_t> block_indices_;
+  std::vector<uint32_t> idoms_;
+  std::vector<std::vector<uint32_t>> dominator_children_;
+  std::vector<Clobbers> block_clobbers_;
+  std::vector<uint32_t> visit_stamps_;
+  uint32_t visit_stamp_ = 0;
+
+  uint32_t next_value_number_ = 1;
+  std::vector<uint32_t> value_numbers_;
+  // By type and the bits of the constant.
+  std::map<std::tuple<uint8_t, uint64_t, uint64_t>, uint32_t>
+      constant_value_numbers_;
+  std::vector<hir::Value*> block_values_;
+  std::vector<uint32_t> block_value_stamps_;
+  uint32_t block_stamp_ = 0;
+
+  std::unordered_map<ExpressionKey, Expression, ExpressionKeyHash>
+      expressions_;
+  std::vector<ExpressionKey> expression_log_;
+  std::map<uint32_t, ContextEntry> context_;
+  std::vector<ContextUndo> context_log_;
+  uint32_t next_epoch_ = 1;
+  uint32_t memory_epoch_ = 0;
+  uint32_t rounding_epoch_ = 0;
+
+  uint32_t local_count_ = 0;
+  uint32_t replaced_in_block_count_ = 0;
+  uint32_t replaced_across_blocks_count_ = 0;
+};
+
+}  // namespace passes
+}  // namespace compiler
+}  // namespace cpu
+}  // namespace xe
+
+#endif  // XENIA_CPU_COMPILER_PASSES_GLOBAL_VALUE_NUMBERING_PASS_H_
@@ -0,0 +1,93 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2020 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include "xenia/cpu/compiler/passes/safepoint_pass.h"
+
+#include <unordered_set>
+
+#include "xenia/base/profiling.h"
+#include "xenia/cpu/compiler/compiler.h"
+
+namespace xe {
+namespace cpu {
+namespace compiler {
+namespace passes {
+
+// TODO(benvanik): remove when enums redefined.
+using namespace xe::cpu::hir;
+
+using xe::cpu::hir::Block;
+using xe::cpu::hir::HIRBuilder;
+using xe::cpu::hir::Instr;
+using xe::cpu::hir::Label;
+
+namespace {
+
+Label* GetBranchTarget(const Instr* i) {
+  if (i->opcode == &OPCODE_BRANCH_info) {
+    return i->src1.label;
+  }
+  if (i->opcode == &OPCODE_BRANCH_TRUE_info ||
+      i->opcode == &OPCODE_BRANCH_FALSE_info) {
+    return i->src2.label;
+  }
+  return nullptr;
+}
+
+void InsertSafepoint(HIRBuilder* builder, Block* block) {
+  // An empty block falls through to the next, which polls just as well.
+  while (block && !block->instr_head) {
+    block = block->next;
+  }
+  if (!block || block->instr_head->opcode == &OPCODE_SAFEPOINT_info) {
+    return;
+  }
+  builder->Safepoint();
+  builder->last_instr()->MoveBefore(block->instr_head);
+}
+
+}  // namespace
+
+SafepointPass::SafepointPass() : CompilerPass() {}
+
+SafepointPass::~SafepointPass() {}
+
+bool SafepointPass::Run(HIRBuilder* builder) {
+  SCOPE_profile_cpu_f("cpu");
+
+  // Branches to a block at or before their own are the back edges of loops.
+  std::unordered_set<Block*> visited;
+  std::unordered_set<Block*> loop_heads;
+  for (auto block = builder->first_block(); block; block = block->next) {
+    visited.insert(block);
+    for (auto i = block->instr_head; i; i = i->next) {
+      Label* target = GetBranchTarget(i);
+      if (target && visited.count(target->block)) {
+        loop_heads.insert(target->block);
+      }
+    }
+  }
+
+  auto first_block = builder->first_block();
+  if (first_block) {
+    InsertSafepoint(builder, first_block);
+  }
+  for (Block* block : loop_heads) {
+    if (block != first_block) {
+      InsertSafepoint(builder, block);
+    }
+  }
+
+  return true;
+}
+
+}  // namespace passes
+}  // namespace compiler
+}  // namespace cpu
+}  // namespace xe
@@ -0,0 +1,37 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2020 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#ifndef XENIA_CPU_COMPILER_PASSES_SAFEPOINT_PASS_H_
+#define XENIA_CPU_COMPILER_PASSES_SAFEPOINT_PASS_H_
+
+#include "xenia/cpu/compiler/compiler_pass.h"
+
+namespace xe {
+namespace cpu {
+namespace compiler {
+namespace passes {
+
+// Adds a SAFEPOINT at the function entry and at the head of every block a
+// branch goes back to, so a thread running guest code gets to its queued user
+// callbacks and suspension requests within a loop iteration or call.
+// Must run before blocks are merged, while they're still in guest order.
+class SafepointPass : public CompilerPass {
+ public:
+  SafepointPass();
+  ~SafepointPass() override;
+
+  bool Run(hir::HIRBuilder* builder) override;
+};
+
+}  // namespace passes
+}  // namespace compiler
+}  // namespace cpu
+}  // namespace xe
+
+#endif  // XENIA_CPU_COMPILER_PASSES_SAFEPOINT_PASS_H_
@@ -0,0 +1,589 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2020 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include "xenia/cpu/compiler/passes/stack_promotion_pass.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <tuple>
+
+#include "xenia/base/profiling.h"
+#include "xenia/cpu/ppc/ppc_context.h"
+
+namespace xe {
+namespace cpu {
+namespace compiler {
+namespace passes {
+
+// TODO(benvanik): remove when enums redefined.
+using namespace xe::cpu::hir;
+
+using xe::cpu::hir::Block;
+using xe::cpu::hir::Edge;
+using xe::cpu::hir::HIRBuilder;
+using xe::cpu::hir::Instr;
+using xe::cpu::hir::Value;
+
+namespace {
+
+const size_t kGPROffset = offsetof(ppc::PPCContext, r);
+const uint32_t kStackPointerRegister = 1;
+
+// Returns the register number if the context offset is within a GPR.
+bool GetGPR(size_t offset, uint32_t& reg) {
+  if (offset < kGPROffset || offset >= kGPROffset + 32 * 8) {
+    return false;
+  }
+  reg = uint32_t((offset - kGPROffset) / 8);
+  return true;
+}
+
+// Not preserved across calls.
+bool IsVolatileGPR(uint32_t reg) { return reg == 0 || (reg >= 2 && reg <= 12); }
+
+bool IsCall(const Instr* i) {
+  return i->opcode == &OPCODE_CALL_info ||
+         i->opcode == &OPCODE_CALL_TRUE_info ||
+         i->opcode == &OPCODE_CALL_INDIRECT_info ||
+         i->opcode == &OPCODE_CALL_INDIRECT_TRUE_info ||
+         i->opcode == &OPCODE_CALL_EXTERN_info;
+}
+
+// Code that may look at the frame in memory.
+bool IsObserver(const Instr* i) {
+  return IsCall(i) || i->opcode == &OPCODE_TRAP_info ||
+         i->opcode == &OPCODE_TRAP_TRUE_info ||
+         i->opcode == &OPCODE_DEBUG_BREAK_info ||
+         i->opcode == &OPCODE_DEBUG_BREAK_TRUE_info;
+}
+
+bool IsPromotableType(TypeName type) {
+  // The types the frontend loads and stores memory as, with byte swapping.
+  return type == INT8_TYPE || type == INT16_TYPE || type == INT32_TYPE ||
+         type == INT64_TYPE || type == VEC128_TYPE;
+}
+
+bool GetConstantOffset(const Value* value, int64_t& offset) {
+  if (!value->IsConstant()) {
+    return false;
+  }
+  if (value->type == INT64_TYPE) {
+    offset = value->constant.i64;
+  } else if (value->type == INT32_TYPE) {
+    offset = value->constant.i32;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+}  // namespace
+
+const uint32_t StackPromotionPass::kNoSlot;
+
+StackPromotionPass::Pointer StackPromotionPass::Pointer::Join(
+    const Pointer& a, const Pointer& b) {
+  if (a.kind == kUnvisited) {
+    return b;
+  }
+  if (b.kind == kUnvisited || a == b) {
+    return a;
+  }
+  return {kUnknown, 0};
+}
+
+StackPromotionPass::StackPromotionPass() : CompilerPass() {}
+
+StackPromotionPass::~StackPromotionPass() {}
+
+bool StackPromotionPass::Run(HIRBuilder* builder) {
+  SCOPE_profile_cpu_f("cpu");
+
+  uint16_t block_ordinal = 0;
+  auto block = builder->first_block();
+  while (block) {
+    block->ordinal = block_ordinal++;
+    block = block->next;
+  }
+  if (!block_ordinal) {
+    return true;
+  }
+
+  // Forward analysis of which registers hold stack pointers, until nothing
+  // changes.
+  RegisterPointers unvisited;
+  unvisited.fill({Pointer::kUnvisited, 0});
+  block_registers_out_.assign(block_ordinal, unvisited);
+  value_pointers_.assign(builder->max_value_ordinal(),
+                         {Pointer::kNotStack, 0});
+  bool changed;
+  do {
+    changed = false;
+    block = builder->first_block();
+    while (block) {
+      RegisterPointers registers = GetIncomingRegisters(block);
+      AnalyzeBlock(block, registers, false);
+      if (registers != block_registers_out_[block->ordinal]) {
+        block_registers_out_[block->ordinal] = registers;
+        changed = true;
+      }
+      block = block->next;
+    }
+  } while (changed);
+
+  block_accesses_.resize(block_ordinal);
+  for (auto& accesses : block_accesses_) {
+    accesses.clear();
+  }
+  block = builder->first_block();
+  while (block) {
+    RegisterPointers registers = GetIncomingRegisters(block);
+    if (!AnalyzeBlock(block, registers, true)) {
+      // The frame may be accessed in ways that aren't followed.
+      return true;
+    }
+    block = block->next;
+  }
+
+  if (!BuildSlots()) {
+    return true;
+  }
+  PromoteLoads(builder->first_block());
+  FindNeededStores(builder->first_block());
+  Rewrite(builder, builder->first_block());
+
+  return true;
+}
+
+StackPromotionPass::RegisterPointers StackPromotionPass::GetIncomingRegisters(
+    Block* block) {
+  RegisterPointers registers;
+  registers.fill({Pointer::kUnvisited, 0});
+  if (!block->prev) {
+    registers.fill({Pointer::kNotStack, 0});
+    registers[kStackPointerRegister] = {Pointer::kStack, 0};
+  }
+  auto edge = block->incoming_edge_head;
+  while (edge) {
+    const RegisterPointers& incoming =
+        block_registers_out_[edge->src->ordinal];
+    for (size_t n = 0; n < registers.size(); ++n) {
+      registers[n] = Pointer::Join(registers[n], incoming[n]);
+    }
+    edge = edge->incoming_next;
+  }
+  return registers;
+}
+
+StackPromotionPass::Pointer StackPromotionPass::GetPointer(Value* value) const {
+  if (value->IsConstant() || value->ordinal >= value_pointers_.size()) {
+    return {Pointer::kNotStack, 0};
+  }
+  return value_pointers_[value->ordinal];
+}
+
+void StackPromotionPass::SetPointer(Value* value, const Pointer& pointer) {
+  value_pointers_[value->ordinal] = pointer;
+}
+
+bool StackPromotionPass::AnalyzeBlock(Block* block,
+                                      RegisterPointers& registers,
+                                      bool collect) {
+  auto i = block->instr_head;
+  while (i) {
+    const OpcodeInfo* opcode = i->opcode;
+    uint32_t reg;
+    if (opcode == &OPCODE_LOAD_CONTEXT_info) {
+      if (GetGPR(i->src1.offset, reg)) {
+        if (i->dest->type == INT64_TYPE &&
+            !((i->src1.offset - kGPROffset) & 7)) {
+          SetPointer(i->dest, registers[reg]);
+          i = i->next;
+          continue;
+        }
+        if (registers[reg].IsFrame()) {
+          return false;
+        }
+      }
+      SetPointer(i->dest, {Pointer::kNotStack, 0});
+    } else if (opcode == &OPCODE_STORE_CONTEXT_info) {
+      Pointer pointer = GetPointer(i->src2.value);
+      if (GetGPR(i->src1.offset, reg)) {
+        if (i->src2.value->type == INT64_TYPE &&
+            !((i->src1.offset - kGPROffset) & 7)) {
+          if (reg == kStackPointerRegister &&
+              (pointer.kind == Pointer::kNotStack ||
+               pointer.kind == Pointer::kUnknown)) {
+            // Restored from memory or computed - can't be followed anymore.
+            return false;
+          }
+          registers[reg] = pointer;
+          i = i->next;
+          continue;
+        }
+        if (reg == kStackPointerRegister || registers[reg].IsFrame()) {
+          return false;
+        }
+        registers[reg] = {Pointer::kNotStack, 0};
+      }
+      if (pointer.IsFrame()) {
+        return false;
+      }
+    } else if (opcode == &OPCODE_LOAD_info ||
+               opcode == &OPCODE_LOAD_OFFSET_info) {
+      if (!AddAccess(
+              block, i, GetPointer(i->src1.value),
+              opcode == &OPCODE_LOAD_OFFSET_info ? i->src2.value : nullptr,
+              false, collect)) {
+        return false;
+      }
+      SetPointer(i->dest, {Pointer::kNotStack, 0});
+    } else if (opcode == &OPCODE_STORE_info ||
+               opcode == &OPCODE_STORE_OFFSET_info) {
+      bool offset = opcode == &OPCODE_STORE_OFFSET_info;
+      if (GetPointer(offset ? i->src3.value : i->src2.value).IsFrame() ||
+          !AddAccess(block, i, GetPointer(i->src1.value),
+                     offset ? i->src2.value : nullptr, true, collect)) {
+        return false;
+      }
+    } else {
+      Pointer result = {Pointer::kNotStack, 0};
+      bool followed = false;
+      if (opcode == &OPCODE_ASSIGN_info) {
+        result = GetPointer(i->src1.value);
+        followed = true;
+      } else if (opcode == &OPCODE_TRUNCATE_info ||
+                 opcode == &OPCODE_ZERO_EXTEND_info) {
+        // Guest addresses are 32-bit.
+        if ((i->dest->type == INT32_TYPE || i->dest->type == INT64_TYPE) &&
+            (i->src1.value->type == INT32_TYPE ||
+             i->src1.value->type == INT64_TYPE)) {
+          result = GetPointer(i->src1.value);
+          followed = true;
+        }
+      } else if (opcode == &OPCODE_ADD_info ||
+                 opcode == &OPCODE_SUB_info) {
+        Pointer base = GetPointer(i->src1.value);
+        Value* other = i->src2.value;
+        if (opcode == &OPCODE_ADD_info && base.kind != Pointer::kStack) {
+          base = GetPointer(i->src2.value);
+          other = i->src1.value;
+        }
+        int64_t constant;
+        if (base.kind == Pointer::kStack &&
+            GetConstantOffset(other, constant)) {
+          result = {Pointer::kStack, opcode == &OPCODE_ADD_info
+                                         ? base.offset + constant
+                                         : base.offset - constant};
+          followed = true;
+        }
+      }
+      if (!followed) {
+        uint32_t signature = opcode->signature;
+        if ((GET_OPCODE_SIG_TYPE_SRC1(signature) == OPCODE_SIG_TYPE_V &&
+             GetPointer(i->src1.value).IsFrame()) ||
+            (GET_OPCODE_SIG_TYPE_SRC2(signature) == OPCODE_SIG_TYPE_V &&
+             GetPointer(i->src2.value).IsFrame()) ||
+            (GET_OPCODE_SIG_TYPE_SRC3(signature) == OPCODE_SIG_TYPE_V &&
+             GetPointer(i->src3.value).IsFrame())) {
+          // Used for something other than an address.
+          return false;
+        }
+      }
+      if (IsCall(i)) {
+        for (uint32_t n = 0; n < registers.size(); ++n) {
+          if (!IsVolatileGPR(n)) {
+            continue;
+          }
+          if (registers[n].IsFrame()) {
+            // May be an argument.
+            return false;
+          }
+          if (opcode == &OPCODE_CALL_info ||
+              opcode == &OPCODE_CALL_INDIRECT_info ||
+              opcode == &OPCODE_CALL_EXTERN_info) {
+            registers[n] = {Pointer::kNotStack, 0};
+          } else {
+            registers[n] =
+                Pointer::Join(registers[n], {Pointer::kNotStack, 0});
+          }
+        }
+      }
+      if (i->dest) {
+        SetPointer(i->dest, result);
+      }
+    }
+    i = i->next;
+  }
+  return true;
+}
+
+bool StackPromotionPass::AddAccess(Block* block, Instr* i, const Pointer& base,
+                                   Value* offset, bool store, bool collect) {
+  if (base.kind == Pointer::kUnknown) {
+    return false;
+  }
+  if (base.kind != Pointer::kStack) {
+    // Not the stack (or not reached yet).
+    return true;
+  }
+  int64_t address = base.offset;
+  if (offset) {
+    int64_t constant;
+    if (!GetConstantOffset(offset, constant)) {
+      return false;
+    }
+    address += constant;
+  }
+  if (collect) {
+    Access access;
+    access.instr = i;
+    access.offset = address;
+    access.type = store ? (offset ? i->src3.value->type : i->src2.value->type)
+                        : i->dest->type;
+    access.store = store;
+    access.slot = kNoSlot;
+    access.promoted_load = false;
+    access.memory_needed = true;
+    block_accesses_[block->ordinal].push_back(access);
+  }
+  return true;
+}
+
+bool StackPromotionPass::BuildSlots() {
+  // Group identical accesses. Slots overlapping anything other than
+  // themselves, or not entirely in the frame, aren't promoted.
+  std::vector<Access*> accesses;
+  for (auto& block_accesses : block_accesses_) {
+    for (auto& access : block_accesses) {
+      accesses.push_back(&access);
+    }
+  }
+  auto key = [](const Access* access) {
+    return std::make_tuple(access->offset, GetTypeSize(access->type),
+                           access->type);
+  };
+  std::sort(accesses.begin(), accesses.end(),
+            [&](const Access* a, const Access* b) { return key(a) < key(b); });
+  slots_.clear();
+  for (size_t n = 0; n < accesses.size(); ++n) {
+    Access* access = accesses[n];
+    if (!n || key(access) != key(accesses[n - 1])) {
+      Slot slot;
+      slot.offset = access->offset;
+      slot.type = access->type;
+      slot.promotable =
+          access->offset + int64_t(GetTypeSize(access->type)) <= 0 &&
+          IsPromotableType(access->type);
+      slot.local = nullptr;
+      slots_.push_back(slot);
+    }
+    if (access->instr->flags) {
+      slots_.back().promotable = false;
+    }
+    access->slot = uint32_t(slots_.size() - 1);
+  }
+  for (size_t n = 0; n < slots_.size(); ++n) {
+    int64_t end = slots_[n].offset + int64_t(GetTypeSize(slots_[n].type));
+    for (size_t m = n + 1; m < slots_.size() && slots_[m].offset < end; ++m) {
+      slots_[n].promotable = false;
+      slots_[m].promotable = false;
+    }
+  }
+
+  // Renumber, leaving only the promotable slots.
+  std::vector<uint32_t> remap(slots_.size(), kNoSlot);
+  uint32_t slot_count = 0;
+  for (size_t n = 0; n < slots_.size(); ++n) {
+    if (slots_[n].promotable) {
+      remap[n] = slot_count;
+      slots_[slot_count++] = slots_[n];
+    }
+  }
+  slots_.resize(slot_count);
+  for (Access* access : accesses) {
+    access->slot = remap[access->slot];
+  }
+  slot_words_ = (slot_count + 63) / 64;
+  return slot_count != 0;
+}
+
+void StackPromotionPass::PromoteLoads(Block* first_block) {
+  // Forward must-analysis of the slots holding a value stored in this
+  // function, which is also in the local, since the last call.
+  size_t block_count = block_accesses_.size();
+  available_out_.assign(block_count * slot_words_, UINT64_MAX);
+  std::vector<uint64_t> available(slot_words_);
+  auto ProcessBlock = [&](Block* block, bool promote) {
+    if (!block->prev || !block->incoming_edge_head) {
+      std::fill(available.begin(), available.end(), 0);
+    } else {
+      std::fill(available.begin(), available.end(), UINT64_MAX);
+      auto edge = block->incoming_edge_head;
+      while (edge) {
+        const uint64_t* incoming =
+            &available_out_[edge->src->ordinal * slot_words_];
+        for (size_t n = 0; n < slot_words_; ++n) {
+          available[n] &= incoming[n];
+        }
+        edge = edge->incoming_next;
+      }
+    }
+    auto& accesses = block_accesses_[block->ordinal];
+    auto access = accesses.begin();
+    for (auto i = block->instr_head; i; i = i->next) {
+      if (IsObserver(i)) {
+        std::fill(available.begin(), available.end(), 0);
+        continue;
+      }
+      if (access == accesses.end() || access->instr != i) {
+        continue;
+      }
+      uint32_t slot = access->slot;
+      if (slot != kNoSlot) {
+        uint64_t bit = uint64_t(1) << (slot & 63);
+        if (access->store) {
+          available[slot >> 6] |= bit;
+        } else if (promote) {
+          access->promoted_load = (available[slot >> 6] & bit) != 0;
+        }
+      }
+      ++access;
+    }
+    uint64_t* out = &available_out_[block->ordinal * slot_words_];
+    if (!std::equal(available.begin(), available.end(), out)) {
+      std::copy(available.begin(), available.end(), out);
+      return true;
+    }
+    return false;
+  };
+  bool changed;
+  do {
+    changed = false;
+    for (auto block = first_block; block; block = block->next) {
+      changed |= ProcessBlock(block, false);
+    }
+  } while (changed);
+  for (auto block = first_block; block; block = block->next) {
+    ProcessBlock(block, true);
+  }
+}
+
+void StackPromotionPass::FindNeededStores(Block* first_block) {
+  // Backward may-analysis of the slots whose memory may be read before being
+  // stored again, by a call or a load that's not promoted. The frame is gone
+  // after returning.
+  Block* last_block = first_block;
+  while (last_block->next) {
+    last_block = last_block->next;
+  }
+  size_t block_count = block_accesses_.size();
+  memory_live_in_.assign(block_count * slot_words_, 0);
+  std::vector<uint64_t> live(slot_words_);
+  auto ProcessBlock = [&](Block* block, bool record) {
+    std::fill(live.begin(), live.end(), 0);
+    auto edge = block->outgoing_edge_head;
+    while (edge) {
+      const uint64_t* outgoing =
+          &memory_live_in_[edge->dest->ordinal * slot_words_];
+      for (size_t n = 0; n < slot_words_; ++n) {
+        live[n] |= outgoing[n];
+      }
+      edge = edge->outgoing_next;
+    }
+    auto& accesses = block_accesses_[block->ordinal];
+    auto access = accesses.rbegin();
+    for (auto i = block->instr_tail; i; i = i->prev) {
+      if (IsObserver(i)) {
+        std::fill(live.begin(), live.end(), UINT64_MAX);
+        continue;
+      }
+      if (access == accesses.rend() || access->instr != i) {
+        continue;
+      }
+      uint32_t slot = access->slot;
+      if (slot != kNoSlot) {
+        uint64_t bit = uint64_t(1) << (slot & 63);
+        if (access->store) {
+          if (record) {
+            access->memory_needed = (live[slot >> 6] & bit) != 0;
+          }
+          live[slot >> 6] &= ~bit;
+        } else if (!access->promoted_load) {
+          live[slot >> 6] |= bit;
+        }
+      }
+      ++access;
+    }
+    uint64_t* in = &memory_live_in_[block->ordinal * slot_words_];
+    if (!std::equal(live.begin(), live.end(), in)) {
+      std::copy(live.begin(), live.end(), in);
+      return true;
+    }
+    return false;
+  };
+  bool changed;
+  do {
+    changed = false;
+    for (auto block = last_block; block; block = block->prev) {
+      changed |= ProcessBlock(block, false);
+    }
+  } while (changed);
+  for (auto block = last_block; block; block = block->prev) {
+    ProcessBlock(block, true);
+  }
+}
+
+void StackPromotionPass::Rewrite(HIRBuilder* builder, Block* first_block) {
+  // The locals hold the values byte swapped back, so the swaps done by the
+  // guest cancel out in simplification.
+  for (auto& accesses : block_accesses_) {
+    for (auto& access : accesses) {
+      if (access.promoted_load && !slots_[access.slot].local) {
+        slots_[access.slot].local = builder->AllocLocal(access.type);
+      }
+    }
+  }
+  for (auto block = first_block; block; block = block->next) {
+    for (auto& access : block_accesses_[block->ordinal]) {
+      if (access.slot == kNoSlot) {
+        continue;
+      }
+      Instr* i = access.instr;
+      Value* local = slots_[access.slot].local;
+      bool swapped = access.type != INT8_TYPE;
+      if (access.store) {
+        if (local) {
+          Value* value = i->opcode == &OPCODE_STORE_OFFSET_info
+                             ? i->src3.value
+                             : i->src2.value;
+          if (swapped) {
+            value = builder->ByteSwap(value);
+            builder->last_instr()->MoveBefore(i);
+          }
+          builder->StoreLocal(local, value);
+          builder->last_instr()->MoveBefore(i);
+        }
+        if (!access.memory_needed) {
+          i->Remove();
+        }
+      } else if (access.promoted_load) {
+        Value* value = builder->LoadLocal(local);
+        builder->last_instr()->MoveBefore(i);
+        i->Replace(swapped ? &OPCODE_BYTE_SWAP_info : &OPCODE_ASSIGN_info, 0);
+        i->set_src1(value);
+      }
+    }
+  }
+}
+
+}  // namespace passes
+}  // namespace compiler
+}  // namespace cpu
+}  // namespace xe
@@ -0,0 +1,127 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2020 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#ifndef XENIA_CPU_COMPILER_PASSES_STACK_PROMOTION_PASS_H_
+#define XENIA_CPU_COMPILER_PASSES_STACK_PROMOTION_PASS_H_
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "xenia/cpu/compiler/compiler_pass.h"
+
+namespace xe {
+namespace cpu {
+namespace compiler {
+namespace passes {
+
+// Keeps guest stack slots of the function in host locals instead of guest
+// memory, removing the byte swapped loads and stores of spills and locals.
+//
+// Addresses are followed from r1 through the guest registers, additions of
+// constants and context promotion. The function is left alone if an address
+// below r1 on entry may escape - it's passed in an argument register, stored
+// to memory or used in anything other than a load or store address - or if r1
+// can't be followed. Only slots always accessed with the same size and type
+// are promoted.
+//
+// Callees may look at the frame of the caller (the parameter area, or back
+// chain walks), so memory has the same contents as without the pass whenever a
+// call, trap or a load that's not promoted may see it. Loads are only promoted
+// where a store to the slot reaches them on every path with no call between.
+// Requires the CFG from ControlFlowAnalysisPass.
+class StackPromotionPass : public CompilerPass {
+ public:
+  StackPromotionPass();
+  ~StackPromotionPass() override;
+
+  bool Run(hir::HIRBuilder* builder) override;
+
+ private:
+  // Whether a value or a guest register may point into the stack, at an offset
+  // from r1 on entry.
+  struct Pointer {
+    enum Kind : uint8_t {
+      kUnvisited,
+      kNotStack,
+      kStack,
+      // A stack pointer on some paths, and not or to elsewhere on others.
+      kUnknown,
+    };
+    Kind kind;
+    int64_t offset;
+
+    bool operator==(const Pointer& other) const {
+      return kind == other.kind && (kind != kStack || offset == other.offset);
+    }
+    bool operator!=(const Pointer& other) const { return !(*this == other); }
+    // May point to bytes below r1 on entry, which belong to this function.
+    bool IsFrame() const {
+      return kind == kUnknown || (kind == kStack && offset < 0);
+    }
+    static Pointer Join(const Pointer& a, const Pointer& b);
+  };
+  using RegisterPointers = std::array<Pointer, 32>;
+
+  struct Access {
+    hir::Instr* instr;
+    int64_t offset;
+    hir::TypeName type;
+    bool store;
+    uint32_t slot;
+    // For loads, whether the value is taken from the local. For stores,
+    // whether memory must still be written.
+    bool promoted_load;
+    bool memory_needed;
+  };
+  struct Slot {
+    int64_t offset;
+    hir::TypeName type;
+    bool promotable;
+    hir::Value* local;
+  };
+  static const uint32_t kNoSlot = UINT32_MAX;
+
+  // Follows stack pointers through the block, recording accesses if collect is
+  // set. Returns false if the frame may be accessed in a way not followed.
+  bool AnalyzeBlock(hir::Block* block, RegisterPointers& registers,
+                    bool collect);
+  RegisterPointers GetIncomingRegisters(hir::Block* block);
+  Pointer GetPointer(hir::Value* value) const;
+  void SetPointer(hir::Value* value, const Pointer& pointer);
+  bool AddAccess(hir::Block* block, hir::Instr* i, const Pointer& base,
+                 hir::Value* offset, bool store, bool collect);
+
+  // Groups accesses into slots, and returns whether any can be promoted.
+  bool BuildSlots();
+  // Finds loads reached by a store to their slot on every path, with no call
+  // in between.
+  void PromoteLoads(hir::Block* first_block);
+  // Finds stores whose value may be seen in memory.
+  void FindNeededStores(hir::Block* first_block);
+  void Rewrite(hir::HIRBuilder* builder, hir::Block* first_block);
+
+  // By block ordinal.
+  std::vector<RegisterPointers> block_registers_out_;
+  std::vector<std::vector<Access>> block_accesses_;
+  // Slot bits, slot_words_ words for each block, by ordinal.
+  std::vector<uint64_t> available_out_;
+  std::vector<uint64_t> memory_live_in_;
+  size_t slot_words_ = 0;
+
+  std::vector<Pointer> value_pointers_;
+  std::vector<Slot> slots_;
+};
+
+}  // namespace passes
+}  // namespace compiler
+}  // namespace cpu
+}  // namespace xe
+
+#endif  // XENIA_CPU_COMPILER_PASSES_STACK_PROMOTION_PASS_H_
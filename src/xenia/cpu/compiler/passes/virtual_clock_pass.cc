@@ -0,0 +1,70 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2020 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include "xenia/cpu/compiler/passes/virtual_clock_pass.h"
+
+#include <cstddef>
+
+#include "xenia/base/profiling.h"
+#include "xenia/cpu/compiler/compiler.h"
+#include "xenia/cpu/ppc/ppc_context.h"
+
+namespace xe {
+namespace cpu {
+namespace compiler {
+namespace passes {
+
+// TODO(benvanik): remove when enums redefined.
+using namespace xe::cpu::hir;
+
+using xe::cpu::hir::Block;
+using xe::cpu::hir::HIRBuilder;
+using xe::cpu::hir::Instr;
+using xe::cpu::hir::Value;
+
+static const size_t kCounterOffset =
+    offsetof(ppc::PPCContext, virtual_clock_instructions);
+
+VirtualClockPass::VirtualClockPass() : CompilerPass() {}
+
+VirtualClockPass::~VirtualClockPass() {}
+
+bool VirtualClockPass::Run(HIRBuilder* builder) {
+  SCOPE_profile_cpu_f("cpu");
+
+  auto block = builder->first_block();
+  while (block) {
+    uint64_t instruction_count = 0;
+    for (auto i = block->instr_head; i; i = i->next) {
+      if (i->opcode == &OPCODE_SOURCE_OFFSET_info) {
+        ++instruction_count;
+      }
+    }
+    if (instruction_count) {
+      // Instructions after a call in the block are counted before they run,
+      // which only matters if the call never returns.
+      Instr* head = block->instr_head;
+      Value* count = builder->LoadContext(kCounterOffset, INT64_TYPE);
+      builder->last_instr()->MoveBefore(head);
+      count =
+          builder->Add(count, builder->LoadConstantUint64(instruction_count));
+      builder->last_instr()->MoveBefore(head);
+      builder->StoreContext(kCounterOffset, count);
+      builder->last_instr()->MoveBefore(head);
+    }
+    block = block->next;
+  }
+
+  return true;
+}
+
+}  // namespace passes
+}  // namespace compiler
+}  // namespace cpu
+}  // namespace xe
@@ -0,0 +1,38 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2020 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#ifndef XENIA_CPU_COMPILER_PASSES_VIRTUAL_CLOCK_PASS_H_
+#define XENIA_CPU_COMPILER_PASSES_VIRTUAL_CLOCK_PASS_H_
+
+#include "xenia/cpu/compiler/compiler_pass.h"
+
+namespace xe {
+namespace cpu {
+namespace compiler {
+namespace passes {
+
+// Counts the guest instructions executed, for the virtual guest clock. Each
+// block adds how many guest instructions (SOURCE_OFFSETs) it holds to
+// PPCContext::virtual_clock_instructions on entry, which is added to the clock
+// whenever the guest reads it or calls into the kernel.
+// Must run before anything removes or moves SOURCE_OFFSETs.
+class VirtualClockPass : public CompilerPass {
+ public:
+  VirtualClockPass();
+  ~VirtualClockPass() override;
+
+  bool Run(hir::HIRBuilder* builder) override;
+};
+
+}  // namespace passes
+}  // namespace compiler
+}  // namespace cpu
+}  // namespace xe
+
+#endif  // XENIA_CPU_COMPILER_PASSES_VIRTUAL_CLOCK_PASS_H_
@@ -34,10 +34,59 @@ DEFINE_bool(
     disable_global_lock, false,
     "Disables global lock usage in guest code. Does not affect host code.",
     "CPU");
+DEFINE_bool(use_reservation_table, true,
+            "Track lwarx/stwcx. reservations per 128-byte granule, so guest "
+            "code disabling interrupts with mtmsr only affects its own thread "
+            "instead of taking the global lock.",
+            "CPU");
+
+DEFINE_bool(invalidate_code_on_icbi, true,
+            "Recompile functions whose guest code is flushed from the "
+            "instruction cache with icbi, for code patched at runtime.",
+            "CPU");
 
 DEFINE_bool(validate_hir, false,
             "Perform validation checks on the HIR during compilation.", "CPU");
 
+DEFINE_bool(lazy_fpscr_updates, true,
+            "Merge the FPSCR updates of FPU instructions and only write FPSCR "
+            "where guest code can observe it.",
+            "CPU");
+DEFINE_bool(inline_save_restore_helpers, true,
+            "Expand calls to the __savegprlr_*/__restgprlr_*, FPR and VMX "
+            "save/restore helpers inline instead of calling them.",
+            "CPU");
+DEFINE_bool(bind_import_thunks, true,
+            "Call kernel exports and the exports of other modules directly "
+            "where guest code calls their import thunks.",
+            "CPU");
+DEFINE_bool(recognize_idioms, true,
+            "Recognize common multi-instruction PPC sequences, such as CR bit "
+            "extraction, and translate them to less HIR.",
+            "CPU");
+DEFINE_bool(global_value_numbering, false,
+            "Reuse computations and loads done in dominating blocks of a "
+            "function instead of repeating them.",
+            "CPU");
+DEFINE_bool(promote_stack_slots, false,
+            "Keep guest stack slots whose address never leaves the function in "
+            "host locals instead of guest memory.",
+            "CPU");
+DEFINE_bool(safepoints, true,
+            "Poll for user callbacks and suspension at guest function entries "
+            "and loop back-edges. Needed for APCs and thread suspension where "
+            "the host can't interrupt running threads (not Windows).",
+            "CPU");
+DEFINE_int32(interpreter_call_threshold, 0,
+             "Interpret guest functions for this many calls before compiling "
+             "them, so code run only a few times isn't compiled. 0 (default) "
+             "compiles every function on its first call.",
+             "CPU");
+DEFINE_int32(interpreter_loop_threshold, 1000,
+             "Compile an interpreted function once a call of it has taken "
+             "this many loop back-edges.",
+             "CPU");
+
 // Breakpoints:
 DEFINE_int64(break_on_instruction, 0,
              "int3 before the given guest address is executed.", "CPU");
@@ -23,9 +23,22 @@ DECLARE_bool(trace_function_references);
 DECLARE_bool(trace_function_data);
 
 DECLARE_bool(disable_global_lock);
+DECLARE_bool(use_reservation_table);
+
+DECLARE_bool(invalidate_code_on_icbi);
 
 DECLARE_bool(validate_hir);
 
+DECLARE_bool(lazy_fpscr_updates);
+DECLARE_bool(inline_save_restore_helpers);
+DECLARE_bool(bind_import_thunks);
+DECLARE_bool(recognize_idioms);
+DECLARE_bool(global_value_numbering);
+DECLARE_bool(promote_stack_slots);
+DECLARE_bool(safepoints);
+DECLARE_int32(interpreter_call_threshold);
+DECLARE_int32(interpreter_loop_threshold);
+
 DECLARE_int64(break_on_instruction);
 DECLARE_int32(break_condition_gpr);
 DECLARE_int64(break_condition_value);
@@ -9,8 +9,11 @@
 
 #include "xenia/cpu/entry_table.h"
 
+#include <algorithm>
+
 #include "xenia/base/profiling.h"
 #include "xenia/base/threading.h"
+#include "xenia/cpu/function.h"
 
 namespace xe {
 namespace cpu {
@@ -73,6 +76,17 @@ Entry::Status EntryTable::GetOrCreate(uint32_t address, Entry** out_entry) {
   return status;
 }
 
+void EntryTable::SetReady(Entry* entry, Function* function) {
+  auto global_lock = global_critical_region_.Acquire();
+  entry->function = function;
+  entry->end_address = function->end_address();
+  if (entry->end_address > entry->address) {
+    max_function_length_ =
+        std::max(max_function_length_, entry->end_address - entry->address);
+  }
+  entry->status = Entry::STATUS_READY;
+}
+
 std::vector<Function*> EntryTable::FindWithAddress(uint32_t address) {
   auto global_lock = global_critical_region_.Acquire();
   std::vector<Function*> fns;
@@ -87,5 +101,45 @@ std::vector<Function*> EntryTable::FindWithAddress(uint32_t address) {
   return fns;
 }
 
+std::vector<Function*> EntryTable::RemoveInRange(uint32_t low_address,
+                                                uint32_t high_address) {
+  auto global_lock = global_critical_region_.Acquire();
+  std::vector<Function*> fns;
+  // Nothing starting further below can reach into the range.
+  uint32_t start_address = low_address > max_function_length_
+                               ? low_address - max_function_length_
+                               : 0;
+  auto it = map_.lower_bound(start_address);
+  while (it != map_.end() && it->first < high_address) {
+    Entry* entry = it->second;
+    if (entry->status == Entry::STATUS_READY &&
+        entry->end_address >= low_address) {
+      fns.push_back(entry->function);
+      Remove(it++);
+    } else {
+      ++it;
+    }
+  }
+  return fns;
+}
+
+void EntryTable::RemoveModule(Module* module) {
+  auto global_lock = global_critical_region_.Acquire();
+  auto it = map_.begin();
+  while (it != map_.end()) {
+    Entry* entry = it->second;
+    if (entry->function && entry->function->module() == module) {
+      Remove(it++);
+    } else {
+      ++it;
+    }
+  }
+}
+
+void EntryTable::Remove(std::map<uint32_t, Entry*>::iterator it) {
+  removed_entries_.emplace_back(it->second);
+  map_.erase(it);
+}
+
 }  // namespace cpu
 }  // namespace xe
@@ -10,7 +10,8 @@
 #ifndef XENIA_CPU_ENTRY_TABLE_H_
 #define XENIA_CPU_ENTRY_TABLE_H_
 
-#include <unordered_map>
+#include <map>
+#include <memory>
 #include <vector>
 
 #include "xenia/base/mutex.h"
@@ -19,6 +20,7 @@ namespace xe {
 namespace cpu {
 
 class Function;
+class Module;
 
 typedef struct Entry_t {
   typedef enum {
@@ -41,13 +43,30 @@ class EntryTable {
 
   Entry* Get(uint32_t address);
   Entry::Status GetOrCreate(uint32_t address, Entry** out_entry);
+  // Completes an entry returned as new by GetOrCreate.
+  void SetReady(Entry* entry, Function* function);
 
   std::vector<Function*> FindWithAddress(uint32_t address);
 
+  // Removes the ready entries for functions with code in [low_address,
+  // high_address) and returns their functions. Entries still compiling are
+  // left alone.
+  std::vector<Function*> RemoveInRange(uint32_t low_address,
+                                       uint32_t high_address);
+  // Removes all entries for functions of the module.
+  void RemoveModule(Module* module);
+
  private:
+  void Remove(std::map<uint32_t, Entry*>::iterator it);
+
   xe::global_critical_region global_critical_region_;
-  // TODO(benvanik): replace with a better data structure.
-  std::unordered_map<uint32_t, Entry*> map_;
+  // Ordered by address, so the entries overlapping a range can be found.
+  std::map<uint32_t, Entry*> map_;
+  // Length of the longest function ever made ready.
+  uint32_t max_function_length_ = 0;
+  // Entries are only freed with the table, as other threads may still be
+  // looking at ones they were given.
+  std::vector<std::unique_ptr<Entry>> removed_entries_;
 };
 
 }  // namespace cpu
@@ -129,8 +129,26 @@ bool GuestFunction::Call(ThreadState* thread_state, uint32_t return_address) {
     ThreadState::Bind(thread_state);
   }
 
+  // Called from host code, outside guest code or with the guest frames paused,
+  // the frames run again until the call returns. The first call into guest
+  // code starts them here.
+  bool resume_frames = thread_state->guest_frames_paused();
+  ThreadState::GuestFrames paused_frames = thread_state->guest_frames();
+  if (resume_frames) {
+    thread_state->ResumeGuestFrames();
+    if (paused_frames.high <= paused_frames.low) {
+      uint8_t stack_marker;
+      thread_state->guest_frames_.high =
+          reinterpret_cast<uintptr_t>(&stack_marker);
+    }
+  }
+
   bool result = CallImpl(thread_state, return_address);
 
+  if (resume_frames) {
+    thread_state->PauseGuestFrames(paused_frames);
+  }
+
   if (original_thread_state != thread_state) {
     ThreadState::Bind(original_thread_state);
   }
@@ -43,6 +43,22 @@ class Function : public Symbol {
     kExtern,
   };
 
+  // Compiler-generated register save/restore helpers, such as __savegprlr_14,
+  // which the frontend can expand inline at call sites.
+  enum class SaveRestore {
+    kNone,
+    // Stores rN-r31 below r1 and r12 (the caller's LR) at r1 - 8.
+    kSaveGprLr,
+    // Loads rN-r31 and LR (also to r12) from below r1 and returns to LR.
+    kRestoreGprLr,
+    // Stores/loads fN-f31 below r12.
+    kSaveFpr,
+    kRestoreFpr,
+    // Stores/loads vN-v31 or vN-v127 below r12, and sets r11 to -16.
+    kSaveVmx,
+    kRestoreVmx,
+  };
+
   ~Function() override;
 
   uint32_t address() const { return address_; }
@@ -52,6 +68,19 @@ class Function : public Symbol {
   Behavior behavior() const { return behavior_; }
   void set_behavior(Behavior value) { behavior_ = value; }
   bool is_guest() const { return behavior_ != Behavior::kBuiltin; }
+  SaveRestore save_restore() const { return save_restore_; }
+  // The first register saved or restored by a save/restore helper.
+  uint32_t save_restore_first_register() const {
+    return save_restore_first_register_;
+  }
+  void set_save_restore(SaveRestore value, uint32_t first_register) {
+    save_restore_ = value;
+    save_restore_first_register_ = first_register;
+  }
+  // For the import thunk of a function exported by another module, the
+  // address of the export, or 0.
+  uint32_t import_target() const { return import_target_; }
+  void set_import_target(uint32_t value) { import_target_ = value; }
 
   bool ContainsAddress(uint32_t address) const {
     if (!address_ || !end_address_) {
@@ -72,6 +101,9 @@ class Function : public Symbol {
 
   uint32_t end_address_ = 0;
   Behavior behavior_ = Behavior::kDefault;
+  SaveRestore save_restore_ = SaveRestore::kNone;
+  uint32_t save_restore_first_register_ = 0;
+  uint32_t import_target_ = 0;
 };
 
 class BuiltinFunction : public Function {
@@ -1215,6 +1215,11 @@ void HIRBuilder::ContextBarrier() {
   AppendInstr(OPCODE_CONTEXT_BARRIER_info, 0);
 }
 
+void HIRBuilder::Safepoint() {
+  Instr* i = AppendInstr(OPCODE_SAFEPOINT_info, 0);
+  i->src1.value = i->src2.value = i->src3.value = NULL;
+}
+
 Value* HIRBuilder::LoadMmio(cpu::MMIORange* mmio_range, uint32_t address,
                             TypeName type) {
   Instr* i = AppendInstr(OPCODE_LOAD_MMIO_info, 0, AllocValue(type));
@@ -1286,7 +1291,9 @@ void HIRBuilder::CacheControl(Value* address, size_t cache_line_size,
   i->src3.value = NULL;
 }
 
-void HIRBuilder::MemoryBarrier() { AppendInstr(OPCODE_MEMORY_BARRIER_info, 0); }
+void HIRBuilder::MemoryBarrier(uint16_t barrier_flags) {
+  AppendInstr(OPCODE_MEMORY_BARRIER_info, barrier_flags);
+}
 
 void HIRBuilder::SetRoundingMode(Value* value) {
   ASSERT_INTEGER_TYPE(value);
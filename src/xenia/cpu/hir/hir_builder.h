@@ -145,6 +145,7 @@ class HIRBuilder {
   Value* LoadContext(size_t offset, TypeName type);
   void StoreContext(size_t offset, Value* value);
   void ContextBarrier();
+  void Safepoint();
 
   Value* LoadMmio(cpu::MMIORange* mmio_range, uint32_t address, TypeName type);
   void StoreMmio(cpu::MMIORange* mmio_range, uint32_t address, Value* value);
@@ -159,7 +160,7 @@ class HIRBuilder {
   void Memset(Value* address, Value* value, Value* length);
   void CacheControl(Value* address, size_t cache_line_size,
                     CacheControlType type);
-  void MemoryBarrier();
+  void MemoryBarrier(uint16_t barrier_flags = MEMORY_BARRIER_FULL);
 
   void SetRoundingMode(Value* value);
   Value* Max(Value* value1, Value* value2);
@@ -46,6 +46,25 @@ enum CacheControlType {
   CACHE_CONTROL_TYPE_DATA_STORE_AND_FLUSH,
 };
 
+// Orderings a MEMORY_BARRIER provides, from the guest instruction it comes
+// from. Passes must not move memory accesses across a barrier of any kind, but
+// backends only need to emit what the host memory model doesn't already give.
+enum MemoryBarrierFlags {
+  // Earlier loads before later loads and stores.
+  MEMORY_BARRIER_ACQUIRE = (1 << 0),
+  // Earlier loads and stores before later stores.
+  MEMORY_BARRIER_RELEASE = (1 << 1),
+  MEMORY_BARRIER_STORE_STORE = (1 << 2),
+  // Accesses to caching-inhibited (MMIO) memory.
+  MEMORY_BARRIER_IO = (1 << 3),
+  // Earlier stores before later loads.
+  MEMORY_BARRIER_STORE_LOAD = (1 << 4),
+  // sync.
+  MEMORY_BARRIER_FULL = MEMORY_BARRIER_ACQUIRE | MEMORY_BARRIER_RELEASE |
+                        MEMORY_BARRIER_STORE_STORE | MEMORY_BARRIER_IO |
+                        MEMORY_BARRIER_STORE_LOAD,
+};
+
 enum ArithmeticFlags {
   ARITHMETIC_UNSIGNED = (1 << 2),
   ARITHMETIC_SATURATE = (1 << 3),
@@ -125,6 +144,7 @@ enum Opcode {
   OPCODE_DEBUG_BREAK_TRUE,
   OPCODE_TRAP,
   OPCODE_TRAP_TRUE,
+  OPCODE_SAFEPOINT,
   OPCODE_CALL,
   OPCODE_CALL_TRUE,
   OPCODE_CALL_INDIRECT,
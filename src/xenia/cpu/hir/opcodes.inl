@@ -51,6 +51,12 @@ DEFINE_OPCODE(
     OPCODE_SIG_X_V,
     OPCODE_FLAG_VOLATILE)
 
+DEFINE_OPCODE(
+    OPCODE_SAFEPOINT,
+    "safepoint",
+    OPCODE_SIG_X,
+    OPCODE_FLAG_VOLATILE)
+
 DEFINE_OPCODE(
     OPCODE_CALL,
     "call",
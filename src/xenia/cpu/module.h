@@ -46,6 +46,11 @@ class Module {
   Symbol::Status DefineFunction(Function* symbol);
   Symbol::Status DefineVariable(Symbol* symbol);
 
+  // Stops the function being found by address, so the next declaration there
+  // creates a new one. The function itself is kept and still visited by
+  // ForEachFunction.
+  void RetireFunction(Function* function);
+
   void ForEachFunction(std::function<void(Function*)> callback);
   void ForEachSymbol(size_t start_index, size_t end_index,
                      std::function<void(Symbol*)> callback);
@@ -54,8 +59,24 @@ class Module {
   bool ReadMap(const char* file_name);
 
  protected:
+  // Start addresses of the compiler-generated register save/restore helpers
+  // (__savegprlr_14 and others), or 0 if not found.
+  struct SaveRestoreHelpers {
+    uint32_t gprlr_start = 0;
+    uint32_t fpr_start = 0;
+    uint32_t vmx_start = 0;
+  };
+
   virtual std::unique_ptr<Function> CreateFunction(uint32_t address) = 0;
 
+  // Searches the code in the range for the helpers that haven't been found
+  // yet.
+  void FindSaveRestoreHelpers(uint32_t start_address, uint32_t end_address,
+                              SaveRestoreHelpers& helpers);
+  // Declares functions for the found helpers, marked so the frontend can expand
+  // calls to them inline.
+  void DeclareSaveRestoreHelpers(const SaveRestoreHelpers& helpers);
+
   Processor* processor_ = nullptr;
   Memory* memory_ = nullptr;
 
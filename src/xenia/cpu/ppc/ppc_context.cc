@@ -40,7 +40,23 @@ uint64_t PPCContext::cr() const {
 }
 
 void PPCContext::set_cr(uint64_t value) {
-  assert_always("not yet implemented");
+  for (int i = 0; i < 8; ++i) {
+    union {
+      uint32_t value;
+      struct {
+        uint8_t lt;
+        uint8_t gt;
+        uint8_t eq;
+        uint8_t so;
+      };
+    } crf;
+    uint64_t bits = value >> ((7 - i) * 4);
+    crf.lt = (bits >> 3) & 0x1;
+    crf.gt = (bits >> 2) & 0x1;
+    crf.eq = (bits >> 1) & 0x1;
+    crf.so = (bits >> 0) & 0x1;
+    *(&cr0.value + i) = crf.value;
+  }
 }
 
 std::string PPCContext::GetRegisterName(PPCRegister reg) {
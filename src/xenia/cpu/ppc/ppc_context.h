@@ -425,6 +425,24 @@ typedef struct PPCContext_s {
 
   // Value of last reserved load
   uint64_t reserved_val;
+  // Version and address of the reservation taken by the last reserved load,
+  // see xe::cpu::ReservationTable. UINT64_MAX if there's none.
+  uint64_t reserved_version;
+  uint32_t reserved_address;
+
+  // Per-thread MSR (only EE and RI), when mtmsr doesn't take the global lock.
+  uint32_t msr;
+
+  // Guest instructions executed and not yet added to the virtual guest clock,
+  // counted by VirtualClockPass code with --clock_virtual.
+  uint64_t virtual_clock_instructions;
+
+  // Set while the thread has user callbacks queued or is to be suspended,
+  // polled by OPCODE_SAFEPOINT. See xe::threading::SetSafepointFlag.
+  uint32_t safepoint_pending;
+
+  // Keeps the size a multiple of 64.
+  uint8_t padding[36];
 
   static std::string GetRegisterName(PPCRegister reg);
   std::string GetStringFromValue(PPCRegister reg) const;
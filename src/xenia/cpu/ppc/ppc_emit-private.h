@@ -12,6 +12,7 @@
 
 #include "xenia/base/logging.h"
 #include "xenia/cpu/ppc/ppc_decode_data.h"
+#include "xenia/cpu/hir/value.h"
 #include "xenia/cpu/ppc/ppc_emit.h"
 #include "xenia/cpu/ppc/ppc_opcode_info.h"
 
@@ -26,6 +27,10 @@ namespace ppc {
   XELOGE("Unimplemented instruction: %s", __FUNCTION__); \
   assert_always("Instruction not implemented");
 
+// ((VA) || (VB)) << (SH << 3), SH in [0, 16].
+hir::Value* ShiftLeftDoubleByOctet(PPCHIRBuilder& f, hir::Value* va,
+                                   hir::Value* vb, uint32_t sh);
+
 }  // namespace ppc
 }  // namespace cpu
 }  // namespace xe
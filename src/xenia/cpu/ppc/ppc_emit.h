@@ -10,16 +10,35 @@
 #ifndef XENIA_CPU_PPC_PPC_EMIT_H_
 #define XENIA_CPU_PPC_PPC_EMIT_H_
 
+#include <cstdint>
+
 namespace xe {
 namespace cpu {
 namespace ppc {
 
+struct InstrData;
+class PPCHIRBuilder;
+
 void RegisterEmitCategoryAltivec();
 void RegisterEmitCategoryALU();
 void RegisterEmitCategoryControl();
 void RegisterEmitCategoryFPU();
 void RegisterEmitCategoryMemory();
 
+// Maximum number of instructions following the first one that an idiom may
+// cover.
+constexpr uint32_t kMaxIdiomLookahead = 2;
+
+// Emits the instruction i along with some of the next_count instructions
+// following it in next if they form a known idiom that can be expressed with
+// less HIR than the individual instructions. Returns the number of
+// instructions emitted, including i, or 0 if no idiom was recognized and
+// nothing was emitted.
+// The following instructions must be in the same basic block as i, and none
+// of them may be a branch target.
+uint32_t EmitIdiom(PPCHIRBuilder& f, const InstrData& i, const InstrData* next,
+                   uint32_t next_count);
+
 }  // namespace ppc
 }  // namespace cpu
 }  // namespace xe
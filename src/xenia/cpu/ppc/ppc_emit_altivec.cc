@@ -1443,22 +1443,29 @@ static const vec128_t __vsldoi_table[16] = {
     vec128b(14, 15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29),
     vec128b(15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29, 30),
 };
-int InstrEmit_vsldoi_(PPCHIRBuilder& f, uint32_t vd, uint32_t va, uint32_t vb,
-                      uint32_t sh) {
-  // (VD) <- ((VA) || (VB)) << (SH << 3)
+Value* ShiftLeftDoubleByOctet(PPCHIRBuilder& f, Value* va, Value* vb,
+                              uint32_t sh) {
+  // ((VA) || (VB)) << (SH << 3)
   if (!sh) {
-    f.StoreVR(vd, f.LoadVR(va));
-    return 0;
+    return va;
   } else if (sh == 16) {
-    f.StoreVR(vd, f.LoadVR(vb));
-    return 0;
+    return vb;
+  }
+  if (va == vb && !(sh & 3)) {
+    // Rotation by whole words:
+    // vsldoi128 vr63,vr63,vr63,4
+    // (ABCD ABCD) << 4b = (BCDA)
+    uint32_t w = sh >> 2;
+    return f.Swizzle(va, INT32_TYPE, MakeSwizzleMask(w, w + 1, w + 2, w + 3));
   }
-  // TODO(benvanik): optimize for the rotation case:
-  // vsldoi128 vr63,vr63,vr63,4
-  // (ABCD ABCD) << 4b = (BCDA)
-  // (VA << SH) OR (VB >> (16 - SH))
   Value* control = f.LoadConstantVec128(__vsldoi_table[sh]);
-  Value* v = f.Permute(control, f.LoadVR(va), f.LoadVR(vb), INT8_TYPE);
+  return f.Permute(control, va, vb, INT8_TYPE);
+}
+int InstrEmit_vsldoi_(PPCHIRBuilder& f, uint32_t vd, uint32_t va, uint32_t vb,
+                      uint32_t sh) {
+  // (VD) <- ((VA) || (VB)) << (SH << 3)
+  Value* v_a = f.LoadVR(va);
+  Value* v = ShiftLeftDoubleByOctet(f, v_a, va == vb ? v_a : f.LoadVR(vb), sh);
   f.StoreVR(vd, v);
   return 0;
 }
@@ -1472,7 +1479,7 @@ int InstrEmit_vsldoi128(PPCHIRBuilder& f, const InstrData& i) {
 
 int InstrEmit_vslo_(PPCHIRBuilder& f, uint32_t vd, uint32_t va, uint32_t vb) {
   // (VD) <- (VA) << (VB.b[F] & 0x78) (by octet)
-  // TODO(benvanik): flag for shift-by-octet as optimization.
+  // Shifts by a vspltisb constant are handled by EmitIdiom.
   Value* sh = f.Shr(
       f.And(f.Extract(f.LoadVR(vb), 15, INT8_TYPE), f.LoadConstantInt8(0x78)),
       3);
@@ -1623,7 +1630,7 @@ int InstrEmit_vsrh(PPCHIRBuilder& f, const InstrData& i) {
 
 int InstrEmit_vsro_(PPCHIRBuilder& f, uint32_t vd, uint32_t va, uint32_t vb) {
   // (VD) <- (VA) >> (VB.b[F] & 0x78) (by octet)
-  // TODO(benvanik): flag for shift-by-octet as optimization.
+  // Shifts by a vspltisb constant are handled by EmitIdiom.
   Value* sh = f.Shr(
       f.And(f.Extract(f.LoadVR(vb), 15, INT8_TYPE), f.LoadConstantInt8(0x78)),
       3);
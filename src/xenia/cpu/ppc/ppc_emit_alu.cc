@@ -1025,22 +1025,47 @@ int InstrEmit_rlwinmx(PPCHIRBuilder& f, const InstrData& i) {
   // RA <- r & m
   Value* v = f.LoadGPR(i.M.RT);
 
-  // (x||x)
-  v = f.Or(f.Shl(v, 32), f.ZeroExtend(f.Truncate(v, INT32_TYPE), INT64_TYPE));
-
-  // TODO(benvanik): optimize srwi
-  // TODO(benvanik): optimize slwi
-  // The compiler will generate a bunch of these for the special case of SH=0.
-  // Which seems to just select some bits and set cr0 for use with a branch.
-  // We can detect this and do less work.
-  if (i.M.SH) {
-    v = f.RotateLeft(v, f.LoadConstantInt8(i.M.SH));
-  }
-  // Compiler sometimes masks with 0xFFFFFFFF (identity) - avoid the work here
-  // as our truncation/zero-extend does it for us.
-  uint64_t m = XEMASK(i.M.MB + 32, i.M.ME + 32);
-  if (m != 0xFFFFFFFFFFFFFFFFull) {
-    v = f.And(v, f.LoadConstantUint64(m));
+  if (i.M.MB <= i.M.ME) {
+    // The mask doesn't wrap around, so none of the upper word of (x||x)
+    // survives and everything can be done on the lower word. This covers the
+    // slwi/srwi/extrwi/clrlwi/clrrwi forms the compiler generates, including
+    // the many SH=0 ones that just select some bits and set cr0 for a branch.
+    uint32_t sh = i.M.SH;
+    uint32_t m = uint32_t(XEMASK(i.M.MB + 32, i.M.ME + 32));
+    v = f.Truncate(v, INT32_TYPE);
+    if (!sh) {
+      // Just the mask.
+    } else if (!(m & ~(0xFFFFFFFFu << sh))) {
+      // slwi - the bits rotated around from the top are masked away.
+      v = f.Shl(v, int8_t(sh));
+      if (m == 0xFFFFFFFFu << sh) {
+        m = 0xFFFFFFFFu;
+      }
+    } else if (!(m & ~(0xFFFFFFFFu >> (32 - sh)))) {
+      // srwi/extrwi - only the bits rotated around from the top are kept.
+      v = f.Shr(v, int8_t(32 - sh));
+      if (m == 0xFFFFFFFFu >> (32 - sh)) {
+        m = 0xFFFFFFFFu;
+      }
+    } else {
+      v = f.RotateLeft(v, f.LoadConstantInt8(sh));
+    }
+    if (m != 0xFFFFFFFFu) {
+      v = f.And(v, f.LoadConstantUint32(m));
+    }
+    v = f.ZeroExtend(v, INT64_TYPE);
+  } else {
+    // (x||x)
+    v = f.Or(f.Shl(v, 32), f.ZeroExtend(f.Truncate(v, INT32_TYPE), INT64_TYPE));
+    if (i.M.SH) {
+      v = f.RotateLeft(v, f.LoadConstantInt8(i.M.SH));
+    }
+    // Compiler sometimes masks with 0xFFFFFFFF (identity) - avoid the work
+    // here as our truncation/zero-extend does it for us.
+    uint64_t m = XEMASK(i.M.MB + 32, i.M.ME + 32);
+    if (m != 0xFFFFFFFFFFFFFFFFull) {
+      v = f.And(v, f.LoadConstantUint64(m));
+    }
   }
   f.StoreGPR(i.M.RA, v);
   if (i.M.Rc) {
@@ -27,6 +27,123 @@ using namespace xe::cpu::hir;
 using xe::cpu::hir::Label;
 using xe::cpu::hir::Value;
 
+// Emits the effects of an unconditional branch to a register save/restore
+// helper (__savegprlr_14 and others) in place of the call, after LR has been
+// updated for it. The helpers are called with bl, except for __restgprlr_*,
+// which is jumped to at the end of the function and returns to the restored
+// LR. Returns false if the branch needs to be emitted as a regular call.
+bool EmitSaveRestoreHelper(PPCHIRBuilder& f, Function* helper, bool lk) {
+  uint32_t first_register = helper->save_restore_first_register();
+  switch (helper->save_restore()) {
+    case Function::SaveRestore::kSaveGprLr: {
+      if (!lk) {
+        return false;
+      }
+      Value* sp = f.LoadGPR(1);
+      for (uint32_t n = first_register; n <= 31; ++n) {
+        Value* offset = f.LoadConstantInt64(-int64_t(8 * (32 - n) + 8));
+        f.StoreOffset(sp, offset, f.ByteSwap(f.LoadGPR(n)));
+      }
+      f.StoreOffset(sp, f.LoadConstantInt64(-8),
+                    f.ByteSwap(f.Truncate(f.LoadGPR(12), INT32_TYPE)));
+      return true;
+    }
+    case Function::SaveRestore::kRestoreGprLr: {
+      if (lk) {
+        return false;
+      }
+      Value* sp = f.LoadGPR(1);
+      for (uint32_t n = first_register; n <= 31; ++n) {
+        Value* offset = f.LoadConstantInt64(-int64_t(8 * (32 - n) + 8));
+        f.StoreGPR(n, f.ByteSwap(f.LoadOffset(sp, offset, INT64_TYPE)));
+      }
+      Value* lr = f.ZeroExtend(
+          f.ByteSwap(f.LoadOffset(sp, f.LoadConstantInt64(-8), INT32_TYPE)),
+          INT64_TYPE);
+      f.StoreGPR(12, lr);
+      f.StoreLR(lr);
+      // The blr at the end of the helper.
+      f.CallIndirect(lr, CALL_TAIL | CALL_POSSIBLE_RETURN);
+      return true;
+    }
+    case Function::SaveRestore::kSaveFpr:
+    case Function::SaveRestore::kRestoreFpr: {
+      if (!lk) {
+        return false;
+      }
+      Value* base = f.LoadGPR(12);
+      for (uint32_t n = first_register; n <= 31; ++n) {
+        Value* offset = f.LoadConstantInt64(-int64_t(8 * (32 - n)));
+        if (helper->save_restore() == Function::SaveRestore::kSaveFpr) {
+          f.StoreOffset(base, offset,
+                        f.ByteSwap(f.Cast(f.LoadFPR(n), INT64_TYPE)));
+        } else {
+          Value* value = f.ByteSwap(f.LoadOffset(base, offset, INT64_TYPE));
+          f.StoreFPR(n, f.Cast(value, FLOAT64_TYPE));
+        }
+      }
+      return true;
+    }
+    case Function::SaveRestore::kSaveVmx:
+    case Function::SaveRestore::kRestoreVmx: {
+      if (!lk) {
+        return false;
+      }
+      // v14-v31 or v64-v127, each addressed with r11 + r12 like stvx/lvx.
+      uint32_t end_register = first_register < 64 ? 32 : 128;
+      Value* base = f.LoadGPR(12);
+      for (uint32_t n = first_register; n < end_register; ++n) {
+        Value* ea = f.And(
+            f.Add(base, f.LoadConstantInt64(-int64_t(16 * (end_register - n)))),
+            f.LoadConstantUint64(~0xFull));
+        if (helper->save_restore() == Function::SaveRestore::kSaveVmx) {
+          f.Store(ea, f.ByteSwap(f.LoadVR(n)));
+        } else {
+          f.StoreVR(n, f.ByteSwap(f.Load(ea, VEC128_TYPE)));
+        }
+      }
+      // The last li r11.
+      f.StoreGPR(11, f.LoadConstantInt64(-16));
+      return true;
+    }
+    default:
+      return false;
+  }
+}
+
+// Emits an unconditional branch to an import thunk as a branch to what the
+// thunk calls, after LR has been updated for it: the kernel export of a thunk
+// rewritten to sc 2, or the export of another module of a thunk that sets r11
+// and CTR to it. Returns false if the thunk needs to be called.
+bool EmitImportThunk(PPCHIRBuilder& f, Function* thunk, bool lk) {
+  Function* target = nullptr;
+  if (thunk->import_target()) {
+    target = f.LookupFunction(thunk->import_target());
+    if (!target) {
+      return false;
+    }
+  } else if (thunk->behavior() != Function::Behavior::kExtern) {
+    return false;
+  }
+  // Compiled again if the thunk is patched.
+  f.BindImportThunk(thunk);
+  if (target) {
+    // The lis/ori/mtctr before the bctr, with lis sign extending.
+    Value* address = f.LoadConstantInt64(
+        static_cast<int32_t>(thunk->import_target()));
+    f.StoreGPR(11, address);
+    f.StoreCTR(address);
+    f.Call(target, lk ? 0 : CALL_TAIL);
+  } else {
+    f.CallExtern(thunk);
+    if (!lk) {
+      // The blr after the sc.
+      f.Return();
+    }
+  }
+  return true;
+}
+
 int InstrEmit_branch(PPCHIRBuilder& f, const char* src, uint64_t cia,
                      Value* nia, bool lk, Value* cond = NULL,
                      bool expect_true = true, bool nia_is_lr = false) {
@@ -76,6 +193,15 @@ int InstrEmit_branch(PPCHIRBuilder& f, const char* src, uint64_t cia,
     } else {
       // Call function.
       auto function = f.LookupFunction(nia_value);
+      if (!cond && function && cvars::inline_save_restore_helpers &&
+          function->save_restore() != Function::SaveRestore::kNone &&
+          EmitSaveRestoreHelper(f, function, lk)) {
+        return 0;
+      }
+      if (!cond && function && cvars::bind_import_thunks &&
+          EmitImportThunk(f, function, lk)) {
+        return 0;
+      }
       if (cond) {
         if (!expect_true) {
           cond = f.IsFalse(cond);
@@ -553,12 +679,11 @@ int InstrEmit_mfcr(PPCHIRBuilder& f, const InstrData& i) {
   // if count = 1 then
   //   RT4un + 32:4un + 35 <- CR4un + 32 : 4un + 35
 
-  // TODO(benvanik): optimize mfcr sequences.
-  // Often look something like this:
+  // Sequences like this one, that only need a single CR bit, are recognized
+  // by EmitIdiom, which loads just that bit for the result:
   //   mfocrf  r11, cr6
   //   not r10, r11
   //   extrwi    r3, r10, 1, 26
-  // Could recognize this and only load the appropriate CR bit.
 
   Value* v;
   if (i.XFX.spr & (1 << 9)) {
@@ -715,15 +840,33 @@ int InstrEmit_mtspr(PPCHIRBuilder& f, const InstrData& i) {
 }
 
 // MSR is used for toggling interrupts (among other things).
-// We track it here for taking a global processor lock, as lots of lockfree
-// code requires it. Sequences of mtmsr/lwar/stcw/mtmsr come up a lot, and
-// without the lock here threads can livelock.
+// Without the reservation table we track it here for taking a global
+// processor lock, as lots of lockfree code requires it. Sequences of
+// mtmsr/lwar/stcw/mtmsr come up a lot, and without the lock here threads can
+// livelock. With the table, reservations can't be stolen by stores they don't
+// conflict with, so as on the real hardware disabling interrupts only affects
+// the current thread.
+
+// L = 1 form, which only sets EE and RI.
+void StorePerThreadMSR(PPCHIRBuilder& f, uint32_t rs) {
+  const uint32_t mask = 0x8002;
+  Value* msr = f.LoadContext(offsetof(PPCContext, msr), INT32_TYPE);
+  msr = f.And(msr, f.LoadConstantUint32(~mask));
+  msr = f.Or(msr, f.And(f.Truncate(f.LoadGPR(rs), INT32_TYPE),
+                        f.LoadConstantUint32(mask)));
+  f.StoreContext(offsetof(PPCContext, msr), msr);
+}
 
 int InstrEmit_mfmsr(PPCHIRBuilder& f, const InstrData& i) {
   // bit 48 = EE; interrupt enabled
   // bit 62 = RI; recoverable interrupt
   // return 8000h if unlocked (interrupts enabled), else 0
   f.MemoryBarrier();
+  if (cvars::use_reservation_table) {
+    Value* msr = f.LoadContext(offsetof(PPCContext, msr), INT32_TYPE);
+    f.StoreGPR(i.X.RT, f.ZeroExtend(msr, INT64_TYPE));
+    return 0;
+  }
   f.CallExtern(f.builtins()->check_global_lock);
   f.StoreGPR(i.X.RT, f.LoadContext(offsetof(PPCContext, scratch), INT64_TYPE));
   return 0;
@@ -734,6 +877,10 @@ int InstrEmit_mtmsr(PPCHIRBuilder& f, const InstrData& i) {
     // L = 1
     // iff storing from r13
     f.MemoryBarrier();
+    if (cvars::use_reservation_table) {
+      StorePerThreadMSR(f, i.X.RT);
+      return 0;
+    }
     f.StoreContext(
         offsetof(PPCContext, scratch),
         f.ZeroExtend(f.ZeroExtend(f.LoadGPR(i.X.RT), INT64_TYPE), INT64_TYPE));
@@ -760,6 +907,10 @@ int InstrEmit_mtmsrd(PPCHIRBuilder& f, const InstrData& i) {
   if (i.X.RA & 0x01) {
     // L = 1
     f.MemoryBarrier();
+    if (cvars::use_reservation_table) {
+      StorePerThreadMSR(f, i.X.RT);
+      return 0;
+    }
     f.StoreContext(offsetof(PPCContext, scratch),
                    f.ZeroExtend(f.LoadGPR(i.X.RT), INT64_TYPE));
     if (i.X.RT == 13) {
@@ -0,0 +1,161 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2020 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include "xenia/cpu/ppc/ppc_emit-private.h"
+
+#include "xenia/base/assert.h"
+#include "xenia/cpu/ppc/ppc_context.h"
+#include "xenia/cpu/ppc/ppc_hir_builder.h"
+
+namespace xe {
+namespace cpu {
+namespace ppc {
+
+// TODO(benvanik): remove when enums redefined.
+using namespace xe::cpu::hir;
+
+using xe::cpu::hir::Value;
+
+namespace {
+
+// Emits an instruction of the idiom that's translated as usual. Only used for
+// instructions that are always implemented.
+void EmitInstr(PPCHIRBuilder& f, const InstrData& i) {
+  if (i.opcode_info->emit(f, i)) {
+    assert_always();
+  }
+}
+
+// A single CR bit moved to a GPR:
+//   mfocrf  r11, cr6          or  mfcr r11
+//   not     r10, r11          (optional)
+//   extrwi  r3, r10, 1, 26    (rlwinm r3, r10, 27, 31, 31)
+// The bit is loaded for r3 directly instead of being extracted from the
+// assembled CR word. r11 and r10 are still written as usual, but when they are
+// overwritten later in the block those stores, and with them the assembly of
+// the CR word, are removed as dead.
+uint32_t EmitIdiomCRBit(PPCHIRBuilder& f, const InstrData& i,
+                        const InstrData* next, uint32_t next_count) {
+  // Fields with defined values.
+  uint32_t field_bits = 0xFF;
+  if (i.XFX.spr & (1 << 9)) {
+    // mfocrf - only meaningful with a single field.
+    field_bits = (i.XFX.spr & 0x1FF) >> 1;
+    if (!field_bits || (field_bits & (field_bits - 1))) {
+      return 0;
+    }
+  }
+  uint32_t reg = i.XFX.RT;
+  uint32_t n = 0;
+  bool invert = false;
+  if (n < next_count && next[n].opcode == PPCOpcode::norx &&
+      next[n].X.RT == reg && next[n].X.RB == reg) {
+    reg = next[n].X.RA;
+    invert = true;
+    ++n;
+  }
+  if (n >= next_count) {
+    return 0;
+  }
+  const InstrData& extract = next[n];
+  if (extract.opcode != PPCOpcode::rlwinmx || extract.M.RT != reg ||
+      extract.M.MB != 31 || extract.M.ME != 31) {
+    return 0;
+  }
+  // Bit 31 of ROTL32(x, SH) is bit SH - 1 of x (both numbered from the MSB).
+  uint32_t cr_bit = (extract.M.SH + 31) & 31;
+  uint32_t cr_field = cr_bit >> 2;
+  if (!(field_bits & (1 << (7 - cr_field)))) {
+    return 0;
+  }
+
+  // Loaded before anything is emitted in case not. updates cr0.
+  Value* v = f.ZeroExtend(f.LoadCRField(cr_field, cr_bit & 3), INT64_TYPE);
+  if (invert) {
+    v = f.Xor(v, f.LoadConstantUint64(1));
+  }
+  EmitInstr(f, i);
+  if (invert) {
+    EmitInstr(f, next[0]);
+  }
+  f.StoreGPR(extract.M.RA, v);
+  if (extract.M.Rc) {
+    f.UpdateCR(0, v);
+  }
+  return n + 2;
+}
+
+// A shift by whole octets with the amount splatted right before:
+//   vspltisb v0, 8
+//   vslo     v3, v1, v0       (or vsro)
+// The shift amount is known, so the permutation control is a constant.
+uint32_t EmitIdiomShiftByOctet(PPCHIRBuilder& f, const InstrData& i,
+                               const InstrData* next, uint32_t next_count) {
+  if (!next_count) {
+    return 0;
+  }
+  const InstrData& shift = next[0];
+  uint32_t vd, va, vb;
+  bool left;
+  switch (shift.opcode) {
+    case PPCOpcode::vslo:
+    case PPCOpcode::vsro:
+      vd = shift.VX.VD;
+      va = shift.VX.VA;
+      vb = shift.VX.VB;
+      left = shift.opcode == PPCOpcode::vslo;
+      break;
+    case PPCOpcode::vslo128:
+    case PPCOpcode::vsro128:
+      vd = shift.VX128.VD128l | (shift.VX128.VD128h << 5);
+      va = shift.VX128.VA128l | (shift.VX128.VA128h << 5) |
+           (shift.VX128.VA128H << 6);
+      vb = shift.VX128.VB128l | (shift.VX128.VB128h << 5);
+      left = shift.opcode == PPCOpcode::vslo128;
+      break;
+    default:
+      return 0;
+  }
+  if (vb != i.VX.VD) {
+    return 0;
+  }
+  // Sign extended from 5 bits, and the shift only uses bits 1-4 of the byte.
+  uint32_t simm = (i.VX.VA & 0x10) ? (i.VX.VA | 0xF0) : i.VX.VA;
+  uint32_t octets = (simm & 0x78) >> 3;
+
+  EmitInstr(f, i);
+  Value* v_a = f.LoadVR(va);
+  Value* v;
+  if (left) {
+    v = ShiftLeftDoubleByOctet(f, v_a, f.LoadZeroVec128(), octets);
+  } else {
+    v = ShiftLeftDoubleByOctet(f, f.LoadZeroVec128(), v_a, 16 - octets);
+  }
+  f.StoreVR(vd, v);
+  return 2;
+}
+
+}  // namespace
+
+uint32_t EmitIdiom(PPCHIRBuilder& f, const InstrData& i, const InstrData* next,
+                   uint32_t next_count) {
+  assert_true(next_count <= kMaxIdiomLookahead);
+  switch (i.opcode) {
+    case PPCOpcode::mfcr:
+      return EmitIdiomCRBit(f, i, next, next_count);
+    case PPCOpcode::vspltisb:
+      return EmitIdiomShiftByOctet(f, i, next, next_count);
+    default:
+      return 0;
+  }
+}
+
+}  // namespace ppc
+}  // namespace cpu
+}  // namespace xe
@@ -11,7 +11,9 @@
 #include "xenia/base/cvar.h"
 #include <stddef.h>
 #include "xenia/base/assert.h"
+#include "xenia/cpu/cpu_flags.h"
 #include "xenia/cpu/ppc/ppc_context.h"
+#include "xenia/cpu/ppc/ppc_frontend.h"
 #include "xenia/cpu/ppc/ppc_hir_builder.h"
 
 DEFINE_bool(UE_Workaround, true,
@@ -737,12 +739,20 @@ int InstrEmit_stswx(PPCHIRBuilder& f, const InstrData& i) {
 // Memory synchronization (A-18)
 
 int InstrEmit_eieio(PPCHIRBuilder& f, const InstrData& i) {
-  f.MemoryBarrier();
+  // Orders stores to cacheable memory and all accesses to caching-inhibited
+  // memory, but not cacheable loads.
+  f.MemoryBarrier(MEMORY_BARRIER_STORE_STORE | MEMORY_BARRIER_IO);
   return 0;
 }
 
 int InstrEmit_sync(PPCHIRBuilder& f, const InstrData& i) {
-  f.MemoryBarrier();
+  // L = 1 is lwsync, which orders everything but stores before loads.
+  if ((i.X.RT & 0x3) == 1) {
+    f.MemoryBarrier(MEMORY_BARRIER_ACQUIRE | MEMORY_BARRIER_RELEASE |
+                    MEMORY_BARRIER_STORE_STORE);
+  } else {
+    f.MemoryBarrier(MEMORY_BARRIER_FULL);
+  }
   return 0;
 }
 
@@ -752,6 +762,41 @@ int InstrEmit_isync(PPCHIRBuilder& f, const InstrData& i) {
   return 0;
 }
 
+// Reservations are tracked per granule in the processor's ReservationTable
+// when enabled. Otherwise only the reserved value is remembered and the
+// conditional store is a compare-exchange against it.
+// With the table, only the reserved address compare of a conditional store is
+// done inline. Reserving, and checking the granule version and storing, are
+// always calls to builtins, as the table isn't reachable from HIR loads.
+void EmitReserve(PPCHIRBuilder& f, Value* ea) {
+  if (cvars::use_reservation_table) {
+    f.StoreContext(offsetof(PPCContext, scratch), ea);
+    f.CallExtern(f.builtins()->reserve);
+  }
+}
+
+void EmitStoreConditional(PPCHIRBuilder& f, Value* ea, Value* rs,
+                          Function* store_conditional) {
+  // A conditional store to anything but the reserved address fails.
+  auto end = f.NewLabel();
+  f.StoreContext(offsetof(PPCContext, cr0.cr0_eq), f.LoadZeroInt8());
+  f.BranchFalse(
+      f.CompareEQ(f.Truncate(ea, INT32_TYPE),
+                  f.LoadContext(offsetof(PPCContext, reserved_address),
+                                INT32_TYPE)),
+      end);
+  f.StoreContext(offsetof(PPCContext, scratch), rs);
+  f.CallExtern(store_conditional);
+  f.StoreContext(
+      offsetof(PPCContext, cr0.cr0_eq),
+      f.Truncate(f.LoadContext(offsetof(PPCContext, scratch), INT64_TYPE),
+                 INT8_TYPE));
+  f.MarkLabel(end);
+  // Whether or not it stored, the reservation is gone.
+  f.StoreContext(offsetof(PPCContext, reserved_version),
+                 f.LoadConstantUint64(UINT64_MAX));
+}
+
 int InstrEmit_ldarx(PPCHIRBuilder& f, const InstrData& i) {
   // if RA = 0 then
   //   b <- 0
@@ -763,14 +808,16 @@ int InstrEmit_ldarx(PPCHIRBuilder& f, const InstrData& i) {
   // RESERVE_ADDR <- real_addr(EA)
   // RT <- MEM(EA, 8)
 
-  // NOTE: we assume we are within a global lock.
-  // We could assert here that the block (or its parent) has taken a global lock
-  // already, but I haven't see anything but interrupt callbacks (which are
-  // always under a global lock) do that yet.
+  // NOTE: without the reservation table we assume we are within a global
+  // lock. We could assert here that the block (or its parent) has taken a
+  // global lock already, but I haven't see anything but interrupt callbacks
+  // (which are always under a global lock) do that yet.
   // We issue a memory barrier here to make sure that we get good values.
-  f.MemoryBarrier();
+  // Guest code that needs earlier stores ordered before the load has a sync.
+  f.MemoryBarrier(MEMORY_BARRIER_ACQUIRE | MEMORY_BARRIER_RELEASE);
 
   Value* ea = CalculateEA_0(f, i.X.RA, i.X.RB);
+  EmitReserve(f, ea);
   Value* rt = f.ByteSwap(f.Load(ea, INT64_TYPE));
   f.StoreReserved(rt);
   f.StoreGPR(i.X.RT, rt);
@@ -788,14 +835,16 @@ int InstrEmit_lwarx(PPCHIRBuilder& f, const InstrData& i) {
   // RESERVE_ADDR <- real_addr(EA)
   // RT <- i32.0 || MEM(EA, 4)
 
-  // NOTE: we assume we are within a global lock.
-  // We could assert here that the block (or its parent) has taken a global lock
-  // already, but I haven't see anything but interrupt callbacks (which are
-  // always under a global lock) do that yet.
+  // NOTE: without the reservation table we assume we are within a global
+  // lock. We could assert here that the block (or its parent) has taken a
+  // global lock already, but I haven't see anything but interrupt callbacks
+  // (which are always under a global lock) do that yet.
   // We issue a memory barrier here to make sure that we get good values.
-  f.MemoryBarrier();
+  // Guest code that needs earlier stores ordered before the load has a sync.
+  f.MemoryBarrier(MEMORY_BARRIER_ACQUIRE | MEMORY_BARRIER_RELEASE);
 
   Value* ea = CalculateEA_0(f, i.X.RA, i.X.RB);
+  EmitReserve(f, ea);
   Value* rt = f.ZeroExtend(f.ByteSwap(f.Load(ea, INT32_TYPE)), INT64_TYPE);
   f.StoreReserved(rt);
   f.StoreGPR(i.X.RT, rt);
@@ -813,18 +862,24 @@ int InstrEmit_stdcx(PPCHIRBuilder& f, const InstrData& i) {
   // n <- 1 if store performed
   // CR0[LT GT EQ SO] = 0b00 || n || XER[SO]
 
-  // NOTE: we assume we are within a global lock.
-  // As we have been exclusively executing this entire time, we assume that no
-  // one else could have possibly touched the memory and must always succeed.
-  // We use atomic compare exchange here to support reserved load/store without
-  // being under the global lock (flag disable_global_lock - see mtmsr/mtmsrd).
-  // This will always succeed if under the global lock, however.
+  // NOTE: without the reservation table we assume we are within a global
+  // lock. As we have been exclusively executing this entire time, we assume
+  // that no one else could have possibly touched the memory and must always
+  // succeed. We use atomic compare exchange here to support reserved
+  // load/store without being under the global lock (flag disable_global_lock
+  // - see mtmsr/mtmsrd). This will always succeed if under the global lock,
+  // however.
 
   Value* ea = CalculateEA_0(f, i.X.RA, i.X.RB);
-  Value* rt = f.ByteSwap(f.LoadGPR(i.X.RT));
-  Value* res = f.ByteSwap(f.LoadReserved());
-  Value* v = f.AtomicCompareExchange(ea, res, rt);
-  f.StoreContext(offsetof(PPCContext, cr0.cr0_eq), v);
+  if (cvars::use_reservation_table) {
+    EmitStoreConditional(f, ea, f.LoadGPR(i.X.RT),
+                         f.builtins()->store_conditional_doubleword);
+  } else {
+    Value* rt = f.ByteSwap(f.LoadGPR(i.X.RT));
+    Value* res = f.ByteSwap(f.LoadReserved());
+    Value* v = f.AtomicCompareExchange(ea, res, rt);
+    f.StoreContext(offsetof(PPCContext, cr0.cr0_eq), v);
+  }
   f.StoreContext(offsetof(PPCContext, cr0.cr0_lt), f.LoadZeroInt8());
   f.StoreContext(offsetof(PPCContext, cr0.cr0_gt), f.LoadZeroInt8());
 
@@ -846,18 +901,26 @@ int InstrEmit_stwcx(PPCHIRBuilder& f, const InstrData& i) {
   // n <- 1 if store performed
   // CR0[LT GT EQ SO] = 0b00 || n || XER[SO]
 
-  // NOTE: we assume we are within a global lock.
-  // As we have been exclusively executing this entire time, we assume that no
-  // one else could have possibly touched the memory and must always succeed.
-  // We use atomic compare exchange here to support reserved load/store without
-  // being under the global lock (flag disable_global_lock - see mtmsr/mtmsrd).
-  // This will always succeed if under the global lock, however.
+  // NOTE: without the reservation table we assume we are within a global
+  // lock. As we have been exclusively executing this entire time, we assume
+  // that no one else could have possibly touched the memory and must always
+  // succeed. We use atomic compare exchange here to support reserved
+  // load/store without being under the global lock (flag disable_global_lock
+  // - see mtmsr/mtmsrd). This will always succeed if under the global lock,
+  // however.
 
   Value* ea = CalculateEA_0(f, i.X.RA, i.X.RB);
-  Value* rt = f.ByteSwap(f.Truncate(f.LoadGPR(i.X.RT), INT32_TYPE));
-  Value* res = f.ByteSwap(f.Truncate(f.LoadReserved(), INT32_TYPE));
-  Value* v = f.AtomicCompareExchange(ea, res, rt);
-  f.StoreContext(offsetof(PPCContext, cr0.cr0_eq), v);
+  if (cvars::use_reservation_table) {
+    EmitStoreConditional(
+        f, ea, f.ZeroExtend(f.Truncate(f.LoadGPR(i.X.RT), INT32_TYPE),
+                            INT64_TYPE),
+        f.builtins()->store_conditional_word);
+  } else {
+    Value* rt = f.ByteSwap(f.Truncate(f.LoadGPR(i.X.RT), INT32_TYPE));
+    Value* res = f.ByteSwap(f.Truncate(f.LoadReserved(), INT32_TYPE));
+    Value* v = f.AtomicCompareExchange(ea, res, rt);
+    f.StoreContext(offsetof(PPCContext, cr0.cr0_eq), v);
+  }
   f.StoreContext(offsetof(PPCContext, cr0.cr0_lt), f.LoadZeroInt8());
   f.StoreContext(offsetof(PPCContext, cr0.cr0_gt), f.LoadZeroInt8());
 
@@ -1140,8 +1203,15 @@ int InstrEmit_dcbz128(PPCHIRBuilder& f, const InstrData& i) {
 }
 
 int InstrEmit_icbi(PPCHIRBuilder& f, const InstrData& i) {
-  // XEINSTRNOTIMPLEMENTED();
-  f.Nop();
+  // Guest code has changed the code in the block, so anything compiled from
+  // it must be compiled again.
+  if (cvars::invalidate_code_on_icbi) {
+    Value* ea = CalculateEA_0(f, i.X.RA, i.X.RB);
+    f.StoreContext(offsetof(PPCContext, scratch), ea);
+    f.CallExtern(f.builtins()->invalidate_code);
+  } else {
+    f.Nop();
+  }
   return 0;
 }
 
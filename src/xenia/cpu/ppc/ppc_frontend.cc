@@ -10,8 +10,10 @@
 #include "xenia/cpu/ppc/ppc_frontend.h"
 
 #include "xenia/base/atomic.h"
+#include "xenia/base/byte_order.h"
 #include "xenia/cpu/ppc/ppc_context.h"
 #include "xenia/cpu/ppc/ppc_emit.h"
+#include "xenia/cpu/ppc/ppc_interpreter.h"
 #include "xenia/cpu/ppc/ppc_opcode_info.h"
 #include "xenia/cpu/ppc/ppc_translator.h"
 #include "xenia/cpu/processor.h"
@@ -36,6 +38,10 @@ void InitializeIfNeeded() {
   RegisterEmitCategoryFPU();
   RegisterEmitCategoryMemory();
 
+  RegisterInterpretCategoryALU();
+  RegisterInterpretCategoryControl();
+  RegisterInterpretCategoryMemory();
+
   atexit(CleanupOnShutdown);
 }
 
@@ -43,6 +49,7 @@ void CleanupOnShutdown() {}
 
 PPCFrontend::PPCFrontend(Processor* processor) : processor_(processor) {
   InitializeIfNeeded();
+  interpreter_ = std::make_unique<PPCInterpreter>(this);
 }
 
 PPCFrontend::~PPCFrontend() {
@@ -84,6 +91,36 @@ void LeaveGlobalLock(PPCContext* ppc_context, void* arg0, void* arg1) {
   global_mutex->unlock();
 }
 
+// Takes a reservation on the address in scratch.
+void Reserve(PPCContext* ppc_context, void* arg0, void* arg1) {
+  auto reservation_table = reinterpret_cast<ReservationTable*>(arg0);
+  uint32_t address = static_cast<uint32_t>(ppc_context->scratch);
+  ppc_context->reserved_address = address;
+  ppc_context->reserved_version = reservation_table->Reserve(address);
+}
+
+// Stores scratch to the reserved address if the reservation still holds, and
+// sets scratch to whether it did.
+template <typename T>
+void StoreConditional(PPCContext* ppc_context, void* arg0, void* arg1) {
+  auto reservation_table = reinterpret_cast<ReservationTable*>(arg0);
+  uint32_t address = ppc_context->reserved_address;
+  auto host_address =
+      ppc_context->processor->memory()->TranslateVirtual<T*>(address);
+  bool stored = reservation_table->StoreConditional(
+      address, ppc_context->reserved_version, host_address,
+      xe::byte_swap(static_cast<T>(ppc_context->reserved_val)),
+      xe::byte_swap(static_cast<T>(ppc_context->scratch)));
+  ppc_context->scratch = stored ? 1 : 0;
+}
+
+// Drops functions compiled from the 128-byte block holding the address in
+// scratch.
+void InvalidateCode(PPCContext* ppc_context, void* arg0, void* arg1) {
+  uint32_t address = static_cast<uint32_t>(ppc_context->scratch) & ~127u;
+  ppc_context->processor->InvalidateCodeRange(address, address + 128);
+}
+
 bool PPCFrontend::Initialize() {
   void* arg0 = reinterpret_cast<void*>(&xe::global_critical_region::mutex());
   void* arg1 = reinterpret_cast<void*>(&builtins_.global_lock_count);
@@ -93,6 +130,19 @@ bool PPCFrontend::Initialize() {
       processor_->DefineBuiltin("EnterGlobalLock", EnterGlobalLock, arg0, arg1);
   builtins_.leave_global_lock =
       processor_->DefineBuiltin("LeaveGlobalLock", LeaveGlobalLock, arg0, arg1);
+  void* reservation_table = processor_->reservation_table();
+  builtins_.reserve = processor_->DefineBuiltin("Reserve", Reserve,
+                                                reservation_table, nullptr);
+  builtins_.store_conditional_word =
+      processor_->DefineBuiltin("StoreConditionalWord",
+                                StoreConditional<uint32_t>, reservation_table,
+                                nullptr);
+  builtins_.store_conditional_doubleword =
+      processor_->DefineBuiltin("StoreConditionalDoubleword",
+                                StoreConditional<uint64_t>, reservation_table,
+                                nullptr);
+  builtins_.invalidate_code = processor_->DefineBuiltin(
+      "InvalidateCode", InvalidateCode, nullptr, nullptr);
   return true;
 }
 
@@ -107,12 +157,24 @@ bool PPCFrontend::DeclareFunction(GuestFunction* function) {
 
 bool PPCFrontend::DefineFunction(GuestFunction* function,
                                  uint32_t debug_info_flags) {
+  if (interpreter_->Prepare(function, debug_info_flags)) {
+    return true;
+  }
+  return CompileFunction(function, debug_info_flags);
+}
+
+bool PPCFrontend::CompileFunction(GuestFunction* function,
+                                  uint32_t debug_info_flags) {
   auto translator = translator_pool_.Allocate(this);
   bool result = translator->Translate(function, debug_info_flags);
   translator_pool_.Release(translator);
   return result;
 }
 
+void PPCFrontend::ReleaseFunction(GuestFunction* function) {
+  interpreter_->Release(function);
+}
+
 }  // namespace ppc
 }  // namespace cpu
 }  // namespace xe
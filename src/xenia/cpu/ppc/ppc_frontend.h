@@ -26,6 +26,7 @@ namespace xe {
 namespace cpu {
 namespace ppc {
 
+class PPCInterpreter;
 class PPCTranslator;
 
 struct PPCBuiltins {
@@ -33,6 +34,10 @@ struct PPCBuiltins {
   Function* check_global_lock;
   Function* enter_global_lock;
   Function* leave_global_lock;
+  Function* reserve;
+  Function* store_conditional_word;
+  Function* store_conditional_doubleword;
+  Function* invalidate_code;
 };
 
 class PPCFrontend {
@@ -46,12 +51,19 @@ class PPCFrontend {
   Memory* memory() const;
   PPCBuiltins* builtins() { return &builtins_; }
 
+  PPCInterpreter* interpreter() const { return interpreter_.get(); }
+
   bool DeclareFunction(GuestFunction* function);
+  // Sets the function up to be interpreted where possible, or compiles it.
   bool DefineFunction(GuestFunction* function, uint32_t debug_info_flags);
+  bool CompileFunction(GuestFunction* function, uint32_t debug_info_flags);
+  // Frees anything kept for the function, once nothing can be running it.
+  void ReleaseFunction(GuestFunction* function);
 
  private:
   Processor* processor_;
   PPCBuiltins builtins_ = {0};
+  std::unique_ptr<PPCInterpreter> interpreter_;
   TypePool<PPCTranslator, PPCFrontend*> translator_pool_;
 };
 
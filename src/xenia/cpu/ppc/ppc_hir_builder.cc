@@ -14,12 +14,14 @@
 
 #include "xenia/base/byte_order.h"
 #include "xenia/base/logging.h"
+#include "xenia/base/math.h"
 #include "xenia/base/memory.h"
 #include "xenia/base/profiling.h"
 #include "xenia/cpu/cpu_flags.h"
 #include "xenia/cpu/hir/label.h"
 #include "xenia/cpu/ppc/ppc_context.h"
 #include "xenia/cpu/ppc/ppc_decode_data.h"
+#include "xenia/cpu/ppc/ppc_emit.h"
 #include "xenia/cpu/ppc/ppc_frontend.h"
 #include "xenia/cpu/ppc/ppc_opcode_info.h"
 #include "xenia/cpu/processor.h"
@@ -68,6 +70,7 @@ void PPCHIRBuilder::Reset() {
   instr_count_ = 0;
   instr_offset_list_ = NULL;
   label_list_ = NULL;
+  fpscr_update_pending_ = false;
   with_debug_info_ = false;
   HIRBuilder::Reset();
 }
@@ -103,6 +106,14 @@ bool PPCHIRBuilder::Emit(GuestFunction* function, uint32_t flags) {
   // Always mark entry with label.
   label_list_[0] = NewLabel();
 
+  fpscr_update_pending_ = false;
+  if (cvars::lazy_fpscr_updates || cvars::recognize_idioms) {
+    MarkBranchTargets();
+  }
+  // Instructions left to skip because they've already been emitted as part of
+  // an idiom.
+  uint32_t idiom_remaining = 0;
+
   uint32_t start_address = function_->address();
   uint32_t end_address = function_->end_address();
   for (uint32_t address = start_address, offset = 0; address <= end_address;
@@ -118,6 +129,7 @@ bool PPCHIRBuilder::Emit(GuestFunction* function, uint32_t flags) {
     // as needed.
     Label* label = label_list_[offset];
     if (label) {
+      FlushFPSCRUpdate();
       MarkLabel(label);
     }
 
@@ -151,6 +163,16 @@ bool PPCHIRBuilder::Emit(GuestFunction* function, uint32_t flags) {
     }
     ++opcode_translation_counts[static_cast<int>(opcode)];
 
+    if (idiom_remaining) {
+      --idiom_remaining;
+      continue;
+    }
+
+    if (opcode_info.group == PPCOpcodeGroup::kB ||
+        opcode_info.type == PPCOpcodeType::kSync) {
+      FlushFPSCRUpdate();
+    }
+
     // Synchronize the PPC context as required.
     // This will ensure all registers are saved to the PPC context before this
     // instruction executes.
@@ -165,7 +187,15 @@ bool PPCHIRBuilder::Emit(GuestFunction* function, uint32_t flags) {
     i.code = code;
     i.opcode = opcode;
     i.opcode_info = &opcode_info;
-    if (!opcode_info.emit || opcode_info.emit(*this, i)) {
+    uint32_t idiom_length = 0;
+    if (cvars::recognize_idioms) {
+      InstrData next[kMaxIdiomLookahead];
+      uint32_t next_count = GetIdiomLookahead(offset, next);
+      idiom_length = EmitIdiom(*this, i, next, next_count);
+    }
+    if (idiom_length) {
+      idiom_remaining = idiom_length - 1;
+    } else if (!opcode_info.emit || opcode_info.emit(*this, i)) {
       auto& disasm_info = GetOpcodeDisasmInfo(opcode);
       XELOGE("Unimplemented instr %.8llX %.8X %s", address, code,
              disasm_info.name);
@@ -174,6 +204,8 @@ bool PPCHIRBuilder::Emit(GuestFunction* function, uint32_t flags) {
     }
   }
 
+  FlushFPSCRUpdate();
+
   if (false) {
     DumpAllOpcodeCounts();
   }
@@ -181,11 +213,65 @@ bool PPCHIRBuilder::Emit(GuestFunction* function, uint32_t flags) {
   return Finalize();
 }
 
+void PPCHIRBuilder::MarkBranchTargets() {
+  // Labels for backward branches would otherwise be inserted after the code
+  // they precede has been emitted, possibly in the middle of a pending FPSCR
+  // update or of an idiom, so create all of them up front.
+  Memory* memory = frontend_->memory();
+  for (uint32_t address = function_->address();
+       address <= function_->end_address(); address += 4) {
+    PPCDecodeData d;
+    d.address = address;
+    d.code = xe::load_and_swap<uint32_t>(memory->TranslateVirtual(address));
+    uint32_t target;
+    switch (LookupOpcode(d.code)) {
+      case PPCOpcode::bx:
+        target = d.I.ADDR();
+        break;
+      case PPCOpcode::bcx:
+        target = d.B.ADDR();
+        break;
+      default:
+        continue;
+    }
+    if (target < function_->address() || target > function_->end_address()) {
+      continue;
+    }
+    size_t target_offset = (target - function_->address()) / 4;
+    if (!label_list_[target_offset]) {
+      label_list_[target_offset] = NewLabel();
+    }
+  }
+}
+
+uint32_t PPCHIRBuilder::GetIdiomLookahead(uint32_t offset, InstrData* next) {
+  // Idioms can't span branch targets (all known up front, marked by
+  // MarkBranchTargets) or hide the --break-on-instruction target.
+  Memory* memory = frontend_->memory();
+  uint32_t count = 0;
+  for (; count < kMaxIdiomLookahead; ++count) {
+    uint32_t next_offset = offset + 1 + count;
+    uint32_t address = start_address_ + next_offset * 4;
+    if (next_offset >= instr_count_ || label_list_[next_offset] ||
+        address == cvars::break_on_instruction) {
+      break;
+    }
+    InstrData& i = next[count];
+    i.address = address;
+    i.code = xe::load_and_swap<uint32_t>(memory->TranslateVirtual(address));
+    i.opcode = LookupOpcode(i.code);
+    i.opcode_info = &GetOpcodeInfo(i.opcode);
+  }
+  return count;
+}
+
 void PPCHIRBuilder::MaybeBreakOnInstruction(uint32_t address) {
   if (address != cvars::break_on_instruction) {
     return;
   }
 
+  FlushFPSCRUpdate();
+
   Comment("--break-on-instruction target");
 
   if (cvars::break_condition_gpr < 0) {
@@ -238,6 +324,11 @@ Function* PPCHIRBuilder::LookupFunction(uint32_t address) {
   return frontend_->processor()->LookupFunction(address);
 }
 
+void PPCHIRBuilder::BindImportThunk(Function* thunk) {
+  frontend_->processor()->BindImportThunk(thunk->address(),
+                                          function_->address());
+}
+
 Label* PPCHIRBuilder::LookupLabel(uint32_t address) {
   if (address < start_address_) {
     return nullptr;
@@ -283,13 +374,22 @@ Value* PPCHIRBuilder::LoadLR() {
   return LoadContext(offsetof(PPCContext, lr), INT64_TYPE);
 }
 
+void PPCHIRBuilder::TraceDest(uint32_t reg, Value* value) {
+  // Inlined save/restore helpers store many registers for one instruction,
+  // and only the first are kept.
+  if (trace_info_.dest_count >= xe::countof(trace_info_.dests)) {
+    return;
+  }
+  auto& trace_reg = trace_info_.dests[trace_info_.dest_count++];
+  trace_reg.reg = uint8_t(reg);
+  trace_reg.value = value;
+}
+
 void PPCHIRBuilder::StoreLR(Value* value) {
   assert_true(value->type == INT64_TYPE);
   StoreContext(offsetof(PPCContext, lr), value);
 
-  auto& trace_reg = trace_info_.dests[trace_info_.dest_count++];
-  trace_reg.reg = 64;
-  trace_reg.value = value;
+  TraceDest(64, value);
 }
 
 Value* PPCHIRBuilder::LoadCTR() {
@@ -300,9 +400,7 @@ void PPCHIRBuilder::StoreCTR(Value* value) {
   assert_true(value->type == INT64_TYPE);
   StoreContext(offsetof(PPCContext, ctr), value);
 
-  auto& trace_reg = trace_info_.dests[trace_info_.dest_count++];
-  trace_reg.reg = 65;
-  trace_reg.value = value;
+  TraceDest(65, value);
 }
 
 Value* PPCHIRBuilder::LoadCR() {
@@ -413,46 +511,52 @@ void PPCHIRBuilder::UpdateCR6(Value* src_value) {
 }
 
 Value* PPCHIRBuilder::LoadFPSCR() {
+  FlushFPSCRUpdate();
   return LoadContext(offsetof(PPCContext, fpscr), INT32_TYPE);
 }
 
 void PPCHIRBuilder::StoreFPSCR(Value* value) {
   assert_true(value->type == INT32_TYPE);
+  // Overwritten entirely, so a pending update would be dead.
+  fpscr_update_pending_ = false;
   StoreContext(offsetof(PPCContext, fpscr), value);
 
-  auto& trace_reg = trace_info_.dests[trace_info_.dest_count++];
-  trace_reg.reg = 67;
-  trace_reg.value = value;
+  TraceDest(67, value);
 }
 
 void PPCHIRBuilder::UpdateFPSCR(Value* result, bool update_cr1) {
   // TODO(benvanik): detect overflow and nan cases.
   // fx and vx are the most important.
-  Value* fx = LoadConstantInt8(0);
-  Value* fex = LoadConstantInt8(0);
-  Value* vx = LoadConstantInt8(0);
-  Value* ox = LoadConstantInt8(0);
-
+  // Until then no exception bits are ever raised, so every update is the same
+  // one: clear FEX and VX, keeping the sticky FX and OX. Any number of them
+  // in a row is equivalent to the last.
   if (update_cr1) {
     // Store into the CR1 field.
     // We do this instead of just calling CopyFPSCRToCR1 so that we don't
     // have to read back the bits and do shifting work.
-    StoreContext(offsetof(PPCContext, cr1.cr1_fx), fx);
-    StoreContext(offsetof(PPCContext, cr1.cr1_fex), fex);
-    StoreContext(offsetof(PPCContext, cr1.cr1_vx), vx);
-    StoreContext(offsetof(PPCContext, cr1.cr1_ox), ox);
+    Value* zero = LoadZeroInt8();
+    StoreContext(offsetof(PPCContext, cr1.cr1_fx), zero);
+    StoreContext(offsetof(PPCContext, cr1.cr1_fex), zero);
+    StoreContext(offsetof(PPCContext, cr1.cr1_vx), zero);
+    StoreContext(offsetof(PPCContext, cr1.cr1_ox), zero);
   }
 
-  // Generate our new bits.
-  Value* new_bits = Shl(ZeroExtend(fx, INT32_TYPE), 31);
-  new_bits = Or(new_bits, Shl(ZeroExtend(fex, INT32_TYPE), 30));
-  new_bits = Or(new_bits, Shl(ZeroExtend(vx, INT32_TYPE), 29));
-  new_bits = Or(new_bits, Shl(ZeroExtend(ox, INT32_TYPE), 28));
+  fpscr_update_pending_ = true;
+  if (!cvars::lazy_fpscr_updates) {
+    FlushFPSCRUpdate();
+  }
+}
 
-  // Mix into fpscr while preserving sticky bits (FX and OX).
-  Value* bits = LoadFPSCR();
-  bits = Or(And(bits, LoadConstantUint32(0x9FFFFFFF)), new_bits);
-  StoreFPSCR(bits);
+void PPCHIRBuilder::FlushFPSCRUpdate() {
+  if (!fpscr_update_pending_) {
+    return;
+  }
+  fpscr_update_pending_ = false;
+  // Not traced through StoreFPSCR as this may be emitted at the start of an
+  // unrelated instruction.
+  Value* bits = LoadContext(offsetof(PPCContext, fpscr), INT32_TYPE);
+  bits = And(bits, LoadConstantUint32(0x9FFFFFFF));
+  StoreContext(offsetof(PPCContext, fpscr), bits);
 }
 
 void PPCHIRBuilder::CopyFPSCRToCR1() {
@@ -487,9 +591,7 @@ void PPCHIRBuilder::StoreCA(Value* value) {
   assert_true(value->type == INT8_TYPE);
   StoreContext(offsetof(PPCContext, xer_ca), value);
 
-  auto& trace_reg = trace_info_.dests[trace_info_.dest_count++];
-  trace_reg.reg = 66;
-  trace_reg.value = value;
+  TraceDest(66, value);
 }
 
 Value* PPCHIRBuilder::LoadSAT() {
@@ -500,9 +602,7 @@ void PPCHIRBuilder::StoreSAT(Value* value) {
   value = Truncate(value, INT8_TYPE);
   StoreContext(offsetof(PPCContext, vscr_sat), value);
 
-  auto& trace_reg = trace_info_.dests[trace_info_.dest_count++];
-  trace_reg.reg = 44;
-  trace_reg.value = value;
+  TraceDest(44, value);
 }
 
 Value* PPCHIRBuilder::LoadGPR(uint32_t reg) {
@@ -513,9 +613,7 @@ void PPCHIRBuilder::StoreGPR(uint32_t reg, Value* value) {
   assert_true(value->type == INT64_TYPE);
   StoreContext(offsetof(PPCContext, r) + reg * 8, value);
 
-  auto& trace_reg = trace_info_.dests[trace_info_.dest_count++];
-  trace_reg.reg = reg;
-  trace_reg.value = value;
+  TraceDest(reg, value);
 }
 
 Value* PPCHIRBuilder::LoadFPR(uint32_t reg) {
@@ -526,9 +624,7 @@ void PPCHIRBuilder::StoreFPR(uint32_t reg, Value* value) {
   assert_true(value->type == FLOAT64_TYPE);
   StoreContext(offsetof(PPCContext, f) + reg * 8, value);
 
-  auto& trace_reg = trace_info_.dests[trace_info_.dest_count++];
-  trace_reg.reg = reg + 32;
-  trace_reg.value = value;
+  TraceDest(reg + 32, value);
 }
 
 Value* PPCHIRBuilder::LoadVR(uint32_t reg) {
@@ -539,9 +635,7 @@ void PPCHIRBuilder::StoreVR(uint32_t reg, Value* value) {
   assert_true(value->type == VEC128_TYPE);
   StoreContext(offsetof(PPCContext, v) + reg * 16, value);
 
-  auto& trace_reg = trace_info_.dests[trace_info_.dest_count++];
-  trace_reg.reg = 128 + reg;
-  trace_reg.value = value;
+  TraceDest(128 + reg, value);
 }
 
 void PPCHIRBuilder::StoreReserved(Value* val) {
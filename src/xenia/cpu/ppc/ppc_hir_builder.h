@@ -18,6 +18,7 @@ namespace xe {
 namespace cpu {
 namespace ppc {
 
+struct InstrData;
 struct PPCBuiltins;
 class PPCFrontend;
 
@@ -42,6 +43,9 @@ class PPCHIRBuilder : public hir::HIRBuilder {
 
   GuestFunction* function() const { return function_; }
   Function* LookupFunction(uint32_t address);
+  // Notes that the function being emitted calls what the import thunk calls
+  // directly instead of calling the thunk.
+  void BindImportThunk(Function* thunk);
   Label* LookupLabel(uint32_t address);
 
   Value* LoadLR();
@@ -59,7 +63,11 @@ class PPCHIRBuilder : public hir::HIRBuilder {
   void UpdateCR6(Value* src_value);
   Value* LoadFPSCR();
   void StoreFPSCR(Value* value);
+  // FPSCR updates from FPU arithmetic are only recorded here and written out
+  // by FlushFPSCRUpdate at the next point guest code could observe FPSCR:
+  // FPSCR accesses, branch targets, branches, calls and traps.
   void UpdateFPSCR(Value* result, bool update_cr1);
+  void FlushFPSCRUpdate();
   void CopyFPSCRToCR1();
   Value* LoadXER();
   void StoreXER(Value* value);
@@ -82,8 +90,13 @@ class PPCHIRBuilder : public hir::HIRBuilder {
   Value* LoadReserved();
 
  private:
+  void MarkBranchTargets();
+  // Decodes up to kMaxIdiomLookahead instructions following the one at the
+  // given offset that an idiom starting there may cover, returning how many.
+  uint32_t GetIdiomLookahead(uint32_t offset, InstrData* next);
   void MaybeBreakOnInstruction(uint32_t address);
   void AnnotateLabel(uint32_t address, Label* label);
+  void TraceDest(uint32_t reg, Value* value);
 
   PPCFrontend* frontend_;
 
@@ -97,6 +110,7 @@ class PPCHIRBuilder : public hir::HIRBuilder {
   uint64_t instr_count_;
   Instr** instr_offset_list_;
   Label** label_list_;
+  bool fpscr_update_pending_;
 
   // Reset each instruction.
   struct {
@@ -0,0 +1,174 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2020 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#ifndef XENIA_CPU_PPC_PPC_INTERPRET_PRIVATE_H_
+#define XENIA_CPU_PPC_PPC_INTERPRET_PRIVATE_H_
+
+#include <atomic>
+#include <cstdint>
+
+#include "xenia/base/memory.h"
+#include "xenia/cpu/mmio_handler.h"
+#include "xenia/cpu/ppc/ppc_context.h"
+#include "xenia/cpu/ppc/ppc_decode_data.h"
+#include "xenia/cpu/ppc/ppc_instr.h"
+#include "xenia/cpu/ppc/ppc_opcode_info.h"
+#include "xenia/memory.h"
+
+namespace xe {
+namespace cpu {
+class Function;
+}  // namespace cpu
+}  // namespace xe
+
+namespace xe {
+namespace cpu {
+namespace ppc {
+
+struct InterpretedFunction;
+
+#define XEREGISTERINTERP(name) \
+  RegisterOpcodeInterpreter(PPCOpcode::name, InstrInterpret_##name);
+
+// A guest instruction decoded for the interpreter.
+struct InterpretedInstr {
+  InstrInterpretFn interpret;
+  InstrData i;
+  // For direct branches within the function, the instruction branched to.
+  const InterpretedInstr* target;
+  // For direct branches out of the function (calls), the address called and
+  // the function there, resolved on first use.
+  uint32_t callee_address;
+  mutable std::atomic<Function*> callee;
+};
+
+// A call of an interpreted function.
+struct InterpreterFrame {
+  PPCContext* context;
+  uint8_t* membase;
+  Memory* memory;
+  InterpretedFunction* function;
+  uint32_t return_address;
+  // Added to guest addresses from 0xE0000000 up, for the 4 KB offset of the
+  // physical memory mapped there where the host can't do it by mapping.
+  uint32_t upper_address_offset;
+  // Loop back-edges taken in this call, towards promoting the function.
+  uint32_t back_edge_count;
+};
+
+inline const InterpretedInstr* Next(const InterpretedInstr* instr) {
+  return instr + 1;
+}
+
+// Takes a direct branch (bx, bcx), either within the function or calling out
+// of it, once LR has been updated for it.
+const InterpretedInstr* TakeBranch(InterpreterFrame& frame,
+                                   const InterpretedInstr* instr, bool lk);
+// Branches to a computed address (bcctrx, bclrx), once LR has been updated.
+// With possible_return, a branch to the return address of the function
+// returns from it.
+const InterpretedInstr* TakeIndirectBranch(InterpreterFrame& frame,
+                                           const InterpretedInstr* instr,
+                                           uint32_t target, bool lk,
+                                           bool possible_return);
+
+// Condition register fields are stored one byte per bit.
+inline uint8_t* CRField(PPCContext* ctx, uint32_t n) {
+  return reinterpret_cast<uint8_t*>(&ctx->cr0) + 4 * n;
+}
+inline uint8_t& CRBit(PPCContext* ctx, uint32_t bi) {
+  return CRField(ctx, bi >> 2)[bi & 3];
+}
+
+template <typename T>
+inline void UpdateCR(PPCContext* ctx, uint32_t n, T lhs, T rhs) {
+  uint8_t* cr = CRField(ctx, n);
+  cr[0] = lhs < rhs;
+  cr[1] = lhs > rhs;
+  cr[2] = lhs == rhs;
+}
+
+// CR0 from the low 32 bits of a result, as the JIT does.
+inline void UpdateCR0(PPCContext* ctx, uint64_t value) {
+  UpdateCR<int32_t>(ctx, 0, int32_t(value), 0);
+}
+
+// Field n of the CR as it is in the 32-bit CR register.
+inline uint64_t LoadCR(PPCContext* ctx, uint32_t n) {
+  const uint8_t* cr = CRField(ctx, n);
+  uint32_t shift = 4 * (7 - n);
+  return (uint64_t(cr[0]) << (shift + 3)) | (uint64_t(cr[1]) << (shift + 2)) |
+         (uint64_t(cr[2]) << (shift + 1)) | (uint64_t(cr[3]) << shift);
+}
+inline void StoreCR(PPCContext* ctx, uint32_t n, uint64_t value) {
+  uint8_t* cr = CRField(ctx, n);
+  uint32_t shift = 4 * (7 - n);
+  cr[0] = (value >> (shift + 3)) & 1;
+  cr[1] = (value >> (shift + 2)) & 1;
+  cr[2] = (value >> (shift + 1)) & 1;
+  cr[3] = (value >> shift) & 1;
+}
+
+// Reads the guest clock, adding the instructions counted so far first when it
+// is virtual.
+uint64_t LoadClock(PPCContext* ctx);
+
+inline uint8_t* HostAddress(const InterpreterFrame& frame, uint64_t ea) {
+  uint32_t address = uint32_t(ea);
+  if (address >= 0xE0000000) {
+    address += frame.upper_address_offset;
+  }
+  return frame.membase + address;
+}
+
+// Guest memory accesses, in guest byte order.
+template <typename T>
+inline T Load(const InterpreterFrame& frame, uint64_t ea) {
+  return xe::load_and_swap<T>(HostAddress(frame, ea));
+}
+template <typename T>
+inline void Store(const InterpreterFrame& frame, uint64_t ea, T value) {
+  xe::store_and_swap<T>(HostAddress(frame, ea), value);
+}
+
+// Registers mapped to MMIO are accessed with 32-bit loads and stores, which
+// are given to the handlers of the range directly instead of faulting.
+inline bool IsMMIOAddress(uint32_t address) {
+  return (address & 0xFF000000) == 0x7F000000;
+}
+template <>
+inline uint32_t Load<uint32_t>(const InterpreterFrame& frame, uint64_t ea) {
+  uint32_t address = uint32_t(ea);
+  if (IsMMIOAddress(address)) {
+    auto range = frame.memory->LookupVirtualMappedRange(address);
+    if (range) {
+      return range->read(frame.context, range->callback_context, address);
+    }
+  }
+  return xe::load_and_swap<uint32_t>(HostAddress(frame, address));
+}
+template <>
+inline void Store<uint32_t>(const InterpreterFrame& frame, uint64_t ea,
+                            uint32_t value) {
+  uint32_t address = uint32_t(ea);
+  if (IsMMIOAddress(address)) {
+    auto range = frame.memory->LookupVirtualMappedRange(address);
+    if (range) {
+      range->write(frame.context, range->callback_context, address, value);
+      return;
+    }
+  }
+  xe::store_and_swap<uint32_t>(HostAddress(frame, address), value);
+}
+
+}  // namespace ppc
+}  // namespace cpu
+}  // namespace xe
+
+#endif  // XENIA_CPU_PPC_PPC_INTERPRET_PRIVATE_H_
@@ -0,0 +1,773 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2020 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include "xenia/cpu/ppc/ppc_interpret-private.h"
+
+#include <algorithm>
+
+#include "xenia/base/math.h"
+#include "xenia/base/platform.h"
+#include "xenia/cpu/ppc/ppc_interpreter.h"
+
+namespace xe {
+namespace cpu {
+namespace ppc {
+
+// Integer arithmetic and logic. These follow what the emitters in
+// ppc_emit_alu.cc generate exactly, including where that differs from the
+// architecture (CR0 from the low 32 bits, CA always from 32-bit carries), so
+// that a function behaves the same before and after it's promoted.
+
+namespace {
+
+inline uint8_t AddDidCarry(uint64_t v1, uint64_t v2) {
+  return uint32_t(v2) > ~uint32_t(v1);
+}
+
+inline uint8_t SubDidCarry(uint64_t v1, uint64_t v2) {
+  return (uint32_t(v1) > ~uint32_t(0 - uint32_t(v2))) || !uint32_t(v2);
+}
+
+inline uint8_t AddWithCarryDidCarry(uint64_t v1, uint64_t v2, uint8_t ca) {
+  uint32_t a = uint32_t(v1);
+  uint32_t b = uint32_t(v2);
+  return (a + b + ca < ca) || (a + b < a);
+}
+
+inline uint64_t Rotl64(uint64_t v, uint32_t sh) {
+  sh &= 0x3F;
+  return sh ? (v << sh) | (v >> (64 - sh)) : v;
+}
+
+// The low word in both halves, as rlw* rotate it.
+inline uint64_t Replicate32(uint64_t v) { return (v << 32) | uint32_t(v); }
+
+inline uint64_t MulHi(uint64_t v1, uint64_t v2) {
+#if XE_COMPILER_MSVC
+  return __umulh(v1, v2);
+#else
+  return uint64_t((unsigned __int128)v1 * v2 >> 64);
+#endif  // XE_COMPILER_MSVC
+}
+
+inline int64_t MulHiSigned(int64_t v1, int64_t v2) {
+#if XE_COMPILER_MSVC
+  return __mulh(v1, v2);
+#else
+  return int64_t((__int128)v1 * v2 >> 64);
+#endif  // XE_COMPILER_MSVC
+}
+
+inline void StoreResult(PPCContext* ctx, uint32_t r, uint64_t v, bool rc) {
+  ctx->r[r] = v;
+  if (rc) {
+    UpdateCR0(ctx, v);
+  }
+}
+
+}  // namespace
+
+// Integer arithmetic (A-3)
+
+const InterpretedInstr* InstrInterpret_addx(InterpreterFrame& frame,
+                                            const InterpretedInstr* instr) {
+  auto ctx = frame.context;
+  const InstrData& i = instr->i;
+  uint64_t v = ctx->r[i.XO.RA] + ctx->r[i.XO.RB];
+  StoreResult(ctx, i.XO.RT, v, i.XO.Rc);
+  return Next(instr);
+}
+
+const InterpretedInstr* InstrInterpret_addcx(InterpreterFrame& frame,
+                                             const InterpretedInstr* instr) {
+  auto ctx = frame.context;
+  const InstrData& i = instr->i;
+  uint64_t ra = ctx->r[i.XO.RA];
+  uint64_t rb = ctx->r[i.XO.RB];
+  ctx->xer_ca = AddDidCarry(ra, rb);
+  StoreResult(ctx, i.XO.RT, ra + rb, i.XO.Rc);
+  return Next(instr);
+}
+
+const InterpretedInstr* InstrInterpret_addex(InterpreterFrame& frame,
+                                             const InterpretedInstr* instr) {
+  auto ctx = frame.context;
+  const InstrData& i = instr->i;
+  uint64_t ra = ctx->r[i.XO.RA];
+  uint64_t rb = ctx->r[i.XO.RB];
+  uint8_t ca = ctx->xer_ca;
+  ctx->xer_ca = AddWithCarryDidCarry(ra, rb, ca);
+  StoreResult(ctx, i.XO.RT, ra + rb + ca, i.XO.Rc);
+  return Next(instr);
+}
+
+const InterpretedInstr* InstrInterpret_addi(InterpreterFrame& frame,
+                                            const InterpretedInstr* instr) {
+  auto ctx = frame.context;
+  const InstrData& i = instr->i;
+  uint64_t si = XEEXTS16(i.D.DS);
+  ctx->r[i.D.RT] = i.D.RA ? ctx->r[i.D.RA] + si : si;
+  return Next(instr);
+}
+
+const InterpretedInstr* InstrInterpret_addic(InterpreterFrame& frame,
+                                             const InterpretedInstr* instr) {
+  auto ctx = frame.context;
+  const InstrData& i = instr->i;
+  uint64_t ra = ctx->r[i.D.RA];
+  uint64_t si = XEEXTS16(i.D.DS);
+  ctx->xer_ca = AddDidCarry(ra, si);
+  ctx->r[i.D.RT] = ra + si;
+  return Next(instr);
+}
+
+const InterpretedInstr* InstrInterpret_addicx(InterpreterFrame& frame,
+                                              const InterpretedInstr* instr) {
+  auto ctx = frame.context;
+  const InstrData& i = instr->i;
+  uint64_t ra = ctx->r[i.D.RA];
+  uint64_t si = XEEXTS16(i.D.DS);
+  ctx->xer_ca = AddDidCarry(ra, si);
+  StoreResult(ctx, i.D.RT, ra + si, true);
+  return Next(instr);
+}
+
+const InterpretedInstr* InstrInterpret_addis(InterpreterFrame& frame,
+                                             const InterpretedInstr* instr) {
+  auto ctx = frame.context;
+  const InstrData& i = instr->i;
+  uint64_t si = uint64_t(XEEXTS16(i.D.DS)) << 16;
+  ctx->r[i.D.RT] = i.D.RA ? ctx->r[i.D.RA] + si : si;
+  return Next(instr);
+}
+
+const InterpretedInstr* InstrInterpret_addmex(InterpreterFrame& frame,
+                                              const InterpretedInstr* instr) {
+  auto ctx = frame.context;
+  const InstrData& i = instr->i;
+  uint64_t ra = ctx->r[i.XO.RA];
+  uint8_t ca = ctx->xer_ca;
+  ctx->xer_ca = AddWithCarryDidCarry(ra, ~0ull, ca);
+  StoreResult(ctx, i.XO.RT, ra + ~0ull + ca, i.XO.Rc);
+  return Next(instr);
+}
+
+const InterpretedInstr* InstrInterpret_addzex(InterpreterFrame& frame,
+                                              const InterpretedInstr* instr) {
+  auto ctx = frame.context;
+  const InstrData& i = instr->i;
+  uint64_t ra = ctx->r[i.XO.RA];
+  uint8_t ca = ctx->xer_ca;
+  ctx->xer_ca = AddWithCarryDidCarry(ra, 0, ca);
+  StoreResult(ctx, i.XO.RT, ra + ca, i.XO.Rc);
+  return Next(instr);
+}
+
+// Divides have no handlers, so functions with them are always compiled. What
+// the JIT gives for a zero divisor (whatever was left in rax) and for the most
+// negative value divided by -1 (a host #DE) can't be reproduced here.
+
+const InterpretedInstr* InstrInterpret_mulhdx(InterpreterFrame& frame,
+                                              const InterpretedInstr* instr) {
+  auto ctx = frame.context;
+  const InstrData& i = instr->i;
+  int64_t v = MulHiSigned(int64_t(ctx->r[i.XO.RA]), int64_t(ctx->r[i.XO.RB]));
+  StoreResult(ctx, i.XO.RT, uint64_t(v), i.XO.Rc);
+  return Next(instr);
+}
+
+const InterpretedInstr* InstrInterpret_mulhdux(InterpreterFrame& frame,
+                                               const InterpretedInstr* instr) {
+  auto ctx = frame.context;
+  const InstrData& i = instr->i;
+  uint64_t v = MulHi(ctx->r[i.XO.RA], ctx->r[i.XO.RB]);
+  StoreResult(ctx, i.XO.RT, v, i.XO.Rc);
+  return Next(instr);
+}
+
+const InterpretedInstr* InstrInterpret_mulhwx(InterpreterFrame& frame,
+                                              const InterpretedInstr* instr) {
+  auto ctx = frame.context;
+  const InstrData& i = instr->i;
+  int64_t v = int64_t(int32_t(ctx->r[i.XO.RA])) * int32_t(ctx->r[i.XO.RB]);
+  StoreResult(ctx, i.XO.RT, uint64_t(int64_t(int32_t(v >> 32))), i.XO.Rc);
+  return Next(instr);
+}
+
+const InterpretedInstr* InstrInterpret_mulhwux(InterpreterFrame& frame,
+                                               const InterpretedInstr* instr) {
+  auto ctx = frame.context;
+  const InstrData& i = instr->i;
+  uint64_t v = uint64_t(uint32_t(ctx->r[i.XO.RA])) * uint32_t(ctx->r[i.XO.RB]);
+  StoreResult(ctx, i.XO.RT, v >> 32, i.XO.Rc);
+  return Next(instr);
+}
+
+const InterpretedInstr* InstrInterpret_mulldx(InterpreterFrame& frame,
+                                              const InterpretedInstr* instr) {
+  auto ctx = frame.context;
+  const InstrData& i = instr->i;
+  StoreResult(ctx, i.XO.RT, ctx->r[i.XO.RA] * ctx->r[i.XO.RB], i.XO.Rc);
+  return Next(instr);
+}
+
+const InterpretedInstr* InstrInterpret_mulli(InterpreterFrame& frame,
+                                             const InterpretedInstr* instr) {
+  auto ctx = frame.context;
+  const InstrData& i = instr->i;
+  ctx->r[i.D.RT] = ctx->r[i.D.RA] * uint64_t(XEEXTS16(i.D.DS));
+  return Next(instr);
+}
+
+const InterpretedInstr* InstrInterpret_mullwx(InterpreterFrame& frame,
+                                              const InterpretedInstr* instr) {
+  auto ctx = frame.context;
+  const InstrData& i = instr->i;
+  int64_t v = int64_t(int32_t(ctx->r[i.XO.RA])) * int32_t(ctx->r[i.XO.RB]);
+  StoreResult(ctx, i.XO.RT, uint64_t(v), i.XO.Rc);
+  return Next(instr);
+}
+
+const InterpretedInstr* InstrInterpret_negx(InterpreterFrame& frame,
+                                            const InterpretedInstr* instr) {
+  auto ctx = frame.context;
+  const InstrData& i = instr->i;
+  StoreResult(ctx, i.XO.RT, 0 - ctx->r[i.XO.RA], i.XO.Rc);
+  return Next(instr);
+}
+
+const InterpretedInstr* InstrInterpret_subfx(InterpreterFrame& frame,
+                                             const InterpretedInstr* instr) {
+  auto ctx = frame.context;
+  const InstrData& i = instr->i;
+  StoreResult(ctx, i.XO.RT, ctx->r[i.XO.RB] - ctx->r[i.XO.RA], i.XO.Rc);
+  return Next(instr);
+}
+
+const InterpretedInstr* InstrInterpret_subfcx(InterpreterFrame& frame,
+                                              const InterpretedInstr* instr) {
+  auto ctx = frame.context;
+  const InstrData& i = instr->i;
+  uint64_t ra = ctx->r[i.XO.RA];
+  uint64_t rb = ctx->r[i.XO.RB];
+  ctx->xer_ca = SubDidCarry(rb, ra);
+  StoreResult(ctx, i.XO.RT, rb - ra, i.XO.Rc);
+  return Next(instr);
+}
+
+const InterpretedInstr* InstrInterpret_subficx(InterpreterFrame& frame,
+                                               const InterpretedInstr* instr) {
+  auto ctx = frame.context;
+  const InstrData& i = instr->i;
+  uint64_t ra = ctx->r[i.D.RA];
+  uint64_t si = XEEXTS16(i.D.DS);
+  ctx->xer_ca = SubDidCarry(si, ra);
+  ctx->r[i.D.RT] = si - ra;
+  return Next(instr);
+}
+
+const InterpretedInstr* InstrInterpret_subfex(InterpreterFrame& frame,
+                                              const InterpretedInstr* instr) {
+  auto ctx = frame.context;
+  const InstrData& i = instr->i;
+  uint64_t not_ra = ~ctx->r[i.XO.RA];
+  uint64_t rb = ctx->r[i.XO.RB];
+  uint8_t ca = ctx->xer_ca;
+  ctx->xer_ca = AddWithCarryDidCarry(not_ra, rb, ca);
+  StoreResult(ctx, i.XO.RT, not_ra + rb + ca, i.XO.Rc);
+  return Next(instr);
+}
+
+const InterpretedInstr* InstrInterpret_subfmex(InterpreterFrame& frame,
+                                               const InterpretedInstr* instr) {
+  auto ctx = frame.context;
+  const InstrData& i = instr->i;
+  uint64_t not_ra = ~ctx->r[i.XO.RA];
+  uint8_t ca = ctx->xer_ca;
+  ctx->xer_ca = AddWithCarryDidCarry(not_ra, ~0ull, ca);
+  StoreResult(ctx, i.XO.RT, not_ra + ~0ull + ca, i.XO.Rc);
+  return Next(instr);
+}
+
+const InterpretedInstr* InstrInterpret_subfzex(InterpreterFrame& frame,
+                                               const InterpretedInstr* instr) {
+  auto ctx = frame.context;
+  const InstrData& i = instr->i;
+  uint64_t not_ra = ~ctx->r[i.XO.RA];
+  uint8_t ca = ctx->xer_ca;
+  ctx->xer_ca = AddWithCarryDidCarry(not_ra, 0, ca);
+  StoreResult(ctx, i.XO.RT, not_ra + ca, i.XO.Rc);
+  return Next(instr);
+}
+
+// Integer compare (A-4)
+
+const InterpretedInstr* InstrInterpret_cmp(InterpreterFrame& frame,
+                                           const InterpretedInstr* instr) {
+  auto ctx = frame.context;
+  const InstrData& i = instr->i;
+  uint32_t bf = i.X.RT >> 2;
+  uint64_t ra = ctx->r[i.X.RA];
+  uint64_t rb = ctx->r[i.X.RB];
+  if (i.X.RT & 1) {
+    UpdateCR<int64_t>(ctx, bf, int64_t(ra), int64_t(rb));
+  } else {
+    UpdateCR<int32_t>(ctx, bf, int32_t(ra), int32_t(rb));
+  }
+  return Next(instr);
+}
+
+const InterpretedInstr* InstrInterpret_cmpi(InterpreterFrame& frame,
+                                            const InterpretedInstr* instr) {
+  auto ctx = frame.context;
+  const InstrData& i = instr->i;
+  uint32_t bf = i.D.RT >> 2;
+  uint64_t ra = ctx->r[i.D.RA];
+  int64_t si = XEEXTS16(i.D.DS);
+  if (i.D.RT & 1) {
+    UpdateCR<int64_t>(ctx, bf, int64_t(ra), si);
+  } else {
+    UpdateCR<int32_t>(ctx, bf, int32_t(ra), int32_t(si));
+  }
+  return Next(instr);
+}
+
+const InterpretedInstr* InstrInterpret_cmpl(InterpreterFrame& frame,
+                                            const InterpretedInstr* instr) {
+  auto ctx = frame.context;
+  const InstrData& i = instr->i;
+  uint32_t bf = i.X.RT >> 2;
+  uint64_t ra = ctx->r[i.X.RA];
+  uint64_t rb = ctx->r[i.X.RB];
+  if (i.X.RT & 1) {
+    UpdateCR<uint64_t>(ctx, bf, ra, rb);
+  } else {
+    UpdateCR<uint32_t>(ctx, bf, uint32_t(ra), uint32_t(rb));
+  }
+  return Next(instr);
+}
+
+const InterpretedInstr* InstrInterpret_cmpli(InterpreterFrame& frame,
+                                             const InterpretedInstr* instr) {
+  auto ctx = frame.context;
+  const InstrData& i = instr->i;
+  uint32_t bf = i.D.RT >> 2;
+  uint64_t ra = ctx->r[i.D.RA];
+  uint64_t ui = XEEXTZ16(i.D.DS);
+  if (i.D.RT & 1) {
+    UpdateCR<uint64_t>(ctx, bf, ra, ui);
+  } else {
+    UpdateCR<uint32_t>(ctx, bf, uint32_t(ra), uint32_t(ui));
+  }
+  return Next(instr);
+}
+
+// Integer logical (A-5)
+
+const InterpretedInstr* InstrInterpret_andx(InterpreterFrame& frame,
+                                            const InterpretedInstr* instr) {
+  auto ctx = frame.context;
+  const InstrData& i = instr->i;
+  StoreResult(ctx, i.X.RA, ctx->r[i.X.RT] & ctx->r[i.X.RB], i.X.Rc);
+  return Next(instr);
+}
+
+const InterpretedInstr* InstrInterpret_andcx(InterpreterFrame& frame,
+                                             const InterpretedInstr* instr) {
+  auto ctx = frame.context;
+  const InstrData& i = instr->i;
+  StoreResult(ctx, i.X.RA, ctx->r[i.X.RT] & ~ctx->r[i.X.RB], i.X.Rc);
+  return Next(instr);
+}
+
+const InterpretedInstr* InstrInterpret_andix(InterpreterFrame& frame,
+                                             const InterpretedInstr* instr) {
+  auto ctx = frame.context;
+  const InstrData& i = instr->i;
+  StoreResult(ctx, i.D.RA, ctx->r[i.D.RT] & XEEXTZ16(i.D.DS), true);
+  return Next(instr);
+}
+
+const InterpretedInstr* InstrInterpret_andisx(InterpreterFrame& frame,
+                                              const InterpretedInstr* instr) {
+  auto ctx = frame.context;
+  const InstrData& i = instr->i;
+  StoreResult(ctx, i.D.RA, ctx->r[i.D.RT] & (XEEXTZ16(i.D.DS) << 16), true);
+  return Next(instr);
+}
+
+const InterpretedInstr* InstrInterpret_cntlzdx(InterpreterFrame& frame,
+                                               const InterpretedInstr* instr) {
+  auto ctx = frame.context;
+  const InstrData& i = instr->i;
+  StoreResult(ctx, i.X.RA, xe::lzcnt(ctx->r[i.X.RT]), i.X.Rc);
+  return Next(instr);
+}
+
+const InterpretedInstr* InstrInterpret_cntlzwx(InterpreterFrame& frame,
+                                               const InterpretedInstr* instr) {
+  auto ctx = frame.context;
+  const InstrData& i = instr->i;
+  StoreResult(ctx, i.X.RA, xe::lzcnt(uint32_t(ctx->r[i.X.RT])), i.X.Rc);
+  return Next(instr);
+}
+
+const InterpretedInstr* InstrInterpret_eqvx(InterpreterFrame& frame,
+                                            const InterpretedInstr* instr) {
+  auto ctx = frame.context;
+  const InstrData& i = instr->i;
+  StoreResult(ctx, i.X.RA, ~(ctx->r[i.X.RT] ^ ctx->r[i.X.RB]), i.X.Rc);
+  return Next(instr);
+}
+
+const InterpretedInstr* InstrInterpret_extsbx(InterpreterFrame& frame,
+                                              const InterpretedInstr* instr) {
+  auto ctx = frame.context;
+  const InstrData& i = instr->i;
+  StoreResult(ctx, i.X.RA, uint64_t(int64_t(int8_t(ctx->r[i.X.RT]))), i.X.Rc);
+  return Next(instr);
+}
+
+const InterpretedInstr* InstrInterpret_extshx(InterpreterFrame& frame,
+                                              const InterpretedInstr* instr) {
+  auto ctx = frame.context;
+  const InstrData& i = instr->i;
+  StoreResult(ctx, i.X.RA, uint64_t(int64_t(int16_t(ctx->r[i.X.RT]))), i.X.Rc);
+  return Next(instr);
+}
+
+const InterpretedInstr* InstrInterpret_extswx(InterpreterFrame& frame,
+                                              const InterpretedInstr* instr) {
+  auto ctx = frame.context;
+  const InstrData& i = instr->i;
+  StoreResult(ctx, i.X.RA, uint64_t(int64_t(int32_t(ctx->r[i.X.RT]))), i.X.Rc);
+  return Next(instr);
+}
+
+const InterpretedInstr* InstrInterpret_nandx(InterpreterFrame& frame,
+                                             const InterpretedInstr* instr) {
+  auto ctx = frame.context;
+  const InstrData& i = instr->i;
+  StoreResult(ctx, i.X.RA, ~(ctx->r[i.X.RT] & ctx->r[i.X.RB]), i.X.Rc);
+  return Next(instr);
+}
+
+const InterpretedInstr* InstrInterpret_norx(InterpreterFrame& frame,
+                                            const InterpretedInstr* instr) {
+  auto ctx = frame.context;
+  const InstrData& i = instr->i;
+  StoreResult(ctx, i.X.RA, ~(ctx->r[i.X.RT] | ctx->r[i.X.RB]), i.X.Rc);
+  return Next(instr);
+}
+
+const InterpretedInstr* InstrInterpret_orx(InterpreterFrame& frame,
+                                           const InterpretedInstr* instr) {
+  auto ctx = frame.context;
+  const InstrData& i = instr->i;
+  StoreResult(ctx, i.X.RA, ctx->r[i.X.RT] | ctx->r[i.X.RB], i.X.Rc);
+  return Next(instr);
+}
+
+const InterpretedInstr* InstrInterpret_orcx(InterpreterFrame& frame,
+                                            const InterpretedInstr* instr) {
+  auto ctx = frame.context;
+  const InstrData& i = instr->i;
+  StoreResult(ctx, i.X.RA, ctx->r[i.X.RT] | ~ctx->r[i.X.RB], i.X.Rc);
+  return Next(instr);
+}
+
+const InterpretedInstr* InstrInterpret_ori(InterpreterFrame& frame,
+                                           const InterpretedInstr* instr) {
+  auto ctx = frame.context;
+  const InstrData& i = instr->i;
+  ctx->r[i.D.RA] = ctx->r[i.D.RT] | XEEXTZ16(i.D.DS);
+  return Next(instr);
+}
+
+const InterpretedInstr* InstrInterpret_oris(InterpreterFrame& frame,
+                                            const InterpretedInstr* instr) {
+  auto ctx = frame.context;
+  const InstrData& i = instr->i;
+  ctx->r[i.D.RA] = ctx->r[i.D.RT] | (XEEXTZ16(i.D.DS) << 16);
+  return Next(instr);
+}
+
+const InterpretedInstr* InstrInterpret_xorx(InterpreterFrame& frame,
+                                            const InterpretedInstr* instr) {
+  auto ctx = frame.context;
+  const InstrData& i = instr->i;
+  StoreResult(ctx, i.X.RA, ctx->r[i.X.RT] ^ ctx->r[i.X.RB], i.X.Rc);
+  return Next(instr);
+}
+
+const InterpretedInstr* InstrInterpret_xori(InterpreterFrame& frame,
+                                            const InterpretedInstr* instr) {
+  auto ctx = frame.context;
+  const InstrData& i = instr->i;
+  ctx->r[i.D.RA] = ctx->r[i.D.RT] ^ XEEXTZ16(i.D.DS);
+  return Next(instr);
+}
+
+const InterpretedInstr* InstrInterpret_xoris(InterpreterFrame& frame,
+                                             const InterpretedInstr* instr) {
+  auto ctx = frame.context;
+  const InstrData& i = instr->i;
+  ctx->r[i.D.RA] = ctx->r[i.D.RT] ^ (XEEXTZ16(i.D.DS) << 16);
+  return Next(instr);
+}
+
+// Integer rotate (A-6)
+
+const InterpretedInstr* InstrInterpret_rldclx(InterpreterFrame& frame,
+                                              const InterpretedInstr* instr) {
+  auto ctx = frame.context;
+  const InstrData& i = instr->i;
+  uint32_t n = ctx->r[i.MDS.RB] & 0x3F;
+  uint32_t mb = (i.MDS.MB5 << 5) | i.MDS.MB;
+  uint64_t v = Rotl64(ctx->r[i.MDS.RT], n) & XEMASK(mb, 63);
+  StoreResult(ctx, i.MDS.RA, v, i.MDS.Rc);
+  return Next(instr);
+}
+
+const InterpretedInstr* InstrInterpret_rldcrx(InterpreterFrame& frame,
+                                              const InterpretedInstr* instr) {
+  auto ctx = frame.context;
+  const InstrData& i = instr->i;
+  uint32_t n = ctx->r[i.MDS.RB] & 0x3F;
+  uint32_t me = (i.MDS.MB5 << 5) | i.MDS.MB;
+  uint64_t v = Rotl64(ctx->r[i.MDS.RT], n) & XEMASK(0, me);
+  StoreResult(ctx, i.MDS.RA, v, i.MDS.Rc);
+  return Next(instr);
+}
+
+const InterpretedInstr* InstrInterpret_rldiclx(InterpreterFrame& frame,
+                                               const InterpretedInstr* instr) {
+  auto ctx = frame.context;
+  const InstrData& i = instr->i;
+  uint32_t sh = (i.MD.SH5 << 5) | i.MD.SH;
+  uint32_t mb = (i.MD.MB5 << 5) | i.MD.MB;
+  uint64_t v = Rotl64(ctx->r[i.MD.RT], sh) & XEMASK(mb, 63);
+  StoreResult(ctx, i.MD.RA, v, i.MD.Rc);
+  return Next(instr);
+}
+
+const InterpretedInstr* InstrInterpret_rldicrx(InterpreterFrame& frame,
+                                               const InterpretedInstr* instr) {
+  auto ctx = frame.context;
+  const InstrData& i = instr->i;
+  uint32_t sh = (i.MD.SH5 << 5) | i.MD.SH;
+  uint32_t me = (i.MD.MB5 << 5) | i.MD.MB;
+  uint64_t v = Rotl64(ctx->r[i.MD.RT], sh) & XEMASK(0, me);
+  StoreResult(ctx, i.MD.RA, v, i.MD.Rc);
+  return Next(instr);
+}
+
+const InterpretedInstr* InstrInterpret_rldimix(InterpreterFrame& frame,
+                                               const InterpretedInstr* instr) {
+  auto ctx = frame.context;
+  const InstrData& i = instr->i;
+  uint32_t sh = (i.MD.SH5 << 5) | i.MD.SH;
+  uint32_t mb = (i.MD.MB5 << 5) | i.MD.MB;
+  uint64_t m = XEMASK(mb, ~sh);
+  uint64_t v = (Rotl64(ctx->r[i.MD.RT], sh) & m) | (ctx->r[i.MD.RA] & ~m);
+  StoreResult(ctx, i.MD.RA, v, i.MD.Rc);
+  return Next(instr);
+}
+
+const InterpretedInstr* InstrInterpret_rlwimix(InterpreterFrame& frame,
+                                               const InterpretedInstr* instr) {
+  auto ctx = frame.context;
+  const InstrData& i = instr->i;
+  uint64_t m = XEMASK(i.M.MB + 32, i.M.ME + 32);
+  uint64_t v = (Rotl64(Replicate32(ctx->r[i.M.RT]), i.M.SH) & m) |
+               (ctx->r[i.M.RA] & ~m);
+  StoreResult(ctx, i.M.RA, v, i.M.Rc);
+  return Next(instr);
+}
+
+const InterpretedInstr* InstrInterpret_rlwinmx(InterpreterFrame& frame,
+                                               const InterpretedInstr* instr) {
+  auto ctx = frame.context;
+  const InstrData& i = instr->i;
+  uint64_t v = Rotl64(Replicate32(ctx->r[i.M.RT]), i.M.SH) &
+               XEMASK(i.M.MB + 32, i.M.ME + 32);
+  StoreResult(ctx, i.M.RA, v, i.M.Rc);
+  return Next(instr);
+}
+
+const InterpretedInstr* InstrInterpret_rlwnmx(InterpreterFrame& frame,
+                                              const InterpretedInstr* instr) {
+  auto ctx = frame.context;
+  const InstrData& i = instr->i;
+  // SH holds RB.
+  uint32_t sh = ctx->r[i.M.SH] & 0x1F;
+  uint64_t v = Rotl64(Replicate32(ctx->r[i.M.RT]), sh) &
+               XEMASK(i.M.MB + 32, i.M.ME + 32);
+  StoreResult(ctx, i.M.RA, v, i.M.Rc);
+  return Next(instr);
+}
+
+// Integer shift (A-7)
+
+const InterpretedInstr* InstrInterpret_sldx(InterpreterFrame& frame,
+                                            const InterpretedInstr* instr) {
+  auto ctx = frame.context;
+  const InstrData& i = instr->i;
+  uint32_t sh = ctx->r[i.X.RB] & 0x7F;
+  uint64_t v = sh & 0x40 ? 0 : ctx->r[i.X.RT] << sh;
+  StoreResult(ctx, i.X.RA, v, i.X.Rc);
+  return Next(instr);
+}
+
+const InterpretedInstr* InstrInterpret_slwx(InterpreterFrame& frame,
+                                            const InterpretedInstr* instr) {
+  auto ctx = frame.context;
+  const InstrData& i = instr->i;
+  uint32_t sh = ctx->r[i.X.RB] & 0x3F;
+  uint32_t v = sh & 0x20 ? 0 : uint32_t(ctx->r[i.X.RT]) << sh;
+  StoreResult(ctx, i.X.RA, v, i.X.Rc);
+  return Next(instr);
+}
+
+const InterpretedInstr* InstrInterpret_srdx(InterpreterFrame& frame,
+                                            const InterpretedInstr* instr) {
+  auto ctx = frame.context;
+  const InstrData& i = instr->i;
+  uint32_t sh = ctx->r[i.X.RB] & 0x7F;
+  uint64_t v = sh & 0x40 ? 0 : ctx->r[i.X.RT] >> sh;
+  StoreResult(ctx, i.X.RA, v, i.X.Rc);
+  return Next(instr);
+}
+
+const InterpretedInstr* InstrInterpret_srwx(InterpreterFrame& frame,
+                                            const InterpretedInstr* instr) {
+  auto ctx = frame.context;
+  const InstrData& i = instr->i;
+  uint32_t sh = ctx->r[i.X.RB] & 0x3F;
+  uint32_t v = sh & 0x20 ? 0 : uint32_t(ctx->r[i.X.RT]) >> sh;
+  StoreResult(ctx, i.X.RA, v, i.X.Rc);
+  return Next(instr);
+}
+
+const InterpretedInstr* InstrInterpret_sradx(InterpreterFrame& frame,
+                                             const InterpretedInstr* instr) {
+  auto ctx = frame.context;
+  const InstrData& i = instr->i;
+  int64_t rt = int64_t(ctx->r[i.X.RT]);
+  uint32_t sh = std::min(uint32_t(ctx->r[i.X.RB] & 0x7F), 63u);
+  int64_t v = rt >> sh;
+  ctx->xer_ca = rt < 0 && (uint64_t(v) << sh) != uint64_t(rt);
+  StoreResult(ctx, i.X.RA, uint64_t(v), i.X.Rc);
+  return Next(instr);
+}
+
+const InterpretedInstr* InstrInterpret_sradix(InterpreterFrame& frame,
+                                              const InterpretedInstr* instr) {
+  auto ctx = frame.context;
+  const InstrData& i = instr->i;
+  int64_t rt = int64_t(ctx->r[i.XS.RT]);
+  uint32_t sh = (i.XS.SH5 << 5) | i.XS.SH;
+  ctx->xer_ca = rt < 0 && sh && (uint64_t(rt) & XEMASK(64 - sh, 63)) != 0;
+  StoreResult(ctx, i.XS.RA, uint64_t(rt >> sh), i.XS.Rc);
+  return Next(instr);
+}
+
+const InterpretedInstr* InstrInterpret_srawx(InterpreterFrame& frame,
+                                             const InterpretedInstr* instr) {
+  auto ctx = frame.context;
+  const InstrData& i = instr->i;
+  int32_t rt = int32_t(ctx->r[i.X.RT]);
+  uint32_t sh = std::min(uint32_t(ctx->r[i.X.RB] & 0x3F), 31u);
+  int32_t v = rt >> sh;
+  ctx->xer_ca = rt < 0 && (uint32_t(v) << sh) != uint32_t(rt);
+  StoreResult(ctx, i.X.RA, uint64_t(int64_t(v)), i.X.Rc);
+  return Next(instr);
+}
+
+const InterpretedInstr* InstrInterpret_srawix(InterpreterFrame& frame,
+                                              const InterpretedInstr* instr) {
+  auto ctx = frame.context;
+  const InstrData& i = instr->i;
+  int32_t rt = int32_t(ctx->r[i.X.RT]);
+  // SH is in RB.
+  uint32_t sh = i.X.RB;
+  ctx->xer_ca =
+      rt < 0 && sh && (uint32_t(rt) & uint32_t(XEMASK(64 - sh, 63))) != 0;
+  StoreResult(ctx, i.X.RA, uint64_t(int64_t(rt >> sh)), i.X.Rc);
+  return Next(instr);
+}
+
+void RegisterInterpretCategoryALU() {
+  XEREGISTERINTERP(addx);
+  XEREGISTERINTERP(addcx);
+  XEREGISTERINTERP(addex);
+  XEREGISTERINTERP(addi);
+  XEREGISTERINTERP(addic);
+  XEREGISTERINTERP(addicx);
+  XEREGISTERINTERP(addis);
+  XEREGISTERINTERP(addmex);
+  XEREGISTERINTERP(addzex);
+  XEREGISTERINTERP(mulhdx);
+  XEREGISTERINTERP(mulhdux);
+  XEREGISTERINTERP(mulhwx);
+  XEREGISTERINTERP(mulhwux);
+  XEREGISTERINTERP(mulldx);
+  XEREGISTERINTERP(mulli);
+  XEREGISTERINTERP(mullwx);
+  XEREGISTERINTERP(negx);
+  XEREGISTERINTERP(subfx);
+  XEREGISTERINTERP(subfcx);
+  XEREGISTERINTERP(subficx);
+  XEREGISTERINTERP(subfex);
+  XEREGISTERINTERP(subfmex);
+  XEREGISTERINTERP(subfzex);
+  XEREGISTERINTERP(cmp);
+  XEREGISTERINTERP(cmpi);
+  XEREGISTERINTERP(cmpl);
+  XEREGISTERINTERP(cmpli);
+  XEREGISTERINTERP(andx);
+  XEREGISTERINTERP(andcx);
+  XEREGISTERINTERP(andix);
+  XEREGISTERINTERP(andisx);
+  XEREGISTERINTERP(cntlzdx);
+  XEREGISTERINTERP(cntlzwx);
+  XEREGISTERINTERP(eqvx);
+  XEREGISTERINTERP(extsbx);
+  XEREGISTERINTERP(extshx);
+  XEREGISTERINTERP(extswx);
+  XEREGISTERINTERP(nandx);
+  XEREGISTERINTERP(norx);
+  XEREGISTERINTERP(orx);
+  XEREGISTERINTERP(orcx);
+  XEREGISTERINTERP(ori);
+  XEREGISTERINTERP(oris);
+  XEREGISTERINTERP(xorx);
+  XEREGISTERINTERP(xori);
+  XEREGISTERINTERP(xoris);
+  XEREGISTERINTERP(rldclx);
+  XEREGISTERINTERP(rldcrx);
+  XEREGISTERINTERP(rldiclx);
+  XEREGISTERINTERP(rldicrx);
+  XEREGISTERINTERP(rldimix);
+  XEREGISTERINTERP(rlwimix);
+  XEREGISTERINTERP(rlwinmx);
+  XEREGISTERINTERP(rlwnmx);
+  XEREGISTERINTERP(sldx);
+  XEREGISTERINTERP(slwx);
+  XEREGISTERINTERP(srdx);
+  XEREGISTERINTERP(srwx);
+  XEREGISTERINTERP(sradx);
+  XEREGISTERINTERP(sradix);
+  XEREGISTERINTERP(srawx);
+  XEREGISTERINTERP(srawix);
+}
+
+}  // namespace ppc
+}  // namespace cpu
+}  // namespace xe
@@ -0,0 +1,306 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2020 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include "xenia/cpu/ppc/ppc_interpret-private.h"
+
+#include "xenia/cpu/ppc/ppc_interpreter.h"
+
+namespace xe {
+namespace cpu {
+namespace ppc {
+
+namespace {
+
+// Decrements CTR unless BO says not to, and tests it and the CR bit as BO
+// says, as ppc_emit_control.cc does.
+bool TestBranchCondition(PPCContext* ctx, uint32_t bo, uint32_t bi,
+                         bool test_ctr) {
+  if (test_ctr && !(bo & 0x4)) {
+    ctx->ctr -= 1;
+    bool ctr_zero = !uint32_t(ctx->ctr);
+    if (ctr_zero != bool(bo & 0x2)) {
+      return false;
+    }
+  }
+  if (!(bo & 0x10)) {
+    if (CRBit(ctx, bi) != ((bo & 0x8) ? 1 : 0)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+inline void UpdateLR(PPCContext* ctx, const InstrData& i, bool lk) {
+  // Set whether or not the branch is taken, as the JIT does.
+  if (lk) {
+    ctx->lr = i.address + 4;
+  }
+}
+
+inline uint32_t SPRNumber(const InstrData& i) {
+  return ((i.XFX.spr & 0x1F) << 5) | ((i.XFX.spr >> 5) & 0x1F);
+}
+
+// The single field selected by the FXM of the one-field forms of mfcr and
+// mtcrf, or -1 if not exactly one is.
+int SingleCRField(const InstrData& i) {
+  uint32_t bits = (i.XFX.spr & 0x1FF) >> 1;
+  int count = 0;
+  int cri = 0;
+  for (int b = 0; b <= 7; ++b) {
+    if (bits & (1 << b)) {
+      cri = 7 - b;
+      ++count;
+    }
+  }
+  return count == 1 ? cri : -1;
+}
+
+}  // namespace
+
+// Branch (A-1)
+
+const InterpretedInstr* InstrInterpret_bx(InterpreterFrame& frame,
+                                          const InterpretedInstr* instr) {
+  const InstrData& i = instr->i;
+  UpdateLR(frame.context, i, i.I.LK);
+  return TakeBranch(frame, instr, i.I.LK);
+}
+
+const InterpretedInstr* InstrInterpret_bcx(InterpreterFrame& frame,
+                                           const InterpretedInstr* instr) {
+  auto ctx = frame.context;
+  const InstrData& i = instr->i;
+  bool ok = TestBranchCondition(ctx, i.B.BO, i.B.BI, true);
+  UpdateLR(ctx, i, i.B.LK);
+  if (!ok) {
+    return Next(instr);
+  }
+  return TakeBranch(frame, instr, i.B.LK);
+}
+
+const InterpretedInstr* InstrInterpret_bcctrx(InterpreterFrame& frame,
+                                              const InterpretedInstr* instr) {
+  auto ctx = frame.context;
+  const InstrData& i = instr->i;
+  bool ok = TestBranchCondition(ctx, i.XL.BO, i.XL.BI, false);
+  UpdateLR(ctx, i, i.XL.LK);
+  if (!ok) {
+    return Next(instr);
+  }
+  return TakeIndirectBranch(frame, instr, uint32_t(ctx->ctr), i.XL.LK, false);
+}
+
+const InterpretedInstr* InstrInterpret_bclrx(InterpreterFrame& frame,
+                                             const InterpretedInstr* instr) {
+  auto ctx = frame.context;
+  const InstrData& i = instr->i;
+  bool ok = TestBranchCondition(ctx, i.XL.BO, i.XL.BI, true);
+  uint32_t target = uint32_t(ctx->lr);
+  UpdateLR(ctx, i, i.XL.LK);
+  if (!ok) {
+    return Next(instr);
+  }
+  return TakeIndirectBranch(frame, instr, target, i.XL.LK, !i.XL.LK);
+}
+
+// Condition register logical (A-23)
+// CR[bt] <- CR[ba] op CR[bb], with bt=BO, ba=BI, bb=BB.
+
+const InterpretedInstr* InstrInterpret_crand(InterpreterFrame& frame,
+                                             const InterpretedInstr* instr) {
+  auto ctx = frame.context;
+  const InstrData& i = instr->i;
+  CRBit(ctx, i.XL.BO) = CRBit(ctx, i.XL.BI) & CRBit(ctx, i.XL.BB);
+  return Next(instr);
+}
+
+const InterpretedInstr* InstrInterpret_crandc(InterpreterFrame& frame,
+                                              const InterpretedInstr* instr) {
+  auto ctx = frame.context;
+  const InstrData& i = instr->i;
+  CRBit(ctx, i.XL.BO) = CRBit(ctx, i.XL.BI) & (~CRBit(ctx, i.XL.BB) & 1);
+  return Next(instr);
+}
+
+const InterpretedInstr* InstrInterpret_creqv(InterpreterFrame& frame,
+                                             const InterpretedInstr* instr) {
+  auto ctx = frame.context;
+  const InstrData& i = instr->i;
+  CRBit(ctx, i.XL.BO) = CRBit(ctx, i.XL.BI) == CRBit(ctx, i.XL.BB);
+  return Next(instr);
+}
+
+const InterpretedInstr* InstrInterpret_crnand(InterpreterFrame& frame,
+                                              const InterpretedInstr* instr) {
+  auto ctx = frame.context;
+  const InstrData& i = instr->i;
+  CRBit(ctx, i.XL.BO) = ~(CRBit(ctx, i.XL.BI) & CRBit(ctx, i.XL.BB)) & 1;
+  return Next(instr);
+}
+
+const InterpretedInstr* InstrInterpret_crnor(InterpreterFrame& frame,
+                                             const InterpretedInstr* instr) {
+  auto ctx = frame.context;
+  const InstrData& i = instr->i;
+  CRBit(ctx, i.XL.BO) = ~(CRBit(ctx, i.XL.BI) | CRBit(ctx, i.XL.BB)) & 1;
+  return Next(instr);
+}
+
+const InterpretedInstr* InstrInterpret_cror(InterpreterFrame& frame,
+                                            const InterpretedInstr* instr) {
+  auto ctx = frame.context;
+  const InstrData& i = instr->i;
+  CRBit(ctx, i.XL.BO) = CRBit(ctx, i.XL.BI) | CRBit(ctx, i.XL.BB);
+  return Next(instr);
+}
+
+const InterpretedInstr* InstrInterpret_crorc(InterpreterFrame& frame,
+                                             const InterpretedInstr* instr) {
+  auto ctx = frame.context;
+  const InstrData& i = instr->i;
+  CRBit(ctx, i.XL.BO) = CRBit(ctx, i.XL.BI) | (~CRBit(ctx, i.XL.BB) & 1);
+  return Next(instr);
+}
+
+const InterpretedInstr* InstrInterpret_crxor(InterpreterFrame& frame,
+                                             const InterpretedInstr* instr) {
+  auto ctx = frame.context;
+  const InstrData& i = instr->i;
+  CRBit(ctx, i.XL.BO) = CRBit(ctx, i.XL.BI) ^ CRBit(ctx, i.XL.BB);
+  return Next(instr);
+}
+
+// Processor control (A-26)
+
+const InterpretedInstr* InstrInterpret_mfcr(InterpreterFrame& frame,
+                                            const InterpretedInstr* instr) {
+  auto ctx = frame.context;
+  const InstrData& i = instr->i;
+  uint64_t v = 0;
+  if (i.XFX.spr & (1 << 9)) {
+    int cri = SingleCRField(i);
+    if (cri >= 0) {
+      v = LoadCR(ctx, cri);
+    }
+  } else {
+    for (uint32_t n = 0; n <= 7; ++n) {
+      v |= LoadCR(ctx, n);
+    }
+  }
+  ctx->r[i.XFX.RT] = v;
+  return Next(instr);
+}
+
+const InterpretedInstr* InstrInterpret_mfspr(InterpreterFrame& frame,
+                                             const InterpretedInstr* instr) {
+  auto ctx = frame.context;
+  const InstrData& i = instr->i;
+  uint64_t v = 0;
+  // Only the SPRs CanInterpret lets through.
+  switch (SPRNumber(i)) {
+    case 1:
+      v = uint64_t(ctx->xer_ca) << 29;
+      break;
+    case 8:
+      v = ctx->lr;
+      break;
+    case 9:
+      v = ctx->ctr;
+      break;
+    case 268:
+      v = LoadClock(ctx);
+      break;
+    case 269:
+      v = LoadClock(ctx) >> 32;
+      break;
+    case 287:
+      v = 0x710800;
+      break;
+  }
+  ctx->r[i.XFX.RT] = v;
+  return Next(instr);
+}
+
+const InterpretedInstr* InstrInterpret_mftb(InterpreterFrame& frame,
+                                            const InterpretedInstr* instr) {
+  auto ctx = frame.context;
+  const InstrData& i = instr->i;
+  uint64_t time = LoadClock(ctx);
+  ctx->r[i.XFX.RT] = SPRNumber(i) == 268 ? time : time >> 32;
+  return Next(instr);
+}
+
+const InterpretedInstr* InstrInterpret_mtcrf(InterpreterFrame& frame,
+                                             const InterpretedInstr* instr) {
+  auto ctx = frame.context;
+  const InstrData& i = instr->i;
+  uint64_t v = ctx->r[i.XFX.RT];
+  if (i.XFX.spr & (1 << 9)) {
+    int cri = SingleCRField(i);
+    if (cri >= 0) {
+      StoreCR(ctx, cri, v);
+    } else {
+      for (uint32_t n = 0; n <= 7; ++n) {
+        StoreCR(ctx, n, 0);
+      }
+    }
+  } else {
+    uint32_t bits = (i.XFX.spr & 0x1FF) >> 1;
+    for (int b = 0; b <= 7; ++b) {
+      if (bits & (1 << b)) {
+        StoreCR(ctx, 7 - b, v);
+      }
+    }
+  }
+  return Next(instr);
+}
+
+const InterpretedInstr* InstrInterpret_mtspr(InterpreterFrame& frame,
+                                             const InterpretedInstr* instr) {
+  auto ctx = frame.context;
+  const InstrData& i = instr->i;
+  uint64_t rt = ctx->r[i.XFX.RT];
+  switch (SPRNumber(i)) {
+    case 1:
+      ctx->xer_ca = (rt >> 29) & 1;
+      break;
+    case 8:
+      ctx->lr = rt;
+      break;
+    case 9:
+      ctx->ctr = rt;
+      break;
+  }
+  return Next(instr);
+}
+
+void RegisterInterpretCategoryControl() {
+  XEREGISTERINTERP(bx);
+  XEREGISTERINTERP(bcx);
+  XEREGISTERINTERP(bcctrx);
+  XEREGISTERINTERP(bclrx);
+  XEREGISTERINTERP(crand);
+  XEREGISTERINTERP(crandc);
+  XEREGISTERINTERP(creqv);
+  XEREGISTERINTERP(crnand);
+  XEREGISTERINTERP(crnor);
+  XEREGISTERINTERP(cror);
+  XEREGISTERINTERP(crorc);
+  XEREGISTERINTERP(crxor);
+  XEREGISTERINTERP(mfcr);
+  XEREGISTERINTERP(mfspr);
+  XEREGISTERINTERP(mftb);
+  XEREGISTERINTERP(mtcrf);
+  XEREGISTERINTERP(mtspr);
+}
+
+}  // namespace ppc
+}  // namespace cpu
+}  // namespace xe
@@ -0,0 +1,627 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2020 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include "xenia/cpu/ppc/ppc_interpret-private.h"
+
+#include <atomic>
+#include <cstring>
+
+#include "xenia/base/cvar.h"
+#include "xenia/base/memory.h"
+#include "xenia/cpu/ppc/ppc_interpreter.h"
+
+DECLARE_bool(UE_Workaround);
+
+namespace xe {
+namespace cpu {
+namespace ppc {
+
+namespace {
+
+// (RA|0) + EXTS(d)
+inline uint64_t DisplacementEA(PPCContext* ctx, uint32_t ra, uint32_t d) {
+  return (ra ? ctx->r[ra] : 0) + XEEXTS16(d);
+}
+
+// (RA|0) + (RB)
+inline uint64_t IndexedEA(PPCContext* ctx, uint32_t ra, uint32_t rb) {
+  return (ra ? ctx->r[ra] : 0) + ctx->r[rb];
+}
+
+// Loads a T and extends it to 64 bits through E, which is signed for the
+// algebraic loads.
+template <typename T, typename E>
+inline void LoadGPR(const InterpreterFrame& frame, uint32_t rt, uint64_t ea) {
+  frame.context->r[rt] = uint64_t(int64_t(E(Load<T>(frame, ea))));
+}
+
+}  // namespace
+
+// Integer load (A-13)
+
+const InterpretedInstr* InstrInterpret_lbz(InterpreterFrame& frame,
+                                           const InterpretedInstr* instr) {
+  auto ctx = frame.context;
+  const InstrData& i = instr->i;
+  LoadGPR<uint8_t, uint8_t>(frame, i.D.RT, DisplacementEA(ctx, i.D.RA, i.D.DS));
+  return Next(instr);
+}
+
+const InterpretedInstr* InstrInterpret_lbzu(InterpreterFrame& frame,
+                                            const InterpretedInstr* instr) {
+  auto ctx = frame.context;
+  const InstrData& i = instr->i;
+  uint64_t ea = ctx->r[i.D.RA] + XEEXTS16(i.D.DS);
+  LoadGPR<uint8_t, uint8_t>(frame, i.D.RT, ea);
+  ctx->r[i.D.RA] = ea;
+  return Next(instr);
+}
+
+const InterpretedInstr* InstrInterpret_lbzux(InterpreterFrame& frame,
+                                             const InterpretedInstr* instr) {
+  auto ctx = frame.context;
+  const InstrData& i = instr->i;
+  uint64_t ea = ctx->r[i.X.RA] + ctx->r[i.X.RB];
+  LoadGPR<uint8_t, uint8_t>(frame, i.X.RT, ea);
+  ctx->r[i.X.RA] = ea;
+  return Next(instr);
+}
+
+const InterpretedInstr* InstrInterpret_lbzx(InterpreterFrame& frame,
+                                            const InterpretedInstr* instr) {
+  auto ctx = frame.context;
+  const InstrData& i = instr->i;
+  LoadGPR<uint8_t, uint8_t>(frame, i.X.RT, IndexedEA(ctx, i.X.RA, i.X.RB));
+  return Next(instr);
+}
+
+const InterpretedInstr* InstrInterpret_lha(InterpreterFrame& frame,
+                                           const InterpretedInstr* instr) {
+  auto ctx = frame.context;
+  const InstrData& i = instr->i;
+  LoadGPR<uint16_t, int16_t>(frame, i.D.RT,
+                             DisplacementEA(ctx, i.D.RA, i.D.DS));
+  return Next(instr);
+}
+
+const InterpretedInstr* InstrInterpret_lhau(InterpreterFrame& frame,
+                                            const InterpretedInstr* instr) {
+  auto ctx = frame.context;
+  const InstrData& i = instr->i;
+  uint64_t ea = ctx->r[i.D.RA] + XEEXTS16(i.D.DS);
+  LoadGPR<uint16_t, int16_t>(frame, i.D.RT, ea);
+  ctx->r[i.D.RA] = ea;
+  return Next(instr);
+}
+
+const InterpretedInstr* InstrInterpret_lhaux(InterpreterFrame& frame,
+                                             const InterpretedInstr* instr) {
+  auto ctx = frame.context;
+  const InstrData& i = instr->i;
+  uint64_t ea = ctx->r[i.X.RA] + ctx->r[i.X.RB];
+  LoadGPR<uint16_t, int16_t>(frame, i.X.RT, ea);
+  ctx->r[i.X.RA] = ea;
+  return Next(instr);
+}
+
+const InterpretedInstr* InstrInterpret_lhax(InterpreterFrame& frame,
+                                            const InterpretedInstr* instr) {
+  auto ctx = frame.context;
+  const InstrData& i = instr->i;
+  LoadGPR<uint16_t, int16_t>(frame, i.X.RT, IndexedEA(ctx, i.X.RA, i.X.RB));
+  return Next(instr);
+}
+
+const InterpretedInstr* InstrInterpret_lhz(InterpreterFrame& frame,
+                                           const InterpretedInstr* instr) {
+  auto ctx = frame.context;
+  const InstrData& i = instr->i;
+  LoadGPR<uint16_t, uint16_t>(frame, i.D.RT,
+                              DisplacementEA(ctx, i.D.RA, i.D.DS));
+  return Next(instr);
+}
+
+const InterpretedInstr* InstrInterpret_lhzu(InterpreterFrame& frame,
+                                            const InterpretedInstr* instr) {
+  auto ctx = frame.context;
+  const InstrData& i = instr->i;
+  uint64_t ea = ctx->r[i.D.RA] + XEEXTS16(i.D.DS);
+  LoadGPR<uint16_t, uint16_t>(frame, i.D.RT, ea);
+  ctx->r[i.D.RA] = ea;
+  return Next(instr);
+}
+
+const InterpretedInstr* InstrInterpret_lhzux(InterpreterFrame& frame,
+                                             const InterpretedInstr* instr) {
+  auto ctx = frame.context;
+  const InstrData& i = instr->i;
+  uint64_t ea = ctx->r[i.X.RA] + ctx->r[i.X.RB];
+  LoadGPR<uint16_t, uint16_t>(frame, i.X.RT, ea);
+  ctx->r[i.X.RA] = ea;
+  return Next(instr);
+}
+
+const InterpretedInstr* InstrInterpret_lhzx(InterpreterFrame& frame,
+                                            const InterpretedInstr* instr) {
+  auto ctx = frame.context;
+  const InstrData& i = instr->i;
+  LoadGPR<uint16_t, uint16_t>(frame, i.X.RT, IndexedEA(ctx, i.X.RA, i.X.RB));
+  return Next(instr);
+}
+
+const InterpretedInstr* InstrInterpret_lwz(InterpreterFrame& frame,
+                                           const InterpretedInstr* instr) {
+  auto ctx = frame.context;
+  const InstrData& i = instr->i;
+  LoadGPR<uint32_t, uint32_t>(frame, i.D.RT,
+                              DisplacementEA(ctx, i.D.RA, i.D.DS));
+  return Next(instr);
+}
+
+const InterpretedInstr* InstrInterpret_lwzu(InterpreterFrame& frame,
+                                            const InterpretedInstr* instr) {
+  auto ctx = frame.context;
+  const InstrData& i = instr->i;
+  uint64_t ea = ctx->r[i.D.RA] + XEEXTS16(i.D.DS);
+  LoadGPR<uint32_t, uint32_t>(frame, i.D.RT, ea);
+  ctx->r[i.D.RA] = ea;
+  return Next(instr);
+}
+
+const InterpretedInstr* InstrInterpret_lwzux(InterpreterFrame& frame,
+                                             const InterpretedInstr* instr) {
+  auto ctx = frame.context;
+  const InstrData& i = instr->i;
+  uint64_t ea = ctx->r[i.X.RA] + ctx->r[i.X.RB];
+  LoadGPR<uint32_t, uint32_t>(frame, i.X.RT, ea);
+  ctx->r[i.X.RA] = ea;
+  return Next(instr);
+}
+
+const InterpretedInstr* InstrInterpret_lwzx(InterpreterFrame& frame,
+                                            const InterpretedInstr* instr) {
+  auto ctx = frame.context;
+  const InstrData& i = instr->i;
+  LoadGPR<uint32_t, uint32_t>(frame, i.X.RT, IndexedEA(ctx, i.X.RA, i.X.RB));
+  return Next(instr);
+}
+
+const InterpretedInstr* InstrInterpret_lwa(InterpreterFrame& frame,
+                                           const InterpretedInstr* instr) {
+  auto ctx = frame.context;
+  const InstrData& i = instr->i;
+  LoadGPR<uint32_t, int32_t>(frame, i.DS.RT,
+                             DisplacementEA(ctx, i.DS.RA, i.DS.DS << 2));
+  return Next(instr);
+}
+
+const InterpretedInstr* InstrInterpret_lwaux(InterpreterFrame& frame,
+                                             const InterpretedInstr* instr) {
+  auto ctx = frame.context;
+  const InstrData& i = instr->i;
+  uint64_t ea = ctx->r[i.X.RA] + ctx->r[i.X.RB];
+  LoadGPR<uint32_t, int32_t>(frame, i.X.RT, ea);
+  ctx->r[i.X.RA] = ea;
+  return Next(instr);
+}
+
+const InterpretedInstr* InstrInterpret_lwax(InterpreterFrame& frame,
+                                            const InterpretedInstr* instr) {
+  auto ctx = frame.context;
+  const InstrData& i = instr->i;
+  LoadGPR<uint32_t, int32_t>(frame, i.X.RT, IndexedEA(ctx, i.X.RA, i.X.RB));
+  return Next(instr);
+}
+
+const InterpretedInstr* InstrInterpret_ld(InterpreterFrame& frame,
+                                          const InterpretedInstr* instr) {
+  auto ctx = frame.context;
+  const InstrData& i = instr->i;
+  LoadGPR<uint64_t, uint64_t>(frame, i.DS.RT,
+                              DisplacementEA(ctx, i.DS.RA, i.DS.DS << 2));
+  return Next(instr);
+}
+
+const InterpretedInstr* InstrInterpret_ldu(InterpreterFrame& frame,
+                                           const InterpretedInstr* instr) {
+  auto ctx = frame.context;
+  const InstrData& i = instr->i;
+  uint64_t ea = ctx->r[i.DS.RA] + XEEXTS16(i.DS.DS << 2);
+  LoadGPR<uint64_t, uint64_t>(frame, i.DS.RT, ea);
+  ctx->r[i.DS.RA] = ea;
+  return Next(instr);
+}
+
+const InterpretedInstr* InstrInterpret_ldux(InterpreterFrame& frame,
+                                            const InterpretedInstr* instr) {
+  auto ctx = frame.context;
+  const InstrData& i = instr->i;
+  uint64_t ea = ctx->r[i.X.RA] + ctx->r[i.X.RB];
+  LoadGPR<uint64_t, uint64_t>(frame, i.X.RT, ea);
+  ctx->r[i.X.RA] = ea;
+  return Next(instr);
+}
+
+const InterpretedInstr* InstrInterpret_ldx(InterpreterFrame& frame,
+                                           const InterpretedInstr* instr) {
+  auto ctx = frame.context;
+  const InstrData& i = instr->i;
+  LoadGPR<uint64_t, uint64_t>(frame, i.X.RT, IndexedEA(ctx, i.X.RA, i.X.RB));
+  return Next(instr);
+}
+
+// Integer store (A-14)
+
+const InterpretedInstr* InstrInterpret_stb(InterpreterFrame& frame,
+                                           const InterpretedInstr* instr) {
+  auto ctx = frame.context;
+  const InstrData& i = instr->i;
+  Store<uint8_t>(frame, DisplacementEA(ctx, i.D.RA, i.D.DS),
+                 uint8_t(ctx->r[i.D.RT]));
+  return Next(instr);
+}
+
+const InterpretedInstr* InstrInterpret_stbu(InterpreterFrame& frame,
+                                            const InterpretedInstr* instr) {
+  auto ctx = frame.context;
+  const InstrData& i = instr->i;
+  uint64_t ea = ctx->r[i.D.RA] + XEEXTS16(i.D.DS);
+  Store<uint8_t>(frame, ea, uint8_t(ctx->r[i.D.RT]));
+  ctx->r[i.D.RA] = ea;
+  return Next(instr);
+}
+
+const InterpretedInstr* InstrInterpret_stbux(InterpreterFrame& frame,
+                                             const InterpretedInstr* instr) {
+  auto ctx = frame.context;
+  const InstrData& i = instr->i;
+  uint64_t ea = ctx->r[i.X.RA] + ctx->r[i.X.RB];
+  Store<uint8_t>(frame, ea, uint8_t(ctx->r[i.X.RT]));
+  ctx->r[i.X.RA] = ea;
+  return Next(instr);
+}
+
+const InterpretedInstr* InstrInterpret_stbx(InterpreterFrame& frame,
+                                            const InterpretedInstr* instr) {
+  auto ctx = frame.context;
+  const InstrData& i = instr->i;
+  Store<uint8_t>(frame, IndexedEA(ctx, i.X.RA, i.X.RB),
+                 uint8_t(ctx->r[i.X.RT]));
+  return Next(instr);
+}
+
+const InterpretedInstr* InstrInterpret_sth(InterpreterFrame& frame,
+                                           const InterpretedInstr* instr) {
+  auto ctx = frame.context;
+  const InstrData& i = instr->i;
+  Store<uint16_t>(frame, DisplacementEA(ctx, i.D.RA, i.D.DS),
+                  uint16_t(ctx->r[i.D.RT]));
+  return Next(instr);
+}
+
+const InterpretedInstr* InstrInterpret_sthu(InterpreterFrame& frame,
+                                            const InterpretedInstr* instr) {
+  auto ctx = frame.context;
+  const InstrData& i = instr->i;
+  uint64_t ea = ctx->r[i.D.RA] + XEEXTS16(i.D.DS);
+  Store<uint16_t>(frame, ea, uint16_t(ctx->r[i.D.RT]));
+  ctx->r[i.D.RA] = ea;
+  return Next(instr);
+}
+
+const InterpretedInstr* InstrInterpret_sthux(InterpreterFrame& frame,
+                                             const InterpretedInstr* instr) {
+  auto ctx = frame.context;
+  const InstrData& i = instr->i;
+  uint64_t ea = ctx->r[i.X.RA] + ctx->r[i.X.RB];
+  Store<uint16_t>(frame, ea, uint16_t(ctx->r[i.X.RT]));
+  ctx->r[i.X.RA] = ea;
+  return Next(instr);
+}
+
+const InterpretedInstr* InstrInterpret_sthx(InterpreterFrame& frame,
+                                            const InterpretedInstr* instr) {
+  auto ctx = frame.context;
+  const InstrData& i = instr->i;
+  Store<uint16_t>(frame, IndexedEA(ctx, i.X.RA, i.X.RB),
+                  uint16_t(ctx->r[i.X.RT]));
+  return Next(instr);
+}
+
+const InterpretedInstr* InstrInterpret_stw(InterpreterFrame& frame,
+                                           const InterpretedInstr* instr) {
+  auto ctx = frame.context;
+  const InstrData& i = instr->i;
+  Store<uint32_t>(frame, DisplacementEA(ctx, i.D.RA, i.D.DS),
+                  uint32_t(ctx->r[i.D.RT]));
+  return Next(instr);
+}
+
+const InterpretedInstr* InstrInterpret_stwu(InterpreterFrame& frame,
+                                            const InterpretedInstr* instr) {
+  auto ctx = frame.context;
+  const InstrData& i = instr->i;
+  uint64_t ea = ctx->r[i.D.RA] + XEEXTS16(i.D.DS);
+  Store<uint32_t>(frame, ea, uint32_t(ctx->r[i.D.RT]));
+  ctx->r[i.D.RA] = ea;
+  return Next(instr);
+}
+
+const InterpretedInstr* InstrInterpret_stwux(InterpreterFrame& frame,
+                                             const InterpretedInstr* instr) {
+  auto ctx = frame.context;
+  const InstrData& i = instr->i;
+  uint64_t ea = ctx->r[i.X.RA] + ctx->r[i.X.RB];
+  Store<uint32_t>(frame, ea, uint32_t(ctx->r[i.X.RT]));
+  ctx->r[i.X.RA] = ea;
+  return Next(instr);
+}
+
+const InterpretedInstr* InstrInterpret_stwx(InterpreterFrame& frame,
+                                            const InterpretedInstr* instr) {
+  auto ctx = frame.context;
+  const InstrData& i = instr->i;
+  Store<uint32_t>(frame, IndexedEA(ctx, i.X.RA, i.X.RB),
+                  uint32_t(ctx->r[i.X.RT]));
+  return Next(instr);
+}
+
+const InterpretedInstr* InstrInterpret_std(InterpreterFrame& frame,
+                                           const InterpretedInstr* instr) {
+  auto ctx = frame.context;
+  const InstrData& i = instr->i;
+  Store<uint64_t>(frame, DisplacementEA(ctx, i.DS.RA, i.DS.DS << 2),
+                  ctx->r[i.DS.RT]);
+  return Next(instr);
+}
+
+const InterpretedInstr* InstrInterpret_stdu(InterpreterFrame& frame,
+                                            const InterpretedInstr* instr) {
+  auto ctx = frame.context;
+  const InstrData& i = instr->i;
+  uint64_t ea = ctx->r[i.DS.RA] + XEEXTS16(i.DS.DS << 2);
+  Store<uint64_t>(frame, ea, ctx->r[i.DS.RT]);
+  ctx->r[i.DS.RA] = ea;
+  return Next(instr);
+}
+
+const InterpretedInstr* InstrInterpret_stdux(InterpreterFrame& frame,
+                                             const InterpretedInstr* instr) {
+  auto ctx = frame.context;
+  const InstrData& i = instr->i;
+  uint64_t ea = ctx->r[i.X.RA] + ctx->r[i.X.RB];
+  Store<uint64_t>(frame, ea, ctx->r[i.X.RT]);
+  ctx->r[i.X.RA] = ea;
+  return Next(instr);
+}
+
+const InterpretedInstr* InstrInterpret_stdx(InterpreterFrame& frame,
+                                            const InterpretedInstr* instr) {
+  auto ctx = frame.context;
+  const InstrData& i = instr->i;
+  Store<uint64_t>(frame, IndexedEA(ctx, i.X.RA, i.X.RB), ctx->r[i.X.RT]);
+  return Next(instr);
+}
+
+// Integer load and store with byte reverse (A-15)
+
+const InterpretedInstr* InstrInterpret_lhbrx(InterpreterFrame& frame,
+                                             const InterpretedInstr* instr) {
+  auto ctx = frame.context;
+  const InstrData& i = instr->i;
+  ctx->r[i.X.RT] = xe::load<uint16_t>(
+      HostAddress(frame, IndexedEA(ctx, i.X.RA, i.X.RB)));
+  return Next(instr);
+}
+
+const InterpretedInstr* InstrInterpret_lwbrx(InterpreterFrame& frame,
+                                             const InterpretedInstr* instr) {
+  auto ctx = frame.context;
+  const InstrData& i = instr->i;
+  ctx->r[i.X.RT] = xe::load<uint32_t>(
+      HostAddress(frame, IndexedEA(ctx, i.X.RA, i.X.RB)));
+  return Next(instr);
+}
+
+const InterpretedInstr* InstrInterpret_ldbrx(InterpreterFrame& frame,
+                                             const InterpretedInstr* instr) {
+  auto ctx = frame.context;
+  const InstrData& i = instr->i;
+  ctx->r[i.X.RT] = xe::load<uint64_t>(
+      HostAddress(frame, IndexedEA(ctx, i.X.RA, i.X.RB)));
+  return Next(instr);
+}
+
+const InterpretedInstr* InstrInterpret_sthbrx(InterpreterFrame& frame,
+                                              const InterpretedInstr* instr) {
+  auto ctx = frame.context;
+  const InstrData& i = instr->i;
+  xe::store<uint16_t>(HostAddress(frame, IndexedEA(ctx, i.X.RA, i.X.RB)),
+                      uint16_t(ctx->r[i.X.RT]));
+  return Next(instr);
+}
+
+const InterpretedInstr* InstrInterpret_stwbrx(InterpreterFrame& frame,
+                                              const InterpretedInstr* instr) {
+  auto ctx = frame.context;
+  const InstrData& i = instr->i;
+  xe::store<uint32_t>(HostAddress(frame, IndexedEA(ctx, i.X.RA, i.X.RB)),
+                      uint32_t(ctx->r[i.X.RT]));
+  return Next(instr);
+}
+
+const InterpretedInstr* InstrInterpret_stdbrx(InterpreterFrame& frame,
+                                              const InterpretedInstr* instr) {
+  auto ctx = frame.context;
+  const InstrData& i = instr->i;
+  xe::store<uint64_t>(HostAddress(frame, IndexedEA(ctx, i.X.RA, i.X.RB)),
+                      uint64_t(ctx->r[i.X.RT]));
+  return Next(instr);
+}
+
+// Integer load and store multiple (A-16)
+
+const InterpretedInstr* InstrInterpret_lmw(InterpreterFrame& frame,
+                                           const InterpretedInstr* instr) {
+  auto ctx = frame.context;
+  const InstrData& i = instr->i;
+  uint64_t ea = DisplacementEA(ctx, i.D.RA, i.D.DS);
+  for (uint32_t j = 0; j < 32 - i.D.RT; ++j) {
+    // RA is left as it was if it's in the range, as the JIT does.
+    if (i.D.RT + j == i.D.RA) {
+      continue;
+    }
+    ctx->r[i.D.RT + j] = Load<uint32_t>(frame, ea + j * 4);
+  }
+  return Next(instr);
+}
+
+const InterpretedInstr* InstrInterpret_stmw(InterpreterFrame& frame,
+                                            const InterpretedInstr* instr) {
+  auto ctx = frame.context;
+  const InstrData& i = instr->i;
+  uint64_t ea = DisplacementEA(ctx, i.D.RA, i.D.DS);
+  for (uint32_t j = 0; j < 32 - i.D.RT; ++j) {
+    Store<uint32_t>(frame, ea + j * 4, uint32_t(ctx->r[i.D.RT + j]));
+  }
+  return Next(instr);
+}
+
+// Memory synchronization (A-18)
+
+const InterpretedInstr* InstrInterpret_eieio(InterpreterFrame& frame,
+                                             const InterpretedInstr* instr) {
+  std::atomic_thread_fence(std::memory_order_release);
+  return Next(instr);
+}
+
+const InterpretedInstr* InstrInterpret_sync(InterpreterFrame& frame,
+                                            const InterpretedInstr* instr) {
+  // L = 1 is lwsync, which orders everything but stores before loads.
+  if ((instr->i.X.RT & 0x3) == 1) {
+    std::atomic_thread_fence(std::memory_order_acq_rel);
+  } else {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+  }
+  return Next(instr);
+}
+
+const InterpretedInstr* InstrInterpret_isync(InterpreterFrame& frame,
+                                             const InterpretedInstr* instr) {
+  return Next(instr);
+}
+
+// Cache management (A-27)
+
+const InterpretedInstr* InstrInterpret_dcbf(InterpreterFrame& frame,
+                                            const InterpretedInstr* instr) {
+  auto ctx = frame.context;
+  const InstrData& i = instr->i;
+  // The Unreal Engine 3 workaround in ppc_emit_memory.cc.
+  if (i.X.RB == 11 && cvars::UE_Workaround) {
+    ctx->r[i.X.RB] -= 4;
+  }
+  return Next(instr);
+}
+
+const InterpretedInstr* InstrInterpret_dcbst(InterpreterFrame& frame,
+                                             const InterpretedInstr* instr) {
+  return Next(instr);
+}
+
+const InterpretedInstr* InstrInterpret_dcbt(InterpreterFrame& frame,
+                                            const InterpretedInstr* instr) {
+  return Next(instr);
+}
+
+const InterpretedInstr* InstrInterpret_dcbtst(InterpreterFrame& frame,
+                                              const InterpretedInstr* instr) {
+  return Next(instr);
+}
+
+const InterpretedInstr* InstrInterpret_dcbz(InterpreterFrame& frame,
+                                            const InterpretedInstr* instr) {
+  auto ctx = frame.context;
+  const InstrData& i = instr->i;
+  uint64_t ea = IndexedEA(ctx, i.X.RA, i.X.RB);
+  std::memset(HostAddress(frame, ea & ~31ull), 0, 32);
+  return Next(instr);
+}
+
+const InterpretedInstr* InstrInterpret_dcbz128(InterpreterFrame& frame,
+                                               const InterpretedInstr* instr) {
+  auto ctx = frame.context;
+  const InstrData& i = instr->i;
+  uint64_t ea = IndexedEA(ctx, i.X.RA, i.X.RB);
+  std::memset(HostAddress(frame, ea & ~127ull), 0, 128);
+  return Next(instr);
+}
+
+void RegisterInterpretCategoryMemory() {
+  XEREGISTERINTERP(lbz);
+  XEREGISTERINTERP(lbzu);
+  XEREGISTERINTERP(lbzux);
+  XEREGISTERINTERP(lbzx);
+  XEREGISTERINTERP(lha);
+  XEREGISTERINTERP(lhau);
+  XEREGISTERINTERP(lhaux);
+  XEREGISTERINTERP(lhax);
+  XEREGISTERINTERP(lhz);
+  XEREGISTERINTERP(lhzu);
+  XEREGISTERINTERP(lhzux);
+  XEREGISTERINTERP(lhzx);
+  XEREGISTERINTERP(lwz);
+  XEREGISTERINTERP(lwzu);
+  XEREGISTERINTERP(lwzux);
+  XEREGISTERINTERP(lwzx);
+  XEREGISTERINTERP(lwa);
+  XEREGISTERINTERP(lwaux);
+  XEREGISTERINTERP(lwax);
+  XEREGISTERINTERP(ld);
+  XEREGISTERINTERP(ldu);
+  XEREGISTERINTERP(ldux);
+  XEREGISTERINTERP(ldx);
+  XEREGISTERINTERP(stb);
+  XEREGISTERINTERP(stbu);
+  XEREGISTERINTERP(stbux);
+  XEREGISTERINTERP(stbx);
+  XEREGISTERINTERP(sth);
+  XEREGISTERINTERP(sthu);
+  XEREGISTERINTERP(sthux);
+  XEREGISTERINTERP(sthx);
+  XEREGISTERINTERP(stw);
+  XEREGISTERINTERP(stwu);
+  XEREGISTERINTERP(stwux);
+  XEREGISTERINTERP(stwx);
+  XEREGISTERINTERP(std);
+  XEREGISTERINTERP(stdu);
+  XEREGISTERINTERP(stdux);
+  XEREGISTERINTERP(stdx);
+  XEREGISTERINTERP(lhbrx);
+  XEREGISTERINTERP(lwbrx);
+  XEREGISTERINTERP(ldbrx);
+  XEREGISTERINTERP(sthbrx);
+  XEREGISTERINTERP(stwbrx);
+  XEREGISTERINTERP(stdbrx);
+  XEREGISTERINTERP(lmw);
+  XEREGISTERINTERP(stmw);
+  XEREGISTERINTERP(eieio);
+  XEREGISTERINTERP(sync);
+  XEREGISTERINTERP(isync);
+  XEREGISTERINTERP(dcbf);
+  XEREGISTERINTERP(dcbst);
+  XEREGISTERINTERP(dcbt);
+  XEREGISTERINTERP(dcbtst);
+  XEREGISTERINTERP(dcbz);
+  XEREGISTERINTERP(dcbz128);
+}
+
+}  // namespace ppc
+}  // namespace cpu
+}  // namespace xe
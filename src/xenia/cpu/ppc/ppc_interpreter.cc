@@ -0,0 +1,355 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2020 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include "xenia/cpu/ppc/ppc_interpreter.h"
+
+#include "xenia/base/assert.h"
+#include "xenia/base/clock.h"
+#include "xenia/base/logging.h"
+#include "xenia/base/memory.h"
+#include "xenia/base/platform.h"
+#include "xenia/base/threading.h"
+#include "xenia/cpu/cpu_flags.h"
+#include "xenia/cpu/ppc/ppc_frontend.h"
+#include "xenia/cpu/ppc/ppc_interpret-private.h"
+#include "xenia/cpu/ppc/ppc_scanner.h"
+#include "xenia/cpu/processor.h"
+
+namespace xe {
+namespace cpu {
+namespace ppc {
+
+struct InterpretedFunction {
+  enum class State {
+    kInterpreting,
+    kPromoting,
+    kPromoted,
+    // Compiling it failed, so it stays interpreted.
+    kPromotionFailed,
+  };
+
+  InterpretedFunction(PPCInterpreter* interpreter, GuestFunction* function,
+                      uint32_t instr_count)
+      : interpreter(interpreter),
+        function(function),
+        instrs(new InterpretedInstr[instr_count]),
+        instr_count(instr_count) {}
+
+  PPCInterpreter* interpreter;
+  GuestFunction* function;
+  std::unique_ptr<InterpretedInstr[]> instrs;
+  uint32_t instr_count;
+  std::atomic<uint32_t> call_count = {0};
+  std::atomic<State> state = {State::kInterpreting};
+};
+
+namespace {
+
+// Skipped, as the JIT does.
+const InterpretedInstr* InterpretInvalid(InterpreterFrame& frame,
+                                         const InterpretedInstr* instr) {
+  return Next(instr);
+}
+
+// The JIT doesn't implement the overflow-enabled forms or all SPRs, and the
+// handlers follow it.
+bool CanInterpret(const InstrData& i) {
+  switch (i.opcode) {
+    case PPCOpcode::addx:
+    case PPCOpcode::addcx:
+    case PPCOpcode::addex:
+    case PPCOpcode::addmex:
+    case PPCOpcode::addzex:
+    case PPCOpcode::divdx:
+    case PPCOpcode::divdux:
+    case PPCOpcode::divwx:
+    case PPCOpcode::divwux:
+    case PPCOpcode::mulhdx:
+    case PPCOpcode::mulhdux:
+    case PPCOpcode::mulhwx:
+    case PPCOpcode::mulhwux:
+    case PPCOpcode::mulldx:
+    case PPCOpcode::mullwx:
+    case PPCOpcode::negx:
+    case PPCOpcode::subfx:
+    case PPCOpcode::subfcx:
+    case PPCOpcode::subfex:
+    case PPCOpcode::subfmex:
+    case PPCOpcode::subfzex:
+      return !i.XO.OE;
+    case PPCOpcode::mfspr:
+    case PPCOpcode::mtspr: {
+      uint32_t n = ((i.XFX.spr & 0x1F) << 5) | ((i.XFX.spr >> 5) & 0x1F);
+      switch (n) {
+        case 1:
+        case 8:
+        case 9:
+        case 256:
+          return true;
+        case 268:
+        case 269:
+        case 287:
+          return i.opcode == PPCOpcode::mfspr;
+        default:
+          return false;
+      }
+    }
+    default:
+      return true;
+  }
+}
+
+// Polled at function entries and loop back-edges, as compiled code does.
+void PollSafepoint(PPCContext* ctx) {
+#if !XE_PLATFORM_WIN32
+  if (cvars::safepoints && ctx->safepoint_pending) {
+    threading::ProcessSafepoint();
+  }
+#endif  // !XE_PLATFORM_WIN32
+}
+
+const InterpretedInstr* CallFunction(InterpreterFrame& frame,
+                                     const InterpretedInstr* instr,
+                                     Function* function, bool lk) {
+  auto thread_state = frame.context->thread_state;
+  if (lk) {
+    function->Call(thread_state, instr->i.address + 4);
+    return Next(instr);
+  }
+  // Without LR set, the callee returns to our caller.
+  function->Call(thread_state, frame.return_address);
+  return nullptr;
+}
+
+void TakeBackEdge(InterpreterFrame& frame) {
+  PollSafepoint(frame.context);
+  if (cvars::interpreter_loop_threshold > 0 &&
+      ++frame.back_edge_count >=
+          uint32_t(cvars::interpreter_loop_threshold)) {
+    // Compiled code can only be entered at the top of the function, so this
+    // call carries on interpreted, and the following ones are compiled.
+    frame.back_edge_count = 0;
+    frame.function->interpreter->Promote(frame.function);
+  }
+}
+
+template <bool kCountInstructions>
+void Dispatch(InterpreterFrame& frame, const InterpretedInstr* instr,
+              const InterpretedInstr* end) {
+  while (instr && instr != end) {
+    if (kCountInstructions) {
+      ++frame.context->virtual_clock_instructions;
+    }
+    instr = instr->interpret(frame, instr);
+  }
+}
+
+}  // namespace
+
+const InterpretedInstr* TakeBranch(InterpreterFrame& frame,
+                                   const InterpretedInstr* instr, bool lk) {
+  if (instr->target) {
+    if (instr->target <= instr) {
+      TakeBackEdge(frame);
+    }
+    return instr->target;
+  }
+  Function* callee = instr->callee.load(std::memory_order_acquire);
+  if (!callee) {
+    callee =
+        frame.context->processor->ResolveFunction(instr->callee_address);
+    if (!callee) {
+      XELOGE("Interpreter failed to resolve call from %.8X to %.8X",
+             instr->i.address, instr->callee_address);
+      assert_always();
+      return nullptr;
+    }
+    instr->callee.store(callee, std::memory_order_release);
+  }
+  return CallFunction(frame, instr, callee, lk);
+}
+
+const InterpretedInstr* TakeIndirectBranch(InterpreterFrame& frame,
+                                           const InterpretedInstr* instr,
+                                           uint32_t target, bool lk,
+                                           bool possible_return) {
+  if (possible_return && target == frame.return_address) {
+    return nullptr;
+  }
+  auto function = frame.context->processor->ResolveFunction(target);
+  if (!function) {
+    XELOGE("Interpreter failed to resolve branch from %.8X to %.8X",
+           instr->i.address, target);
+    assert_always();
+    return nullptr;
+  }
+  return CallFunction(frame, instr, function, lk);
+}
+
+uint64_t LoadClock(PPCContext* ctx) {
+  if (cvars::clock_virtual) {
+    Clock::AdvanceGuestInstructions(ctx->virtual_clock_instructions);
+    ctx->virtual_clock_instructions = 0;
+  }
+  return Clock::QueryGuestTickCount();
+}
+
+PPCInterpreter::PPCInterpreter(PPCFrontend* frontend) : frontend_(frontend) {
+  // As the JIT computes host addresses.
+  upper_address_offset_ =
+      xe::memory::allocation_granularity() > 0x1000 ? 0x1000 : 0;
+}
+
+PPCInterpreter::~PPCInterpreter() = default;
+
+bool PPCInterpreter::Prepare(GuestFunction* function,
+                             uint32_t debug_info_flags) {
+  auto processor = frontend_->processor();
+  if (cvars::interpreter_call_threshold <= 0 ||
+      function->behavior() != Function::Behavior::kDefault) {
+    return false;
+  }
+  // Debugging and tracing are only done by compiled code.
+  if (processor->is_debugger_attached() || cvars::break_on_instruction ||
+      (debug_info_flags & DebugInfoFlags::kDebugInfoAllTracing) ||
+      cvars::trace_functions || cvars::trace_function_coverage ||
+      cvars::trace_function_references || cvars::trace_function_data) {
+    return false;
+  }
+
+  PPCScanner scanner(frontend_);
+  if (!scanner.Scan(function, nullptr)) {
+    return false;
+  }
+
+  uint32_t start_address = function->address();
+  uint32_t end_address = function->end_address();
+  uint32_t instr_count = (end_address - start_address) / 4 + 1;
+  auto interpreted = std::make_unique<InterpretedFunction>(this, function,
+                                                           instr_count);
+  auto memory = frontend_->memory();
+  for (uint32_t n = 0; n < instr_count; ++n) {
+    auto& instr = interpreted->instrs[n];
+    InstrData& i = instr.i;
+    i.address = start_address + n * 4;
+    i.code = xe::load_and_swap<uint32_t>(memory->TranslateVirtual(i.address));
+    i.opcode = LookupOpcode(i.code);
+    i.opcode_info = &GetOpcodeInfo(i.opcode);
+    instr.target = nullptr;
+    instr.callee_address = 0;
+    instr.callee = nullptr;
+    if (i.opcode == PPCOpcode::kInvalid) {
+      instr.interpret = InterpretInvalid;
+      continue;
+    }
+    if (!i.opcode_info->interpret || !CanInterpret(i)) {
+      return false;
+    }
+    instr.interpret = i.opcode_info->interpret;
+
+    // Direct branches go to an instruction of the function, or call the
+    // function at the target, the same way they are compiled.
+    uint32_t target;
+    bool lk;
+    if (i.opcode == PPCOpcode::bx) {
+      target = uint32_t((i.I.AA ? 0 : i.address) + XEEXTS26(i.I.LI << 2));
+      lk = i.I.LK;
+    } else if (i.opcode == PPCOpcode::bcx) {
+      target = uint32_t((i.B.AA ? 0 : i.address) + XEEXTS16(i.B.BD << 2));
+      lk = i.B.LK;
+    } else {
+      continue;
+    }
+    bool is_recursion = target == start_address && lk;
+    if (!is_recursion && target >= start_address && target <= end_address) {
+      instr.target = &interpreted->instrs[(target - start_address) / 4];
+    } else {
+      if (!processor->LookupFunction(target)) {
+        return false;
+      }
+      instr.callee_address = target;
+    }
+  }
+
+  if (!processor->backend()->SetupInterpreterEntry(function, Entry,
+                                                   interpreted.get())) {
+    return false;
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  functions_[function] = std::move(interpreted);
+  return true;
+}
+
+void PPCInterpreter::Release(GuestFunction* function) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  functions_.erase(function);
+}
+
+bool PPCInterpreter::is_interpreting(GuestFunction* function) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = functions_.find(function);
+  return it != functions_.end() &&
+         it->second->state != InterpretedFunction::State::kPromoted;
+}
+
+void PPCInterpreter::Promote(InterpretedFunction* function) {
+  auto state = InterpretedFunction::State::kInterpreting;
+  if (!function->state.compare_exchange_strong(
+          state, InterpretedFunction::State::kPromoting)) {
+    // Already done, or being done by another thread.
+    return;
+  }
+  if (frontend_->processor()->PromoteFunction(function->function)) {
+    function->state = InterpretedFunction::State::kPromoted;
+  } else {
+    XELOGE("Failed to compile interpreted function %.8X",
+           function->function->address());
+    function->state = InterpretedFunction::State::kPromotionFailed;
+  }
+}
+
+void PPCInterpreter::Entry(void* raw_context, void* data,
+                           uint32_t return_address) {
+  auto ctx = reinterpret_cast<PPCContext*>(raw_context);
+  auto function = reinterpret_cast<InterpretedFunction*>(data);
+  auto interpreter = function->interpreter;
+
+  if (function->state == InterpretedFunction::State::kInterpreting &&
+      function->call_count.fetch_add(1, std::memory_order_relaxed) + 1 >=
+          uint32_t(cvars::interpreter_call_threshold)) {
+    interpreter->Promote(function);
+  }
+  if (function->state == InterpretedFunction::State::kPromoted) {
+    // Callers still reaching the interpreter get the compiled code.
+    function->function->Call(ctx->thread_state, return_address);
+    return;
+  }
+
+  PollSafepoint(ctx);
+
+  InterpreterFrame frame;
+  frame.context = ctx;
+  frame.membase = ctx->virtual_membase;
+  frame.memory = ctx->processor->memory();
+  frame.function = function;
+  frame.return_address = return_address;
+  frame.upper_address_offset = interpreter->upper_address_offset_;
+  frame.back_edge_count = 0;
+  const InterpretedInstr* begin = function->instrs.get();
+  const InterpretedInstr* end = begin + function->instr_count;
+  if (cvars::clock_virtual) {
+    Dispatch<true>(frame, begin, end);
+  } else {
+    Dispatch<false>(frame, begin, end);
+  }
+}
+
+}  // namespace ppc
+}  // namespace cpu
+}  // namespace xe
@@ -0,0 +1,70 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2020 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#ifndef XENIA_CPU_PPC_PPC_INTERPRETER_H_
+#define XENIA_CPU_PPC_PPC_INTERPRETER_H_
+
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+#include "xenia/cpu/function.h"
+
+namespace xe {
+namespace cpu {
+namespace ppc {
+
+class PPCFrontend;
+struct InterpretedFunction;
+
+void RegisterInterpretCategoryALU();
+void RegisterInterpretCategoryControl();
+void RegisterInterpretCategoryMemory();
+
+// Runs guest functions from their decoded instructions, without compiling
+// them, until they have been called or have looped often enough to be worth
+// compiling (--interpreter_call_threshold, --interpreter_loop_threshold).
+// Only functions made entirely of instructions it has handlers for are
+// interpreted - integer (but not divide), branch, condition register and
+// load/store ones - and everything else is compiled on first use as before.
+// Off by default.
+class PPCInterpreter {
+ public:
+  explicit PPCInterpreter(PPCFrontend* frontend);
+  ~PPCInterpreter();
+
+  // Decodes the function and has calls to it interpreted until it is
+  // promoted. Returns false if it must be compiled instead.
+  bool Prepare(GuestFunction* function, uint32_t debug_info_flags);
+  // Frees what was decoded for the function once nothing can be running it.
+  void Release(GuestFunction* function);
+
+  // Whether calls to the function are still interpreted.
+  bool is_interpreting(GuestFunction* function);
+
+  // Compiles the function so that calls to it no longer reach the
+  // interpreter. Threads already interpreting it carry on doing so until they
+  // return from it.
+  void Promote(InterpretedFunction* function);
+
+ private:
+  static void Entry(void* raw_context, void* data, uint32_t return_address);
+
+  PPCFrontend* frontend_;
+  uint32_t upper_address_offset_;
+  std::mutex mutex_;
+  std::unordered_map<GuestFunction*, std::unique_ptr<InterpretedFunction>>
+      functions_;
+};
+
+}  // namespace ppc
+}  // namespace cpu
+}  // namespace xe
+
+#endif  // XENIA_CPU_PPC_PPC_INTERPRETER_H_
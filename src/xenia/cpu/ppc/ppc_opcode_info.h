@@ -20,6 +20,8 @@ namespace cpu {
 namespace ppc {
 
 struct InstrData;
+struct InterpretedInstr;
+struct InterpreterFrame;
 class PPCHIRBuilder;
 
 enum class PPCOpcodeFormat {
@@ -67,11 +69,16 @@ enum class PPCOpcodeType {
 };
 
 typedef int (*InstrEmitFn)(PPCHIRBuilder& f, const InstrData& i);
+// Executes one decoded instruction and returns the next one to execute, or
+// null when the function has returned.
+typedef const InterpretedInstr* (*InstrInterpretFn)(
+    InterpreterFrame& frame, const InterpretedInstr* instr);
 
 struct PPCOpcodeInfo {
   PPCOpcodeGroup group;
   PPCOpcodeType type;
   InstrEmitFn emit;
+  InstrInterpretFn interpret;
 };
 
 struct PPCDecodeData;
@@ -151,6 +158,7 @@ const PPCOpcodeInfo& GetOpcodeInfo(PPCOpcode opcode);
 const PPCOpcodeDisasmInfo& GetOpcodeDisasmInfo(PPCOpcode opcode);
 
 void RegisterOpcodeEmitter(PPCOpcode opcode, InstrEmitFn fn);
+void RegisterOpcodeInterpreter(PPCOpcode opcode, InstrInterpretFn fn);
 void RegisterOpcodeDisasm(PPCOpcode opcode, InstrDisasmFn fn);
 
 inline const PPCOpcodeInfo& LookupOpcodeInfo(uint32_t code) {
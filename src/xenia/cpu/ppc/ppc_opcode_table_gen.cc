@@ -12,7 +12,7 @@ namespace cpu {
 namespace ppc {
 
 #define INSTRUCTION(opcode, mnem, form, group, type) \
-    {PPCOpcodeGroup::group, PPCOpcodeType::type, nullptr}
+    {PPCOpcodeGroup::group, PPCOpcodeType::type, nullptr, nullptr}
 PPCOpcodeInfo ppc_opcode_table[] = {
   INSTRUCTION(0x7c000014, "addcx"       , kXO     , kI, kGeneral),
   INSTRUCTION(0x7c000114, "addex"       , kXO     , kI, kGeneral),
@@ -479,6 +479,10 @@ void RegisterOpcodeEmitter(PPCOpcode opcode, InstrEmitFn fn) {
   assert_null(ppc_opcode_table[static_cast<int>(opcode)].emit);
   ppc_opcode_table[static_cast<int>(opcode)].emit = fn;
 }
+void RegisterOpcodeInterpreter(PPCOpcode opcode, InstrInterpretFn fn) {
+  assert_null(ppc_opcode_table[static_cast<int>(opcode)].interpret);
+  ppc_opcode_table[static_cast<int>(opcode)].interpret = fn;
+}
 
 }  // namespace ppc
 }  // namespace cpu
@@ -11,7 +11,9 @@
 
 #include "xenia/base/assert.h"
 #include "xenia/base/byte_order.h"
+#include "xenia/base/clock.h"
 #include "xenia/base/memory.h"
+#include "xenia/base/platform.h"
 #include "xenia/base/profiling.h"
 #include "xenia/base/reset_scope.h"
 #include "xenia/cpu/compiler/compiler_passes.h"
@@ -41,9 +43,24 @@ PPCTranslator::PPCTranslator(PPCFrontend* frontend) : frontend_(frontend) {
 
   bool validate = cvars::validate_hir;
 
+  if (cvars::clock_virtual) {
+    // Before anything merges blocks or drops SOURCE_OFFSETs.
+    compiler_->AddPass(std::make_unique<passes::VirtualClockPass>());
+  }
+#if !XE_PLATFORM_WIN32
+  if (cvars::safepoints) {
+    // Also needs the blocks in guest order.
+    compiler_->AddPass(std::make_unique<passes::SafepointPass>());
+  }
+#endif  // !XE_PLATFORM_WIN32
+
   // Merge blocks early. This will let us use more context in other passes.
   // The CFG is required for simplification and dirtied by it.
   compiler_->AddPass(std::make_unique<passes::ControlFlowAnalysisPass>());
+  if (cvars::lazy_fpscr_updates) {
+    // Needs the CFG before simplification dirties it.
+    compiler_->AddPass(std::make_unique<passes::FPSCRUpdateEliminationPass>());
+  }
   compiler_->AddPass(std::make_unique<passes::ControlFlowSimplificationPass>());
 
   // Passes are executed in the order they are added. Multiple of the same
@@ -61,6 +78,15 @@ PPCTranslator::PPCTranslator(PPCFrontend* frontend) : frontend_(frontend) {
   if (validate) sap->AddPass(std::make_unique<passes::ValidationPass>());
   compiler_->AddPass(std::move(sap));
 
+  if (cvars::promote_stack_slots) {
+    // Before memory sequence combination folds the byte swaps into the loads
+    // and stores. Constant propagation may have removed branches since the CFG
+    // was built.
+    compiler_->AddPass(std::make_unique<passes::ControlFlowAnalysisPass>());
+    compiler_->AddPass(std::make_unique<passes::StackPromotionPass>());
+    if (validate)
+      compiler_->AddPass(std::make_unique<passes::ValidationPass>());
+  }
   if (backend->machine_info()->supports_extended_load_store) {
     // Backend supports the advanced LOAD/STORE instructions.
     // These will save us a lot of HIR opcodes.
@@ -69,6 +95,13 @@ PPCTranslator::PPCTranslator(PPCFrontend* frontend) : frontend_(frontend) {
     if (validate)
       compiler_->AddPass(std::make_unique<passes::ValidationPass>());
   }
+  if (cvars::global_value_numbering) {
+    // Constant propagation may have removed branches since the CFG was built.
+    compiler_->AddPass(std::make_unique<passes::ControlFlowAnalysisPass>());
+    compiler_->AddPass(std::make_unique<passes::GlobalValueNumberingPass>());
+    if (validate)
+      compiler_->AddPass(std::make_unique<passes::ValidationPass>());
+  }
   compiler_->AddPass(std::make_unique<passes::SimplificationPass>());
   if (validate) compiler_->AddPass(std::make_unique<passes::ValidationPass>());
   // compiler_->AddPass(std::make_unique<passes::DeadStoreEliminationPass>());
@@ -261,3 +261,62 @@ test_rlwinm_12:
   blr
   #_ REGISTER_OUT r4 0xFFFFFFFFFFFFFFFF
   #_ REGISTER_OUT r7 0xFFFFFFFFC0000003
+
+test_rlwinm_13:
+  # slwi
+  #_ REGISTER_IN r4 0xFFFFFFFF12345678
+  rlwinm r3, r4, 8, 0, 23
+  blr
+  #_ REGISTER_OUT r3 0x34567800
+  #_ REGISTER_OUT r4 0xFFFFFFFF12345678
+
+test_rlwinm_14:
+  # srwi
+  #_ REGISTER_IN r4 0xFFFFFFFF12345678
+  rlwinm r3, r4, 24, 8, 31
+  blr
+  #_ REGISTER_OUT r3 0x00123456
+  #_ REGISTER_OUT r4 0xFFFFFFFF12345678
+
+test_rlwinm_15:
+  # extrwi r3, r4, 8, 4
+  #_ REGISTER_IN r4 0xFFFFFFFF12345678
+  rlwinm r3, r4, 12, 24, 31
+  blr
+  #_ REGISTER_OUT r3 0x23
+  #_ REGISTER_OUT r4 0xFFFFFFFF12345678
+
+test_rlwinm_16:
+  # clrlwi
+  #_ REGISTER_IN r4 0xFFFFFFFF12345678
+  rlwinm r3, r4, 0, 16, 31
+  blr
+  #_ REGISTER_OUT r3 0x5678
+  #_ REGISTER_OUT r4 0xFFFFFFFF12345678
+
+test_rlwinm_17:
+  # clrrwi
+  #_ REGISTER_IN r4 0xFFFFFFFF12345678
+  rlwinm r3, r4, 0, 0, 19
+  blr
+  #_ REGISTER_OUT r3 0x12345000
+  #_ REGISTER_OUT r4 0xFFFFFFFF12345678
+
+test_rlwinm_18:
+  # rotlwi
+  #_ REGISTER_IN r4 0xFFFFFFFF12345678
+  rlwinm r3, r4, 8, 0, 31
+  blr
+  #_ REGISTER_OUT r3 0x34567812
+  #_ REGISTER_OUT r4 0xFFFFFFFF12345678
+
+test_rlwinm_19:
+  # slwi.
+  #_ REGISTER_IN r4 0xFFFFFFFF18000000
+  #_ REGISTER_IN cr 0
+  rlwinm. r3, r4, 4, 0, 27
+  mfcr r12
+  blr
+  #_ REGISTER_OUT r3 0x80000000
+  #_ REGISTER_OUT r4 0xFFFFFFFF18000000
+  #_ REGISTER_OUT r12 0x80000000
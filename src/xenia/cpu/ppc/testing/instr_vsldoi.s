@@ -27,3 +27,37 @@ test_vsldoi_3:
   #_ REGISTER_OUT v3 [00010203, 04050607, 08090A0B, 0C0D0E0F]
   #_ REGISTER_OUT v4 [10111213, 14151617, 18191A1B, 1C1D1E1F]
   #_ REGISTER_OUT v5 [0F101112, 13141516, 1718191A, 1B1C1D1E]
+
+test_vsldoi_4:
+  #_ REGISTER_IN v3 [00010203, 04050607, 08090A0B, 0C0D0E0F]
+  vsldoi v5, v3, v3, 4
+  blr
+  #_ REGISTER_OUT v3 [00010203, 04050607, 08090A0B, 0C0D0E0F]
+  #_ REGISTER_OUT v5 [04050607, 08090A0B, 0C0D0E0F, 00010203]
+
+test_vsldoi_5:
+  #_ REGISTER_IN v3 [00010203, 04050607, 08090A0B, 0C0D0E0F]
+  vsldoi v5, v3, v3, 8
+  blr
+  #_ REGISTER_OUT v3 [00010203, 04050607, 08090A0B, 0C0D0E0F]
+  #_ REGISTER_OUT v5 [08090A0B, 0C0D0E0F, 00010203, 04050607]
+
+test_vsldoi_6:
+  #_ REGISTER_IN v3 [00010203, 04050607, 08090A0B, 0C0D0E0F]
+  vsldoi v3, v3, v3, 12
+  blr
+  #_ REGISTER_OUT v3 [0C0D0E0F, 00010203, 04050607, 08090A0B]
+
+test_vsldoi_7:
+  #_ REGISTER_IN v3 [00010203, 04050607, 08090A0B, 0C0D0E0F]
+  vsldoi v5, v3, v3, 5
+  blr
+  #_ REGISTER_OUT v3 [00010203, 04050607, 08090A0B, 0C0D0E0F]
+  #_ REGISTER_OUT v5 [05060708, 090A0B0C, 0D0E0F00, 01020304]
+
+test_vsldoi128_1:
+  #_ REGISTER_IN v3 [00010203, 04050607, 08090A0B, 0C0D0E0F]
+  vsldoi128 v5, v3, v3, 4
+  blr
+  #_ REGISTER_OUT v3 [00010203, 04050607, 08090A0B, 0C0D0E0F]
+  #_ REGISTER_OUT v5 [04050607, 08090A0B, 0C0D0E0F, 00010203]
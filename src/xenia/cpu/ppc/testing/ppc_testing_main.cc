@@ -7,6 +7,9 @@
  ******************************************************************************
  */
 
+#include <chrono>
+#include <climits>
+
 #include "xenia/base/filesystem.h"
 #include "xenia/base/logging.h"
 #include "xenia/base/main.h"
@@ -16,6 +19,7 @@
 #include "xenia/cpu/cpu_flags.h"
 #include "xenia/cpu/ppc/ppc_context.h"
 #include "xenia/cpu/ppc/ppc_frontend.h"
+#include "xenia/cpu/ppc/ppc_interpreter.h"
 #include "xenia/cpu/processor.h"
 #include "xenia/cpu/raw_module.h"
 
@@ -28,6 +32,14 @@ DEFINE_string(test_path, "src/xenia/cpu/ppc/testing/",
 DEFINE_string(test_bin_path, "src/xenia/cpu/ppc/testing/bin/",
               "Directory with binary outputs of the test files.", "Other");
 DEFINE_transient_string(test_name, "", "Specifies test name.", "General");
+DEFINE_int32(benchmark_run_iterations, 0,
+             "Instead of running the tests, run each test function this many "
+             "times and report how long execution took.",
+             "Other");
+DEFINE_bool(test_interpreter, false,
+            "Run every test again interpreted. Tests using instructions the "
+            "interpreter can't run are skipped in that pass, and counted.",
+            "Other");
 
 namespace xe {
 namespace cpu {
@@ -184,7 +196,9 @@ class TestRunner {
     memory.reset();
   }
 
-  bool Setup(TestSuite& suite) {
+  // With interpret, test functions the interpreter can run are interpreted
+  // instead of compiled, given the thresholds set by RunTests.
+  bool Setup(TestSuite& suite, bool interpret = false) {
     // Reset memory.
     memory->Reset();
 
@@ -204,10 +218,14 @@ class TestRunner {
       }
     }
 
-    // Setup a fresh processor.
+    // Setup a fresh processor. The previous thread is registered with the
+    // previous processor, so it must go first.
+    thread_state.reset();
     processor.reset(new Processor(memory.get(), nullptr));
     processor->Setup(std::move(backend));
-    processor->set_debug_info_flags(DebugInfoFlags::kDebugInfoAll);
+    // Tracing is only done by compiled code.
+    processor->set_debug_info_flags(interpret ? DebugInfoFlags::kDebugInfoNone
+                                              : DebugInfoFlags::kDebugInfoAll);
 
     // Load the binary module.
     auto module = std::make_unique<xe::cpu::RawModule>(processor.get());
@@ -236,6 +254,15 @@ class TestRunner {
     return true;
   }
 
+  // Whether the test function is interpreted rather than compiled, given the
+  // thresholds set by RunTests.
+  bool IsInterpreted(TestCase& test_case) {
+    auto fn = processor->ResolveFunction(test_case.address);
+    return fn && fn->is_guest() &&
+           processor->frontend()->interpreter()->is_interpreting(
+               static_cast<xe::cpu::GuestFunction*>(fn));
+  }
+
   bool Run(TestCase& test_case) {
     // Setup test state from annotations.
     if (!SetupTestState(test_case)) {
@@ -257,15 +284,38 @@ class TestRunner {
     // Assert test state expectations.
     bool result = CheckTestResults(test_case);
     if (!result) {
-      // Also dump all disasm/etc.
+      // Also dump all disasm/etc, if it was compiled.
       if (fn->is_guest()) {
-        static_cast<xe::cpu::GuestFunction*>(fn)->debug_info()->Dump();
+        auto debug_info =
+            static_cast<xe::cpu::GuestFunction*>(fn)->debug_info();
+        if (debug_info) {
+          debug_info->Dump();
+        }
       }
     }
 
     return result;
   }
 
+  // Returns the time taken to run the test function the given number of times
+  // in milliseconds, excluding compilation, or a negative value if it couldn't
+  // be compiled. Test expectations aren't checked.
+  double TimeRun(TestCase& test_case, int iterations) {
+    auto fn = processor->ResolveFunction(test_case.address);
+    if (!fn) {
+      return -1.0;
+    }
+    auto ctx = thread_state->context();
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int n = 0; n < iterations; ++n) {
+      SetupTestState(test_case);
+      ctx->lr = 0xBCBCBCBC;
+      fn->Call(thread_state.get(), uint32_t(ctx->lr));
+    }
+    auto elapsed = std::chrono::high_resolution_clock::now() - start;
+    return std::chrono::duration<double, std::milli>(elapsed).count();
+  }
+
   bool SetupTestState(TestCase& test_case) {
     auto ppc_context = thread_state->context();
     for (auto& it : test_case.annotations) {
@@ -376,21 +426,24 @@ int filter(unsigned int code) {
 #endif  // XE_COMPILER_MSVC
 
 void ProtectedRunTest(TestSuite& test_suite, TestRunner& runner,
-                      TestCase& test_case, int& failed_count,
-                      int& passed_count) {
+                      TestCase& test_case, bool interpret, int& failed_count,
+                      int& passed_count, int& skipped_count) {
 #if XE_COMPILER_MSVC
   __try {
 #endif  // XE_COMPILER_MSVC
 
-    if (!runner.Setup(test_suite)) {
+    if (!runner.Setup(test_suite, interpret)) {
       XELOGE("    TEST FAILED SETUP");
       ++failed_count;
-    }
-    if (runner.Run(test_case)) {
-      ++passed_count;
-    } else {
+    } else if (interpret && !runner.IsInterpreted(test_case)) {
+      // Compiled code would run it, as already tested in the compiled pass.
+      XELOGI("    SKIPPED (NOT INTERPRETED)");
+      ++skipped_count;
+    } else if (!runner.Run(test_case)) {
       XELOGE("    TEST FAILED");
       ++failed_count;
+    } else {
+      ++passed_count;
     }
 
 #if XE_COMPILER_MSVC
@@ -401,6 +454,37 @@ void ProtectedRunTest(TestSuite& test_suite, TestRunner& runner,
 #endif  // XE_COMPILER_MSVC
 }
 
+bool BenchmarkRun(std::vector<TestSuite>& test_suites, int iterations) {
+  TestRunner runner;
+  double total_ms = 0;
+  size_t run_count = 0;
+  for (auto& test_suite : test_suites) {
+    double suite_ms = 0;
+    for (auto& test_case : test_suite.test_cases) {
+      if (!runner.Setup(test_suite)) {
+        XELOGE("%ls.s: setup failed", test_suite.name.c_str());
+        return false;
+      }
+      double ms = runner.TimeRun(test_case, iterations);
+      if (ms < 0) {
+        XELOGE("%ls.s: %s failed to compile", test_suite.name.c_str(),
+               test_case.name.c_str());
+        return false;
+      }
+      XELOGI("%ls.s: %s: %.3f us per run", test_suite.name.c_str(),
+             test_case.name.c_str(), ms * 1000 / iterations);
+      suite_ms += ms;
+      run_count += iterations;
+    }
+    total_ms += suite_ms;
+  }
+
+  XELOGI("");
+  XELOGI("Ran %zu functions in %.3f ms (%.4f us each)", run_count, total_ms,
+         run_count ? total_ms * 1000 / run_count : 0.0);
+  return true;
+}
+
 bool RunTests(const std::wstring& test_name) {
   int result_code = 1;
   int failed_count = 0;
@@ -438,18 +522,45 @@ bool RunTests(const std::wstring& test_name) {
   }
 
   XELOGI("%d tests loaded.", (int)test_suites.size());
-  TestRunner runner;
-  for (auto& test_suite : test_suites) {
-    XELOGI("%ls.s:", test_suite.name.c_str());
+  if (cvars::benchmark_run_iterations > 0) {
+    return BenchmarkRun(test_suites, cvars::benchmark_run_iterations);
+  }
 
-    for (auto& test_case : test_suite.test_cases) {
-      XELOGI("  - %s", test_case.name.c_str());
-      ProtectedRunTest(test_suite, runner, test_case, failed_count,
-                       passed_count);
+  // Every test is run compiled and, with --test_interpreter, again
+  // interpreted, as the two must give the same results.
+  int32_t call_threshold = cvars::interpreter_call_threshold;
+  int32_t loop_threshold = cvars::interpreter_loop_threshold;
+  TestRunner runner;
+  for (bool interpret : {false, true}) {
+    if (interpret && !cvars::test_interpreter) {
+      continue;
     }
+    const char* tier = interpret ? "interpreted" : "compiled";
+    cvars::interpreter_call_threshold = interpret ? INT32_MAX : 0;
+    cvars::interpreter_loop_threshold = interpret ? INT32_MAX : 0;
+    int tier_failed_count = 0;
+    int tier_passed_count = 0;
+    int tier_skipped_count = 0;
+    for (auto& test_suite : test_suites) {
+      XELOGI("%ls.s (%s):", test_suite.name.c_str(), tier);
+
+      for (auto& test_case : test_suite.test_cases) {
+        XELOGI("  - %s", test_case.name.c_str());
+        ProtectedRunTest(test_suite, runner, test_case, interpret,
+                         tier_failed_count, tier_passed_count,
+                         tier_skipped_count);
+      }
 
+      XELOGI("");
+    }
+    XELOGI("%s: %d passed, %d failed, %d skipped", tier, tier_passed_count,
+           tier_failed_count, tier_skipped_count);
     XELOGI("");
+    failed_count += tier_failed_count;
+    passed_count += tier_passed_count;
   }
+  cvars::interpreter_call_threshold = call_threshold;
+  cvars::interpreter_loop_threshold = loop_threshold;
 
   XELOGI("");
   XELOGI("Total tests: %d", failed_count + passed_count);
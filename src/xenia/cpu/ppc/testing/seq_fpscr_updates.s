@@ -0,0 +1,113 @@
+test_fpscr_updates_1:
+  #_ REGISTER_IN f1 1.0
+  #_ REGISTER_IN f2 2.0
+  #_ REGISTER_IN f10 0x00000000F0000000
+  mtfsf 0xFF, f10
+  fadd f3, f1, f2
+  fmul f3, f3, f2
+  mffs f4
+  blr
+  #_ REGISTER_OUT f3 6.0
+  #_ REGISTER_OUT f4 0x0000000090000000
+
+test_fpscr_updates_2:
+  #_ REGISTER_IN r3 0
+  #_ REGISTER_IN f1 1.0
+  #_ REGISTER_IN f2 2.0
+  #_ REGISTER_IN f10 0x00000000F0000000
+  mtfsf 0xFF, f10
+  cmpwi r3, 0
+  beq fpscr_updates_2_skip
+  fadd f3, f1, f2
+fpscr_updates_2_skip:
+  mffs f4
+  blr
+  #_ REGISTER_OUT f4 0x00000000F0000000
+
+test_fpscr_updates_3:
+  #_ REGISTER_IN r3 1
+  #_ REGISTER_IN f1 1.0
+  #_ REGISTER_IN f2 2.0
+  #_ REGISTER_IN f10 0x00000000F0000000
+  mtfsf 0xFF, f10
+  cmpwi r3, 0
+  beq fpscr_updates_3_skip
+  fadd f3, f1, f2
+fpscr_updates_3_skip:
+  mffs f4
+  blr
+  #_ REGISTER_OUT f3 3.0
+  #_ REGISTER_OUT f4 0x0000000090000000
+
+test_fpscr_updates_4:
+  # The loop head follows an update, and the loop sets the bits it clears.
+  #_ REGISTER_IN r4 2
+  #_ REGISTER_IN f1 1.0
+  #_ REGISTER_IN f2 2.0
+  #_ REGISTER_IN f10 0x00000000F0000000
+  mtctr r4
+  fadd f3, f1, f2
+fpscr_updates_4_loop:
+  mffs f4
+  mtfsf 0xFF, f10
+  bdnz fpscr_updates_4_loop
+  mffs f5
+  blr
+  #_ REGISTER_OUT f4 0x00000000F0000000
+  #_ REGISTER_OUT f5 0x00000000F0000000
+
+test_fpscr_updates_5:
+  #_ REGISTER_IN cr 0x0F000000
+  #_ REGISTER_IN f1 1.0
+  #_ REGISTER_IN f2 2.0
+  fadd. f3, f1, f2
+  fmul f3, f3, f2
+  blr
+  #_ REGISTER_OUT f3 6.0
+  #_ REGISTER_OUT cr 0
+
+test_fpscr_updates_6:
+  # FP-heavy; also used for benchmarking.
+  #_ REGISTER_IN f1 1.0
+  #_ REGISTER_IN f2 0.5
+  #_ REGISTER_IN f10 0x00000000F0000000
+  fmr f3, f1
+  mtfsf 0xFF, f10
+  fadd f3, f3, f1
+  fmul f3, f3, f2
+  fadd f3, f3, f1
+  fmul f3, f3, f2
+  fadd f3, f3, f1
+  fmul f3, f3, f2
+  fadd f3, f3, f1
+  fmul f3, f3, f2
+  fadd f3, f3, f1
+  fmul f3, f3, f2
+  fadd f3, f3, f1
+  fmul f3, f3, f2
+  fadd f3, f3, f1
+  fmul f3, f3, f2
+  fadd f3, f3, f1
+  fmul f3, f3, f2
+  fadd f3, f3, f1
+  fmul f3, f3, f2
+  fadd f3, f3, f1
+  fmul f3, f3, f2
+  fadd f3, f3, f1
+  fmul f3, f3, f2
+  fadd f3, f3, f1
+  fmul f3, f3, f2
+  fadd f3, f3, f1
+  fmul f3, f3, f2
+  fadd f3, f3, f1
+  fmul f3, f3, f2
+  fadd f3, f3, f1
+  fmul f3, f3, f2
+  fadd f3, f3, f1
+  fmul f3, f3, f2
+  fmadd f5, f3, f2, f1
+  mffs f4
+  blr
+  #_ REGISTER_OUT f3 1.0
+  #_ REGISTER_OUT f4 0x0000000090000000
+  #_ REGISTER_OUT f5 1.5
@@ -0,0 +1,139 @@
+# Sequences recognized as idioms by the frontend (unless
+# --recognize_idioms=false), which must behave exactly like the individual
+# instructions.
+
+test_idiom_cr_bit_1:
+  # mfcr, extrwi
+  #_ REGISTER_IN cr 0x12345678
+  mfcr r11
+  extrwi r3, r11, 1, 26
+  blr
+  #_ REGISTER_OUT r3 1
+  #_ REGISTER_OUT r11 0x12345678
+
+test_idiom_cr_bit_2:
+  # mfocrf, not, extrwi
+  #_ REGISTER_IN cr 0x12345658
+  mfocrf r11, 0x02
+  not r10, r11
+  extrwi r3, r10, 1, 26
+  blr
+  #_ REGISTER_OUT r3 1
+  #_ REGISTER_OUT r10 0xFFFFFFFFFFFFFFAF
+  #_ REGISTER_OUT r11 0x50
+
+test_idiom_cr_bit_3:
+  # Same register all the way through.
+  #_ REGISTER_IN cr 0x12345658
+  mfocrf r3, 0x02
+  not r3, r3
+  extrwi r3, r3, 1, 25
+  blr
+  #_ REGISTER_OUT r3 0
+
+test_idiom_cr_bit_4:
+  # not. updates cr0 after the CR has been read.
+  #_ REGISTER_IN cr 0x22345658
+  mfcr r11
+  not. r10, r11
+  extrwi r3, r10, 1, 0
+  mfcr r12
+  blr
+  #_ REGISTER_OUT r3 1
+  #_ REGISTER_OUT r10 0xFFFFFFFFDDCBA9A7
+  #_ REGISTER_OUT r11 0x22345658
+  #_ REGISTER_OUT r12 0x82345658
+
+test_idiom_cr_bit_5:
+  # extrwi. updates cr0 from the extracted bit.
+  #_ REGISTER_IN cr 0x22345678
+  mfcr r11
+  extrwi. r3, r11, 1, 26
+  mfcr r12
+  blr
+  #_ REGISTER_OUT r3 1
+  #_ REGISTER_OUT r11 0x22345678
+  #_ REGISTER_OUT r12 0x42345678
+
+test_idiom_cr_bit_6:
+  # The extrwi is a branch target, so it can't be part of an idiom - the
+  # second time around it must read r11 again.
+  #_ REGISTER_IN cr 0x12345678
+  li r4, 2
+  mfcr r11
+idiom_cr_bit_6_loop:
+  extrwi r3, r11, 1, 26
+  li r11, 0
+  addic. r4, r4, -1
+  bne idiom_cr_bit_6_loop
+  blr
+  #_ REGISTER_OUT r3 0
+  #_ REGISTER_OUT r4 0
+  #_ REGISTER_OUT r11 0
+
+test_idiom_shift_by_octet_1:
+  #_ REGISTER_IN v1 [00010203, 04050607, 08090A0B, 0C0D0E0F]
+  vspltisb v0, 8
+  vslo v3, v1, v0
+  blr
+  #_ REGISTER_OUT v0 [08080808, 08080808, 08080808, 08080808]
+  #_ REGISTER_OUT v1 [00010203, 04050607, 08090A0B, 0C0D0E0F]
+  #_ REGISTER_OUT v3 [01020304, 05060708, 090A0B0C, 0D0E0F00]
+
+test_idiom_shift_by_octet_2:
+  #_ REGISTER_IN v1 [00010203, 04050607, 08090A0B, 0C0D0E0F]
+  vspltisb v0, 15
+  vsro v3, v1, v0
+  blr
+  #_ REGISTER_OUT v0 [0F0F0F0F, 0F0F0F0F, 0F0F0F0F, 0F0F0F0F]
+  #_ REGISTER_OUT v1 [00010203, 04050607, 08090A0B, 0C0D0E0F]
+  #_ REGISTER_OUT v3 [00000102, 03040506, 0708090A, 0B0C0D0E]
+
+test_idiom_shift_by_octet_3:
+  # Only bits 1-4 of the amount are used: -8 is 15 octets.
+  #_ REGISTER_IN v1 [AA010203, 04050607, 08090A0B, 0C0D0E0F]
+  vspltisb v0, -8
+  vsro v3, v1, v0
+  blr
+  #_ REGISTER_OUT v0 [F8F8F8F8, F8F8F8F8, F8F8F8F8, F8F8F8F8]
+  #_ REGISTER_OUT v3 [00000000, 00000000, 00000000, 000000AA]
+
+test_idiom_shift_by_octet_4:
+  # -16 is 14 octets.
+  #_ REGISTER_IN v1 [00010203, 04050607, 08090A0B, 0C0D0E0F]
+  vspltisb v0, -16
+  vslo v3, v1, v0
+  blr
+  #_ REGISTER_OUT v0 [F0F0F0F0, F0F0F0F0, F0F0F0F0, F0F0F0F0]
+  #_ REGISTER_OUT v3 [0E0F0000, 00000000, 00000000, 00000000]
+
+test_idiom_shift_by_octet_5:
+  # Less than an octet.
+  #_ REGISTER_IN v1 [00010203, 04050607, 08090A0B, 0C0D0E0F]
+  vspltisb v0, 7
+  vslo v3, v1, v0
+  blr
+  #_ REGISTER_OUT v0 [07070707, 07070707, 07070707, 07070707]
+  #_ REGISTER_OUT v3 [00010203, 04050607, 08090A0B, 0C0D0E0F]
+
+test_idiom_shift_by_octet_6:
+  # The splatted register is also the one shifted.
+  vspltisb v1, 8
+  vslo v3, v1, v1
+  blr
+  #_ REGISTER_OUT v1 [08080808, 08080808, 08080808, 08080808]
+  #_ REGISTER_OUT v3 [08080808, 08080808, 08080808, 08080800]
+
+test_idiom_shift_by_octet_7:
+  #_ REGISTER_IN v1 [00010203, 04050607, 08090A0B, 0C0D0E0F]
+  vspltisb v0, 8
+  vslo128 v3, v1, v0
+  blr
+  #_ REGISTER_OUT v3 [01020304, 05060708, 090A0B0C, 0D0E0F00]
+
+test_idiom_shift_by_octet_8:
+  #_ REGISTER_IN v1 [00010203, 04050607, 08090A0B, 0C0D0E0F]
+  vspltisb v0, 8
+  vsro128 v3, v1, v0
+  blr
+  #_ REGISTER_OUT v3 [00000102, 03040506, 0708090A, 0B0C0D0E]
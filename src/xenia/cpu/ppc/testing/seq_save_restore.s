@@ -0,0 +1,913 @@
+# Calls to the compiler's register save/restore helpers, which are expanded
+# inline unless --inline_save_restore_helpers=false. The helpers below are
+# the exact sequences found in games, so they are detected when the test
+# binary is loaded; results must be the same whether they're called or
+# expanded.
+
+test_save_restore_gprlr_14:
+  #_ REGISTER_IN r14 0x0E11223344556677
+  #_ REGISTER_IN r15 0x0F11223344556677
+  #_ REGISTER_IN r16 0x1011223344556677
+  #_ REGISTER_IN r17 0x1111223344556677
+  #_ REGISTER_IN r18 0x1211223344556677
+  #_ REGISTER_IN r19 0x1311223344556677
+  #_ REGISTER_IN r20 0x1411223344556677
+  #_ REGISTER_IN r21 0x1511223344556677
+  #_ REGISTER_IN r22 0x1611223344556677
+  #_ REGISTER_IN r23 0x1711223344556677
+  #_ REGISTER_IN r24 0x1811223344556677
+  #_ REGISTER_IN r25 0x1911223344556677
+  #_ REGISTER_IN r26 0x1A11223344556677
+  #_ REGISTER_IN r27 0x1B11223344556677
+  #_ REGISTER_IN r28 0x1C11223344556677
+  #_ REGISTER_IN r29 0x1D11223344556677
+  #_ REGISTER_IN r30 0x1E11223344556677
+  #_ REGISTER_IN r31 0x1F11223344556677
+  mflr r3
+  mr r4, r1
+  lis r1, 0x1000
+  ori r1, r1, 0x2000
+  bl save_restore_gprlr_14_body
+  mr r1, r4
+  mtlr r3
+  blr
+  #_ REGISTER_OUT r14 0x0E11223344556677
+  #_ REGISTER_OUT r15 0x0F11223344556677
+  #_ REGISTER_OUT r16 0x1011223344556677
+  #_ REGISTER_OUT r17 0x1111223344556677
+  #_ REGISTER_OUT r18 0x1211223344556677
+  #_ REGISTER_OUT r19 0x1311223344556677
+  #_ REGISTER_OUT r20 0x1411223344556677
+  #_ REGISTER_OUT r21 0x1511223344556677
+  #_ REGISTER_OUT r22 0x1611223344556677
+  #_ REGISTER_OUT r23 0x1711223344556677
+  #_ REGISTER_OUT r24 0x1811223344556677
+  #_ REGISTER_OUT r25 0x1911223344556677
+  #_ REGISTER_OUT r26 0x1A11223344556677
+  #_ REGISTER_OUT r27 0x1B11223344556677
+  #_ REGISTER_OUT r28 0x1C11223344556677
+  #_ REGISTER_OUT r29 0x1D11223344556677
+  #_ REGISTER_OUT r30 0x1E11223344556677
+  #_ REGISTER_OUT r31 0x1F11223344556677
+  #_ MEMORY_OUT 10001F68 0E112233 44556677 0F112233 44556677
+  #_ MEMORY_OUT 10001F78 10112233 44556677 11112233 44556677
+  #_ MEMORY_OUT 10001F88 12112233 44556677 13112233 44556677
+  #_ MEMORY_OUT 10001F98 14112233 44556677 15112233 44556677
+  #_ MEMORY_OUT 10001FA8 16112233 44556677 17112233 44556677
+  #_ MEMORY_OUT 10001FB8 18112233 44556677 19112233 44556677
+  #_ MEMORY_OUT 10001FC8 1A112233 44556677 1B112233 44556677
+  #_ MEMORY_OUT 10001FD8 1C112233 44556677 1D112233 44556677
+  #_ MEMORY_OUT 10001FE8 1E112233 44556677 1F112233 44556677
+
+save_restore_gprlr_14_body:
+  mflr r12
+  bl __savegprlr_14
+  .irp n, 14,15,16,17,18,19,20,21,22,23,24,25,26,27,28,29,30,31
+  li r\n, 0
+  .endr
+  b __restgprlr_14
+
+test_save_restore_gprlr_28:
+  #_ MEMORY_IN 10002FD0 A5A5A5A5 A5A5A5A5
+  #_ REGISTER_IN r27 0x1B11223344556677
+  #_ REGISTER_IN r28 0x1C11223344556677
+  #_ REGISTER_IN r29 0x1D11223344556677
+  #_ REGISTER_IN r30 0x1E11223344556677
+  #_ REGISTER_IN r31 0x1F11223344556677
+  mflr r3
+  mr r4, r1
+  lis r1, 0x1000
+  ori r1, r1, 0x3000
+  bl save_restore_gprlr_28_body
+  mr r1, r4
+  mtlr r3
+  blr
+  #_ REGISTER_OUT r27 0
+  #_ REGISTER_OUT r28 0x1C11223344556677
+  #_ REGISTER_OUT r29 0x1D11223344556677
+  #_ REGISTER_OUT r30 0x1E11223344556677
+  #_ REGISTER_OUT r31 0x1F11223344556677
+  #_ MEMORY_OUT 10002FD0 A5A5A5A5 A5A5A5A5 1C112233 44556677
+  #_ MEMORY_OUT 10002FE0 1D112233 44556677 1E112233 44556677
+  #_ MEMORY_OUT 10002FF0 1F112233 44556677
+
+save_restore_gprlr_28_body:
+  mflr r12
+  bl __savegprlr_28
+  .irp n, 27,28,29,30,31
+  li r\n, 0
+  .endr
+  b __restgprlr_28
+
+test_save_restore_fpr_14:
+  #_ REGISTER_IN f14 0x4E00AABBCCDDEEFF
+  #_ REGISTER_IN f15 0x4F00AABBCCDDEEFF
+  #_ REGISTER_IN f16 0x5000AABBCCDDEEFF
+  #_ REGISTER_IN f17 0x5100AABBCCDDEEFF
+  #_ REGISTER_IN f18 0x5200AABBCCDDEEFF
+  #_ REGISTER_IN f19 0x5300AABBCCDDEEFF
+  #_ REGISTER_IN f20 0x5400AABBCCDDEEFF
+  #_ REGISTER_IN f21 0x5500AABBCCDDEEFF
+  #_ REGISTER_IN f22 0x5600AABBCCDDEEFF
+  #_ REGISTER_IN f23 0x5700AABBCCDDEEFF
+  #_ REGISTER_IN f24 0x5800AABBCCDDEEFF
+  #_ REGISTER_IN f25 0x5900AABBCCDDEEFF
+  #_ REGISTER_IN f26 0x5A00AABBCCDDEEFF
+  #_ REGISTER_IN f27 0x5B00AABBCCDDEEFF
+  #_ REGISTER_IN f28 0x5C00AABBCCDDEEFF
+  #_ REGISTER_IN f29 0x5D00AABBCCDDEEFF
+  #_ REGISTER_IN f30 0x5E00AABBCCDDEEFF
+  #_ REGISTER_IN f31 0x5F00AABBCCDDEEFF
+  mflr r3
+  lis r12, 0x1000
+  ori r12, r12, 0x4000
+  bl __savefpr_14
+  .irp n, 14,15,16,17,18,19,20,21,22,23,24,25,26,27,28,29,30,31
+  fsub f\n, f\n, f\n
+  .endr
+  bl __restfpr_14
+  mtlr r3
+  blr
+  #_ REGISTER_OUT f14 0x4E00AABBCCDDEEFF
+  #_ REGISTER_OUT f15 0x4F00AABBCCDDEEFF
+  #_ REGISTER_OUT f16 0x5000AABBCCDDEEFF
+  #_ REGISTER_OUT f17 0x5100AABBCCDDEEFF
+  #_ REGISTER_OUT f18 0x5200AABBCCDDEEFF
+  #_ REGISTER_OUT f19 0x5300AABBCCDDEEFF
+  #_ REGISTER_OUT f20 0x5400AABBCCDDEEFF
+  #_ REGISTER_OUT f21 0x5500AABBCCDDEEFF
+  #_ REGISTER_OUT f22 0x5600AABBCCDDEEFF
+  #_ REGISTER_OUT f23 0x5700AABBCCDDEEFF
+  #_ REGISTER_OUT f24 0x5800AABBCCDDEEFF
+  #_ REGISTER_OUT f25 0x5900AABBCCDDEEFF
+  #_ REGISTER_OUT f26 0x5A00AABBCCDDEEFF
+  #_ REGISTER_OUT f27 0x5B00AABBCCDDEEFF
+  #_ REGISTER_OUT f28 0x5C00AABBCCDDEEFF
+  #_ REGISTER_OUT f29 0x5D00AABBCCDDEEFF
+  #_ REGISTER_OUT f30 0x5E00AABBCCDDEEFF
+  #_ REGISTER_OUT f31 0x5F00AABBCCDDEEFF
+  #_ MEMORY_OUT 10003F70 4E00AABB CCDDEEFF 4F00AABB CCDDEEFF
+  #_ MEMORY_OUT 10003F80 5000AABB CCDDEEFF 5100AABB CCDDEEFF
+  #_ MEMORY_OUT 10003F90 5200AABB CCDDEEFF 5300AABB CCDDEEFF
+  #_ MEMORY_OUT 10003FA0 5400AABB CCDDEEFF 5500AABB CCDDEEFF
+  #_ MEMORY_OUT 10003FB0 5600AABB CCDDEEFF 5700AABB CCDDEEFF
+  #_ MEMORY_OUT 10003FC0 5800AABB CCDDEEFF 5900AABB CCDDEEFF
+  #_ MEMORY_OUT 10003FD0 5A00AABB CCDDEEFF 5B00AABB CCDDEEFF
+  #_ MEMORY_OUT 10003FE0 5C00AABB CCDDEEFF 5D00AABB CCDDEEFF
+  #_ MEMORY_OUT 10003FF0 5E00AABB CCDDEEFF 5F00AABB CCDDEEFF
+
+test_save_restore_vmx_14:
+  #_ REGISTER_IN v14 [0E000001, 0E000002, 0E000003, 0E000004]
+  #_ REGISTER_IN v15 [0F000001, 0F000002, 0F000003, 0F000004]
+  #_ REGISTER_IN v16 [10000001, 10000002, 10000003, 10000004]
+  #_ REGISTER_IN v17 [11000001, 11000002, 11000003, 11000004]
+  #_ REGISTER_IN v18 [12000001, 12000002, 12000003, 12000004]
+  #_ REGISTER_IN v19 [13000001, 13000002, 13000003, 13000004]
+  #_ REGISTER_IN v20 [14000001, 14000002, 14000003, 14000004]
+  #_ REGISTER_IN v21 [15000001, 15000002, 15000003, 15000004]
+  #_ REGISTER_IN v22 [16000001, 16000002, 16000003, 16000004]
+  #_ REGISTER_IN v23 [17000001, 17000002, 17000003, 17000004]
+  #_ REGISTER_IN v24 [18000001, 18000002, 18000003, 18000004]
+  #_ REGISTER_IN v25 [19000001, 19000002, 19000003, 19000004]
+  #_ REGISTER_IN v26 [1A000001, 1A000002, 1A000003, 1A000004]
+  #_ REGISTER_IN v27 [1B000001, 1B000002, 1B000003, 1B000004]
+  #_ REGISTER_IN v28 [1C000001, 1C000002, 1C000003, 1C000004]
+  #_ REGISTER_IN v29 [1D000001, 1D000002, 1D000003, 1D000004]
+  #_ REGISTER_IN v30 [1E000001, 1E000002, 1E000003, 1E000004]
+  #_ REGISTER_IN v31 [1F000001, 1F000002, 1F000003, 1F000004]
+  mflr r3
+  lis r12, 0x1000
+  ori r12, r12, 0x5008
+  bl __savevmx_14
+  .irp n, 14,15,16,17,18,19,20,21,22,23,24,25,26,27,28,29,30,31
+  vxor v\n, v\n, v\n
+  .endr
+  bl __restvmx_14
+  mtlr r3
+  blr
+  #_ REGISTER_OUT r11 0xFFFFFFFFFFFFFFF0
+  #_ REGISTER_OUT v14 [0E000001, 0E000002, 0E000003, 0E000004]
+  #_ REGISTER_OUT v15 [0F000001, 0F000002, 0F000003, 0F000004]
+  #_ REGISTER_OUT v16 [10000001, 10000002, 10000003, 10000004]
+  #_ REGISTER_OUT v17 [11000001, 11000002, 11000003, 11000004]
+  #_ REGISTER_OUT v18 [12000001, 12000002, 12000003, 12000004]
+  #_ REGISTER_OUT v19 [13000001, 13000002, 13000003, 13000004]
+  #_ REGISTER_OUT v20 [14000001, 14000002, 14000003, 14000004]
+  #_ REGISTER_OUT v21 [15000001, 15000002, 15000003, 15000004]
+  #_ REGISTER_OUT v22 [16000001, 16000002, 16000003, 16000004]
+  #_ REGISTER_OUT v23 [17000001, 17000002, 17000003, 17000004]
+  #_ REGISTER_OUT v24 [18000001, 18000002, 18000003, 18000004]
+  #_ REGISTER_OUT v25 [19000001, 19000002, 19000003, 19000004]
+  #_ REGISTER_OUT v26 [1A000001, 1A000002, 1A000003, 1A000004]
+  #_ REGISTER_OUT v27 [1B000001, 1B000002, 1B000003, 1B000004]
+  #_ REGISTER_OUT v28 [1C000001, 1C000002, 1C000003, 1C000004]
+  #_ REGISTER_OUT v29 [1D000001, 1D000002, 1D000003, 1D000004]
+  #_ REGISTER_OUT v30 [1E000001, 1E000002, 1E000003, 1E000004]
+  #_ REGISTER_OUT v31 [1F000001, 1F000002, 1F000003, 1F000004]
+  #_ MEMORY_OUT 10004EE0 0E000001 0E000002 0E000003 0E000004
+  #_ MEMORY_OUT 10004EF0 0F000001 0F000002 0F000003 0F000004
+  #_ MEMORY_OUT 10004F00 10000001 10000002 10000003 10000004
+  #_ MEMORY_OUT 10004F10 11000001 11000002 11000003 11000004
+  #_ MEMORY_OUT 10004F20 12000001 12000002 12000003 12000004
+  #_ MEMORY_OUT 10004F30 13000001 13000002 13000003 13000004
+  #_ MEMORY_OUT 10004F40 14000001 14000002 14000003 14000004
+  #_ MEMORY_OUT 10004F50 15000001 15000002 15000003 15000004
+  #_ MEMORY_OUT 10004F60 16000001 16000002 16000003 16000004
+  #_ MEMORY_OUT 10004F70 17000001 17000002 17000003 17000004
+  #_ MEMORY_OUT 10004F80 18000001 18000002 18000003 18000004
+  #_ MEMORY_OUT 10004F90 19000001 19000002 19000003 19000004
+  #_ MEMORY_OUT 10004FA0 1A000001 1A000002 1A000003 1A000004
+  #_ MEMORY_OUT 10004FB0 1B000001 1B000002 1B000003 1B000004
+  #_ MEMORY_OUT 10004FC0 1C000001 1C000002 1C000003 1C000004
+  #_ MEMORY_OUT 10004FD0 1D000001 1D000002 1D000003 1D000004
+  #_ MEMORY_OUT 10004FE0 1E000001 1E000002 1E000003 1E000004
+  #_ MEMORY_OUT 10004FF0 1F000001 1F000002 1F000003 1F000004
+
+test_save_restore_vmx_120:
+  #_ REGISTER_IN v120 [78000001, 78000002, 78000003, 78000004]
+  #_ REGISTER_IN v121 [79000001, 79000002, 79000003, 79000004]
+  #_ REGISTER_IN v122 [7A000001, 7A000002, 7A000003, 7A000004]
+  #_ REGISTER_IN v123 [7B000001, 7B000002, 7B000003, 7B000004]
+  #_ REGISTER_IN v124 [7C000001, 7C000002, 7C000003, 7C000004]
+  #_ REGISTER_IN v125 [7D000001, 7D000002, 7D000003, 7D000004]
+  #_ REGISTER_IN v126 [7E000001, 7E000002, 7E000003, 7E000004]
+  #_ REGISTER_IN v127 [7F000001, 7F000002, 7F000003, 7F000004]
+  mflr r3
+  lis r12, 0x1000
+  ori r12, r12, 0x6000
+  bl __savevmx_120
+  .irp n, 120,121,122,123,124,125,126,127
+  vxor128 \n, \n, \n
+  .endr
+  bl __restvmx_120
+  mtlr r3
+  blr
+  #_ REGISTER_OUT r11 0xFFFFFFFFFFFFFFF0
+  #_ REGISTER_OUT v120 [78000001, 78000002, 78000003, 78000004]
+  #_ REGISTER_OUT v121 [79000001, 79000002, 79000003, 79000004]
+  #_ REGISTER_OUT v122 [7A000001, 7A000002, 7A000003, 7A000004]
+  #_ REGISTER_OUT v123 [7B000001, 7B000002, 7B000003, 7B000004]
+  #_ REGISTER_OUT v124 [7C000001, 7C000002, 7C000003, 7C000004]
+  #_ REGISTER_OUT v125 [7D000001, 7D000002, 7D000003, 7D000004]
+  #_ REGISTER_OUT v126 [7E000001, 7E000002, 7E000003, 7E000004]
+  #_ REGISTER_OUT v127 [7F000001, 7F000002, 7F000003, 7F000004]
+  #_ MEMORY_OUT 10005F80 78000001 78000002 78000003 78000004
+  #_ MEMORY_OUT 10005F90 79000001 79000002 79000003 79000004
+  #_ MEMORY_OUT 10005FA0 7A000001 7A000002 7A000003 7A000004
+  #_ MEMORY_OUT 10005FB0 7B000001 7B000002 7B000003 7B000004
+  #_ MEMORY_OUT 10005FC0 7C000001 7C000002 7C000003 7C000004
+  #_ MEMORY_OUT 10005FD0 7D000001 7D000002 7D000003 7D000004
+  #_ MEMORY_OUT 10005FE0 7E000001 7E000002 7E000003 7E000004
+  #_ MEMORY_OUT 10005FF0 7F000001 7F000002 7F000003 7F000004
+
+# Helpers, as emitted by the compiler.
+__savegprlr_14:
+  std r14, -152(r1)
+__savegprlr_15:
+  std r15, -144(r1)
+__savegprlr_16:
+  std r16, -136(r1)
+__savegprlr_17:
+  std r17, -128(r1)
+__savegprlr_18:
+  std r18, -120(r1)
+__savegprlr_19:
+  std r19, -112(r1)
+__savegprlr_20:
+  std r20, -104(r1)
+__savegprlr_21:
+  std r21, -96(r1)
+__savegprlr_22:
+  std r22, -88(r1)
+__savegprlr_23:
+  std r23, -80(r1)
+__savegprlr_24:
+  std r24, -72(r1)
+__savegprlr_25:
+  std r25, -64(r1)
+__savegprlr_26:
+  std r26, -56(r1)
+__savegprlr_27:
+  std r27, -48(r1)
+__savegprlr_28:
+  std r28, -40(r1)
+__savegprlr_29:
+  std r29, -32(r1)
+__savegprlr_30:
+  std r30, -24(r1)
+__savegprlr_31:
+  std r31, -16(r1)
+  stw r12, -8(r1)
+  blr
+__restgprlr_14:
+  ld r14, -152(r1)
+__restgprlr_15:
+  ld r15, -144(r1)
+__restgprlr_16:
+  ld r16, -136(r1)
+__restgprlr_17:
+  ld r17, -128(r1)
+__restgprlr_18:
+  ld r18, -120(r1)
+__restgprlr_19:
+  ld r19, -112(r1)
+__restgprlr_20:
+  ld r20, -104(r1)
+__restgprlr_21:
+  ld r21, -96(r1)
+__restgprlr_22:
+  ld r22, -88(r1)
+__restgprlr_23:
+  ld r23, -80(r1)
+__restgprlr_24:
+  ld r24, -72(r1)
+__restgprlr_25:
+  ld r25, -64(r1)
+__restgprlr_26:
+  ld r26, -56(r1)
+__restgprlr_27:
+  ld r27, -48(r1)
+__restgprlr_28:
+  ld r28, -40(r1)
+__restgprlr_29:
+  ld r29, -32(r1)
+__restgprlr_30:
+  ld r30, -24(r1)
+__restgprlr_31:
+  ld r31, -16(r1)
+  lwz r12, -8(r1)
+  mtlr r12
+  blr
+
+__savefpr_14:
+  stfd f14, -144(r12)
+__savefpr_15:
+  stfd f15, -136(r12)
+__savefpr_16:
+  stfd f16, -128(r12)
+__savefpr_17:
+  stfd f17, -120(r12)
+__savefpr_18:
+  stfd f18, -112(r12)
+__savefpr_19:
+  stfd f19, -104(r12)
+__savefpr_20:
+  stfd f20, -96(r12)
+__savefpr_21:
+  stfd f21, -88(r12)
+__savefpr_22:
+  stfd f22, -80(r12)
+__savefpr_23:
+  stfd f23, -72(r12)
+__savefpr_24:
+  stfd f24, -64(r12)
+__savefpr_25:
+  stfd f25, -56(r12)
+__savefpr_26:
+  stfd f26, -48(r12)
+__savefpr_27:
+  stfd f27, -40(r12)
+__savefpr_28:
+  stfd f28, -32(r12)
+__savefpr_29:
+  stfd f29, -24(r12)
+__savefpr_30:
+  stfd f30, -16(r12)
+__savefpr_31:
+  stfd f31, -8(r12)
+  blr
+__restfpr_14:
+  lfd f14, -144(r12)
+__restfpr_15:
+  lfd f15, -136(r12)
+__restfpr_16:
+  lfd f16, -128(r12)
+__restfpr_17:
+  lfd f17, -120(r12)
+__restfpr_18:
+  lfd f18, -112(r12)
+__restfpr_19:
+  lfd f19, -104(r12)
+__restfpr_20:
+  lfd f20, -96(r12)
+__restfpr_21:
+  lfd f21, -88(r12)
+__restfpr_22:
+  lfd f22, -80(r12)
+__restfpr_23:
+  lfd f23, -72(r12)
+__restfpr_24:
+  lfd f24, -64(r12)
+__restfpr_25:
+  lfd f25, -56(r12)
+__restfpr_26:
+  lfd f26, -48(r12)
+__restfpr_27:
+  lfd f27, -40(r12)
+__restfpr_28:
+  lfd f28, -32(r12)
+__restfpr_29:
+  lfd f29, -24(r12)
+__restfpr_30:
+  lfd f30, -16(r12)
+__restfpr_31:
+  lfd f31, -8(r12)
+  blr
+
+# Registers above v31 are only encodable by number.
+__savevmx_14:
+  li r11, -288
+  stvx v14, r11, r12
+__savevmx_15:
+  li r11, -272
+  stvx v15, r11, r12
+__savevmx_16:
+  li r11, -256
+  stvx v16, r11, r12
+__savevmx_17:
+  li r11, -240
+  stvx v17, r11, r12
+__savevmx_18:
+  li r11, -224
+  stvx v18, r11, r12
+__savevmx_19:
+  li r11, -208
+  stvx v19, r11, r12
+__savevmx_20:
+  li r11, -192
+  stvx v20, r11, r12
+__savevmx_21:
+  li r11, -176
+  stvx v21, r11, r12
+__savevmx_22:
+  li r11, -160
+  stvx v22, r11, r12
+__savevmx_23:
+  li r11, -144
+  stvx v23, r11, r12
+__savevmx_24:
+  li r11, -128
+  stvx v24, r11, r12
+__savevmx_25:
+  li r11, -112
+  stvx v25, r11, r12
+__savevmx_26:
+  li r11, -96
+  stvx v26, r11, r12
+__savevmx_27:
+  li r11, -80
+  stvx v27, r11, r12
+__savevmx_28:
+  li r11, -64
+  stvx v28, r11, r12
+__savevmx_29:
+  li r11, -48
+  stvx v29, r11, r12
+__savevmx_30:
+  li r11, -32
+  stvx v30, r11, r12
+__savevmx_31:
+  li r11, -16
+  stvx v31, r11, r12
+  blr
+__savevmx_64:
+  li r11, -1024
+  stvx128 64, r11, r12
+__savevmx_65:
+  li r11, -1008
+  stvx128 65, r11, r12
+__savevmx_66:
+  li r11, -992
+  stvx128 66, r11, r12
+__savevmx_67:
+  li r11, -976
+  stvx128 67, r11, r12
+__savevmx_68:
+  li r11, -960
+  stvx128 68, r11, r12
+__savevmx_69:
+  li r11, -944
+  stvx128 69, r11, r12
+__savevmx_70:
+  li r11, -928
+  stvx128 70, r11, r12
+__savevmx_71:
+  li r11, -912
+  stvx128 71, r11, r12
+__savevmx_72:
+  li r11, -896
+  stvx128 72, r11, r12
+__savevmx_73:
+  li r11, -880
+  stvx128 73, r11, r12
+__savevmx_74:
+  li r11, -864
+  stvx128 74, r11, r12
+__savevmx_75:
+  li r11, -848
+  stvx128 75, r11, r12
+__savevmx_76:
+  li r11, -832
+  stvx128 76, r11, r12
+__savevmx_77:
+  li r11, -816
+  stvx128 77, r11, r12
+__savevmx_78:
+  li r11, -800
+  stvx128 78, r11, r12
+__savevmx_79:
+  li r11, -784
+  stvx128 79, r11, r12
+__savevmx_80:
+  li r11, -768
+  stvx128 80, r11, r12
+__savevmx_81:
+  li r11, -752
+  stvx128 81, r11, r12
+__savevmx_82:
+  li r11, -736
+  stvx128 82, r11, r12
+__savevmx_83:
+  li r11, -720
+  stvx128 83, r11, r12
+__savevmx_84:
+  li r11, -704
+  stvx128 84, r11, r12
+__savevmx_85:
+  li r11, -688
+  stvx128 85, r11, r12
+__savevmx_86:
+  li r11, -672
+  stvx128 86, r11, r12
+__savevmx_87:
+  li r11, -656
+  stvx128 87, r11, r12
+__savevmx_88:
+  li r11, -640
+  stvx128 88, r11, r12
+__savevmx_89:
+  li r11, -624
+  stvx128 89, r11, r12
+__savevmx_90:
+  li r11, -608
+  stvx128 90, r11, r12
+__savevmx_91:
+  li r11, -592
+  stvx128 91, r11, r12
+__savevmx_92:
+  li r11, -576
+  stvx128 92, r11, r12
+__savevmx_93:
+  li r11, -560
+  stvx128 93, r11, r12
+__savevmx_94:
+  li r11, -544
+  stvx128 94, r11, r12
+__savevmx_95:
+  li r11, -528
+  stvx128 95, r11, r12
+__savevmx_96:
+  li r11, -512
+  stvx128 96, r11, r12
+__savevmx_97:
+  li r11, -496
+  stvx128 97, r11, r12
+__savevmx_98:
+  li r11, -480
+  stvx128 98, r11, r12
+__savevmx_99:
+  li r11, -464
+  stvx128 99, r11, r12
+__savevmx_100:
+  li r11, -448
+  stvx128 100, r11, r12
+__savevmx_101:
+  li r11, -432
+  stvx128 101, r11, r12
+__savevmx_102:
+  li r11, -416
+  stvx128 102, r11, r12
+__savevmx_103:
+  li r11, -400
+  stvx128 103, r11, r12
+__savevmx_104:
+  li r11, -384
+  stvx128 104, r11, r12
+__savevmx_105:
+  li r11, -368
+  stvx128 105, r11, r12
+__savevmx_106:
+  li r11, -352
+  stvx128 106, r11, r12
+__savevmx_107:
+  li r11, -336
+  stvx128 107, r11, r12
+__savevmx_108:
+  li r11, -320
+  stvx128 108, r11, r12
+__savevmx_109:
+  li r11, -304
+  stvx128 109, r11, r12
+__savevmx_110:
+  li r11, -288
+  stvx128 110, r11, r12
+__savevmx_111:
+  li r11, -272
+  stvx128 111, r11, r12
+__savevmx_112:
+  li r11, -256
+  stvx128 112, r11, r12
+__savevmx_113:
+  li r11, -240
+  stvx128 113, r11, r12
+__savevmx_114:
+  li r11, -224
+  stvx128 114, r11, r12
+__savevmx_115:
+  li r11, -208
+  stvx128 115, r11, r12
+__savevmx_116:
+  li r11, -192
+  stvx128 116, r11, r12
+__savevmx_117:
+  li r11, -176
+  stvx128 117, r11, r12
+__savevmx_118:
+  li r11, -160
+  stvx128 118, r11, r12
+__savevmx_119:
+  li r11, -144
+  stvx128 119, r11, r12
+__savevmx_120:
+  li r11, -128
+  stvx128 120, r11, r12
+__savevmx_121:
+  li r11, -112
+  stvx128 121, r11, r12
+__savevmx_122:
+  li r11, -96
+  stvx128 122, r11, r12
+__savevmx_123:
+  li r11, -80
+  stvx128 123, r11, r12
+__savevmx_124:
+  li r11, -64
+  stvx128 124, r11, r12
+__savevmx_125:
+  li r11, -48
+  stvx128 125, r11, r12
+__savevmx_126:
+  li r11, -32
+  stvx128 126, r11, r12
+__savevmx_127:
+  li r11, -16
+  stvx128 127, r11, r12
+  blr
+__restvmx_14:
+  li r11, -288
+  lvx v14, r11, r12
+__restvmx_15:
+  li r11, -272
+  lvx v15, r11, r12
+__restvmx_16:
+  li r11, -256
+  lvx v16, r11, r12
+__restvmx_17:
+  li r11, -240
+  lvx v17, r11, r12
+__restvmx_18:
+  li r11, -224
+  lvx v18, r11, r12
+__restvmx_19:
+  li r11, -208
+  lvx v19, r11, r12
+__restvmx_20:
+  li r11, -192
+  lvx v20, r11, r12
+__restvmx_21:
+  li r11, -176
+  lvx v21, r11, r12
+__restvmx_22:
+  li r11, -160
+  lvx v22, r11, r12
+__restvmx_23:
+  li r11, -144
+  lvx v23, r11, r12
+__restvmx_24:
+  li r11, -128
+  lvx v24, r11, r12
+__restvmx_25:
+  li r11, -112
+  lvx v25, r11, r12
+__restvmx_26:
+  li r11, -96
+  lvx v26, r11, r12
+__restvmx_27:
+  li r11, -80
+  lvx v27, r11, r12
+__restvmx_28:
+  li r11, -64
+  lvx v28, r11, r12
+__restvmx_29:
+  li r11, -48
+  lvx v29, r11, r12
+__restvmx_30:
+  li r11, -32
+  lvx v30, r11, r12
+__restvmx_31:
+  li r11, -16
+  lvx v31, r11, r12
+  blr
+__restvmx_64:
+  li r11, -1024
+  lvx128 64, r11, r12
+__restvmx_65:
+  li r11, -1008
+  lvx128 65, r11, r12
+__restvmx_66:
+  li r11, -992
+  lvx128 66, r11, r12
+__restvmx_67:
+  li r11, -976
+  lvx128 67, r11, r12
+__restvmx_68:
+  li r11, -960
+  lvx128 68, r11, r12
+__restvmx_69:
+  li r11, -944
+  lvx128 69, r11, r12
+__restvmx_70:
+  li r11, -928
+  lvx128 70, r11, r12
+__restvmx_71:
+  li r11, -912
+  lvx128 71, r11, r12
+__restvmx_72:
+  li r11, -896
+  lvx128 72, r11, r12
+__restvmx_73:
+  li r11, -880
+  lvx128 73, r11, r12
+__restvmx_74:
+  li r11, -864
+  lvx128 74, r11, r12
+__restvmx_75:
+  li r11, -848
+  lvx128 75, r11, r12
+__restvmx_76:
+  li r11, -832
+  lvx128 76, r11, r12
+__restvmx_77:
+  li r11, -816
+  lvx128 77, r11, r12
+__restvmx_78:
+  li r11, -800
+  lvx128 78, r11, r12
+__restvmx_79:
+  li r11, -784
+  lvx128 79, r11, r12
+__restvmx_80:
+  li r11, -768
+  lvx128 80, r11, r12
+__restvmx_81:
+  li r11, -752
+  lvx128 81, r11, r12
+__restvmx_82:
+  li r11, -736
+  lvx128 82, r11, r12
+__restvmx_83:
+  li r11, -720
+  lvx128 83, r11, r12
+__restvmx_84:
+  li r11, -704
+  lvx128 84, r11, r12
+__restvmx_85:
+  li r11, -688
+  lvx128 85, r11, r12
+__restvmx_86:
+  li r11, -672
+  lvx128 86, r11, r12
+__restvmx_87:
+  li r11, -656
+  lvx128 87, r11, r12
+__restvmx_88:
+  li r11, -640
+  lvx128 88, r11, r12
+__restvmx_89:
+  li r11, -624
+  lvx128 89, r11, r12
+__restvmx_90:
+  li r11, -608
+  lvx128 90, r11, r12
+__restvmx_91:
+  li r11, -592
+  lvx128 91, r11, r12
+__restvmx_92:
+  li r11, -576
+  lvx128 92, r11, r12
+__restvmx_93:
+  li r11, -560
+  lvx128 93, r11, r12
+__restvmx_94:
+  li r11, -544
+  lvx128 94, r11, r12
+__restvmx_95:
+  li r11, -528
+  lvx128 95, r11, r12
+__restvmx_96:
+  li r11, -512
+  lvx128 96, r11, r12
+__restvmx_97:
+  li r11, -496
+  lvx128 97, r11, r12
+__restvmx_98:
+  li r11, -480
+  lvx128 98, r11, r12
+__restvmx_99:
+  li r11, -464
+  lvx128 99, r11, r12
+__restvmx_100:
+  li r11, -448
+  lvx128 100, r11, r12
+__restvmx_101:
+  li r11, -432
+  lvx128 101, r11, r12
+__restvmx_102:
+  li r11, -416
+  lvx128 102, r11, r12
+__restvmx_103:
+  li r11, -400
+  lvx128 103, r11, r12
+__restvmx_104:
+  li r11, -384
+  lvx128 104, r11, r12
+__restvmx_105:
+  li r11, -368
+  lvx128 105, r11, r12
+__restvmx_106:
+  li r11, -352
+  lvx128 106, r11, r12
+__restvmx_107:
+  li r11, -336
+  lvx128 107, r11, r12
+__restvmx_108:
+  li r11, -320
+  lvx128 108, r11, r12
+__restvmx_109:
+  li r11, -304
+  lvx128 109, r11, r12
+__restvmx_110:
+  li r11, -288
+  lvx128 110, r11, r12
+__restvmx_111:
+  li r11, -272
+  lvx128 111, r11, r12
+__restvmx_112:
+  li r11, -256
+  lvx128 112, r11, r12
+__restvmx_113:
+  li r11, -240
+  lvx128 113, r11, r12
+__restvmx_114:
+  li r11, -224
+  lvx128 114, r11, r12
+__restvmx_115:
+  li r11, -208
+  lvx128 115, r11, r12
+__restvmx_116:
+  li r11, -192
+  lvx128 116, r11, r12
+__restvmx_117:
+  li r11, -176
+  lvx128 117, r11, r12
+__restvmx_118:
+  li r11, -160
+  lvx128 118, r11, r12
+__restvmx_119:
+  li r11, -144
+  lvx128 119, r11, r12
+__restvmx_120:
+  li r11, -128
+  lvx128 120, r11, r12
+__restvmx_121:
+  li r11, -112
+  lvx128 121, r11, r12
+__restvmx_122:
+  li r11, -96
+  lvx128 122, r11, r12
+__restvmx_123:
+  li r11, -80
+  lvx128 123, r11, r12
+__restvmx_124:
+  li r11, -64
+  lvx128 124, r11, r12
+__restvmx_125:
+  li r11, -48
+  lvx128 125, r11, r12
+__restvmx_126:
+  li r11, -32
+  lvx128 126, r11, r12
+__restvmx_127:
+  li r11, -16
+  lvx128 127, r11, r12
+  blr
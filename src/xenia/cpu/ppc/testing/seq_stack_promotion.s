@@ -0,0 +1,107 @@
+# Functions keeping values in their stack frame, which are kept in host locals
+# instead with --promote_stack_slots. What callees see of the frame at each
+# call, and the values loaded back, must be the same either way.
+
+test_stack_promotion_leaf:
+  #_ REGISTER_IN r3 0x1122334455667788
+  #_ REGISTER_IN r4 0x99AABBCC
+  stwu r1, -0x40(r1)
+  std r3, 0x20(r1)
+  stw r4, 0x28(r1)
+  cmplwi r4, 0
+  beq stack_promotion_leaf_join
+  stw r3, 0x28(r1)
+stack_promotion_leaf_join:
+  li r3, 0
+  li r4, 0
+  ld r5, 0x20(r1)
+  lwz r6, 0x28(r1)
+  # Overlaps the doubleword, so neither is promoted.
+  lhz r7, 0x20(r1)
+  addi r1, r1, 0x40
+  blr
+  #_ REGISTER_OUT r3 0
+  #_ REGISTER_OUT r4 0
+  #_ REGISTER_OUT r5 0x1122334455667788
+  #_ REGISTER_OUT r6 0x55667788
+  #_ REGISTER_OUT r7 0x1122
+
+test_stack_promotion_loop:
+  #_ REGISTER_IN r3 5
+  stwu r1, -0x20(r1)
+  li r4, 0
+  stw r4, 0x10(r1)
+stack_promotion_loop_top:
+  lwz r4, 0x10(r1)
+  add r4, r4, r3
+  stw r4, 0x10(r1)
+  addic. r3, r3, -1
+  bne stack_promotion_loop_top
+  lwz r5, 0x10(r1)
+  addi r1, r1, 0x20
+  blr
+  #_ REGISTER_OUT r3 0
+  #_ REGISTER_OUT r4 15
+  #_ REGISTER_OUT r5 15
+
+test_stack_promotion_call:
+  #_ REGISTER_IN r3 0x11111111
+  #_ REGISTER_IN r4 0x22222222
+  #_ REGISTER_IN r30 0x10001000
+  mflr r12
+  stw r12, -8(r1)
+  stwu r1, -0x60(r1)
+  # Overwritten before the call.
+  stw r4, 0x54(r1)
+  stw r3, 0x50(r1)
+  stw r3, 0x54(r1)
+  bl stack_promotion_call_body
+  # Written by the callee.
+  lwz r5, 0x50(r1)
+  lwz r6, 0x54(r1)
+  stw r4, 0x48(r1)
+  lwz r7, 0x48(r1)
+  addi r1, r1, 0x60
+  lwz r12, -8(r1)
+  mtlr r12
+  blr
+  #_ REGISTER_OUT r5 0x33333333
+  #_ REGISTER_OUT r6 0x11111111
+  #_ REGISTER_OUT r7 0x22222222
+  #_ MEMORY_OUT 10001000 11111111 11111111
+
+stack_promotion_call_body:
+  # Copies out the bottom of the caller's frame, where parameters are passed,
+  # and writes to it.
+  lwz r8, 0x50(r1)
+  stw r8, 0(r30)
+  lwz r8, 0x54(r1)
+  stw r8, 4(r30)
+  lis r8, 0x3333
+  ori r8, r8, 0x3333
+  stw r8, 0x50(r1)
+  blr
+
+test_stack_promotion_escape:
+  #_ REGISTER_IN r3 0x44444444
+  mflr r12
+  stw r12, -8(r1)
+  stwu r1, -0x60(r1)
+  stw r3, 0x48(r1)
+  # The address of the local is passed to the callee.
+  addi r3, r1, 0x48
+  bl stack_promotion_escape_body
+  lwz r5, 0x48(r1)
+  addi r1, r1, 0x60
+  lwz r12, -8(r1)
+  mtlr r12
+  blr
+  #_ REGISTER_OUT r5 0x55555555
+  #_ REGISTER_OUT r6 0x44444444
+
+stack_promotion_escape_body:
+  lwz r6, 0(r3)
+  lis r7, 0x5555
+  ori r7, r7, 0x5555
+  stw r7, 0(r3)
+  blr
@@ -9,14 +9,16 @@
 
 #include "xenia/cpu/processor.h"
 
+#include <algorithm>
+
 #include "xenia/base/assert.h"
-#include "xenia/base/atomic.h"
 #include "xenia/base/byte_order.h"
 #include "xenia/base/byte_stream.h"
 #include "xenia/base/cvar.h"
 #include "xenia/base/debugging.h"
 #include "xenia/base/exception_handler.h"
 #include "xenia/base/logging.h"
+#include "xenia/base/math.h"
 #include "xenia/base/memory.h"
 #include "xenia/base/profiling.h"
 #include "xenia/base/threading.h"
@@ -167,6 +169,40 @@ bool Processor::AddModule(std::unique_ptr<Module> module) {
   return true;
 }
 
+std::unique_ptr<Module> Processor::RemoveModule(Module* module) {
+  std::unique_ptr<Module> removed_module;
+  {
+    auto global_lock = global_critical_region_.Acquire();
+    auto it = std::find_if(modules_.begin(), modules_.end(),
+                           [module](const std::unique_ptr<Module>& m) {
+                             return m.get() == module;
+                           });
+    if (it == modules_.end()) {
+      return nullptr;
+    }
+    removed_module = std::move(*it);
+    modules_.erase(it);
+    entry_table_.RemoveModule(module);
+  }
+
+  // Including functions retired by InvalidateCodeRange and not yet freed.
+  auto global_lock = global_critical_region_.Acquire();
+  retired_code_.erase(
+      std::remove_if(retired_code_.begin(), retired_code_.end(),
+                     [module](const RetiredCode& code) {
+                       return code.function->module() == module;
+                     }),
+      retired_code_.end());
+  has_retired_code_ = !retired_code_.empty();
+  module->ForEachFunction([this](Function* function) {
+    if (function->is_guest()) {
+      backend_->ReleaseFunction(static_cast<GuestFunction*>(function));
+      frontend_->ReleaseFunction(static_cast<GuestFunction*>(function));
+    }
+  });
+  return removed_module;
+}
+
 Module* Processor::GetModule(const char* name) {
   auto global_lock = global_critical_region_.Acquire();
   for (const auto& module : modules_) {
@@ -233,9 +269,8 @@ Function* Processor::ResolveFunction(uint32_t address) {
       entry->status = Entry::STATUS_FAILED;
       return nullptr;
     }
-    entry->function = function;
-    entry->end_address = function->end_address();
-    status = entry->status = Entry::STATUS_READY;
+    entry_table_.SetReady(entry, function);
+    status = Entry::STATUS_READY;
   }
   if (status == Entry::STATUS_READY) {
     // Ready to use.
@@ -246,6 +281,193 @@ Function* Processor::ResolveFunction(uint32_t address) {
   }
 }
 
+void Processor::InvalidateCodeRange(uint32_t low_address,
+                                    uint32_t high_address) {
+  // Held throughout so no thread resolves a function in the range between it
+  // leaving its module and the entry table.
+  auto global_lock = global_critical_region_.Acquire();
+  auto functions = entry_table_.RemoveInRange(low_address, high_address);
+  // Callers bound to an import thunk in the range go to what it called when
+  // they were compiled, so they must be compiled again along with it.
+  const uint32_t kImportThunkLength = 16;
+  uint32_t thunk_low = low_address > kImportThunkLength
+                           ? low_address - kImportThunkLength + 1
+                           : 0;
+  auto first_binding = bound_import_thunks_.lower_bound({thunk_low, 0});
+  auto end_binding = bound_import_thunks_.lower_bound({high_address, 0});
+  uint32_t thunk_address = 0;
+  for (auto it = first_binding; it != end_binding; ++it) {
+    if (it->first != thunk_address) {
+      // Bound callers may have left the thunk itself uncalled, and so not in
+      // the entry table.
+      thunk_address = it->first;
+      for (const auto& module : modules_) {
+        if (!module->ContainsAddress(thunk_address)) {
+          continue;
+        }
+        auto symbol = module->LookupSymbol(thunk_address, false);
+        if (symbol && symbol->type() == Symbol::Type::kFunction) {
+          module->RetireFunction(static_cast<Function*>(symbol));
+        }
+      }
+    }
+    auto callers = entry_table_.RemoveInRange(it->second, it->second + 4);
+    functions.insert(functions.end(), callers.begin(), callers.end());
+  }
+  bound_import_thunks_.erase(first_binding, end_binding);
+  if (functions.empty()) {
+    return;
+  }
+  ++retired_code_epoch_;
+  for (auto function : functions) {
+    function->module()->RetireFunction(function);
+    if (!function->is_guest()) {
+      continue;
+    }
+    auto guest_function = static_cast<GuestFunction*>(function);
+    backend_->RetireFunction(guest_function);
+    if (guest_function->machine_code()) {
+      RetiredCode code;
+      code.low = reinterpret_cast<uintptr_t>(guest_function->machine_code());
+      code.high = code.low + guest_function->machine_code_length();
+      code.epoch = retired_code_epoch_;
+      code.function = guest_function;
+      retired_code_.insert(
+          std::upper_bound(retired_code_.begin(), retired_code_.end(), code,
+                           [](const RetiredCode& a, const RetiredCode& b) {
+                             return a.low < b.low;
+                           }),
+          code);
+    }
+  }
+  has_retired_code_ = !retired_code_.empty();
+  ReclaimRetiredCode(true);
+}
+
+void Processor::AddThreadState(ThreadState* thread_state) {
+  auto global_lock = global_critical_region_.Acquire();
+  // Code retired before now can't be entered by the thread.
+  thread_state->retired_code_epoch_ = retired_code_epoch_;
+  thread_states_.push_back(thread_state);
+}
+
+void Processor::RemoveThreadState(ThreadState* thread_state) {
+  auto global_lock = global_critical_region_.Acquire();
+  thread_states_.erase(
+      std::find(thread_states_.begin(), thread_states_.end(), thread_state));
+  // Its frames may have been all that kept some code.
+  if (has_retired_code_) {
+    ReclaimRetiredCode(false);
+  }
+}
+
+void Processor::OnGuestFramesPaused(ThreadState* thread_state) {
+  if (!has_retired_code_) {
+    return;
+  }
+  auto global_lock = global_critical_region_.Acquire();
+  if (thread_state->retired_code_epoch_ < retired_code_epoch_) {
+    ReclaimRetiredCode(false);
+  }
+}
+
+void Processor::ReclaimRetiredCode(bool scan_paused) {
+  if (retired_code_.empty()) {
+    return;
+  }
+  auto current_thread_state = ThreadState::Get();
+  uint64_t clean_epoch = retired_code_epoch_;
+  for (auto thread_state : thread_states_) {
+    if (thread_state->retired_code_epoch_ < retired_code_epoch_) {
+      if (thread_state == current_thread_state) {
+        // Its frames are from here up, running or not.
+        uint8_t stack_marker;
+        thread_state->retired_code_epoch_ =
+            ScanGuestFrames(reinterpret_cast<uintptr_t>(&stack_marker),
+                            thread_state->guest_frames_.high);
+      } else if (scan_paused) {
+        // Kept paused until scanned; a running thread scans itself as it
+        // next pauses.
+        auto state = ThreadState::GuestFramesState::kPaused;
+        if (thread_state->guest_frames_state_.compare_exchange_strong(
+                state, ThreadState::GuestFramesState::kScanning,
+                std::memory_order_acquire)) {
+          thread_state->retired_code_epoch_ =
+              ScanGuestFrames(thread_state->guest_frames_.low,
+                              thread_state->guest_frames_.high);
+          thread_state->guest_frames_state_.store(
+              ThreadState::GuestFramesState::kPaused,
+              std::memory_order_release);
+        }
+      }
+    }
+    clean_epoch = std::min(clean_epoch, thread_state->retired_code_epoch_);
+  }
+
+  // No thread can enter retired code again, so code none have on their stack
+  // can go.
+  auto it = retired_code_.begin();
+  while (it != retired_code_.end()) {
+    if (it->epoch <= clean_epoch) {
+      backend_->ReleaseFunction(it->function);
+      it = retired_code_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+  has_retired_code_ = !retired_code_.empty();
+}
+
+uint64_t Processor::ScanGuestFrames(uintptr_t low, uintptr_t high) {
+  uint64_t clean_epoch = retired_code_epoch_;
+  if (retired_code_.empty()) {
+    return clean_epoch;
+  }
+  uintptr_t code_low = retired_code_.front().low;
+  uintptr_t code_high = 0;
+  for (const auto& code : retired_code_) {
+    code_high = std::max(code_high, code.high);
+  }
+  // Return addresses, or anything else that could be one.
+  low = xe::round_up(low, sizeof(uintptr_t));
+  for (uintptr_t slot = low; slot + sizeof(uintptr_t) <= high;
+       slot += sizeof(uintptr_t)) {
+    uintptr_t value = *reinterpret_cast<const uintptr_t*>(slot);
+    if (value < code_low || value > code_high) {
+      continue;
+    }
+    // The last code starting at or before the value.
+    auto it = std::upper_bound(
+        retired_code_.begin(), retired_code_.end(), value,
+        [](uintptr_t value, const RetiredCode& code) {
+          return value < code.low;
+        });
+    if (it != retired_code_.begin() && value <= (--it)->high) {
+      clean_epoch = std::min(clean_epoch, it->epoch - 1);
+    }
+  }
+  return clean_epoch;
+}
+
+void Processor::BindImportThunk(uint32_t thunk_address,
+                                uint32_t caller_address) {
+  auto global_lock = global_critical_region_.Acquire();
+  bound_import_thunks_.emplace(thunk_address, caller_address);
+}
+
+bool Processor::PromoteFunction(GuestFunction* function) {
+  if (!frontend_->CompileFunction(function, debug_info_flags_)) {
+    return false;
+  }
+  // Invalidated while it was being compiled, so callers must not be sent to
+  // what was compiled from the old code.
+  auto global_lock = global_critical_region_.Acquire();
+  if (QueryFunction(function->address()) != function) {
+    backend_->RetireFunction(function);
+  }
+  return true;
+}
+
 Function* Processor::LookupFunction(uint32_t address) {
   // TODO(benvanik): fast reject invalid addresses/log errors.
 
@@ -421,17 +643,6 @@ uint64_t Processor::ExecuteInterrupt(ThreadState* thread_state,
   return context->r[3];
 }
 
-Irql Processor::RaiseIrql(Irql new_value) {
-  return static_cast<Irql>(
-      xe::atomic_exchange(static_cast<uint32_t>(new_value),
-                          reinterpret_cast<volatile uint32_t*>(&irql_)));
-}
-
-void Processor::LowerIrql(Irql old_value) {
-  xe::atomic_exchange(static_cast<uint32_t>(old_value),
-                      reinterpret_cast<volatile uint32_t*>(&irql_));
-}
-
 bool Processor::Save(ByteStream* stream) {
   stream->Write('PROC');
   return true;
@@ -10,9 +10,12 @@
 #ifndef XENIA_CPU_PROCESSOR_H_
 #define XENIA_CPU_PROCESSOR_H_
 
+#include <atomic>
 #include <map>
 #include <memory>
+#include <set>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "xenia/base/cvar.h"
@@ -25,6 +28,7 @@
 #include "xenia/cpu/function.h"
 #include "xenia/cpu/module.h"
 #include "xenia/cpu/ppc/ppc_frontend.h"
+#include "xenia/cpu/reservation_table.h"
 #include "xenia/cpu/thread_debug_info.h"
 #include "xenia/cpu/thread_state.h"
 #include "xenia/memory.h"
@@ -69,6 +73,7 @@ class Processor {
   ppc::PPCFrontend* frontend() const { return frontend_.get(); }
   backend::Backend* backend() const { return backend_.get(); }
   ExportResolver* export_resolver() const { return export_resolver_; }
+  ReservationTable* reservation_table() { return &reservation_table_; }
 
   bool Setup(std::unique_ptr<backend::Backend> backend);
 
@@ -99,6 +104,10 @@ class Processor {
   }
 
   bool AddModule(std::unique_ptr<Module> module);
+  // Takes the module out of function lookup and frees the code generated for
+  // it. Its code must no longer be running. The module is handed back, as
+  // its owner may still refer to it.
+  std::unique_ptr<Module> RemoveModule(Module* module);
   Module* GetModule(const char* name);
   Module* GetModule(const std::string& name) { return GetModule(name.c_str()); }
   std::vector<Module*> GetModules();
@@ -115,6 +124,20 @@ class Processor {
   Function* LookupFunction(Module* module, uint32_t address);
   Function* ResolveFunction(uint32_t address);
 
+  // Drops the functions compiled from guest code in [low_address,
+  // high_address), so they are compiled again from what is there now when
+  // next called. Their code may still be running, so it's only freed once no
+  // thread has it on its stack.
+  void InvalidateCodeRange(uint32_t low_address, uint32_t high_address);
+  // Notes that calls to the import thunk at thunk_address were bound to what
+  // it calls in the function at caller_address, so that invalidating the
+  // thunk also drops the caller.
+  void BindImportThunk(uint32_t thunk_address, uint32_t caller_address);
+
+  // Compiles a function that has been interpreted so far, called by the
+  // interpreter once it is worth it.
+  bool PromoteFunction(GuestFunction* function);
+
   bool Execute(ThreadState* thread_state, uint32_t address);
   bool ExecuteRaw(ThreadState* thread_state, uint32_t address);
   uint64_t Execute(ThreadState* thread_state, uint32_t address, uint64_t args[],
@@ -122,9 +145,6 @@ class Processor {
   uint64_t ExecuteInterrupt(ThreadState* thread_state, uint32_t address,
                             uint64_t args[], size_t arg_count);
 
-  Irql RaiseIrql(Irql new_value);
-  void LowerIrql(Irql old_value);
-
   bool Save(ByteStream* stream);
   bool Restore(ByteStream* stream);
 
@@ -187,6 +207,12 @@ class Processor {
 
  public:
   // TODO(benvanik): hide.
+  // Called by thread states as they are created and destroyed, and as they
+  // pause their guest frames.
+  void AddThreadState(ThreadState* thread_state);
+  void RemoveThreadState(ThreadState* thread_state);
+  void OnGuestFramesPaused(ThreadState* thread_state);
+
   void OnThreadCreated(uint32_t handle, ThreadState* thread_state,
                        Thread* thread);
   void OnThreadExit(uint32_t thread_id);
@@ -236,6 +262,15 @@ class Processor {
 
   bool DemandFunction(Function* function);
 
+  // Frees the code of retired functions that no thread can be running
+  // anymore. The frames of the calling thread are scanned for it, and if
+  // scan_paused, those of other threads that are paused. Must be called with
+  // the global lock held.
+  void ReclaimRetiredCode(bool scan_paused);
+  // Returns the epoch before that of the oldest retired code with a pointer
+  // into it in [low, high), or the current epoch if there's none.
+  uint64_t ScanGuestFrames(uintptr_t low, uintptr_t high);
+
   Memory* memory_ = nullptr;
   std::unique_ptr<StackWalker> stack_walker_;
 
@@ -253,6 +288,7 @@ class Processor {
   ExportResolver* export_resolver_ = nullptr;
 
   EntryTable entry_table_;
+  ReservationTable reservation_table_;
   xe::global_critical_region global_critical_region_;
   ExecutionState execution_state_ = ExecutionState::kPaused;
   std::vector<std::unique_ptr<Module>> modules_;
@@ -263,10 +299,28 @@ class Processor {
   // removed. Must be guarded with the global lock.
   std::map<uint32_t, std::unique_ptr<ThreadDebugInfo>> thread_debug_infos_;
 
+  // Import thunk addresses and the callers bound to them, by thunk address.
+  // Must be guarded with the global lock.
+  std::set<std::pair<uint32_t, uint32_t>> bound_import_thunks_;
+
+  // Machine code of a function retired by InvalidateCodeRange.
+  struct RetiredCode {
+    uintptr_t low;
+    uintptr_t high;
+    // Of the InvalidateCodeRange that retired it.
+    uint64_t epoch;
+    GuestFunction* function;
+  };
+  // Retired code not yet freed, sorted by address, and the thread states
+  // whose frames may hold it. Must be guarded with the global lock.
+  std::vector<RetiredCode> retired_code_;
+  uint64_t retired_code_epoch_ = 0;
+  std::vector<ThreadState*> thread_states_;
+  // Whether retired_code_ has anything, checked without the lock.
+  std::atomic<bool> has_retired_code_ = {false};
+
   // TODO(benvanik): cleanup/change structures.
   std::vector<Breakpoint*> breakpoints_;
-
-  Irql irql_;
 };
 
 }  // namespace cpu
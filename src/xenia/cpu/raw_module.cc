@@ -59,6 +59,10 @@ bool RawModule::LoadFile(uint32_t base_address, const std::wstring& path) {
   low_address_ = base_address;
   high_address_ = base_address + file_length;
 
+  SaveRestoreHelpers save_restore_helpers;
+  FindSaveRestoreHelpers(low_address_, high_address_, save_restore_helpers);
+  DeclareSaveRestoreHelpers(save_restore_helpers);
+
   // Notify backend about executable code.
   processor_->backend()->CommitExecutableRange(low_address_, high_address_);
   return true;
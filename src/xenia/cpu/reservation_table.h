@@ -0,0 +1,98 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2020 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#ifndef XENIA_CPU_RESERVATION_TABLE_H_
+#define XENIA_CPU_RESERVATION_TABLE_H_
+
+#include <atomic>
+#include <cstdint>
+
+#include "xenia/base/atomic.h"
+#include "xenia/base/platform.h"
+#include "xenia/base/threading.h"
+
+namespace xe {
+namespace cpu {
+
+// Backs lwarx/ldarx and stwcx./stdcx. across all guest threads.
+// Each entry holds a version shared by the 128-byte reservation granules that
+// hash to it. A reservation remembers the version, and a conditional store
+// only goes through if no other conditional store has been performed to the
+// granule since (so values changed and changed back are still noticed) and
+// memory still holds the reserved value (which catches most plain stores).
+// The low bit of a version is set while a conditional store is in progress.
+// Failing when another granule with the same hash was stored to is allowed,
+// as real hardware may lose reservations spuriously too.
+class ReservationTable {
+ public:
+  static const uint32_t kGranuleShift = 7;
+  static const uint32_t kEntryCount = 4096;
+
+  ReservationTable() {
+    for (auto& entry : entries_) {
+      entry.version.store(0, std::memory_order_relaxed);
+    }
+  }
+
+  // Returns the version to pass to StoreConditional for a reservation on
+  // guest_address. Must be called before loading the reserved value.
+  uint64_t Reserve(uint32_t guest_address) {
+    auto& version = entries_[EntryIndex(guest_address)].version;
+    uint64_t value = version.load(std::memory_order_acquire);
+    uint32_t spins = 0;
+    while (value & 1) {
+      // Another thread is between its compare-exchanges; that's very short
+      // unless it got preempted.
+      if (++spins < 64) {
+        _mm_pause();
+      } else {
+        xe::threading::MaybeYield();
+      }
+      value = version.load(std::memory_order_acquire);
+    }
+    return value;
+  }
+
+  // Stores value to host_address if the reservation taken with version is
+  // still held and the memory still holds expected_value. Values are in
+  // guest byte order. Returns whether the store was performed.
+  template <typename T>
+  bool StoreConditional(uint32_t guest_address, uint64_t version,
+                        T* host_address, T expected_value, T value) {
+    auto& entry_version = entries_[EntryIndex(guest_address)].version;
+    if (version & 1 ||
+        !entry_version.compare_exchange_strong(version, version + 1,
+                                               std::memory_order_acquire)) {
+      return false;
+    }
+    bool stored = xe::atomic_cas(expected_value, value,
+                                 reinterpret_cast<volatile T*>(host_address));
+    // Only a performed store takes the reservations of other threads.
+    entry_version.store(stored ? version + 2 : version,
+                        std::memory_order_release);
+    return stored;
+  }
+
+  static uint32_t EntryIndex(uint32_t guest_address) {
+    return (guest_address >> kGranuleShift) & (kEntryCount - 1);
+  }
+
+ private:
+  // Padded so threads working on different granules don't share lines.
+  struct Entry {
+    std::atomic<uint64_t> version;
+    uint8_t padding[56];
+  };
+  Entry entries_[kEntryCount];
+};
+
+}  // namespace cpu
+}  // namespace xe
+
+#endif  // XENIA_CPU_RESERVATION_TABLE_H_
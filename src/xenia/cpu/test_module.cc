@@ -10,10 +10,12 @@
 #include "xenia/cpu/test_module.h"
 
 #include "xenia/base/assert.h"
+#include "xenia/base/clock.h"
 #include "xenia/base/platform.h"
 #include "xenia/base/reset_scope.h"
 #include "xenia/base/string.h"
 #include "xenia/cpu/compiler/compiler_passes.h"
+#include "xenia/cpu/cpu_flags.h"
 #include "xenia/cpu/processor.h"
 
 namespace xe {
@@ -36,6 +38,15 @@ TestModule::TestModule(Processor* processor, const std::string& name,
   assembler_ = processor->backend()->CreateAssembler();
   assembler_->Initialize();
 
+  if (cvars::clock_virtual) {
+    compiler_->AddPass(std::make_unique<passes::VirtualClockPass>());
+  }
+#if !XE_PLATFORM_WIN32
+  if (cvars::safepoints) {
+    compiler_->AddPass(std::make_unique<passes::SafepointPass>());
+  }
+#endif  // !XE_PLATFORM_WIN32
+
   // Merge blocks early. This will let us use more context in other passes.
   // The CFG is required for simplification and dirtied by it.
   compiler_->AddPass(std::make_unique<passes::ControlFlowAnalysisPass>());
@@ -0,0 +1,203 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2020 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include <algorithm>
+#include <future>
+#include <memory>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "xenia/base/mutex.h"
+#include "xenia/cpu/backend/x64/x64_code_cache.h"
+#include "xenia/cpu/testing/util.h"
+
+using namespace xe;
+using namespace xe::cpu;
+using namespace xe::cpu::hir;
+using namespace xe::cpu::testing;
+
+namespace {
+
+const uint32_t kModuleLow = 0x80000000;
+const uint32_t kModuleHigh = 0x80000100;
+const uint32_t kFunctionCount = 16;
+const size_t kMaxCodeSize = 2048;
+
+class CodeCacheTest {
+ public:
+  CodeCacheTest() : test_(kModuleLow, kModuleHigh) {}
+
+  Processor* processor() const { return test_.processor(); }
+  backend::x64::X64CodeCache* code_cache() const {
+    return static_cast<backend::x64::X64Backend*>(processor()->backend())
+        ->code_cache();
+  }
+
+  // Every function in the module sets r3 to what *value is when it's compiled.
+  Module* AddModule(const uint32_t* value) {
+    return test_.AddModule("CodeCacheTest", kModuleLow, kModuleHigh,
+                           [value](HIRBuilder& b) {
+                             StoreGPR(b, 3, b.LoadConstantUint64(*value));
+                             b.Return();
+                           });
+  }
+
+  uint64_t Call(Function* fn) { return test_.Call(fn)->r[3]; }
+
+ private:
+  TestProcessor test_;
+};
+
+}  // namespace
+
+TEST_CASE("CODE_CACHE_MODULE_RELOAD", "[code_cache]") {
+  CodeCacheTest test;
+  auto code_cache = test.code_cache();
+  size_t base_size = code_cache->used_size();
+  size_t first_high_water_mark = 0;
+  for (uint32_t round = 1; round <= 64; ++round) {
+    auto module = test.AddModule(&round);
+    for (uint32_t n = 0; n < kFunctionCount; ++n) {
+      auto fn = test.processor()->ResolveFunction(kModuleLow + n * 4);
+      REQUIRE(fn);
+      REQUIRE(test.Call(fn) == round);
+    }
+    REQUIRE(code_cache->used_size() > base_size);
+    REQUIRE(test.processor()->RemoveModule(module));
+    REQUIRE_FALSE(test.processor()->QueryFunction(kModuleLow));
+
+    // Each load reuses the space freed by the last.
+    REQUIRE(code_cache->used_size() == base_size);
+    if (round == 1) {
+      first_high_water_mark = code_cache->high_water_mark();
+    }
+    REQUIRE(code_cache->high_water_mark() == first_high_water_mark);
+  }
+}
+
+TEST_CASE("CODE_CACHE_INVALIDATE_RANGE", "[code_cache]") {
+  CodeCacheTest test;
+  auto code_cache = test.code_cache();
+  size_t base_size = code_cache->used_size();
+  uint32_t version = 1;
+  auto module = test.AddModule(&version);
+  auto fn = test.processor()->ResolveFunction(kModuleLow);
+  auto other_fn = test.processor()->ResolveFunction(kModuleLow + 0x80);
+  REQUIRE(test.Call(fn) == 1);
+  REQUIRE(test.Call(other_fn) == 1);
+  size_t module_size = code_cache->used_size();
+
+  // As icbi of the block holding the first function.
+  version = 2;
+  test.processor()->InvalidateCodeRange(kModuleLow, kModuleLow + 0x80);
+  // Nothing is running it, so it's freed right away.
+  REQUIRE(code_cache->used_size() < module_size);
+  auto new_fn = test.processor()->ResolveFunction(kModuleLow);
+  REQUIRE(new_fn != fn);
+  REQUIRE(test.Call(new_fn) == 2);
+  // Callers still holding the old function get the new one.
+  REQUIRE(test.Call(fn) == 2);
+  // Functions outside the range are left alone.
+  REQUIRE(test.processor()->ResolveFunction(kModuleLow + 0x80) == other_fn);
+  REQUIRE(test.Call(other_fn) == 1);
+  REQUIRE(code_cache->used_size() == module_size);
+
+  // Code rewritten over and over doesn't pile up.
+  for (version = 3; version < 64; ++version) {
+    test.processor()->InvalidateCodeRange(kModuleLow, kModuleLow + 0x80);
+    REQUIRE(test.Call(test.processor()->ResolveFunction(kModuleLow)) ==
+            version);
+    REQUIRE(code_cache->used_size() == module_size);
+  }
+
+  REQUIRE(test.processor()->RemoveModule(module));
+  REQUIRE(code_cache->used_size() == base_size);
+}
+
+TEST_CASE("CODE_CACHE_MIXED_SIZE_RELOAD", "[code_cache]") {
+  // Code placed directly, as modules of functions of any size load and unload
+  // while others stay. The cache only hands the functions back from lookups.
+  auto code_cache = backend::x64::X64CodeCache::Create();
+  REQUIRE(code_cache->Initialize());
+  size_t base_size = code_cache->used_size();
+  std::vector<uint8_t> machine_code(kMaxCodeSize, 0xCC);
+  std::minstd_rand random(1);
+  uintptr_t function_count = 0;
+  struct PlacedFunction {
+    uint8_t* code;
+    size_t size;
+    GuestFunction* function;
+  };
+  auto place = [&]() {
+    backend::x64::EmitFunctionInfo func_info = {};
+    func_info.code_size.total = 16 + random() % (kMaxCodeSize - 16);
+    func_info.code_size.prolog = 7;
+    func_info.prolog_stack_alloc_offset = 7;
+    func_info.stack_size = 0x40;
+    auto function = reinterpret_cast<GuestFunction*>(++function_count * 16);
+    auto code = static_cast<uint8_t*>(code_cache->PlaceGuestCode(
+        kModuleLow, machine_code.data(), func_info, function));
+    return PlacedFunction{code, func_info.code_size.total, function};
+  };
+  auto is_found = [&](const PlacedFunction& placed) {
+    return code_cache->LookupFunction(uint64_t(placed.code)) ==
+               placed.function &&
+           code_cache->LookupFunction(
+               uint64_t(placed.code + placed.size - 1)) == placed.function;
+  };
+
+  // Half of the functions stay loaded throughout, between the others.
+  std::vector<PlacedFunction> resident, module;
+  for (int n = 0; n < 1000; ++n) {
+    (n % 2 ? module : resident).push_back(place());
+  }
+  size_t first_high_water_mark = code_cache->high_water_mark();
+  for (int round = 0; round < 64; ++round) {
+    std::shuffle(module.begin(), module.end(), random);
+    for (auto& placed : module) {
+      code_cache->FreeGuestCode(kModuleLow, placed.code);
+    }
+    module.clear();
+    for (int n = 0; n < 500; ++n) {
+      module.push_back(place());
+    }
+    // Freed space is reused, so the cache stays within what fragmentation
+    // costs.
+    REQUIRE(code_cache->high_water_mark() <= first_high_water_mark * 5 / 4);
+    for (auto* placed_functions : {&resident, &module}) {
+      for (auto& placed : *placed_functions) {
+        REQUIRE(is_found(placed));
+      }
+    }
+  }
+
+  // Lookups are made while handling exceptions and walking stacks, where
+  // another thread may be stopped holding the global lock.
+  std::promise<void> locked;
+  std::promise<void> looked_up;
+  std::thread lock_holder([&]() {
+    auto global_lock = global_critical_region::AcquireDirect();
+    locked.set_value();
+    looked_up.get_future().wait();
+  });
+  locked.get_future().wait();
+  bool all_found = std::all_of(resident.begin(), resident.end(), is_found);
+  looked_up.set_value();
+  lock_holder.join();
+  REQUIRE(all_found);
+
+  for (auto* placed_functions : {&resident, &module}) {
+    for (auto& placed : *placed_functions) {
+      code_cache->FreeGuestCode(kModuleLow, placed.code);
+      REQUIRE(code_cache->LookupFunction(uint64_t(placed.code)) == nullptr);
+    }
+  }
+  REQUIRE(code_cache->used_size() == base_size);
+}
@@ -0,0 +1,191 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2020 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+// DOT_PRODUCT_3/4 used to be vdpps with the MXCSR overflow flag checked
+// around it. These compare the current sequences against exactly that.
+
+#include <smmintrin.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <random>
+
+#include "xenia/cpu/testing/util.h"
+
+using namespace xe;
+using namespace xe::cpu;
+using namespace xe::cpu::hir;
+using namespace xe::cpu::testing;
+using xe::cpu::ppc::PPCContext;
+
+namespace {
+
+const int kFuzzIterations = 20000;
+
+uint32_t ReferenceDotProduct(const vec128_t& a, const vec128_t& b, bool dot3) {
+  // Volatile so the dot product can't be moved out from between the MXCSR
+  // accesses.
+  volatile __m128 va = _mm_loadu_ps(a.f32);
+  volatile __m128 vb = _mm_loadu_ps(b.f32);
+  _mm_setcsr(_mm_getcsr() & ~_MM_EXCEPT_OVERFLOW);
+  volatile __m128 result =
+      dot3 ? _mm_dp_ps(va, vb, 0b01110001) : _mm_dp_ps(va, vb, 0b11110001);
+  bool overflow = (_mm_getcsr() & _MM_EXCEPT_OVERFLOW) != 0;
+  _mm_setcsr(_mm_getcsr() & ~_MM_EXCEPT_OVERFLOW);
+  if (overflow) {
+    return 0x7FC00000;
+  }
+  __m128 value = result;
+  uint32_t bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+  return bits;
+}
+
+// Mostly magnitudes whose products and sums land near the top of the float
+// range, plus infinities, NaNs with payloads, zeros and denormals.
+vec128_t RandomDotProductVec128(std::mt19937& rng) {
+  static const uint32_t specials[] = {
+      0x00000000, 0x80000000, 0x7F800000, 0xFF800000, 0x7FC00000,
+      0xFFC00001, 0x7F800123, 0x7F7FFFFF, 0xFF7FFFFF, 0x00000001,
+      0x5F800000, 0xDF800000, 0x3F800000,
+  };
+  vec128_t v;
+  for (size_t i = 0; i < 4; ++i) {
+    uint32_t bits = rng();
+    switch (rng() % 5) {
+      case 0:
+        v.u32[i] = specials[rng() % xe::countof(specials)];
+        break;
+      case 1:
+      case 2:
+        // Exponents 2^36..2^63 and 2^-27..2^0.
+        v.u32[i] = (bits & 0x807FFFFF) | (((rng() % 28) + 163) << 23);
+        break;
+      case 3:
+        v.u32[i] = (bits & 0x807FFFFF) | (((rng() % 28) + 100) << 23);
+        break;
+      default:
+        v.u32[i] = bits;
+        break;
+    }
+  }
+  return v;
+}
+
+void FuzzDotProduct(bool dot3) {
+  std::mt19937 rng(dot3 ? 0x5EED0003 : 0x5EED0004);
+  TestFunction test([dot3](HIRBuilder& b) {
+    Value* v1 = LoadVR(b, 4);
+    Value* v2 = LoadVR(b, 5);
+    Value* dp = dot3 ? b.DotProduct3(v1, v2) : b.DotProduct4(v1, v2);
+    b.StoreContext(offsetof(PPCContext, v) + 3 * 16, dp);
+    b.Return();
+  });
+  for (int n = 0; n < kFuzzIterations; ++n) {
+    vec128_t a = RandomDotProductVec128(rng);
+    vec128_t b = RandomDotProductVec128(rng);
+    test.Run(
+        [&](PPCContext* ctx) {
+          ctx->v[4] = a;
+          ctx->v[5] = b;
+        },
+        [&](PPCContext* ctx) {
+          REQUIRE(ctx->v[3].u32[0] == ReferenceDotProduct(a, b, dot3));
+        });
+  }
+}
+
+}  // namespace
+
+TEST_CASE("DOT_PRODUCT_3_FUZZ", "[instr]") { FuzzDotProduct(true); }
+
+TEST_CASE("DOT_PRODUCT_4_FUZZ", "[instr]") { FuzzDotProduct(false); }
+
+TEST_CASE("DOT_PRODUCT_OVERFLOW", "[instr]") {
+  TestFunction test([](HIRBuilder& b) {
+    StoreVR(b, 3, b.Splat(b.DotProduct4(LoadVR(b, 4), LoadVR(b, 5)),
+                          VEC128_TYPE));
+    b.Return();
+  });
+  // Product overflow.
+  test.Run(
+      [](PPCContext* ctx) {
+        ctx->v[4] = vec128f(1e30f, 0.0f, 0.0f, 0.0f);
+        ctx->v[5] = vec128f(1e30f, 0.0f, 0.0f, 0.0f);
+      },
+      [](PPCContext* ctx) { REQUIRE(ctx->v[3] == vec128i(0x7FC00000)); });
+  // Sum overflow from finite products.
+  test.Run(
+      [](PPCContext* ctx) {
+        ctx->v[4] = vec128f(3e38f, 3e38f, 0.0f, 0.0f);
+        ctx->v[5] = vec128f(1.0f, 1.0f, 1.0f, 1.0f);
+      },
+      [](PPCContext* ctx) { REQUIRE(ctx->v[3] == vec128i(0x7FC00000)); });
+  // Overflow hidden behind an infinite input.
+  test.Run(
+      [](PPCContext* ctx) {
+        ctx->v[4] = vec128f(1e30f, 1.0f, 0.0f, 0.0f);
+        ctx->v[5] = vec128f(1e30f, std::numeric_limits<float>::infinity(),
+                            0.0f, 0.0f);
+      },
+      [](PPCContext* ctx) { REQUIRE(ctx->v[3] == vec128i(0x7FC00000)); });
+  // Infinite inputs alone don't overflow.
+  test.Run(
+      [](PPCContext* ctx) {
+        ctx->v[4] = vec128f(2.0f, 1.0f, 0.0f, 0.0f);
+        ctx->v[5] = vec128f(3.0f, std::numeric_limits<float>::infinity(),
+                            0.0f, 0.0f);
+      },
+      [](PPCContext* ctx) { REQUIRE(ctx->v[3] == vec128i(0x7F800000)); });
+}
+
+TEST_CASE("DOT_PRODUCT_BENCHMARK", "[.benchmark]") {
+  const int kChainLength = 1024;
+  const int kRuns = 1000;
+  // Weights summing to 1 keep the chain away from overflow and denormals.
+  auto time_runs = [&](TestFunction& test, const vec128_t& weights) {
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int n = 0; n < kRuns; ++n) {
+      test.Run(
+          [&](PPCContext* ctx) {
+            ctx->v[4] = vec128f(1.5f);
+            ctx->v[5] = weights;
+          },
+          [](PPCContext* ctx) {});
+    }
+    auto elapsed = std::chrono::high_resolution_clock::now() - start;
+    return std::chrono::duration<double, std::nano>(elapsed).count();
+  };
+  TestFunction empty([](HIRBuilder& b) {
+    StoreVR(b, 3, LoadVR(b, 4));
+    b.Return();
+  });
+  double overhead = time_runs(empty, vec128f(0.25f));
+  for (bool dot3 : {true, false}) {
+    // Each result feeds the next so this measures latency, as in transform
+    // chains.
+    TestFunction test([dot3](HIRBuilder& b) {
+      Value* v = LoadVR(b, 4);
+      Value* m = LoadVR(b, 5);
+      for (int n = 0; n < kChainLength; ++n) {
+        Value* dp = dot3 ? b.DotProduct3(v, m) : b.DotProduct4(v, m);
+        v = b.Splat(dp, VEC128_TYPE);
+      }
+      StoreVR(b, 3, v);
+      b.Return();
+    });
+    auto weights = dot3 ? vec128f(0.5f, 0.25f, 0.25f, 0.0f) : vec128f(0.25f);
+    double ns =
+        (time_runs(test, weights) - overhead) / (double(kRuns) * kChainLength);
+    std::printf("%-14s %6.2f ns/op\n", dot3 ? "DOT_PRODUCT_3" : "DOT_PRODUCT_4",
+                ns);
+  }
+}
@@ -0,0 +1,256 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2020 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include <functional>
+#include <memory>
+
+#include "xenia/cpu/compiler/compiler.h"
+#include "xenia/cpu/compiler/compiler_passes.h"
+#include "xenia/cpu/testing/util.h"
+
+using namespace xe;
+using namespace xe::cpu;
+using namespace xe::cpu::hir;
+using namespace xe::cpu::testing;
+
+namespace passes = xe::cpu::compiler::passes;
+
+namespace {
+
+// Builds the function with the generator and runs value numbering on it alone,
+// so the HIR can be checked without the other passes changing it further.
+class GVNTest {
+ public:
+  explicit GVNTest(std::function<void(HIRBuilder& b)> generator)
+      : compiler_(nullptr) {
+    generator(builder_);
+    builder_.Finalize();
+    compiler_.AddPass(std::make_unique<passes::ControlFlowAnalysisPass>());
+    auto gvn = std::make_unique<passes::GlobalValueNumberingPass>();
+    gvn_ = gvn.get();
+    compiler_.AddPass(std::move(gvn));
+    compiler_.AddPass(std::make_unique<passes::ValidationPass>());
+    REQUIRE(compiler_.Compile(&builder_));
+  }
+
+  uint32_t Count(const OpcodeInfo& opcode) const {
+    uint32_t count = 0;
+    for (auto block = builder_.first_block(); block; block = block->next) {
+      for (auto i = block->instr_head; i; i = i->next) {
+        if (i->opcode == &opcode) {
+          ++count;
+        }
+      }
+    }
+    return count;
+  }
+
+  uint32_t replaced_in_block() const {
+    return gvn_->replaced_in_block_count();
+  }
+  uint32_t replaced_across_blocks() const {
+    return gvn_->replaced_across_blocks_count();
+  }
+
+ private:
+  HIRBuilder builder_;
+  compiler::Compiler compiler_;
+  passes::GlobalValueNumberingPass* gvn_;
+};
+
+Value* Product(HIRBuilder& b) { return b.Mul(LoadGPR(b, 3), LoadGPR(b, 4)); }
+
+Value* LoadWord(HIRBuilder& b) {
+  return b.Load(b.Add(LoadGPR(b, 3), b.LoadConstantUint64(16)), INT32_TYPE);
+}
+
+}  // namespace
+
+TEST_CASE("GVN_SAME_BLOCK", "[gvn]") {
+  GVNTest test([](HIRBuilder& b) {
+    StoreGPR(b, 5, Product(b));
+    StoreGPR(b, 6, Product(b));
+    b.Return();
+  });
+  // The second product and the context loads feeding it.
+  REQUIRE(test.replaced_in_block() == 3);
+  REQUIRE(test.replaced_across_blocks() == 0);
+  REQUIRE(test.Count(OPCODE_MUL_info) == 1);
+}
+
+TEST_CASE("GVN_COMMUTATIVE", "[gvn]") {
+  GVNTest test([](HIRBuilder& b) {
+    StoreGPR(b, 5, b.Add(LoadGPR(b, 3), LoadGPR(b, 4)));
+    StoreGPR(b, 6, b.Add(LoadGPR(b, 4), LoadGPR(b, 3)));
+    StoreGPR(b, 7, b.Sub(LoadGPR(b, 3), LoadGPR(b, 4)));
+    StoreGPR(b, 8, b.Sub(LoadGPR(b, 4), LoadGPR(b, 3)));
+    b.Return();
+  });
+  REQUIRE(test.Count(OPCODE_ADD_info) == 1);
+  REQUIRE(test.Count(OPCODE_SUB_info) == 2);
+}
+
+TEST_CASE("GVN_CONSTANTS", "[gvn]") {
+  GVNTest test([](HIRBuilder& b) {
+    StoreGPR(b, 5, b.Add(LoadGPR(b, 3), b.LoadConstantUint64(16)));
+    StoreGPR(b, 6, b.Add(LoadGPR(b, 3), b.LoadConstantUint64(16)));
+    StoreGPR(b, 7, b.Add(LoadGPR(b, 3), b.LoadConstantUint64(32)));
+    b.Return();
+  });
+  REQUIRE(test.Count(OPCODE_ADD_info) == 2);
+}
+
+TEST_CASE("GVN_DIAMOND", "[gvn]") {
+  GVNTest test([](HIRBuilder& b) {
+    auto else_label = b.NewLabel();
+    auto end_label = b.NewLabel();
+    StoreGPR(b, 5, Product(b));
+    b.BranchTrue(LoadGPR(b, 6), else_label);
+    StoreGPR(b, 7, Product(b));
+    b.Branch(end_label);
+    b.MarkLabel(else_label);
+    StoreGPR(b, 8, Product(b));
+    b.MarkLabel(end_label);
+    StoreGPR(b, 9, Product(b));
+    b.Return();
+  });
+  // Computed once, then loaded from a local in both arms and after the join.
+  REQUIRE(test.replaced_across_blocks() == 3);
+  REQUIRE(test.Count(OPCODE_MUL_info) == 1);
+  REQUIRE(test.Count(OPCODE_STORE_LOCAL_info) == 1);
+  REQUIRE(test.Count(OPCODE_LOAD_LOCAL_info) == 3);
+  // Context loads are not carried across blocks.
+  REQUIRE(test.Count(OPCODE_LOAD_CONTEXT_info) == 2 + 1 + 2 * 3);
+}
+
+TEST_CASE("GVN_CONTEXT_STORE_ON_PATH", "[gvn]") {
+  GVNTest test([](HIRBuilder& b) {
+    auto else_label = b.NewLabel();
+    auto end_label = b.NewLabel();
+    StoreGPR(b, 5, Product(b));
+    b.BranchTrue(LoadGPR(b, 6), else_label);
+    StoreGPR(b, 3, LoadGPR(b, 7));
+    b.Branch(end_label);
+    b.MarkLabel(else_label);
+    // Not on the path through the other arm.
+    StoreGPR(b, 8, Product(b));
+    b.MarkLabel(end_label);
+    StoreGPR(b, 9, Product(b));
+    b.Return();
+  });
+  REQUIRE(test.replaced_across_blocks() == 1);
+  REQUIRE(test.Count(OPCODE_MUL_info) == 2);
+}
+
+TEST_CASE("GVN_CONTEXT_STORE_FORWARDING", "[gvn]") {
+  GVNTest test([](HIRBuilder& b) {
+    auto skip_label = b.NewLabel();
+    StoreGPR(b, 3, b.Mul(LoadGPR(b, 4), LoadGPR(b, 5)));
+    b.BranchTrue(LoadGPR(b, 6), skip_label);
+    b.MarkLabel(skip_label);
+    // r3 still holds the product stored above.
+    StoreGPR(b, 7, b.Add(LoadGPR(b, 3), LoadGPR(b, 6)));
+    StoreGPR(b, 8, b.Add(b.Mul(LoadGPR(b, 4), LoadGPR(b, 5)), LoadGPR(b, 6)));
+    b.Return();
+  });
+  REQUIRE(test.Count(OPCODE_MUL_info) == 1);
+  REQUIRE(test.Count(OPCODE_ADD_info) == 1);
+}
+
+TEST_CASE("GVN_CALL", "[gvn]") {
+  GVNTest test([](HIRBuilder& b) {
+    auto skip_label = b.NewLabel();
+    StoreGPR(b, 5, Product(b));
+    b.BranchTrue(LoadGPR(b, 6), skip_label);
+    b.CallExtern(nullptr);
+    b.MarkLabel(skip_label);
+    StoreGPR(b, 9, Product(b));
+    b.Return();
+  });
+  REQUIRE(test.replaced_across_blocks() == 0);
+  REQUIRE(test.Count(OPCODE_MUL_info) == 2);
+}
+
+TEST_CASE("GVN_MEMORY", "[gvn]") {
+  SECTION("Dominated") {
+    GVNTest test([](HIRBuilder& b) {
+      auto skip_label = b.NewLabel();
+      StoreGPR(b, 5, b.ZeroExtend(LoadWord(b), INT64_TYPE));
+      b.BranchTrue(LoadGPR(b, 6), skip_label);
+      b.MarkLabel(skip_label);
+      StoreGPR(b, 7, b.ZeroExtend(LoadWord(b), INT64_TYPE));
+      b.Return();
+    });
+    REQUIRE(test.Count(OPCODE_LOAD_info) == 1);
+    REQUIRE(test.Count(OPCODE_ADD_info) == 1);
+  }
+  SECTION("Store on path") {
+    GVNTest test([](HIRBuilder& b) {
+      auto skip_label = b.NewLabel();
+      StoreGPR(b, 5, b.ZeroExtend(LoadWord(b), INT64_TYPE));
+      b.BranchTrue(LoadGPR(b, 6), skip_label);
+      b.Store(LoadGPR(b, 8), b.LoadConstantUint32(0));
+      b.MarkLabel(skip_label);
+      StoreGPR(b, 7, b.ZeroExtend(LoadWord(b), INT64_TYPE));
+      b.Return();
+    });
+    REQUIRE(test.Count(OPCODE_LOAD_info) == 2);
+    // The address is still reused.
+    REQUIRE(test.Count(OPCODE_ADD_info) == 1);
+  }
+  SECTION("Loop") {
+    // Another thread may be what changes the value and ends the loop.
+    GVNTest test([](HIRBuilder& b) {
+      auto loop_label = b.NewLabel();
+      StoreGPR(b, 5, b.ZeroExtend(LoadWord(b), INT64_TYPE));
+      b.MarkLabel(loop_label);
+      b.BranchTrue(LoadWord(b), loop_label);
+      b.Return();
+    });
+    REQUIRE(test.Count(OPCODE_LOAD_info) == 2);
+  }
+  SECTION("Loop on path") {
+    // A spin loop on another word, such as a lock, orders the loads after it.
+    GVNTest test([](HIRBuilder& b) {
+      auto skip_label = b.NewLabel();
+      auto spin_label = b.NewLabel();
+      StoreGPR(b, 5, b.ZeroExtend(LoadWord(b), INT64_TYPE));
+      b.BranchTrue(LoadGPR(b, 6), skip_label);
+      b.MarkLabel(spin_label);
+      b.BranchFalse(b.Load(LoadGPR(b, 8), INT32_TYPE), spin_label);
+      b.MarkLabel(skip_label);
+      StoreGPR(b, 7, b.ZeroExtend(LoadWord(b), INT64_TYPE));
+      b.Return();
+    });
+    REQUIRE(test.Count(OPCODE_LOAD_info) == 3);
+  }
+  SECTION("MMIO read") {
+    GVNTest test([](HIRBuilder& b) {
+      StoreGPR(b, 5, b.ZeroExtend(LoadWord(b), INT64_TYPE));
+      StoreGPR(b, 6, b.ZeroExtend(b.LoadMmio(nullptr, 0x7FC80000, INT32_TYPE),
+                                  INT64_TYPE));
+      StoreGPR(b, 7, b.ZeroExtend(LoadWord(b), INT64_TYPE));
+      b.Return();
+    });
+    REQUIRE(test.Count(OPCODE_LOAD_info) == 2);
+  }
+}
+
+TEST_CASE("GVN_ROUNDING_MODE", "[gvn]") {
+  GVNTest test([](HIRBuilder& b) {
+    StoreFPR(b, 1, b.Add(LoadFPR(b, 2), LoadFPR(b, 3)));
+    b.SetRoundingMode(b.LoadConstantInt32(1));
+    StoreFPR(b, 4, b.Add(LoadFPR(b, 2), LoadFPR(b, 3)));
+    StoreGPR(b, 5, b.Add(LoadGPR(b, 3), LoadGPR(b, 4)));
+    StoreGPR(b, 6, b.Add(LoadGPR(b, 3), LoadGPR(b, 4)));
+    b.Return();
+  });
+  // Only the integer add is merged.
+  REQUIRE(test.Count(OPCODE_ADD_info) == 3);
+}
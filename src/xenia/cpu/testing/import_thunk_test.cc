@@ -0,0 +1,222 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2020 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+// Calls from PPC code through import thunks rewritten as XexModule does when
+// loading, to the kernel and to the export of another module, with and
+// without --bind_import_thunks.
+
+#include <chrono>
+#include <cstdio>
+#include <initializer_list>
+#include <memory>
+#include <string>
+
+#include "xenia/base/byte_order.h"
+#include "xenia/cpu/cpu_flags.h"
+#include "xenia/cpu/raw_module.h"
+#include "xenia/cpu/testing/util.h"
+#include "xenia/cpu/xex_module.h"
+
+using namespace xe;
+using namespace xe::cpu;
+using namespace xe::cpu::testing;
+
+namespace {
+
+// The game, with the callers and its import thunks, and a library it imports
+// a function from.
+const uint32_t kGameLow = 0x80000000;
+const uint32_t kGameHigh = 0x80010000;
+const uint32_t kLibraryLow = 0x80010000;
+const uint32_t kLibraryHigh = 0x80020000;
+const uint32_t kKernelCallerAddress = 0x80000000;
+const uint32_t kUserCallerAddress = 0x80000040;
+const uint32_t kKernelThunkAddress = 0x80000100;
+const uint32_t kUserThunkAddress = 0x80000200;
+const uint32_t kExportAddress = 0x80010000;
+// r11 and CTR as the thunk leaves them, sign extended by the lis.
+const uint64_t kExportAddressRegister = 0xFFFFFFFF80010000ull;
+
+// Counts calls in r5.
+void TrivialKernelExport(PPCContext* ppc_context,
+                         kernel::KernelState* kernel_state) {
+  ppc_context->r[5] += 1;
+}
+
+class CvarOverride {
+ public:
+  CvarOverride(bool* cvar, bool value) : cvar_(cvar), previous_(*cvar) {
+    *cvar = value;
+  }
+  ~CvarOverride() { *cvar_ = previous_; }
+
+ private:
+  bool* cvar_;
+  bool previous_;
+};
+
+class ImportThunkTest {
+ public:
+  ImportThunkTest() : test_(kGameLow, kLibraryHigh) {
+    auto game = AddModule("game", kGameLow, kGameHigh);
+    AddModule("library", kLibraryLow, kLibraryHigh);
+
+    Write(kExportAddress, {0x38A50001,    // addi r5, r5, 1
+                           0x4E800020});  // blr
+    WriteCaller(kKernelCallerAddress, kKernelThunkAddress);
+    WriteCaller(kUserCallerAddress, kUserThunkAddress);
+
+    // The thunks as they are in the image, until loading rewrites them.
+    for (uint32_t address : {kKernelThunkAddress, kUserThunkAddress}) {
+      Write(address, {0x38600000,    // li r3, 0
+                      0x388001F5,    // li r4, 0x1F5
+                      0x7D6903A6,    // mtctr r11
+                      0x4E800420});  // bctr
+    }
+    Function* kernel_thunk = DeclareThunk(game, kKernelThunkAddress);
+    XexModule::SetupKernelImportThunk(
+        memory(), static_cast<GuestFunction*>(kernel_thunk),
+        TrivialKernelExport, nullptr);
+    kernel_thunk->set_status(Symbol::Status::kDeclared);
+    Function* user_thunk = DeclareThunk(game, kUserThunkAddress);
+    XexModule::SetupUserImportThunk(memory(), user_thunk, kExportAddress);
+    user_thunk->set_status(Symbol::Status::kDeclared);
+  }
+
+  Memory* memory() const { return test_.memory(); }
+  Processor* processor() const { return test_.processor(); }
+
+  void Write(uint32_t address, std::initializer_list<uint32_t> code) {
+    uint8_t* p = memory()->TranslateVirtual(address);
+    for (uint32_t instr : code) {
+      xe::store_and_swap<uint32_t>(p, instr);
+      p += 4;
+    }
+  }
+
+  // Runs the caller at the address, calling its thunk r3 times.
+  PPCContext* Call(uint32_t address, uint64_t iterations) {
+    auto function = processor()->ResolveFunction(address);
+    REQUIRE(function);
+    test_.thread_state()->context()->r[5] = 0;
+    auto ctx = test_.Call(function, iterations);
+    REQUIRE(ctx->r[5] == iterations);
+    return ctx;
+  }
+
+  // Runs the caller once it's compiled, returning the time per call.
+  double TimeCalls(uint32_t address, uint64_t iterations) {
+    Call(address, 1);
+    auto start = std::chrono::high_resolution_clock::now();
+    Call(address, iterations);
+    auto elapsed = std::chrono::high_resolution_clock::now() - start;
+    return std::chrono::duration<double, std::nano>(elapsed).count() /
+           iterations;
+  }
+
+ private:
+  Module* AddModule(const std::string& name, uint32_t low, uint32_t high) {
+    REQUIRE(memory()->LookupHeap(low)->AllocFixed(
+        low, high - low, 0, kMemoryAllocationReserve | kMemoryAllocationCommit,
+        kMemoryProtectRead | kMemoryProtectWrite));
+    auto module = std::make_unique<RawModule>(processor());
+    module->set_name(name);
+    module->SetAddressRange(low, high - low);
+    Module* module_ptr = module.get();
+    processor()->AddModule(std::move(module));
+    return module_ptr;
+  }
+
+  // A loop doing bl to the thunk r3 times, counting in r4.
+  void WriteCaller(uint32_t address, uint32_t thunk_address) {
+    uint32_t bl = 0x48000001 | ((thunk_address - (address + 8)) & 0x03FFFFFC);
+    Write(address, {0x7D8802A6,    // mflr r12
+                    0x38800000,    // li r4, 0
+                    bl,            // bl thunk
+                    0x38840001,    // addi r4, r4, 1
+                    0x7C041840,    // cmplw r4, r3
+                    0x4180FFF4,    // blt the bl
+                    0x7D8803A6,    // mtlr r12
+                    0x4E800020});  // blr
+  }
+
+  // As XexModule declares an import thunk before rewriting it.
+  Function* DeclareThunk(Module* module, uint32_t address) {
+    Function* function;
+    module->DeclareFunction(address, &function);
+    function->set_end_address(address + 16 - 4);
+    return function;
+  }
+
+  TestProcessor test_;
+};
+
+}  // namespace
+
+TEST_CASE("IMPORT_THUNK_BIND", "[import_thunk]") {
+  SECTION("Kernel export") {
+    ImportThunkTest test;
+    test.Call(kKernelCallerAddress, 4);
+    // The export was called from the caller, never through the thunk.
+    REQUIRE_FALSE(test.processor()->QueryFunction(kKernelThunkAddress));
+  }
+  SECTION("User export") {
+    ImportThunkTest test;
+    auto ctx = test.Call(kUserCallerAddress, 4);
+    REQUIRE(ctx->r[11] == kExportAddressRegister);
+    REQUIRE(ctx->ctr == kExportAddressRegister);
+    REQUIRE_FALSE(test.processor()->QueryFunction(kUserThunkAddress));
+    REQUIRE(test.processor()->QueryFunction(kExportAddress));
+  }
+  SECTION("Not bound") {
+    CvarOverride bind_import_thunks(&cvars::bind_import_thunks, false);
+    ImportThunkTest test;
+    test.Call(kKernelCallerAddress, 4);
+    REQUIRE(test.processor()->QueryFunction(kKernelThunkAddress));
+    auto ctx = test.Call(kUserCallerAddress, 4);
+    REQUIRE(ctx->r[11] == kExportAddressRegister);
+    REQUIRE(ctx->ctr == kExportAddressRegister);
+    REQUIRE(test.processor()->QueryFunction(kUserThunkAddress));
+  }
+}
+
+TEST_CASE("IMPORT_THUNK_INVALIDATE_BOUND_CALLER", "[import_thunk]") {
+  ImportThunkTest test;
+  test.Call(kKernelCallerAddress, 4);
+  auto caller = test.processor()->QueryFunction(kKernelCallerAddress);
+  REQUIRE(caller);
+
+  // Patching code elsewhere leaves the caller be.
+  test.processor()->InvalidateCodeRange(kKernelThunkAddress + 0x80,
+                                        kKernelThunkAddress + 0x100);
+  REQUIRE(test.processor()->QueryFunction(kKernelCallerAddress) == caller);
+
+  // The game patching the thunk, and doing icbi of the block holding it.
+  test.Write(kKernelThunkAddress, {0x38A50001,    // addi r5, r5, 1
+                                   0x4E800020});  // blr
+  test.processor()->InvalidateCodeRange(kKernelThunkAddress,
+                                        kKernelThunkAddress + 0x80);
+  REQUIRE_FALSE(test.processor()->QueryFunction(kKernelCallerAddress));
+  // Now calling the patched code.
+  test.Call(kKernelCallerAddress, 4);
+  REQUIRE(test.processor()->QueryFunction(kKernelThunkAddress));
+}
+
+TEST_CASE("IMPORT_THUNK_CALL_BENCHMARK", "[.benchmark]") {
+  const uint64_t kIterations = 10000000;
+  for (bool bind : {false, true}) {
+    CvarOverride bind_import_thunks(&cvars::bind_import_thunks, bind);
+    ImportThunkTest test;
+    double kernel_ns = test.TimeCalls(kKernelCallerAddress, kIterations);
+    double user_ns = test.TimeCalls(kUserCallerAddress, kIterations);
+    std::printf(
+        "%-9s kernel export %6.2f ns/call, library export %6.2f ns/call\n",
+        bind ? "bound:" : "thunk:", kernel_ns, user_ns);
+  }
+}
@@ -0,0 +1,174 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2020 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <thread>
+
+#include "xenia/cpu/testing/util.h"
+
+using namespace xe;
+using namespace xe::cpu;
+using namespace xe::cpu::hir;
+using namespace xe::cpu::testing;
+
+namespace {
+
+// On separate cache lines.
+const uint32_t kAddressX = 0x10001000;
+const uint32_t kAddressY = 0x10001080;
+
+const uint32_t kRounds = 20000;
+
+// Litmus test: each thread runs its own body at the same time as the other,
+// many times over, with both words starting at zero each round. The body gets
+// its thread index in r3, 0 in r4 and 1 in r5, and leaves what it saw in r6
+// and r7.
+class LitmusTest {
+ public:
+  LitmusTest(std::function<void(HIRBuilder& b)> thread0,
+             std::function<void(HIRBuilder& b)> thread1)
+      : test_([thread0, thread1](HIRBuilder& b) {
+          auto thread1_label = b.NewLabel();
+          b.BranchTrue(LoadGPR(b, 3), thread1_label);
+          thread0(b);
+          b.Return();
+          b.MarkLabel(thread1_label);
+          thread1(b);
+          b.Return();
+        }) {
+    test_.memory->LookupHeap(0)->AllocFixed(
+        kAddressX, 0x1000, 0,
+        kMemoryAllocationReserve | kMemoryAllocationCommit,
+        kMemoryProtectRead | kMemoryProtectWrite);
+  }
+
+  // Returns the number of rounds for which forbidden returned true.
+  uint32_t Run(std::function<bool(const PPCContext& thread0,
+                                  const PPCContext& thread1)>
+                   forbidden) {
+    auto processor = test_.processors[0].get();
+    auto fn = processor->ResolveFunction(0x80000000);
+    REQUIRE(fn);
+    auto x = test_.memory->TranslateVirtual<uint32_t*>(kAddressX);
+    auto y = test_.memory->TranslateVirtual<uint32_t*>(kAddressY);
+
+    std::atomic<uint32_t> round(0);
+    std::atomic<uint32_t> finished(0);
+    std::unique_ptr<ThreadState> thread_states[2];
+    std::thread threads[2];
+    for (uint32_t n = 0; n < 2; ++n) {
+      thread_states[n] = std::make_unique<ThreadState>(processor, 0x100 + n);
+      threads[n] = std::thread([&, n]() {
+        auto thread_state = thread_states[n].get();
+        auto ctx = thread_state->context();
+        for (uint32_t r = 1; r <= kRounds; ++r) {
+          while (round.load(std::memory_order_acquire) != r) {
+          }
+          ctx->r[3] = n;
+          ctx->r[4] = 0;
+          ctx->r[5] = 1;
+          ctx->lr = 0xBCBCBCBC;
+          fn->Call(thread_state, uint32_t(ctx->lr));
+          finished.fetch_add(1, std::memory_order_acq_rel);
+        }
+      });
+    }
+
+    uint32_t forbidden_count = 0;
+    for (uint32_t r = 1; r <= kRounds; ++r) {
+      *x = 0;
+      *y = 0;
+      round.store(r, std::memory_order_release);
+      while (finished.load(std::memory_order_acquire) != r * 2) {
+      }
+      if (forbidden(*thread_states[0]->context(),
+                    *thread_states[1]->context())) {
+        ++forbidden_count;
+      }
+    }
+    for (auto& thread : threads) {
+      thread.join();
+    }
+    return forbidden_count;
+  }
+
+ private:
+  TestFunction test_;
+};
+
+Value* LoadWord(HIRBuilder& b, uint32_t address) {
+  return b.ZeroExtend(b.Load(b.LoadConstantUint32(address), INT32_TYPE),
+                      INT64_TYPE);
+}
+
+void StoreOne(HIRBuilder& b, uint32_t address) {
+  b.Store(b.LoadConstantUint32(address), b.LoadConstantUint32(1));
+}
+
+}  // namespace
+
+// sync between a store and a load of another word: both threads can't miss
+// the store of the other. Needs a real fence on x64.
+TEST_CASE("MEMORY_BARRIER_STORE_BUFFERING", "[memory_barrier]") {
+  LitmusTest test(
+      [](HIRBuilder& b) {
+        StoreOne(b, kAddressX);
+        b.MemoryBarrier(MEMORY_BARRIER_FULL);
+        StoreGPR(b, 6, LoadWord(b, kAddressY));
+      },
+      [](HIRBuilder& b) {
+        StoreOne(b, kAddressY);
+        b.MemoryBarrier(MEMORY_BARRIER_FULL);
+        StoreGPR(b, 6, LoadWord(b, kAddressX));
+      });
+  REQUIRE(test.Run([](const PPCContext& thread0, const PPCContext& thread1) {
+            return thread0.r[6] == 0 && thread1.r[6] == 0;
+          }) == 0);
+}
+
+// As above with the stores done by compare exchanges, which make the fence
+// after them unnecessary.
+TEST_CASE("MEMORY_BARRIER_LOCKED_STORE_BUFFERING", "[memory_barrier]") {
+  auto body = [](uint32_t mine, uint32_t other) {
+    return [mine, other](HIRBuilder& b) {
+      b.AtomicCompareExchange(b.LoadConstantUint32(mine),
+                              b.Truncate(LoadGPR(b, 4), INT32_TYPE),
+                              b.Truncate(LoadGPR(b, 5), INT32_TYPE));
+      b.MemoryBarrier(MEMORY_BARRIER_FULL);
+      StoreGPR(b, 6, LoadWord(b, other));
+    };
+  };
+  LitmusTest test(body(kAddressX, kAddressY), body(kAddressY, kAddressX));
+  REQUIRE(test.Run([](const PPCContext& thread0, const PPCContext& thread1) {
+            return thread0.r[6] == 0 && thread1.r[6] == 0;
+          }) == 0);
+}
+
+// lwsync between publishing data and a flag, and between reading the flag and
+// the data: the flag can't be seen without the data.
+TEST_CASE("MEMORY_BARRIER_MESSAGE_PASSING", "[memory_barrier]") {
+  const uint16_t lwsync = MEMORY_BARRIER_ACQUIRE | MEMORY_BARRIER_RELEASE |
+                          MEMORY_BARRIER_STORE_STORE;
+  LitmusTest test(
+      [lwsync](HIRBuilder& b) {
+        StoreOne(b, kAddressX);
+        b.MemoryBarrier(lwsync);
+        StoreOne(b, kAddressY);
+      },
+      [lwsync](HIRBuilder& b) {
+        StoreGPR(b, 6, LoadWord(b, kAddressY));
+        b.MemoryBarrier(lwsync);
+        StoreGPR(b, 7, LoadWord(b, kAddressX));
+      });
+  REQUIRE(test.Run([](const PPCContext& thread0, const PPCContext& thread1) {
+            return thread1.r[6] == 1 && thread1.r[7] == 0;
+          }) == 0);
+}
@@ -0,0 +1,186 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2020 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include "xenia/cpu/reservation_table.h"
+
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "xenia/base/byte_order.h"
+
+#include "third_party/catch/single_include/catch.hpp"
+
+namespace xe {
+namespace cpu {
+namespace test {
+
+// Guest memory stand-in; guest addresses are offsets into it.
+struct TestMemory {
+  alignas(128) uint32_t words[1024] = {};
+
+  uint32_t* TranslateVirtual(uint32_t address) {
+    return &words[address / sizeof(uint32_t)];
+  }
+};
+
+// lwarx, add, stwcx. retried until it goes through, as guest code does for
+// InterlockedIncrement. Returns the number of failed attempts.
+uint32_t GuestIncrement(ReservationTable* table, TestMemory* memory,
+                        uint32_t address) {
+  uint32_t failures = 0;
+  while (true) {
+    uint64_t version = table->Reserve(address);
+    uint32_t* host_address = memory->TranslateVirtual(address);
+    uint32_t value = xe::byte_swap(*host_address);
+    if (table->StoreConditional(address, version, host_address,
+                                xe::byte_swap(value),
+                                xe::byte_swap(value + 1))) {
+      return failures;
+    }
+    ++failures;
+  }
+}
+
+TEST_CASE("reservation_table_store_conditional", "[reservation]") {
+  auto table = std::make_unique<ReservationTable>();
+  auto memory = std::make_unique<TestMemory>();
+  uint32_t* word = memory->TranslateVirtual(0x10);
+
+  uint64_t version = table->Reserve(0x10);
+  REQUIRE(table->StoreConditional(0x10, version, word, 0u, 1u));
+  REQUIRE(*word == 1);
+  // A reservation only allows one store.
+  REQUIRE_FALSE(table->StoreConditional(0x10, version, word, 1u, 2u));
+  REQUIRE(*word == 1);
+  // No reservation at all.
+  REQUIRE_FALSE(table->StoreConditional(0x10, UINT64_MAX, word, 1u, 2u));
+  REQUIRE(*word == 1);
+}
+
+TEST_CASE("reservation_table_lost_to_other_store", "[reservation]") {
+  auto table = std::make_unique<ReservationTable>();
+  auto memory = std::make_unique<TestMemory>();
+  uint32_t* word = memory->TranslateVirtual(0x20);
+  uint32_t* neighbor = memory->TranslateVirtual(0x24);
+
+  // Another thread changes the value and changes it back before we store.
+  uint64_t version = table->Reserve(0x20);
+  uint64_t other_version = table->Reserve(0x20);
+  REQUIRE(table->StoreConditional(0x20, other_version, word, 0u, 5u));
+  other_version = table->Reserve(0x20);
+  REQUIRE(table->StoreConditional(0x20, other_version, word, 5u, 0u));
+  REQUIRE_FALSE(table->StoreConditional(0x20, version, word, 0u, 1u));
+  REQUIRE(*word == 0);
+
+  // Any conditional store to the same granule takes the reservation.
+  version = table->Reserve(0x20);
+  other_version = table->Reserve(0x24);
+  REQUIRE(table->StoreConditional(0x24, other_version, neighbor, 0u, 7u));
+  REQUIRE_FALSE(table->StoreConditional(0x20, version, word, 0u, 1u));
+
+  // A plain store changing the value is noticed too.
+  version = table->Reserve(0x20);
+  *word = 3;
+  REQUIRE_FALSE(table->StoreConditional(0x20, version, word, 0u, 1u));
+  REQUIRE(*word == 3);
+
+  // A failed conditional store doesn't affect other reservations.
+  version = table->Reserve(0x20);
+  other_version = table->Reserve(0x20);
+  REQUIRE_FALSE(table->StoreConditional(0x20, other_version, word, 0u, 9u));
+  REQUIRE(table->StoreConditional(0x20, version, word, 3u, 4u));
+  REQUIRE(*word == 4);
+}
+
+TEST_CASE("reservation_table_granules_independent", "[reservation]") {
+  auto table = std::make_unique<ReservationTable>();
+  auto memory = std::make_unique<TestMemory>();
+  const uint32_t a = 0x00;
+  const uint32_t b = 1 << ReservationTable::kGranuleShift;
+  REQUIRE(ReservationTable::EntryIndex(a) != ReservationTable::EntryIndex(b));
+
+  uint64_t version_a = table->Reserve(a);
+  uint64_t version_b = table->Reserve(b);
+  REQUIRE(table->StoreConditional(b, version_b, memory->TranslateVirtual(b),
+                                  0u, 1u));
+  REQUIRE(table->StoreConditional(a, version_a, memory->TranslateVirtual(a),
+                                  0u, 1u));
+}
+
+TEST_CASE("reservation_table_stress", "[reservation]") {
+  auto table = std::make_unique<ReservationTable>();
+  auto memory = std::make_unique<TestMemory>();
+  // Two counters sharing a granule and one on its own.
+  const uint32_t addresses[] = {0x100, 0x104, 0x200};
+  const uint32_t thread_count = 16;
+  const uint32_t iterations = 20000;
+
+  std::vector<std::thread> threads;
+  for (uint32_t t = 0; t < thread_count; ++t) {
+    threads.emplace_back([&, t]() {
+      for (uint32_t n = 0; n < iterations; ++n) {
+        GuestIncrement(table.get(), memory.get(), addresses[(t + n) % 3]);
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  uint32_t total = 0;
+  for (uint32_t address : addresses) {
+    total += xe::byte_swap(*memory->TranslateVirtual(address));
+  }
+  REQUIRE(total == thread_count * iterations);
+}
+
+TEST_CASE("reservation_table_benchmark", "[.benchmark]") {
+  const uint32_t iterations = 200000;
+  for (uint32_t thread_count : {1, 2, 4, 8, 16}) {
+    // Each thread increments its own counter, in its own granule, as with
+    // per-object locks and reference counts.
+    auto run = [&](bool global_lock) {
+      auto table = std::make_unique<ReservationTable>();
+      auto memory = std::make_unique<TestMemory>();
+      std::mutex mutex;
+      auto start = std::chrono::high_resolution_clock::now();
+      std::vector<std::thread> threads;
+      for (uint32_t t = 0; t < thread_count; ++t) {
+        threads.emplace_back([&, t]() {
+          uint32_t address = (t % 8) << ReservationTable::kGranuleShift;
+          for (uint32_t n = 0; n < iterations; ++n) {
+            if (global_lock) {
+              // What mtmsr around lwarx/stwcx. used to cost.
+              std::lock_guard<std::mutex> lock(mutex);
+              GuestIncrement(table.get(), memory.get(), address);
+            } else {
+              GuestIncrement(table.get(), memory.get(), address);
+            }
+          }
+        });
+      }
+      for (auto& thread : threads) {
+        thread.join();
+      }
+      auto elapsed = std::chrono::high_resolution_clock::now() - start;
+      return std::chrono::duration<double, std::nano>(elapsed).count() /
+             (double(iterations) * thread_count);
+    };
+    std::printf("%2u threads: %7.2f ns/op reservations, %7.2f ns/op locked\n",
+                thread_count, run(false), run(true));
+  }
+}
+
+}  // namespace test
+}  // namespace cpu
+}  // namespace xe
@@ -0,0 +1,336 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2020 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <thread>
+
+#include "xenia/base/platform.h"
+#include "xenia/base/threading.h"
+#include "xenia/cpu/cpu_flags.h"
+#include "xenia/cpu/testing/util.h"
+
+// Windows alerts and suspends threads itself, without safepoints.
+#if !XE_PLATFORM_WIN32
+
+#include <pthread.h>
+#include <signal.h>
+
+using namespace xe;
+using namespace xe::cpu;
+using namespace xe::cpu::hir;
+using namespace xe::cpu::testing;
+
+namespace {
+
+const uint32_t kStopAddress = 0x10001000;
+
+bool ExchangeSafepoints(bool safepoints) {
+  bool previous = cvars::safepoints;
+  cvars::safepoints = safepoints;
+  return previous;
+}
+
+// Counts in r4 until the word at kStopAddress is set.
+void SpinLoop(HIRBuilder& b) {
+  StoreGPR(b, 4, b.LoadZeroInt64());
+  auto loop = b.NewLabel();
+  b.MarkLabel(loop);
+  StoreGPR(b, 4, b.Add(LoadGPR(b, 4), b.LoadConstantUint64(1)));
+  auto stop = b.Load(b.LoadConstantUint32(kStopAddress), INT32_TYPE);
+  b.BranchFalse(stop, loop);
+  b.Return();
+}
+
+// Counts in r4 up to r3.
+void CountedLoop(HIRBuilder& b) {
+  StoreGPR(b, 4, b.LoadZeroInt64());
+  auto loop = b.NewLabel();
+  b.MarkLabel(loop);
+  Value* count = b.Add(LoadGPR(b, 4), b.LoadConstantUint64(1));
+  StoreGPR(b, 4, count);
+  b.BranchTrue(b.CompareULT(count, LoadGPR(b, 3)), loop);
+  b.Return();
+}
+
+// Runs SpinLoop on a thread of its own, created suspended, then waits
+// alertably once.
+class SpinningThread {
+ public:
+  SpinningThread() : safepoints_(ExchangeSafepoints(true)), test_(SpinLoop) {
+    test_.memory->LookupHeap(0)->AllocFixed(
+        kStopAddress, 0x1000, 0,
+        kMemoryAllocationReserve | kMemoryAllocationCommit,
+        kMemoryProtectRead | kMemoryProtectWrite);
+    stop_ = test_.memory->TranslateVirtual<volatile uint32_t*>(kStopAddress);
+    *stop_ = 0;
+
+    threading::Thread::CreationParameters params;
+    params.create_suspended = true;
+    thread_ = threading::Thread::Create(params, [this]() {
+      auto processor = test_.processors[0].get();
+      auto thread_state = std::make_unique<ThreadState>(processor, 0x100);
+      auto ctx = thread_state->context();
+      ctx->lr = 0xBCBCBCBC;
+      context_ = ctx;
+      processor->ResolveFunction(0x80000000)
+          ->Call(thread_state.get(), uint32_t(ctx->lr));
+      context_ = nullptr;
+      thread_state.reset();
+      threading::AlertableSleep(std::chrono::milliseconds(0));
+      finished_ = true;
+    });
+  }
+
+  ~SpinningThread() {
+    uint32_t suspend_count;
+    do {
+      thread_->Resume(&suspend_count);
+    } while (suspend_count > 1);
+    Stop();
+    ExchangeSafepoints(safepoints_);
+  }
+
+  // Ends the loop and waits for the thread to finish.
+  void Stop() {
+    *stop_ = 1;
+    while (!finished_) {
+      std::this_thread::yield();
+    }
+  }
+
+  threading::Thread* thread() const { return thread_.get(); }
+  PPCContext* context() const { return context_; }
+  bool started() const { return context_ != nullptr; }
+  uint64_t count() const {
+    return reinterpret_cast<volatile const uint64_t*>(context_.load()->r)[4];
+  }
+
+  void WaitForCount(uint64_t count) {
+    while (!started() || this->count() < count) {
+      std::this_thread::yield();
+    }
+  }
+
+  // Waits for the count to stop going up.
+  uint64_t WaitForStop() {
+    uint64_t count = this->count();
+    while (true) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(5));
+      uint64_t new_count = this->count();
+      if (new_count == count) {
+        return count;
+      }
+      count = new_count;
+    }
+  }
+
+ private:
+  bool safepoints_;
+  TestFunction test_;
+  volatile uint32_t* stop_;
+  std::unique_ptr<threading::Thread> thread_;
+  std::atomic<PPCContext*> context_ = {nullptr};
+  std::atomic<bool> finished_ = {false};
+};
+
+// Runs CountedLoop on this thread, returning the time per iteration.
+double TimeCountedLoop(bool safepoints, uint64_t iterations) {
+  bool previous_safepoints = ExchangeSafepoints(safepoints);
+  TestFunction test(CountedLoop);
+  ExchangeSafepoints(previous_safepoints);
+  auto processor = test.processors[0].get();
+  auto fn = processor->ResolveFunction(0x80000000);
+  auto thread_state = std::make_unique<ThreadState>(processor, 0x100);
+  auto ctx = thread_state->context();
+  ctx->r[3] = iterations;
+  ctx->lr = 0xBCBCBCBC;
+  auto start = std::chrono::high_resolution_clock::now();
+  fn->Call(thread_state.get(), uint32_t(ctx->lr));
+  auto elapsed = std::chrono::high_resolution_clock::now() - start;
+  REQUIRE(ctx->r[4] == iterations);
+  return std::chrono::duration<double, std::nano>(elapsed).count() /
+         iterations;
+}
+
+}  // namespace
+
+TEST_CASE("SAFEPOINT_CREATE_SUSPENDED", "[safepoint]") {
+  SpinningThread test;
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  REQUIRE_FALSE(test.started());
+  uint32_t suspend_count = 0;
+  REQUIRE(test.thread()->Resume(&suspend_count));
+  REQUIRE(suspend_count == 1);
+  test.WaitForCount(1);
+}
+
+TEST_CASE("SAFEPOINT_USER_CALLBACK", "[safepoint]") {
+  // Callbacks are left for the next alertable wait, as on Windows, rather than
+  // run at safepoints.
+  SpinningThread test;
+  test.thread()->Resume();
+  test.WaitForCount(1);
+  std::atomic<bool> called = {false};
+  test.thread()->QueueUserCallback([&]() { called = true; });
+  test.WaitForCount(test.count() + 100000);
+  REQUIRE_FALSE(called);
+  test.Stop();
+  REQUIRE(called);
+}
+
+TEST_CASE("SAFEPOINT_SUSPEND_RESUME", "[safepoint]") {
+  SpinningThread test;
+  test.thread()->Resume();
+  test.WaitForCount(1);
+
+  uint32_t suspend_count = UINT32_MAX;
+  REQUIRE(test.thread()->Suspend(&suspend_count));
+  REQUIRE(suspend_count == 0);
+  uint64_t count = test.WaitForStop();
+  REQUIRE(test.thread()->Suspend(&suspend_count));
+  REQUIRE(suspend_count == 1);
+
+  REQUIRE(test.thread()->Resume(&suspend_count));
+  REQUIRE(suspend_count == 2);
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  REQUIRE(test.count() == count);
+
+  REQUIRE(test.thread()->Resume(&suspend_count));
+  REQUIRE(suspend_count == 1);
+  test.WaitForCount(count + 1000);
+}
+
+TEST_CASE("SAFEPOINT_ALERTABLE_WAIT", "[safepoint]") {
+  // Threads blocked in host waits are interrupted to run callbacks.
+  std::atomic<bool> waiting = {false};
+  std::atomic<bool> called = {false};
+  threading::WaitResult result = threading::WaitResult::kFailed;
+  auto event = threading::Event::CreateAutoResetEvent(false);
+  auto thread = threading::Thread::Create({}, [&]() {
+    waiting = true;
+    result = threading::Wait(event.get(), true, std::chrono::seconds(10));
+  });
+  while (!waiting) {
+    std::this_thread::yield();
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  auto start = std::chrono::steady_clock::now();
+  thread->QueueUserCallback([&]() { called = true; });
+  while (!called) {
+    std::this_thread::yield();
+  }
+  REQUIRE(std::chrono::steady_clock::now() - start < std::chrono::seconds(5));
+  while (result == threading::WaitResult::kFailed) {
+    std::this_thread::yield();
+  }
+  REQUIRE(result == threading::WaitResult::kUserCallback);
+}
+
+TEST_CASE("SAFEPOINT_ALERTABLE_WAIT_OTHER_SIGNAL", "[safepoint]") {
+  // Other signals interrupt the host wait too, which then carries on.
+  struct sigaction action = {}, previous_action;
+  action.sa_handler = [](int) {};
+  sigemptyset(&action.sa_mask);
+  sigaction(SIGUSR2, &action, &previous_action);
+  std::atomic<bool> waiting = {false};
+  std::atomic<bool> done = {false};
+  pthread_t handle;
+  threading::WaitResult result = threading::WaitResult::kFailed;
+  auto event = threading::Event::CreateAutoResetEvent(false);
+  auto thread = threading::Thread::Create({}, [&]() {
+    handle = pthread_self();
+    waiting = true;
+    result = threading::Wait(event.get(), true, std::chrono::seconds(10));
+    done = true;
+  });
+  while (!waiting) {
+    std::this_thread::yield();
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  pthread_kill(handle, SIGUSR2);
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  REQUIRE_FALSE(done);
+  event->Set();
+  while (!done) {
+    std::this_thread::yield();
+  }
+  REQUIRE(result == threading::WaitResult::kSuccess);
+  sigaction(SIGUSR2, &previous_action, nullptr);
+}
+
+TEST_CASE("SAFEPOINT_ALERTABLE_WAIT_ON_START", "[safepoint]") {
+  // A thread handed out by itself can be alerted before its creator has
+  // returned from creating it.
+  for (uint32_t i = 0; i < 100; ++i) {
+    std::atomic<threading::Thread*> published = {nullptr};
+    std::atomic<bool> called = {false};
+    auto event = threading::Event::CreateAutoResetEvent(false);
+    std::thread alerter([&]() {
+      threading::Thread* target;
+      while (!(target = published.load())) {
+        std::this_thread::yield();
+      }
+      target->QueueUserCallback([&]() { called = true; });
+    });
+    auto thread = threading::Thread::Create({}, [&]() {
+      published = threading::Thread::GetCurrentThread();
+      threading::Wait(event.get(), true, std::chrono::seconds(10));
+    });
+    alerter.join();
+    while (!called) {
+      std::this_thread::yield();
+    }
+  }
+}
+
+TEST_CASE("SAFEPOINT_BENCHMARK", "[.benchmark]") {
+  // Cost of the polls in a tight loop, and how long a running thread takes to
+  // stop once asked to suspend.
+  const uint64_t iterations = 200000000;
+  double without = TimeCountedLoop(false, iterations);
+  double with = TimeCountedLoop(true, iterations);
+
+  const int rounds = 1000;
+  SpinningThread test;
+  test.thread()->Resume();
+  test.WaitForCount(1);
+  std::chrono::nanoseconds total_latency(0);
+  std::chrono::nanoseconds max_latency(0);
+  for (int n = 0; n < rounds; ++n) {
+    auto start = std::chrono::high_resolution_clock::now();
+    test.thread()->Suspend();
+    // Stopped once the count is seen not to move between two reads a
+    // safepoint apart.
+    uint64_t count = test.count();
+    while (true) {
+      std::this_thread::yield();
+      uint64_t new_count = test.count();
+      if (new_count == count) {
+        break;
+      }
+      count = new_count;
+    }
+    auto latency = std::chrono::high_resolution_clock::now() - start;
+    total_latency += latency;
+    max_latency = std::max(max_latency, latency);
+    test.thread()->Resume();
+  }
+  std::printf(
+      "loop iteration: %6.3f ns without safepoints, %6.3f ns with; suspend "
+      "latency %8.0f ns average, %8.0f ns max\n",
+      without, with, double(total_latency.count()) / rounds,
+      double(max_latency.count()));
+}
+
+#endif  // !XE_PLATFORM_WIN32
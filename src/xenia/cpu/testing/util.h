@@ -10,6 +10,9 @@
 #ifndef XENIA_CPU_TESTING_UTIL_H_
 #define XENIA_CPU_TESTING_UTIL_H_
 
+#include <functional>
+#include <memory>
+#include <string>
 #include <vector>
 
 #include "xenia/base/main.h"
@@ -90,6 +93,62 @@ class TestFunction {
   std::vector<std::unique_ptr<Processor>> processors;
 };
 
+// A processor on the x64 backend, with code committed in [low, high) for the
+// modules a test adds, and a thread state to call them on.
+class TestProcessor {
+ public:
+  TestProcessor(uint32_t low, uint32_t high) {
+    memory_ = std::make_unique<Memory>();
+    memory_->Initialize();
+    processor_ = std::make_unique<Processor>(memory_.get(), nullptr);
+    processor_->Setup(std::make_unique<xe::cpu::backend::x64::X64Backend>());
+    processor_->backend()->CommitExecutableRange(low, high);
+    thread_state_ = std::make_unique<ThreadState>(processor_.get(), 0x100);
+  }
+
+  ~TestProcessor() {
+    thread_state_.reset();
+    processor_.reset();
+    memory_.reset();
+  }
+
+  Memory* memory() const { return memory_.get(); }
+  Processor* processor() const { return processor_.get(); }
+  ThreadState* thread_state() const { return thread_state_.get(); }
+
+  // Adds a module of the functions in [low, high), each compiled from what the
+  // generator emits when it's first resolved.
+  Module* AddModule(const std::string& name, uint32_t low, uint32_t high,
+                    std::function<void(hir::HIRBuilder& b)> generator) {
+    auto module = std::make_unique<xe::cpu::TestModule>(
+        processor_.get(), name,
+        [low, high](uint32_t address) {
+          return address >= low && address < high;
+        },
+        [generator](hir::HIRBuilder& b) {
+          generator(b);
+          return true;
+        });
+    Module* module_ptr = module.get();
+    processor_->AddModule(std::move(module));
+    return module_ptr;
+  }
+
+  // Calls the function with r3 set, returning the context after.
+  PPCContext* Call(Function* function, uint64_t r3 = 0) {
+    auto ctx = thread_state_->context();
+    ctx->r[3] = r3;
+    ctx->lr = 0xBCBCBCBC;
+    function->Call(thread_state_.get(), uint32_t(ctx->lr));
+    return ctx;
+  }
+
+ private:
+  std::unique_ptr<Memory> memory_;
+  std::unique_ptr<Processor> processor_;
+  std::unique_ptr<ThreadState> thread_state_;
+};
+
 inline hir::Value* LoadGPR(hir::HIRBuilder& b, int reg) {
   return b.LoadContext(offsetof(PPCContext, r) + reg * 8, hir::INT64_TYPE);
 }
@@ -0,0 +1,463 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2020 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+// Randomized checks of the x64 sequences that replaced calls into C helpers,
+// against scalar versions of those helpers. The variable shifts have separate
+// AVX2 and AVX paths, so those are run with both. POW2/LOG2 still call the
+// libm helpers and are checked for exactly their results.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <random>
+
+#include "xenia/base/math.h"
+#include "xenia/cpu/testing/util.h"
+
+#include "third_party/half/include/half.hpp"
+
+using namespace xe;
+using namespace xe::cpu;
+using namespace xe::cpu::hir;
+using namespace xe::cpu::testing;
+using xe::cpu::ppc::PPCContext;
+
+namespace {
+
+const int kFuzzIterations = 1000;
+
+vec128_t RandomVec128(std::mt19937& rng) {
+  vec128_t v;
+  for (size_t i = 0; i < 4; ++i) {
+    v.u32[i] = rng();
+  }
+  return v;
+}
+
+// Random floats with exponents around the half float range, sprinkled with
+// zeros, infinities and NaNs.
+vec128_t RandomHalfRangeVec128(std::mt19937& rng) {
+  static const uint32_t specials[] = {
+      0x00000000, 0x80000000, 0x7F800000, 0xFF800000, 0x7FC00000,
+      0x7F802000, 0x477FE000, 0x477FFFFF, 0x47800000, 0x38800000,
+      0x387FFFFF, 0x33800000, 0x337FFFFF, 0x00000001, 0x7F7FFFFF,
+  };
+  vec128_t v = RandomVec128(rng);
+  for (size_t i = 0; i < 4; ++i) {
+    switch (rng() % 4) {
+      case 0:
+        v.u32[i] = specials[rng() % xe::countof(specials)];
+        break;
+      case 1:
+      case 2:
+        v.u32[i] = (v.u32[i] & 0x807FFFFF) | (((rng() % 60) + 95) << 23);
+        break;
+      default:
+        break;
+    }
+  }
+  return v;
+}
+
+// Runs fn once with the AVX2/F16C/FMA paths enabled (where the host has
+// them) and once with plain AVX.
+void ForEachFeatureLevel(std::function<void()> fn) {
+  bool use_haswell_instructions = cvars::use_haswell_instructions;
+  for (bool haswell : {true, false}) {
+    cvars::use_haswell_instructions = haswell;
+    fn();
+  }
+  cvars::use_haswell_instructions = use_haswell_instructions;
+}
+
+template <typename T>
+vec128_t ShiftReference(const vec128_t& value, const vec128_t& shamt,
+                        Opcode opcode) {
+  T v[16 / sizeof(T)];
+  T s[16 / sizeof(T)];
+  std::memcpy(v, &value, sizeof(v));
+  std::memcpy(s, &shamt, sizeof(s));
+  for (size_t i = 0; i < xe::countof(v); ++i) {
+    auto n = s[i] & ((sizeof(T) * 8) - 1);
+    if (opcode == OPCODE_VECTOR_SHL) {
+      v[i] = T(v[i] << n);
+    } else {
+      v[i] = T(v[i] >> n);
+    }
+  }
+  vec128_t result;
+  std::memcpy(&result, v, sizeof(v));
+  return result;
+}
+
+template <typename T>
+void FuzzVectorShift(Opcode opcode, TypeName part_type) {
+  std::mt19937 rng(0x5EED0000 | opcode);
+  ForEachFeatureLevel([&]() {
+    TestFunction test([&](HIRBuilder& b) {
+      Value* value = LoadVR(b, 4);
+      Value* shamt = LoadVR(b, 5);
+      switch (opcode) {
+        case OPCODE_VECTOR_SHL:
+          StoreVR(b, 3, b.VectorShl(value, shamt, part_type));
+          break;
+        case OPCODE_VECTOR_SHR:
+          StoreVR(b, 3, b.VectorShr(value, shamt, part_type));
+          break;
+        default:
+          StoreVR(b, 3, b.VectorSha(value, shamt, part_type));
+          break;
+      }
+      b.Return();
+    });
+    for (int n = 0; n < kFuzzIterations; ++n) {
+      vec128_t value = RandomVec128(rng);
+      vec128_t shamt = RandomVec128(rng);
+      if (n & 1) {
+        // Mostly in-range counts, which exercise every blend step.
+        for (size_t i = 0; i < 16; ++i) {
+          shamt.u8[i] &= sizeof(T) * 8 - 1;
+        }
+      }
+      test.Run(
+          [&](PPCContext* ctx) {
+            ctx->v[4] = value;
+            ctx->v[5] = shamt;
+          },
+          [&](PPCContext* ctx) {
+            REQUIRE(ctx->v[3] == ShiftReference<T>(value, shamt, opcode));
+          });
+    }
+  });
+}
+
+vec128_t ShlV128Reference(vec128_t value, uint8_t shamt) {
+  shamt &= 0x7;
+  for (int i = 0; i < 15; ++i) {
+    value.u8[i ^ 0x3] = (value.u8[i ^ 0x3] << shamt) |
+                        (value.u8[(i + 1) ^ 0x3] >> (8 - shamt));
+  }
+  value.u8[15 ^ 0x3] = value.u8[15 ^ 0x3] << shamt;
+  return value;
+}
+
+vec128_t ShrV128Reference(vec128_t value, uint8_t shamt) {
+  shamt &= 0x7;
+  for (int i = 15; i > 0; --i) {
+    value.u8[i ^ 0x3] = (value.u8[i ^ 0x3] >> shamt) |
+                        (value.u8[(i - 1) ^ 0x3] << (8 - shamt));
+  }
+  value.u8[0 ^ 0x3] = value.u8[0 ^ 0x3] >> shamt;
+  return value;
+}
+
+}  // namespace
+
+TEST_CASE("VECTOR_SHL_FUZZ", "[instr]") {
+  FuzzVectorShift<uint8_t>(OPCODE_VECTOR_SHL, INT8_TYPE);
+  FuzzVectorShift<uint16_t>(OPCODE_VECTOR_SHL, INT16_TYPE);
+  FuzzVectorShift<uint32_t>(OPCODE_VECTOR_SHL, INT32_TYPE);
+}
+
+TEST_CASE("VECTOR_SHR_FUZZ", "[instr]") {
+  FuzzVectorShift<uint8_t>(OPCODE_VECTOR_SHR, INT8_TYPE);
+  FuzzVectorShift<uint16_t>(OPCODE_VECTOR_SHR, INT16_TYPE);
+  FuzzVectorShift<uint32_t>(OPCODE_VECTOR_SHR, INT32_TYPE);
+}
+
+TEST_CASE("VECTOR_SHA_FUZZ", "[instr]") {
+  FuzzVectorShift<int8_t>(OPCODE_VECTOR_SHA, INT8_TYPE);
+  FuzzVectorShift<int16_t>(OPCODE_VECTOR_SHA, INT16_TYPE);
+  FuzzVectorShift<int32_t>(OPCODE_VECTOR_SHA, INT32_TYPE);
+}
+
+TEST_CASE("SHL_SHR_V128_FUZZ", "[instr]") {
+  std::mt19937 rng(0x5EED0128);
+  TestFunction test([](HIRBuilder& b) {
+    Value* shamt = b.Truncate(LoadGPR(b, 4), INT8_TYPE);
+    StoreVR(b, 3, b.Shl(LoadVR(b, 5), shamt));
+    StoreVR(b, 4, b.Shr(LoadVR(b, 5), shamt));
+    b.Return();
+  });
+  for (int n = 0; n < kFuzzIterations; ++n) {
+    vec128_t value = RandomVec128(rng);
+    uint8_t shamt = uint8_t(rng());
+    test.Run(
+        [&](PPCContext* ctx) {
+          ctx->r[4] = shamt;
+          ctx->v[5] = value;
+        },
+        [&](PPCContext* ctx) {
+          REQUIRE(ctx->v[3] == ShlV128Reference(value, shamt));
+          REQUIRE(ctx->v[4] == ShrV128Reference(value, shamt));
+        });
+  }
+}
+
+TEST_CASE("PACK_8_IN_16_UN_UN_FUZZ", "[instr]") {
+  std::mt19937 rng(0x5EED0816);
+  TestFunction test([](HIRBuilder& b) {
+    StoreVR(b, 3,
+            b.Pack(LoadVR(b, 4), LoadVR(b, 5),
+                   PACK_TYPE_8_IN_16 | PACK_TYPE_IN_UNSIGNED |
+                       PACK_TYPE_OUT_UNSIGNED | PACK_TYPE_OUT_SATURATE));
+    StoreVR(b, 6,
+            b.Pack(LoadVR(b, 4), LoadVR(b, 5),
+                   PACK_TYPE_8_IN_16 | PACK_TYPE_IN_UNSIGNED |
+                       PACK_TYPE_OUT_UNSIGNED));
+    b.Return();
+  });
+  for (int n = 0; n < kFuzzIterations; ++n) {
+    vec128_t a = RandomVec128(rng);
+    vec128_t b = RandomVec128(rng);
+    if (n & 1) {
+      // Keep some words in byte range so saturation isn't the only outcome.
+      for (size_t i = 0; i < 8; ++i) {
+        a.u16[i] &= 0x01FF;
+        b.u16[i] &= 0x01FF;
+      }
+    }
+    vec128_t saturated, truncated;
+    for (size_t i = 0; i < 8; ++i) {
+      saturated.u8[i] = uint8_t(std::min(uint16_t(255), a.u16[i]));
+      saturated.u8[i + 8] = uint8_t(std::min(uint16_t(255), b.u16[i]));
+      truncated.u8[i] = a.u8[i * 2];
+      truncated.u8[i + 8] = b.u8[i * 2];
+    }
+    // Same guest word order fixup the sequence applies.
+    for (size_t i = 0; i < 8; i += 2) {
+      std::swap(saturated.u16[i], saturated.u16[i + 1]);
+      std::swap(truncated.u16[i], truncated.u16[i + 1]);
+    }
+    test.Run(
+        [&](PPCContext* ctx) {
+          ctx->v[4] = a;
+          ctx->v[5] = b;
+        },
+        [&](PPCContext* ctx) {
+          REQUIRE(ctx->v[3] == saturated);
+          REQUIRE(ctx->v[6] == truncated);
+        });
+  }
+}
+
+TEST_CASE("PACK_UNPACK_FLOAT16_FUZZ", "[instr]") {
+  // The F16C paths are the hardware's; check the fallback against the
+  // software conversion it replaced.
+  bool use_haswell_instructions = cvars::use_haswell_instructions;
+  cvars::use_haswell_instructions = false;
+  std::mt19937 rng(0x5EED0F16);
+  TestFunction test([](HIRBuilder& b) {
+    StoreVR(b, 3, b.Pack(LoadVR(b, 4), PACK_TYPE_FLOAT16_2));
+    StoreVR(b, 5, b.Pack(LoadVR(b, 4), PACK_TYPE_FLOAT16_4));
+    StoreVR(b, 6, b.Unpack(LoadVR(b, 7), PACK_TYPE_FLOAT16_2));
+    StoreVR(b, 8, b.Unpack(LoadVR(b, 7), PACK_TYPE_FLOAT16_4));
+    b.Return();
+  });
+  for (int n = 0; n < kFuzzIterations; ++n) {
+    vec128_t floats = RandomHalfRangeVec128(rng);
+    vec128_t halves = RandomVec128(rng);
+    vec128_t packed_2 = vec128i(0), packed_4 = vec128i(0);
+    for (int i = 0; i < 4; ++i) {
+      uint16_t half =
+          half_float::detail::float2half<std::round_toward_zero>(floats.f32[i]);
+      if (i < 2) {
+        packed_2.u16[7 - i] = half;
+      }
+      packed_4.u16[7 - (i ^ 2)] = half;
+    }
+    vec128_t unpacked_2 = vec128f(0.0f, 0.0f, 0.0f, 1.0f);
+    vec128_t unpacked_4;
+    for (int i = 0; i < 4; ++i) {
+      if (i < 2) {
+        unpacked_2.f32[i] =
+            half_float::detail::half2float(halves.u16[VEC128_W(6 + i)]);
+      }
+      unpacked_4.f32[i] =
+          half_float::detail::half2float(halves.u16[VEC128_W(4 + i)]);
+    }
+    test.Run(
+        [&](PPCContext* ctx) {
+          ctx->v[4] = floats;
+          ctx->v[7] = halves;
+        },
+        [&](PPCContext* ctx) {
+          REQUIRE(ctx->v[3] == packed_2);
+          REQUIRE(ctx->v[5] == packed_4);
+          REQUIRE(ctx->v[6] == unpacked_2);
+          REQUIRE(ctx->v[8] == unpacked_4);
+        });
+  }
+  cvars::use_haswell_instructions = use_haswell_instructions;
+}
+
+TEST_CASE("POW2_LOG2_V128_FUZZ", "[instr]") {
+  std::mt19937 rng(0x5EED0002);
+  TestFunction test([](HIRBuilder& b) {
+    StoreVR(b, 3, b.Pow2(LoadVR(b, 4)));
+    StoreVR(b, 5, b.Log2(LoadVR(b, 4)));
+    b.Return();
+  });
+  for (int n = 0; n < kFuzzIterations; ++n) {
+    vec128_t value = RandomVec128(rng);
+    if (n & 1) {
+      // Mostly inputs where exp2 is neither 0 nor infinity.
+      for (size_t i = 0; i < 4; ++i) {
+        value.f32[i] = std::ldexp(float(int32_t(value.u32[i])), -24);
+      }
+    }
+    vec128_t exp2, log2;
+    for (size_t i = 0; i < 4; ++i) {
+      exp2.f32[i] = std::exp2(value.f32[i]);
+      log2.f32[i] = std::log2(value.f32[i]);
+    }
+    test.Run([&](PPCContext* ctx) { ctx->v[4] = value; },
+             [&](PPCContext* ctx) {
+               REQUIRE(ctx->v[3] == exp2);
+               REQUIRE(ctx->v[5] == log2);
+             });
+  }
+}
+
+// Rough per-op cost of the sequences; run with "[.benchmark]" explicitly.
+// Each function chains the op so results depend on the previous one, and the
+// cost of an empty function is subtracted. As a baseline, each op is also
+// timed the way it was done before: a CallNativeSafe (here through a builtin)
+// into the scalar helper, with v3 carrying the chained value.
+TEST_CASE("VECTOR_EMULATION_BENCHMARK", "[.benchmark]") {
+  const int kChainLength = 1024;
+  const int kRuns = 1000;
+  struct Benchmark {
+    const char* name;
+    std::function<Value*(HIRBuilder& b, Value* v, Value* shamt)> op;
+    BuiltinFunction::Handler helper;
+  };
+  const Benchmark benchmarks[] = {
+      {"VECTOR_SHL_I8",
+       [](HIRBuilder& b, Value* v, Value* s) {
+         return b.VectorShl(v, s, INT8_TYPE);
+       },
+       [](PPCContext* ctx, void*, void*) {
+         ctx->v[3] =
+             ShiftReference<uint8_t>(ctx->v[3], ctx->v[5], OPCODE_VECTOR_SHL);
+       }},
+      {"VECTOR_SHA_I8",
+       [](HIRBuilder& b, Value* v, Value* s) {
+         return b.VectorSha(v, s, INT8_TYPE);
+       },
+       [](PPCContext* ctx, void*, void*) {
+         ctx->v[3] =
+             ShiftReference<int8_t>(ctx->v[3], ctx->v[5], OPCODE_VECTOR_SHA);
+       }},
+      {"VECTOR_SHL_I16",
+       [](HIRBuilder& b, Value* v, Value* s) {
+         return b.VectorShl(v, s, INT16_TYPE);
+       },
+       [](PPCContext* ctx, void*, void*) {
+         ctx->v[3] =
+             ShiftReference<uint16_t>(ctx->v[3], ctx->v[5], OPCODE_VECTOR_SHL);
+       }},
+      {"VECTOR_SHR_I32",
+       [](HIRBuilder& b, Value* v, Value* s) {
+         return b.VectorShr(v, s, INT32_TYPE);
+       },
+       [](PPCContext* ctx, void*, void*) {
+         ctx->v[3] =
+             ShiftReference<uint32_t>(ctx->v[3], ctx->v[5], OPCODE_VECTOR_SHR);
+       }},
+      {"SHL_V128",
+       [](HIRBuilder& b, Value* v, Value* s) {
+         return b.Shl(v, b.Truncate(b.Extract(s, 0, INT32_TYPE), INT8_TYPE));
+       },
+       [](PPCContext* ctx, void*, void*) {
+         ctx->v[3] = ShlV128Reference(ctx->v[3], uint8_t(ctx->v[5].u32[0]));
+       }},
+      {"PACK_FLOAT16_4",
+       [](HIRBuilder& b, Value* v, Value* s) {
+         return b.Pack(v, PACK_TYPE_FLOAT16_4);
+       },
+       [](PPCContext* ctx, void*, void*) {
+         vec128_t packed = vec128i(0);
+         for (int i = 0; i < 4; ++i) {
+           packed.u16[7 - (i ^ 2)] =
+               half_float::detail::float2half<std::round_toward_zero>(
+                   ctx->v[3].f32[i]);
+         }
+         ctx->v[3] = packed;
+       }},
+      {"UNPACK_FLOAT16_4",
+       [](HIRBuilder& b, Value* v, Value* s) {
+         return b.Unpack(v, PACK_TYPE_FLOAT16_4);
+       },
+       [](PPCContext* ctx, void*, void*) {
+         vec128_t unpacked;
+         for (int i = 0; i < 4; ++i) {
+           unpacked.f32[i] =
+               half_float::detail::half2float(ctx->v[3].u16[VEC128_W(4 + i)]);
+         }
+         ctx->v[3] = unpacked;
+       }},
+  };
+  auto time_runs = [&](TestFunction& test) {
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int n = 0; n < kRuns; ++n) {
+      test.Run(
+          [](PPCContext* ctx) {
+            ctx->v[4] = vec128f(1.5f);
+            ctx->v[5] =
+                vec128b(1, 2, 3, 4, 5, 6, 7, 0, 1, 2, 3, 4, 5, 6, 7, 0);
+          },
+          [](PPCContext* ctx) {});
+    }
+    auto elapsed = std::chrono::high_resolution_clock::now() - start;
+    return std::chrono::duration<double, std::nano>(elapsed).count();
+  };
+  ForEachFeatureLevel([&]() {
+    TestFunction empty([](HIRBuilder& b) {
+      StoreVR(b, 3, LoadVR(b, 4));
+      b.Return();
+    });
+    double overhead = time_runs(empty);
+    for (auto& benchmark : benchmarks) {
+      TestFunction test([&](HIRBuilder& b) {
+        Value* v = LoadVR(b, 4);
+        Value* shamt = LoadVR(b, 5);
+        for (int n = 0; n < kChainLength; ++n) {
+          v = benchmark.op(b, v, shamt);
+        }
+        StoreVR(b, 3, v);
+        b.Return();
+      });
+      double ns =
+          (time_runs(test) - overhead) / (double(kRuns) * kChainLength);
+
+      Function* helper = nullptr;
+      TestFunction baseline([&](HIRBuilder& b) {
+        StoreVR(b, 3, LoadVR(b, 4));
+        for (int n = 0; n < kChainLength; ++n) {
+          b.CallExtern(helper);
+        }
+        b.Return();
+      });
+      helper = baseline.processors[0]->DefineBuiltin(
+          benchmark.name, benchmark.helper, nullptr, nullptr);
+      double baseline_ns =
+          (time_runs(baseline) - overhead) / (double(kRuns) * kChainLength);
+
+      std::printf("%-20s %s %6.2f ns/op, %6.2f ns/op through the helper\n",
+                  benchmark.name,
+                  cvars::use_haswell_instructions ? "avx2" : "avx ", ns,
+                  baseline_ns);
+    }
+  });
+}
@@ -0,0 +1,155 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2020 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <thread>
+
+#include "xenia/base/clock.h"
+#include "xenia/cpu/testing/util.h"
+
+using namespace xe;
+using namespace xe::cpu;
+using namespace xe::cpu::hir;
+using namespace xe::cpu::testing;
+
+namespace {
+
+const uint32_t kFunctionAddress = 0x80000000;
+
+// Guest code compiled with --clock_virtual, counting instructions on the
+// virtual guest clock.
+class VirtualClockTest {
+ public:
+  VirtualClockTest(std::function<void(HIRBuilder& b)> generator)
+      : clock_virtual_(cvars::clock_virtual),
+        instructions_per_tick_(cvars::clock_virtual_instructions_per_tick),
+        guest_tick_frequency_(Clock::guest_tick_frequency()) {
+    cvars::clock_virtual = true;
+    cvars::clock_virtual_instructions_per_tick = 1;
+    Clock::set_guest_tick_frequency(50000000);
+    test_ = std::make_unique<TestProcessor>(kFunctionAddress,
+                                            kFunctionAddress + 0x1000);
+    test_->AddModule("VirtualClockTest", kFunctionAddress,
+                     kFunctionAddress + 4, generator);
+  }
+
+  ~VirtualClockTest() {
+    test_.reset();
+    Clock::set_guest_tick_frequency(guest_tick_frequency_);
+    cvars::clock_virtual_instructions_per_tick = instructions_per_tick_;
+    cvars::clock_virtual = clock_virtual_;
+  }
+
+  PPCContext* Call(uint64_t r3) {
+    return test_->Call(test_->processor()->ResolveFunction(kFunctionAddress),
+                       r3);
+  }
+
+ private:
+  bool clock_virtual_;
+  int32_t instructions_per_tick_;
+  uint64_t guest_tick_frequency_;
+  std::unique_ptr<TestProcessor> test_;
+};
+
+// Instructions are marked by source offsets, as the PPC frontend emits them.
+// Loops r3 times over 4 instructions after 2, then reads the clock into r5.
+void CountedLoop(HIRBuilder& b) {
+  uint32_t address = kFunctionAddress;
+  b.SourceOffset(address += 4);
+  b.SourceOffset(address += 4);
+  StoreGPR(b, 4, b.LoadZeroInt64());
+  auto loop = b.NewLabel();
+  b.MarkLabel(loop);
+  b.SourceOffset(address += 4);
+  b.SourceOffset(address += 4);
+  b.SourceOffset(address += 4);
+  b.SourceOffset(address += 4);
+  Value* count = b.Add(LoadGPR(b, 4), b.LoadConstantUint64(1));
+  StoreGPR(b, 4, count);
+  b.BranchTrue(b.CompareULT(count, LoadGPR(b, 3)), loop);
+  b.SourceOffset(address += 4);
+  StoreGPR(b, 5, b.LoadClock());
+  b.Return();
+}
+
+}  // namespace
+
+TEST_CASE("VIRTUAL_CLOCK_COUNTS_INSTRUCTIONS", "[virtual_clock]") {
+  VirtualClockTest test(CountedLoop);
+  for (uint64_t iterations : {1, 10, 1000}) {
+    Clock::ResetGuestVirtualTime();
+    auto ctx = test.Call(iterations);
+    REQUIRE(ctx->r[4] == iterations);
+    REQUIRE(ctx->r[5] == 2 + 4 * iterations + 1);
+    // Everything counted was added to the clock by reading it.
+    REQUIRE(ctx->virtual_clock_instructions == 0);
+    REQUIRE(Clock::QueryGuestTickCount() == ctx->r[5]);
+  }
+}
+
+TEST_CASE("VIRTUAL_CLOCK_REPRODUCIBLE", "[virtual_clock]") {
+  // The guest sees the same times on every run of the same work.
+  VirtualClockTest test(CountedLoop);
+  uint64_t times[2][3];
+  for (auto& run : times) {
+    Clock::ResetGuestVirtualTime();
+    Clock::set_guest_system_time_base(132223104000000000ull);
+    run[0] = test.Call(5000)->r[5];
+    Clock::SkipGuestIdle(10000);
+    run[1] = test.Call(100)->r[5];
+    run[2] = Clock::QueryGuestSystemTime();
+  }
+  REQUIRE(times[0][0] == times[1][0]);
+  REQUIRE(times[0][1] == times[1][1]);
+  REQUIRE(times[0][2] == times[1][2]);
+  // 1ms idle at 50MHz between the calls.
+  REQUIRE(times[0][1] - times[0][0] == 50000 + 2 + 4 * 100 + 1);
+}
+
+TEST_CASE("VIRTUAL_CLOCK_IDLE_SKIP", "[virtual_clock]") {
+  // A delay only skips ahead once every other guest thread is blocked too,
+  // and then only to its end.
+  VirtualClockTest test(CountedLoop);
+  Clock::ResetGuestVirtualTime();
+  Clock::AddGuestThread();
+  Clock::AddGuestThread();
+  std::atomic<bool> woken = {false};
+  uint64_t woken_time = 0;
+  std::thread sleeper([&]() {
+    Clock::SkipGuestIdle(10000);
+    woken_time = Clock::QueryGuestTickCount();
+    woken = true;
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  test.Call(100);
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  REQUIRE_FALSE(woken);
+  Clock::BeginGuestWait();
+  sleeper.join();
+  Clock::EndGuestWait();
+  // 1ms at 50MHz from when the delay began.
+  REQUIRE(woken_time == 50000);
+
+  // Threads still running wake it once they have run past its end.
+  sleeper = std::thread([&]() {
+    Clock::SkipGuestIdle(20);
+    woken_time = Clock::QueryGuestTickCount();
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  uint64_t start_time = Clock::QueryGuestTickCount();
+  test.Call(100);
+  sleeper.join();
+  REQUIRE(woken_time == start_time + 2 + 4 * 100 + 1);
+  Clock::RemoveGuestThread();
+  Clock::RemoveGuestThread();
+}
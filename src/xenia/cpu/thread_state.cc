@@ -53,14 +53,20 @@ ThreadState::ThreadState(Processor* processor, uint32_t thread_id,
   // Set initial registers.
   context_->r[1] = stack_base;
   context_->r[13] = pcr_address;
+  // Interrupts enabled.
+  context_->msr = 0x8000;
+  context_->reserved_version = UINT64_MAX;
+
+  processor_->AddThreadState(this);
 }
 
 ThreadState::~ThreadState() {
+  processor_->RemoveThreadState(this);
   if (backend_data_) {
     processor_->backend()->FreeThreadData(backend_data_);
   }
   if (thread_state_ == this) {
-    thread_state_ = nullptr;
+    Bind(nullptr);
   }
 
   memory::AlignedFree(context_);
@@ -68,10 +74,43 @@ ThreadState::~ThreadState() {
 
 void ThreadState::Bind(ThreadState* thread_state) {
   thread_state_ = thread_state;
+  // Safepoints in the guest code running on this thread poll the context.
+  threading::SetSafepointFlag(
+      thread_state ? &thread_state->context_->safepoint_pending : nullptr);
 }
 
 ThreadState* ThreadState::Get() { return thread_state_; }
 
+bool ThreadState::PauseGuestFrames() {
+  if (guest_frames_paused()) {
+    return false;
+  }
+  // Anything called from here is below this.
+  uint8_t stack_marker;
+  PauseGuestFrames(
+      {reinterpret_cast<uintptr_t>(&stack_marker), guest_frames_.high});
+  return true;
+}
+
+void ThreadState::PauseGuestFrames(GuestFrames frames) {
+  guest_frames_ = frames;
+  // Scans the frames now if there's retired code to free, as they can't be
+  // scanned while running.
+  processor_->OnGuestFramesPaused(this);
+  guest_frames_state_.store(GuestFramesState::kPaused,
+                            std::memory_order_release);
+}
+
+void ThreadState::ResumeGuestFrames() {
+  auto state = GuestFramesState::kPaused;
+  while (!guest_frames_state_.compare_exchange_weak(
+      state, GuestFramesState::kRunning, std::memory_order_acquire)) {
+    // Wait for a scan by another thread to finish.
+    state = GuestFramesState::kPaused;
+    xe::threading::MaybeYield();
+  }
+}
+
 uint32_t ThreadState::GetThreadID() {
   return thread_state_ ? thread_state_->thread_id_ : 0xFFFFFFFF;
 }
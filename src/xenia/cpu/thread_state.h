@@ -10,6 +10,8 @@
 #ifndef XENIA_CPU_THREAD_STATE_H_
 #define XENIA_CPU_THREAD_STATE_H_
 
+#include <atomic>
+#include <cstdint>
 #include <string>
 
 #include "xenia/cpu/ppc/ppc_context.h"
@@ -37,7 +39,43 @@ class ThreadState {
   static ThreadState* Get();
   static uint32_t GetThreadID();
 
+  // Guest code retired by the processor is only freed once no thread has it
+  // on its host stack. The guest frames of a thread lie between where host
+  // code first called into guest code and the stack pointer. Host code that
+  // may block with guest frames beneath it pauses them, so that other threads
+  // can scan them, and resumes them before returning to guest code. Both are
+  // called on the thread itself. Returns false if they already were paused, as
+  // they are outside guest code, in which case they aren't to be resumed.
+  bool PauseGuestFrames();
+  void ResumeGuestFrames();
+
  private:
+  friend class GuestFunction;
+  friend class Processor;
+
+  enum class GuestFramesState : uint32_t {
+    kRunning,
+    kPaused,
+    // Paused, and being scanned by another thread.
+    kScanning,
+  };
+
+  // Host stack range of the guest frames, fixed while paused. Empty when
+  // there are none.
+  struct GuestFrames {
+    uintptr_t low;
+    uintptr_t high;
+  };
+
+  // Used by GuestFunction::Call, which resumes the frames if they are paused
+  // (as they are outside guest code) and puts them back as they were after.
+  bool guest_frames_paused() const {
+    return guest_frames_state_.load(std::memory_order_relaxed) !=
+           GuestFramesState::kRunning;
+  }
+  GuestFrames guest_frames() const { return guest_frames_; }
+  void PauseGuestFrames(GuestFrames frames);
+
   Processor* processor_;
   Memory* memory_;
   void* backend_data_;
@@ -47,6 +85,36 @@ class ThreadState {
 
   // NOTE: must be 64b aligned for SSE ops.
   ppc::PPCContext* context_;
+
+  std::atomic<GuestFramesState> guest_frames_state_ = {
+      GuestFramesState::kPaused};
+  GuestFrames guest_frames_ = {0, 0};
+  // Code retired up to this processor epoch is known not to be on the stack.
+  // Only used by the processor, with its lock held.
+  uint64_t retired_code_epoch_ = 0;
+};
+
+// Pauses the guest frames of the calling thread, if it has a thread state, for
+// as long as it's in scope.
+class GuestFramesPause {
+ public:
+  GuestFramesPause() {
+    thread_state_ = ThreadState::Get();
+    if (thread_state_ && !thread_state_->PauseGuestFrames()) {
+      thread_state_ = nullptr;
+    }
+  }
+  ~GuestFramesPause() {
+    if (thread_state_) {
+      thread_state_->ResumeGuestFrames();
+    }
+  }
+
+  GuestFramesPause(const GuestFramesPause&) = delete;
+  GuestFramesPause& operator=(const GuestFramesPause&) = delete;
+
+ private:
+  ThreadState* thread_state_;
 };
 
 }  // namespace cpu
@@ -134,6 +134,15 @@ class XexModule : public xe::cpu::Module {
   uint32_t GetProcAddress(uint16_t ordinal) const;
   uint32_t GetProcAddress(const char* name) const;
 
+  // Rewrite the code of an import thunk declared as the function as loading
+  // does, to branch to the export of another module at export_address, or to
+  // call a kernel export through sc 2.
+  static void SetupUserImportThunk(Memory* memory, Function* thunk,
+                                   uint32_t export_address);
+  static void SetupKernelImportThunk(Memory* memory, GuestFunction* thunk,
+                                     GuestFunction::ExternHandler handler,
+                                     Export* kernel_export);
+
   int ApplyPatch(XexModule* module);
   bool Load(const std::string& name, const std::string& path,
             const void* xex_addr, size_t xex_length);
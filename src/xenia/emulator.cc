@@ -124,7 +124,13 @@ X_STATUS Emulator::Setup(
   // 360 uses a 50MHz clock.
   Clock::set_guest_tick_frequency(50000000);
   // We could reset this with save state data/constant value to help replays.
-  Clock::set_guest_system_time_base(Clock::QueryHostSystemTime());
+  if (cvars::clock_virtual) {
+    // Same time of day on every run too: 2020-01-01 00:00 UTC.
+    Clock::set_guest_system_time_base(132223104000000000ull);
+    Clock::ResetGuestVirtualTime();
+  } else {
+    Clock::set_guest_system_time_base(Clock::QueryHostSystemTime());
+  }
   // This can be adjusted dynamically, as well.
   Clock::set_guest_time_scalar(cvars::time_scalar);
 
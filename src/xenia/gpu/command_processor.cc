@@ -40,7 +40,11 @@ CommandProcessor::CommandProcessor(GraphicsSystem* graphics_system,
       trace_writer_(graphics_system->memory()->physical_membase()),
       worker_running_(true),
       write_ptr_index_event_(xe::threading::Event::CreateAutoResetEvent(false)),
-      write_ptr_index_(0) {}
+      write_ptr_index_(0) {
+  if (cvars::gpu_wait_reg_mem_watch) {
+    wait_reg_mem_watch_ = std::make_unique<WaitRegMemWatch>(memory_);
+  }
+}
 
 CommandProcessor::~CommandProcessor() = default;
 
@@ -83,6 +87,9 @@ void CommandProcessor::Shutdown() {
 
   worker_running_ = false;
   write_ptr_index_event_->Set();
+  if (wait_reg_mem_watch_) {
+    wait_reg_mem_watch_->Interrupt();
+  }
   worker_thread_->Wait(0, 0, 0, nullptr);
   worker_thread_.reset();
 }
@@ -858,13 +865,18 @@ bool CommandProcessor::ExecutePacketType3_WAIT_REG_MEM(RingBuffer* reader,
   uint32_t ref = reader->ReadAndSwap<uint32_t>();
   uint32_t mask = reader->ReadAndSwap<uint32_t>();
   uint32_t wait = reader->ReadAndSwap<uint32_t>();
+  auto endianness = Endian::kNone;
+  if (wait_info & 0x10) {
+    // The same every time the value is checked again.
+    endianness = static_cast<Endian>(poll_reg_addr & 0x3);
+    poll_reg_addr &= ~0x3;
+  }
   bool matched = false;
+  bool watching = false;
   do {
     uint32_t value;
     if (wait_info & 0x10) {
       // Memory.
-      auto endianness = static_cast<Endian>(poll_reg_addr & 0x3);
-      poll_reg_addr &= ~0x3;
       value = xe::load<uint32_t>(memory_->TranslatePhysical(poll_reg_addr));
       value = GpuSwap(value, endianness);
       trace_writer_.WriteMemoryRead(CpuToGpu(poll_reg_addr), 4);
@@ -906,10 +918,30 @@ bool CommandProcessor::ExecutePacketType3_WAIT_REG_MEM(RingBuffer* reader,
     if (!matched) {
       // Wait.
       if (wait >= 0x100) {
+        if (cvars::vsync && wait_reg_mem_watch_ && !watching) {
+          // Watch before checking again, so a write done in between isn't
+          // missed.
+          if (wait_info & 0x10) {
+            wait_reg_mem_watch_->WatchMemory(poll_reg_addr);
+          } else {
+            wait_reg_mem_watch_->WatchRegister(poll_reg_addr);
+          }
+          watching = true;
+          continue;
+        }
         PrepareForWait();
         if (!cvars::vsync) {
           // User wants it fast and dangerous.
           xe::threading::MaybeYield();
+        } else if (watching) {
+          // Sleep until the value may have changed. The timeout is only a
+          // fallback for writes that can't be watched, such as to read-only
+          // pages or by the host through the physical memory mapping.
+          if (wait_reg_mem_watch_->Wait(
+                  std::chrono::milliseconds(wait / 0x100))) {
+            // The watch is one-shot.
+            watching = false;
+          }
         } else {
           xe::threading::Sleep(std::chrono::milliseconds(wait / 0x100));
         }
@@ -918,6 +950,9 @@ bool CommandProcessor::ExecutePacketType3_WAIT_REG_MEM(RingBuffer* reader,
 
         if (!worker_running_) {
           // Short-circuited exit.
+          if (watching) {
+            wait_reg_mem_watch_->Unwatch();
+          }
           return false;
         }
       } else {
@@ -925,6 +960,9 @@ bool CommandProcessor::ExecutePacketType3_WAIT_REG_MEM(RingBuffer* reader,
       }
     }
   } while (!matched);
+  if (watching) {
+    wait_reg_mem_watch_->Unwatch();
+  }
 
   return true;
 }
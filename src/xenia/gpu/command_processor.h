@@ -23,6 +23,7 @@
 #include "xenia/base/threading.h"
 #include "xenia/gpu/register_file.h"
 #include "xenia/gpu/trace_writer.h"
+#include "xenia/gpu/wait_reg_mem_watch.h"
 #include "xenia/gpu/xenos.h"
 #include "xenia/kernel/xthread.h"
 #include "xenia/memory.h"
@@ -149,6 +150,14 @@ class CommandProcessor {
 
   void UpdateWritePointer(uint32_t value);
 
+  // Must be called after registers are written by the guest, to wake
+  // PM4_WAIT_REG_MEM waiting for them.
+  void NotifyRegisterWritten(uint32_t index) {
+    if (wait_reg_mem_watch_) {
+      wait_reg_mem_watch_->RegisterWritten(index);
+    }
+  }
+
   void ExecutePacket(uint32_t ptr, uint32_t count);
 
   bool is_paused() const { return paused_; }
@@ -291,6 +300,9 @@ class CommandProcessor {
   std::unique_ptr<xe::threading::Event> write_ptr_index_event_;
   std::atomic<uint32_t> write_ptr_index_;
 
+  // Null if PM4_WAIT_REG_MEM polls on a timer.
+  std::unique_ptr<WaitRegMemWatch> wait_reg_mem_watch_;
+
   uint64_t bin_select_ = 0xFFFFFFFFull;
   uint64_t bin_mask_ = 0xFFFFFFFFull;
 
@@ -0,0 +1,96 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2020 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include "xenia/gpu/constant_register_packer.h"
+
+#include <cstring>
+
+#include "xenia/base/math.h"
+
+namespace xe {
+namespace gpu {
+
+constexpr uint32_t ConstantRegisterPacker::kFloatConstantsOffset;
+constexpr uint32_t ConstantRegisterPacker::kBoolConstantsOffset;
+constexpr uint32_t ConstantRegisterPacker::kLoopConstantsOffset;
+constexpr uint32_t ConstantRegisterPacker::kSize;
+
+ConstantRegisterPacker::ConstantRegisterPacker(
+    const RegisterFile* register_file)
+    : register_file_(register_file) {}
+
+void ConstantRegisterPacker::RegisterWritten(uint32_t index) {
+  if (index >= XE_GPU_REG_SHADER_CONSTANT_000_X &&
+      index <= XE_GPU_REG_SHADER_CONSTANT_511_W) {
+    uint32_t float_constant_index =
+        (index - XE_GPU_REG_SHADER_CONSTANT_000_X) >> 2;
+    if (float_bitmap_[float_constant_index >> 6] &
+        (1ull << (float_constant_index & 63))) {
+      valid_ = false;
+    }
+  } else if (index >= XE_GPU_REG_SHADER_CONSTANT_BOOL_000_031 &&
+             index <= XE_GPU_REG_SHADER_CONSTANT_LOOP_31) {
+    // Always packed.
+    valid_ = false;
+  }
+}
+
+bool ConstantRegisterPacker::IsUpToDate(
+    const Shader::ConstantRegisterMap& vertex_map,
+    const Shader::ConstantRegisterMap& pixel_map) const {
+  if (!valid_) {
+    return false;
+  }
+  for (uint32_t i = 0; i < 4; ++i) {
+    if ((vertex_map.float_bitmap[i] & ~float_bitmap_[i]) ||
+        (pixel_map.float_bitmap[i] & ~float_bitmap_[4 + i])) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void ConstantRegisterPacker::Pack(const Shader::ConstantRegisterMap& vertex_map,
+                                  const Shader::ConstantRegisterMap& pixel_map,
+                                  uint8_t* dest) {
+  const RegisterFile::RegisterValue* values = register_file_->values;
+  for (uint32_t i = 0; i < 4; ++i) {
+    float_bitmap_[i] = vertex_map.float_bitmap[i];
+    float_bitmap_[4 + i] = pixel_map.float_bitmap[i];
+  }
+  // Copy contiguous ranges at once - often all constants of a shader are, and
+  // with dynamic addressing, all of them are used.
+  for (uint32_t i = 0; i < xe::countof(float_bitmap_); ++i) {
+    uint64_t bits = float_bitmap_[i];
+    while (bits) {
+      uint32_t first = xe::tzcnt(bits);
+      uint32_t count = xe::tzcnt(~(bits >> first));
+      uint32_t float_constant_index = i * 64 + first;
+      std::memcpy(dest + kFloatConstantsOffset + float_constant_index * 16,
+                  &values[XE_GPU_REG_SHADER_CONSTANT_000_X +
+                          float_constant_index * 4]
+                       .u32,
+                  count * 16);
+      if (first + count >= 64) {
+        break;
+      }
+      bits &= ~((uint64_t(1) << (first + count)) - 1);
+    }
+  }
+  std::memcpy(dest + kBoolConstantsOffset,
+              &values[XE_GPU_REG_SHADER_CONSTANT_BOOL_000_031].u32,
+              8 * sizeof(uint32_t));
+  std::memcpy(dest + kLoopConstantsOffset,
+              &values[XE_GPU_REG_SHADER_CONSTANT_LOOP_00].u32,
+              32 * sizeof(uint32_t));
+  valid_ = true;
+}
+
+}  // namespace gpu
+}  // namespace xe
@@ -0,0 +1,72 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2020 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#ifndef XENIA_GPU_CONSTANT_REGISTER_PACKER_H_
+#define XENIA_GPU_CONSTANT_REGISTER_PACKER_H_
+
+#include <cstdint>
+
+#include "xenia/gpu/register_file.h"
+#include "xenia/gpu/shader.h"
+
+namespace xe {
+namespace gpu {
+
+// Copies the constant registers used by a vertex/pixel shader pair to the
+// uniform buffer layout the translated shaders read them from, and tracks
+// whether the last copy can still be used by the next draw, so constants are
+// only uploaded when a shader starts reading different ones or one of the
+// copied registers is written.
+//
+// The layout is the whole constant register file, indexed the same way as the
+// registers (pixel shader float constants start at 256):
+// struct {
+//   vec4 float[512];
+//   uint bool[8];
+//   uint loop[32];
+// };
+// Only the float constants used by the shaders are written, the rest of the
+// float array is left undefined.
+class ConstantRegisterPacker {
+ public:
+  static constexpr uint32_t kFloatConstantsOffset = 0;
+  static constexpr uint32_t kBoolConstantsOffset = 512 * 4 * sizeof(float);
+  static constexpr uint32_t kLoopConstantsOffset =
+      kBoolConstantsOffset + 8 * sizeof(uint32_t);
+  static constexpr uint32_t kSize =
+      kLoopConstantsOffset + 32 * sizeof(uint32_t);
+
+  explicit ConstantRegisterPacker(const RegisterFile* register_file);
+
+  // Must be called for every write of a shader constant register.
+  void RegisterWritten(uint32_t index);
+  // Makes the next draw require an upload, for example, when the last copy
+  // isn't accessible anymore.
+  void Invalidate() { valid_ = false; }
+
+  // Whether the last packed constants contain up-to-date values of all the
+  // constants used by the shaders.
+  bool IsUpToDate(const Shader::ConstantRegisterMap& vertex_map,
+                  const Shader::ConstantRegisterMap& pixel_map) const;
+  // Writes the constants used by the shaders to dest, which must be kSize
+  // bytes, and starts tracking writes to them.
+  void Pack(const Shader::ConstantRegisterMap& vertex_map,
+            const Shader::ConstantRegisterMap& pixel_map, uint8_t* dest);
+
+ private:
+  const RegisterFile* register_file_;
+  // Float constants in the last packed data, vertex then pixel.
+  uint64_t float_bitmap_[512 / 64] = {};
+  bool valid_ = false;
+};
+
+}  // namespace gpu
+}  // namespace xe
+
+#endif  // XENIA_GPU_CONSTANT_REGISTER_PACKER_H_
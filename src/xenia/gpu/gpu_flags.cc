@@ -20,6 +20,12 @@ DEFINE_string(
 
 DEFINE_bool(vsync, true, "Enable VSYNC.", "GPU");
 
+DEFINE_bool(
+    gpu_wait_reg_mem_watch, true,
+    "Make the GPU sleep until the guest writes the awaited memory or register "
+    "when waiting for a CPU fence, instead of polling the value on a timer.",
+    "GPU");
+
 DEFINE_bool(
     gpu_allow_invalid_fetch_constants, false,
     "Allow texture and vertex fetch constants with invalid type - generally "
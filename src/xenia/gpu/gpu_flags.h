@@ -18,6 +18,8 @@ DECLARE_string(dump_shaders);
 
 DECLARE_bool(vsync);
 
+DECLARE_bool(gpu_wait_reg_mem_watch);
+
 DECLARE_bool(gpu_allow_invalid_fetch_constants);
 
 #endif  // XENIA_GPU_GPU_FLAGS_H_
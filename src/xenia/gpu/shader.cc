@@ -40,6 +40,16 @@ std::string Shader::GetTranslatedBinaryString() const {
   return result;
 }
 
+const std::string& Shader::ucode_disassembly() const {
+  std::lock_guard<std::mutex> lock(ucode_disassembly_mutex_);
+  if (ucode_disassembly_.empty() && parsed_ucode_) {
+    StringBuffer buffer;
+    parsed_ucode_->Disassemble(&buffer);
+    ucode_disassembly_ = buffer.to_string();
+  }
+  return ucode_disassembly_;
+}
+
 std::pair<std::string, std::string> Shader::Dump(const std::string& base_path,
                                                  const char* path_prefix) {
   // Ensure target path exists.
@@ -10,6 +10,9 @@
 #ifndef XENIA_GPU_SHADER_H_
 #define XENIA_GPU_SHADER_H_
 
+#include <memory>
+#include <mutex>
+#include <set>
 #include <string>
 #include <vector>
 
@@ -585,6 +588,70 @@ class Shader {
     uint32_t packed_byte_length;
   };
 
+  // Microcode decoded once into the parsed instructions in listing order,
+  // along with everything gathered about the shader before translation, so
+  // translating the shader again (for another host or with another register
+  // count or patch type) doesn't decode the microcode again. The result only
+  // depends on the microcode and the shader type.
+  struct ParsedUcode {
+    enum class EntryType : uint8_t {
+      // Target of a control flow instruction, before the instruction.
+      kLabel,
+      kControlFlowBegin,
+      kControlFlowEnd,
+      kControlFlowNop,
+      kExecBegin,
+      kExecEnd,
+      kLoopStart,
+      kLoopEnd,
+      kCall,
+      kReturn,
+      kJump,
+      kAlloc,
+      kVertexFetch,
+      kTextureFetch,
+      kAlu,
+    };
+    struct Entry {
+      EntryType type;
+      // Whether a fetch or ALU instruction is preceded by a serialize.
+      bool is_sync;
+      // Control flow index for labels and control flow instructions,
+      // instruction address for fetch and ALU instructions.
+      uint32_t address;
+      // Index in the list of parsed instructions of the entry type.
+      uint32_t index;
+    };
+
+    std::vector<Entry> entries;
+    std::vector<ucode::ControlFlowInstruction> cf_instructions;
+    std::vector<ParsedExecInstruction> exec_instructions;
+    std::vector<ParsedLoopStartInstruction> loop_start_instructions;
+    std::vector<ParsedLoopEndInstruction> loop_end_instructions;
+    std::vector<ParsedCallInstruction> call_instructions;
+    std::vector<ParsedReturnInstruction> return_instructions;
+    std::vector<ParsedJumpInstruction> jump_instructions;
+    std::vector<ParsedAllocInstruction> alloc_instructions;
+    std::vector<ParsedVertexFetchInstruction> vertex_fetch_instructions;
+    std::vector<ParsedTextureFetchInstruction> texture_fetch_instructions;
+    std::vector<ParsedAluInstruction> alu_instructions;
+
+    std::vector<VertexBinding> vertex_bindings;
+    std::vector<TextureBinding> texture_bindings;
+    ConstantRegisterMap constant_register_map = {0};
+    bool uses_register_dynamic_addressing = false;
+    bool writes_color_targets[4] = {false, false, false, false};
+    bool writes_depth = false;
+    bool implicit_early_z_allowed = true;
+    // Which `alloc export`s write to eA, and which eM# they write after that.
+    uint32_t memexport_eA_written = 0;
+    uint8_t memexport_eM_written[16] = {0};
+    std::set<uint32_t> memexport_stream_constants;
+
+    // Disassembles the whole shader into ucode assembly text.
+    void Disassemble(StringBuffer* out) const;
+  };
+
   Shader(ShaderType shader_type, uint64_t ucode_data_hash,
          const uint32_t* ucode_dwords, size_t ucode_dword_count);
   virtual ~Shader();
@@ -644,8 +711,13 @@ class Shader {
   // Errors that occurred during translation.
   const std::vector<Error>& errors() const { return errors_; }
 
-  // Microcode disassembly in D3D format.
-  const std::string& ucode_disassembly() const { return ucode_disassembly_; }
+  // Microcode decoded by the first translation, or nullptr if the shader
+  // hasn't been translated yet.
+  const ParsedUcode* parsed_ucode() const { return parsed_ucode_.get(); }
+
+  // Microcode disassembly in D3D format, generated from the parsed microcode
+  // the first time it's requested.
+  const std::string& ucode_disassembly() const;
 
   // Translated shader binary (or text).
   const std::vector<uint8_t>& translated_binary() const {
@@ -692,7 +764,9 @@ class Shader {
   bool is_translated_ = false;
   std::vector<Error> errors_;
 
-  std::string ucode_disassembly_;
+  std::unique_ptr<ParsedUcode> parsed_ucode_;
+  mutable std::mutex ucode_disassembly_mutex_;
+  mutable std::string ucode_disassembly_;
   std::vector<uint8_t> translated_binary_;
   std::string host_disassembly_;
   std::string host_error_log_;
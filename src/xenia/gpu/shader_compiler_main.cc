@@ -7,6 +7,7 @@
  ******************************************************************************
  */
 
+#include <chrono>
 #include <cinttypes>
 #include <cstring>
 #include <string>
@@ -43,6 +44,10 @@ DEFINE_string(shader_output_patch, "",
 DEFINE_bool(shader_output_dxbc_rov, false,
             "Output ROV-based output-merger code in DXBC pixel shaders.",
             "GPU");
+DEFINE_int32(shader_benchmark_iterations, 0,
+             "Translate the shader this many more times and log the average "
+             "time, decoding the microcode each time and reusing it.",
+             "GPU");
 
 namespace xe {
 namespace gpu {
@@ -125,6 +130,33 @@ int shader_compiler_main(const std::vector<std::wstring>& args) {
 
   translator->Translate(shader.get(), patch_primitive_type);
 
+  if (cvars::shader_benchmark_iterations > 0) {
+    uint32_t iterations = uint32_t(cvars::shader_benchmark_iterations);
+    auto time_translation = [&](bool reuse_parsed_ucode) {
+      auto start = std::chrono::high_resolution_clock::now();
+      for (uint32_t i = 0; i < iterations; ++i) {
+        std::unique_ptr<Shader> fresh_shader;
+        if (!reuse_parsed_ucode) {
+          fresh_shader = std::make_unique<Shader>(
+              shader_type, ucode_data_hash, ucode_dwords.data(),
+              ucode_dwords.size());
+        }
+        translator->Translate(
+            reuse_parsed_ucode ? shader.get() : fresh_shader.get(),
+            patch_primitive_type);
+      }
+      auto elapsed = std::chrono::high_resolution_clock::now() - start;
+      return std::chrono::duration<double, std::micro>(elapsed).count() /
+             iterations;
+    };
+    double parse_time = time_translation(false);
+    double reuse_time = time_translation(true);
+    XELOGI(
+        "Translated %u times: %.2f us with decoding, %.2f us reusing the "
+        "decoded microcode.",
+        iterations, parse_time, reuse_time);
+  }
+
   const void* source_data = shader->translated_binary().data();
   size_t source_data_size = shader->translated_binary().size();
 
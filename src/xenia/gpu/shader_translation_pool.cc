@@ -0,0 +1,144 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2020 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include "xenia/gpu/shader_translation_pool.h"
+
+#include <algorithm>
+
+#include "xenia/base/assert.h"
+
+namespace xe {
+namespace gpu {
+
+ShaderTranslationPool::ShaderTranslationPool(size_t thread_count,
+                                             TranslatorFactory factory,
+                                             PrepareFunction prepare,
+                                             const char* thread_name)
+    : factory_(std::move(factory)), prepare_(std::move(prepare)) {
+  assert_not_zero(thread_count);
+  for (size_t i = 0; i < thread_count; ++i) {
+    auto thread =
+        xe::threading::Thread::Create({}, [this]() { WorkerThread(); });
+    thread->set_name(thread_name);
+    threads_.push_back(std::move(thread));
+  }
+}
+
+ShaderTranslationPool::~ShaderTranslationPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    shutting_down_ = true;
+  }
+  request_cond_.notify_all();
+  for (auto& thread : threads_) {
+    xe::threading::Wait(thread.get(), false);
+  }
+  threads_.clear();
+}
+
+void ShaderTranslationPool::Request(Shader* shader,
+                                    reg::SQ_PROGRAM_CNTL cntl) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto& status = statuses_[shader];
+    if (status != Status::kNone) {
+      return;
+    }
+    status = Status::kQueued;
+    queue_.push_back({shader, cntl});
+  }
+  request_cond_.notify_one();
+}
+
+ShaderTranslationPool::Status ShaderTranslationPool::GetStatus(
+    Shader* shader) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = statuses_.find(shader);
+  return it != statuses_.end() ? it->second : Status::kNone;
+}
+
+bool ShaderTranslationPool::Await(Shader* shader) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  auto it = statuses_.find(shader);
+  if (it == statuses_.end()) {
+    assert_always("Awaiting a shader that wasn't requested");
+    return false;
+  }
+  // Unlike iterators, references to elements survive rehashing.
+  Status& status = it->second;
+  if (status == Status::kQueued) {
+    // Everything behind this draw is waiting for it, so don't let shaders
+    // requested earlier (likely prefetched for draws still far ahead) go first.
+    auto request_it = std::find_if(queue_.begin(), queue_.end(),
+                                   [shader](const TranslationRequest& request) {
+                                     return request.shader == shader;
+                                   });
+    assert_true(request_it != queue_.end());
+    TranslationRequest request = *request_it;
+    queue_.erase(request_it);
+    queue_.push_front(request);
+  }
+  completion_cond_.wait(lock, [&status]() {
+    return status == Status::kTranslated || status == Status::kFailed;
+  });
+  return status == Status::kTranslated;
+}
+
+void ShaderTranslationPool::AwaitAll() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  completion_cond_.wait(
+      lock, [this]() { return queue_.empty() && !busy_count_; });
+}
+
+void ShaderTranslationPool::Clear() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  queue_.clear();
+  completion_cond_.wait(lock, [this]() { return !busy_count_; });
+  statuses_.clear();
+}
+
+void ShaderTranslationPool::WorkerThread() {
+  std::unique_ptr<ShaderTranslator> translator = factory_();
+  while (true) {
+    TranslationRequest request;
+    Status* status;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      request_cond_.wait(
+          lock, [this]() { return shutting_down_ || !queue_.empty(); });
+      if (shutting_down_) {
+        return;
+      }
+      request = queue_.front();
+      queue_.pop_front();
+      // Only erased in Clear, which waits for busy workers, so the pointer
+      // stays valid.
+      status = &statuses_[request.shader];
+      *status = Status::kTranslating;
+      ++busy_count_;
+    }
+
+    bool translated = translator->Translate(
+                          request.shader, PrimitiveType::kNone, request.cntl) &&
+                      request.shader->is_valid();
+    if (translated && prepare_) {
+      translated = prepare_(request.shader);
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      *status = translated ? Status::kTranslated : Status::kFailed;
+      --busy_count_;
+    }
+    completion_cond_.notify_all();
+  }
+}
+
+}  // namespace gpu
+}  // namespace xe
@@ -0,0 +1,98 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2020 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#ifndef XENIA_GPU_SHADER_TRANSLATION_POOL_H_
+#define XENIA_GPU_SHADER_TRANSLATION_POOL_H_
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "xenia/base/threading.h"
+#include "xenia/gpu/registers.h"
+#include "xenia/gpu/shader.h"
+#include "xenia/gpu/shader_translator.h"
+
+namespace xe {
+namespace gpu {
+
+// Translates shaders on worker threads, so first-time translation doesn't
+// stall the thread that needs the shader. Each worker owns its translator, as
+// translators keep per-shader state.
+// All methods are meant to be called from one thread (the command processor),
+// which also owns the shaders.
+class ShaderTranslationPool {
+ public:
+  enum class Status {
+    // Never requested (or forgotten in Clear).
+    kNone,
+    kQueued,
+    kTranslating,
+    kTranslated,
+    kFailed,
+  };
+
+  using TranslatorFactory = std::function<std::unique_ptr<ShaderTranslator>()>;
+  // Called on the worker thread after successful translation, before the
+  // shader is reported as translated, to create host objects for it.
+  // Returns false to report the translation as failed.
+  using PrepareFunction = std::function<bool(Shader* shader)>;
+
+  ShaderTranslationPool(size_t thread_count, TranslatorFactory factory,
+                        PrepareFunction prepare, const char* thread_name);
+  ~ShaderTranslationPool();
+
+  size_t thread_count() const { return threads_.size(); }
+
+  // Queues the shader for translation with the given register configuration,
+  // unless it has been requested already.
+  void Request(Shader* shader, reg::SQ_PROGRAM_CNTL cntl);
+  Status GetStatus(Shader* shader);
+  // Waits until a requested shader is translated (moving it to the front of
+  // the queue if no worker has picked it up yet). Returns whether translation
+  // succeeded.
+  bool Await(Shader* shader);
+  // Waits until all requested shaders are translated.
+  void AwaitAll();
+  // Drops queued requests, waits for the ones in progress and forgets all
+  // shaders. Must be called before deleting requested shaders.
+  void Clear();
+
+ private:
+  struct TranslationRequest {
+    Shader* shader;
+    reg::SQ_PROGRAM_CNTL cntl;
+  };
+
+  void WorkerThread();
+
+  TranslatorFactory factory_;
+  PrepareFunction prepare_;
+
+  std::mutex mutex_;
+  // Notified when a request is queued or the workers need to shut down.
+  std::condition_variable request_cond_;
+  // Notified when a request is completed.
+  std::condition_variable completion_cond_;
+  std::deque<TranslationRequest> queue_;
+  std::unordered_map<Shader*, Status> statuses_;
+  size_t busy_count_ = 0;
+  bool shutting_down_ = false;
+
+  std::vector<std::unique_ptr<xe::threading::Thread>> threads_;
+};
+
+}  // namespace gpu
+}  // namespace xe
+
+#endif  // XENIA_GPU_SHADER_TRANSLATION_POOL_H_
@@ -50,58 +50,23 @@ ShaderTranslator::~ShaderTranslator() = default;
 
 void ShaderTranslator::Reset() {
   errors_.clear();
-  ucode_disasm_buffer_.Reset();
-  ucode_disasm_line_number_ = 0;
-  previous_ucode_disasm_scan_offset_ = 0;
   register_count_ = 64;
-  total_attrib_count_ = 0;
-  vertex_bindings_.clear();
-  unique_vertex_bindings_ = 0;
-  texture_bindings_.clear();
-  unique_texture_bindings_ = 0;
-  std::memset(&constant_register_map_, 0, sizeof(constant_register_map_));
-  uses_register_dynamic_addressing_ = false;
-  for (size_t i = 0; i < xe::countof(writes_color_targets_); ++i) {
-    writes_color_targets_[i] = false;
-  }
-  writes_depth_ = false;
-  implicit_early_z_allowed_ = true;
-  memexport_alloc_count_ = 0;
-  memexport_eA_written_ = 0;
-  std::memset(&memexport_eM_written_, 0, sizeof(memexport_eM_written_));
-  memexport_stream_constants_.clear();
+  ucode_ = nullptr;
 }
 
 bool ShaderTranslator::GatherAllBindingInformation(Shader* shader) {
   // DEPRECATED: remove this codepath when GL4 goes away.
   Reset();
 
-  shader_type_ = shader->type();
-  ucode_dwords_ = shader->ucode_dwords();
-  ucode_dword_count_ = shader->ucode_dword_count();
-
-  uint32_t max_cf_dword_index = static_cast<uint32_t>(ucode_dword_count_);
-  for (uint32_t i = 0; i < max_cf_dword_index; i += 3) {
-    ControlFlowInstruction cf_a;
-    ControlFlowInstruction cf_b;
-    UnpackControlFlowInstructions(ucode_dwords_ + i, &cf_a, &cf_b);
-    if (IsControlFlowOpcodeExec(cf_a.opcode())) {
-      max_cf_dword_index =
-          std::min(max_cf_dword_index, cf_a.exec.address() * 3);
-    }
-    if (IsControlFlowOpcodeExec(cf_b.opcode())) {
-      max_cf_dword_index =
-          std::min(max_cf_dword_index, cf_b.exec.address() * 3);
-    }
-
-    GatherInstructionInformation(cf_a);
-    GatherInstructionInformation(cf_b);
+  if (!shader->parsed_ucode_) {
+    ParseUcode(shader);
   }
+  ucode_ = shader->parsed_ucode_.get();
 
-  shader->vertex_bindings_ = std::move(vertex_bindings_);
-  shader->texture_bindings_ = std::move(texture_bindings_);
-  for (size_t i = 0; i < xe::countof(writes_color_targets_); ++i) {
-    shader->writes_color_targets_[i] = writes_color_targets_[i];
+  shader->vertex_bindings_ = ucode_->vertex_bindings;
+  shader->texture_bindings_ = ucode_->texture_bindings;
+  for (size_t i = 0; i < xe::countof(ucode_->writes_color_targets); ++i) {
+    shader->writes_color_targets_[i] = ucode_->writes_color_targets[i];
   }
 
   return true;
@@ -127,9 +92,58 @@ bool ShaderTranslator::TranslateInternal(Shader* shader,
   shader_type_ = shader->type();
   patch_primitive_type_ =
       shader_type_ == ShaderType::kVertex ? patch_type : PrimitiveType::kNone;
+
+  // The microcode is only decoded the first time the shader is translated.
+  if (!shader->parsed_ucode_) {
+    ParseUcode(shader);
+  }
+  ucode_ = shader->parsed_ucode_.get();
+
+  StartTranslation();
+
+  TranslateBlocks();
+
+  shader->errors_ = std::move(errors_);
+  shader->translated_binary_ = CompleteTranslation();
+  shader->patch_primitive_type_ = patch_primitive_type_;
+  shader->vertex_bindings_ = ucode_->vertex_bindings;
+  shader->texture_bindings_ = ucode_->texture_bindings;
+  shader->constant_register_map_ = ucode_->constant_register_map;
+  for (size_t i = 0; i < xe::countof(ucode_->writes_color_targets); ++i) {
+    shader->writes_color_targets_[i] = ucode_->writes_color_targets[i];
+  }
+  shader->writes_depth_ = ucode_->writes_depth;
+  shader->implicit_early_z_allowed_ = ucode_->implicit_early_z_allowed;
+  shader->memexport_stream_constants_.assign(
+      ucode_->memexport_stream_constants.begin(),
+      ucode_->memexport_stream_constants.end());
+
+  shader->is_valid_ = true;
+  shader->is_translated_ = true;
+  for (const auto& error : shader->errors_) {
+    if (error.is_fatal) {
+      shader->is_valid_ = false;
+      break;
+    }
+  }
+
+  PostTranslation(shader);
+
+  return shader->is_valid_;
+}
+
+void ShaderTranslator::ParseUcode(Shader* shader) {
+  shader_type_ = shader->type();
   ucode_dwords_ = shader->ucode_dwords();
   ucode_dword_count_ = shader->ucode_dword_count();
 
+  auto parsed_ucode = std::make_unique<Shader::ParsedUcode>();
+  ucode_ = parsed_ucode.get();
+  total_attrib_count_ = 0;
+  unique_vertex_bindings_ = 0;
+  unique_texture_bindings_ = 0;
+  memexport_alloc_count_ = 0;
+
   // Run through and gather all binding information and to check whether
   // registers are dynamically addressed.
   // Translators may need this before they start codegen.
@@ -151,101 +165,60 @@ bool ShaderTranslator::TranslateInternal(Shader* shader,
     GatherInstructionInformation(cf_b);
   }
   // Cleanup invalid/unneeded memexport allocs.
+  static_assert(
+      sizeof(Shader::ParsedUcode::memexport_eM_written) == kMaxMemExports,
+      "Parsed microcode must hold the eM# usage of all memexports");
   for (uint32_t i = 0; i < kMaxMemExports; ++i) {
-    if (!memexport_eM_written_[i]) {
-      memexport_eA_written_ &= ~(1u << i);
+    if (!ucode_->memexport_eM_written[i]) {
+      ucode_->memexport_eA_written &= ~(1u << i);
     }
   }
-  if (memexport_eA_written_ == 0) {
-    memexport_stream_constants_.clear();
+  if (ucode_->memexport_eA_written == 0) {
+    ucode_->memexport_stream_constants.clear();
   }
-  if (!memexport_stream_constants_.empty()) {
+  if (!ucode_->memexport_stream_constants.empty()) {
     // TODO(Triang3l): Investigate what happens to memexport when the pixel
     // fails the depth/stencil test, but in Direct3D 11 UAV writes disable early
     // depth/stencil.
-    implicit_early_z_allowed_ = false;
+    ucode_->implicit_early_z_allowed = false;
   }
 
-  StartTranslation();
-
-  TranslateBlocks();
+  ParseBlocks();
 
   // Compute total number of float registers and total bytes used by the
   // register map. This saves us work later when we need to pack them.
-  constant_register_map_.packed_byte_length = 0;
-  constant_register_map_.float_count = 0;
+  auto& constant_register_map = ucode_->constant_register_map;
+  constant_register_map.packed_byte_length = 0;
+  constant_register_map.float_count = 0;
   for (int i = 0; i < 4; ++i) {
     // Each bit indicates a vec4 (4 floats).
-    constant_register_map_.float_count +=
-        xe::bit_count(constant_register_map_.float_bitmap[i]);
+    constant_register_map.float_count +=
+        xe::bit_count(constant_register_map.float_bitmap[i]);
   }
-  constant_register_map_.packed_byte_length +=
-      4 * 4 * constant_register_map_.float_count;
+  constant_register_map.packed_byte_length +=
+      4 * 4 * constant_register_map.float_count;
   // Each bit indicates a single word.
-  constant_register_map_.packed_byte_length +=
-      4 * xe::bit_count(constant_register_map_.loop_bitmap);
+  constant_register_map.packed_byte_length +=
+      4 * xe::bit_count(constant_register_map.loop_bitmap);
   // Direct map between words and words we upload.
   for (int i = 0; i < 8; ++i) {
-    if (constant_register_map_.bool_bitmap[i]) {
-      constant_register_map_.packed_byte_length += 4;
-    }
-  }
-
-  shader->errors_ = std::move(errors_);
-  shader->translated_binary_ = CompleteTranslation();
-  shader->ucode_disassembly_ = ucode_disasm_buffer_.to_string();
-  shader->patch_primitive_type_ = patch_primitive_type_;
-  shader->vertex_bindings_ = std::move(vertex_bindings_);
-  shader->texture_bindings_ = std::move(texture_bindings_);
-  shader->constant_register_map_ = std::move(constant_register_map_);
-  for (size_t i = 0; i < xe::countof(writes_color_targets_); ++i) {
-    shader->writes_color_targets_[i] = writes_color_targets_[i];
-  }
-  shader->writes_depth_ = writes_depth_;
-  shader->implicit_early_z_allowed_ = implicit_early_z_allowed_;
-  shader->memexport_stream_constants_.clear();
-  for (uint32_t memexport_stream_constant : memexport_stream_constants_) {
-    shader->memexport_stream_constants_.push_back(memexport_stream_constant);
-  }
-
-  shader->is_valid_ = true;
-  shader->is_translated_ = true;
-  for (const auto& error : shader->errors_) {
-    if (error.is_fatal) {
-      shader->is_valid_ = false;
-      break;
-    }
-  }
-
-  PostTranslation(shader);
-
-  return shader->is_valid_;
-}
-
-void ShaderTranslator::MarkUcodeInstruction(uint32_t dword_offset) {
-  auto disasm = ucode_disasm_buffer_.GetString();
-  size_t current_offset = ucode_disasm_buffer_.length();
-  for (size_t i = previous_ucode_disasm_scan_offset_; i < current_offset; ++i) {
-    if (disasm[i] == '\n') {
-      ++ucode_disasm_line_number_;
+    if (constant_register_map.bool_bitmap[i]) {
+      constant_register_map.packed_byte_length += 4;
     }
   }
-  previous_ucode_disasm_scan_offset_ = current_offset;
-}
-
-void ShaderTranslator::AppendUcodeDisasm(char c) {
-  ucode_disasm_buffer_.Append(c);
-}
 
-void ShaderTranslator::AppendUcodeDisasm(const char* value) {
-  ucode_disasm_buffer_.Append(value);
+  shader->parsed_ucode_ = std::move(parsed_ucode);
 }
 
-void ShaderTranslator::AppendUcodeDisasmFormat(const char* format, ...) {
-  va_list va;
-  va_start(va, format);
-  ucode_disasm_buffer_.AppendVarargs(format, va);
-  va_end(va);
+void ShaderTranslator::AppendUcodeEntry(Shader::ParsedUcode::EntryType type,
+                                        uint32_t address, size_t index,
+                                        bool is_sync) {
+  Shader::ParsedUcode::Entry entry;
+  entry.type = type;
+  entry.is_sync = is_sync;
+  entry.address = address;
+  entry.index = uint32_t(index);
+  ucode_->entries.push_back(entry);
 }
 
 void ShaderTranslator::EmitTranslationError(const char* message) {
@@ -302,19 +275,20 @@ void ShaderTranslator::GatherInstructionInformation(
           if (op.has_vector_op()) {
             const auto& opcode_info =
                 alu_vector_opcode_infos_[static_cast<int>(op.vector_opcode())];
-            implicit_early_z_allowed_ &= !opcode_info.disable_implicit_early_z;
+            ucode_->implicit_early_z_allowed &=
+                !opcode_info.disable_implicit_early_z;
             for (size_t i = 0; i < opcode_info.argument_count; ++i) {
               if (op.src_is_temp(i + 1) && (op.src_reg(i + 1) & 0x40)) {
-                uses_register_dynamic_addressing_ = true;
+                ucode_->uses_register_dynamic_addressing = true;
               }
             }
             if (op.is_export()) {
               if (is_pixel_shader()) {
                 if (op.vector_dest() <= 3) {
-                  writes_color_targets_[op.vector_dest()] = true;
+                  ucode_->writes_color_targets[op.vector_dest()] = true;
                 } else if (op.vector_dest() == 61) {
-                  writes_depth_ = true;
-                  implicit_early_z_allowed_ = false;
+                  ucode_->writes_depth = true;
+                  ucode_->implicit_early_z_allowed = false;
                 }
               }
               if (memexport_alloc_count_ > 0 &&
@@ -333,50 +307,53 @@ void ShaderTranslator::GatherInstructionInformation(
                     op.vector_opcode() == AluVectorOpcode::kMad &&
                     op.vector_write_mask() == 0b1111 && !op.src_is_temp(3) &&
                     op.src_swizzle(3) == 0) {
-                  memexport_eA_written_ |= 1u << memexport_alloc_index;
-                  memexport_stream_constants_.insert(op.src_reg(3));
+                  ucode_->memexport_eA_written |= 1u << memexport_alloc_index;
+                  ucode_->memexport_stream_constants.insert(op.src_reg(3));
                 } else if (op.vector_dest() >= 33 && op.vector_dest() <= 37) {
-                  if (memexport_eA_written_ & (1u << memexport_alloc_index)) {
-                    memexport_eM_written_[memexport_alloc_index] |=
+                  if (ucode_->memexport_eA_written &
+                      (1u << memexport_alloc_index)) {
+                    ucode_->memexport_eM_written[memexport_alloc_index] |=
                         1 << (op.vector_dest() - 33);
                   }
                 }
               }
             } else {
               if (op.is_vector_dest_relative()) {
-                uses_register_dynamic_addressing_ = true;
+                ucode_->uses_register_dynamic_addressing = true;
               }
             }
           }
           if (op.has_scalar_op()) {
             const auto& opcode_info =
                 alu_scalar_opcode_infos_[static_cast<int>(op.scalar_opcode())];
-            implicit_early_z_allowed_ &= !opcode_info.disable_implicit_early_z;
+            ucode_->implicit_early_z_allowed &=
+                !opcode_info.disable_implicit_early_z;
             if (opcode_info.argument_count == 1 && op.src_is_temp(3) &&
                 (op.src_reg(3) & 0x40)) {
-              uses_register_dynamic_addressing_ = true;
+              ucode_->uses_register_dynamic_addressing = true;
             }
             if (op.is_export()) {
               if (is_pixel_shader()) {
                 if (op.scalar_dest() <= 3) {
-                  writes_color_targets_[op.scalar_dest()] = true;
+                  ucode_->writes_color_targets[op.scalar_dest()] = true;
                 } else if (op.scalar_dest() == 61) {
-                  writes_depth_ = true;
-                  implicit_early_z_allowed_ = false;
+                  ucode_->writes_depth = true;
+                  ucode_->implicit_early_z_allowed = false;
                 }
               }
               if (memexport_alloc_count_ > 0 &&
                   memexport_alloc_count_ <= kMaxMemExports &&
                   op.scalar_dest() >= 33 && op.scalar_dest() <= 37) {
                 uint32_t memexport_alloc_index = memexport_alloc_count_ - 1;
-                if (memexport_eA_written_ & (1u << memexport_alloc_index)) {
-                  memexport_eM_written_[memexport_alloc_index] |=
+                if (ucode_->memexport_eA_written &
+                    (1u << memexport_alloc_index)) {
+                  ucode_->memexport_eM_written[memexport_alloc_index] |=
                       1 << (op.scalar_dest() - 33);
                 }
               }
             } else {
               if (op.is_scalar_dest_relative()) {
-                uses_register_dynamic_addressing_ = true;
+                ucode_->uses_register_dynamic_addressing = true;
               }
             }
           }
@@ -405,14 +382,14 @@ void ShaderTranslator::GatherVertexFetchInformation(
 
   // Check if using dynamic register indices.
   if (op.is_dest_relative() || op.is_src_relative()) {
-    uses_register_dynamic_addressing_ = true;
+    ucode_->uses_register_dynamic_addressing = true;
   }
 
   // Try to allocate an attribute on an existing binding.
   // If no binding for this fetch slot is found create it.
   using VertexBinding = Shader::VertexBinding;
   VertexBinding::Attribute* attrib = nullptr;
-  for (auto& vertex_binding : vertex_bindings_) {
+  for (auto& vertex_binding : ucode_->vertex_bindings) {
     if (vertex_binding.fetch_constant == op.fetch_constant_index()) {
       // It may not hold that all strides are equal, but I hope it does.
       assert_true(!fetch_instr.attributes.stride ||
@@ -425,12 +402,12 @@ void ShaderTranslator::GatherVertexFetchInformation(
   if (!attrib) {
     assert_not_zero(fetch_instr.attributes.stride);
     VertexBinding vertex_binding;
-    vertex_binding.binding_index = int(vertex_bindings_.size());
+    vertex_binding.binding_index = int(ucode_->vertex_bindings.size());
     vertex_binding.fetch_constant = op.fetch_constant_index();
     vertex_binding.stride_words = fetch_instr.attributes.stride;
     vertex_binding.attributes.push_back({});
-    vertex_bindings_.emplace_back(std::move(vertex_binding));
-    attrib = &vertex_bindings_.back().attributes.back();
+    ucode_->vertex_bindings.emplace_back(std::move(vertex_binding));
+    attrib = &ucode_->vertex_bindings.back().attributes.back();
   }
 
   // Populate attribute.
@@ -444,7 +421,7 @@ void ShaderTranslator::GatherTextureFetchInformation(
     const TextureFetchInstruction& op) {
   // Check if using dynamic register indices.
   if (op.is_dest_relative() || op.is_src_relative()) {
-    uses_register_dynamic_addressing_ = true;
+    ucode_->uses_register_dynamic_addressing = true;
   }
 
   switch (op.opcode()) {
@@ -463,7 +440,7 @@ void ShaderTranslator::GatherTextureFetchInformation(
   binding.fetch_constant = binding.fetch_instr.operands[1].storage_index;
 
   // Check and see if this fetch constant was previously used...
-  for (auto& tex_binding : texture_bindings_) {
+  for (auto& tex_binding : ucode_->texture_bindings) {
     if (tex_binding.fetch_constant == binding.fetch_constant) {
       binding.binding_index = tex_binding.binding_index;
       break;
@@ -475,7 +452,7 @@ void ShaderTranslator::GatherTextureFetchInformation(
     binding.binding_index = unique_texture_bindings_++;
   }
 
-  texture_bindings_.emplace_back(std::move(binding));
+  ucode_->texture_bindings.emplace_back(std::move(binding));
 }
 
 void AddControlFlowTargetLabel(const ControlFlowInstruction& cf,
@@ -499,7 +476,7 @@ void AddControlFlowTargetLabel(const ControlFlowInstruction& cf,
   }
 }
 
-bool ShaderTranslator::TranslateBlocks() {
+void ShaderTranslator::ParseBlocks() {
   // Control flow instructions come paired in blocks of 3 dwords and all are
   // listed at the top of the ucode.
   // Each control flow instruction is executed sequentially until the final
@@ -510,7 +487,8 @@ bool ShaderTranslator::TranslateBlocks() {
   // This is what freedreno does.
   uint32_t max_cf_dword_index = static_cast<uint32_t>(ucode_dword_count_);
   std::set<uint32_t> label_addresses;
-  std::vector<ControlFlowInstruction> cf_instructions;
+  std::vector<ControlFlowInstruction>& cf_instructions =
+      ucode_->cf_instructions;
   for (uint32_t i = 0; i < max_cf_dword_index; i += 3) {
     ControlFlowInstruction cf_a;
     ControlFlowInstruction cf_b;
@@ -530,44 +508,84 @@ bool ShaderTranslator::TranslateBlocks() {
     cf_instructions.push_back(cf_b);
   }
 
-  PreProcessControlFlowInstructions(cf_instructions);
-
-  // Translate all instructions.
-  for (uint32_t i = 0, cf_index = 0; i < max_cf_dword_index; i += 3) {
-    ControlFlowInstruction cf_a;
-    ControlFlowInstruction cf_b;
-    UnpackControlFlowInstructions(ucode_dwords_ + i, &cf_a, &cf_b);
-
+  // Parse all instructions.
+  for (uint32_t cf_index = 0; cf_index < uint32_t(cf_instructions.size());
+       ++cf_index) {
     cf_index_ = cf_index;
-    MarkUcodeInstruction(i);
     if (label_addresses.count(cf_index)) {
-      AppendUcodeDisasmFormat("                label L%u\n", cf_index);
-      ProcessLabel(cf_index);
+      AppendUcodeEntry(Shader::ParsedUcode::EntryType::kLabel, cf_index, 0);
     }
-    AppendUcodeDisasmFormat("/* %4u.0 */ ", cf_index / 2);
-    ProcessControlFlowInstructionBegin(cf_index);
-    TranslateControlFlowInstruction(cf_a);
-    ProcessControlFlowInstructionEnd(cf_index);
-    ++cf_index;
+    AppendUcodeEntry(Shader::ParsedUcode::EntryType::kControlFlowBegin,
+                     cf_index, 0);
+    TranslateControlFlowInstruction(cf_instructions[cf_index]);
+    AppendUcodeEntry(Shader::ParsedUcode::EntryType::kControlFlowEnd, cf_index,
+                     0);
+  }
+}
 
-    cf_index_ = cf_index;
-    MarkUcodeInstruction(i);
-    if (label_addresses.count(cf_index)) {
-      AppendUcodeDisasmFormat("                label L%u\n", cf_index);
-      ProcessLabel(cf_index);
+void ShaderTranslator::TranslateBlocks() {
+  using EntryType = Shader::ParsedUcode::EntryType;
+
+  PreProcessControlFlowInstructions(ucode_->cf_instructions);
+
+  for (const Shader::ParsedUcode::Entry& entry : ucode_->entries) {
+    switch (entry.type) {
+      case EntryType::kLabel:
+        ProcessLabel(entry.address);
+        break;
+      case EntryType::kControlFlowBegin:
+        ProcessControlFlowInstructionBegin(entry.address);
+        break;
+      case EntryType::kControlFlowEnd:
+        ProcessControlFlowInstructionEnd(entry.address);
+        break;
+      case EntryType::kControlFlowNop:
+        ProcessControlFlowNopInstruction(entry.address);
+        break;
+      case EntryType::kExecBegin:
+        ProcessExecInstructionBegin(ucode_->exec_instructions[entry.index]);
+        break;
+      case EntryType::kExecEnd:
+        ProcessExecInstructionEnd(ucode_->exec_instructions[entry.index]);
+        break;
+      case EntryType::kLoopStart:
+        ProcessLoopStartInstruction(
+            ucode_->loop_start_instructions[entry.index]);
+        break;
+      case EntryType::kLoopEnd:
+        ProcessLoopEndInstruction(ucode_->loop_end_instructions[entry.index]);
+        break;
+      case EntryType::kCall:
+        ProcessCallInstruction(ucode_->call_instructions[entry.index]);
+        break;
+      case EntryType::kReturn:
+        ProcessReturnInstruction(ucode_->return_instructions[entry.index]);
+        break;
+      case EntryType::kJump:
+        ProcessJumpInstruction(ucode_->jump_instructions[entry.index]);
+        break;
+      case EntryType::kAlloc:
+        ProcessAllocInstruction(ucode_->alloc_instructions[entry.index]);
+        break;
+      case EntryType::kVertexFetch:
+        ProcessVertexFetchInstruction(
+            ucode_->vertex_fetch_instructions[entry.index]);
+        break;
+      case EntryType::kTextureFetch:
+        ProcessTextureFetchInstruction(
+            ucode_->texture_fetch_instructions[entry.index]);
+        break;
+      case EntryType::kAlu:
+        ProcessAluInstruction(ucode_->alu_instructions[entry.index]);
+        break;
     }
-    AppendUcodeDisasmFormat("/* %4u.1 */ ", cf_index / 2);
-    ProcessControlFlowInstructionBegin(cf_index);
-    TranslateControlFlowInstruction(cf_b);
-    ProcessControlFlowInstructionEnd(cf_index);
-    ++cf_index;
   }
-
-  return true;
 }
 
 std::vector<uint8_t> UcodeShaderTranslator::CompleteTranslation() {
-  return ucode_disasm_buffer().ToBytes();
+  StringBuffer ucode_disasm_buffer;
+  parsed_ucode().Disassemble(&ucode_disasm_buffer);
+  return ucode_disasm_buffer.ToBytes();
 }
 
 void ShaderTranslator::TranslateControlFlowInstruction(
@@ -632,9 +650,8 @@ void ShaderTranslator::TranslateControlFlowInstruction(
 
 void ShaderTranslator::TranslateControlFlowNop(
     const ControlFlowInstruction& cf) {
-  ucode_disasm_buffer_.Append("      cnop\n");
-
-  ProcessControlFlowNopInstruction(cf_index_);
+  AppendUcodeEntry(Shader::ParsedUcode::EntryType::kControlFlowNop, cf_index_,
+                   0);
 }
 
 void ShaderTranslator::TranslateControlFlowExec(
@@ -673,7 +690,7 @@ void ShaderTranslator::TranslateControlFlowCondExec(
   i.instruction_count = cf.count();
   i.type = ParsedExecInstruction::Type::kConditional;
   i.bool_constant_index = cf.bool_address();
-  constant_register_map_.bool_bitmap[i.bool_constant_index / 32] |=
+  ucode_->constant_register_map.bool_bitmap[i.bool_constant_index / 32] |=
       1 << (i.bool_constant_index % 32);
   i.condition = cf.condition();
   switch (cf.opcode()) {
@@ -714,13 +731,13 @@ void ShaderTranslator::TranslateControlFlowLoopStart(
   ParsedLoopStartInstruction i;
   i.dword_index = cf_index_;
   i.loop_constant_index = cf.loop_id();
-  constant_register_map_.loop_bitmap |= 1 << i.loop_constant_index;
+  ucode_->constant_register_map.loop_bitmap |= 1 << i.loop_constant_index;
   i.is_repeat = cf.is_repeat();
   i.loop_skip_address = cf.address();
 
-  i.Disassemble(&ucode_disasm_buffer_);
-
-  ProcessLoopStartInstruction(i);
+  AppendUcodeEntry(Shader::ParsedUcode::EntryType::kLoopStart, cf_index_,
+                   ucode_->loop_start_instructions.size());
+  ucode_->loop_start_instructions.push_back(i);
 }
 
 void ShaderTranslator::TranslateControlFlowLoopEnd(
@@ -730,12 +747,12 @@ void ShaderTranslator::TranslateControlFlowLoopEnd(
   i.is_predicated_break = cf.is_predicated_break();
   i.predicate_condition = cf.condition();
   i.loop_constant_index = cf.loop_id();
-  constant_register_map_.loop_bitmap |= 1 << i.loop_constant_index;
+  ucode_->constant_register_map.loop_bitmap |= 1 << i.loop_constant_index;
   i.loop_body_address = cf.address();
 
-  i.Disassemble(&ucode_disasm_buffer_);
-
-  ProcessLoopEndInstruction(i);
+  AppendUcodeEntry(Shader::ParsedUcode::EntryType::kLoopEnd, cf_index_,
+                   ucode_->loop_end_instructions.size());
+  ucode_->loop_end_instructions.push_back(i);
 }
 
 void ShaderTranslator::TranslateControlFlowCondCall(
@@ -751,14 +768,14 @@ void ShaderTranslator::TranslateControlFlowCondCall(
   } else {
     i.type = ParsedCallInstruction::Type::kConditional;
     i.bool_constant_index = cf.bool_address();
-    constant_register_map_.bool_bitmap[i.bool_constant_index / 32] |=
+    ucode_->constant_register_map.bool_bitmap[i.bool_constant_index / 32] |=
         1 << (i.bool_constant_index % 32);
     i.condition = cf.condition();
   }
 
-  i.Disassemble(&ucode_disasm_buffer_);
-
-  ProcessCallInstruction(i);
+  AppendUcodeEntry(Shader::ParsedUcode::EntryType::kCall, cf_index_,
+                   ucode_->call_instructions.size());
+  ucode_->call_instructions.push_back(i);
 }
 
 void ShaderTranslator::TranslateControlFlowReturn(
@@ -766,9 +783,9 @@ void ShaderTranslator::TranslateControlFlowReturn(
   ParsedReturnInstruction i;
   i.dword_index = cf_index_;
 
-  i.Disassemble(&ucode_disasm_buffer_);
-
-  ProcessReturnInstruction(i);
+  AppendUcodeEntry(Shader::ParsedUcode::EntryType::kReturn, cf_index_,
+                   ucode_->return_instructions.size());
+  ucode_->return_instructions.push_back(i);
 }
 
 void ShaderTranslator::TranslateControlFlowCondJmp(
@@ -784,14 +801,14 @@ void ShaderTranslator::TranslateControlFlowCondJmp(
   } else {
     i.type = ParsedJumpInstruction::Type::kConditional;
     i.bool_constant_index = cf.bool_address();
-    constant_register_map_.bool_bitmap[i.bool_constant_index / 32] |=
+    ucode_->constant_register_map.bool_bitmap[i.bool_constant_index / 32] |=
         1 << (i.bool_constant_index % 32);
     i.condition = cf.condition();
   }
 
-  i.Disassemble(&ucode_disasm_buffer_);
-
-  ProcessJumpInstruction(i);
+  AppendUcodeEntry(Shader::ParsedUcode::EntryType::kJump, cf_index_,
+                   ucode_->jump_instructions.size());
+  ucode_->jump_instructions.push_back(i);
 }
 
 void ShaderTranslator::TranslateControlFlowAlloc(
@@ -802,48 +819,45 @@ void ShaderTranslator::TranslateControlFlowAlloc(
   i.count = cf.size();
   i.is_vertex_shader = is_vertex_shader();
 
-  i.Disassemble(&ucode_disasm_buffer_);
-
-  ProcessAllocInstruction(i);
+  AppendUcodeEntry(Shader::ParsedUcode::EntryType::kAlloc, cf_index_,
+                   ucode_->alloc_instructions.size());
+  ucode_->alloc_instructions.push_back(i);
 }
 
 void ShaderTranslator::TranslateExecInstructions(
     const ParsedExecInstruction& instr) {
-  instr.Disassemble(&ucode_disasm_buffer_);
-
-  ProcessExecInstructionBegin(instr);
+  size_t exec_index = ucode_->exec_instructions.size();
+  ucode_->exec_instructions.push_back(instr);
+  AppendUcodeEntry(Shader::ParsedUcode::EntryType::kExecBegin, cf_index_,
+                   exec_index);
 
   uint32_t sequence = instr.sequence;
   for (uint32_t instr_offset = instr.instruction_address;
        instr_offset < instr.instruction_address + instr.instruction_count;
        ++instr_offset, sequence >>= 2) {
-    MarkUcodeInstruction(instr_offset);
-    AppendUcodeDisasmFormat("/* %4u   */ ", instr_offset);
     bool is_sync = (sequence & 0x2) == 0x2;
     bool is_fetch = (sequence & 0x1) == 0x1;
-    if (is_sync) {
-      AppendUcodeDisasm("         serialize\n             ");
-    }
     if (is_fetch) {
       auto fetch_opcode =
           static_cast<FetchOpcode>(ucode_dwords_[instr_offset * 3] & 0x1F);
       if (fetch_opcode == FetchOpcode::kVertexFetch) {
         auto& op = *reinterpret_cast<const VertexFetchInstruction*>(
             ucode_dwords_ + instr_offset * 3);
-        TranslateVertexFetchInstruction(op);
+        TranslateVertexFetchInstruction(op, instr_offset, is_sync);
       } else {
         auto& op = *reinterpret_cast<const TextureFetchInstruction*>(
             ucode_dwords_ + instr_offset * 3);
-        TranslateTextureFetchInstruction(op);
+        TranslateTextureFetchInstruction(op, instr_offset, is_sync);
       }
     } else {
       auto& op = *reinterpret_cast<const AluInstruction*>(ucode_dwords_ +
                                                           instr_offset * 3);
-      TranslateAluInstruction(op);
+      TranslateAluInstruction(op, instr_offset, is_sync);
     }
   }
 
-  ProcessExecInstructionEnd(instr);
+  AppendUcodeEntry(Shader::ParsedUcode::EntryType::kExecEnd, cf_index_,
+                   exec_index);
 }
 
 void ParseFetchInstructionResult(uint32_t dest, uint32_t swizzle,
@@ -874,11 +888,12 @@ void ParseFetchInstructionResult(uint32_t dest, uint32_t swizzle,
 }
 
 void ShaderTranslator::TranslateVertexFetchInstruction(
-    const VertexFetchInstruction& op) {
+    const VertexFetchInstruction& op, uint32_t address, bool is_sync) {
   ParsedVertexFetchInstruction instr;
   ParseVertexFetchInstruction(op, &instr);
-  instr.Disassemble(&ucode_disasm_buffer_);
-  ProcessVertexFetchInstruction(instr);
+  AppendUcodeEntry(Shader::ParsedUcode::EntryType::kVertexFetch, address,
+                   ucode_->vertex_fetch_instructions.size(), is_sync);
+  ucode_->vertex_fetch_instructions.push_back(instr);
 }
 
 void ShaderTranslator::ParseVertexFetchInstruction(
@@ -931,11 +946,12 @@ void ShaderTranslator::ParseVertexFetchInstruction(
 }
 
 void ShaderTranslator::TranslateTextureFetchInstruction(
-    const TextureFetchInstruction& op) {
+    const TextureFetchInstruction& op, uint32_t address, bool is_sync) {
   ParsedTextureFetchInstruction instr;
   ParseTextureFetchInstruction(op, &instr);
-  instr.Disassemble(&ucode_disasm_buffer_);
-  ProcessTextureFetchInstruction(instr);
+  AppendUcodeEntry(Shader::ParsedUcode::EntryType::kTextureFetch, address,
+                   ucode_->texture_fetch_instructions.size(), is_sync);
+  ucode_->texture_fetch_instructions.push_back(instr);
 }
 
 void ShaderTranslator::ParseTextureFetchInstruction(
@@ -1137,7 +1153,8 @@ const ShaderTranslator::AluOpcodeInfo
         {"retain_prev", 1, 1, false},  // 50
 };
 
-void ShaderTranslator::TranslateAluInstruction(const AluInstruction& op) {
+void ShaderTranslator::TranslateAluInstruction(const AluInstruction& op,
+                                               uint32_t address, bool is_sync) {
   ParsedAluInstruction instr;
 
   instr.dword_index = 0;
@@ -1148,9 +1165,9 @@ void ShaderTranslator::TranslateAluInstruction(const AluInstruction& op) {
   ParseAluVectorOperation(op, instr);
   ParseAluScalarOperation(op, instr);
 
-  instr.Disassemble(&ucode_disasm_buffer_);
-
-  ProcessAluInstruction(instr);
+  AppendUcodeEntry(Shader::ParsedUcode::EntryType::kAlu, address,
+                   ucode_->alu_instructions.size(), is_sync);
+  ucode_->alu_instructions.push_back(instr);
 }
 
 void ParseAluInstructionOperand(const AluInstruction& op, int i,
@@ -1393,11 +1410,11 @@ void ShaderTranslator::ParseAluVectorOperation(const AluInstruction& op,
       if (i.vector_operands[j].storage_addressing_mode !=
           InstructionStorageAddressingMode::kStatic) {
         // Dynamic addressing makes all constants required.
-        std::memset(constant_register_map_.float_bitmap, 0xFF,
-                    sizeof(constant_register_map_.float_bitmap));
+        std::memset(ucode_->constant_register_map.float_bitmap, 0xFF,
+                    sizeof(ucode_->constant_register_map.float_bitmap));
       } else {
         auto register_index = i.vector_operands[j].storage_index;
-        constant_register_map_.float_bitmap[register_index / 64] |=
+        ucode_->constant_register_map.float_bitmap[register_index / 64] |=
             1ull << (register_index % 64);
       }
     }
@@ -1545,10 +1562,10 @@ void ShaderTranslator::ParseAluScalarOperation(const AluInstruction& op,
     if (i.scalar_operands[0].storage_addressing_mode !=
         InstructionStorageAddressingMode::kStatic) {
       // Dynamic addressing makes all constants required.
-      std::memset(constant_register_map_.float_bitmap, 0xFF,
-                  sizeof(constant_register_map_.float_bitmap));
+      std::memset(ucode_->constant_register_map.float_bitmap, 0xFF,
+                  sizeof(ucode_->constant_register_map.float_bitmap));
     } else {
-      constant_register_map_.float_bitmap[register_index / 64] |=
+      ucode_->constant_register_map.float_bitmap[register_index / 64] |=
           1ull << (register_index % 64);
     }
   }
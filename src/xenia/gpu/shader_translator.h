@@ -52,37 +52,43 @@ class ShaderTranslator {
   PrimitiveType patch_primitive_type() const { return patch_primitive_type_; }
   // True if the current shader is a pixel shader.
   bool is_pixel_shader() const { return shader_type_ == ShaderType::kPixel; }
+  // Microcode of the current shader, parsed before translation.
+  const Shader::ParsedUcode& parsed_ucode() const { return *ucode_; }
   const Shader::ConstantRegisterMap& constant_register_map() const {
-    return constant_register_map_;
+    return ucode_->constant_register_map;
   }
   // True if the current shader addresses general-purpose registers with dynamic
   // indices.
   bool uses_register_dynamic_addressing() const {
-    return uses_register_dynamic_addressing_;
+    return ucode_->uses_register_dynamic_addressing;
   }
   // True if the current shader writes to a color target on any execution path.
-  bool writes_color_target(int i) const { return writes_color_targets_[i]; }
+  bool writes_color_target(int i) const {
+    return ucode_->writes_color_targets[i];
+  }
   bool writes_any_color_target() const {
-    for (size_t i = 0; i < xe::countof(writes_color_targets_); ++i) {
-      if (writes_color_targets_[i]) {
+    for (size_t i = 0; i < xe::countof(ucode_->writes_color_targets); ++i) {
+      if (ucode_->writes_color_targets[i]) {
         return true;
       }
     }
     return false;
   }
   // True if the current shader overrides the pixel depth.
-  bool writes_depth() const { return writes_depth_; }
+  bool writes_depth() const { return ucode_->writes_depth; }
   // True if Xenia can automatically enable early depth/stencil for the pixel
   // shader when RB_DEPTHCONTROL EARLY_Z_ENABLE is not set, provided alpha
   // testing and alpha to coverage are disabled.
-  bool implicit_early_z_allowed() const { return implicit_early_z_allowed_; }
+  bool implicit_early_z_allowed() const {
+    return ucode_->implicit_early_z_allowed;
+  }
   // A list of all vertex bindings, populated before translation occurs.
   const std::vector<Shader::VertexBinding>& vertex_bindings() const {
-    return vertex_bindings_;
+    return ucode_->vertex_bindings;
   }
   // A list of all texture bindings, populated before translation occurs.
   const std::vector<Shader::TextureBinding>& texture_bindings() const {
-    return texture_bindings_;
+    return ucode_->texture_bindings;
   }
 
   // Based on the number of AS_VS/PS_EXPORT_STREAM_* enum sets found in a game
@@ -92,17 +98,15 @@ class ShaderTranslator {
   // `alloc export`, for up to kMaxMemExports exports. This will contain zero
   // for certain corrupt exports - that don't write to eA before writing to eM#,
   // or if the write was done any way other than MAD with a stream constant.
-  const uint8_t* memexport_eM_written() const { return memexport_eM_written_; }
+  const uint8_t* memexport_eM_written() const {
+    return ucode_->memexport_eM_written;
+  }
   // All c# registers used as the addend in MAD operations to eA, populated
   // before translation occurs.
   const std::set<uint32_t>& memexport_stream_constants() const {
-    return memexport_stream_constants_;
+    return ucode_->memexport_stream_constants;
   }
 
-  // Current line number in the ucode disassembly.
-  size_t ucode_disasm_line_number() const { return ucode_disasm_line_number_; }
-  // Ucode disassembly buffer accumulated during translation.
-  StringBuffer& ucode_disasm_buffer() { return ucode_disasm_buffer_; }
   // Emits a translation error that will be passed back in the result.
   virtual void EmitTranslationError(const char* message);
   // Emits a translation error indicating that the current translation is not
@@ -183,12 +187,14 @@ class ShaderTranslator {
 
   bool TranslateInternal(Shader* shader, PrimitiveType patch_type);
 
-  void MarkUcodeInstruction(uint32_t dword_offset);
-  void AppendUcodeDisasm(char c);
-  void AppendUcodeDisasm(const char* value);
-  void AppendUcodeDisasmFormat(const char* format, ...);
+  // Decodes the microcode of the shader into its parsed microcode.
+  void ParseUcode(Shader* shader);
+  void ParseBlocks();
+  void AppendUcodeEntry(Shader::ParsedUcode::EntryType type, uint32_t address,
+                        size_t index, bool is_sync = false);
 
-  bool TranslateBlocks();
+  // Passes the parsed microcode to the translator implementation.
+  void TranslateBlocks();
   void GatherInstructionInformation(const ucode::ControlFlowInstruction& cf);
   void GatherVertexFetchInformation(const ucode::VertexFetchInstruction& op);
   void GatherTextureFetchInformation(const ucode::TextureFetchInstruction& op);
@@ -213,16 +219,19 @@ class ShaderTranslator {
 
   void TranslateExecInstructions(const ParsedExecInstruction& instr);
 
-  void TranslateVertexFetchInstruction(const ucode::VertexFetchInstruction& op);
+  void TranslateVertexFetchInstruction(const ucode::VertexFetchInstruction& op,
+                                       uint32_t address, bool is_sync);
   void ParseVertexFetchInstruction(const ucode::VertexFetchInstruction& op,
                                    ParsedVertexFetchInstruction* out_instr);
 
   void TranslateTextureFetchInstruction(
-      const ucode::TextureFetchInstruction& op);
+      const ucode::TextureFetchInstruction& op, uint32_t address,
+      bool is_sync);
   void ParseTextureFetchInstruction(const ucode::TextureFetchInstruction& op,
                                     ParsedTextureFetchInstruction* out_instr);
 
-  void TranslateAluInstruction(const ucode::AluInstruction& op);
+  void TranslateAluInstruction(const ucode::AluInstruction& op,
+                               uint32_t address, bool is_sync);
   void ParseAluVectorOperation(const ucode::AluInstruction& op,
                                ParsedAluInstruction& instr);
   void ParseAluScalarOperation(const ucode::AluInstruction& op,
@@ -239,38 +248,20 @@ class ShaderTranslator {
   // Accumulated translation errors.
   std::vector<Shader::Error> errors_;
 
+  // Parsed microcode of the current shader.
+  Shader::ParsedUcode* ucode_ = nullptr;
+
   // Current control flow dword index.
   uint32_t cf_index_ = 0;
 
-  // Microcode disassembly buffer, accumulated throughout the translation.
-  StringBuffer ucode_disasm_buffer_;
-  // Current line number in the disasm, which can be used for source annotation.
-  size_t ucode_disasm_line_number_ = 0;
-  // Last offset used when scanning for line numbers.
-  size_t previous_ucode_disasm_scan_offset_ = 0;
-
   // Kept for supporting vfetch_mini.
   ucode::VertexFetchInstruction previous_vfetch_full_;
 
-  // Detected binding information gathered before translation.
+  // State for gathering the binding information while parsing.
   int total_attrib_count_ = 0;
-  std::vector<Shader::VertexBinding> vertex_bindings_;
-  std::vector<Shader::TextureBinding> texture_bindings_;
   uint32_t unique_vertex_bindings_ = 0;
   uint32_t unique_texture_bindings_ = 0;
-
-  Shader::ConstantRegisterMap constant_register_map_ = {0};
-  bool uses_register_dynamic_addressing_ = false;
-  bool writes_color_targets_[4] = {false, false, false, false};
-  bool writes_depth_ = false;
-  bool implicit_early_z_allowed_ = true;
-
   uint32_t memexport_alloc_count_ = 0;
-  // For register allocation in implementations - what was used after each
-  // `alloc export`.
-  uint32_t memexport_eA_written_ = 0;
-  uint8_t memexport_eM_written_[kMaxMemExports] = {0};
-  std::set<uint32_t> memexport_stream_constants_;
 
   static const AluOpcodeInfo alu_vector_opcode_infos_[0x20];
   static const AluOpcodeInfo alu_scalar_opcode_infos_[0x40];
@@ -498,5 +498,62 @@ void ParsedAluInstruction::Disassemble(StringBuffer* out) const {
   }
 }
 
+void Shader::ParsedUcode::Disassemble(StringBuffer* out) const {
+  for (const Entry& entry : entries) {
+    switch (entry.type) {
+      case EntryType::kLabel:
+        out->AppendFormat("                label L%u\n", entry.address);
+        break;
+      case EntryType::kControlFlowBegin:
+        out->AppendFormat("/* %4u.%u */ ", entry.address / 2,
+                          entry.address & 1);
+        break;
+      case EntryType::kControlFlowEnd:
+        break;
+      case EntryType::kControlFlowNop:
+        out->Append("      cnop\n");
+        break;
+      case EntryType::kExecBegin:
+        exec_instructions[entry.index].Disassemble(out);
+        break;
+      case EntryType::kExecEnd:
+        break;
+      case EntryType::kLoopStart:
+        loop_start_instructions[entry.index].Disassemble(out);
+        break;
+      case EntryType::kLoopEnd:
+        loop_end_instructions[entry.index].Disassemble(out);
+        break;
+      case EntryType::kCall:
+        call_instructions[entry.index].Disassemble(out);
+        break;
+      case EntryType::kReturn:
+        return_instructions[entry.index].Disassemble(out);
+        break;
+      case EntryType::kJump:
+        jump_instructions[entry.index].Disassemble(out);
+        break;
+      case EntryType::kAlloc:
+        alloc_instructions[entry.index].Disassemble(out);
+        break;
+      case EntryType::kVertexFetch:
+      case EntryType::kTextureFetch:
+      case EntryType::kAlu:
+        out->AppendFormat("/* %4u   */ ", entry.address);
+        if (entry.is_sync) {
+          out->Append("         serialize\n             ");
+        }
+        if (entry.type == EntryType::kVertexFetch) {
+          vertex_fetch_instructions[entry.index].Disassemble(out);
+        } else if (entry.type == EntryType::kTextureFetch) {
+          texture_fetch_instructions[entry.index].Disassemble(out);
+        } else {
+          alu_instructions[entry.index].Disassemble(out);
+        }
+        break;
+    }
+  }
+}
+
 }  // namespace gpu
 }  // namespace xe
@@ -0,0 +1,242 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2020 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include "xenia/gpu/constant_register_packer.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include "third_party/catch/include/catch.hpp"
+
+namespace xe {
+namespace gpu {
+namespace test {
+
+using Packer = ConstantRegisterPacker;
+
+const uint8_t kUnwritten = 0xCD;
+
+Shader::ConstantRegisterMap MakeMap() {
+  Shader::ConstantRegisterMap map;
+  std::memset(&map, 0, sizeof(map));
+  return map;
+}
+
+void UseFloat(Shader::ConstantRegisterMap& map, uint32_t index) {
+  map.float_bitmap[index >> 6] |= uint64_t(1) << (index & 63);
+}
+
+void FillRegisters(RegisterFile& register_file) {
+  for (uint32_t i = XE_GPU_REG_SHADER_CONSTANT_000_X;
+       i <= XE_GPU_REG_SHADER_CONSTANT_LOOP_31; ++i) {
+    register_file.values[i].u32 = 0x10000000 | i;
+  }
+}
+
+uint32_t PackedFloatX(const std::vector<uint8_t>& packed, uint32_t index) {
+  uint32_t value;
+  std::memcpy(&value, &packed[Packer::kFloatConstantsOffset + index * 16],
+              sizeof(value));
+  return value;
+}
+
+bool IsFloatWritten(const std::vector<uint8_t>& packed, uint32_t index) {
+  for (uint32_t i = 0; i < 16; ++i) {
+    if (packed[Packer::kFloatConstantsOffset + index * 16 + i] !=
+        kUnwritten) {
+      return true;
+    }
+  }
+  return false;
+}
+
+TEST_CASE("CONSTANT_REGISTER_PACKER_PLACEMENT", "[gpu]") {
+  auto register_file = std::make_unique<RegisterFile>();
+  FillRegisters(*register_file);
+  Packer packer(register_file.get());
+
+  auto vertex_map = MakeMap();
+  UseFloat(vertex_map, 0);
+  UseFloat(vertex_map, 62);
+  UseFloat(vertex_map, 63);
+  UseFloat(vertex_map, 64);
+  UseFloat(vertex_map, 255);
+  auto pixel_map = MakeMap();
+  UseFloat(pixel_map, 5);
+
+  std::vector<uint8_t> packed(Packer::kSize, kUnwritten);
+  packer.Pack(vertex_map, pixel_map, packed.data());
+
+  for (uint32_t i : {0u, 62u, 63u, 64u, 255u}) {
+    REQUIRE(PackedFloatX(packed, i) ==
+            (0x10000000 | (XE_GPU_REG_SHADER_CONSTANT_000_X + i * 4)));
+  }
+  REQUIRE(PackedFloatX(packed, 256 + 5) ==
+          (0x10000000 | (XE_GPU_REG_SHADER_CONSTANT_000_X + (256 + 5) * 4)));
+  // All four components are copied.
+  uint32_t w;
+  std::memcpy(&w, &packed[Packer::kFloatConstantsOffset + 62 * 16 + 12],
+              sizeof(w));
+  REQUIRE(w == (0x10000000 | (XE_GPU_REG_SHADER_CONSTANT_000_X + 62 * 4 + 3)));
+  // Unused constants are skipped.
+  REQUIRE_FALSE(IsFloatWritten(packed, 1));
+  REQUIRE_FALSE(IsFloatWritten(packed, 61));
+  REQUIRE_FALSE(IsFloatWritten(packed, 65));
+  REQUIRE_FALSE(IsFloatWritten(packed, 256));
+  REQUIRE_FALSE(IsFloatWritten(packed, 256 + 255));
+
+  // Bool and loop constants are always copied.
+  for (uint32_t i = 0; i < 8; ++i) {
+    uint32_t value;
+    std::memcpy(&value, &packed[Packer::kBoolConstantsOffset + i * 4],
+                sizeof(value));
+    REQUIRE(value ==
+            (0x10000000 | (XE_GPU_REG_SHADER_CONSTANT_BOOL_000_031 + i)));
+  }
+  for (uint32_t i = 0; i < 32; ++i) {
+    uint32_t value;
+    std::memcpy(&value, &packed[Packer::kLoopConstantsOffset + i * 4],
+                sizeof(value));
+    REQUIRE(value == (0x10000000 | (XE_GPU_REG_SHADER_CONSTANT_LOOP_00 + i)));
+  }
+}
+
+TEST_CASE("CONSTANT_REGISTER_PACKER_DYNAMIC_ADDRESSING", "[gpu]") {
+  auto register_file = std::make_unique<RegisterFile>();
+  FillRegisters(*register_file);
+  Packer packer(register_file.get());
+
+  // Shaders with dynamic addressing are marked as using all constants.
+  auto map = MakeMap();
+  std::memset(map.float_bitmap, 0xFF, sizeof(map.float_bitmap));
+  std::vector<uint8_t> packed(Packer::kSize, kUnwritten);
+  packer.Pack(map, map, packed.data());
+  REQUIRE(std::memcmp(packed.data() + Packer::kFloatConstantsOffset,
+                      &register_file->values[XE_GPU_REG_SHADER_CONSTANT_000_X],
+                      512 * 16) == 0);
+}
+
+TEST_CASE("CONSTANT_REGISTER_PACKER_UP_TO_DATE", "[gpu]") {
+  auto register_file = std::make_unique<RegisterFile>();
+  FillRegisters(*register_file);
+  Packer packer(register_file.get());
+  std::vector<uint8_t> packed(Packer::kSize);
+
+  auto vertex_map = MakeMap();
+  UseFloat(vertex_map, 3);
+  UseFloat(vertex_map, 4);
+  auto pixel_map = MakeMap();
+  UseFloat(pixel_map, 0);
+
+  REQUIRE_FALSE(packer.IsUpToDate(vertex_map, pixel_map));
+  packer.Pack(vertex_map, pixel_map, packed.data());
+  REQUIRE(packer.IsUpToDate(vertex_map, pixel_map));
+
+  SECTION("Unused constant written") {
+    packer.RegisterWritten(XE_GPU_REG_SHADER_CONSTANT_000_X + 5 * 4);
+    packer.RegisterWritten(XE_GPU_REG_SHADER_CONSTANT_000_X + 0 * 4 + 2);
+    REQUIRE(packer.IsUpToDate(vertex_map, pixel_map));
+  }
+  SECTION("Used vertex constant written") {
+    packer.RegisterWritten(XE_GPU_REG_SHADER_CONSTANT_000_X + 4 * 4 + 3);
+    REQUIRE_FALSE(packer.IsUpToDate(vertex_map, pixel_map));
+  }
+  SECTION("Used pixel constant written") {
+    packer.RegisterWritten(XE_GPU_REG_SHADER_CONSTANT_000_X + 256 * 4 + 1);
+    REQUIRE_FALSE(packer.IsUpToDate(vertex_map, pixel_map));
+  }
+  SECTION("Bool constant written") {
+    packer.RegisterWritten(XE_GPU_REG_SHADER_CONSTANT_BOOL_000_031 + 7);
+    REQUIRE_FALSE(packer.IsUpToDate(vertex_map, pixel_map));
+  }
+  SECTION("Loop constant written") {
+    packer.RegisterWritten(XE_GPU_REG_SHADER_CONSTANT_LOOP_31);
+    REQUIRE_FALSE(packer.IsUpToDate(vertex_map, pixel_map));
+  }
+  SECTION("Other register written") {
+    packer.RegisterWritten(XE_GPU_REG_SHADER_CONSTANT_FETCH_00_0);
+    REQUIRE(packer.IsUpToDate(vertex_map, pixel_map));
+  }
+  SECTION("Shaders using fewer constants") {
+    auto fewer_map = MakeMap();
+    UseFloat(fewer_map, 4);
+    REQUIRE(packer.IsUpToDate(fewer_map, MakeMap()));
+  }
+  SECTION("Shaders using more constants") {
+    auto more_map = vertex_map;
+    UseFloat(more_map, 200);
+    REQUIRE_FALSE(packer.IsUpToDate(more_map, pixel_map));
+    // Vertex constants don't cover pixel ones.
+    REQUIRE_FALSE(packer.IsUpToDate(vertex_map, vertex_map));
+  }
+  SECTION("Invalidated") {
+    packer.Invalidate();
+    REQUIRE_FALSE(packer.IsUpToDate(vertex_map, pixel_map));
+  }
+}
+
+TEST_CASE("CONSTANT_REGISTER_PACKER_BENCHMARK", "[.benchmark]") {
+  const int kRuns = 100000;
+  auto register_file = std::make_unique<RegisterFile>();
+  FillRegisters(*register_file);
+  Packer packer(register_file.get());
+  std::vector<uint8_t> packed(Packer::kSize);
+
+  // Typical usage - a transform matrix block and a few scattered constants.
+  auto vertex_map = MakeMap();
+  for (uint32_t i = 0; i < 16; ++i) {
+    UseFloat(vertex_map, i);
+  }
+  UseFloat(vertex_map, 100);
+  auto pixel_map = MakeMap();
+  for (uint32_t i = 0; i < 8; ++i) {
+    UseFloat(pixel_map, i * 3);
+  }
+  auto dynamic_map = MakeMap();
+  std::memset(dynamic_map.float_bitmap, 0xFF, sizeof(dynamic_map.float_bitmap));
+
+  auto time_runs = [&](auto upload) {
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int run = 0; run < kRuns; ++run) {
+      upload();
+    }
+    auto elapsed = std::chrono::high_resolution_clock::now() - start;
+    return std::chrono::duration<double, std::nano>(elapsed).count() / kRuns;
+  };
+  const auto& values = register_file->values;
+  double full_ns = time_runs([&]() {
+    std::memcpy(packed.data() + Packer::kFloatConstantsOffset,
+                &values[XE_GPU_REG_SHADER_CONSTANT_000_X], 512 * 16);
+    std::memcpy(packed.data() + Packer::kBoolConstantsOffset,
+                &values[XE_GPU_REG_SHADER_CONSTANT_BOOL_000_031], 8 * 4);
+    std::memcpy(packed.data() + Packer::kLoopConstantsOffset,
+                &values[XE_GPU_REG_SHADER_CONSTANT_LOOP_00], 32 * 4);
+  });
+  double packed_ns =
+      time_runs([&]() { packer.Pack(vertex_map, pixel_map, packed.data()); });
+  double dynamic_ns = time_runs(
+      [&]() { packer.Pack(dynamic_map, dynamic_map, packed.data()); });
+  double check_ns = time_runs([&]() {
+    packer.RegisterWritten(XE_GPU_REG_SHADER_CONSTANT_000_X + 200 * 4);
+    if (!packer.IsUpToDate(vertex_map, pixel_map)) {
+      packer.Pack(vertex_map, pixel_map, packed.data());
+    }
+  });
+  std::printf("full copy:            %8.1f ns\n", full_ns);
+  std::printf("packed (25 used):     %8.1f ns\n", packed_ns);
+  std::printf("packed (all used):    %8.1f ns\n", dynamic_ns);
+  std::printf("unused write + check: %8.1f ns\n", check_ns);
+}
+
+}  // namespace test
+}  // namespace gpu
+}  // namespace xe
@@ -0,0 +1,16 @@
+project_root = "../../../.."
+include(project_root.."/tools/build")
+
+test_suite("xenia-gpu-tests", project_root, ".", {
+  links = {
+    "dxbc",
+    "glslang-spirv",
+    "spirv-tools",
+    "xenia-base",
+    "xenia-core",
+    "xenia-cpu",
+    "xenia-gpu",
+    "xenia-ui",
+    "xenia-ui-spirv",
+  },
+})
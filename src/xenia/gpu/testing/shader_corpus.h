@@ -0,0 +1,153 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2020 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#ifndef XENIA_GPU_TESTING_SHADER_CORPUS_H_
+#define XENIA_GPU_TESTING_SHADER_CORPUS_H_
+
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "xenia/base/byte_order.h"
+#include "xenia/base/math.h"
+#include "xenia/gpu/registers.h"
+#include "xenia/gpu/shader.h"
+#include "xenia/gpu/ucode.h"
+
+namespace xe {
+namespace gpu {
+namespace test {
+
+using namespace xe::gpu::ucode;
+
+// Synthetic shaders for the translation tests and benchmarks.
+const uint32_t kRegisterCount = 4;
+const size_t kCorpusSize = 48;
+
+inline reg::SQ_PROGRAM_CNTL MakeProgramCntl() {
+  reg::SQ_PROGRAM_CNTL cntl;
+  cntl.value = 0;
+  cntl.vs_num_reg = kRegisterCount - 1;
+  cntl.ps_num_reg = kRegisterCount - 1;
+  return cntl;
+}
+
+struct CorpusEntry {
+  ShaderType type;
+  // Big-endian, as in guest memory.
+  std::vector<uint32_t> ucode;
+};
+
+// Appends an ALU instruction. Sources are temps if their reg is below
+// kRegisterCount, float constants otherwise (with the index offset by
+// kRegisterCount).
+inline void EmitAlu(std::vector<uint32_t>& ucode, AluVectorOpcode vector_opcode,
+             uint32_t vector_dest, uint32_t vector_write_mask, bool is_export,
+             AluScalarOpcode scalar_opcode, uint32_t scalar_dest,
+             uint32_t scalar_write_mask, const uint32_t src_regs[3]) {
+  uint32_t dwords[3] = {};
+  dwords[0] = vector_dest | (scalar_dest << 8) | (uint32_t(is_export) << 15) |
+              (vector_write_mask << 16) | (scalar_write_mask << 20) |
+              (uint32_t(scalar_opcode) << 26);
+  // Identity swizzles and no modifiers.
+  dwords[1] = 0;
+  dwords[2] = uint32_t(vector_opcode) << 24;
+  for (uint32_t i = 0; i < 3; ++i) {
+    // src1 is in the highest bits.
+    uint32_t shift = (2 - i) * 8;
+    if (src_regs[i] < kRegisterCount) {
+      dwords[2] |= (src_regs[i] << shift) | (1u << (31 - i));
+    } else {
+      dwords[2] |= (src_regs[i] - kRegisterCount) << shift;
+    }
+  }
+  for (uint32_t dword : dwords) {
+    ucode.push_back(xe::byte_swap(dword));
+  }
+}
+
+// Builds shaders shaped like typical small game shaders: one alloc and one
+// exec of arithmetic on temps and float constants, ending with the exports.
+inline CorpusEntry MakeShader(ShaderType type, std::mt19937& rng) {
+  static const AluVectorOpcode vector_opcodes[] = {
+      AluVectorOpcode::kAdd, AluVectorOpcode::kMul, AluVectorOpcode::kMax,
+      AluVectorOpcode::kMad, AluVectorOpcode::kDp4,
+  };
+  static const AluScalarOpcode scalar_opcodes[] = {
+      AluScalarOpcode::kRcp,
+      AluScalarOpcode::kSqrt,
+  };
+  bool is_vertex = type == ShaderType::kVertex;
+  uint32_t export_count = is_vertex ? 2 : 1;
+  // exec can run up to 6 instructions.
+  uint32_t alu_count = export_count + 1 + rng() % (6 - export_count);
+
+  CorpusEntry entry;
+  entry.type = type;
+  auto& ucode = entry.ucode;
+  // alloc position (or colors), then exec_end at instruction address 1 with
+  // all ALU instructions.
+  uint32_t cf_a[2] = {
+      0, ((is_vertex ? uint32_t(AllocType::kVsPosition)
+                     : uint32_t(AllocType::kPsColors))
+          << 9) |
+             (uint32_t(ControlFlowOpcode::kAlloc) << 12)};
+  uint32_t cf_b[2] = {1 | (alu_count << 12),
+                      uint32_t(ControlFlowOpcode::kExecEnd) << 12};
+  ucode.push_back(xe::byte_swap(cf_a[0]));
+  ucode.push_back(xe::byte_swap((cf_a[1] & 0xFFFF) | (cf_b[0] << 16)));
+  ucode.push_back(xe::byte_swap((cf_b[0] >> 16) | (cf_b[1] << 16)));
+
+  for (uint32_t i = 0; i < alu_count - export_count; ++i) {
+    // At most two constant operands, and src3 (used by scalar ops) is a temp.
+    uint32_t src_regs[3] = {
+        rng() % 2 ? rng() % kRegisterCount : kRegisterCount + rng() % 256,
+        rng() % 2 ? rng() % kRegisterCount : kRegisterCount + rng() % 256,
+        rng() % kRegisterCount,
+    };
+    bool has_scalar = (rng() % 3) == 0;
+    EmitAlu(ucode, vector_opcodes[rng() % xe::countof(vector_opcodes)],
+            rng() % kRegisterCount, 1 + rng() % 15, false,
+            has_scalar ? scalar_opcodes[rng() % xe::countof(scalar_opcodes)]
+                       : AluScalarOpcode::kRetainPrev,
+            rng() % kRegisterCount, has_scalar ? 1 + rng() % 15 : 0,
+            src_regs);
+  }
+  // Exports: position and interpolator 0, or color 0.
+  uint32_t export_dests[] = {is_vertex ? 62u : 0u, 0};
+  for (uint32_t i = 0; i < export_count; ++i) {
+    uint32_t src = rng() % kRegisterCount;
+    uint32_t src_regs[3] = {src, src, 0};
+    EmitAlu(ucode, AluVectorOpcode::kMax, export_dests[i], 0xF, true,
+            AluScalarOpcode::kRetainPrev, 0, 0, src_regs);
+  }
+  return entry;
+}
+
+inline std::vector<CorpusEntry> MakeCorpus() {
+  std::mt19937 rng(0x5EED5EED);
+  std::vector<CorpusEntry> corpus;
+  for (size_t i = 0; i < kCorpusSize; ++i) {
+    corpus.push_back(MakeShader(
+        (i & 1) ? ShaderType::kPixel : ShaderType::kVertex, rng));
+  }
+  return corpus;
+}
+
+inline std::unique_ptr<Shader> MakeShaderObject(const CorpusEntry& entry,
+                                                uint64_t hash) {
+  return std::make_unique<Shader>(entry.type, hash, entry.ucode.data(),
+                                  uint32_t(entry.ucode.size()));
+}
+
+}  // namespace test
+}  // namespace gpu
+}  // namespace xe
+
+#endif  // XENIA_GPU_TESTING_SHADER_CORPUS_H_
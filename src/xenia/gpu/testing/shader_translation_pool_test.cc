@@ -0,0 +1,122 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2020 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include "xenia/gpu/shader_translation_pool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "xenia/gpu/spirv_shader_translator.h"
+#include "xenia/gpu/testing/shader_corpus.h"
+
+#include "third_party/catch/include/catch.hpp"
+
+namespace xe {
+namespace gpu {
+namespace test {
+
+std::unique_ptr<ShaderTranslationPool> MakePool(
+    size_t thread_count, ShaderTranslationPool::PrepareFunction prepare) {
+  return std::make_unique<ShaderTranslationPool>(
+      thread_count, []() { return std::make_unique<SpirvShaderTranslator>(); },
+      std::move(prepare), "Shader Translation Test");
+}
+
+TEST_CASE("shader_translation_pool_deterministic", "[gpu]") {
+  auto corpus = MakeCorpus();
+  auto cntl = MakeProgramCntl();
+
+  // Reference: translated one by one, like on the command processor thread.
+  std::vector<std::vector<uint8_t>> reference;
+  SpirvShaderTranslator translator;
+  for (size_t i = 0; i < corpus.size(); ++i) {
+    auto shader = MakeShaderObject(corpus[i], i);
+    REQUIRE(translator.Translate(shader.get(), PrimitiveType::kNone, cntl));
+    REQUIRE(shader->is_valid());
+    const auto& binary = shader->translated_binary();
+    REQUIRE(binary.size() >= 4 * sizeof(uint32_t));
+    REQUIRE(*reinterpret_cast<const uint32_t*>(binary.data()) == 0x07230203);
+    reference.push_back(binary);
+  }
+
+  // Drain several shuffled copies of the corpus, so each worker's translator
+  // is reused for many different shaders in an unpredictable order.
+  std::atomic<uint32_t> prepared_count(0);
+  auto pool = MakePool(4, [&prepared_count](Shader* shader) {
+    ++prepared_count;
+    return shader->is_translated();
+  });
+  std::vector<std::pair<size_t, std::unique_ptr<Shader>>> shaders;
+  for (size_t copy = 0; copy < 3; ++copy) {
+    for (size_t i = 0; i < corpus.size(); ++i) {
+      shaders.emplace_back(i, MakeShaderObject(corpus[i], i));
+    }
+  }
+  std::shuffle(shaders.begin(), shaders.end(), std::mt19937(1));
+  for (auto& shader : shaders) {
+    pool->Request(shader.second.get(), cntl);
+  }
+  // Requesting again is ignored.
+  pool->Request(shaders.front().second.get(), cntl);
+  pool->AwaitAll();
+
+  REQUIRE(prepared_count.load() == shaders.size());
+  for (auto& shader : shaders) {
+    REQUIRE(pool->GetStatus(shader.second.get()) ==
+            ShaderTranslationPool::Status::kTranslated);
+    REQUIRE(shader.second->translated_binary() == reference[shader.first]);
+  }
+  pool->Clear();
+}
+
+TEST_CASE("shader_translation_pool_await", "[gpu]") {
+  auto corpus = MakeCorpus();
+  auto cntl = MakeProgramCntl();
+  // Vertex shaders fail preparation.
+  auto pool = MakePool(2, [](Shader* shader) {
+    return shader->type() == ShaderType::kPixel;
+  });
+
+  std::vector<std::unique_ptr<Shader>> shaders;
+  for (size_t i = 0; i < corpus.size(); ++i) {
+    shaders.push_back(MakeShaderObject(corpus[i], i));
+    REQUIRE(pool->GetStatus(shaders.back().get()) ==
+            ShaderTranslationPool::Status::kNone);
+    pool->Request(shaders.back().get(), cntl);
+  }
+
+  // The last ones are likely still queued and get moved to the front.
+  for (size_t i = shaders.size(); i-- > 0;) {
+    Shader* shader = shaders[i].get();
+    bool translated = pool->Await(shader);
+    REQUIRE(translated == (shader->type() == ShaderType::kPixel));
+    REQUIRE(pool->GetStatus(shader) ==
+            (translated ? ShaderTranslationPool::Status::kTranslated
+                        : ShaderTranslationPool::Status::kFailed));
+  }
+
+  // Clearing with requests still in flight drops them.
+  pool->Clear();
+  for (auto& shader : shaders) {
+    shader = MakeShaderObject(corpus[0], 0);
+    pool->Request(shader.get(), cntl);
+  }
+  pool->Clear();
+  for (auto& shader : shaders) {
+    REQUIRE(pool->GetStatus(shader.get()) ==
+            ShaderTranslationPool::Status::kNone);
+  }
+}
+
+}  // namespace test
+}  // namespace gpu
+}  // namespace xe
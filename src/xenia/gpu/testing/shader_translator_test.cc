@@ -0,0 +1,111 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2020 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include "xenia/gpu/shader_translator.h"
+
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "xenia/gpu/spirv_shader_translator.h"
+#include "xenia/gpu/testing/shader_corpus.h"
+
+#include "third_party/catch/include/catch.hpp"
+
+namespace xe {
+namespace gpu {
+namespace test {
+
+TEST_CASE("shader_translator_parses_once", "[gpu]") {
+  auto corpus = MakeCorpus();
+  auto cntl = MakeProgramCntl();
+  UcodeShaderTranslator ucode_translator;
+  SpirvShaderTranslator spirv_translator;
+  for (size_t i = 0; i < corpus.size(); ++i) {
+    auto shader = MakeShaderObject(corpus[i], i);
+    REQUIRE(shader->parsed_ucode() == nullptr);
+    REQUIRE(spirv_translator.Translate(shader.get(), PrimitiveType::kNone,
+                                       cntl));
+    const Shader::ParsedUcode* parsed_ucode = shader->parsed_ucode();
+    REQUIRE(parsed_ucode != nullptr);
+    REQUIRE(!parsed_ucode->entries.empty());
+    auto spirv = shader->translated_binary();
+
+    // Translating again, for the same or another host, reuses the parsed
+    // microcode and gives the same result.
+    REQUIRE(spirv_translator.Translate(shader.get(), PrimitiveType::kNone,
+                                       cntl));
+    REQUIRE(shader->parsed_ucode() == parsed_ucode);
+    REQUIRE(shader->translated_binary() == spirv);
+    REQUIRE(ucode_translator.Translate(shader.get(), PrimitiveType::kNone,
+                                       cntl));
+    REQUIRE(shader->parsed_ucode() == parsed_ucode);
+
+    // The disassembly is generated on request, and is what the ucode
+    // translator outputs.
+    const auto& ucode_binary = shader->translated_binary();
+    const std::string& disassembly = shader->ucode_disassembly();
+    REQUIRE(!disassembly.empty());
+    REQUIRE(std::string(ucode_binary.begin(), ucode_binary.end()) ==
+            disassembly);
+    REQUIRE(disassembly.find("alloc") != std::string::npos);
+    REQUIRE(disassembly.find("exece") != std::string::npos);
+  }
+}
+
+TEST_CASE("shader_translator_benchmark", "[.benchmark]") {
+  // Translates the corpus to SPIR-V many times, decoding the microcode for
+  // each translation as on the first use of a shader, and from the microcode
+  // decoded before, as when translating a shader again.
+  const uint32_t rounds = 200;
+  auto corpus = MakeCorpus();
+  auto cntl = MakeProgramCntl();
+  SpirvShaderTranslator translator;
+  std::vector<std::unique_ptr<Shader>> shaders;
+  for (size_t i = 0; i < corpus.size(); ++i) {
+    shaders.push_back(MakeShaderObject(corpus[i], i));
+  }
+
+  auto run = [&](bool fresh) {
+    auto start = std::chrono::high_resolution_clock::now();
+    for (uint32_t r = 0; r < rounds; ++r) {
+      for (size_t i = 0; i < corpus.size(); ++i) {
+        if (fresh) {
+          shaders[i] = MakeShaderObject(corpus[i], i);
+        }
+        translator.Translate(shaders[i].get(), PrimitiveType::kNone, cntl);
+      }
+    }
+    auto elapsed = std::chrono::high_resolution_clock::now() - start;
+    return std::chrono::duration<double, std::nano>(elapsed).count() /
+           (rounds * corpus.size());
+  };
+  double fresh = run(true);
+  double cached = run(false);
+
+  auto start = std::chrono::high_resolution_clock::now();
+  size_t disassembly_length = 0;
+  for (auto& shader : shaders) {
+    disassembly_length += shader->ucode_disassembly().size();
+  }
+  auto elapsed = std::chrono::high_resolution_clock::now() - start;
+  std::printf(
+      "%zu shaders: parse and translate %8.0f ns/shader, translate parsed "
+      "%8.0f ns/shader, disassemble on request %8.0f ns/shader\n",
+      corpus.size(), fresh, cached,
+      std::chrono::duration<double, std::nano>(elapsed).count() /
+          corpus.size());
+  REQUIRE(disassembly_length != 0);
+}
+
+}  // namespace test
+}  // namespace gpu
+}  // namespace xe
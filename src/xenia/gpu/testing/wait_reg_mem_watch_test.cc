@@ -0,0 +1,328 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2020 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include "xenia/gpu/wait_reg_mem_watch.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <thread>
+
+#include "xenia/base/byte_order.h"
+#include "xenia/base/math.h"
+#include "xenia/base/platform.h"
+#include "xenia/gpu/command_processor.h"
+#include "xenia/gpu/gpu_flags.h"
+#include "xenia/gpu/graphics_system.h"
+#include "xenia/memory.h"
+
+#include "third_party/catch/include/catch.hpp"
+
+namespace xe {
+namespace gpu {
+namespace test {
+
+std::unique_ptr<Memory> MakeMemory() {
+  auto memory = std::make_unique<Memory>();
+  REQUIRE(memory->Initialize());
+  return memory;
+}
+
+// Just enough of a graphics system for a command processor to execute packets
+// that don't draw.
+class TestGraphicsSystem : public GraphicsSystem {
+ public:
+  explicit TestGraphicsSystem(Memory* memory) { memory_ = memory; }
+
+  std::wstring name() const override { return L"test"; }
+
+ protected:
+  std::unique_ptr<CommandProcessor> CreateCommandProcessor() override {
+    return nullptr;
+  }
+  void Swap(xe::ui::UIEvent* e) override {}
+};
+
+class TestCommandProcessor : public CommandProcessor {
+ public:
+  explicit TestCommandProcessor(GraphicsSystem* graphics_system)
+      : CommandProcessor(graphics_system, nullptr) {}
+
+  void TracePlaybackWroteMemory(uint32_t base_ptr, uint32_t length) override {}
+  void RestoreEDRAMSnapshot(const void* snapshot) override {}
+
+ private:
+  bool SetupContext() override { return true; }
+  void ShutdownContext() override {}
+  void PerformSwap(uint32_t frontbuffer_ptr, uint32_t frontbuffer_width,
+                   uint32_t frontbuffer_height) override {}
+  Shader* LoadShader(ShaderType shader_type, uint32_t guest_address,
+                     const uint32_t* host_address,
+                     uint32_t dword_count) override {
+    return nullptr;
+  }
+  bool IssueDraw(PrimitiveType prim_type, uint32_t index_count,
+                 IndexBufferInfo* index_buffer_info,
+                 bool major_mode_explicit) override {
+    return false;
+  }
+  bool IssueCopy() override { return false; }
+  void InitializeTrace() override {}
+  void FinalizeTrace() override {}
+};
+
+class CvarOverride {
+ public:
+  CvarOverride(bool* cvar, bool value) : cvar_(cvar), previous_(*cvar) {
+    *cvar = value;
+  }
+  ~CvarOverride() { *cvar_ = previous_; }
+
+ private:
+  bool* cvar_;
+  bool previous_;
+};
+
+// Executes PM4_WAIT_REG_MEM packets on a command processor, like its worker
+// thread does for the ring buffer.
+class WaitRegMemTest {
+ public:
+  explicit WaitRegMemTest(Memory* memory)
+      : memory_(memory), graphics_system_(memory) {
+    packet_address_ = memory->SystemHeapAlloc(64, 64, kSystemHeapPhysical);
+    command_processor_ =
+        std::make_unique<TestCommandProcessor>(&graphics_system_);
+  }
+  ~WaitRegMemTest() {
+    command_processor_.reset();
+    memory_->SystemHeapFree(packet_address_);
+  }
+
+  TestCommandProcessor* command_processor() const {
+    return command_processor_.get();
+  }
+
+  // Writes a register like GraphicsSystem::WriteRegister does for the guest.
+  void WriteRegister(uint32_t index, uint32_t value, bool notify = true) {
+    graphics_system_.register_file()->values[index].u32 = value;
+    if (notify) {
+      command_processor_->NotifyRegisterWritten(index);
+    }
+  }
+
+  // Waits until (value & mask) >= ref, polling every wait / 0x100 ms.
+  void WaitGreaterOrEqual(bool memory, uint32_t address, uint32_t ref,
+                          uint32_t wait) {
+    uint32_t packet[] = {
+        xenos::MakePacketType3(xenos::PM4_WAIT_REG_MEM, 5),
+        (memory ? 0x10u : 0x0u) | 0x5,
+        address,
+        ref,
+        0xFFFFFFFF,
+        wait,
+    };
+    // Written through the physical mapping, like a command buffer the guest
+    // has flushed.
+    uint32_t packet_physical_address =
+        memory_->GetPhysicalAddress(packet_address_);
+    uint8_t* host_address = memory_->TranslatePhysical(packet_physical_address);
+    for (size_t i = 0; i < xe::countof(packet); ++i) {
+      xe::store_and_swap<uint32_t>(host_address + i * 4, packet[i]);
+    }
+    command_processor_->ExecutePacket(packet_physical_address,
+                                      uint32_t(xe::countof(packet)));
+  }
+
+ private:
+  Memory* memory_;
+  TestGraphicsSystem graphics_system_;
+  uint32_t packet_address_;
+  std::unique_ptr<TestCommandProcessor> command_processor_;
+};
+
+TEST_CASE("wait_reg_mem_watch_register", "[gpu]") {
+  auto memory = MakeMemory();
+  {
+    WaitRegMemWatch watch(memory.get());
+    watch.WatchRegister(0x0578);
+    watch.RegisterWritten(0x0579);
+    REQUIRE_FALSE(watch.Wait(std::chrono::milliseconds(0)));
+    watch.RegisterWritten(0x0578);
+    REQUIRE(watch.Wait(std::chrono::milliseconds(0)));
+    watch.RegisterWritten(0x0578);
+    REQUIRE_FALSE(watch.Wait(std::chrono::milliseconds(0)));
+
+    watch.Interrupt();
+    REQUIRE(watch.Wait(std::chrono::milliseconds(0)));
+  }
+  memory.reset();
+}
+
+TEST_CASE("wait_reg_mem_register", "[gpu]") {
+  auto memory = MakeMemory();
+  // A long timeout, so a wait ending early can only have been woken.
+  const uint32_t kWait = 0x100 * 10000;
+  const uint32_t kRegister = XE_GPU_REG_SCRATCH_REG0;
+  SECTION("Watch") {
+    CvarOverride vsync(&cvars::vsync, true);
+    CvarOverride watch(&cvars::gpu_wait_reg_mem_watch, true);
+    WaitRegMemTest test(memory.get());
+    test.WriteRegister(kRegister, 0);
+    std::atomic<bool> done = {false};
+    auto start = std::chrono::steady_clock::now();
+    std::thread gpu_thread([&]() {
+      test.WaitGreaterOrEqual(false, kRegister, 1, kWait);
+      done = true;
+    });
+    // Sleeping until told about a write rather than polling.
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    test.WriteRegister(kRegister, 1, false);
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    REQUIRE_FALSE(done);
+    test.WriteRegister(kRegister, 1);
+    gpu_thread.join();
+    REQUIRE(std::chrono::steady_clock::now() - start <
+            std::chrono::seconds(5));
+  }
+  SECTION("No vsync") {
+    // Yields instead of sleeping, so writes are seen without being watched.
+    CvarOverride vsync(&cvars::vsync, false);
+    CvarOverride watch(&cvars::gpu_wait_reg_mem_watch, true);
+    WaitRegMemTest test(memory.get());
+    test.WriteRegister(kRegister, 0);
+    auto start = std::chrono::steady_clock::now();
+    std::thread gpu_thread(
+        [&]() { test.WaitGreaterOrEqual(false, kRegister, 1, kWait); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    test.WriteRegister(kRegister, 1, false);
+    gpu_thread.join();
+    REQUIRE(std::chrono::steady_clock::now() - start <
+            std::chrono::seconds(5));
+  }
+  memory.reset();
+}
+
+// Physical memory watches rely on access violations, which are only handled
+// on Windows for now.
+#if XE_PLATFORM_WIN32
+// A physical page shared by the "CPU" and the "GPU", like a fence.
+struct FencePage {
+  explicit FencePage(Memory* memory) : memory(memory) {
+    virtual_address = memory->SystemHeapAlloc(4096, 4096, kSystemHeapPhysical);
+    physical_address = memory->GetPhysicalAddress(virtual_address);
+  }
+  ~FencePage() { memory->SystemHeapFree(virtual_address); }
+
+  // Stores like guest code does, through the virtual address, which triggers
+  // physical memory watches.
+  void GuestStore(uint32_t offset, uint32_t value) {
+    xe::store_and_swap<uint32_t>(
+        memory->TranslateVirtual(virtual_address + offset), value);
+  }
+  // Loads and stores like the command processor does.
+  uint32_t GpuLoad(uint32_t offset) {
+    return xe::load_and_swap<uint32_t>(
+        memory->TranslatePhysical(physical_address + offset));
+  }
+  void GpuStore(uint32_t offset, uint32_t value) {
+    xe::store_and_swap<uint32_t>(
+        memory->TranslatePhysical(physical_address + offset), value);
+  }
+
+  Memory* memory;
+  uint32_t virtual_address;
+  uint32_t physical_address;
+};
+
+TEST_CASE("wait_reg_mem_watch_memory", "[gpu]") {
+  auto memory = MakeMemory();
+  {
+    FencePage page(memory.get());
+    WaitRegMemWatch watch(memory.get());
+
+    // Nothing written - times out.
+    watch.WatchMemory(page.physical_address);
+    REQUIRE_FALSE(watch.Wait(std::chrono::milliseconds(0)));
+
+    // Written between the check and the wait - doesn't block.
+    page.GuestStore(0, 1);
+    REQUIRE(watch.Wait(std::chrono::milliseconds(0)));
+    REQUIRE(page.GpuLoad(0) == 1);
+
+    // The watch is one-shot.
+    page.GuestStore(0, 2);
+    REQUIRE_FALSE(watch.Wait(std::chrono::milliseconds(0)));
+
+    // Written by another thread while waiting.
+    watch.WatchMemory(page.physical_address + 0x10);
+    std::thread cpu_thread([&page]() {
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+      page.GuestStore(0x10, 3);
+    });
+    REQUIRE(watch.Wait(std::chrono::milliseconds(10000)));
+    REQUIRE(page.GpuLoad(0x10) == 3);
+    cpu_thread.join();
+
+    // No longer interested.
+    watch.WatchMemory(page.physical_address);
+    watch.Unwatch();
+    page.GuestStore(0, 4);
+    REQUIRE_FALSE(watch.Wait(std::chrono::milliseconds(0)));
+  }
+  memory.reset();
+}
+
+// The CPU signals a fence and waits for the GPU to write back that it has
+// passed it, like a guest waiting for the GPU to consume a command buffer. The
+// GPU waits with PM4_WAIT_REG_MEM polling every millisecond.
+TEST_CASE("wait_reg_mem_fence_round_trip", "[.benchmark]") {
+  auto memory = MakeMemory();
+  CvarOverride vsync(&cvars::vsync, true);
+  for (bool use_watch : {true, false}) {
+    CvarOverride watch(&cvars::gpu_wait_reg_mem_watch, use_watch);
+    FencePage page(memory.get());
+    WaitRegMemTest test(memory.get());
+    const uint32_t kFenceOffset = 0;
+    const uint32_t kDoneOffset = 0x800;
+    const uint32_t round_trips = use_watch ? 1000 : 100;
+
+    // Stored big-endian by the guest.
+    const uint32_t fence_address = (page.physical_address + kFenceOffset) |
+                                   uint32_t(Endian::k8in32);
+
+    std::thread gpu_thread([&]() {
+      for (uint32_t i = 1; i <= round_trips; ++i) {
+        test.WaitGreaterOrEqual(true, fence_address, i, 0x100);
+        page.GpuStore(kDoneOffset, i);
+      }
+    });
+    auto start = std::chrono::high_resolution_clock::now();
+    for (uint32_t i = 1; i <= round_trips; ++i) {
+      page.GuestStore(kFenceOffset, i);
+      while (xe::load_and_swap<uint32_t>(memory->TranslateVirtual(
+                 page.virtual_address + kDoneOffset)) < i) {
+        std::this_thread::yield();
+      }
+    }
+    auto elapsed = std::chrono::high_resolution_clock::now() - start;
+    gpu_thread.join();
+    std::printf("Fence round trip with %s: %.2f us\n",
+                use_watch ? "write watch" : "1 ms polling",
+                std::chrono::duration<double, std::micro>(elapsed).count() /
+                    round_trips);
+  }
+  memory.reset();
+}
+#endif  // XE_PLATFORM_WIN32
+
+}  // namespace test
+}  // namespace gpu
+}  // namespace xe
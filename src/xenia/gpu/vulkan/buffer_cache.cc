@@ -94,11 +94,14 @@ void copy_and_swap_32_unaligned(void* dest_ptr, const void* src_ptr,
 using xe::ui::vulkan::CheckResult;
 
 constexpr VkDeviceSize kConstantRegisterUniformRange =
-    512 * 4 * 4 + 8 * 4 + 32 * 4;
+    ConstantRegisterPacker::kSize;
 
 BufferCache::BufferCache(RegisterFile* register_file, Memory* memory,
                          ui::vulkan::VulkanDevice* device, size_t capacity)
-    : register_file_(register_file), memory_(memory), device_(device) {
+    : register_file_(register_file),
+      memory_(memory),
+      device_(device),
+      constant_packer_(register_file) {
   transient_buffer_ = std::make_unique<ui::vulkan::CircularBuffer>(
       device_,
       VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT |
@@ -322,100 +325,53 @@ std::pair<VkDeviceSize, VkDeviceSize> BufferCache::UploadConstantRegisters(
     const Shader::ConstantRegisterMap& vertex_constant_register_map,
     const Shader::ConstantRegisterMap& pixel_constant_register_map,
     VkFence fence) {
-  // Fat struct, including all registers:
-  // struct {
-  //   vec4 float[512];
-  //   uint bool[8];
-  //   uint loop[32];
-  // };
+  if (fence != constant_upload_fence_) {
+    // The previous uploads may be reclaimed once the batch is done.
+    constant_packer_.Invalidate();
+    constant_upload_fence_ = fence;
+    constant_barrier_recorded_ = false;
+  }
+  if (constant_packer_.IsUpToDate(vertex_constant_register_map,
+                                  pixel_constant_register_map)) {
+    return {constant_offset_, constant_offset_};
+  }
+
   auto offset = AllocateTransientData(kConstantRegisterUniformRange, fence);
   if (offset == VK_WHOLE_SIZE) {
     // OOM.
+    constant_packer_.Invalidate();
     return {VK_WHOLE_SIZE, VK_WHOLE_SIZE};
   }
 
-  // Copy over all the registers.
-  const auto& values = register_file_->values;
-  uint8_t* dest_ptr = transient_buffer_->host_base() + offset;
-  std::memcpy(dest_ptr, &values[XE_GPU_REG_SHADER_CONSTANT_000_X].f32,
-              (512 * 4 * 4));
-  dest_ptr += 512 * 4 * 4;
-  std::memcpy(dest_ptr, &values[XE_GPU_REG_SHADER_CONSTANT_BOOL_000_031].u32,
-              8 * 4);
-  dest_ptr += 8 * 4;
-  std::memcpy(dest_ptr, &values[XE_GPU_REG_SHADER_CONSTANT_LOOP_00].u32,
-              32 * 4);
-  dest_ptr += 32 * 4;
-
+  // Only the constants used by the shaders are copied, to the same place as
+  // in the full register layout, so dynamic indexing still works.
+  constant_packer_.Pack(vertex_constant_register_map,
+                        pixel_constant_register_map,
+                        transient_buffer_->host_base() + offset);
   transient_buffer_->Flush(offset, kConstantRegisterUniformRange);
-
-  // Append a barrier to the command buffer.
-  VkBufferMemoryBarrier barrier = {
-      VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
-      nullptr,
-      VK_ACCESS_HOST_WRITE_BIT,
-      VK_ACCESS_UNIFORM_READ_BIT | VK_ACCESS_SHADER_READ_BIT,
-      VK_QUEUE_FAMILY_IGNORED,
-      VK_QUEUE_FAMILY_IGNORED,
-      transient_buffer_->gpu_buffer(),
-      offset,
-      kConstantRegisterUniformRange,
-  };
-  vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_HOST_BIT,
-                       VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 0, nullptr, 1,
-                       &barrier, 0, nullptr);
-
-  return {offset, offset};
-
-// Packed upload code.
-// This is not currently supported by the shaders, but would be awesome.
-// We should be able to use this for any shader that does not do dynamic
-// constant indexing.
-#if 0
-  // Allocate space in the buffer for our data.
-  auto offset =
-      AllocateTransientData(constant_register_map.packed_byte_length, fence);
-  if (offset == VK_WHOLE_SIZE) {
-    // OOM.
-    return VK_WHOLE_SIZE;
-  }
-
-  // Run through registers and copy them into the buffer.
-  // TODO(benvanik): optimize this - it's hit twice every call.
-  const auto& values = register_file_->values;
-  uint8_t* dest_ptr =
-      reinterpret_cast<uint8_t*>(transient_buffer_data_) + offset;
-  for (int i = 0; i < 4; ++i) {
-    auto piece = constant_register_map.float_bitmap[i];
-    if (!piece) {
-      continue;
-    }
-    for (int j = 0, sh = 0; j < 64; ++j, sh << 1) {
-      if (piece & sh) {
-        xe::copy_128_aligned(
-            dest_ptr,
-            &values[XE_GPU_REG_SHADER_CONSTANT_000_X + i * 64 + j].f32, 1);
-        dest_ptr += 16;
-      }
-    }
-  }
-  for (int i = 0; i < 32; ++i) {
-    if (constant_register_map.loop_bitmap & (1 << i)) {
-      xe::store<uint32_t>(dest_ptr,
-                          values[XE_GPU_REG_SHADER_CONSTANT_LOOP_00 + i].u32);
-      dest_ptr += 4;
-    }
-  }
-  for (int i = 0; i < 8; ++i) {
-    if (constant_register_map.bool_bitmap[i]) {
-      xe::store<uint32_t>(
-          dest_ptr, values[XE_GPU_REG_SHADER_CONSTANT_BOOL_000_031 + i].u32);
-      dest_ptr += 4;
-    }
+  constant_offset_ = offset;
+
+  // Append a barrier to the command buffer, once for all uploads in the batch
+  // since the setup buffer is submitted before any of the draws.
+  if (!constant_barrier_recorded_) {
+    VkBufferMemoryBarrier barrier = {
+        VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
+        nullptr,
+        VK_ACCESS_HOST_WRITE_BIT,
+        VK_ACCESS_UNIFORM_READ_BIT | VK_ACCESS_SHADER_READ_BIT,
+        VK_QUEUE_FAMILY_IGNORED,
+        VK_QUEUE_FAMILY_IGNORED,
+        transient_buffer_->gpu_buffer(),
+        0,
+        VK_WHOLE_SIZE,
+    };
+    vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_HOST_BIT,
+                         VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 0, nullptr, 1,
+                         &barrier, 0, nullptr);
+    constant_barrier_recorded_ = true;
   }
 
-  return offset;
-#endif  // 0
+  return {offset, offset};
 }
 
 std::pair<VkBuffer, VkDeviceSize> BufferCache::UploadIndexBuffer(
@@ -784,13 +740,18 @@ void BufferCache::InvalidateCache() {
   transient_cache_.clear();
 }
 
-void BufferCache::ClearCache() { transient_cache_.clear(); }
+void BufferCache::ClearCache() {
+  transient_cache_.clear();
+  constant_packer_.Invalidate();
+}
 
 void BufferCache::Scavenge() {
   SCOPE_profile_cpu_f("gpu");
 
   transient_cache_.clear();
   transient_buffer_->Scavenge();
+  constant_packer_.Invalidate();
+  constant_upload_fence_ = nullptr;
 
   // TODO(DrChat): These could persist across frames, we just need a smart way
   // to delete unused ones.
@@ -10,6 +10,7 @@
 #ifndef XENIA_GPU_VULKAN_BUFFER_CACHE_H_
 #define XENIA_GPU_VULKAN_BUFFER_CACHE_H_
 
+#include "xenia/gpu/constant_register_packer.h"
 #include "xenia/gpu/register_file.h"
 #include "xenia/gpu/shader.h"
 #include "xenia/gpu/xenos.h"
@@ -61,8 +62,9 @@ class BufferCache {
   }
 
   // Uploads the constants specified in the register maps to the transient
-  // uniform storage buffer.
-  // The registers are tightly packed in order as [floats, ints, bools].
+  // uniform storage buffer, in the layout of ConstantRegisterPacker.
+  // If none of the constants used by the shaders have changed since the last
+  // upload in the same batch, the previous offsets are returned.
   // Returns an offset that can be used with the transient_descriptor_set or
   // VK_WHOLE_SIZE if the constants could not be uploaded (OOM).
   // The returned offsets may alias.
@@ -71,6 +73,10 @@ class BufferCache {
       const Shader::ConstantRegisterMap& vertex_constant_register_map,
       const Shader::ConstantRegisterMap& pixel_constant_register_map,
       VkFence fence);
+  // Must be called for every write of a shader constant register.
+  void ConstantRegisterWritten(uint32_t index) {
+    constant_packer_.RegisterWritten(index);
+  }
 
   // Uploads index buffer data from guest memory, possibly eliding with
   // recently uploaded data or cached copies.
@@ -168,6 +174,12 @@ class BufferCache {
   VkDescriptorPool constant_descriptor_pool_ = nullptr;
   VkDescriptorSetLayout constant_descriptor_set_layout_ = nullptr;
   VkDescriptorSet constant_descriptor_set_ = nullptr;
+
+  // Constants uploaded in the current batch.
+  ConstantRegisterPacker constant_packer_;
+  VkFence constant_upload_fence_ = nullptr;
+  VkDeviceSize constant_offset_ = 0;
+  bool constant_barrier_recorded_ = false;
 };
 
 }  // namespace vulkan
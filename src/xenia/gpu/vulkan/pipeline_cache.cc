@@ -14,9 +14,11 @@
 #include "xenia/base/math.h"
 #include "xenia/base/memory.h"
 #include "xenia/base/profiling.h"
+#include "xenia/base/threading.h"
 #include "xenia/gpu/gpu_flags.h"
 #include "xenia/gpu/vulkan/vulkan_gpu_flags.h"
 
+#include <algorithm>
 #include <cinttypes>
 #include <string>
 
@@ -165,11 +167,36 @@ VkResult PipelineCache::Initialize(
                             VK_DEBUG_REPORT_OBJECT_TYPE_SHADER_MODULE_EXT,
                             "S(p): Dummy");
 
+  if (cvars::vulkan_shader_translation_threads != 0) {
+    uint32_t logical_processor_count = xe::threading::logical_processor_count();
+    if (!logical_processor_count) {
+      // Pick some reasonable amount if couldn't determine the number of cores.
+      logical_processor_count = 6;
+    }
+    // Leave the rest of the cores to the guest and the command processor.
+    uint32_t thread_count;
+    if (cvars::vulkan_shader_translation_threads < 0) {
+      thread_count = std::max(logical_processor_count / 2, uint32_t(1));
+    } else {
+      thread_count =
+          std::min(uint32_t(cvars::vulkan_shader_translation_threads),
+                   logical_processor_count);
+    }
+    shader_translation_pool_ = std::make_unique<ShaderTranslationPool>(
+        thread_count,
+        []() { return std::make_unique<SpirvShaderTranslator>(); },
+        [this](Shader* shader) {
+          return PrepareShader(static_cast<VulkanShader*>(shader));
+        },
+        "Vulkan Shader Translation");
+  }
+
   return VK_SUCCESS;
 }
 
 void PipelineCache::Shutdown() {
   ClearCache();
+  shader_translation_pool_.reset();
 
   // Destroy geometry shaders.
   if (geometry_shaders_.line_quad_list) {
@@ -225,6 +252,57 @@ VulkanShader* PipelineCache::LoadShader(ShaderType shader_type,
   return shader;
 }
 
+PipelineCache::ShadersStatus PipelineCache::EnsureShadersTranslated(
+    VulkanShader* vertex_shader, VulkanShader* pixel_shader) {
+  auto sq_program_cntl = register_file_->Get<reg::SQ_PROGRAM_CNTL>();
+
+  if (!shader_translation_pool_) {
+    if (!vertex_shader->is_translated() &&
+        !TranslateShader(vertex_shader, sq_program_cntl)) {
+      XELOGE("Failed to translate the vertex shader!");
+      return ShadersStatus::kError;
+    }
+    if (pixel_shader && !pixel_shader->is_translated() &&
+        !TranslateShader(pixel_shader, sq_program_cntl)) {
+      XELOGE("Failed to translate the pixel shader!");
+      return ShadersStatus::kError;
+    }
+    return ShadersStatus::kReady;
+  }
+
+  // Request both before waiting for either so they're translated in parallel.
+  shader_translation_pool_->Request(vertex_shader, sq_program_cntl);
+  if (pixel_shader) {
+    shader_translation_pool_->Request(pixel_shader, sq_program_cntl);
+  }
+
+  bool pending = false;
+  for (VulkanShader* shader : {vertex_shader, pixel_shader}) {
+    if (!shader) {
+      continue;
+    }
+    auto status = shader_translation_pool_->GetStatus(shader);
+    if (status == ShaderTranslationPool::Status::kTranslated) {
+      continue;
+    }
+    if (status != ShaderTranslationPool::Status::kFailed) {
+      if (cvars::vulkan_skip_draws_pending_shaders) {
+        pending = true;
+        continue;
+      }
+      SCOPE_profile_cpu_i("gpu", "AwaitShaderTranslation");
+      if (shader_translation_pool_->Await(shader)) {
+        continue;
+      }
+    }
+    // Failed shaders stay failed, like with translation on this thread.
+    XELOGE("Failed to translate the %s shader!",
+           shader == vertex_shader ? "vertex" : "pixel");
+    return ShadersStatus::kError;
+  }
+  return pending ? ShadersStatus::kPending : ShadersStatus::kReady;
+}
+
 PipelineCache::UpdateStatus PipelineCache::ConfigurePipeline(
     VkCommandBuffer command_buffer, const RenderState* render_state,
     VulkanShader* vertex_shader, VulkanShader* pixel_shader,
@@ -280,7 +358,10 @@ void PipelineCache::ClearCache() {
   cached_pipelines_.clear();
   COUNT_profile_set("gpu/pipeline_cache/pipelines", 0);
 
-  // Destroy all shaders.
+  // Destroy all shaders, making sure none of them is being translated.
+  if (shader_translation_pool_) {
+    shader_translation_pool_->Clear();
+  }
   for (auto it : shader_map_) {
     delete it.second;
   }
@@ -371,6 +452,10 @@ bool PipelineCache::TranslateShader(VulkanShader* shader,
     return false;
   }
 
+  return PrepareShader(shader);
+}
+
+bool PipelineCache::PrepareShader(VulkanShader* shader) {
   // Prepare the shader for use (creates our VkShaderModule).
   // It could still fail at this point.
   if (!shader->Prepare()) {
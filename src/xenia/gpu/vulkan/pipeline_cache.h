@@ -10,11 +10,13 @@
 #ifndef XENIA_GPU_VULKAN_PIPELINE_CACHE_H_
 #define XENIA_GPU_VULKAN_PIPELINE_CACHE_H_
 
+#include <memory>
 #include <unordered_map>
 
 #include "third_party/xxhash/xxhash.h"
 
 #include "xenia/gpu/register_file.h"
+#include "xenia/gpu/shader_translation_pool.h"
 #include "xenia/gpu/spirv_shader_translator.h"
 #include "xenia/gpu/vulkan/render_cache.h"
 #include "xenia/gpu/vulkan/vulkan_shader.h"
@@ -38,6 +40,14 @@ class PipelineCache {
     kError,
   };
 
+  enum class ShadersStatus {
+    kReady,
+    // Still being translated in the background and draws aren't waiting for
+    // them.
+    kPending,
+    kError,
+  };
+
   PipelineCache(RegisterFile* register_file, ui::vulkan::VulkanDevice* device);
   ~PipelineCache();
 
@@ -50,6 +60,13 @@ class PipelineCache {
   VulkanShader* LoadShader(ShaderType shader_type, uint32_t guest_address,
                            const uint32_t* host_address, uint32_t dword_count);
 
+  // Translates the shaders for a draw if they haven't been yet, using the
+  // current SQ_PROGRAM_CNTL. With translation threads, this either waits for
+  // them or returns kPending, depending on vulkan_skip_draws_pending_shaders.
+  // The pixel shader may be null.
+  ShadersStatus EnsureShadersTranslated(VulkanShader* vertex_shader,
+                                        VulkanShader* pixel_shader);
+
   // Configures a pipeline using the current render state and the given render
   // pass. If a previously available pipeline is available it will be used,
   // otherwise a new one may be created. Any state that can be set dynamically
@@ -79,6 +96,9 @@ class PipelineCache {
   VkPipeline GetPipeline(const RenderState* render_state, uint64_t hash_key);
 
   bool TranslateShader(VulkanShader* shader, reg::SQ_PROGRAM_CNTL cntl);
+  // Creates the shader module for a translated shader and dumps it if needed.
+  // Thread-safe, called on translation threads.
+  bool PrepareShader(VulkanShader* shader);
 
   void DumpShaderDisasmAMD(VkPipeline pipeline);
   void DumpShaderDisasmNV(const VkGraphicsPipelineCreateInfo& info);
@@ -93,6 +113,8 @@ class PipelineCache {
 
   // Reusable shader translator.
   std::unique_ptr<ShaderTranslator> shader_translator_ = nullptr;
+  // Translates shaders in the background, if enabled.
+  std::unique_ptr<ShaderTranslationPool> shader_translation_pool_;
   // Disassembler used to get the SPIRV disasm. Only used in debug.
   xe::ui::spirv::SpirvDisassembler disassembler_;
   // All loaded shaders mapped by their guest hash key.
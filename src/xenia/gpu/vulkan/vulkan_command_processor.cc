@@ -199,24 +199,10 @@ void VulkanCommandProcessor::WriteRegister(uint32_t index, uint32_t value) {
   CommandProcessor::WriteRegister(index, value);
 
   if (index >= XE_GPU_REG_SHADER_CONSTANT_000_X &&
-      index <= XE_GPU_REG_SHADER_CONSTANT_511_W) {
-    uint32_t offset = index - XE_GPU_REG_SHADER_CONSTANT_000_X;
-    offset /= 4 * 4;
-    offset ^= 0x3F;
-
-    dirty_float_constants_ |= (1ull << offset);
-  } else if (index >= XE_GPU_REG_SHADER_CONSTANT_BOOL_000_031 &&
-             index <= XE_GPU_REG_SHADER_CONSTANT_BOOL_224_255) {
-    uint32_t offset = index - XE_GPU_REG_SHADER_CONSTANT_BOOL_000_031;
-    offset ^= 0x7;
-
-    dirty_bool_constants_ |= (1 << offset);
-  } else if (index >= XE_GPU_REG_SHADER_CONSTANT_LOOP_00 &&
-             index <= XE_GPU_REG_SHADER_CONSTANT_LOOP_31) {
-    uint32_t offset = index - XE_GPU_REG_SHADER_CONSTANT_LOOP_00;
-    offset ^= 0x1F;
-
-    dirty_loop_constants_ |= (1 << offset);
+      index <= XE_GPU_REG_SHADER_CONSTANT_LOOP_31) {
+    if (buffer_cache_) {
+      buffer_cache_->ConstantRegisterWritten(index);
+    }
   } else if (index == XE_GPU_REG_DC_LUT_PWL_DATA) {
     UpdateGammaRampValue(GammaRampType::kPWL, value);
   } else if (index == XE_GPU_REG_DC_LUT_30_COLOR) {
@@ -638,6 +624,18 @@ bool VulkanCommandProcessor::IssueDraw(PrimitiveType primitive_type,
     return true;
   }
 
+  // Translate the shaders before opening anything for the draw, as it may be
+  // skipped while they're being translated in the background.
+  switch (
+      pipeline_cache_->EnsureShadersTranslated(vertex_shader, pixel_shader)) {
+    case PipelineCache::ShadersStatus::kReady:
+      break;
+    case PipelineCache::ShadersStatus::kPending:
+      return true;
+    case PipelineCache::ShadersStatus::kError:
+      return false;
+  }
+
   bool full_update = false;
   if (!frame_open_) {
     BeginFrame();
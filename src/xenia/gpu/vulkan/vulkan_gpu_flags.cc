@@ -14,3 +14,16 @@ DEFINE_bool(vulkan_renderdoc_capture_all, false,
 DEFINE_bool(vulkan_native_msaa, false, "Use native MSAA", "Vulkan");
 DEFINE_bool(vulkan_dump_disasm, false,
             "Dump shader disassembly. NVIDIA only supported.", "Vulkan");
+DEFINE_int32(
+    vulkan_shader_translation_threads, -1,
+    "Number of threads used for translating shaders in the background. -1 to "
+    "calculate automatically (half of logical CPU cores), a positive number to "
+    "specify the number of threads explicitly (up to the number of logical CPU "
+    "cores), 0 to translate shaders on the command processor thread.",
+    "Vulkan");
+DEFINE_bool(
+    vulkan_skip_draws_pending_shaders, false,
+    "Skip draws whose shaders are still being translated in the background "
+    "instead of waiting for them. Removes stutter when new shaders appear, at "
+    "the cost of objects missing for a few frames.",
+    "Vulkan");
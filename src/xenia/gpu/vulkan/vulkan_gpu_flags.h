@@ -16,5 +16,7 @@
 DECLARE_bool(vulkan_renderdoc_capture_all);
 DECLARE_bool(vulkan_native_msaa);
 DECLARE_bool(vulkan_dump_disasm);
+DECLARE_int32(vulkan_shader_translation_threads);
+DECLARE_bool(vulkan_skip_draws_pending_shaders);
 
 #endif  // XENIA_GPU_VULKAN_VULKAN_GPU_FLAGS_H_
@@ -0,0 +1,89 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2020 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include "xenia/gpu/wait_reg_mem_watch.h"
+
+namespace xe {
+namespace gpu {
+
+constexpr uint32_t WaitRegMemWatch::kNotWatched;
+
+WaitRegMemWatch::WaitRegMemWatch(Memory* memory)
+    : memory_(memory),
+      watched_physical_address_(kNotWatched),
+      watched_register_(kNotWatched),
+      event_(xe::threading::Event::CreateAutoResetEvent(false)) {
+  memory_invalidation_callback_handle_ =
+      memory_->RegisterPhysicalMemoryInvalidationCallback(
+          MemoryInvalidationCallbackThunk, this);
+}
+
+WaitRegMemWatch::~WaitRegMemWatch() {
+  if (memory_invalidation_callback_handle_ != nullptr) {
+    memory_->UnregisterPhysicalMemoryInvalidationCallback(
+        memory_invalidation_callback_handle_);
+    memory_invalidation_callback_handle_ = nullptr;
+  }
+}
+
+void WaitRegMemWatch::WatchMemory(uint32_t physical_address) {
+  watched_register_.store(kNotWatched, std::memory_order_relaxed);
+  watched_physical_address_.store(physical_address & 0x1FFFFFFF,
+                                  std::memory_order_release);
+  // Pages that are already watched (by this or by other users) just keep the
+  // notifications enabled.
+  memory_->EnablePhysicalMemoryAccessCallbacks(physical_address & 0x1FFFFFFF,
+                                               sizeof(uint32_t), true, false);
+}
+
+void WaitRegMemWatch::WatchRegister(uint32_t index) {
+  watched_physical_address_.store(kNotWatched, std::memory_order_relaxed);
+  watched_register_.store(index, std::memory_order_release);
+}
+
+void WaitRegMemWatch::Unwatch() {
+  watched_physical_address_.store(kNotWatched, std::memory_order_relaxed);
+  watched_register_.store(kNotWatched, std::memory_order_relaxed);
+}
+
+void WaitRegMemWatch::RegisterWritten(uint32_t index) {
+  uint32_t watched_register = index;
+  if (watched_register_.compare_exchange_strong(watched_register, kNotWatched,
+                                                std::memory_order_acq_rel)) {
+    event_->Set();
+  }
+}
+
+bool WaitRegMemWatch::Wait(std::chrono::milliseconds timeout) {
+  return xe::threading::Wait(event_.get(), false, timeout) ==
+         xe::threading::WaitResult::kSuccess;
+}
+
+std::pair<uint32_t, uint32_t> WaitRegMemWatch::MemoryInvalidationCallback(
+    uint32_t physical_address_start, uint32_t length, bool exact_range) {
+  uint32_t watched_physical_address =
+      watched_physical_address_.load(std::memory_order_acquire);
+  if (watched_physical_address - physical_address_start < length &&
+      watched_physical_address_.compare_exchange_strong(
+          watched_physical_address, kNotWatched, std::memory_order_acq_rel)) {
+    event_->Set();
+  }
+  // Nothing is cached for the page, so any range can be unwatched.
+  return std::make_pair<uint32_t, uint32_t>(0, UINT32_MAX);
+}
+
+std::pair<uint32_t, uint32_t> WaitRegMemWatch::MemoryInvalidationCallbackThunk(
+    void* context_ptr, uint32_t physical_address_start, uint32_t length,
+    bool exact_range) {
+  return reinterpret_cast<WaitRegMemWatch*>(context_ptr)
+      ->MemoryInvalidationCallback(physical_address_start, length, exact_range);
+}
+
+}  // namespace gpu
+}  // namespace xe
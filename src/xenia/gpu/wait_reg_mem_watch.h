@@ -0,0 +1,76 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2020 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#ifndef XENIA_GPU_WAIT_REG_MEM_WATCH_H_
+#define XENIA_GPU_WAIT_REG_MEM_WATCH_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+#include "xenia/base/threading.h"
+#include "xenia/memory.h"
+
+namespace xe {
+namespace gpu {
+
+// Lets the command processor thread sleep in PM4_WAIT_REG_MEM until the polled
+// value may have changed, instead of re-reading it on a timer.
+// Memory waits use a physical memory write watch on the page containing the
+// polled word (one-shot, like all physical memory watches), register waits are
+// woken by RegisterWritten, which must be called for every register write
+// done outside the command processor thread.
+// Wakeups may be spurious (another word in the watched page was written, or a
+// watch that fired after the value was last checked is still pending), so the
+// waiter must re-check the value after every Wait. Watches must be set up
+// before the value is checked, so a write done between the check and the Wait
+// isn't missed.
+class WaitRegMemWatch {
+ public:
+  explicit WaitRegMemWatch(Memory* memory);
+  ~WaitRegMemWatch();
+
+  void WatchMemory(uint32_t physical_address);
+  void WatchRegister(uint32_t index);
+  // Stops waking on writes to the watched register or memory (though the
+  // memory page may stay protected until it's written).
+  void Unwatch();
+
+  void RegisterWritten(uint32_t index);
+  // Wakes the waiter without a write, for example, to let it exit.
+  void Interrupt() { event_->Set(); }
+
+  // Waits until the watched location may have been written or until the
+  // timeout expires, returning true in the former case. The watch is consumed
+  // by waking, and needs to be set up again before the next check.
+  bool Wait(std::chrono::milliseconds timeout);
+
+ private:
+  static constexpr uint32_t kNotWatched = UINT32_MAX;
+
+  std::pair<uint32_t, uint32_t> MemoryInvalidationCallback(
+      uint32_t physical_address_start, uint32_t length, bool exact_range);
+  static std::pair<uint32_t, uint32_t> MemoryInvalidationCallbackThunk(
+      void* context_ptr, uint32_t physical_address_start, uint32_t length,
+      bool exact_range);
+
+  Memory* memory_;
+  void* memory_invalidation_callback_handle_ = nullptr;
+
+  std::atomic<uint32_t> watched_physical_address_;
+  std::atomic<uint32_t> watched_register_;
+  std::unique_ptr<xe::threading::Event> event_;
+};
+
+}  // namespace gpu
+}  // namespace xe
+
+#endif  // XENIA_GPU_WAIT_REG_MEM_WATCH_H_
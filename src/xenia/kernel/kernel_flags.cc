@@ -14,3 +14,9 @@ DEFINE_bool(headless, false,
             "UI");
 DEFINE_bool(log_high_frequency_kernel_calls, false,
             "Log kernel calls with the kHighFrequency tag.", "Kernel");
+DEFINE_bool(log_spinlock_contention, false,
+            "Log the most contended guest spinlocks on shutdown.", "Kernel");
+DEFINE_int32(thread_block_pool_size, 16,
+             "Guest stacks, TLS and thread blocks of exited threads to keep "
+             "per size for new threads to reuse.",
+             "Kernel");
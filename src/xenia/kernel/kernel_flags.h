@@ -13,5 +13,7 @@
 
 DECLARE_bool(headless);
 DECLARE_bool(log_high_frequency_kernel_calls);
+DECLARE_bool(log_spinlock_contention);
+DECLARE_int32(thread_block_pool_size);
 
 #endif  // XENIA_KERNEL_KERNEL_FLAGS_H_
@@ -9,6 +9,7 @@
 
 #include "xenia/kernel/kernel_state.h"
 
+#include <algorithm>
 #include <string>
 
 #include "xenia/base/assert.h"
@@ -17,8 +18,10 @@
 #include "xenia/base/string.h"
 #include "xenia/cpu/processor.h"
 #include "xenia/emulator.h"
+#include "xenia/kernel/kernel_flags.h"
 #include "xenia/kernel/user_module.h"
 #include "xenia/kernel/util/shim_utils.h"
+#include "xenia/kernel/util/socket_poller.h"
 #include "xenia/kernel/xam/xam_module.h"
 #include "xenia/kernel/xboxkrnl/xboxkrnl_module.h"
 #include "xenia/kernel/xevent.h"
@@ -55,6 +58,12 @@ KernelState::KernelState(Emulator* emulator)
 
   xam::UserProfile::CreateUsers(this, user_profiles_);
 
+  thread_stack_pool_.set_max_blocks_per_size(
+      uint32_t(std::max(cvars::thread_block_pool_size, 0)));
+  spin_lock_table_.set_record_contention(cvars::log_spinlock_contention);
+  thread_block_pool_.set_max_blocks_per_size(
+      uint32_t(std::max(cvars::thread_block_pool_size, 0)));
+
   assert_null(shared_kernel_state_);
   shared_kernel_state_ = this;
 
@@ -80,6 +89,18 @@ KernelState::~KernelState() {
   // Delete all objects.
   object_table_.Reset();
 
+  // Now that the threads are gone.
+  thread_stack_pool_.Clear([this](uint32_t address, uint32_t size) {
+    memory_->LookupHeap(address)->Release(address);
+  });
+  thread_block_pool_.Clear([this](uint32_t address, uint32_t size) {
+    memory_->SystemHeapFree(address);
+  });
+
+  if (cvars::log_spinlock_contention) {
+    LogSpinLockContention();
+  }
+
   // Shutdown apps.
   app_manager_.reset();
 
@@ -89,6 +110,18 @@ KernelState::~KernelState() {
 
 KernelState* KernelState::shared() { return shared_kernel_state_; }
 
+void KernelState::LogSpinLockContention() {
+  auto contention = spin_lock_table_.GetContention();
+  XELOGI("Guest spinlock contention (%zu locks):", contention.size());
+  size_t count = std::min(contention.size(), size_t(32));
+  for (size_t i = 0; i < count; ++i) {
+    auto& entry = contention[i];
+    XELOGI("  %.8X: %llu contended, %llu yielded, %llu parked, %llu pauses",
+           entry.first, entry.second.contended, entry.second.yielded,
+           entry.second.parked, entry.second.pauses);
+  }
+}
+
 uint32_t KernelState::title_id() const {
   assert_not_null(executable_module_);
 
@@ -102,6 +135,14 @@ uint32_t KernelState::title_id() const {
   return 0;
 }
 
+util::SocketPoller* KernelState::socket_poller() {
+  auto global_lock = global_critical_region_.Acquire();
+  if (!socket_poller_) {
+    socket_poller_ = std::make_unique<util::SocketPoller>();
+  }
+  return socket_poller_.get();
+}
+
 uint32_t KernelState::process_type() const {
   auto pib =
       memory_->TranslateVirtual<ProcessInfoBlock*>(process_info_block_address_);
@@ -353,6 +394,10 @@ void KernelState::LoadKernelModule(object_ref<KernelModule> kernel_module) {
 
 object_ref<UserModule> KernelState::LoadUserModule(const char* raw_name,
                                                    bool call_entry) {
+  // Held through DllMain, so threads starting meanwhile see the module only
+  // once it has been attached.
+  std::lock_guard<std::recursive_mutex> loader_lock(loader_lock_);
+
   // Some games try to load relative to launch module, others specify full path.
   std::string name = xe::find_name_from_path(raw_name);
   std::string path(raw_name);
@@ -408,7 +453,7 @@ object_ref<UserModule> KernelState::LoadUserModule(const char* raw_name,
 
 void KernelState::UnloadUserModule(const object_ref<UserModule>& module,
                                    bool call_entry) {
-  auto global_lock = global_critical_region_.Acquire();
+  std::lock_guard<std::recursive_mutex> loader_lock(loader_lock_);
 
   if (module->is_dll_module() && module->entry_point() && call_entry) {
     // Call DllMain(DLL_PROCESS_DETACH):
@@ -423,6 +468,7 @@ void KernelState::UnloadUserModule(const object_ref<UserModule>& module,
                          xe::countof(args));
   }
 
+  auto global_lock = global_critical_region_.Acquire();
   auto iter = std::find_if(
       user_modules_.begin(), user_modules_.end(),
       [&module](const auto& e) { return e->path() == module->path(); });
@@ -545,49 +591,49 @@ void KernelState::UnregisterThread(XThread* thread) {
 }
 
 void KernelState::OnThreadExecute(XThread* thread) {
-  auto global_lock = global_critical_region_.Acquire();
-
   // Must be called on executing thread.
   assert_true(XThread::GetCurrentThread() == thread);
 
   // Call DllMain(DLL_THREAD_ATTACH) for each user module:
   // https://msdn.microsoft.com/en-us/library/windows/desktop/ms682583%28v=vs.85%29.aspx
-  auto thread_state = thread->thread_state();
-  for (auto user_module : user_modules_) {
-    if (user_module->is_dll_module() && user_module->entry_point()) {
-      uint64_t args[] = {
-          user_module->handle(),
-          2,  // DLL_THREAD_ATTACH
-          0,  // 0 because always dynamic
-      };
-      processor()->Execute(thread_state, user_module->entry_point(), args,
-                           xe::countof(args));
-    }
-  }
+  CallDllMains(thread, 2);  // DLL_THREAD_ATTACH
 }
 
 void KernelState::OnThreadExit(XThread* thread) {
-  auto global_lock = global_critical_region_.Acquire();
-
   // Must be called on executing thread.
   assert_true(XThread::GetCurrentThread() == thread);
 
   // Call DllMain(DLL_THREAD_DETACH) for each user module:
   // https://msdn.microsoft.com/en-us/library/windows/desktop/ms682583%28v=vs.85%29.aspx
-  auto thread_state = thread->thread_state();
-  for (auto user_module : user_modules_) {
-    if (user_module->is_dll_module() && user_module->entry_point()) {
-      uint64_t args[] = {
-          user_module->handle(),
-          3,  // DLL_THREAD_DETACH
-          0,  // 0 because always dynamic
-      };
-      processor()->Execute(thread_state, user_module->entry_point(), args,
-                           xe::countof(args));
+  CallDllMains(thread, 3);  // DLL_THREAD_DETACH
+
+  emulator()->processor()->OnThreadExit(thread->thread_id());
+}
+
+void KernelState::CallDllMains(XThread* thread, uint32_t reason) {
+  // Only the loader lock is held while the guest code runs, so other threads
+  // can carry on with kernel calls meanwhile.
+  std::lock_guard<std::recursive_mutex> loader_lock(loader_lock_);
+  std::vector<object_ref<UserModule>> dll_modules;
+  {
+    auto global_lock = global_critical_region_.Acquire();
+    for (auto& user_module : user_modules_) {
+      if (user_module->is_dll_module() && user_module->entry_point()) {
+        dll_modules.push_back(user_module);
+      }
     }
   }
 
-  emulator()->processor()->OnThreadExit(thread->thread_id());
+  auto thread_state = thread->thread_state();
+  for (auto& dll_module : dll_modules) {
+    uint64_t args[] = {
+        dll_module->handle(),
+        reason,
+        0,  // 0 because always dynamic
+    };
+    processor()->Execute(thread_state, dll_module->entry_point(), args,
+                         xe::countof(args));
+  }
 }
 
 object_ref<XThread> KernelState::GetThreadByID(uint32_t thread_id) {
@@ -15,14 +15,17 @@
 #include <functional>
 #include <list>
 #include <memory>
+#include <mutex>
 #include <vector>
 
 #include "xenia/base/bit_map.h"
 #include "xenia/base/cvar.h"
 #include "xenia/base/mutex.h"
 #include "xenia/cpu/export_resolver.h"
+#include "xenia/kernel/util/guest_block_pool.h"
 #include "xenia/kernel/util/native_list.h"
 #include "xenia/kernel/util/object_table.h"
+#include "xenia/kernel/util/spin_lock_table.h"
 #include "xenia/kernel/xam/app_manager.h"
 #include "xenia/kernel/xam/content_manager.h"
 #include "xenia/kernel/xam/user_profile.h"
@@ -49,6 +52,10 @@ class XNotifyListener;
 class XThread;
 class UserModule;
 
+namespace util {
+class SocketPoller;
+}  // namespace util
+
 // (?), used by KeGetCurrentProcessType
 constexpr uint32_t X_PROCTYPE_IDLE = 0;
 constexpr uint32_t X_PROCTYPE_USER = 1;
@@ -102,6 +109,8 @@ class KernelState {
   xam::ContentManager* content_manager() const {
     return content_manager_.get();
   }
+  // Created with the first socket.
+  util::SocketPoller* socket_poller();
 
   // Returns pointer to UserProfile for the given user_index
   // Returns nullptr if user_index is invalid, or user isn't signed in
@@ -176,12 +185,21 @@ class KernelState {
   void OnThreadExit(XThread* thread);
   object_ref<XThread> GetThreadByID(uint32_t thread_id);
 
+  // Stacks and system heap blocks (TLS, PCR, scratch) of exited threads, for
+  // new threads to reuse.
+  util::GuestBlockPool* thread_stack_pool() { return &thread_stack_pool_; }
+  util::GuestBlockPool* thread_block_pool() { return &thread_block_pool_; }
+
   void RegisterNotifyListener(XNotifyListener* listener);
   void UnregisterNotifyListener(XNotifyListener* listener);
   void BroadcastNotification(XNotificationID id, uint32_t data);
 
   util::NativeList* dpc_list() { return &dpc_list_; }
 
+  // Waiting and contention tracking for guest spinlocks.
+  util::SpinLockTable<>* spin_lock_table() { return &spin_lock_table_; }
+  void LogSpinLockContention();
+
   void CompleteOverlapped(uint32_t overlapped_ptr, X_RESULT result);
   void CompleteOverlappedEx(uint32_t overlapped_ptr, X_RESULT result,
                             uint32_t extended_error, uint32_t length);
@@ -199,6 +217,8 @@ class KernelState {
 
  private:
   void LoadKernelModule(object_ref<KernelModule> kernel_module);
+  // Calls DllMain of each user DLL on the thread with the reason.
+  void CallDllMains(XThread* thread, uint32_t reason);
 
   Emulator* emulator_;
   Memory* memory_;
@@ -207,6 +227,8 @@ class KernelState {
 
   std::unique_ptr<xam::AppManager> app_manager_;
   std::unique_ptr<xam::ContentManager> content_manager_;
+  // Outlives the objects in the object table, sockets included.
+  std::unique_ptr<util::SocketPoller> socket_poller_;
 
   std::unique_ptr<xam::UserProfile> user_profiles_[xam::kMaxNumUsers];
 
@@ -222,6 +244,11 @@ class KernelState {
   object_ref<UserModule> executable_module_;
   std::vector<object_ref<KernelModule>> kernel_modules_;
   std::vector<object_ref<UserModule>> user_modules_;
+  // Serializes module loads and the DllMain calls of user modules, as the
+  // loader lock does on Windows, so that they don't hold up every other guest
+  // thread in the global critical region. Must be taken before the global
+  // critical region, never while holding it.
+  std::recursive_mutex loader_lock_;
   std::vector<TerminateNotification> terminate_notifications_;
 
   uint32_t process_info_block_address_ = 0;
@@ -231,6 +258,9 @@ class KernelState {
   // Must be guarded by the global critical region.
   util::NativeList dpc_list_;
   std::condition_variable_any dispatch_cond_;
+  util::SpinLockTable<> spin_lock_table_;
+  util::GuestBlockPool thread_stack_pool_;
+  util::GuestBlockPool thread_block_pool_;
   std::list<std::function<void()>> dispatch_queue_;
 
   BitMap tls_bitmap_;
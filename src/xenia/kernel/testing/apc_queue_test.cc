@@ -0,0 +1,225 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2020 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include "xenia/kernel/util/apc_queue.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "third_party/catch/include/catch.hpp"
+
+namespace xe {
+namespace kernel {
+namespace test {
+
+// Stand-in for the guest list; entries are APC ids, taken in queue order.
+struct TestList {
+  std::deque<uint32_t> entries;
+
+  void Insert(uint32_t entry) { entries.push_back(entry); }
+  uint32_t Shift() {
+    uint32_t entry = entries.front();
+    entries.pop_front();
+    return entry;
+  }
+  bool HasPending() { return !entries.empty(); }
+};
+
+using Queue = util::ApcQueue<TestList>;
+
+void Enqueue(Queue* queue, uint32_t id) {
+  queue->Lock();
+  queue->list()->Insert(id);
+  queue->Unlock();
+}
+
+// As XThread::DeliverAPCs: the lock is dropped while each routine runs.
+void Deliver(Queue* queue, std::function<void(uint32_t id)> routine) {
+  queue->Lock();
+  while (queue->list()->HasPending()) {
+    uint32_t id = queue->list()->Shift();
+    queue->Unlock();
+    routine(id);
+    queue->Lock();
+  }
+  queue->Unlock();
+}
+
+// As XThread::CheckApcs.
+void Check(Queue* queue, std::vector<uint32_t>* delivered) {
+  if (queue->CanDeliver()) {
+    Deliver(queue, [delivered](uint32_t id) { delivered->push_back(id); });
+  }
+}
+
+TEST_CASE("apc_queue_pending", "[kernel]") {
+  Queue queue;
+  REQUIRE_FALSE(queue.pending());
+  REQUIRE_FALSE(queue.CanDeliver());
+  Enqueue(&queue, 1);
+  REQUIRE(queue.pending());
+  REQUIRE(queue.CanDeliver());
+  std::vector<uint32_t> delivered;
+  Check(&queue, &delivered);
+  REQUIRE(delivered == std::vector<uint32_t>{1});
+  REQUIRE_FALSE(queue.pending());
+}
+
+TEST_CASE("apc_queue_held_in_critical_region", "[kernel]") {
+  Queue queue;
+  std::vector<uint32_t> delivered;
+  queue.EnterCriticalRegion();
+  queue.EnterCriticalRegion();
+  Enqueue(&queue, 1);
+  Enqueue(&queue, 2);
+  Check(&queue, &delivered);
+  REQUIRE(delivered.empty());
+  // Still in the outer region.
+  queue.LeaveCriticalRegion();
+  Check(&queue, &delivered);
+  REQUIRE(delivered.empty());
+  queue.LeaveCriticalRegion();
+  Check(&queue, &delivered);
+  REQUIRE(delivered == std::vector<uint32_t>{1, 2});
+  REQUIRE(queue.critical_region_depth() == 0);
+}
+
+TEST_CASE("apc_queue_held_at_raised_irql", "[kernel]") {
+  Queue queue;
+  std::vector<uint32_t> delivered;
+  REQUIRE(queue.RaiseIrql(3) == 0);
+  Enqueue(&queue, 1);
+  Check(&queue, &delivered);
+  REQUIRE(delivered.empty());
+  REQUIRE(queue.RaiseIrql(2) == 3);
+  queue.LowerIrql(Queue::kApcLevel);
+  Check(&queue, &delivered);
+  REQUIRE(delivered.empty());
+  queue.LowerIrql(0);
+  Check(&queue, &delivered);
+  REQUIRE(delivered == std::vector<uint32_t>{1});
+}
+
+TEST_CASE("apc_queue_queued_during_delivery", "[kernel]") {
+  // Routines may queue more APCs to the same thread, which are delivered in
+  // the same pass, after those already queued.
+  Queue queue;
+  Enqueue(&queue, 1);
+  Enqueue(&queue, 2);
+  std::vector<uint32_t> delivered;
+  Deliver(&queue, [&](uint32_t id) {
+    delivered.push_back(id);
+    if (id < 3) {
+      Enqueue(&queue, id + 2);
+    }
+  });
+  REQUIRE(delivered == std::vector<uint32_t>{1, 2, 3, 4});
+  REQUIRE_FALSE(queue.pending());
+}
+
+TEST_CASE("apc_queue_queued_by_other_threads", "[kernel]") {
+  // Other threads queue while the owner keeps entering and leaving critical
+  // regions and checking. Nothing is delivered inside a region, nothing is
+  // lost, and each thread's APCs arrive in the order it queued them.
+  const uint32_t thread_count = 4;
+  const uint32_t apcs_per_thread = 2000;
+  Queue queue;
+  std::atomic<uint32_t> producers_done = {0};
+  std::vector<std::thread> producers;
+  for (uint32_t t = 0; t < thread_count; ++t) {
+    producers.emplace_back([&, t]() {
+      for (uint32_t n = 0; n < apcs_per_thread; ++n) {
+        Enqueue(&queue, (t << 16) | n);
+      }
+      producers_done.fetch_add(1);
+    });
+  }
+
+  std::vector<uint32_t> delivered;
+  bool delivered_in_region = false;
+  while (producers_done.load() != thread_count || queue.pending()) {
+    queue.EnterCriticalRegion();
+    size_t delivered_before = delivered.size();
+    Check(&queue, &delivered);
+    delivered_in_region |= delivered.size() != delivered_before;
+    queue.LeaveCriticalRegion();
+    Check(&queue, &delivered);
+  }
+  for (auto& producer : producers) {
+    producer.join();
+  }
+
+  REQUIRE_FALSE(delivered_in_region);
+  REQUIRE(delivered.size() == thread_count * apcs_per_thread);
+  std::vector<uint32_t> next(thread_count, 0);
+  for (uint32_t id : delivered) {
+    uint32_t t = id >> 16;
+    REQUIRE((id & 0xFFFF) == next[t]);
+    ++next[t];
+  }
+}
+
+TEST_CASE("apc_queue_benchmark", "[.benchmark]") {
+  // KeEnterCriticalRegion, KeLeaveCriticalRegion and the APC check after it,
+  // with no APCs queued, on every thread at once.
+  const uint32_t iterations = 1000000;
+  for (uint32_t thread_count : {1, 2, 4, 8, 16}) {
+    auto run = [&](bool global_lock) {
+      std::recursive_mutex global_mutex;
+      std::vector<std::unique_ptr<Queue>> queues;
+      for (uint32_t t = 0; t < thread_count; ++t) {
+        queues.emplace_back(std::make_unique<Queue>());
+      }
+      auto start = std::chrono::high_resolution_clock::now();
+      std::vector<std::thread> threads;
+      for (uint32_t t = 0; t < thread_count; ++t) {
+        threads.emplace_back([&, t]() {
+          auto queue = queues[t].get();
+          std::vector<uint32_t> delivered;
+          for (uint32_t n = 0; n < iterations; ++n) {
+            if (global_lock) {
+              // What the critical region and APC check used to cost.
+              global_mutex.lock();
+              global_mutex.unlock();
+              global_mutex.lock();
+              bool pending = queue->list()->HasPending();
+              global_mutex.unlock();
+              if (pending) {
+                Deliver(queue, [](uint32_t id) {});
+              }
+            } else {
+              queue->EnterCriticalRegion();
+              queue->LeaveCriticalRegion();
+              Check(queue, &delivered);
+            }
+          }
+        });
+      }
+      for (auto& thread : threads) {
+        thread.join();
+      }
+      auto elapsed = std::chrono::high_resolution_clock::now() - start;
+      return std::chrono::duration<double, std::nano>(elapsed).count() /
+             (double(iterations) * thread_count);
+    };
+    std::printf("%2u threads: %7.2f ns/op per thread, %7.2f ns/op global\n",
+                thread_count, run(false), run(true));
+  }
+}
+
+}  // namespace test
+}  // namespace kernel
+}  // namespace xe
@@ -0,0 +1,221 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2020 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include "xenia/kernel/util/guest_block_pool.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "third_party/catch/include/catch.hpp"
+
+namespace xe {
+namespace kernel {
+namespace test {
+
+TEST_CASE("guest_block_pool_reuse_by_size", "[kernel]") {
+  util::GuestBlockPool pool(2);
+  REQUIRE(pool.Acquire(0x1000) == 0);
+
+  REQUIRE(pool.Release(0x40001000, 0x1000));
+  REQUIRE(pool.Release(0x40010000, 0x2000));
+  REQUIRE(pool.Acquire(0x3000) == 0);
+  REQUIRE(pool.Acquire(0x2000) == 0x40010000);
+  REQUIRE(pool.Acquire(0x2000) == 0);
+  REQUIRE(pool.Acquire(0x1000) == 0x40001000);
+  REQUIRE(pool.Acquire(0x1000) == 0);
+
+  // Nothing to keep.
+  REQUIRE(pool.Release(0, 0x1000));
+  REQUIRE(pool.Acquire(0x1000) == 0);
+}
+
+TEST_CASE("guest_block_pool_limit", "[kernel]") {
+  util::GuestBlockPool pool(2);
+  REQUIRE(pool.Release(0x40001000, 0x1000));
+  REQUIRE(pool.Release(0x40002000, 0x1000));
+  // Past the limit the caller frees it.
+  REQUIRE_FALSE(pool.Release(0x40003000, 0x1000));
+  // Other sizes have limits of their own.
+  REQUIRE(pool.Release(0x40010000, 0x2000));
+
+  std::map<uint32_t, uint32_t> freed;
+  pool.Clear([&](uint32_t address, uint32_t size) { freed[address] = size; });
+  REQUIRE(freed.size() == 3);
+  REQUIRE(freed[0x40001000] == 0x1000);
+  REQUIRE(freed[0x40002000] == 0x1000);
+  REQUIRE(freed[0x40010000] == 0x2000);
+  REQUIRE(pool.Acquire(0x1000) == 0);
+
+  util::GuestBlockPool disabled(0);
+  REQUIRE_FALSE(disabled.Release(0x40001000, 0x1000));
+}
+
+TEST_CASE("guest_block_pool_concurrent", "[kernel]") {
+  // Every block is handed to one thread at a time.
+  const uint32_t thread_count = 8;
+  const uint32_t iterations = 20000;
+  const uint32_t block_count = 16;
+  util::GuestBlockPool pool(block_count);
+  std::vector<std::atomic<uint32_t>> owners(block_count);
+  for (uint32_t n = 0; n < block_count; ++n) {
+    owners[n] = 0;
+    REQUIRE(pool.Release(0x40000000 + n * 0x1000, 0x1000));
+  }
+  std::atomic<bool> shared = {false};
+  std::vector<std::thread> threads;
+  for (uint32_t t = 0; t < thread_count; ++t) {
+    threads.emplace_back([&, t]() {
+      for (uint32_t n = 0; n < iterations; ++n) {
+        uint32_t address = pool.Acquire(0x1000);
+        if (!address) {
+          continue;
+        }
+        auto& owner = owners[(address - 0x40000000) / 0x1000];
+        if (owner.exchange(t + 1) != 0) {
+          shared = true;
+        }
+        owner = 0;
+        pool.Release(address, 0x1000);
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  REQUIRE_FALSE(shared);
+}
+
+// Stands in for a guest heap, which is guarded by the global critical region.
+class FakeHeap {
+ public:
+  static const uint32_t kBlockStride = 0x100000;
+  static const uint32_t kMaxBlockCount = 64;
+
+  explicit FakeHeap(std::recursive_mutex* global_mutex)
+      : global_mutex_(global_mutex), blocks_(kMaxBlockCount) {}
+
+  // Zeroed, as guest heap allocations are.
+  uint32_t Alloc(uint32_t size) {
+    std::lock_guard<std::recursive_mutex> lock(*global_mutex_);
+    for (uint32_t n = 0; n < kMaxBlockCount; ++n) {
+      if (!blocks_[n]) {
+        blocks_[n].reset(new uint8_t[size]());
+        return (n + 1) * kBlockStride;
+      }
+    }
+    return 0;
+  }
+  void Free(uint32_t address) {
+    std::lock_guard<std::recursive_mutex> lock(*global_mutex_);
+    blocks_[address / kBlockStride - 1].reset();
+  }
+  uint8_t* Translate(uint32_t address) {
+    return blocks_[address / kBlockStride - 1].get();
+  }
+
+ private:
+  std::recursive_mutex* global_mutex_;
+  std::vector<std::unique_ptr<uint8_t[]>> blocks_;
+};
+
+TEST_CASE("thread_lifecycle_benchmark", "[.benchmark]") {
+  // Guest threads started and joined back to back while other threads make
+  // short kernel calls in the global critical region. Each started thread
+  // gets a stack and TLS and runs a DllMain attach and detach of a few
+  // microseconds, either as before (all of it in the global critical region,
+  // blocks from the heap) or as now (DllMain under the loader lock, blocks
+  // from the pool).
+  const uint32_t thread_count = 2000;
+  const uint32_t stack_size = 256 * 1024;
+  const uint32_t tls_size = 4096;
+  const auto dll_main_time = std::chrono::microseconds(5);
+  for (uint32_t contender_count : {0, 2, 4}) {
+    auto run = [&](bool pooled, double* kernel_calls_per_ms) {
+      std::recursive_mutex global_mutex;
+      std::recursive_mutex loader_mutex;
+      FakeHeap heap(&global_mutex);
+      util::GuestBlockPool pool;
+      auto allocate = [&](uint32_t size) {
+        uint32_t address = pooled ? pool.Acquire(size) : 0;
+        if (address) {
+          std::memset(heap.Translate(address), 0, size);
+          return address;
+        }
+        return heap.Alloc(size);
+      };
+      auto free = [&](uint32_t address, uint32_t size) {
+        if (!pooled || !pool.Release(address, size)) {
+          heap.Free(address);
+        }
+      };
+      auto dll_main = [&]() {
+        std::lock_guard<std::recursive_mutex> lock(pooled ? loader_mutex
+                                                          : global_mutex);
+        auto end = std::chrono::high_resolution_clock::now() + dll_main_time;
+        while (std::chrono::high_resolution_clock::now() < end) {
+        }
+      };
+
+      std::atomic<bool> stop = {false};
+      std::atomic<uint64_t> kernel_calls = {0};
+      std::vector<std::thread> contenders;
+      for (uint32_t c = 0; c < contender_count; ++c) {
+        contenders.emplace_back([&]() {
+          uint64_t calls = 0;
+          while (!stop) {
+            std::lock_guard<std::recursive_mutex> lock(global_mutex);
+            ++calls;
+          }
+          kernel_calls += calls;
+        });
+      }
+
+      auto start = std::chrono::high_resolution_clock::now();
+      for (uint32_t n = 0; n < thread_count; ++n) {
+        uint32_t stack = allocate(stack_size);
+        uint32_t tls = allocate(tls_size);
+        REQUIRE(stack);
+        REQUIRE(tls);
+        std::thread thread([&]() {
+          dll_main();
+          dll_main();
+        });
+        thread.join();
+        free(tls, tls_size);
+        free(stack, stack_size);
+      }
+      auto elapsed = std::chrono::high_resolution_clock::now() - start;
+      stop = true;
+      for (auto& contender : contenders) {
+        contender.join();
+      }
+      double ms = std::chrono::duration<double, std::milli>(elapsed).count();
+      *kernel_calls_per_ms = kernel_calls / ms;
+      return thread_count / ms;
+    };
+    double global_calls, loader_calls;
+    double global_rate = run(false, &global_calls);
+    double loader_rate = run(true, &loader_calls);
+    std::printf(
+        "%u contenders: global lock %6.1f threads/ms %9.0f calls/ms, "
+        "loader lock %6.1f threads/ms %9.0f calls/ms\n",
+        contender_count, global_rate, global_calls, loader_rate, loader_calls);
+  }
+}
+
+}  // namespace test
+}  // namespace kernel
+}  // namespace xe
@@ -0,0 +1,145 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2020 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include "xenia/kernel/util/native_object_cache.h"
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "third_party/catch/include/catch.hpp"
+
+namespace xe {
+namespace kernel {
+namespace test {
+
+// Mimics the XObject reference counting contract. Retaining an object after
+// its owner was told it may destroy it is recorded as a violation.
+struct FakeObject {
+  std::atomic<int32_t> ref_count = {1};
+  std::atomic<bool> alive = {true};
+  std::atomic<bool> retained_when_dead = {false};
+  void Retain() {
+    if (!alive) {
+      retained_when_dead = true;
+    }
+    ++ref_count;
+  }
+  void Release() { --ref_count; }
+};
+
+using Cache = util::NativeObjectCache<FakeObject, 64>;
+
+TEST_CASE("native_object_cache_lookup", "[kernel]") {
+  Cache cache;
+  FakeObject a, b;
+
+  REQUIRE(cache.Lookup(0x80001000, 0x100) == nullptr);
+
+  cache.Insert(0x80001000, 0x100, &a);
+  REQUIRE(cache.Lookup(0x80001000, 0x100) == &a);
+  REQUIRE(a.ref_count == 2);
+  a.Release();
+
+  // Mismatched stashed handle must miss.
+  REQUIRE(cache.Lookup(0x80001000, 0x104) == nullptr);
+
+  // Rebinding the address replaces the old entry.
+  cache.Insert(0x80001000, 0x200, &b);
+  REQUIRE(cache.Lookup(0x80001000, 0x100) == nullptr);
+  REQUIRE(cache.Lookup(0x80001000, 0x200) == &b);
+  b.Release();
+
+  cache.Evict(&b);
+  REQUIRE(cache.Lookup(0x80001000, 0x200) == nullptr);
+  REQUIRE(a.ref_count == 1);
+  REQUIRE(b.ref_count == 1);
+}
+
+TEST_CASE("native_object_cache_collisions", "[kernel]") {
+  // Fill well past capacity; every lookup either hits the right object or
+  // misses, never returns a different one.
+  Cache cache;
+  std::vector<FakeObject> objects(256);
+  for (uint32_t i = 0; i < objects.size(); ++i) {
+    cache.Insert(0x80000000 + i * 0x10, i, &objects[i]);
+  }
+  uint32_t hits = 0;
+  for (uint32_t i = 0; i < objects.size(); ++i) {
+    auto object = cache.Lookup(0x80000000 + i * 0x10, i);
+    if (object) {
+      REQUIRE(object == &objects[i]);
+      object->Release();
+      ++hits;
+    }
+  }
+  REQUIRE(hits > 0);
+  cache.Clear();
+  for (uint32_t i = 0; i < objects.size(); ++i) {
+    REQUIRE(cache.Lookup(0x80000000 + i * 0x10, i) == nullptr);
+    REQUIRE(objects[i].ref_count == 1);
+  }
+}
+
+TEST_CASE("native_object_cache_contention", "[kernel]") {
+  // Readers hammer a small set of addresses while a writer repeatedly evicts,
+  // "destroys" and rebinds the objects behind them. A reader must never
+  // retain an object after its eviction completed.
+  const uint32_t kAddressCount = 8;
+  const uint32_t kIterations = 2000;
+  Cache cache;
+  std::vector<std::unique_ptr<FakeObject>> objects(kAddressCount);
+  for (uint32_t i = 0; i < kAddressCount; ++i) {
+    objects[i].reset(new FakeObject());
+    cache.Insert(0x80000000 + i * 0x10, i, objects[i].get());
+  }
+
+  std::atomic<bool> done = {false};
+  std::vector<std::thread> readers;
+  for (uint32_t t = 0; t < 4; ++t) {
+    readers.emplace_back([&, t]() {
+      uint32_t i = t;
+      while (!done) {
+        i = (i + 1) % kAddressCount;
+        auto object = cache.Lookup(0x80000000 + i * 0x10, i);
+        if (object) {
+          object->Release();
+        }
+      }
+    });
+  }
+
+  std::vector<std::unique_ptr<FakeObject>> graveyard;
+  for (uint32_t n = 0; n < kIterations; ++n) {
+    uint32_t i = n % kAddressCount;
+    cache.Evict(objects[i].get());
+    // Readers may still hold references taken before the eviction, but no
+    // new ones may be handed out from here on.
+    objects[i]->alive = false;
+    graveyard.push_back(std::move(objects[i]));
+    objects[i].reset(new FakeObject());
+    cache.Insert(0x80000000 + i * 0x10, i, objects[i].get());
+  }
+  done = true;
+  for (auto& thread : readers) {
+    thread.join();
+  }
+  for (auto& object : graveyard) {
+    REQUIRE_FALSE(object->retained_when_dead);
+    REQUIRE(object->ref_count == 1);
+  }
+  for (auto& object : objects) {
+    REQUIRE(object->ref_count == 1);
+  }
+}
+
+}  // namespace test
+}  // namespace kernel
+}  // namespace xe
@@ -286,6 +286,10 @@ X_STATUS UserModule::Unload() {
 
   if (module_format_ == kModuleFormatXex && processor_module_ &&
       xex_module()->Unload()) {
+    // Frees the code compiled for it. Kept alive with us, as processor_module_
+    // is still used to answer queries about the module.
+    unloaded_module_ =
+        kernel_state()->processor()->RemoveModule(processor_module_);
     OnUnload();
     return X_STATUS_SUCCESS;
   }
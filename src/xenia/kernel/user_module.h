@@ -10,6 +10,7 @@
 #ifndef XENIA_KERNEL_USER_MODULE_H_
 #define XENIA_KERNEL_USER_MODULE_H_
 
+#include <memory>
 #include <string>
 
 #include "xenia/cpu/export_resolver.h"
@@ -100,6 +101,9 @@ class UserModule : public XModule {
   bool is_dll_module_ = false;
   uint32_t entry_point_ = 0;
   uint32_t stack_size_ = 0;
+
+  // processor_module_ once removed from the processor on unload.
+  std::unique_ptr<cpu::Module> unloaded_module_;
 };
 
 }  // namespace kernel
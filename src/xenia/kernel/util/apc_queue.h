@@ -0,0 +1,93 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2020 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#ifndef XENIA_KERNEL_UTIL_APC_QUEUE_H_
+#define XENIA_KERNEL_UTIL_APC_QUEUE_H_
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <utility>
+
+#include "xenia/base/assert.h"
+
+namespace xe {
+namespace kernel {
+namespace util {
+
+// APC state of a single thread, and what decides when APCs can be delivered to
+// it: the critical region depth (KernelApcDisable) and IRQL.
+//
+// The queue has a lock of its own rather than the global critical region, held
+// while the list is changed and while APCs are taken off it. Whether anything
+// is queued is published to a flag each time the lock is released, so checking
+// for APCs - which KeLeaveCriticalRegion and KfLowerIrql do on every call, and
+// which almost never finds any - takes no lock at all.
+//
+// As on NT, only the owning thread changes its critical region depth and IRQL.
+template <typename List>
+class ApcQueue {
+ public:
+  // APC_LEVEL; normal APCs are only delivered below it.
+  static constexpr uint32_t kApcLevel = 1;
+
+  ApcQueue() = default;
+  explicit ApcQueue(List list) : list_(std::move(list)) {}
+  ApcQueue(const ApcQueue&) = delete;
+  ApcQueue& operator=(const ApcQueue&) = delete;
+
+  // Only to be used with the lock held.
+  List* list() { return &list_; }
+
+  // Recursive, as kernel routines run with the lock held and may queue APCs.
+  void Lock() { mutex_.lock(); }
+  // Returns whether any APCs are queued.
+  bool Unlock() {
+    bool pending = list_.HasPending();
+    pending_.store(pending, std::memory_order_release);
+    mutex_.unlock();
+    return pending;
+  }
+  bool pending() const { return pending_.load(std::memory_order_acquire); }
+
+  void EnterCriticalRegion() { ++critical_region_depth_; }
+  void LeaveCriticalRegion() {
+    assert_not_zero(critical_region_depth_);
+    --critical_region_depth_;
+  }
+  uint32_t critical_region_depth() const { return critical_region_depth_; }
+
+  uint32_t RaiseIrql(uint32_t new_irql) {
+    return irql_.exchange(new_irql, std::memory_order_relaxed);
+  }
+  void LowerIrql(uint32_t new_irql) {
+    irql_.store(new_irql, std::memory_order_relaxed);
+  }
+  uint32_t irql() const { return irql_.load(std::memory_order_relaxed); }
+
+  // Whether the owning thread has APCs queued and can take them now.
+  bool CanDeliver() const {
+    return pending() && !critical_region_depth_ && irql() < kApcLevel;
+  }
+
+ private:
+  std::recursive_mutex mutex_;
+  std::atomic<bool> pending_ = {false};
+  List list_;
+
+  uint32_t critical_region_depth_ = 0;
+  // Other threads may look at it, as spinlock code does.
+  std::atomic<uint32_t> irql_ = {0};
+};
+
+}  // namespace util
+}  // namespace kernel
+}  // namespace xe
+
+#endif  // XENIA_KERNEL_UTIL_APC_QUEUE_H_
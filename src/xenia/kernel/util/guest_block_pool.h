@@ -0,0 +1,93 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2020 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#ifndef XENIA_KERNEL_UTIL_GUEST_BLOCK_POOL_H_
+#define XENIA_KERNEL_UTIL_GUEST_BLOCK_POOL_H_
+
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace xe {
+namespace kernel {
+namespace util {
+
+// Guest memory blocks given up by exited threads (stacks, TLS, PCRs), kept by
+// size for the next threads needing the same size so that titles creating
+// and exiting threads all the time don't go to the guest heaps each time.
+//
+// The pool only hands addresses around. What the blocks hold when they come
+// back out is up to the caller, and blocks beyond max_blocks_per_size of a
+// size must be freed by the caller as before.
+class GuestBlockPool {
+ public:
+  explicit GuestBlockPool(uint32_t max_blocks_per_size = 16)
+      : max_blocks_per_size_(max_blocks_per_size) {}
+  GuestBlockPool(const GuestBlockPool&) = delete;
+  GuestBlockPool& operator=(const GuestBlockPool&) = delete;
+
+  void set_max_blocks_per_size(uint32_t value) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    max_blocks_per_size_ = value;
+  }
+
+  // Returns a block of the size put back earlier, or 0 if there is none.
+  uint32_t Acquire(uint32_t size) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = blocks_.find(size);
+    if (it == blocks_.end() || it->second.empty()) {
+      return 0;
+    }
+    uint32_t address = it->second.back();
+    it->second.pop_back();
+    return address;
+  }
+
+  // Keeps the block for reuse. Returns false if there are enough of the size
+  // already, in which case the caller must free it.
+  bool Release(uint32_t address, uint32_t size) {
+    if (!address) {
+      return true;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto& blocks = blocks_[size];
+    if (blocks.size() >= max_blocks_per_size_) {
+      return false;
+    }
+    blocks.push_back(address);
+    return true;
+  }
+
+  // Empties the pool, calling free_block for each block it held.
+  void Clear(std::function<void(uint32_t address, uint32_t size)> free_block) {
+    std::unordered_map<uint32_t, std::vector<uint32_t>> blocks;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      blocks.swap(blocks_);
+    }
+    for (auto& size_blocks : blocks) {
+      for (uint32_t address : size_blocks.second) {
+        free_block(address, size_blocks.first);
+      }
+    }
+  }
+
+ private:
+  std::mutex mutex_;
+  uint32_t max_blocks_per_size_;
+  std::unordered_map<uint32_t, std::vector<uint32_t>> blocks_;
+};
+
+}  // namespace util
+}  // namespace kernel
+}  // namespace xe
+
+#endif  // XENIA_KERNEL_UTIL_GUEST_BLOCK_POOL_H_
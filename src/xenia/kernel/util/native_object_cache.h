@@ -0,0 +1,164 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2020 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#ifndef XENIA_KERNEL_UTIL_NATIVE_OBJECT_CACHE_H_
+#define XENIA_KERNEL_UTIL_NATIVE_OBJECT_CACHE_H_
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+
+#include "xenia/base/threading.h"
+
+namespace xe {
+namespace kernel {
+namespace util {
+
+// Maps guest dispatcher object addresses (KEVENT/KMUTANT/etc) to the host
+// objects wrapping them so that already-wrapped objects can be resolved
+// without taking the global critical region.
+//
+// Readers only touch the atomics of a single slot. Inserts and evictions are
+// serialized by a writer mutex, and an eviction waits for all in-flight
+// readers of the slot to leave before returning. As long as the owner drops
+// its reference only after Evict returns, a reader can never retain a dead
+// object.
+//
+// This is a cache, not a map: each address hashes to a single slot, colliding
+// inserts replace the older entry, and a miss just means the caller takes its
+// slow path.
+template <typename T, uint32_t kSlotCount = 4096>
+class NativeObjectCache {
+  static_assert((kSlotCount & (kSlotCount - 1)) == 0,
+                "Slot count must be a power of two");
+
+ public:
+  NativeObjectCache() = default;
+  NativeObjectCache(const NativeObjectCache&) = delete;
+  NativeObjectCache& operator=(const NativeObjectCache&) = delete;
+
+  // Returns the object cached for guest_ptr with a reference taken, or nullptr
+  // if the slot holds something else. handle must match the handle the entry
+  // was cached with, which lets callers validate against the value stashed in
+  // guest memory.
+  T* Lookup(uint32_t guest_ptr, uint32_t handle) {
+    if (!guest_ptr) {
+      return nullptr;
+    }
+    Slot& slot = slots_[SlotIndex(guest_ptr)];
+    T* object = nullptr;
+    slot.readers.fetch_add(1);
+    if (slot.guest_ptr.load() == guest_ptr && slot.handle.load() == handle) {
+      object = slot.object.load();
+      if (object) {
+        object->Retain();
+      }
+    }
+    slot.readers.fetch_sub(1);
+    return object;
+  }
+
+  // Binds guest_ptr to object. The cache does not take a reference; the
+  // caller must Evict the object before it may be destroyed.
+  void Insert(uint32_t guest_ptr, uint32_t handle, T* object) {
+    if (!guest_ptr) {
+      return;
+    }
+    std::lock_guard<std::mutex> lock(writer_mutex_);
+    Slot& slot = slots_[SlotIndex(guest_ptr)];
+    T* previous = slot.object.load();
+    if (previous == object && slot.guest_ptr.load() == guest_ptr &&
+        slot.handle.load() == handle) {
+      return;
+    }
+    if (previous) {
+      ClearSlot(slot);
+      object_addresses_.erase(previous);
+    }
+    auto it = object_addresses_.find(object);
+    if (it != object_addresses_.end()) {
+      // Object was previously bound to another address; drop that binding.
+      Slot& old_slot = slots_[SlotIndex(it->second)];
+      if (old_slot.object.load() == object) {
+        ClearSlot(old_slot);
+      }
+      object_addresses_.erase(it);
+    }
+    slot.object.store(object);
+    slot.handle.store(handle);
+    slot.guest_ptr.store(guest_ptr);
+    object_addresses_.emplace(object, guest_ptr);
+  }
+
+  // Removes any binding to object. Once this returns no reader can obtain a
+  // new reference to it through the cache.
+  void Evict(T* object) {
+    std::lock_guard<std::mutex> lock(writer_mutex_);
+    auto it = object_addresses_.find(object);
+    if (it == object_addresses_.end()) {
+      return;
+    }
+    Slot& slot = slots_[SlotIndex(it->second)];
+    if (slot.object.load() == object) {
+      ClearSlot(slot);
+    }
+    object_addresses_.erase(it);
+  }
+
+  void Clear() {
+    std::lock_guard<std::mutex> lock(writer_mutex_);
+    for (auto& entry : object_addresses_) {
+      Slot& slot = slots_[SlotIndex(entry.second)];
+      if (slot.object.load() == entry.first) {
+        ClearSlot(slot);
+      }
+    }
+    object_addresses_.clear();
+  }
+
+ private:
+  struct Slot {
+    std::atomic<uint32_t> guest_ptr = {0};
+    std::atomic<uint32_t> handle = {0};
+    std::atomic<T*> object = {nullptr};
+    // Number of readers currently inspecting the slot.
+    std::atomic<uint32_t> readers = {0};
+  };
+
+  static uint32_t SlotIndex(uint32_t guest_ptr) {
+    // Dispatcher objects are at least 8b aligned and commonly sit in arrays
+    // with a power-of-two stride, so mix the bits before masking.
+    uint32_t hash = (guest_ptr >> 3) * 0x9E3779B1u;
+    return (hash >> 16) & (kSlotCount - 1);
+  }
+
+  // Must be called with writer_mutex_ held.
+  static void ClearSlot(Slot& slot) {
+    slot.guest_ptr.store(0);
+    slot.object.store(nullptr);
+    slot.handle.store(0);
+    // Readers that got in before the clear may still retain the old object;
+    // wait for them so the owner can safely release after we return.
+    while (slot.readers.load()) {
+      xe::threading::MaybeYield();
+    }
+  }
+
+  std::mutex writer_mutex_;
+  Slot slots_[kSlotCount];
+  // Reverse mapping used for eviction. Only touched under writer_mutex_.
+  std::unordered_map<T*, uint32_t> object_addresses_;
+};
+
+}  // namespace util
+}  // namespace kernel
+}  // namespace xe
+
+#endif  // XENIA_KERNEL_UTIL_NATIVE_OBJECT_CACHE_H_
@@ -28,6 +28,8 @@ ObjectTable::~ObjectTable() { Reset(); }
 void ObjectTable::Reset() {
   auto global_lock = global_critical_region_.Acquire();
 
+  native_object_cache_.Clear();
+
   // Release all objects.
   for (uint32_t n = 0; n < table_capacity_; n++) {
     ObjectTableEntry& entry = table_[n];
@@ -206,6 +208,10 @@ X_STATUS ObjectTable::RemoveHandle(X_HANDLE handle) {
 
     XELOGI("Removed handle:%08X for %s", handle, typeid(*object).name());
 
+    // The stashed handle may be the one we just removed, and the cached
+    // binding must not outlive the table reference.
+    native_object_cache_.Evict(object);
+
     // Release now that the object has been removed from the table.
     object->Release();
   }
@@ -234,6 +240,7 @@ void ObjectTable::PurgeAllObjects() {
   for (uint32_t slot = 0; slot < table_capacity_; slot++) {
     auto& entry = table_[slot];
     if (entry.object && !entry.object->is_host_object()) {
+      native_object_cache_.Evict(entry.object);
       entry.handle_ref_count = 0;
       entry.object->Release();
 
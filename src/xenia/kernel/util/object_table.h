@@ -15,6 +15,7 @@
 #include <vector>
 
 #include "xenia/base/mutex.h"
+#include "xenia/kernel/util/native_object_cache.h"
 #include "xenia/kernel/xobject.h"
 #include "xenia/xbox.h"
 
@@ -57,6 +58,16 @@ class ObjectTable {
     return result;
   }
 
+  // Resolves a guest dispatcher object bound with CacheNativeObject without
+  // taking the global critical region. handle is the value stashed in the
+  // object's dispatch header and must match the cached binding.
+  object_ref<XObject> LookupNativeObject(uint32_t guest_ptr, X_HANDLE handle) {
+    return object_ref<XObject>(native_object_cache_.Lookup(guest_ptr, handle));
+  }
+  void CacheNativeObject(uint32_t guest_ptr, X_HANDLE handle, XObject* object) {
+    native_object_cache_.Insert(guest_ptr, handle, object);
+  }
+
   X_STATUS AddNameMapping(const std::string& name, X_HANDLE handle);
   void RemoveNameMapping(const std::string& name);
   X_STATUS GetObjectByName(const std::string& name, X_HANDLE* out_handle);
@@ -100,6 +111,9 @@ class ObjectTable {
   ObjectTableEntry* table_ = nullptr;
   uint32_t last_free_entry_ = 0;
   std::unordered_map<std::string, X_HANDLE> name_table_;
+  // Entries are evicted whenever a handle to the object is removed, before
+  // the table drops its reference.
+  NativeObjectCache<XObject> native_object_cache_;
 };
 
 // Generic lookup
@@ -0,0 +1,486 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2020 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#ifndef XENIA_KERNEL_UTIL_SOCKET_POLLER_H_
+#define XENIA_KERNEL_UTIL_SOCKET_POLLER_H_
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "xenia/base/platform.h"
+
+#if XE_PLATFORM_WIN32
+// clang-format off
+#include "xenia/base/platform_win.h"
+#include <WinSock2.h>
+// clang-format on
+#else
+#include <poll.h>
+#include <unistd.h>
+#endif  // XE_PLATFORM_WIN32
+
+#if XE_PLATFORM_LINUX
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#endif  // XE_PLATFORM_LINUX
+
+namespace xe {
+namespace kernel {
+namespace util {
+
+// What select() reports a socket as.
+enum SocketReadiness : uint32_t {
+  kSocketReadable = 1 << 0,
+  kSocketWritable = 1 << 1,
+  kSocketException = 1 << 2,
+};
+
+// Tracks the readiness of host sockets for select() and event notification.
+//
+// On Linux every socket is registered once with an edge-triggered epoll set,
+// which a thread of the poller waits on, caching what each socket has become
+// ready for. Sockets without cached readiness can't be ready, so select() only
+// has to confirm the others - in one poll() call, as data may have been read
+// since - and otherwise sleeps until an edge arrives for one of its sockets.
+// A select() of only a few sockets is cheaper as one blocking poll() of them
+// than as a wait for the poller thread to pass their edges on, so is done that
+// way. Elsewhere select() is always a single poll() of all of its sockets.
+class SocketPoller {
+ public:
+  class Registration {
+   public:
+    uint64_t native_handle() const { return native_handle_; }
+    // May be stale in the ready direction, never in the other.
+    uint32_t cached_readiness() const {
+      return readiness_.load(std::memory_order_acquire);
+    }
+
+   private:
+    friend class SocketPoller;
+
+    uint64_t native_handle_ = 0;
+    std::atomic<uint32_t> readiness_ = {0};
+    // Bumped with the poller mutex held on each edge, so readiness is only
+    // cleared if nothing arrived since it was checked.
+    std::atomic<uint32_t> edge_count_ = {0};
+    std::atomic<bool> unregistered_ = {false};
+    uint32_t observer_interest_ = 0;
+    std::function<void()> observer_;
+  };
+
+  struct Query {
+    std::shared_ptr<Registration> registration;
+    // SocketReadiness bits asked for, and those found.
+    uint32_t interest;
+    uint32_t ready;
+  };
+
+  static const size_t kMaxDirectPollCount = 16;
+
+  // Selects of up to direct_poll_count sockets (at most kMaxDirectPollCount)
+  // poll them directly.
+  explicit SocketPoller(size_t direct_poll_count = kMaxDirectPollCount)
+      : direct_poll_count_(direct_poll_count < kMaxDirectPollCount
+                               ? direct_poll_count
+                               : kMaxDirectPollCount) {
+#if XE_PLATFORM_LINUX
+    epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+    wake_fd_ = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    epoll_event event = {};
+    event.events = EPOLLIN;
+    event.data.ptr = nullptr;
+    epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, wake_fd_, &event);
+    thread_ = std::thread([this]() { PollThread(); });
+#endif  // XE_PLATFORM_LINUX
+  }
+
+  ~SocketPoller() {
+#if XE_PLATFORM_LINUX
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stopping_ = true;
+    }
+    uint64_t value = 1;
+    ssize_t written = write(wake_fd_, &value, sizeof(value));
+    (void)written;
+    thread_.join();
+    close(wake_fd_);
+    close(epoll_fd_);
+#endif  // XE_PLATFORM_LINUX
+  }
+
+  SocketPoller(const SocketPoller&) = delete;
+  SocketPoller& operator=(const SocketPoller&) = delete;
+
+  // To be unregistered before the socket is closed.
+  std::shared_ptr<Registration> Register(uint64_t native_handle) {
+    auto registration = std::make_shared<Registration>();
+    registration->native_handle_ = native_handle;
+#if XE_PLATFORM_LINUX
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      registrations_[registration.get()] = registration;
+    }
+    // Reports whatever the socket is already ready for.
+    epoll_event event = {};
+    event.events = EPOLLIN | EPOLLOUT | EPOLLPRI | EPOLLRDHUP | EPOLLET;
+    event.data.ptr = registration.get();
+    epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, int(native_handle), &event);
+#else
+    // Always confirmed by poll.
+    registration->readiness_ =
+        kSocketReadable | kSocketWritable | kSocketException;
+#endif  // XE_PLATFORM_LINUX
+    return registration;
+  }
+
+  // Selects waiting on the socket fail, as they would on a closed socket.
+  void Unregister(Registration* registration) {
+#if XE_PLATFORM_LINUX
+    epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, int(registration->native_handle_),
+              nullptr);
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      registration->observer_ = nullptr;
+      registration->unregistered_ = true;
+      ++registration->edge_count_;
+      registrations_.erase(registration);
+      for (auto waiter : direct_waiters_) {
+        if (!waiter->woken) {
+          waiter->woken = true;
+          uint64_t value = 1;
+          ssize_t written = write(waiter->wake_fd, &value, sizeof(value));
+          (void)written;
+        }
+      }
+    }
+    edge_changed_.notify_all();
+#else
+    registration->unregistered_ = true;
+#endif  // XE_PLATFORM_LINUX
+  }
+
+  // Calls observer from the poller thread whenever the socket becomes ready
+  // for anything in interest, and now if it may already be. An interest of 0
+  // removes it. Returns false where there's no poller thread.
+  bool SetObserver(Registration* registration, uint32_t interest,
+                   std::function<void()> observer) {
+#if XE_PLATFORM_LINUX
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      registration->observer_interest_ = interest;
+      registration->observer_ = interest ? observer : nullptr;
+    }
+    if (interest && (registration->cached_readiness() & interest)) {
+      observer();
+    }
+    return true;
+#else
+    return false;
+#endif  // XE_PLATFORM_LINUX
+  }
+
+  // As select(): fills in what each query's socket is ready for, waiting up to
+  // timeout_us (forever if negative) for any to be. Returns how many queries
+  // have ready bits, or -1 if polling failed or a socket was unregistered.
+  int Select(Query* queries, size_t count, int64_t timeout_us) {
+#if XE_PLATFORM_LINUX
+    if (count <= direct_poll_count_) {
+      return SelectDirect(queries, count, timeout_us);
+    }
+    auto deadline = std::chrono::steady_clock::now() +
+                    std::chrono::microseconds(std::max<int64_t>(timeout_us, 0));
+#endif  // XE_PLATFORM_LINUX
+    std::vector<uint32_t> edge_counts(count);
+    std::vector<size_t> candidates;
+    std::vector<pollfd> poll_fds;
+    while (true) {
+      for (size_t i = 0; i < count; ++i) {
+        if (queries[i].registration->unregistered_) {
+          return -1;
+        }
+      }
+#if XE_PLATFORM_LINUX
+      for (size_t i = 0; i < count; ++i) {
+        edge_counts[i] = queries[i].registration->edge_count_.load(
+            std::memory_order_acquire);
+      }
+#endif  // XE_PLATFORM_LINUX
+      candidates.clear();
+      poll_fds.clear();
+      for (size_t i = 0; i < count; ++i) {
+        queries[i].ready = 0;
+        if (queries[i].registration->cached_readiness() &
+            queries[i].interest) {
+          candidates.push_back(i);
+          poll_fds.push_back(
+              {PollHandle(queries[i].registration->native_handle_),
+               PollEvents(queries[i].interest), 0});
+        }
+      }
+
+      int ready_count = 0;
+      if (!candidates.empty()) {
+#if XE_PLATFORM_LINUX
+        int poll_timeout_ms = 0;
+#else
+        int poll_timeout_ms =
+            timeout_us < 0 ? -1 : int((timeout_us + 999) / 1000);
+#endif  // XE_PLATFORM_LINUX
+        ++syscall_count_;
+        if (PollSockets(poll_fds.data(), poll_fds.size(), poll_timeout_ms) <
+            0) {
+          return -1;
+        }
+        for (size_t n = 0; n < candidates.size(); ++n) {
+          auto& query = queries[candidates[n]];
+          query.ready = Translate(poll_fds[n].revents) & query.interest;
+          if (query.ready) {
+            ++ready_count;
+          }
+#if XE_PLATFORM_LINUX
+          uint32_t not_ready = query.interest & ~query.ready;
+          if (not_ready) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (query.registration->edge_count_ == edge_counts[candidates[n]]) {
+              query.registration->readiness_ &= ~not_ready;
+            }
+          }
+#endif  // XE_PLATFORM_LINUX
+        }
+      }
+#if !XE_PLATFORM_LINUX
+      return ready_count;
+#else
+      if (ready_count || timeout_us == 0) {
+        return ready_count;
+      }
+
+      // Sleep until an edge for one of the sockets, or the deadline.
+      auto edge_arrived = [&]() {
+        for (size_t i = 0; i < count; ++i) {
+          if (queries[i].registration->edge_count_ != edge_counts[i]) {
+            return true;
+          }
+        }
+        return false;
+      };
+      std::unique_lock<std::mutex> lock(mutex_);
+      if (timeout_us < 0) {
+        edge_changed_.wait(lock, edge_arrived);
+      } else if (!edge_changed_.wait_until(lock, deadline, edge_arrived)) {
+        return 0;
+      }
+#endif  // !XE_PLATFORM_LINUX
+    }
+  }
+
+  // poll and epoll_wait calls made so far.
+  uint64_t syscall_count() const { return syscall_count_; }
+
+ private:
+#if XE_PLATFORM_WIN32
+  using pollfd = WSAPOLLFD;
+  static SOCKET PollHandle(uint64_t native_handle) {
+    return SOCKET(native_handle);
+  }
+  static int PollSockets(pollfd* fds, size_t count, int timeout_ms) {
+    return WSAPoll(fds, ULONG(count), timeout_ms);
+  }
+#else
+  static int PollHandle(uint64_t native_handle) { return int(native_handle); }
+  static int PollSockets(pollfd* fds, size_t count, int timeout_ms) {
+    return poll(fds, nfds_t(count), timeout_ms);
+  }
+#endif  // XE_PLATFORM_WIN32
+
+  static short PollEvents(uint32_t interest) {
+    short events = 0;
+    if (interest & kSocketReadable) {
+      events |= POLLIN;
+    }
+    if (interest & kSocketWritable) {
+      events |= POLLOUT;
+    }
+#if !XE_PLATFORM_WIN32
+    // WSAPoll refuses POLLPRI; exceptions are only reported as errors there.
+    if (interest & kSocketException) {
+      events |= POLLPRI;
+    }
+#endif  // !XE_PLATFORM_WIN32
+    return events;
+  }
+
+  // Hang ups read as end of stream, and errors fail whatever is tried next, as
+  // select() has it.
+  static uint32_t Translate(short revents) {
+    uint32_t readiness = 0;
+    if (revents & (POLLIN | POLLHUP | POLLERR)) {
+      readiness |= kSocketReadable;
+    }
+    if (revents & (POLLOUT | POLLHUP | POLLERR)) {
+      readiness |= kSocketWritable;
+    }
+    if (revents & (POLLPRI | POLLERR)) {
+      readiness |= kSocketException;
+    }
+    return readiness;
+  }
+
+#if XE_PLATFORM_LINUX
+  // A thread in SelectDirect, which Unregister interrupts through wake_fd.
+  struct DirectWaiter {
+    int wake_fd;
+    bool woken;
+  };
+
+  // An eventfd per selecting thread, polled along with its sockets.
+  static int ThreadWakeFd() {
+    struct WakeFd {
+      int fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+      ~WakeFd() { close(fd); }
+    };
+    static thread_local WakeFd wake_fd;
+    return wake_fd.fd;
+  }
+
+  int SelectDirect(Query* queries, size_t count, int64_t timeout_us) {
+    DirectWaiter waiter = {ThreadWakeFd(), false};
+    pollfd poll_fds[kMaxDirectPollCount + 1];
+    for (size_t i = 0; i < count; ++i) {
+      poll_fds[i] = {PollHandle(queries[i].registration->native_handle_),
+                     PollEvents(queries[i].interest), 0};
+    }
+    poll_fds[count] = {waiter.wake_fd, POLLIN, 0};
+    auto unregistered = [&]() {
+      for (size_t i = 0; i < count; ++i) {
+        if (queries[i].registration->unregistered_) {
+          return true;
+        }
+      }
+      return false;
+    };
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (unregistered()) {
+        return -1;
+      }
+      direct_waiters_.push_back(&waiter);
+    }
+
+    int poll_timeout_ms = timeout_us < 0 ? -1 : int((timeout_us + 999) / 1000);
+    ++syscall_count_;
+    int result = PollSockets(poll_fds, count + 1, poll_timeout_ms);
+
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      direct_waiters_.erase(std::find(direct_waiters_.begin(),
+                                      direct_waiters_.end(), &waiter));
+    }
+    if (waiter.woken) {
+      uint64_t value;
+      ssize_t read_size = read(waiter.wake_fd, &value, sizeof(value));
+      (void)read_size;
+    }
+    if (result < 0 || unregistered()) {
+      return -1;
+    }
+    int ready_count = 0;
+    for (size_t i = 0; i < count; ++i) {
+      queries[i].ready = Translate(poll_fds[i].revents) & queries[i].interest;
+      if (queries[i].ready) {
+        ++ready_count;
+      }
+    }
+    return ready_count;
+  }
+
+  static uint32_t TranslateEpoll(uint32_t events) {
+    uint32_t readiness = 0;
+    if (events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) {
+      readiness |= kSocketReadable;
+    }
+    if (events & (EPOLLOUT | EPOLLHUP | EPOLLERR)) {
+      readiness |= kSocketWritable;
+    }
+    if (events & (EPOLLPRI | EPOLLERR)) {
+      readiness |= kSocketException;
+    }
+    return readiness;
+  }
+
+  void PollThread() {
+    epoll_event events[64];
+    std::vector<std::function<void()>> observers;
+    while (true) {
+      int event_count = epoll_wait(epoll_fd_, events, 64, -1);
+      ++syscall_count_;
+      if (event_count < 0) {
+        continue;
+      }
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (stopping_) {
+          return;
+        }
+        for (int i = 0; i < event_count; ++i) {
+          auto it = registrations_.find(
+              static_cast<Registration*>(events[i].data.ptr));
+          if (it == registrations_.end()) {
+            // The wake event, or a socket unregistered since.
+            continue;
+          }
+          Registration* registration = it->first;
+          uint32_t readiness = TranslateEpoll(events[i].events);
+          registration->readiness_ |= readiness;
+          ++registration->edge_count_;
+          if (registration->observer_interest_ & readiness) {
+            observers.push_back(registration->observer_);
+          }
+        }
+      }
+      edge_changed_.notify_all();
+      for (auto& observer : observers) {
+        observer();
+      }
+      observers.clear();
+    }
+  }
+
+  int epoll_fd_ = -1;
+  // Written to stop the thread.
+  int wake_fd_ = -1;
+  std::thread thread_;
+  bool stopping_ = false;
+  // Keeps registrations alive while events for them may be in flight.
+  std::unordered_map<Registration*, std::shared_ptr<Registration>>
+      registrations_;
+  std::condition_variable edge_changed_;
+  std::vector<DirectWaiter*> direct_waiters_;
+#endif  // XE_PLATFORM_LINUX
+
+  size_t direct_poll_count_;
+  std::mutex mutex_;
+  std::atomic<uint64_t> syscall_count_ = {0};
+};
+
+}  // namespace util
+}  // namespace kernel
+}  // namespace xe
+
+#endif  // XENIA_KERNEL_UTIL_SOCKET_POLLER_H_
@@ -0,0 +1,203 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2020 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#ifndef XENIA_KERNEL_UTIL_SPIN_LOCK_TABLE_H_
+#define XENIA_KERNEL_UTIL_SPIN_LOCK_TABLE_H_
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "xenia/base/atomic.h"
+#include "xenia/base/platform.h"
+#include "xenia/base/threading.h"
+
+namespace xe {
+namespace kernel {
+namespace util {
+
+// Contention counters for a single guest spinlock. Only acquisitions that
+// failed their first attempt are recorded.
+struct SpinLockContention {
+  // Acquisitions that had to wait at all.
+  uint64_t contended = 0;
+  // Of those, acquisitions that gave up spinning and yielded.
+  uint64_t yielded = 0;
+  // Of those, acquisitions that had to park.
+  uint64_t parked = 0;
+  // Total pause instructions issued while spinning.
+  uint64_t pauses = 0;
+};
+
+// Host side of guest spinlocks (KSPIN_LOCK). The lock word in guest memory
+// stays the source of truth: 0 is free and taking it is a CAS to 1, so guest
+// code that touches the word directly still interoperates.
+//
+// Waiting is adaptive. Lock holders are often guest threads the host has
+// preempted, which happens whenever there are fewer free host cores than
+// guest hardware threads, so spinning for long just burns the timeslice the
+// holder needs. Waiters spin with exponential pause backoff, then yield, then
+// park on a condition variable in a bucket hashed from the guest address and
+// are woken by Release. Parks time out and re-check the word, so a guest that
+// releases the lock inline without calling into the kernel only costs the
+// waiter latency, never a deadlock.
+template <uint32_t kBucketCount = 64>
+class SpinLockTable {
+  static_assert((kBucketCount & (kBucketCount - 1)) == 0,
+                "Bucket count must be a power of two");
+
+ public:
+  // Pauses spent spinning before starting to yield.
+  static constexpr uint32_t kMaxSpinPauses = 4096;
+  static constexpr uint32_t kMaxPauseBatch = 64;
+  // Yields before parking.
+  static constexpr uint32_t kMaxYields = 16;
+  static constexpr std::chrono::milliseconds kParkTimeout{1};
+
+  SpinLockTable() = default;
+  SpinLockTable(const SpinLockTable&) = delete;
+  SpinLockTable& operator=(const SpinLockTable&) = delete;
+
+  static bool TryAcquire(uint32_t* lock) {
+    return xe::atomic_cas(0u, 1u, lock);
+  }
+
+  void Acquire(uint32_t guest_address, uint32_t* lock) {
+    if (TryAcquire(lock)) {
+      return;
+    }
+    SpinLockContention contention;
+    contention.contended = 1;
+    auto volatile_lock = reinterpret_cast<volatile uint32_t*>(lock);
+
+    // Spin on plain reads so the line isn't bounced around while it's held.
+    uint32_t batch = 1;
+    while (contention.pauses < kMaxSpinPauses) {
+      for (uint32_t i = 0; i < batch; ++i) {
+        _mm_pause();
+      }
+      contention.pauses += batch;
+      if (!*volatile_lock && TryAcquire(lock)) {
+        RecordContention(guest_address, contention);
+        return;
+      }
+      batch = std::min(batch * 2, uint32_t(kMaxPauseBatch));
+    }
+
+    // The holder is probably not running; give it our core.
+    contention.yielded = 1;
+    for (uint32_t i = 0; i < kMaxYields; ++i) {
+      xe::threading::MaybeYield();
+      if (!*volatile_lock && TryAcquire(lock)) {
+        RecordContention(guest_address, contention);
+        return;
+      }
+    }
+
+    contention.parked = 1;
+    Bucket& bucket = buckets_[BucketIndex(guest_address)];
+    while (true) {
+      {
+        std::unique_lock<std::mutex> bucket_lock(bucket.mutex);
+        // Publish ourselves before the final check; Release reads waiters
+        // after freeing the word, so one of us always sees the other.
+        bucket.waiters.fetch_add(1);
+        if (*volatile_lock) {
+          bucket.cond.wait_for(bucket_lock, kParkTimeout);
+        }
+        bucket.waiters.fetch_sub(1);
+      }
+      if (TryAcquire(lock)) {
+        break;
+      }
+    }
+    RecordContention(guest_address, contention);
+  }
+
+  void Release(uint32_t guest_address, uint32_t* lock) {
+    xe::atomic_dec(lock);
+    Bucket& bucket = buckets_[BucketIndex(guest_address)];
+    if (bucket.waiters.load()) {
+      // Taking the mutex orders us after any waiter between its check and
+      // its wait.
+      std::lock_guard<std::mutex> bucket_lock(bucket.mutex);
+      bucket.cond.notify_all();
+    }
+  }
+
+  // Contention is only counted once this is set, as counting serializes
+  // contended acquisitions of every lock.
+  void set_record_contention(bool value) { record_contention_ = value; }
+
+  // Returns the counters of every lock that has seen contention, most
+  // contended first.
+  std::vector<std::pair<uint32_t, SpinLockContention>> GetContention() {
+    std::vector<std::pair<uint32_t, SpinLockContention>> result;
+    {
+      std::lock_guard<std::mutex> lock(contention_mutex_);
+      result.assign(contention_.begin(), contention_.end());
+    }
+    std::sort(result.begin(), result.end(),
+              [](const auto& a, const auto& b) {
+                return a.second.contended > b.second.contended;
+              });
+    return result;
+  }
+
+  void ResetContention() {
+    std::lock_guard<std::mutex> lock(contention_mutex_);
+    contention_.clear();
+  }
+
+ private:
+  struct Bucket {
+    std::mutex mutex;
+    std::condition_variable cond;
+    std::atomic<uint32_t> waiters = {0};
+  };
+
+  static uint32_t BucketIndex(uint32_t guest_address) {
+    uint32_t hash = (guest_address >> 2) * 0x9E3779B1u;
+    return (hash >> 16) & (kBucketCount - 1);
+  }
+
+  void RecordContention(uint32_t guest_address,
+                        const SpinLockContention& contention) {
+    if (!record_contention_) {
+      return;
+    }
+    std::lock_guard<std::mutex> lock(contention_mutex_);
+    auto& entry = contention_[guest_address];
+    entry.contended += contention.contended;
+    entry.yielded += contention.yielded;
+    entry.parked += contention.parked;
+    entry.pauses += contention.pauses;
+  }
+
+  Bucket buckets_[kBucketCount];
+  bool record_contention_ = false;
+  // Only touched on contended paths, when recording.
+  std::mutex contention_mutex_;
+  std::unordered_map<uint32_t, SpinLockContention> contention_;
+};
+
+template <uint32_t kBucketCount>
+constexpr std::chrono::milliseconds SpinLockTable<kBucketCount>::kParkTimeout;
+
+}  // namespace util
+}  // namespace kernel
+}  // namespace xe
+
+#endif  // XENIA_KERNEL_UTIL_SPIN_LOCK_TABLE_H_
@@ -7,13 +7,16 @@
  ******************************************************************************
  */
 
+#include <algorithm>
 #include <cstring>
+#include <vector>
 
 #include "xenia/base/clock.h"
 #include "xenia/base/logging.h"
 #include "xenia/base/cvar.h"
 #include "xenia/kernel/kernel_state.h"
 #include "xenia/kernel/util/shim_utils.h"
+#include "xenia/kernel/util/socket_poller.h"
 #include "xenia/kernel/xam/xam_module.h"
 #include "xenia/kernel/xam/xam_private.h"
 #include "xenia/kernel/xboxkrnl/xboxkrnl_error.h"
@@ -417,6 +420,36 @@ dword_result_t NetDll_WSAWaitForMultipleEvents(dword_t num_events,
 DECLARE_XAM_EXPORT2(NetDll_WSAWaitForMultipleEvents, kNetworking, kImplemented,
                     kBlocking);
 
+int_result_t NetDll_WSAEventSelect(dword_t caller, dword_t socket_handle,
+                                   dword_t event_handle,
+                                   dword_t network_events) {
+  auto socket =
+      kernel_state()->object_table()->LookupObject<XSocket>(socket_handle);
+  if (!socket) {
+    // WSAENOTSOCK
+    XThread::SetLastError(0x2736);
+    return -1;
+  }
+  object_ref<XEvent> event;
+  if (network_events) {
+    event = kernel_state()->object_table()->LookupObject<XEvent>(event_handle);
+    if (!event) {
+      // WSAEINVAL
+      XThread::SetLastError(0x2726);
+      return -1;
+    }
+  }
+
+  X_STATUS result = socket->EventSelect(event, network_events);
+  if (XFAILED(result)) {
+    // WSAEINVAL
+    XThread::SetLastError(0x2726);
+    return -1;
+  }
+  return 0;
+}
+DECLARE_XAM_EXPORT1(NetDll_WSAEventSelect, kNetworking, kImplemented);
+
 dword_result_t NetDll_WSACreateEvent() {
   XEvent* ev = new XEvent(kernel_state());
   ev->Initialize(true, false);
@@ -822,10 +855,13 @@ struct x_fd_set {
 struct host_set {
   uint32_t count;
   object_ref<XSocket> sockets[64];
+  // Taken once, as Close may drop the socket's own at any time.
+  std::shared_ptr<util::SocketPoller::Registration> registrations[64];
 
-  void Load(const x_fd_set* guest_set) {
-    assert_true(guest_set->fd_count < 64);
-    this->count = guest_set->fd_count;
+  // Returns false if any handle isn't an open socket.
+  bool Load(const x_fd_set* guest_set) {
+    assert_true(guest_set->fd_count <= 64);
+    this->count = std::min(uint32_t(guest_set->fd_count), 64u);
     for (uint32_t i = 0; i < this->count; ++i) {
       auto socket_handle = static_cast<X_HANDLE>(guest_set->fd_array[i]);
       if (socket_handle == -1) {
@@ -835,9 +871,17 @@ struct host_set {
       // Convert from Xenia -> native
       auto socket =
           kernel_state()->object_table()->LookupObject<XSocket>(socket_handle);
-      assert_not_null(socket);
+      if (!socket) {
+        return false;
+      }
+      auto registration = socket->poll_registration();
+      if (!registration) {
+        return false;
+      }
       this->sockets[i] = socket;
+      this->registrations[i] = std::move(registration);
     }
+    return true;
   }
 
   void Store(x_fd_set* guest_set) {
@@ -848,18 +892,20 @@ struct host_set {
     }
   }
 
-  void Store(fd_set* native_set) {
-    FD_ZERO(native_set);
+  void AddQueries(uint32_t interest,
+                  std::vector<util::SocketPoller::Query>* queries) {
     for (uint32_t i = 0; i < this->count; ++i) {
-      FD_SET(this->sockets[i]->native_handle(), native_set);
+      queries->push_back({this->registrations[i], interest, 0});
     }
   }
 
-  void UpdateFrom(fd_set* native_set) {
+  // Keeps the sockets found ready by the queries AddQueries added.
+  void UpdateFrom(const util::SocketPoller::Query* queries) {
     uint32_t new_count = 0;
     for (uint32_t i = 0; i < this->count; ++i) {
       auto socket = this->sockets[i];
-      if (FD_ISSET(socket->native_handle(), native_set)) {
+      if (queries[i].ready) {
+        this->registrations[new_count] = this->registrations[i];
         this->sockets[new_count++] = socket;
       }
     }
@@ -867,56 +913,60 @@ struct host_set {
   }
 };
 
+// Served from the readiness the kernel's socket poller keeps for every socket,
+// rather than building host fd_sets each call. As on Windows, nfds is ignored.
 int_result_t NetDll_select(int_t caller, int_t nfds,
                            pointer_t<x_fd_set> readfds,
                            pointer_t<x_fd_set> writefds,
                            pointer_t<x_fd_set> exceptfds,
                            lpvoid_t timeout_ptr) {
   host_set host_readfds = {0};
-  fd_set native_readfds = {0};
-  if (readfds) {
-    host_readfds.Load(readfds);
-    host_readfds.Store(&native_readfds);
-  }
   host_set host_writefds = {0};
-  fd_set native_writefds = {0};
-  if (writefds) {
-    host_writefds.Load(writefds);
-    host_writefds.Store(&native_writefds);
-  }
   host_set host_exceptfds = {0};
-  fd_set native_exceptfds = {0};
-  if (exceptfds) {
-    host_exceptfds.Load(exceptfds);
-    host_exceptfds.Store(&native_exceptfds);
+  if ((readfds && !host_readfds.Load(readfds)) ||
+      (writefds && !host_writefds.Load(writefds)) ||
+      (exceptfds && !host_exceptfds.Load(exceptfds))) {
+    // WSAENOTSOCK
+    XThread::SetLastError(0x2736);
+    return -1;
   }
-  timeval* timeout_in = nullptr;
-  timeval timeout;
+  std::vector<util::SocketPoller::Query> queries;
+  host_readfds.AddQueries(util::kSocketReadable, &queries);
+  host_writefds.AddQueries(util::kSocketWritable, &queries);
+  host_exceptfds.AddQueries(util::kSocketException, &queries);
+
+  int64_t timeout_us = -1;
   if (timeout_ptr) {
-    timeout = {static_cast<int32_t>(timeout_ptr.as_array<int32_t>()[0]),
-               static_cast<int32_t>(timeout_ptr.as_array<int32_t>()[1])};
-    Clock::ScaleGuestDurationTimeval(
-        reinterpret_cast<int32_t*>(&timeout.tv_sec),
-        reinterpret_cast<int32_t*>(&timeout.tv_usec));
-    timeout_in = &timeout;
+    int32_t timeout_sec = timeout_ptr.as_array<int32_t>()[0];
+    int32_t timeout_usec = timeout_ptr.as_array<int32_t>()[1];
+    Clock::ScaleGuestDurationTimeval(&timeout_sec, &timeout_usec);
+    timeout_us = int64_t(timeout_sec) * 1000000 + timeout_usec;
   }
-  int ret = select(nfds, readfds ? &native_readfds : nullptr,
-                   writefds ? &native_writefds : nullptr,
-                   exceptfds ? &native_exceptfds : nullptr, timeout_in);
+  int ret = kernel_state()->socket_poller()->Select(queries.data(),
+                                                    queries.size(), timeout_us);
+  if (ret < 0) {
+    // WSAEINVAL
+    XThread::SetLastError(0x2726);
+    return -1;
+  }
+
+  // The queries are in the order of the sets.
+  auto write_queries = queries.data() + host_readfds.count;
+  auto except_queries = write_queries + host_writefds.count;
   if (readfds) {
-    host_readfds.UpdateFrom(&native_readfds);
+    host_readfds.UpdateFrom(queries.data());
     host_readfds.Store(readfds);
   }
   if (writefds) {
-    host_writefds.UpdateFrom(&native_writefds);
+    host_writefds.UpdateFrom(write_queries);
     host_writefds.Store(writefds);
   }
   if (exceptfds) {
-    host_exceptfds.UpdateFrom(&native_exceptfds);
+    host_exceptfds.UpdateFrom(except_queries);
     host_exceptfds.Store(exceptfds);
   }
 
-  // TODO(gibbed): modify ret to be what's actually copied to the guest fd_sets?
+  // As select(), the number of handles left across the sets.
   return ret;
 }
 DECLARE_XAM_EXPORT1(NetDll_select, kNetworking, kImplemented);
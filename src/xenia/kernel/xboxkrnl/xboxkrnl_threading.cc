@@ -876,11 +876,8 @@ uint32_t xeKeKfAcquireSpinLock(uint32_t* lock) {
   //     lock_ptr);
 
   // Lock.
-  while (!xe::atomic_cas(0, 1, lock)) {
-    // Spin!
-    // TODO(benvanik): error on deadlock?
-    xe::threading::MaybeYield();
-  }
+  kernel_state()->spin_lock_table()->Acquire(
+      kernel_memory()->HostToGuestVirtual(lock), lock);
 
   // Raise IRQL to DISPATCH.
   XThread* thread = XThread::GetCurrentThread();
@@ -902,7 +899,8 @@ void xeKeKfReleaseSpinLock(uint32_t* lock, dword_t old_irql) {
   thread->LowerIrql(old_irql);
 
   // Unlock.
-  xe::atomic_dec(lock);
+  kernel_state()->spin_lock_table()->Release(
+      kernel_memory()->HostToGuestVirtual(lock), lock);
 }
 
 void KfReleaseSpinLock(lpdword_t lock_ptr, dword_t old_irql) {
@@ -915,10 +913,7 @@ DECLARE_XBOXKRNL_EXPORT2(KfReleaseSpinLock, kThreading, kImplemented,
 void KeAcquireSpinLockAtRaisedIrql(lpdword_t lock_ptr) {
   // Lock.
   auto lock = reinterpret_cast<uint32_t*>(lock_ptr.host_address());
-  while (!xe::atomic_cas(0, 1, lock)) {
-    // Spin!
-    // TODO(benvanik): error on deadlock?
-  }
+  kernel_state()->spin_lock_table()->Acquire(lock_ptr.guest_address(), lock);
 }
 DECLARE_XBOXKRNL_EXPORT3(KeAcquireSpinLockAtRaisedIrql, kThreading,
                          kImplemented, kBlocking, kHighFrequency);
@@ -926,7 +921,7 @@ DECLARE_XBOXKRNL_EXPORT3(KeAcquireSpinLockAtRaisedIrql, kThreading,
 dword_result_t KeTryToAcquireSpinLockAtRaisedIrql(lpdword_t lock_ptr) {
   // Lock.
   auto lock = reinterpret_cast<uint32_t*>(lock_ptr.host_address());
-  if (!xe::atomic_cas(0, 1, lock)) {
+  if (!kernel_state()->spin_lock_table()->TryAcquire(lock)) {
     return 0;
   }
   return 1;
@@ -937,35 +932,36 @@ DECLARE_XBOXKRNL_EXPORT4(KeTryToAcquireSpinLockAtRaisedIrql, kThreading,
 void KeReleaseSpinLockFromRaisedIrql(lpdword_t lock_ptr) {
   // Unlock.
   auto lock = reinterpret_cast<uint32_t*>(lock_ptr.host_address());
-  xe::atomic_dec(lock);
+  kernel_state()->spin_lock_table()->Release(lock_ptr.guest_address(), lock);
 }
 DECLARE_XBOXKRNL_EXPORT2(KeReleaseSpinLockFromRaisedIrql, kThreading,
                          kImplemented, kHighFrequency);
 
-void KeEnterCriticalRegion() { XThread::EnterCriticalRegion(); }
+void KeEnterCriticalRegion() {
+  XThread::GetCurrentThread()->EnterCriticalRegion();
+}
 DECLARE_XBOXKRNL_EXPORT2(KeEnterCriticalRegion, kThreading, kImplemented,
                          kHighFrequency);
 
 void KeLeaveCriticalRegion() {
-  XThread::LeaveCriticalRegion();
-
-  XThread::GetCurrentThread()->CheckApcs();
+  auto thread = XThread::GetCurrentThread();
+  thread->LeaveCriticalRegion();
+  thread->CheckApcs();
 }
 DECLARE_XBOXKRNL_EXPORT2(KeLeaveCriticalRegion, kThreading, kImplemented,
                          kHighFrequency);
 
 dword_result_t KeRaiseIrqlToDpcLevel() {
-  auto old_value = kernel_state()->processor()->RaiseIrql(cpu::Irql::DPC);
-  return (uint32_t)old_value;
+  return XThread::GetCurrentThread()->RaiseIrql(
+      static_cast<uint32_t>(cpu::Irql::DPC));
 }
 DECLARE_XBOXKRNL_EXPORT2(KeRaiseIrqlToDpcLevel, kThreading, kImplemented,
                          kHighFrequency);
 
 void KfLowerIrql(dword_t old_value) {
-  kernel_state()->processor()->LowerIrql(
-      static_cast<cpu::Irql>((uint32_t)old_value));
-
-  XThread::GetCurrentThread()->CheckApcs();
+  auto thread = XThread::GetCurrentThread();
+  thread->LowerIrql(old_value);
+  thread->CheckApcs();
 }
 DECLARE_XBOXKRNL_EXPORT2(KfLowerIrql, kThreading, kImplemented, kHighFrequency);
 
@@ -9,10 +9,12 @@
 
 #include "xenia/kernel/xobject.h"
 
+#include <utility>
 #include <vector>
 
 #include "xenia/base/byte_stream.h"
 #include "xenia/base/clock.h"
+#include "xenia/cpu/thread_state.h"
 #include "xenia/kernel/kernel_state.h"
 #include "xenia/kernel/util/shim_utils.h"
 #include "xenia/kernel/xboxkrnl/xboxkrnl_private.h"
@@ -29,6 +31,36 @@
 namespace xe {
 namespace kernel {
 
+namespace {
+
+inline bool IsTimeout(xe::threading::WaitResult result) {
+  return result == xe::threading::WaitResult::kTimeout;
+}
+inline bool IsTimeout(std::pair<xe::threading::WaitResult, size_t> result) {
+  return IsTimeout(result.first);
+}
+
+// With virtual guest time, a guest thread counts as blocked while in a wait
+// that isn't satisfied right away, as time may skip once all of them are.
+template <typename Wait>
+auto GuestWait(std::chrono::milliseconds timeout, Wait wait)
+    -> decltype(wait(timeout)) {
+  if (!cvars::clock_virtual || !timeout.count() || !XThread::IsInThread() ||
+      !XThread::GetCurrentThread()->is_guest_thread()) {
+    return wait(timeout);
+  }
+  auto result = wait(std::chrono::milliseconds(0));
+  if (!IsTimeout(result)) {
+    return result;
+  }
+  Clock::BeginGuestWait();
+  result = wait(timeout);
+  Clock::EndGuestWait();
+  return result;
+}
+
+}  // namespace
+
 XObject::XObject(Type type)
     : kernel_state_(nullptr), pointer_ref_count_(1), type_(type) {
   handles_.reserve(10);
@@ -204,8 +236,13 @@ X_STATUS XObject::Wait(uint32_t wait_reason, uint32_t processor_mode,
                         TimeoutTicksToMs(*opt_timeout)))
                   : std::chrono::milliseconds::max();
 
+  // Retired guest code beneath can be freed while blocked.
+  cpu::GuestFramesPause guest_frames_pause;
   auto result =
-      xe::threading::Wait(wait_handle, alertable ? true : false, timeout_ms);
+      GuestWait(timeout_ms, [&](std::chrono::milliseconds timeout) {
+        return xe::threading::Wait(wait_handle, alertable ? true : false,
+                                   timeout);
+      });
   switch (result) {
     case xe::threading::WaitResult::kSuccess:
       WaitCallback();
@@ -231,9 +268,18 @@ X_STATUS XObject::SignalAndWait(XObject* signal_object, XObject* wait_object,
                         TimeoutTicksToMs(*opt_timeout)))
                   : std::chrono::milliseconds::max();
 
+  cpu::GuestFramesPause guest_frames_pause;
+  // Signaled only once, before the wait proper if it isn't satisfied.
   auto result = xe::threading::SignalAndWait(
       signal_object->GetWaitHandle(), wait_object->GetWaitHandle(),
-      alertable ? true : false, timeout_ms);
+      alertable ? true : false,
+      cvars::clock_virtual ? std::chrono::milliseconds(0) : timeout_ms);
+  if (cvars::clock_virtual && IsTimeout(result)) {
+    result = GuestWait(timeout_ms, [&](std::chrono::milliseconds timeout) {
+      return xe::threading::Wait(wait_object->GetWaitHandle(),
+                                 alertable ? true : false, timeout);
+    });
+  }
   switch (result) {
     case xe::threading::WaitResult::kSuccess:
       wait_object->WaitCallback();
@@ -266,9 +312,14 @@ X_STATUS XObject::WaitMultiple(uint32_t count, XObject** objects,
                         TimeoutTicksToMs(*opt_timeout)))
                   : std::chrono::milliseconds::max();
 
+  cpu::GuestFramesPause guest_frames_pause;
   if (wait_type) {
-    auto result = xe::threading::WaitAny(std::move(wait_handles),
-                                         alertable ? true : false, timeout_ms);
+    auto result =
+        GuestWait(timeout_ms, [&](std::chrono::milliseconds timeout) {
+          return xe::threading::WaitAny(wait_handles.data(),
+                                        wait_handles.size(),
+                                        alertable ? true : false, timeout);
+        });
     switch (result.first) {
       case xe::threading::WaitResult::kSuccess:
         objects[result.second]->WaitCallback();
@@ -287,8 +338,12 @@ X_STATUS XObject::WaitMultiple(uint32_t count, XObject** objects,
         return X_STATUS_UNSUCCESSFUL;
     }
   } else {
-    auto result = xe::threading::WaitAll(std::move(wait_handles),
-                                         alertable ? true : false, timeout_ms);
+    auto result =
+        GuestWait(timeout_ms, [&](std::chrono::milliseconds timeout) {
+          return xe::threading::WaitAll(wait_handles.data(),
+                                        wait_handles.size(),
+                                        alertable ? true : false, timeout);
+        });
     switch (result) {
       case xe::threading::WaitResult::kSuccess:
         for (uint32_t i = 0; i < count; i++) {
@@ -373,9 +428,22 @@ object_ref<XObject> XObject::GetNativeObject(KernelState* kernel_state,
   // We identify this by setting wait_list_flink to a magic value. When set,
   // wait_list_blink will hold a handle to our object.
 
-  auto global_lock = xe::global_critical_region::AcquireDirect();
-
   auto header = reinterpret_cast<X_DISPATCH_HEADER*>(native_ptr);
+  auto object_table = kernel_state->object_table();
+  uint32_t guest_ptr = kernel_state->memory()->HostToGuestVirtual(native_ptr);
+
+  // Fast path: objects we have already wrapped are resolved through a
+  // lock-free cache keyed by guest address. The stashed handle still has to
+  // match so that guest code reinitializing the struct is noticed.
+  if (header->wait_list_flink == 'XEN\0') {
+    auto object =
+        object_table->LookupNativeObject(guest_ptr, header->wait_list_blink);
+    if (object) {
+      return object;
+    }
+  }
+
+  auto global_lock = xe::global_critical_region::AcquireDirect();
 
   if (as_type == -1) {
     as_type = header->type;
@@ -385,7 +453,10 @@ object_ref<XObject> XObject::GetNativeObject(KernelState* kernel_state,
     // Already initialized.
     // TODO: assert if the type of the object != as_type
     uint32_t handle = header->wait_list_blink;
-    auto object = kernel_state->object_table()->LookupObject<XObject>(handle);
+    auto object = object_table->LookupObject<XObject>(handle);
+    if (object) {
+      object_table->CacheNativeObject(guest_ptr, handle, object.get());
+    }
 
     // TODO(benvanik): assert nothing has been changed in the struct.
     return object;
@@ -434,6 +505,7 @@ object_ref<XObject> XObject::GetNativeObject(KernelState* kernel_state,
     // Stash pointer in struct.
     // FIXME: This assumes the object contains a dispatch header (some don't!)
     StashHandle(header, object->handle());
+    object_table->CacheNativeObject(guest_ptr, object->handle(), object);
 
     return object_ref<XObject>(object);
   }
@@ -12,6 +12,7 @@
 #include "xenia/base/platform.h"
 #include "xenia/kernel/kernel_state.h"
 #include "xenia/kernel/xam/xam_module.h"
+#include "xenia/kernel/xevent.h"
 // #include "xenia/kernel/xnet.h"
 
 #ifdef XE_PLATFORM_WIN32
@@ -22,6 +23,7 @@
 // clang-format on
 #else
 #include <arpa/inet.h>
+#include <fcntl.h>
 #include <netinet/in.h>
 #include <netinet/ip.h>
 #include <sys/socket.h>
@@ -52,11 +54,27 @@ X_STATUS XSocket::Initialize(AddressFamily af, Type type, Protocol proto) {
   if (native_handle_ == -1) {
     return X_STATUS_UNSUCCESSFUL;
   }
+  RegisterWithPoller();
 
   return X_STATUS_SUCCESS;
 }
 
+void XSocket::RegisterWithPoller() {
+  std::atomic_store(&poll_registration_,
+                    kernel_state_->socket_poller()->Register(native_handle_));
+}
+
 X_STATUS XSocket::Close() {
+  if (native_handle_ == -1) {
+    return X_STATUS_SUCCESS;
+  }
+  auto registration = std::atomic_exchange(
+      &poll_registration_,
+      std::shared_ptr<util::SocketPoller::Registration>());
+  if (registration) {
+    kernel_state_->socket_poller()->Unregister(registration.get());
+  }
+
 #if XE_PLATFORM_WIN32
   int ret = closesocket(native_handle_);
 #elif XE_PLATFORM_LINUX
@@ -66,6 +84,7 @@ X_STATUS XSocket::Close() {
   if (ret != 0) {
     return X_STATUS_UNSUCCESSFUL;
   }
+  native_handle_ = -1;
 
   return X_STATUS_SUCCESS;
 }
@@ -107,6 +126,47 @@ X_STATUS XSocket::IOControl(uint32_t cmd, uint8_t* arg_ptr) {
 #endif
 }
 
+X_STATUS XSocket::EventSelect(object_ref<XEvent> event,
+                              uint32_t network_events) {
+  if (!event) {
+    network_events = 0;
+  }
+#ifdef XE_PLATFORM_WIN32
+  // The host event of the XEvent serves as the WSAEVENT.
+  int ret = WSAEventSelect(
+      native_handle_,
+      event ? event->GetWaitHandle()->native_handle() : nullptr,
+      network_events);
+  return ret == 0 ? X_STATUS_SUCCESS : X_STATUS_UNSUCCESSFUL;
+#else
+  int flags = fcntl(int(native_handle_), F_GETFL, 0);
+  if (flags < 0 ||
+      fcntl(int(native_handle_), F_SETFL, flags | O_NONBLOCK) < 0) {
+    return X_STATUS_UNSUCCESSFUL;
+  }
+
+  // FD_READ, FD_ACCEPT, FD_CLOSE; FD_WRITE, FD_CONNECT; FD_OOB.
+  uint32_t interest = 0;
+  if (network_events & (0x01 | 0x08 | 0x20)) {
+    interest |= util::kSocketReadable;
+  }
+  if (network_events & (0x02 | 0x10)) {
+    interest |= util::kSocketWritable;
+  }
+  if (network_events & 0x04) {
+    interest |= util::kSocketException;
+  }
+  auto registration = poll_registration();
+  if (!registration ||
+      !kernel_state_->socket_poller()->SetObserver(
+          registration.get(), interest,
+          [event]() { event->Set(0, false); })) {
+    return X_STATUS_UNSUCCESSFUL;
+  }
+  return X_STATUS_SUCCESS;
+#endif  // XE_PLATFORM_WIN32
+}
+
 X_STATUS XSocket::Connect(N_XSOCKADDR* name, int name_len) {
   int ret = connect(native_handle_, (sockaddr*)name, name_len);
   if (ret < 0) {
@@ -156,6 +216,7 @@ object_ref<XSocket> XSocket::Accept(N_XSOCKADDR* name, int* name_len) {
   socket->af_ = af_;
   socket->type_ = type_;
   socket->proto_ = proto_;
+  socket->RegisterWithPoller();
 
   return socket;
 }
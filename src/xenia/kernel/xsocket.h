@@ -10,14 +10,18 @@
 #ifndef XENIA_KERNEL_XSOCKET_H_
 #define XENIA_KERNEL_XSOCKET_H_
 
+#include <memory>
 #include <queue>
 
 #include "xenia/base/byte_order.h"
 #include "xenia/base/math.h"
+#include "xenia/kernel/util/socket_poller.h"
 #include "xenia/kernel/xobject.h"
 
 namespace xe {
 namespace kernel {
+class XEvent;
+
 struct XSOCKADDR {
   xe::be<uint16_t> address_family;
   char sa_data[14];
@@ -92,6 +96,11 @@ class XSocket : public XObject {
 
   uint64_t native_handle() const { return native_handle_; }
   uint16_t bound_port() const { return bound_port_; }
+  // Readiness as tracked by the kernel's socket poller, while open. May be
+  // called while another thread closes the socket.
+  std::shared_ptr<util::SocketPoller::Registration> poll_registration() const {
+    return std::atomic_load(&poll_registration_);
+  }
 
   X_STATUS Initialize(AddressFamily af, Type type, Protocol proto);
   X_STATUS Close();
@@ -99,6 +108,10 @@ class XSocket : public XObject {
   X_STATUS SetOption(uint32_t level, uint32_t optname, void* optval_ptr,
                      uint32_t optlen);
   X_STATUS IOControl(uint32_t cmd, uint8_t* arg_ptr);
+  // As WSAEventSelect: makes the socket non-blocking, and sets the event when
+  // it becomes ready for any of the FD_* network events. No events and no
+  // event stop it.
+  X_STATUS EventSelect(object_ref<XEvent> event, uint32_t network_events);
 
   X_STATUS Connect(N_XSOCKADDR* name, int name_len);
   X_STATUS Bind(N_XSOCKADDR_IN* name, int name_len);
@@ -129,7 +142,11 @@ class XSocket : public XObject {
 
  private:
   XSocket(KernelState* kernel_state, uint64_t native_handle);
+  void RegisterWithPoller();
+
   uint64_t native_handle_ = -1;
+  // Only accessed with std::atomic_load and std::atomic_store.
+  std::shared_ptr<util::SocketPoller::Registration> poll_registration_;
 
   AddressFamily af_;    // Address family
   Type type_;           // Type (DGRAM/Stream/etc)
@@ -24,6 +24,7 @@
 #include "xenia/cpu/breakpoint.h"
 #include "xenia/cpu/ppc/ppc_decode_data.h"
 #include "xenia/cpu/processor.h"
+#include "xenia/cpu/thread_state.h"
 #include "xenia/emulator.h"
 #include "xenia/kernel/kernel_state.h"
 #include "xenia/kernel/user_module.h"
@@ -57,7 +58,7 @@ XThread::XThread(KernelState* kernel_state, uint32_t stack_size,
       thread_id_(++next_xthread_id_),
       guest_thread_(guest_thread),
       main_thread_(main_thread),
-      apc_list_(kernel_state->memory()) {
+      apc_queue_(util::NativeList(kernel_state->memory())) {
   creation_params_.stack_size = stack_size;
   creation_params_.xapi_thread_startup = xapi_thread_startup;
   creation_params_.start_address = start_address;
@@ -92,9 +93,9 @@ XThread::~XThread() {
   if (thread_state_) {
     delete thread_state_;
   }
-  kernel_state()->memory()->SystemHeapFree(scratch_address_);
-  kernel_state()->memory()->SystemHeapFree(tls_static_address_);
-  kernel_state()->memory()->SystemHeapFree(pcr_address_);
+  FreeSystemBlock(scratch_address_, scratch_size_);
+  FreeSystemBlock(tls_static_address_, tls_total_size_);
+  FreeSystemBlock(pcr_address_, kPcrSize);
   FreeStack();
 
   if (thread_) {
@@ -227,7 +228,18 @@ bool XThread::AllocateStack(uint32_t size) {
   size = xe::round_up(size, alignment);
   auto actual_size = size + padding;
 
-  uint32_t address = 0;
+  uint32_t address = kernel_state()->thread_stack_pool()->Acquire(actual_size);
+  if (address) {
+    stack_alloc_base_ = address;
+    stack_alloc_size_ = actual_size;
+    stack_limit_ = address + (padding / 2);
+    stack_base_ = stack_limit_ + size;
+
+    // An exited thread's, with its guard pages still in place.
+    memory()->Fill(stack_limit_, size, 0x00);
+    return true;
+  }
+
   if (!heap->AllocRange(0x40000000, 0x7F000000, actual_size, alignment,
                         kMemoryAllocationReserve | kMemoryAllocationCommit,
                         kMemoryProtectRead | kMemoryProtectWrite, false,
@@ -252,8 +264,11 @@ bool XThread::AllocateStack(uint32_t size) {
 
 void XThread::FreeStack() {
   if (stack_alloc_base_) {
-    auto heap = memory()->LookupHeap(0x40000000);
-    heap->Release(stack_alloc_base_);
+    if (!kernel_state()->thread_stack_pool()->Release(stack_alloc_base_,
+                                                      stack_alloc_size_)) {
+      auto heap = memory()->LookupHeap(0x40000000);
+      heap->Release(stack_alloc_base_);
+    }
 
     stack_alloc_base_ = 0;
     stack_alloc_size_ = 0;
@@ -262,6 +277,22 @@ void XThread::FreeStack() {
   }
 }
 
+uint32_t XThread::AllocateSystemBlock(uint32_t size) {
+  uint32_t address = kernel_state()->thread_block_pool()->Acquire(size);
+  if (!address) {
+    return memory()->SystemHeapAlloc(size);
+  }
+  // Zeroed, as SystemHeapAlloc does.
+  memory()->Zero(address, size);
+  return address;
+}
+
+void XThread::FreeSystemBlock(uint32_t address, uint32_t size) {
+  if (!kernel_state()->thread_block_pool()->Release(address, size)) {
+    memory()->SystemHeapFree(address);
+  }
+}
+
 X_STATUS XThread::Create() {
   // Thread kernel object.
   if (!CreateNative<X_KTHREAD>()) {
@@ -277,7 +308,7 @@ X_STATUS XThread::Create() {
   // Allocate thread scratch.
   // This is used by interrupts/APCs/etc so we can round-trip pointers through.
   scratch_size_ = 4 * 16;
-  scratch_address_ = memory()->SystemHeapAlloc(scratch_size_);
+  scratch_address_ = AllocateSystemBlock(scratch_size_);
 
   // Allocate TLS block.
   // Games will specify a certain number of 4b slots that each thread will get.
@@ -300,7 +331,7 @@ X_STATUS XThread::Create() {
   // will directly access those through 0(r13).
   uint32_t tls_slot_size = tls_slots * 4;
   tls_total_size_ = tls_slot_size + tls_extended_size;
-  tls_static_address_ = memory()->SystemHeapAlloc(tls_total_size_);
+  tls_static_address_ = AllocateSystemBlock(tls_total_size_);
   tls_dynamic_address_ = tls_static_address_ + tls_extended_size;
   if (!tls_static_address_) {
     XELOGW("Unable to allocate thread local storage block");
@@ -331,7 +362,7 @@ X_STATUS XThread::Create() {
   // 0x160: last error
   // So, at offset 0x100 we have a 4b pointer to offset 200, then have the
   // structure.
-  pcr_address_ = memory()->SystemHeapAlloc(0x2D8);
+  pcr_address_ = AllocateSystemBlock(kPcrSize);
   if (!pcr_address_) {
     XELOGW("Unable to allocate thread state block");
     return X_STATUS_NO_MEMORY;
@@ -434,6 +465,10 @@ X_STATUS XThread::Create() {
 
   // Notify processor of our creation.
   emulator()->processor()->OnThreadCreated(handle(), thread_state_, this);
+  if (guest_thread_) {
+    clock_guest_thread_ = true;
+    Clock::AddGuestThread();
+  }
 
   if ((creation_params_.creation_flags & X_CREATE_SUSPENDED) == 0) {
     // Start the thread now that we're all setup.
@@ -459,6 +494,10 @@ X_STATUS XThread::Exit(int exit_code) {
 
   // Notify processor of our exit.
   emulator()->processor()->OnThreadExit(thread_id_);
+  if (clock_guest_thread_) {
+    clock_guest_thread_ = false;
+    Clock::RemoveGuestThread();
+  }
 
   // NOTE: unless PlatformExit fails, expect it to never return!
   current_xthread_tls_ = nullptr;
@@ -483,6 +522,10 @@ X_STATUS XThread::Terminate(int exit_code) {
 
   // Notify processor of our exit.
   emulator()->processor()->OnThreadExit(thread_id_);
+  if (clock_guest_thread_) {
+    clock_guest_thread_ = false;
+    Clock::RemoveGuestThread();
+  }
 
   running_ = false;
   if (XThread::IsInThread(this)) {
@@ -535,29 +578,34 @@ void XThread::Execute() {
   Exit(exit_code);
 }
 
-void XThread::EnterCriticalRegion() {
-  xe::global_critical_region::mutex().lock();
-}
+void XThread::EnterCriticalRegion() { apc_queue_.EnterCriticalRegion(); }
 
-void XThread::LeaveCriticalRegion() {
-  xe::global_critical_region::mutex().unlock();
-}
+void XThread::LeaveCriticalRegion() { apc_queue_.LeaveCriticalRegion(); }
 
 uint32_t XThread::RaiseIrql(uint32_t new_irql) {
-  return irql_.exchange(new_irql);
+  return apc_queue_.RaiseIrql(new_irql);
 }
 
-void XThread::LowerIrql(uint32_t new_irql) { irql_ = new_irql; }
+void XThread::LowerIrql(uint32_t new_irql) { apc_queue_.LowerIrql(new_irql); }
 
-void XThread::CheckApcs() { DeliverAPCs(); }
+void XThread::CheckApcs() {
+  if (apc_queue_.CanDeliver()) {
+    DeliverAPCs();
+  }
+}
 
-void XThread::LockApc() { EnterCriticalRegion(); }
+void XThread::LockApc() { apc_queue_.Lock(); }
 
 void XThread::UnlockApc(bool queue_delivery) {
-  bool needs_apc = apc_list_.HasPending();
-  LeaveCriticalRegion();
+  bool needs_apc = apc_queue_.Unlock();
   if (needs_apc && queue_delivery) {
-    thread_->QueueUserCallback([this]() { DeliverAPCs(); });
+    // Run when the thread next waits alertably, and only if it can take APCs
+    // then - otherwise leaving the critical region or lowering the IRQL will.
+    thread_->QueueUserCallback([this]() {
+      if (apc_queue_.CanDeliver()) {
+        DeliverAPCs();
+      }
+    });
   }
 }
 
@@ -580,7 +628,7 @@ void XThread::EnqueueApc(uint32_t normal_routine, uint32_t normal_context,
   apc->enqueued = 1;
 
   uint32_t list_entry_ptr = apc_ptr + 8;
-  apc_list_.Insert(list_entry_ptr);
+  apc_list()->Insert(list_entry_ptr);
 
   UnlockApc(true);
 }
@@ -590,10 +638,10 @@ void XThread::DeliverAPCs() {
   // https://www.drdobbs.com/inside-nts-asynchronous-procedure-call/184416590?pgno=7
   auto processor = kernel_state()->processor();
   LockApc();
-  while (apc_list_.HasPending()) {
+  while (apc_list()->HasPending()) {
     // Get APC entry (offset for LIST_ENTRY offset) and cache what we need.
     // Calling the routine may delete the memory/overwrite it.
-    uint32_t apc_ptr = apc_list_.Shift() - 8;
+    uint32_t apc_ptr = apc_list()->Shift() - 8;
     auto apc = reinterpret_cast<XAPC*>(memory()->TranslateVirtual(apc_ptr));
     bool needs_freeing = apc->kernel_routine == XAPC::kDummyKernelRoutine;
 
@@ -654,10 +702,10 @@ void XThread::DeliverAPCs() {
 void XThread::RundownAPCs() {
   assert_true(XThread::GetCurrentThread() == this);
   LockApc();
-  while (apc_list_.HasPending()) {
+  while (apc_list()->HasPending()) {
     // Get APC entry (offset for LIST_ENTRY offset) and cache what we need.
     // Calling the routine may delete the memory/overwrite it.
-    uint32_t apc_ptr = apc_list_.Shift() - 8;
+    uint32_t apc_ptr = apc_list()->Shift() - 8;
     auto apc = reinterpret_cast<XAPC*>(memory()->TranslateVirtual(apc_ptr));
     bool needs_freeing = apc->kernel_routine == XAPC::kDummyKernelRoutine;
 
@@ -801,7 +849,16 @@ X_STATUS XThread::Delay(uint32_t processor_mode, uint32_t alertable,
   } else {
     timeout_ms = 0;
   }
-  timeout_ms = Clock::ScaleGuestDurationMillis(timeout_ms);
+  if (cvars::clock_virtual) {
+    // Guest time only moves as the guest runs, so the delay ends once other
+    // threads have run for it, or is skipped over once they are all blocked.
+    // Only then are any APCs taken, if alertable.
+    Clock::SkipGuestIdle(timeout_ticks < 0 ? uint64_t(-timeout_ticks) : 0);
+    timeout_ms = 0;
+  } else {
+    timeout_ms = Clock::ScaleGuestDurationMillis(timeout_ms);
+  }
+  cpu::GuestFramesPause guest_frames_pause;
   if (alertable) {
     auto result =
         xe::threading::AlertableSleep(std::chrono::milliseconds(timeout_ms));
@@ -880,7 +937,7 @@ bool XThread::Save(ByteStream* stream) {
   state.thread_id = thread_id_;
   state.is_main_thread = main_thread_;
   state.is_running = running_;
-  state.apc_head = apc_list_.head();
+  state.apc_head = apc_queue_.list()->head();
   state.tls_static_address = tls_static_address_;
   state.tls_dynamic_address = tls_dynamic_address_;
   state.tls_total_size = tls_total_size_;
@@ -943,7 +1000,6 @@ object_ref<XThread> XThread::Restore(KernelState* kernel_state,
   thread->thread_id_ = state.thread_id;
   thread->main_thread_ = state.is_main_thread;
   thread->running_ = state.is_running;
-  thread->apc_list_.set_head(state.apc_head);
   thread->tls_static_address_ = state.tls_static_address;
   thread->tls_dynamic_address_ = state.tls_dynamic_address;
   thread->tls_total_size_ = state.tls_total_size;
@@ -953,7 +1009,10 @@ object_ref<XThread> XThread::Restore(KernelState* kernel_state,
   thread->stack_alloc_base_ = state.stack_alloc_base;
   thread->stack_alloc_size_ = state.stack_alloc_size;
 
-  thread->apc_list_.set_memory(kernel_state->memory());
+  thread->LockApc();
+  thread->apc_list()->set_head(state.apc_head);
+  thread->apc_list()->set_memory(kernel_state->memory());
+  thread->UnlockApc(false);
 
   // Register now that we know our thread ID.
   kernel_state->RegisterThread(thread);
@@ -1029,6 +1088,10 @@ object_ref<XThread> XThread::Restore(KernelState* kernel_state,
     // Notify processor we were recreated.
     thread->emulator()->processor()->OnThreadCreated(
         thread->handle(), thread->thread_state(), thread);
+    if (thread->guest_thread_) {
+      thread->clock_guest_thread_ = true;
+      Clock::AddGuestThread();
+    }
   }
 
   return object_ref<XThread>(thread);
@@ -17,6 +17,7 @@
 #include "xenia/base/threading.h"
 #include "xenia/cpu/thread.h"
 #include "xenia/cpu/thread_state.h"
+#include "xenia/kernel/util/apc_queue.h"
 #include "xenia/kernel/util/native_list.h"
 #include "xenia/kernel/xmutant.h"
 #include "xenia/kernel/xobject.h"
@@ -106,6 +107,8 @@ static_assert_size(X_KTHREAD, 0xAB0);
 class XThread : public XObject, public cpu::Thread {
  public:
   static const Type kType = kTypeThread;
+  // Size of the thread state block (PCR) set as r13.
+  static const uint32_t kPcrSize = 0x2D8;
 
   struct CreationParams {
     uint32_t stack_size;
@@ -150,15 +153,18 @@ class XThread : public XObject, public cpu::Thread {
 
   virtual void Execute();
 
-  static void EnterCriticalRegion();
-  static void LeaveCriticalRegion();
+  // Critical regions and the IRQL only hold back APCs to this thread, and must
+  // be changed from it.
+  void EnterCriticalRegion();
+  void LeaveCriticalRegion();
   uint32_t RaiseIrql(uint32_t new_irql);
   void LowerIrql(uint32_t new_irql);
 
+  // Delivers queued APCs if the thread can take them now.
   void CheckApcs();
   void LockApc();
   void UnlockApc(bool queue_delivery);
-  util::NativeList* apc_list() { return &apc_list_; }
+  util::NativeList* apc_list() { return apc_queue_.list(); }
   void EnqueueApc(uint32_t normal_routine, uint32_t normal_context,
                   uint32_t arg1, uint32_t arg2);
 
@@ -193,6 +199,10 @@ class XThread : public XObject, public cpu::Thread {
  protected:
   bool AllocateStack(uint32_t size);
   void FreeStack();
+  // Allocates from the system heap, or reuses a block of the size freed by an
+  // exited thread.
+  uint32_t AllocateSystemBlock(uint32_t size);
+  void FreeSystemBlock(uint32_t address, uint32_t size);
   void InitializeGuestObject();
 
   void DeliverAPCs();
@@ -218,13 +228,14 @@ class XThread : public XObject, public cpu::Thread {
   bool guest_thread_ = false;
   bool main_thread_ = false;  // Entry-point thread
   bool running_ = false;
+  // Counted by Clock as a guest thread until it exits.
+  bool clock_guest_thread_ = false;
 
   int32_t priority_ = 0;
   uint32_t affinity_ = 0;
 
   xe::global_critical_region global_critical_region_;
-  std::atomic<uint32_t> irql_ = {0};
-  util::NativeList apc_list_;
+  util::ApcQueue<util::NativeList> apc_queue_;
 };
 
 class XHostThread : public XThread {